@@ -98,6 +98,23 @@ typedef struct {
     custom_component_info *custom_components;   /**< The custom components. */
 } cap_file_constant_info;
 
+/**
+ * \brief What the Directory component of the CAP file an analyzed CAP file
+ * comes from tells about the components which may be copied from it.
+ */
+typedef struct {
+    u2 component_sizes[12];     /**< The size of each component, indexed by its
+                                     tag minus one, 0 if it is absent. */
+    u2 image_size;              /**< The image size of the Static Field
+                                     component. */
+    u2 array_init_count;        /**< The array_init_count of the Static Field
+                                     component. */
+    u2 array_init_size;         /**< The array_init_size of the Static Field
+                                     component. */
+    u1 import_count;            /**< The number of imported packages. */
+    u1 applet_count;            /**< The number of applets. */
+} source_directory_info;
+
 
 /**
  * \brief Information about an imported package.
@@ -323,38 +340,47 @@ typedef struct {
 } stableswitch_info;
 
 
+/**
+ * \brief Represent the arguments of a switch like bytecode.
+ *
+ * The member to use is given by the opcode of the owning bytecode.
+ */
+typedef union {
+    ilookupswitch_info ilookupswitch;   /**< Opcode is equal to 118. */
+    slookupswitch_info slookupswitch;   /**< Opcode is equal to 117. */
+    itableswitch_info itableswitch;     /**< Opcode is equal to 116. */
+    stableswitch_info stableswitch;     /**< Opcode is equal to 115. */
+} switch_info;
+
+
 /**
  * \brief Represent an analyzed bytecode and its arguments.
+ *
+ * Switch like bytecodes are rare so their arguments are kept out of line to
+ * keep this structure small.
  */
 typedef struct bytecode_info {
     u1 opcode;          /**< The opcode of the bytecode (see page 7-1 of Virtual
                              Machine Specification, Java Card Platform,
                              v2.2.2). */
-    u2 offset;          /**< Offset within the method. */
-    u2 info_offset;     /**< Offset within info[] of the Method component. */
-
-    u1 nb_args;         /**< Number of bytes representing the arguments for the
-                             represented bytecode */
-
     u1 nb_byte_args;    /**< Number of byte arguments (do not include references
                              and branches) like pushed static final values and such. */
     u1 args[4];         /**< Value of the byte arguments. */
 
     u1 has_ref;         /**< Does the bytecode use a reference? */
-    constant_pool_entry_info* ref;  /**< Should be set if has_ref is true (!=0). */
-
     u1 has_branch;      /**< Does the bytecode use a branch? */
+
+    u2 nb_args;         /**< Number of bytes representing the arguments for the
+                             represented bytecode */
+    u2 offset;          /**< Offset within the method. */
+    u2 info_offset;     /**< Offset within info[] of the Method component. */
+
+    constant_pool_entry_info* ref;  /**< Should be set if has_ref is true (!=0). */
     struct bytecode_info* branch;   /**< Should be set of has_branch is true
                                         (!=0). */
 
-    ilookupswitch_info ilookupswitch;   /**< Should be set if opcode is equal to
-                                             118. */
-    slookupswitch_info slookupswitch;   /**< Should be set if opcode is equal to
-                                             117. */
-    itableswitch_info itableswitch;     /**< Should be set if opcode is equal to
-                                             116. */
-    stableswitch_info stableswitch;     /**< Should be set if opcode is equal to
-                                             115. */
+    switch_info* switch_data;   /**< Should be set if opcode is between 115 and
+                                     118 included, NULL else. */
 } bytecode_info;
 
 
@@ -406,9 +432,9 @@ typedef struct method_info {
 #define METHOD_INIT         0x0080  /**< The method is a class init. */
 #define METHOD_EXTENDED     0x0100  /**< The method header is extended. */
     u2 flags;                       /**< Describe the method properties. */
-    u1 max_stack;           /**< Is not generated but should. FIXME */
-    u1 nargs;               /**< Is not generated but should. FIXME */
-    u1 max_locals;          /**< Is not generated but should. FIXME */
+    u1 max_stack;           /**< Computed again when generating. */
+    u1 nargs;               /**< Computed again when generating. */
+    u1 max_locals;          /**< Computed again when generating. */
 
     type_descriptor_info* signature;    /**< The signature is part of the
                                              analyzed signature pool. */ 
@@ -417,6 +443,10 @@ typedef struct method_info {
                              counted). The size of the bytecodes array. */
     u2 bytecodes_size;  /**< The size of the bytecodes and their args in byte. */
     bytecode_info** bytecodes;  /**< The bytecodes of the method. */
+    u1 needs_layout;    /**< Set by whatever changes bytecodes so that an
+                             incremental generation computes the frame of
+                             the method and lays it out again (see
+                             GENERATE_INCREMENTAL_LAYOUT). */
 
     u1 exception_handlers_count;    /**< The number of exception handlers. */
     exception_handler_info** exception_handlers; /**< Exception handlers with a
@@ -565,6 +595,16 @@ typedef struct {
         handlers. */
     exception_handler_info** exception_handlers;    /**< The analyzed exception
         handlers. */
+
+    char* source;   /**< The CAP file this one was analyzed from, NULL if
+        unknown. */
+    source_directory_info source_directory; /**< What the source tells about
+        its components. */
+    u2 dirty_components;    /**< The COMPONENT_BIT() of the components changed
+        since the analysis. Anything changing the analyzed CAP file must add
+        the components it changed so the others may be copied from the source
+        when writing the generated CAP file. A method whose needs_layout is
+        set counts as a change of the Method component. */
 } analyzed_cap_file;
 
 #endif
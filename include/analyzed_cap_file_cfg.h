@@ -0,0 +1,243 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_cfg.h
+ * \brief Basic blocks, control flow graph and dominators of analyzed
+ * methods.
+ *
+ * Blocks are contiguous ranges of bytecode indexes. The edges of all the
+ * blocks of a method are kept in two flat arrays, the successors and the
+ * predecessors of a block being a slice of them: the normal ones first,
+ * then those due to exceptions.
+ */
+
+#ifndef ANALYZED_CAP_FILE_CFG_H
+#define ANALYZED_CAP_FILE_CFG_H
+
+#include "analyzed_cap_file.h"
+
+#define CFG_NONE    0xFFFF  /**< No block. */
+
+/**
+ * \brief A table giving the index of a bytecode within its method from its
+ * address.
+ */
+typedef struct {
+    u4 mask;                    /**< The size of the table minus one. */
+    bytecode_info** keys;       /**< The bytecodes hashed by address. */
+    u2* values;                 /**< The index of each hashed bytecode. */
+} bytecode_index_map;
+
+/**
+ * \brief A basic block.
+ */
+typedef struct {
+    u2 start;                           /**< Index of the first bytecode. */
+    u2 end;                             /**< Index right after the last
+                                             bytecode. */
+
+    u4 first_successor;                 /**< Index of the first successor in
+                                             the successors array. */
+    u2 successors_count;                /**< Number of blocks which might be
+                                             executed next. */
+    u2 exception_successors_count;      /**< Number of exception handlers
+                                             covering the block, following the
+                                             other successors. */
+
+    u4 first_predecessor;               /**< Index of the first predecessor in
+                                             the predecessors array. */
+    u2 predecessors_count;              /**< Number of blocks which might be
+                                             executed right before. */
+    u2 exception_predecessors_count;    /**< Number of blocks this one handles
+                                             exceptions of, following the
+                                             other predecessors. */
+
+    u2 idom;                            /**< The immediate dominator, CFG_NONE
+                                             for the entry block and
+                                             unreachable ones. */
+    u2 rpo;                             /**< Position in reverse postorder,
+                                             CFG_NONE if unreachable. */
+} cfg_block;
+
+/**
+ * \brief The control flow graph of a method.
+ *
+ * Blocks start at the first bytecode, at branch, switch and exception
+ * handler targets, at the start and end of exception handler ranges and
+ * after branches, switches, returns, athrow and ret. A block is either
+ * entirely covered by a handler or not at all. jsr is considered to fall
+ * through to the next bytecode and ret to have no successor.
+ */
+typedef struct {
+    method_info* method;        /**< The method. */
+    bytecode_info** bytecodes;  /**< The bytecodes array the graph was built
+                                     from. */
+    u2 bytecodes_count;         /**< The number of bytecodes the graph was
+                                     built from. */
+
+    u2 blocks_count;            /**< The number of blocks. */
+    cfg_block* blocks;          /**< The blocks sorted by bytecode index, the
+                                     entry block being the first one. */
+    u2* block_of;               /**< The block of each bytecode. */
+
+    u2* successors;             /**< The successors of every block. */
+    u2* predecessors;           /**< The predecessors of every block. */
+
+    u2 reachable_count;         /**< The number of reachable blocks. */
+    u2* order;                  /**< The reachable blocks in reverse
+                                     postorder. */
+} method_cfg;
+
+/**
+ * \brief The control flow graphs of the class methods of an analyzed CAP
+ * file, built when first asked for.
+ *
+ * The cache is tied to the classes and methods the analyzed CAP file has
+ * when it is created.
+ */
+typedef struct {
+    analyzed_cap_file* acf;     /**< The analyzed CAP file. */
+    u2 classes_count;           /**< The number of classes. */
+    u2* methods_counts;         /**< The number of methods of each class. */
+    method_cfg*** cfgs;         /**< For each class, the graph of each method
+                                     or NULL if not built yet. */
+} cfg_cache;
+
+/**
+ * \brief Fill a table giving the index of each bytecode of a method.
+ *
+ * \param map    The table to fill, to be freed by free_bytecode_index_map()
+ *               even if an error occurred.
+ * \param method The method.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int init_bytecode_index_map(bytecode_index_map* map, method_info* method);
+
+/**
+ * \brief Get the index of a bytecode within the method a table was filled
+ * from, in constant time.
+ *
+ * \param map      The table.
+ * \param bytecode The bytecode.
+ *
+ * \return Return the index or CFG_NONE if the bytecode is not one of the
+ *         method.
+ */
+u2 get_mapped_bytecode_index(const bytecode_index_map* map, const bytecode_info* bytecode);
+
+/**
+ * \brief Free what a table holds.
+ *
+ * \param map The table.
+ */
+void free_bytecode_index_map(bytecode_index_map* map);
+
+/**
+ * \brief Build the control flow graph of a method, in time linear with
+ * respect to its bytecodes and edges, and compute its dominators.
+ *
+ * \param method The method.
+ *
+ * \return Return NULL if an error occurred, the allocated graph else.
+ */
+method_cfg* build_method_cfg(method_info* method);
+
+/**
+ * \brief Free a control flow graph.
+ *
+ * \param cfg The graph to free, may be NULL.
+ */
+void free_method_cfg(method_cfg* cfg);
+
+/**
+ * \brief Check whether every path from the entry to a block goes through
+ * another.
+ *
+ * \param cfg    The control flow graph.
+ * \param block1 The possible dominator.
+ * \param block2 The possibly dominated block.
+ *
+ * \return Return 1 if block1 dominates block2, which needs to be reachable,
+ *         0 else.
+ */
+int cfg_dominates(const method_cfg* cfg, u2 block1, u2 block2);
+
+/**
+ * \brief Allocate an empty cache of control flow graphs.
+ *
+ * \param acf The analyzed CAP file.
+ *
+ * \return Return NULL if an error occurred, the allocated cache else.
+ */
+cfg_cache* new_cfg_cache(analyzed_cap_file* acf);
+
+/**
+ * \brief Get the control flow graph of a class method, building it if it was
+ * not yet or if the bytecodes array or count of the method changed since.
+ *
+ * \param cache        The cache.
+ * \param class_index  Index of the class within the analyzed CAP file.
+ * \param method_index Index of the method within the class.
+ *
+ * \return Return NULL if an error occurred, the graph else which belongs to
+ *         the cache.
+ */
+method_cfg* get_method_cfg(cfg_cache* cache, u2 class_index, u2 method_index);
+
+/**
+ * \brief Forget the control flow graph of a class method whose bytecodes
+ * were changed in place.
+ *
+ * \param cache        The cache.
+ * \param class_index  Index of the class within the analyzed CAP file.
+ * \param method_index Index of the method within the class.
+ */
+void invalidate_method_cfg(cfg_cache* cache, u2 class_index, u2 method_index);
+
+/**
+ * \brief Free a cache and its control flow graphs.
+ *
+ * \param cache The cache to free.
+ */
+void free_cfg_cache(cfg_cache* cache);
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_constant.h
+ * \brief Fold operations on constants and propagate the value of static
+ * fields which are never written.
+ */
+
+#ifndef ANALYZED_CAP_FILE_CONSTANT_H
+#define ANALYZED_CAP_FILE_CONSTANT_H
+
+#include "analyzed_cap_file.h"
+
+/**
+ * \brief What the constant folding did.
+ */
+typedef struct {
+    u2 constant_fields;     /**< Number of static fields whose value is
+                                 known. */
+    u2 loads_replaced;      /**< Number of getstatic replaced by a push. */
+    u2 operations_folded;   /**< Number of arithmetic, logic and conversion
+                                 bytecodes computed. */
+    u2 branches_folded;     /**< Number of conditional branches turned into
+                                 a goto or removed. */
+    u4 bytes_saved;         /**< Size in byte saved in all class methods. */
+} constant_report;
+
+/**
+ * \brief Compute an arithmetic, logic or shift bytecode, from sadd to ixor
+ * except sneg and ineg, as a card would.
+ *
+ * \param opcode The opcode.
+ * \param value1 The first operand, sign extended if it is a short.
+ * \param value2 The second operand, sign extended if it is a short.
+ * \param result Set to the result, sign extended if it is a short.
+ *
+ * \return Return 1 if the result is computed, 0 if the bytecode would throw
+ *         an ArithmeticException or is not supported.
+ */
+char compute_operation(u1 opcode, int32_t value1, int32_t value2, int32_t* result);
+
+/**
+ * \brief Check whether the value of a static field is known when generating.
+ *
+ * Static final fields of primitive type are already replaced by their value
+ * by the converter and are not analyzed. The remaining static fields of
+ * type boolean, byte, short or int are constant if no bytecode of the
+ * package writes them and no other package can write them, that is if they
+ * are final, are not public or protected, or belong to a class which is not
+ * public.
+ *
+ * \param acf   The analyzed CAP file.
+ * \param field The static field.
+ * \param value Set to the initial value of the field if it is constant.
+ *
+ * \return Return 1 if the field is constant, 0 else.
+ */
+int get_constant_field_value(analyzed_cap_file* acf, field_info* field, int32_t* value);
+
+/**
+ * \brief Fold constants in every class method.
+ *
+ * getstatic of constant fields are replaced by a push of their value, then
+ * the following sequences are computed until none is found:
+ *  - a push followed by sneg, ineg, s2b, s2i, i2b or i2s,
+ *  - two pushes followed by an arithmetic, logic, shift or icmp bytecode
+ *    (divisions and remainders by zero are kept so they still throw),
+ *  - a push followed by if<cond>, two pushes followed by if_scmp<cond>,
+ *    aconst_null followed by ifnull or ifnonnull.
+ *
+ * A folded branch becomes a goto if it is always taken and is removed else.
+ * The bytecodes following a constant push must not be branch targets.
+ * Constant pool entries only used by the replaced getstatic are dropped
+ * when generating.
+ *
+ * \param acf    The analyzed CAP file.
+ * \param report Filled with what was done if not NULL.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int fold_constants(analyzed_cap_file* acf, constant_report* report);
+
+#endif
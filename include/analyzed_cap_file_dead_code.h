@@ -0,0 +1,84 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_dead_code.h
+ * \brief Remove the methods, fields, constant pool entries and signature pool
+ * entries of an analyzed CAP file that can never be used.
+ *
+ * Reachability starts from applet install methods, methods implementing an
+ * interface or overriding a method of an imported package and, when the
+ * package is exported, public and protected members of public classes.
+ * Interfaces and classes are always kept.
+ */
+
+#ifndef ANALYZED_CAP_FILE_DEAD_CODE_H
+#define ANALYZED_CAP_FILE_DEAD_CODE_H
+
+#include "analyzed_cap_file.h"
+
+/**
+ * \brief What was removed from an analyzed CAP file.
+ */
+typedef struct {
+    u2 methods_removed;                 /**< Number of removed methods. */
+    u2 fields_removed;                  /**< Number of removed fields. */
+    u2 constant_pool_entries_removed;   /**< Number of removed constant pool
+                                             entries. */
+    u2 signature_pool_entries_removed;  /**< Number of removed signature pool
+                                             entries. */
+} dead_code_report;
+
+/**
+ * \brief Remove the unreachable methods and fields of the classes of an
+ * analyzed CAP file as well as the constant pool entries, signature pool
+ * entries and exception handlers referring only to them.
+ *
+ * Removed methods and fields are not freed. A CAP file generated afterwards
+ * only contains the reachable set.
+ *
+ * \param acf    The analyzed CAP file.
+ * \param report Filled with what was removed if not NULL.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int remove_dead_code(analyzed_cap_file* acf, dead_code_report* report);
+
+#endif
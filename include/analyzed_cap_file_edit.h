@@ -0,0 +1,221 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_edit.h
+ * \brief Insert, remove and replace analyzed bytecodes while keeping
+ * branches, switches and exception handlers consistent.
+ *
+ * remove_bytecodes edits a method right away. A bytecode editor instead
+ * records any number of edits, indexed as the method was before them, and
+ * applies them all at once in a single pass over the method, so that
+ * injecting a probe before each of its bytecodes is not quadratic.
+ */
+
+#ifndef ANALYZED_CAP_FILE_EDIT_H
+#define ANALYZED_CAP_FILE_EDIT_H
+
+#include "analyzed_cap_file.h"
+
+#define BYTECODE_EDIT_INSERT_BEFORE 0   /**< Insert before a bytecode. */
+#define BYTECODE_EDIT_REMOVE        1   /**< Remove bytecodes. */
+#define BYTECODE_EDIT_INSERT_AFTER  2   /**< Insert after a bytecode. */
+
+/**
+ * \brief An edit waiting to be applied.
+ */
+typedef struct {
+    u1 kind;                    /**< One of BYTECODE_EDIT_*. */
+    u1 retarget;                /**< For an insertion before, whether what
+                                     referred to the bytecode now refers to
+                                     the first inserted one. */
+    u2 index;                   /**< Index of the bytecode in the method as it
+                                     was before any edit. */
+    u2 count;                   /**< Number of bytecodes removed or
+                                     inserted. */
+    u2 span;                    /**< Number of replaced bytecodes referred to
+                                     through the first inserted one. */
+    u4 order;                   /**< Rank of the edit so that insertions at the
+                                     same place are kept in order. */
+    bytecode_info** bytecodes;  /**< The inserted bytecodes. */
+} bytecode_edit;
+
+/**
+ * \brief Edits of a method waiting to be applied.
+ */
+typedef struct {
+    method_info* method;    /**< The edited method. */
+    u4 edits_count;         /**< The number of pending edits. */
+    u4 edits_capacity;      /**< The number of edits allocated. */
+    bytecode_edit* edits;   /**< The pending edits. */
+} bytecode_editor;
+
+/**
+ * \brief Allocate a bytecode whose arguments are not set.
+ *
+ * The number of arguments, has_branch and has_ref follow the opcode format,
+ * checkcast and instanceof being given the form using a class reference. The
+ * reference, branch and byte arguments are left for the caller to set, as
+ * well as the switch data and its number of arguments.
+ *
+ * \param opcode The opcode of the bytecode.
+ *
+ * \return Return NULL if an error occurred, the allocated bytecode else.
+ */
+bytecode_info* new_bytecode(u1 opcode);
+
+/**
+ * \brief Free a bytecode and its switch arguments.
+ *
+ * \param bytecode The bytecode to free.
+ */
+void free_bytecode(bytecode_info* bytecode);
+
+/**
+ * \brief Remove bytecodes from a method.
+ *
+ * Branches, switch like bytecodes and exception handlers referring to a
+ * removed bytecode are redirected to the bytecode following the removed ones.
+ * The removed bytecodes are freed.
+ *
+ * \param method The method.
+ * \param index  The index of the first bytecode to remove.
+ * \param count  The number of bytecodes to remove.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int remove_bytecodes(method_info* method, u2 index, u2 count);
+
+/**
+ * \brief Start editing a method.
+ *
+ * \param editor The editor to initialize.
+ * \param method The method to edit.
+ */
+void init_bytecode_editor(bytecode_editor* editor, method_info* method);
+
+/**
+ * \brief Insert bytecodes before a bytecode.
+ *
+ * If retarget is set, branches, switch like bytecodes and exception handlers
+ * referring to the bytecode refer to the first inserted one instead, so that
+ * the inserted bytecodes are executed on every path to it. Else they are
+ * only executed when falling through from the previous bytecode.
+ *
+ * \param editor    The editor.
+ * \param index     The index of the bytecode, or the number of bytecodes of
+ *                  the method to append to it.
+ * \param bytecodes The bytecodes to insert, owned by the method once the
+ *                  edits are applied. The array itself is copied.
+ * \param count     The number of bytecodes to insert.
+ * \param retarget  Whether references to the bytecode are moved to the
+ *                  inserted ones.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int edit_insert_before(bytecode_editor* editor, u2 index, bytecode_info** bytecodes, u2 count, char retarget);
+
+/**
+ * \brief Insert bytecodes after a bytecode, they are only executed when
+ * falling through from it.
+ *
+ * \param editor    The editor.
+ * \param index     The index of the bytecode.
+ * \param bytecodes The bytecodes to insert, owned by the method once the
+ *                  edits are applied. The array itself is copied.
+ * \param count     The number of bytecodes to insert.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int edit_insert_after(bytecode_editor* editor, u2 index, bytecode_info** bytecodes, u2 count);
+
+/**
+ * \brief Remove bytecodes, what referred to them refers to the bytecode
+ * which follows them once every edit is applied.
+ *
+ * \param editor The editor.
+ * \param index  The index of the first bytecode to remove.
+ * \param count  The number of bytecodes to remove.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int edit_remove(bytecode_editor* editor, u2 index, u2 count);
+
+/**
+ * \brief Replace bytecodes, what referred to any of them refers to the
+ * first new one.
+ *
+ * \param editor    The editor.
+ * \param index     The index of the first bytecode to replace.
+ * \param count     The number of bytecodes to replace.
+ * \param bytecodes The new bytecodes, owned by the method once the edits are
+ *                  applied. The array itself is copied.
+ * \param new_count The number of new bytecodes, 0 being a removal.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int edit_replace(bytecode_editor* editor, u2 index, u2 count, bytecode_info** bytecodes, u2 new_count);
+
+/**
+ * \brief Apply the pending edits to the method.
+ *
+ * Branches, switch like bytecodes and exception handlers of the method are
+ * fixed up, removed bytecodes are freed, bytecodes_size is updated and
+ * needs_layout is set. The branches of inserted bytecodes are left as they
+ * were given, they may refer to any bytecode the method keeps. An exception
+ * handler ending with the method covers the bytecodes appended to it.
+ *
+ * On error, the method is left untouched and the edits are still pending.
+ * On success, the editor can be used again for new edits.
+ *
+ * \param editor The editor.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int commit_bytecode_edits(bytecode_editor* editor);
+
+/**
+ * \brief Free the pending edits, including the bytecodes they would insert.
+ *
+ * \param editor The editor.
+ */
+void free_bytecode_editor(bytecode_editor* editor);
+
+#endif
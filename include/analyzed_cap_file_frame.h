@@ -0,0 +1,155 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_frame.h
+ * \brief Compute the frame of analyzed methods (max_stack, nargs and
+ * max_locals) from their bytecodes.
+ */
+
+#ifndef ANALYZED_CAP_FILE_FRAME_H
+#define ANALYZED_CAP_FILE_FRAME_H
+
+#include "analyzed_cap_file.h"
+#include "exp_file.h"
+
+/**
+ * \brief Count the words used by the parameters of a method signature.
+ *
+ * \param signature    The method signature.
+ * \param return_words If not NULL, set to the number of words of the return
+ *                     type (0 for void).
+ *
+ * \return Return the number of words of the parameters, without this.
+ */
+u1 get_signature_words(type_descriptor_info* signature, u1* return_words);
+
+/**
+ * \brief Find the signature of a method of an internal interface or of one
+ * of its internal superinterfaces.
+ *
+ * \param interface The interface.
+ * \param token     The method token.
+ *
+ * \return Return the signature or NULL if the method is not found.
+ */
+type_descriptor_info* get_interface_method_signature(interface_info* interface, u1 token);
+
+/**
+ * \brief Find the descriptor of an exported method in an export file.
+ *
+ * \param ef          The export file, may be NULL.
+ * \param class_token The token of the class or interface of the method.
+ * \param token       The method token.
+ *
+ * \return Return the CONSTANT_Utf8 entry of the descriptor, such as "(S[B)V",
+ * or NULL if the method is not found.
+ */
+ef_cp_info* get_export_method_descriptor(export_file* ef, u1 class_token, u1 token);
+
+/**
+ * \brief Get the number of words an analyzed bytecode pops from and pushes
+ * onto the operand stack.
+ *
+ * The stack effect of invokeinterface is taken from the interface method,
+ * which is an error if it is not found.
+ *
+ * \param bytecode The analyzed bytecode.
+ * \param pops     Set to the number of popped words.
+ * \param pushes   Set to the number of pushed words.
+ *
+ * \return Return -1 if the stack effect cannot be computed, 0 else.
+ */
+int get_stack_effect(bytecode_info* bytecode, u1* pops, u1* pushes);
+
+/**
+ * \brief Check whether the interface method called by every invokeinterface
+ * of a method is found, either in the package or in the export files, so that
+ * get_stack_effect() does not fail on them.
+ *
+ * \param method The method.
+ *
+ * \return Return 1 if every interface method is found, 0 else.
+ */
+int has_known_stack_effects(method_info* method);
+
+#define STACK_DEPTH_UNREACHED   -1  /**< The bytecode cannot be reached. */
+
+/**
+ * \brief Compute the operand stack depth before each bytecode of a method.
+ *
+ * The depth is propagated from the first bytecode and from each exception
+ * handler, which starts with the thrown object on the stack, through
+ * fall-throughs, branches and switches. A bytecode reached with two
+ * different depths is an error.
+ *
+ * \param method    The method.
+ * \param depths    An array of bytecodes_count depths in words, filled with
+ *                  STACK_DEPTH_UNREACHED for bytecodes which cannot be
+ *                  reached.
+ * \param max_stack Set to the largest depth reached.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int compute_stack_depths(method_info* method, int16_t* depths, u1* max_stack);
+
+/**
+ * \brief Compute max_stack, nargs and max_locals of a method.
+ *
+ * max_stack is the largest depth computed by compute_stack_depths(). The
+ * METHOD_EXTENDED flag is set if any value does not fit in a standard method
+ * header and cleared else.
+ *
+ * \param method The method.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int compute_method_frame(method_info* method);
+
+/**
+ * \brief Compute the frame of every class method of an analyzed CAP file.
+ *
+ * \param acf The analyzed CAP file.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int compute_frames(analyzed_cap_file* acf);
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_inline.h
+ * \brief Replace calls to small internal static and private methods by a copy
+ * of their bytecodes.
+ */
+
+#ifndef ANALYZED_CAP_FILE_INLINE_H
+#define ANALYZED_CAP_FILE_INLINE_H
+
+#include "analyzed_cap_file.h"
+
+#define INLINE_MAX_CALLEE_SIZE  8   /**< Default size in byte of the largest
+                                         inlined method. */
+
+/**
+ * \brief What the inliner did.
+ */
+typedef struct {
+    u2 calls_inlined;   /**< Number of invokestatic and invokespecial
+                             replaced by the bytecodes of the callee. */
+    u2 methods_removed; /**< Number of callees removed since they are not
+                             called anymore. */
+    u4 size_before;     /**< Size in byte of the bytecodes of all class
+                             methods before inlining. */
+    u4 size_after;      /**< Size in byte of the bytecodes of all class
+                             methods after inlining. */
+} inline_report;
+
+/**
+ * \brief Inline calls to small internal methods.
+ *
+ * A callee is inlined if it is a static method called by invokestatic, or a
+ * private method without parameters called by invokespecial on this
+ * (aload_0 right before the call, which is not a branch target), and if it
+ * belongs to the class of the caller, is not larger than the given size, has
+ * no exception handler, no subroutine and no switch, and returns with nothing
+ * else than the returned value on the stack.
+ *
+ * Parameters are stored into fresh local variables of the caller, or popped
+ * if the callee never uses them, and returns become gotos to the bytecode
+ * following the call. Exception handlers and branches referring to the call
+ * refer to the first inlined bytecode. Callees which are private or package
+ * static and not called anymore are removed, but not freed.
+ *
+ * \param acf             The analyzed CAP file.
+ * \param max_callee_size The size in byte of the largest inlined method.
+ * \param report          Filled with what was done if not NULL.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int inline_methods(analyzed_cap_file* acf, u2 max_callee_size, inline_report* report);
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_instrument.h
+ * \brief Inject calls to a probe at method entries, method exits and basic
+ * blocks of an analyzed CAP file, for coverage and timing on emulators.
+ *
+ * The probe is a static method taking a short and returning nothing, either
+ * defined in the instrumented package or exported by another one. Each
+ * injected call passes its own id, which the block map relates to a method
+ * and a range of bytecodes.
+ */
+
+#ifndef ANALYZED_CAP_FILE_INSTRUMENT_H
+#define ANALYZED_CAP_FILE_INSTRUMENT_H
+
+#include "analyzed_cap_file.h"
+#include "exp_file.h"
+#include "verbose_sink.h"
+
+#define INSTRUMENT_ENTRIES  0x01    /**< Call the probe when entering a
+                                         method. */
+#define INSTRUMENT_EXITS    0x02    /**< Call the probe before each return. */
+#define INSTRUMENT_BLOCKS   0x04    /**< Call the probe at the start of each
+                                         basic block. */
+
+#define INSTRUMENT_MAX_PROBES   0x8000  /**< Ids are pushed as shorts. */
+
+/**
+ * \brief The static method called by injected probes, of signature (S)V.
+ */
+typedef struct {
+    method_info* method;    /**< The probe if it is in the instrumented
+                                 package, NULL else. */
+    export_file* ef;        /**< The export file of the package of the probe
+                                 if it is external. */
+    u1 class_token;         /**< The class token of an external probe. */
+    u1 method_token;        /**< The method token of an external probe. */
+} instrument_probe;
+
+/**
+ * \brief What an injected probe call stands for.
+ */
+typedef struct {
+    u2 id;              /**< The id passed to the probe. */
+    u1 kind;            /**< One of INSTRUMENT_ENTRIES, INSTRUMENT_EXITS or
+                             INSTRUMENT_BLOCKS. */
+    u2 class_index;     /**< Index of the class within the analyzed CAP
+                             file. */
+    u2 method_index;    /**< Index of the method within the class. */
+    u2 start;           /**< Offset within the method, before instrumenting,
+                             of the first bytecode of the block, of the return
+                             or 0 for an entry. */
+    u2 end;             /**< Offset right after the last bytecode of the
+                             block, of the return or of the method for an
+                             entry. */
+} block_map_entry;
+
+/**
+ * \brief Find an external probe by name in an export file.
+ *
+ * \param ef          The export file of the package of the probe.
+ * \param class_name  The name of the class, either fully qualified with '/'
+ *                    as separator or not.
+ * \param method_name The name of a public static method of signature (S)V.
+ * \param probe       Filled with the probe if found.
+ *
+ * \return Return -1 if the probe is not found, 0 else.
+ */
+int find_external_probe(export_file* ef, const char* class_name, const char* method_name, instrument_probe* probe);
+
+/**
+ * \brief Inject a probe call at method entries, method exits and basic
+ * blocks of every class method, the probe itself excepted.
+ *
+ * Basic blocks are those of build_method_cfg, which also start and end with
+ * the ranges covered by exception handlers. A block probe is on every path
+ * into its block while an entry probe is only executed when the method is
+ * called, not when branching back to its first bytecode. Exit probes precede sreturn,
+ * ireturn, areturn and return, exits by an exception are not probed.
+ *
+ * Constant pool, import and signature pool entries needed to call the probe
+ * are added.
+ *
+ * \param acf       The analyzed CAP file to instrument.
+ * \param probe     The probe to call.
+ * \param flags     A combination of INSTRUMENT_ENTRIES, INSTRUMENT_EXITS and
+ *                  INSTRUMENT_BLOCKS.
+ * \param map       An allocated array of the injected probes by id.
+ * \param map_count The number of injected probes.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int instrument_cap_file(analyzed_cap_file* acf, const instrument_probe* probe, u1 flags, block_map_entry** map, u2* map_count);
+
+/**
+ * \brief Output a block map, one probe per line as id, kind (entry, exit or
+ * block), class index, method index, start and end offsets.
+ *
+ * \param sink      Where to output the map.
+ * \param map       The injected probes.
+ * \param map_count The number of injected probes.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int print_block_map(verbose_sink* sink, const block_map_entry* map, u2 map_count);
+
+#endif
@@ -0,0 +1,253 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_interpreter.h
+ * \brief Execute analyzed methods on the host to profile them.
+ *
+ * Values are kept as on a card: the operand stack and the local variables
+ * are made of 16 bits words, an int taking two words with the high one
+ * first, and a reference is a handle into the interpreter heap (0 is null).
+ * Calls to external methods go to a native callback which, by default,
+ * pops the arguments and returns zero or null, so the framework API is
+ * stubbed out.
+ */
+
+#ifndef ANALYZED_CAP_FILE_INTERPRETER_H
+#define ANALYZED_CAP_FILE_INTERPRETER_H
+
+#include "analyzed_cap_file.h"
+
+#define INTERPRETER_ARRAY_BOOLEAN   10  /**< newarray type of boolean[]. */
+#define INTERPRETER_ARRAY_BYTE      11  /**< newarray type of byte[]. */
+#define INTERPRETER_ARRAY_SHORT     12  /**< newarray type of short[]. */
+#define INTERPRETER_ARRAY_INT       13  /**< newarray type of int[]. */
+#define INTERPRETER_ARRAY_REFERENCE 14  /**< Type of the arrays of references. */
+
+#define INTERPRETER_NULL_POINTER_EXCEPTION          1   /**< A null reference
+                                                             was used. */
+#define INTERPRETER_ARRAY_INDEX_EXCEPTION           2   /**< An array index was
+                                                             out of bounds. */
+#define INTERPRETER_ARITHMETIC_EXCEPTION            3   /**< A division by
+                                                             zero. */
+#define INTERPRETER_NEGATIVE_ARRAY_SIZE_EXCEPTION   4   /**< An array was
+                                                             created with a
+                                                             negative size. */
+#define INTERPRETER_CLASS_CAST_EXCEPTION            5   /**< checkcast
+                                                             failed. */
+
+/**
+ * \brief A field value, of an object or static.
+ */
+typedef struct {
+    const void* key;    /**< The internal field_info or, for external fields,
+                             the constant pool entry. */
+    int32_t value;      /**< A short, an int or a reference handle. */
+} interpreter_field;
+
+/**
+ * \brief An object or an array of the interpreter heap.
+ *
+ * Objects of external classes and exceptions thrown by the interpreter
+ * itself have no class.
+ */
+typedef struct {
+    class_info* class;                          /**< The internal class or
+                                                     NULL. */
+    constant_pool_entry_info* external_class;   /**< The class reference used
+                                                     to create an object of an
+                                                     external class. */
+    u1 exception;                   /**< INTERPRETER_*_EXCEPTION if thrown by
+                                         the interpreter, 0 else. */
+    u1 array_type;                  /**< INTERPRETER_ARRAY_* or 0 if not an
+                                         array. */
+    u2 length;                      /**< The number of elements. */
+    int32_t* elements;              /**< The elements of an array. */
+    u2 fields_count;                /**< The number of fields written. */
+    interpreter_field* fields;      /**< The fields written, the others are
+                                         0 or null. */
+} interpreter_object;
+
+/**
+ * \brief What was executed in a method.
+ */
+typedef struct {
+    method_info* method;        /**< The profiled method. */
+    u4 invocations;             /**< Number of times the method was called. */
+    u4 cycles;                  /**< Cycles spent in the method itself. */
+    u4* executions;             /**< Number of executions of each bytecode. */
+    u4* taken;                  /**< For each branch, the number of times it
+                                     was taken. For each switch, the number
+                                     of times a case other than the default
+                                     one was selected. */
+    bytecode_info** sorted;     /**< The bytecodes sorted by address. */
+    u2* sorted_indexes;         /**< The index of each sorted bytecode. */
+} method_profile;
+
+struct interpreter;
+
+#define INTERPRETER_NATIVE_RETURN   0   /**< The native method returned. */
+#define INTERPRETER_NATIVE_THROW    1   /**< The native method threw the object
+                                             whose handle is the first
+                                             result word. */
+#define INTERPRETER_NATIVE_DEFAULT  2   /**< The native method is not known;
+                                             zero or null is returned. */
+
+/**
+ * \brief Execute a call to an external method or to a method which could
+ * not be resolved.
+ *
+ * \param interp        The interpreter.
+ * \param invoke        The invoke bytecode.
+ * \param args          The argument words, this first if any.
+ * \param args_count    The number of argument words.
+ * \param results       The words to return.
+ * \param results_count The number of words to return.
+ *
+ * \return Return -1 if an error occurred, else INTERPRETER_NATIVE_*.
+ */
+typedef int (*native_method)(struct interpreter* interp, bytecode_info* invoke, int16_t* args, u1 args_count, int16_t* results, u1 results_count);
+
+/**
+ * \brief The state of the interpreter and the profile collected so far.
+ */
+typedef struct interpreter {
+    analyzed_cap_file* acf;     /**< The executed analyzed CAP file. */
+
+    u4 cycle_costs[256];        /**< The cost in cycles of each opcode. */
+    u4 max_steps;               /**< Executing more bytecodes than that in one
+                                     call is an error; 0 for no limit. */
+
+    native_method native;       /**< Called for external methods, may be
+                                     NULL. */
+    void* native_data;          /**< For the native callback. */
+
+    u2 objects_count;               /**< The number of heap objects. */
+    interpreter_object* objects;    /**< The heap, handle n being objects[n - 1]. */
+
+    u2 statics_count;               /**< The number of static fields used. */
+    interpreter_field* statics;     /**< The static fields used. */
+
+    u4 opcode_counts[256];      /**< Number of executions of each opcode. */
+    u4 steps;                   /**< Number of executed bytecodes. */
+    u4 cycles;                  /**< Total number of cycles. */
+
+    u2 profiles_count;          /**< The number of profiled methods. */
+    method_profile* profiles;   /**< The profile of each class method. */
+} interpreter;
+
+/**
+ * \brief Fill a cycle cost model with a default one.
+ *
+ * Simple bytecodes cost 1 cycle, field and array accesses more, and calls,
+ * object creations, switches and throws even more.
+ *
+ * \param cycle_costs The cost in cycles of each opcode.
+ */
+void get_default_cycle_costs(u4* cycle_costs);
+
+/**
+ * \brief Create an interpreter for an analyzed CAP file.
+ *
+ * \param acf         The analyzed CAP file. Frames of its methods are
+ *                    computed again.
+ * \param cycle_costs The cost in cycles of each opcode, copied. NULL for the
+ *                    default model.
+ *
+ * \return Return NULL if an error occurred, an allocated interpreter else.
+ */
+interpreter* new_interpreter(analyzed_cap_file* acf, const u4* cycle_costs);
+
+/**
+ * \brief Free an interpreter, its heap and its profile.
+ *
+ * \param interp The interpreter.
+ */
+void free_interpreter(interpreter* interp);
+
+/**
+ * \brief Allocate an array in the interpreter heap, for instance an APDU
+ * buffer to pass to a method.
+ *
+ * \param interp The interpreter.
+ * \param type   INTERPRETER_ARRAY_*.
+ * \param length The number of elements, all 0 or null.
+ *
+ * \return Return the handle of the array or 0 if an error occurred.
+ */
+u2 new_interpreter_array(interpreter* interp, u1 type, u2 length);
+
+/**
+ * \brief Get the profile of a class method.
+ *
+ * \param interp The interpreter.
+ * \param method The method.
+ *
+ * \return Return the profile or NULL if the method is not a class method.
+ */
+method_profile* get_method_profile(interpreter* interp, method_info* method);
+
+#define INTERPRETER_RETURNED    0   /**< The method returned. */
+#define INTERPRETER_THREW       1   /**< The method threw an uncaught
+                                         exception. */
+
+/**
+ * \brief Execute a class method.
+ *
+ * Calls are resolved within the CAP file: virtual and interface calls are
+ * dispatched on the class of the object. An exception is caught by a
+ * handler catching its class or a superclass of it, or catching any
+ * exception. Exceptions thrown by the interpreter and objects of external
+ * classes are caught by handlers of any external class.
+ *
+ * \param interp        The interpreter.
+ * \param method        The method.
+ * \param args          The argument words, this first if any.
+ * \param args_count    The number of argument words, nargs of the method.
+ * \param result        Set to the returned words, or to the handle of the
+ *                      thrown object, if not NULL. Should hold 2 words.
+ * \param result_count  Set to the number of returned words if not NULL.
+ *
+ * \return Return -1 if an error occurred or the step limit was reached, else
+ *         INTERPRETER_RETURNED or INTERPRETER_THREW.
+ */
+int interpret_method(interpreter* interp, method_info* method, const int16_t* args, u1 args_count, int16_t* result, u1* result_count);
+
+#endif
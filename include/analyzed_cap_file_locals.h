@@ -0,0 +1,91 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_locals.h
+ * \brief Renumber the local variables of analyzed methods so that variables
+ * which are never live at the same time share a slot.
+ */
+
+#ifndef ANALYZED_CAP_FILE_LOCALS_H
+#define ANALYZED_CAP_FILE_LOCALS_H
+
+#include "analyzed_cap_file.h"
+
+/**
+ * \brief What was gained by renumbering local variables.
+ */
+typedef struct {
+    u2 methods_changed; /**< Number of methods whose locals were renumbered. */
+    u2 slots_saved;     /**< Number of local variable words saved. */
+    u2 bytes_saved;     /**< Number of bytecode bytes saved by using the
+                             aload_<n> like forms. */
+} locals_report;
+
+/**
+ * \brief Renumber the local variables of a method which are not parameters.
+ *
+ * Liveness is computed over the bytecodes, their branches and exception
+ * handlers. The most used variables get the smallest slots first so that
+ * they can use the one byte forms (aload_<n>, sstore_<n>...). The method is
+ * left untouched when it uses jsr or ret, when a slot is used both as an
+ * int and as a short or reference, or when renumbering would not make the
+ * frame or the bytecodes smaller.
+ *
+ * \param method      The method.
+ * \param slots_saved Set to the number of local variable words saved.
+ * \param bytes_saved Set to the number of bytecode bytes saved.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int allocate_method_locals(method_info* method, u2* slots_saved, u2* bytes_saved);
+
+/**
+ * \brief Renumber the local variables of every class method of an analyzed
+ * CAP file.
+ *
+ * \param acf    The analyzed CAP file.
+ * \param report Filled with what was gained if not NULL.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int allocate_locals(analyzed_cap_file* acf, locals_report* report);
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_peephole.h
+ * \brief Rewrite short sequences of analyzed bytecodes into smaller
+ * equivalent ones before generating a CAP file.
+ */
+
+#ifndef ANALYZED_CAP_FILE_PEEPHOLE_H
+#define ANALYZED_CAP_FILE_PEEPHOLE_H
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_edit.h"
+
+/**
+ * \brief A peephole rule looks at the bytecode at the given index and might
+ * rewrite it and the following ones.
+ *
+ * A rule should make the method strictly smaller each time it returns 1 so
+ * that applying rules until none matches terminates.
+ *
+ * \param acf    The analyzed CAP file.
+ * \param method The method being optimized.
+ * \param index  The index of the bytecode within the method.
+ *
+ * \return Return -1 if an error occurred, 1 if the method was changed, 0 else.
+ */
+typedef int (*peephole_rule)(analyzed_cap_file* acf, method_info* method, u2 index);
+
+/**
+ * \brief The bytes saved in a method by the peephole optimizer.
+ */
+typedef struct {
+    u2 class_index;     /**< Index of the class within the analyzed CAP file. */
+    u2 method_index;    /**< Index of the method within the class. */
+    u2 bytes_saved;     /**< Number of bytes saved in the method. */
+} peephole_report;
+
+/**
+ * \brief Use the shortest push bytecode for a constant (sconst_<n>,
+ * bspush, sspush and their int counterparts).
+ */
+int peephole_shorter_push(analyzed_cap_file* acf, method_info* method, u2 index);
+
+/**
+ * \brief Use aload_<n> like bytecodes for local variables 0 to 3.
+ */
+int peephole_shorter_local(analyzed_cap_file* acf, method_info* method, u2 index);
+
+/**
+ * \brief Remove a goto to the next bytecode and turn a conditional branch to
+ * the next bytecode into a pop or pop2.
+ */
+int peephole_jump_to_next(analyzed_cap_file* acf, method_info* method, u2 index);
+
+/**
+ * \brief Remove a load of a local variable immediately stored back into it.
+ */
+int peephole_load_store(analyzed_cap_file* acf, method_info* method, u2 index);
+
+/**
+ * \brief Remove a constant or local variable push, or a dup, immediately
+ * popped.
+ */
+int peephole_push_pop(analyzed_cap_file* acf, method_info* method, u2 index);
+
+/**
+ * \brief Remove a checkcast to java.lang.Object, repeating the previous one
+ * or following aconst_null.
+ */
+int peephole_redundant_checkcast(analyzed_cap_file* acf, method_info* method, u2 index);
+
+/**
+ * \brief Remove bytecodes following an unconditional one (goto, return,
+ * athrow, switch like bytecodes...) which are not a branch or exception
+ * handler target.
+ */
+int peephole_unreachable(analyzed_cap_file* acf, method_info* method, u2 index);
+
+/**
+ * \brief The rules applied by default, terminated by NULL.
+ */
+extern const peephole_rule default_peephole_rules[];
+
+/**
+ * \brief Check whether a bytecode is the target of a branch, of a switch like
+ * bytecode or is used by an exception handler of its method.
+ *
+ * \param method   The method of the bytecode.
+ * \param bytecode The bytecode to check.
+ *
+ * \return Return 1 if the bytecode is a target, 0 else.
+ */
+int is_bytecode_target(method_info* method, bytecode_info* bytecode);
+
+/**
+ * \brief Apply peephole rules to every class method until none matches.
+ *
+ * \param acf           The analyzed CAP file to optimize.
+ * \param rules         The rules to apply terminated by NULL, or NULL for the
+ *                      default ones.
+ * \param reports       If not NULL, an allocated array of the methods in which
+ *                      bytes were saved.
+ * \param reports_count The number of reports in the array.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int peephole_optimize(analyzed_cap_file* acf, const peephole_rule* rules, peephole_report** reports, u2* reports_count);
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_serialize.h
+ * \brief Output an analyzed CAP file as a JSON or CBOR document.
+ */
+
+#ifndef ANALYZED_CAP_FILE_SERIALIZE_H
+#define ANALYZED_CAP_FILE_SERIALIZE_H
+
+#include "analyzed_cap_file.h"
+#include "structured_writer.h"
+
+/**
+ * \brief Write an analyzed CAP file as one object holding its constant
+ * info, imported packages, constant and signature pools, interfaces,
+ * classes and exception handlers.
+ *
+ * Constant pool entries are referred to by index, classes, interfaces and
+ * methods by offset and branch targets by offset within their method, as in
+ * the verbose output.
+ *
+ * \param writer The writer of the document.
+ * \param acf The analyzed CAP file to output.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int serialize_analyzed_cap_file(structured_writer* writer, analyzed_cap_file* acf);
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_snapshot.h
+ * \brief Save and load an analyzed CAP file to and from a binary snapshot.
+ *
+ * Pointers between the parts of an analyzed CAP file are stored as indexes so
+ * a snapshot does not depend on where it was produced. A snapshot file can be
+ * handed to another process which loads it without the original CAP file.
+ */
+
+#ifndef ANALYZED_CAP_FILE_SNAPSHOT_H
+#define ANALYZED_CAP_FILE_SNAPSHOT_H
+
+#include "analyzed_cap_file.h"
+#include "exp_file.h"
+
+/**
+ * \brief Serialize an analyzed CAP file into a newly allocated buffer.
+ *
+ * The tweak field of classes is not saved. Imported packages only keep their
+ * AID: export files are linked again when the snapshot is loaded.
+ *
+ * \param acf  The analyzed CAP file to serialize.
+ * \param size The size in byte of the returned buffer.
+ *
+ * \return Return the snapshot or NULL if an error occurred.
+ */
+u1* save_analyzed_cap_file_snapshot(analyzed_cap_file* acf, u4* size);
+
+/**
+ * \brief Rebuild an analyzed CAP file from a snapshot.
+ *
+ * \param snapshot        The snapshot as built by
+ *                        save_analyzed_cap_file_snapshot().
+ * \param size            The size in byte of the snapshot.
+ * \param export_files    An array of parsed export files used to link the
+ *                        imported packages.
+ * \param nb_export_files The number of parsed export files in the array.
+ *
+ * \return Return the analyzed CAP file or NULL if an error occurred.
+ */
+analyzed_cap_file* load_analyzed_cap_file_snapshot(const u1* snapshot, u4 size, export_file** export_files, int nb_export_files);
+
+/**
+ * \brief Serialize an analyzed CAP file into a snapshot file.
+ *
+ * \param filename The snapshot file to write.
+ * \param acf      The analyzed CAP file to serialize.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int write_analyzed_cap_file_snapshot(const char* filename, analyzed_cap_file* acf);
+
+/**
+ * \brief Rebuild an analyzed CAP file from a snapshot file.
+ *
+ * The file is memory-mapped and read in a single pass.
+ *
+ * \param filename        The snapshot file to read.
+ * \param export_files    An array of parsed export files used to link the
+ *                        imported packages.
+ * \param nb_export_files The number of parsed export files in the array.
+ *
+ * \return Return the analyzed CAP file or NULL if an error occurred.
+ */
+analyzed_cap_file* read_analyzed_cap_file_snapshot(const char* filename, export_file** export_files, int nb_export_files);
+
+#endif
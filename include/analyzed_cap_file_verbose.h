@@ -47,61 +47,64 @@
 #define ANALYZED_CAP_FILE_VERBOSE_H
 
 #include "analyzed_cap_file.h"
+#include "verbose_sink.h"
 
 /**
- * \brief Output the constant info of an analyzed CAP file on the standard
- * output.
+ * \brief Output the constant info of an analyzed CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param acf The analyzed CAP file to output.
  */
-void verbose_constant_info(analyzed_cap_file* acf);
+void verbose_constant_info(verbose_sink* sink, analyzed_cap_file* acf);
 
 /**
- * \brief Output the imported packages of an analyzed CAP file on the standard
- * output.
+ * \brief Output the imported packages of an analyzed CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param acf The analyzed CAP file to output.
  */
-void verbose_imported_package(analyzed_cap_file* acf);
+void verbose_imported_package(verbose_sink* sink, analyzed_cap_file* acf);
 
 /**
- * \brief Output the constant pool of an analyzed CAP file on the standard
- * output.
+ * \brief Output the constant pool of an analyzed CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param acf The analyzed CAP file to output.
  */
-void verbose_constant_pool(analyzed_cap_file* acf);
+void verbose_constant_pool(verbose_sink* sink, analyzed_cap_file* acf);
 
 /**
- * \brief Output the signature pool of an analyzed CAP file on the standard
- * output.
+ * \brief Output the signature pool of an analyzed CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param acf The analyzed CAP file to output.
  */
-void verbose_signature_pool(analyzed_cap_file* acf);
+void verbose_signature_pool(verbose_sink* sink, analyzed_cap_file* acf);
 
 /**
- * \brief Output the interfaces and their methods of an analyzed CAP file on
- * the standard output.
+ * \brief Output the interfaces and their methods of an analyzed CAP file to
+ * a sink.
  *
+ * \param sink Where to output it.
  * \param acf The analyzed CAP file to output.
  */
-void verbose_interfaces(analyzed_cap_file* acf);
+void verbose_interfaces(verbose_sink* sink, analyzed_cap_file* acf);
 
 /**
  * \brief Output the classes and their fields and methods of an analyzed CAP
- * file on the standard output.
+ * file to a sink.
  *
+ * \param sink Where to output it.
  * \param acf The analyzed CAP file to output.
  */
-void verbose_classes(analyzed_cap_file* acf);
+void verbose_classes(verbose_sink* sink, analyzed_cap_file* acf);
 
 /**
- * \brief Output the exception handlers of an analyzed CAP file on the standard
- * output.
+ * \brief Output the exception handlers of an analyzed CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param acf The analyzed CAP file to output.
  */
-void verbose_exception_handlers(analyzed_cap_file* acf);
+void verbose_exception_handlers(verbose_sink* sink, analyzed_cap_file* acf);
 
 #endif
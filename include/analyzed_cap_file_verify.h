@@ -0,0 +1,130 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_verify.h
+ * \brief Verify the bytecodes of an analyzed CAP file by typed dataflow
+ * analysis, the way an off-card verifier does.
+ *
+ * The type of every local variable and operand stack word is inferred at the
+ * start of each basic block until a fixed point is reached, checking each
+ * bytecode against the types it uses, the declared frame of its method and
+ * the constant pool entry it refers to. Signatures come from the signature
+ * pool and, for external interface methods, from the export files.
+ *
+ * Reference types are tracked as objects, null and arrays of each element
+ * type. The class of objects is not tracked, neither are objects created by
+ * new and not yet initialized. Arrays of booleans and of bytes share a type
+ * as baload and bastore handle both. A subroutine called by jsr is verified
+ * but its effect on local variables is not carried back to its caller.
+ *
+ * Verifying does not change the analyzed CAP file, so methods and files may
+ * be verified by several threads at once.
+ */
+
+#ifndef ANALYZED_CAP_FILE_VERIFY_H
+#define ANALYZED_CAP_FILE_VERIFY_H
+
+#include "analyzed_cap_file.h"
+#include "verbose_sink.h"
+
+#define VERIFY_NO_OFFSET        0xFFFF  /**< The failure is not due to one
+                                             bytecode. */
+#define VERIFY_MESSAGE_LENGTH   112     /**< The size of a failure message. */
+
+/**
+ * \brief Why a method was rejected.
+ */
+typedef struct {
+    u2 class_index;     /**< Index of the class within the analyzed CAP
+                             file. */
+    u2 method_index;    /**< Index of the method within the class. */
+    u2 offset;          /**< Offset of the rejected bytecode within the
+                             method or VERIFY_NO_OFFSET. */
+    u1 opcode;          /**< The opcode of the rejected bytecode. */
+    char message[VERIFY_MESSAGE_LENGTH];    /**< What is wrong. */
+} verify_failure;
+
+/**
+ * \brief Verify one method.
+ *
+ * Branch targets and exception handlers must be within the method,
+ * execution must not fall off its end, the operand stack must stay within
+ * max_stack and local variables within nargs plus max_locals, which must
+ * match the signature. Each bytecode must find the types it expects and,
+ * at each branch target, the operand stack must have the same depth and
+ * compatible types whatever the path. Unreachable bytecodes are not
+ * verified.
+ *
+ * \param method  The method.
+ * \param failure Filled with the first failure found. The class and method
+ *                indexes are left to the caller.
+ *
+ * \return Return -1 if the method is rejected or could not be verified, 0
+ * else.
+ */
+int verify_method(method_info* method, verify_failure* failure);
+
+/**
+ * \brief Verify every non abstract class method of an analyzed CAP file.
+ *
+ * \param acf            The analyzed CAP file.
+ * \param failures       Set to an allocated array holding the failure of each
+ *                       rejected method.
+ * \param failures_count Set to the number of rejected methods.
+ *
+ * \return Return -1 if an error occurred, the number of rejected methods
+ * else.
+ */
+int verify_cap_file(analyzed_cap_file* acf, verify_failure** failures, u2* failures_count);
+
+/**
+ * \brief Output failures, one per line as class index, method index,
+ * offset and mnemonic of the bytecode when known, and message.
+ *
+ * \param sink           Where to output the failures.
+ * \param failures       The failures.
+ * \param failures_count The number of failures.
+ *
+ * \return Return -1 if the sink failed, 0 else.
+ */
+int print_verify_failures(verbose_sink* sink, const verify_failure* failures, u2 failures_count);
+
+#endif
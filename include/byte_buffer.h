@@ -0,0 +1,219 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file byte_buffer.h
+ * \brief Big endian reading and writing of the binary files of the library
+ * (snapshots, cache entries and indexes) and mapping of those files in
+ * memory.
+ */
+
+#ifndef BYTE_BUFFER_H
+#define BYTE_BUFFER_H
+
+#include <stdint.h>
+
+#include "cap_file.h"
+
+/**
+ * \brief A buffer growing as values are appended to it.
+ */
+typedef struct {
+    u1* buffer;     /**< The written bytes. */
+    u4 size;        /**< The number of written bytes. */
+    u4 capacity;    /**< The number of allocated bytes. */
+    int error;      /**< Set when the buffer could not grow, later writes
+                         being ignored. */
+} byte_writer;
+
+/**
+ * \brief Reads values from a buffer with bound checks.
+ */
+typedef struct {
+    const u1* buffer;   /**< The read bytes. */
+    u4 size;            /**< The size of the buffer. */
+    u4 position;        /**< Where the next read happens. */
+    int error;          /**< Set when reading past the end, later reads
+                             returning 0. */
+} byte_reader;
+
+/**
+ * \brief Append bytes to a growing buffer.
+ *
+ * \param writer The buffer.
+ * \param bytes  The bytes to append.
+ * \param length The number of bytes.
+ */
+void put_bytes(byte_writer* writer, const u1* bytes, u4 length);
+
+/**
+ * \brief Append a u1 to a growing buffer.
+ *
+ * \param writer The buffer.
+ * \param value  The value.
+ */
+void put_u1(byte_writer* writer, u1 value);
+
+/**
+ * \brief Append a u2 to a growing buffer.
+ *
+ * \param writer The buffer.
+ * \param value  The value.
+ */
+void put_u2(byte_writer* writer, u2 value);
+
+/**
+ * \brief Append a u4 to a growing buffer.
+ *
+ * \param writer The buffer.
+ * \param value  The value.
+ */
+void put_u4(byte_writer* writer, u4 value);
+
+/**
+ * \brief Consume bytes from a buffer.
+ *
+ * \param reader The buffer.
+ * \param length The number of bytes.
+ *
+ * \return Return the bytes or NULL if there are not enough of them.
+ */
+const u1* get_bytes(byte_reader* reader, u4 length);
+
+/**
+ * \brief Consume a u1 from a buffer.
+ *
+ * \param reader The buffer.
+ *
+ * \return Return the value or 0 if there are not enough bytes.
+ */
+u1 get_u1(byte_reader* reader);
+
+/**
+ * \brief Consume a u2 from a buffer.
+ *
+ * \param reader The buffer.
+ *
+ * \return Return the value or 0 if there are not enough bytes.
+ */
+u2 get_u2(byte_reader* reader);
+
+/**
+ * \brief Consume a u4 from a buffer.
+ *
+ * \param reader The buffer.
+ *
+ * \return Return the value or 0 if there are not enough bytes.
+ */
+u4 get_u4(byte_reader* reader);
+
+/**
+ * \brief Consume a u8 from a buffer.
+ *
+ * \param reader The buffer.
+ *
+ * \return Return the value or 0 if there are not enough bytes.
+ */
+uint64_t get_u8(byte_reader* reader);
+
+/**
+ * \brief Write a u2 at a given place.
+ *
+ * \param buffer Where to write the value.
+ * \param value  The value.
+ */
+void store_u2(u1* buffer, u2 value);
+
+/**
+ * \brief Write a u4 at a given place.
+ *
+ * \param buffer Where to write the value.
+ * \param value  The value.
+ */
+void store_u4(u1* buffer, u4 value);
+
+/**
+ * \brief Write a u8 at a given place.
+ *
+ * \param buffer Where to write the value.
+ * \param value  The value.
+ */
+void store_u8(u1* buffer, uint64_t value);
+
+/**
+ * \brief Read a u4 from a given place.
+ *
+ * \param buffer Where to read the value.
+ *
+ * \return Return the value.
+ */
+u4 load_u4(const u1* buffer);
+
+/**
+ * \brief Read a u8 from a given place.
+ *
+ * \param buffer Where to read the value.
+ *
+ * \return Return the value.
+ */
+uint64_t load_u8(const u1* buffer);
+
+/**
+ * \brief Map a whole file in memory for reading.
+ *
+ * \param path    The file.
+ * \param size    Set to the size of the file.
+ * \param missing If not NULL, set to whether the file does not exist, which
+ *                is then not reported.
+ *
+ * \return Return the mapped file or NULL if an error occurred or if the file
+ *         is empty or larger than 4GB.
+ */
+const u1* map_file(const char* path, u4* size, int* missing);
+
+/**
+ * \brief Unmap a file mapped by map_file().
+ *
+ * \param buffer The mapped file.
+ * \param size   Its size.
+ */
+void unmap_file(const u1* buffer, u4 size);
+
+#endif
@@ -40,273 +40,112 @@
 
 /**
  * \file bytecodes.h
- * \brief Define the mnemonics of each Java Card bytecode.
+ * \brief Describe each Java Card bytecode (mnemonic, operands, stack effect).
  */
 
 #ifndef BYTECODES_H
 #define BYTECODES_H
 
-char* mnemonics[] = {
-    "nop",
-    "aconst_null",
-    "sconst_m1",
-    "sconst_0",
-    "sconst_1",
-    "sconst_2",
-    "sconst_3",
-    "sconst_4",
-    "sconst_5",
-    "iconst_m1",
-    "iconst_0",
-    "iconst_1",
-    "iconst_2",
-    "iconst_3",
-    "iconst_4",
-    "iconst_5",
-    "bspush",
-    "sspush",
-    "bipush",
-    "sipush",
-    "iipush",
-    "aload",
-    "sload",
-    "iload",
-    "aload_0",
-    "aload_1",
-    "aload_2",
-    "aload_3",
-    "sload_0",
-    "sload_1",
-    "sload_2",
-    "sload_3",
-    "iload_0",
-    "iload_1",
-    "iload_2",
-    "iload_3",
-    "aaload",
-    "baload",
-    "saload",
-    "iaload",
-    "astore",
-    "sstore",
-    "istore",
-    "astore_0",
-    "astore_1",
-    "astore_2",
-    "astore_3",
-    "sstore_0",
-    "sstore_1",
-    "sstore_2",
-    "sstore_3",
-    "istore_0",
-    "istore_1",
-    "istore_2",
-    "istore_3",
-    "aastore",
-    "bastore",
-    "sastore",
-    "iastore",
-    "pop",
-    "pop2",
-    "dup",
-    "dup2",
-    "dup_x",
-    "swap_x",
-    "sadd",
-    "iadd",
-    "ssub",
-    "isub",
-    "smul",
-    "imul",
-    "sdiv",
-    "idiv",
-    "srem",
-    "irem",
-    "sneg",
-    "ineg",
-    "sshl",
-    "ishl",
-    "ishr",
-    "ishr",
-    "sushr",
-    "iushr",
-    "sand",
-    "iand",
-    "sor",
-    "ior",
-    "sxor",
-    "ixor",
-    "sinc",
-    "iinc",
-    "s2b",
-    "s2i",
-    "i2b",
-    "i2s",
-    "icmp",
-    "ifeq",
-    "ifne",
-    "iflt",
-    "ifge",
-    "ifgt",
-    "ifle",
-    "ifnull",
-    "ifnonnull",
-    "if_acmpeq",
-    "if_acmpne",
-    "if_scmpeq",
-    "if_scmpne",
-    "if_scmplt",
-    "if_scmpge",
-    "if_scmpgt",
-    "if_scmple",
-    "goto",
-    "jsr",
-    "ret",
-    "stableswitch",
-    "itableswitch",
-    "slookupswitch",
-    "ilookupswitch",
-    "areturn",
-    "sreturn",
-    "ireturn",
-    "return",
-    "getstatic_a",
-    "getstatic_b",
-    "getstatic_s",
-    "getstatic_i",
-    "putstatic_a",
-    "putstatic_b",
-    "putstatic_s",
-    "putstatic_i",
-    "getfield_a",
-    "getfield_b",
-    "getfield_s",
-    "getfield_i",
-    "putfield_a",
-    "putfield_b",
-    "putfield_s",
-    "putfield_i",
-    "invokevirtual",
-    "invokespecial",
-    "invokestatic",
-    "invokeinterface",
-    "new",
-    "newarray",
-    "anewarray",
-    "arraylength",
-    "athrow",
-    "checkcast",
-    "instanceof",
-    "sinc_w",
-    "iinc_w",
-    "ifeq_w",
-    "ifne_w",
-    "iflt_w",
-    "ifge_w",
-    "ifgt_w",
-    "ifle_w",
-    "ifnull_w",
-    "ifnonnull_w",
-    "if_acmpeq_w",
-    "if_acmpne_w",
-    "if_scmpeq_w",
-    "if_scmpne_w",
-    "if_scmplt_w",
-    "if_scmpge_w",
-    "if_scmpgt_w",
-    "if_scmple_w",
-    "goto_w",
-    "getfield_a_w",
-    "getfield_b_w",
-    "getfield_s_w",
-    "getfield_i_w",
-    "getfield_a_this",
-    "getfield_b_this",
-    "getfield_s_this",
-    "getfield_i_this",
-    "putfield_a_w",
-    "putfield_b_w",
-    "putfield_s_w",
-    "putfield_i_w",
-    "putfield_a_this",
-    "putfield_b_this",
-    "putfield_s_this",
-    "putfield_i_this",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "invalid_opcode",
-    "impdep1",
-    "impdep2"
-};
+#include "cap_file.h"
+#include "analyzed_cap_file.h"
 
+/**
+ * \brief Describe one Java Card opcode.
+ *
+ * Decoding, encoding, compaction and printing of bytecodes are all driven by
+ * this description.
+ */
+typedef struct {
+    const char* mnemonic;   /**< The mnemonic of the opcode. */
+
+#define OPCODE_FORMAT_INVALID           0   /**< Not a valid opcode. */
+#define OPCODE_FORMAT_NONE              1   /**< No operand. */
+#define OPCODE_FORMAT_BYTES             2   /**< Only byte operands. */
+#define OPCODE_FORMAT_BRANCH            3   /**< One branch operand. */
+#define OPCODE_FORMAT_REF               4   /**< One constant pool index. */
+#define OPCODE_FORMAT_TYPE_REF          5   /**< An array type followed by a
+                                                 constant pool index if the
+                                                 type is a reference
+                                                 (checkcast and
+                                                 instanceof). */
+#define OPCODE_FORMAT_INVOKEINTERFACE   6   /**< nargs, constant pool index
+                                                 and method token. */
+#define OPCODE_FORMAT_STABLESWITCH      7   /**< See stableswitch_info. */
+#define OPCODE_FORMAT_ITABLESWITCH      8   /**< See itableswitch_info. */
+#define OPCODE_FORMAT_SLOOKUPSWITCH     9   /**< See slookupswitch_info. */
+#define OPCODE_FORMAT_ILOOKUPSWITCH     10  /**< See ilookupswitch_info. */
+    u1 format;          /**< The operand layout. */
+    u1 nb_args;         /**< Number of bytes of operands. For switch like
+                             bytecodes, only the fixed part is counted. */
+    u1 ref_width;       /**< Width of the constant pool index if any, 0 else. */
+    u1 branch_width;    /**< Width of the branch offsets if any, 0 else. */
+    u1 counterpart;     /**< The opcode of the wide form of a narrow opcode or
+                             of the narrow form of a wide opcode. For
+                             getfield_<t>_this and putfield_<t>_this it is
+                             getfield_<t>_w and putfield_<t>_w. The opcode
+                             itself if there is none. */
+
+#define OPCODE_VARIABLE_STACK   0xFF    /**< The stack effect depends on
+                                             operands or on a signature. */
+    u1 pops;            /**< Number of words popped from the stack. */
+    u1 pushes;          /**< Number of words pushed onto the stack. */
+
+#define OPCODE_UNCONDITIONAL    0x01    /**< Execution never falls through to
+                                             the next bytecode. */
+#define OPCODE_INT              0x02    /**< The int type is used. */
+#define OPCODE_THIS             0x04    /**< The local variable 0 is
+                                             implicitly used as object
+                                             reference. */
+    u1 flags;           /**< Describe the opcode properties. */
+} opcode_info;
+
+/**
+ * \brief The description of every opcode indexed by its value.
+ */
+extern const opcode_info opcodes[256];
 
+#define LOCAL_REFERENCE 0   /**< a prefixed load/store. */
+#define LOCAL_SHORT     1   /**< s prefixed load/store. */
+#define LOCAL_INT       2   /**< i prefixed load/store. */
 
+#define LOCAL_ACCESS_NONE   0   /**< The bytecode does not use a local. */
+#define LOCAL_ACCESS_LOAD   1   /**< The bytecode reads a local. */
+#define LOCAL_ACCESS_STORE  2   /**< The bytecode writes a local. */
+#define LOCAL_ACCESS_INC    3   /**< The bytecode reads and writes a local. */
 
+/**
+ * \brief Decode the local variable used by a load, a store or an increment.
+ *
+ * ret and the implicit this of the _this opcodes are not decoded.
+ *
+ * \param bytecode The analyzed bytecode.
+ * \param kind     Set to LOCAL_REFERENCE, LOCAL_SHORT or LOCAL_INT.
+ * \param local    Set to the local variable index.
+ *
+ * \return Return the LOCAL_ACCESS_* value of the bytecode, kind and local
+ *         being set unless it is LOCAL_ACCESS_NONE.
+ */
+u1 get_local_access(const bytecode_info* bytecode, u1* kind, u1* local);
+
+/**
+ * \brief Make a load, a store or an increment use another local variable,
+ * with the short form of loads and stores if possible.
+ *
+ * \param bytecode The analyzed bytecode, which has to use a local variable.
+ * \param local    The new local variable index.
+ */
+void set_local_access(bytecode_info* bytecode, u1 local);
+
+/**
+ * \brief Get the index of a bytecode within a method by scanning its
+ * bytecodes.
+ *
+ * \param method   The method.
+ * \param bytecode The bytecode.
+ *
+ * \return Return the index or -1, with a message, if the bytecode is not one
+ *         of the method.
+ */
+int find_bytecode_index(const method_info* method, const bytecode_info* bytecode);
 
 #endif
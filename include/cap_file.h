@@ -61,6 +61,12 @@
 #define COMPONENT_EXPORT 10
 #define COMPONENT_DESCRIPTOR 11
 #define COMPONENT_DEBUG 12                  /* only for M.m > 2.1 */
+#define COMPONENT_MANIFEST 0                /* not a component, stands for the
+                                               manifest in sets of components */
+
+#define COMPONENT_BIT(tag) (1 << (tag))     /* bit of a component in a set of
+                                               components */
+#define ALL_COMPONENTS 0x1FFF
 
 #define HEADER_ACC_INT 0x01
 #define HEADER_ACC_EXPORT 0x02
@@ -1057,6 +1063,14 @@ typedef struct {
     cf_export_component export; /**< The Export component. */
     cf_descriptor_component descriptor; /**< The Descriptor component. */
     cf_debug_component debug;   /**< The Debug component. Only when M.m > 2.1. */
+
+    char* source;   /**< The CAP file this one was read or generated from, NULL
+                         if none. */
+    u2 source_components;   /**< The COMPONENT_BIT() of the components which
+                                 were not generated but are identical to those
+                                 of the source. Only their tag and size are
+                                 set and write_cap_file() copies them from the
+                                 source as they are. */
 } cap_file;
 
 #endif
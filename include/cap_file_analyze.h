@@ -64,6 +64,18 @@
  */
 export_file** get_export_files_from_directories(char* const* directories, int nb_directories, int* nb_export_files);
 
+/**
+ * \brief Search for the parsed export file of a package given its AID.
+ *
+ * \param aid             The AID of the package.
+ * \param aid_length      The length of the AID.
+ * \param export_files    The array of parsed export files.
+ * \param nb_export_files The number of parsed export files in the array.
+ *
+ * \return Return the parsed export file or NULL if none was found.
+ */
+export_file* get_export_file_by_aid(const u1* aid, u1 aid_length, export_file** export_files, int nb_export_files);
+
 /**
  * \brief Analyze a straightforward representation of a CAP file into a more
  *        useful format.
@@ -76,4 +88,36 @@ export_file** get_export_files_from_directories(char* const* directories, int nb
  */
 analyzed_cap_file* analyze_cap_file(cap_file* cf, export_file** export_files, int nb_export_files);
 
+/**
+ * \brief Free a method of an analyzed CAP file along with its bytecodes. The
+ *        exception handlers belong to the analyzed CAP file and are not
+ *        freed.
+ *
+ * \param method The method to free.
+ */
+void free_method(method_info* method);
+
+/**
+ * \brief Free a field of an analyzed CAP file along with its initial value.
+ *
+ * \param field The field to free.
+ */
+void free_field(field_info* field);
+
+/**
+ * \brief Free a type descriptor of the signature pool of an analyzed CAP
+ *        file.
+ *
+ * \param type The type descriptor to free.
+ */
+void free_type_descriptor(type_descriptor_info* type);
+
+/**
+ * \brief Free an analyzed CAP file built by analyze_cap_file() or loaded from
+ *        a snapshot. The export files it refers to are not freed.
+ *
+ * \param acf The analyzed CAP file to free, might be NULL.
+ */
+void free_analyzed_cap_file(analyzed_cap_file* acf);
+
 #endif
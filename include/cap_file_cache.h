@@ -0,0 +1,119 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file cap_file_cache.h
+ * \brief Keep analyzed CAP files in an on-disk cache so unchanged CAP files are
+ * not read and analyzed again.
+ *
+ * A cache entry is named after a hash of the CAP file bytes and records a hash
+ * of the export file used for each imported package. An entry is only used if
+ * the given export files still hash the same.
+ */
+
+#ifndef CAP_FILE_CACHE_H
+#define CAP_FILE_CACHE_H
+
+#include "analyzed_cap_file.h"
+#include "exp_file.h"
+
+/**
+ * \brief Hash the bytes of a file.
+ *
+ * \param filename The file to hash.
+ * \param hash     Where to store the hash.
+ *
+ * \return Return -1 if the file could not be read, 0 else.
+ */
+int hash_file(const char* filename, uint64_t* hash);
+
+/**
+ * \brief Hash everything a parsed export file holds, so that a change in the
+ * export file used for an imported package can be detected.
+ *
+ * \param ef The parsed export file.
+ *
+ * \return Return the hash.
+ */
+uint64_t hash_export_file(const export_file* ef);
+
+/**
+ * \brief Load an analyzed CAP file from the cache.
+ *
+ * \param cache_directory The directory holding the cache entries.
+ * \param filename        The CAP file which was analyzed.
+ * \param export_files    An array of parsed export files.
+ * \param nb_export_files The number of parsed export files in the array.
+ *
+ * \return Return the analyzed CAP file or NULL if it is not in the cache or an
+ *         error occurred.
+ */
+analyzed_cap_file* get_cached_analyzed_cap_file(const char* cache_directory, const char* filename, export_file** export_files, int nb_export_files);
+
+/**
+ * \brief Store an analyzed CAP file in the cache, replacing any previous entry
+ * for the same CAP file bytes.
+ *
+ * \param cache_directory The directory holding the cache entries. It should
+ *                        exist.
+ * \param filename        The CAP file which was analyzed.
+ * \param acf             The analyzed CAP file. Its imported packages should be
+ *                        linked to their export file.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int put_cached_analyzed_cap_file(const char* cache_directory, const char* filename, analyzed_cap_file* acf);
+
+/**
+ * \brief Load an analyzed CAP file from the cache or else read, analyze and
+ * store it in the cache.
+ *
+ * A failure to store the analyzed CAP file is reported but not fatal.
+ *
+ * \param cache_directory The directory holding the cache entries.
+ * \param filename        The CAP file to read.
+ * \param export_files    An array of parsed export files.
+ * \param nb_export_files The number of parsed export files in the array.
+ *
+ * \return Return the analyzed CAP file or NULL if an error occurred.
+ */
+analyzed_cap_file* read_and_analyze_cap_file(const char* cache_directory, const char* filename, export_file** export_files, int nb_export_files);
+
+#endif
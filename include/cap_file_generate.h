@@ -61,4 +61,61 @@
  */
 cap_file* generate_cap_file(analyzed_cap_file* acf);
 
+#define GENERATE_SORT_CONSTANT_POOL 0x01    /**< Within each constant pool
+                                                 group, give the smallest
+                                                 indexes to the most referred
+                                                 entries so more bytecodes use a
+                                                 one byte index. */
+#define GENERATE_LOWER_SWITCHES     0x02    /**< Give each switch its
+                                                 cheapest form with respect to
+                                                 size and dispatch cycles:
+                                                 tableswitch, lookupswitch or,
+                                                 for one or two cases, a chain
+                                                 of comparisons. Cases
+                                                 branching to the default
+                                                 target are dropped. */
+#define GENERATE_INCREMENTAL_LAYOUT 0x04    /**< Only relax the branches and
+                                                 compute the frame and
+                                                 offsets of methods whose
+                                                 needs_layout is set, the
+                                                 others being shifted as a
+                                                 whole. */
+#define GENERATE_COPY_UNCHANGED     0x08    /**< Do not generate the
+                                                 components left unchanged
+                                                 since the analysis (see
+                                                 dirty_components) but let
+                                                 write_cap_file() copy them
+                                                 from the source CAP file.
+                                                 They only get their tag and
+                                                 size, so the generated CAP
+                                                 file is only fit for
+                                                 writing. */
+
+/**
+ * \brief What was changed in the bytecodes while generating a CAP file.
+ */
+typedef struct {
+    u4 narrowed_branches;   /**< Number of wide branches given a short form. */
+    u4 widened_branches;    /**< Number of short branches given a wide form. */
+    u4 reencoded_switches;  /**< Number of switches whose form or size
+                                 changed. */
+    u4 unrolled_switches;   /**< Number of switches replaced by a chain of
+                                 comparisons. */
+} generate_report;
+
+/**
+ * \brief Generate from the analyzed CAP file a straightforward representation
+ * of a CAP file ready to be written, with optional optimizations.
+ *
+ * Whatever the flags, each branch gets the shortest form its offset fits in.
+ *
+ * \param acf    The analyzed CAP file to generate from.
+ * \param flags  A combination of GENERATE_* flags.
+ * \param report Filled with what was changed in the bytecodes if not NULL.
+ *
+ * \return Return NULL if an error occured, an allocated and filled cap_file
+ *         else.
+ */
+cap_file* generate_cap_file_with_flags(analyzed_cap_file* acf, u1 flags, generate_report* report);
+
 #endif
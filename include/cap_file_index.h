@@ -0,0 +1,217 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file cap_file_index.h
+ * \brief An on-disk inverted index of the external names used by a corpus of
+ * CAP files.
+ *
+ * Every bytecode and exception handler referring to an imported package is
+ * recorded under the name of what it uses, resolved through the export file
+ * of the package: "pkg/Class" for a class, "pkg/Class.field" for a field and
+ * "pkg/Class.method(descriptor)" for a method. Without an export file the
+ * tokens are used instead, such as "A0000000620101/3.7()".
+ *
+ * The index file starts with a table of the indexed CAP files and a table of
+ * the names sorted bytewise, each name followed by its usages sorted by CAP
+ * file. A query maps the file and binary searches the names so it does not
+ * depend on the size of the corpus. The index is updated by scanning again
+ * only the CAP files whose bytes or imported export files changed.
+ */
+
+#ifndef CAP_FILE_INDEX_H
+#define CAP_FILE_INDEX_H
+
+#include "analyzed_cap_file.h"
+#include "exp_file.h"
+#include "verbose_sink.h"
+
+#define CAP_FILE_INDEX_MAX_AID_LENGTH   16  /**< The longest AID. */
+
+/**
+ * \brief The export file an indexed CAP file was scanned with for one of its
+ * imported packages.
+ */
+typedef struct {
+    u1 aid_length;                          /**< The length of the AID. */
+    u1 aid[CAP_FILE_INDEX_MAX_AID_LENGTH];  /**< The AID of the imported
+                                                 package. */
+    uint64_t hash;                          /**< The hash of the export file or
+                                                 0 if there was none. */
+} cap_file_index_import;
+
+/**
+ * \brief Where a name is used.
+ */
+typedef struct {
+    u4 key;             /**< Index of the name within the keys of the
+                             document. */
+    u2 class_index;     /**< Index of the class within the CAP file. */
+    u2 method_index;    /**< Index of the method within the class. */
+    u2 offset;          /**< Offset of the bytecode within the method. */
+} cap_file_index_usage;
+
+/**
+ * \brief An indexed CAP file.
+ */
+typedef struct {
+    char* path;                         /**< The CAP file as it was given. */
+    uint64_t hash;                      /**< The hash of the CAP file bytes. */
+    uint64_t size;                      /**< The size of the CAP file. */
+    int64_t mtime;                      /**< The modification time of the CAP
+                                             file, to avoid hashing it again
+                                             when it did not change. */
+
+    u1 imports_count;                   /**< The number of imported
+                                             packages. */
+    cap_file_index_import* imports;     /**< The imported packages. */
+
+    u4 keys_count;                      /**< The number of distinct names
+                                             used. */
+    char** keys;                        /**< The distinct names used. */
+
+    u4 usages_count;                    /**< The number of usages. */
+    cap_file_index_usage* usages;       /**< The usages in the order of the
+                                             classes, methods and bytecodes. */
+} cap_file_index_document;
+
+/**
+ * \brief An index being updated.
+ */
+typedef struct {
+    export_file** export_files;         /**< The export files to resolve the
+                                             names with. */
+    int nb_export_files;                /**< The number of export files. */
+    uint64_t* export_file_hashes;       /**< The hash of each export file. */
+
+    u4 documents_count;                 /**< The number of indexed CAP
+                                             files. */
+    cap_file_index_document** documents;    /**< The indexed CAP files sorted
+                                                 by path. */
+} cap_file_index;
+
+
+/**
+ * \brief Read an index file so it can be updated.
+ *
+ * \param path            The index file. An empty index is returned if it
+ *                        does not exist.
+ * \param export_files    An array of parsed export files.
+ * \param nb_export_files The number of parsed export files in the array.
+ *
+ * \return Return the index or NULL if the file is not a valid index or an
+ *         error occurred.
+ */
+cap_file_index* read_cap_file_index(const char* path, export_file** export_files, int nb_export_files);
+
+/**
+ * \brief Free an index and all of its documents.
+ *
+ * \param index The index to free.
+ */
+void free_cap_file_index(cap_file_index* index);
+
+/**
+ * \brief Scan an analyzed CAP file for the names it uses.
+ *
+ * \param index The index giving the export files.
+ * \param acf   The analyzed CAP file. Its imported packages should be linked
+ *              to their export file when there is one.
+ * \param path  The CAP file it was analyzed from.
+ *
+ * \return Return the document or NULL if an error occurred.
+ */
+cap_file_index_document* scan_cap_file_usages(const cap_file_index* index, analyzed_cap_file* acf, const char* path);
+
+/**
+ * \brief Free a document.
+ *
+ * \param document The document to free.
+ */
+void free_cap_file_index_document(cap_file_index_document* document);
+
+/**
+ * \brief Index a batch of CAP files.
+ *
+ * A CAP file already indexed is scanned again only if its bytes or one of
+ * the export files of its imported packages changed. The CAP files of the
+ * index which are not in the batch are removed from it. One line per CAP
+ * file tells whether it was kept or how many usages were found.
+ *
+ * \param index           The index to update.
+ * \param filenames       The CAP files to index.
+ * \param nb_filenames    The number of CAP files.
+ * \param nb_workers      The number of worker threads scanning CAP files.
+ * \param cache_directory Where analyzed CAP files are cached, NULL for no
+ *                        cache.
+ * \param output          Where to output what was done for each CAP file.
+ * \param report          Where to output the messages.
+ *
+ * \return Return the number of CAP files which could not be indexed or -1 if
+ *         an error occurred.
+ */
+int update_cap_file_index(cap_file_index* index, char* const* filenames, int nb_filenames, int nb_workers, const char* cache_directory, verbose_sink* output, verbose_sink* report);
+
+/**
+ * \brief Write an index file. It is first written to a temporary file which
+ * then replaces the index file.
+ *
+ * \param index The index to write.
+ * \param path  The index file.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int write_cap_file_index(cap_file_index* index, const char* path);
+
+/**
+ * \brief Output the usages of a name, one per line.
+ *
+ * \param path      The index file.
+ * \param name      The name to search for.
+ * \param is_prefix Whether every name starting with the given one should be
+ *                  searched for, such as "javacard/security/" for a whole
+ *                  package.
+ * \param output    Where to output the usages.
+ *
+ * \return Return the number of usages found or -1 if an error occurred.
+ */
+int query_cap_file_index(const char* path, const char* name, int is_prefix, verbose_sink* output);
+
+#endif
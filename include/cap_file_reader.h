@@ -59,4 +59,11 @@
  * \return An allocated cap_file structure containing the parsed CAP file.
  */
 cap_file* read_cap_file(const char* filename);
+
+/**
+ * \brief Free a CAP file built by read_cap_file() or generate_cap_file().
+ *
+ * \param cf The CAP file to free, might be NULL.
+ */
+void free_cap_file(cap_file* cf);
 #endif
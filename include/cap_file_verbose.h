@@ -45,87 +45,100 @@
  */
 
 #include "cap_file.h"
+#include "verbose_sink.h"
 
 /**
- * \brief Output the manifest of a CAP file on the standard output.
+ * \brief Output the manifest of a CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param cf The CAP file to output.
  */
-void verbose_manifest(cap_file* cf);
+void verbose_manifest(verbose_sink* sink, cap_file* cf);
 
 /**
- * \brief Output the Header component of a CAP file on the standard output.
+ * \brief Output the Header component of a CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param cf The CAP file to output.
  */
-void verbose_header_component(cap_file* cf);
+void verbose_header_component(verbose_sink* sink, cap_file* cf);
 
 /**
- * \brief Output the Directory component of a CAP file on the standard output.
+ * \brief Output the Directory component of a CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param cf The CAP file to output.
  */
-void verbose_directory_component(cap_file* cf);
+void verbose_directory_component(verbose_sink* sink, cap_file* cf);
 
 /**
- * \brief Output the Applet component of a CAP file on the standard output.
+ * \brief Output the Applet component of a CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param cf The CAP file to output.
  */
-void verbose_applet_component(cap_file* cf);
+void verbose_applet_component(verbose_sink* sink, cap_file* cf);
 
 /**
- * \brief Output the Import component of a CAP file on the standard output.
+ * \brief Output the Import component of a CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param cf The CAP file to output.
  */
-void verbose_import_component(cap_file* cf);
+void verbose_import_component(verbose_sink* sink, cap_file* cf);
 
 /**
- * \brief Output the Constant Pool component of a CAP file on the standard output.
+ * \brief Output the Constant Pool component of a CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param cf The CAP file to output.
  */
-void verbose_constant_pool_component(cap_file* cf);
+void verbose_constant_pool_component(verbose_sink* sink, cap_file* cf);
 
 /**
- * \brief Output the Class component of a CAP file on the standard output.
+ * \brief Output the Class component of a CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param cf The CAP file to output.
  */
-void verbose_class_component(cap_file* cf);
+void verbose_class_component(verbose_sink* sink, cap_file* cf);
 
 /**
- * \brief Output the Method component of a CAP file on the standard output.
+ * \brief Output the Method component of a CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param cf The CAP file to output.
  */
-void verbose_method_component(cap_file* cf);
+void verbose_method_component(verbose_sink* sink, cap_file* cf);
 
 /**
- * \brief Output the Static Field component of a CAP file on the standard output.
+ * \brief Output the Static Field component of a CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param cf The CAP file to output.
  */
-void verbose_static_field_component(cap_file* cf);
+void verbose_static_field_component(verbose_sink* sink, cap_file* cf);
 
 /**
- * \brief Output the Reference Location component of a CAP file on the standard output.
+ * \brief Output the Reference Location component of a CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param cf The CAP file to output.
  */
-void verbose_reference_location_component(cap_file* cf);
+void verbose_reference_location_component(verbose_sink* sink, cap_file* cf);
 
 /**
- * \brief Output the Export component of a CAP file on the standard output.
+ * \brief Output the Export component of a CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param cf The CAP file to output.
  */
-void verbose_export_component(cap_file* cf);
+void verbose_export_component(verbose_sink* sink, cap_file* cf);
 
 /**
- * \brief Output the Descriptor component of a CAP file on the standard output.
+ * \brief Output the Descriptor component of a CAP file to a sink.
  *
+ * \param sink Where to output it.
  * \param cf The CAP file to output.
  */
-void verbose_descriptor_component(cap_file* cf);
+void verbose_descriptor_component(verbose_sink* sink, cap_file* cf);
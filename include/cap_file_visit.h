@@ -0,0 +1,142 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file cap_file_visit.h
+ * \brief Walk the bytecodes of a straightforward representation of CAP file
+ * without analyzing it.
+ */
+
+#ifndef CAP_FILE_VISIT_H
+#define CAP_FILE_VISIT_H
+
+#include "cap_file.h"
+
+/**
+ * \brief Describe a bytecode decoded in place from the Method component.
+ *
+ * Nothing is allocated: args points within the bytecodes of the method.
+ */
+typedef struct {
+    u1 opcode;          /**< The opcode of the bytecode. */
+    u2 offset;          /**< Offset within the method. */
+    u2 info_offset;     /**< Offset within info[] of the Method component. */
+
+    u2 nb_args;         /**< Number of bytes of the arguments. */
+    const u1* args;     /**< The raw arguments. */
+
+    u1 has_ref;         /**< Does the bytecode use a constant pool entry? */
+    u2 ref;             /**< Index within the Constant Pool component if
+                             has_ref is true (!=0). */
+
+    u1 has_branch;      /**< Does the bytecode branch? True for switch like
+                             bytecodes. */
+    u2 branch;          /**< Offset within the method of the branch target or
+                             of the default branch for switch like
+                             bytecodes. */
+
+    u2 nb_cases;        /**< Number of cases for switch like bytecodes. */
+} visited_bytecode;
+
+/**
+ * \brief Called before visiting the bytecodes of a method.
+ *
+ * \param cf           The visited CAP file.
+ * \param method_index The index of the method within the Method component.
+ * \param data         The data given to visit_cap_file_bytecodes.
+ *
+ * \return Return -1 to abort the walk with an error, 1 to stop it, 0 to
+ *         continue.
+ */
+typedef int (*method_visitor)(cap_file* cf, u2 method_index, void* data);
+
+/**
+ * \brief Called for each visited bytecode.
+ *
+ * \param cf           The visited CAP file.
+ * \param method_index The index of the method within the Method component.
+ * \param bytecode     The decoded bytecode. It is only valid during the call.
+ * \param data         The data given to the walking function.
+ *
+ * \return Return -1 to abort the walk with an error, 1 to stop it, 0 to
+ *         continue.
+ */
+typedef int (*bytecode_visitor)(cap_file* cf, u2 method_index, const visited_bytecode* bytecode, void* data);
+
+/**
+ * \brief Get a case of a visited switch like bytecode.
+ *
+ * \param bytecode   The visited switch like bytecode.
+ * \param case_index The index of the case (less than nb_cases).
+ * \param match      The value of the case.
+ * \param branch     The offset within the method of the case target.
+ *
+ * \return Return -1 if the bytecode is not a switch or the case does not
+ *         exist, 0 else.
+ */
+int get_visited_switch_case(const visited_bytecode* bytecode, u2 case_index, int32_t* match, u2* branch);
+
+/**
+ * \brief Visit the bytecodes of one method of a straightforward CAP file.
+ *
+ * \param cf           The CAP file.
+ * \param method_index The index of the method within the Method component.
+ * \param visitor      Called for each bytecode.
+ * \param data         Given as is to the visitor.
+ *
+ * \return Return -1 if an error occurred, 1 if the visitor stopped the walk,
+ *         0 else.
+ */
+int visit_method_bytecodes(cap_file* cf, u2 method_index, bytecode_visitor visitor, void* data);
+
+/**
+ * \brief Visit the bytecodes of every method of a straightforward CAP file.
+ *
+ * \param cf               The CAP file.
+ * \param method_visitor   Called before each method. Might be NULL.
+ * \param bytecode_visitor Called for each bytecode. Might be NULL.
+ * \param data             Given as is to the visitors.
+ *
+ * \return Return -1 if an error occurred, 1 if a visitor stopped the walk, 0
+ *         else.
+ */
+int visit_cap_file_bytecodes(cap_file* cf, method_visitor method_visitor, bytecode_visitor bytecode_visitor, void* data);
+
+#endif
@@ -49,6 +49,8 @@
 
 /**
  * \brief Write a straightforward CAP file representation into a file.
+ * The components in source_components, which were not generated, are copied
+ * from the source CAP file as they are, still compressed.
  * 
  * \param The straightforward representation of a CAP file.
  * \param filename The path to the file to write in.
@@ -56,4 +58,16 @@
  * \return Return -1 if an error occurred, 0 else.
  */
 int write_cap_file(cap_file* cf, const char* filename);
+
+/**
+ * \brief Check that the components a written CAP file copied from its source
+ * are the same entries, byte for byte and still compressed the same way.
+ *
+ * \param cf The straightforward representation of the written CAP file.
+ * \param filename The path to the written CAP file.
+ *
+ * \return Return -1 if an error occurred, the number of copied components
+ *         which differ from the source else.
+ */
+int check_copied_components(cap_file* cf, const char* filename);
 #endif
@@ -43,5 +43,12 @@
  * \brief Output a human readable version of an export file.
  */
 #include "exp_file.h"
+#include "verbose_sink.h"
 
-void verbose_export_file(export_file* ef);
+/**
+ * \brief Output an export file to a sink.
+ *
+ * \param sink Where to output it.
+ * \param ef The export file to output.
+ */
+void verbose_export_file(verbose_sink* sink, export_file* ef);
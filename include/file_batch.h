@@ -0,0 +1,125 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file file_batch.h
+ * \brief Run a function on many input files on a pool of worker threads
+ * while keeping the output in the order of the inputs.
+ *
+ * Each input is given its own memory sinks for its output and its report so
+ * the workers never interleave their output. The main thread hands them over
+ * to the real sinks in order. At most FILE_BATCH_WINDOW_FACTOR outputs per
+ * worker are kept in memory at any time.
+ */
+
+#ifndef FILE_BATCH_H
+#define FILE_BATCH_H
+
+#include "verbose_sink.h"
+
+#define FILE_BATCH_WINDOW_FACTOR    2   /**< Number of pending outputs per
+                                             worker. */
+
+
+/**
+ * \brief Function run on each input file.
+ *
+ * It may be called from several threads at once with different files and
+ * must therefore only share read-only data.
+ *
+ * \param filename The input file.
+ * \param output Where to output the result for this file.
+ * \param report Where to output the messages for this file.
+ * \param data The data given to process_file_batch().
+ *
+ * \return -1 if the file could not be processed, 0 else.
+ */
+typedef int (*file_batch_function)(const char* filename, verbose_sink* output, verbose_sink* report, void* data);
+
+
+/**
+ * \brief Expand the inputs given on a command line.
+ *
+ * A directory is replaced by the regular files with the given extension found
+ * in it and its subdirectories, sorted by path. An argument starting with @
+ * is replaced by the paths listed in the named file, one per line. Other
+ * arguments are kept as they are.
+ *
+ * \param arguments The arguments to expand.
+ * \param nb_arguments The number of arguments.
+ * \param extension The extension of the files to take from directories, such
+ * as ".cap", or NULL for any file.
+ * \param nb_filenames The number of file names in the returned array.
+ *
+ * \return An array of allocated file names or NULL if an error occurred.
+ */
+char** get_file_batch(char* const* arguments, int nb_arguments, const char* extension, int* nb_filenames);
+
+/**
+ * \brief Free an array returned by get_file_batch().
+ *
+ * \param filenames The array of file names.
+ * \param nb_filenames The number of file names in the array.
+ */
+void free_file_batch(char** filenames, int nb_filenames);
+
+/**
+ * \brief Run a function on every file of a batch.
+ *
+ * The outputs and reports are written to the given sinks in the order of the
+ * files whatever the order in which the workers finish. When there is more
+ * than one file, each output is preceded by a line holding the name of its
+ * file. With one worker or less everything is done in the calling thread and
+ * written to the sinks as it is produced.
+ *
+ * \param filenames The input files.
+ * \param nb_filenames The number of input files.
+ * \param nb_workers The number of worker threads.
+ * \param function The function to run on each file.
+ * \param data Data given to each call of the function.
+ * \param output Where to output the results.
+ * \param report Where to output the messages.
+ *
+ * \return The number of files the function failed on or -1 if the batch
+ * could not be run.
+ */
+int process_file_batch(char* const* filenames, int nb_filenames, int nb_workers, file_batch_function function, void* data, verbose_sink* output, verbose_sink* report);
+
+#endif
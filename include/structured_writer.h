@@ -0,0 +1,261 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file structured_writer.h
+ * \brief Stream JSON or CBOR documents to a verbose_sink.
+ *
+ * Documents are written as they are built, without keeping them in memory:
+ * objects and arrays are opened and closed explicitly, and CBOR ones use the
+ * indefinite length encoding so that their size need not be known upfront.
+ * Errors are sticky: once a call failed, the following ones do nothing and
+ * has_failed is set.
+ */
+
+#ifndef STRUCTURED_WRITER_H
+#define STRUCTURED_WRITER_H
+
+#include <stdint.h>
+
+#include "cap_file.h"
+#include "verbose_sink.h"
+
+#define STRUCTURED_JSON 1   /**< Indented JSON. */
+#define STRUCTURED_CBOR 2   /**< CBOR (RFC 7049). */
+
+#define STRUCTURED_MAX_DEPTH    32  /**< Maximum nesting of objects and
+                                         arrays. */
+
+/**
+ * \brief The name of a flag, for write_flags_member().
+ */
+typedef struct {
+    u2 mask;            /**< The bit of the flag. */
+    const char* name;   /**< Its name. */
+} structured_flag;
+
+/**
+ * \brief The state of a document being written.
+ */
+typedef struct {
+    verbose_sink* sink;     /**< Where the document goes. */
+    u1 format;              /**< STRUCTURED_JSON or STRUCTURED_CBOR. */
+    u1 depth;               /**< Number of open objects and arrays. */
+    char has_failed;        /**< An error occurred. */
+    char after_key;         /**< A key was just written (JSON only). */
+    char has_elements[STRUCTURED_MAX_DEPTH + 1];   /**< An element was written
+                                                        at this depth (JSON
+                                                        only). */
+} structured_writer;
+
+/**
+ * \brief Start writing a document.
+ *
+ * \param writer The writer to initialize.
+ * \param sink Where the document goes. It is not flushed by the writer.
+ * \param format STRUCTURED_JSON or STRUCTURED_CBOR.
+ */
+void init_structured_writer(structured_writer* writer, verbose_sink* sink, u1 format);
+
+/**
+ * \brief Open an object, a map in CBOR. Its content is a sequence of keys
+ * each followed by one value.
+ *
+ * \param writer The writer.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int begin_object(structured_writer* writer);
+
+/**
+ * \brief Close the innermost object.
+ *
+ * \param writer The writer.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int end_object(structured_writer* writer);
+
+/**
+ * \brief Open an array.
+ *
+ * \param writer The writer.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int begin_array(structured_writer* writer);
+
+/**
+ * \brief Close the innermost array.
+ *
+ * \param writer The writer.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int end_array(structured_writer* writer);
+
+/**
+ * \brief Write the key of the next member of the innermost object.
+ *
+ * \param writer The writer.
+ * \param key A NUL terminated ASCII key.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int write_key(structured_writer* writer, const char* key);
+
+/**
+ * \brief Write an unsigned integer.
+ *
+ * \param writer The writer.
+ * \param value The value.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int write_uint(structured_writer* writer, u4 value);
+
+/**
+ * \brief Write a signed integer.
+ *
+ * \param writer The writer.
+ * \param value The value.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int write_int(structured_writer* writer, int32_t value);
+
+/**
+ * \brief Write a boolean.
+ *
+ * \param writer The writer.
+ * \param value 0 for false, true else.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int write_bool(structured_writer* writer, char value);
+
+/**
+ * \brief Write null.
+ *
+ * \param writer The writer.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int write_null(structured_writer* writer);
+
+/**
+ * \brief Write a text string.
+ *
+ * \param writer The writer.
+ * \param text The UTF-8 text, not necessarily NUL terminated.
+ * \param length The length of text in bytes.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int write_string(structured_writer* writer, const u1* text, u4 length);
+
+/**
+ * \brief Write a byte string, as a string of hexadecimal digits in JSON.
+ *
+ * \param writer The writer.
+ * \param bytes The bytes.
+ * \param length The number of bytes.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int write_bytes(structured_writer* writer, const u1* bytes, u4 length);
+
+/**
+ * \brief Write a member whose value is an unsigned integer.
+ *
+ * \param writer The writer.
+ * \param key The key of the member.
+ * \param value The value.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int write_uint_member(structured_writer* writer, const char* key, u4 value);
+
+/**
+ * \brief Write a member whose value is a NUL terminated text string.
+ *
+ * \param writer The writer.
+ * \param key The key of the member.
+ * \param text The value.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int write_string_member(structured_writer* writer, const char* key, const char* text);
+
+/**
+ * \brief Write a member whose value is a byte string.
+ *
+ * \param writer The writer.
+ * \param key The key of the member.
+ * \param bytes The bytes.
+ * \param length The number of bytes.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int write_bytes_member(structured_writer* writer, const char* key, const u1* bytes, u4 length);
+
+/**
+ * \brief Write a member whose value is the array of the names of the set
+ * flags.
+ *
+ * \param writer The writer.
+ * \param key The key of the member.
+ * \param flags The flags.
+ * \param names The known flags, ended by an entry whose name is NULL.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int write_flags_member(structured_writer* writer, const char* key, u2 flags, const structured_flag* names);
+
+/**
+ * \brief End the document. Every object and array must have been closed.
+ *
+ * \param writer The writer.
+ *
+ * \return -1 if an error occurred now or before, 0 else.
+ */
+int end_document(structured_writer* writer);
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file verbose_sink.h
+ * \brief Buffered destination of the output of the verbose_* functions.
+ *
+ * The output is formatted into a large buffer which is handed over to a
+ * file, a growable memory block or a callback once it is full or when
+ * flush_verbose_sink() is called.
+ */
+
+#ifndef VERBOSE_SINK_H
+#define VERBOSE_SINK_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "cap_file.h"
+
+#define VERBOSE_SINK_BUFFER_SIZE    8192    /**< Size of the formatting
+                                                 buffer. */
+
+/**
+ * \brief Receive a chunk of output.
+ *
+ * \param data The data given to init_callback_sink().
+ * \param bytes The output, not NUL terminated.
+ * \param length The number of bytes.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+typedef int (*verbose_sink_callback)(void* data, const char* bytes, size_t length);
+
+/**
+ * \brief Where the output goes.
+ */
+typedef struct {
+#define VERBOSE_SINK_FILE       1   /**< Written to a FILE. */
+#define VERBOSE_SINK_MEMORY     2   /**< Appended to a memory block. */
+#define VERBOSE_SINK_CALLBACK   3   /**< Given to a callback. */
+    u1 type;                        /**< The kind of sink. */
+    char has_failed;                /**< An error occurred, the output is
+                                         incomplete. */
+    FILE* file;                     /**< The file of a VERBOSE_SINK_FILE. */
+    char* memory;                   /**< The NUL terminated output of a
+                                         VERBOSE_SINK_MEMORY. */
+    size_t memory_length;           /**< The length of the output. */
+    size_t memory_capacity;         /**< The allocated size of memory. */
+    verbose_sink_callback callback; /**< The callback of a
+                                         VERBOSE_SINK_CALLBACK. */
+    void* callback_data;            /**< Given to the callback. */
+    size_t buffer_length;           /**< Bytes waiting in buffer. */
+    char buffer[VERBOSE_SINK_BUFFER_SIZE];  /**< Formatted output not yet
+                                                 handed over. */
+} verbose_sink;
+
+/**
+ * \brief Output to a file.
+ *
+ * \param sink The sink to initialize.
+ * \param file The file to write to, for example stdout.
+ */
+void init_file_sink(verbose_sink* sink, FILE* file);
+
+/**
+ * \brief Output to a growable memory block. Once flushed, the output is in
+ * sink->memory and must be freed with free_verbose_sink().
+ *
+ * \param sink The sink to initialize.
+ */
+void init_memory_sink(verbose_sink* sink);
+
+/**
+ * \brief Output to a callback.
+ *
+ * \param sink The sink to initialize.
+ * \param callback Called with each chunk of output.
+ * \param data Given to the callback.
+ */
+void init_callback_sink(verbose_sink* sink, verbose_sink_callback callback, void* data);
+
+/**
+ * \brief Format some output as printf() does.
+ *
+ * \param sink The sink to output to.
+ * \param format The format of the output.
+ *
+ * \return -1 if an error occurred, 0 else. Once an error occurred, further
+ *         output is dropped and has_failed is set.
+ */
+int sink_printf(verbose_sink* sink, const char* format, ...)
+#ifdef __GNUC__
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+/**
+ * \brief Output some bytes as they are.
+ *
+ * \param sink The sink to output to.
+ * \param bytes The bytes to output.
+ * \param length The number of bytes.
+ *
+ * \return -1 if an error occurred, 0 else.
+ */
+int sink_write(verbose_sink* sink, const char* bytes, size_t length);
+
+/**
+ * \brief Hand the buffered output over to the file, memory block or
+ * callback. It should be called once the output is complete.
+ *
+ * \param sink The sink to flush.
+ *
+ * \return -1 if an error occurred now or before, 0 else.
+ */
+int flush_verbose_sink(verbose_sink* sink);
+
+/**
+ * \brief Free the memory block of a memory sink. The file of a file sink is
+ * not closed.
+ *
+ * \param sink The sink to free.
+ */
+void free_verbose_sink(verbose_sink* sink);
+
+#endif
@@ -0,0 +1,731 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_cfg.c
+ * \brief Basic blocks, control flow graph and dominators of analyzed
+ * methods.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_cfg.h"
+#include "bytecodes.h"
+
+#define CFG_EDGE_NORMAL     0   /**< An edge to a block executed next. */
+#define CFG_EDGE_EXCEPTION  1   /**< An edge to an exception handler. */
+
+/**
+ * \brief What is needed while building the graph of a method.
+ */
+typedef struct {
+    bytecode_index_map index;   /**< The index of each bytecode. */
+
+    u1* leaders;                /**< Whether each bytecode starts a block. */
+    u4* stamps;                 /**< For each block, the last block and edge
+                                     kind it was added as a successor of. */
+
+    u2* handler_starts;         /**< The first bytecode covered by each
+                                     handler. */
+    u2* handler_ends;           /**< The bytecode right after the last one
+                                     covered by each handler. */
+    u2* handler_blocks;         /**< The block of each handler. */
+} cfg_builder;
+
+
+/**
+ * Hash a bytecode address.
+ */
+static u4 hash_bytecode(const bytecode_info* bytecode) {
+
+    return (u4)((uintptr_t)bytecode >> 3) * 2654435761U;
+
+}
+
+
+int init_bytecode_index_map(bytecode_index_map* map, method_info* method) {
+
+    u4 size = 16;
+    u2 u2Index = 0;
+
+    while(size < (u4)method->bytecodes_count * 2)
+        size *= 2;
+
+    map->mask = size - 1;
+    map->keys = (bytecode_info**)calloc(size, sizeof(bytecode_info*));
+    map->values = (u2*)malloc(sizeof(u2) * size);
+    if((map->keys == NULL) || (map->values == NULL)) {
+        perror("init_bytecode_index_map");
+        return -1;
+    }
+
+    for(; u2Index < method->bytecodes_count; ++u2Index) {
+        u4 slot = hash_bytecode(method->bytecodes[u2Index]) & map->mask;
+
+        while(map->keys[slot] != NULL)
+            slot = (slot + 1) & map->mask;
+
+        map->keys[slot] = method->bytecodes[u2Index];
+        map->values[slot] = u2Index;
+    }
+
+    return 0;
+
+}
+
+
+u2 get_mapped_bytecode_index(const bytecode_index_map* map, const bytecode_info* bytecode) {
+
+    u4 slot = hash_bytecode(bytecode) & map->mask;
+
+    for(; map->keys[slot] != NULL; slot = (slot + 1) & map->mask)
+        if(map->keys[slot] == bytecode)
+            return map->values[slot];
+
+    return CFG_NONE;
+
+}
+
+
+void free_bytecode_index_map(bytecode_index_map* map) {
+
+    free(map->keys);
+    free(map->values);
+
+}
+
+
+/**
+ * Mark a branch target as a block leader.
+ */
+static int mark_target(cfg_builder* builder, const bytecode_info* target) {
+
+    u2 index = (target == NULL) ? CFG_NONE : get_mapped_bytecode_index(&builder->index, target);
+
+    if(index == CFG_NONE) {
+        fprintf(stderr, "Branch target outside of its method\n");
+        return -1;
+    }
+
+    builder->leaders[index] = 1;
+
+    return 0;
+
+}
+
+
+/**
+ * Mark the first bytecode of each basic block.
+ */
+static int mark_leaders(cfg_builder* builder, method_info* method) {
+
+    u2 u2Index1 = 0;
+    u1 u1Index = 0;
+
+    builder->leaders[0] = 1;
+
+    for(; u2Index1 < method->bytecodes_count; ++u2Index1) {
+        bytecode_info* bytecode = method->bytecodes[u2Index1];
+        const opcode_info* opcode = &opcodes[bytecode->opcode];
+        switch_info* data = bytecode->switch_data;
+        u2 u2Index2 = 0;
+
+        if(((opcode->format == OPCODE_FORMAT_BRANCH) || (data != NULL) || (opcode->flags & OPCODE_UNCONDITIONAL)) && (u2Index1 + 1 < method->bytecodes_count))
+            builder->leaders[u2Index1 + 1] = 1;
+
+        if(bytecode->has_branch && (mark_target(builder, bytecode->branch) == -1))
+            return -1;
+
+        if(data == NULL)
+            continue;
+
+        switch(opcode->format) {
+            case OPCODE_FORMAT_STABLESWITCH:
+                if(mark_target(builder, data->stableswitch.default_branch) == -1)
+                    return -1;
+                for(; u2Index2 < data->stableswitch.nb_cases; ++u2Index2)
+                    if(mark_target(builder, data->stableswitch.branches[u2Index2]) == -1)
+                        return -1;
+                break;
+
+            case OPCODE_FORMAT_ITABLESWITCH:
+                if(mark_target(builder, data->itableswitch.default_branch) == -1)
+                    return -1;
+                for(; u2Index2 < data->itableswitch.nb_cases; ++u2Index2)
+                    if(mark_target(builder, data->itableswitch.branches[u2Index2]) == -1)
+                        return -1;
+                break;
+
+            case OPCODE_FORMAT_SLOOKUPSWITCH:
+                if(mark_target(builder, data->slookupswitch.default_branch) == -1)
+                    return -1;
+                for(; u2Index2 < data->slookupswitch.nb_cases; ++u2Index2)
+                    if(mark_target(builder, data->slookupswitch.cases[u2Index2].branch) == -1)
+                        return -1;
+                break;
+
+            case OPCODE_FORMAT_ILOOKUPSWITCH:
+                if(mark_target(builder, data->ilookupswitch.default_branch) == -1)
+                    return -1;
+                for(; u2Index2 < data->ilookupswitch.nb_cases; ++u2Index2)
+                    if(mark_target(builder, data->ilookupswitch.cases[u2Index2].branch) == -1)
+                        return -1;
+                break;
+        }
+    }
+
+    for(; u1Index < method->exception_handlers_count; ++u1Index) {
+        exception_handler_info* handler = method->exception_handlers[u1Index];
+
+        if((mark_target(builder, handler->start) == -1) || (mark_target(builder, handler->handler) == -1) || ((handler->end != NULL) && (mark_target(builder, handler->end) == -1)))
+            return -1;
+
+        builder->handler_starts[u1Index] = get_mapped_bytecode_index(&builder->index, handler->start);
+        builder->handler_ends[u1Index] = (handler->end == NULL) ? method->bytecodes_count : get_mapped_bytecode_index(&builder->index, handler->end);
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Count, or store if fill, an edge from a block unless it is already there.
+ */
+static void add_edge(cfg_builder* builder, method_cfg* cfg, u2 from, u2 to, u1 kind, char fill) {
+
+    cfg_block* block = cfg->blocks + from;
+    u4 stamp = ((u4)from << 1) | kind;
+
+    if(builder->stamps[to] == stamp)
+        return;
+    builder->stamps[to] = stamp;
+
+    if(kind == CFG_EDGE_NORMAL) {
+        if(fill)
+            cfg->successors[block->first_successor + block->successors_count] = to;
+        ++block->successors_count;
+    } else {
+        if(fill)
+            cfg->successors[block->first_successor + block->successors_count + block->exception_successors_count] = to;
+        ++block->exception_successors_count;
+    }
+
+}
+
+
+/**
+ * Count, or store if fill, the edges of a block: the normal ones first, then
+ * the exception ones.
+ */
+static void add_block_edges(cfg_builder* builder, method_cfg* cfg, u2 from, char fill) {
+
+    cfg_block* block = cfg->blocks + from;
+    bytecode_info* last = cfg->bytecodes[block->end - 1];
+    switch_info* data = last->switch_data;
+    u2 u2Index = 0;
+    u1 u1Index = 0;
+
+    block->successors_count = 0;
+    block->exception_successors_count = 0;
+
+    if(!(opcodes[last->opcode].flags & OPCODE_UNCONDITIONAL) && (block->end < cfg->bytecodes_count))
+        add_edge(builder, cfg, from, from + 1, CFG_EDGE_NORMAL, fill);
+
+    if(last->has_branch)
+        add_edge(builder, cfg, from, cfg->block_of[get_mapped_bytecode_index(&builder->index, last->branch)], CFG_EDGE_NORMAL, fill);
+
+    if(data != NULL)
+        switch(opcodes[last->opcode].format) {
+            case OPCODE_FORMAT_STABLESWITCH:
+                add_edge(builder, cfg, from, cfg->block_of[get_mapped_bytecode_index(&builder->index, data->stableswitch.default_branch)], CFG_EDGE_NORMAL, fill);
+                for(; u2Index < data->stableswitch.nb_cases; ++u2Index)
+                    add_edge(builder, cfg, from, cfg->block_of[get_mapped_bytecode_index(&builder->index, data->stableswitch.branches[u2Index])], CFG_EDGE_NORMAL, fill);
+                break;
+
+            case OPCODE_FORMAT_ITABLESWITCH:
+                add_edge(builder, cfg, from, cfg->block_of[get_mapped_bytecode_index(&builder->index, data->itableswitch.default_branch)], CFG_EDGE_NORMAL, fill);
+                for(; u2Index < data->itableswitch.nb_cases; ++u2Index)
+                    add_edge(builder, cfg, from, cfg->block_of[get_mapped_bytecode_index(&builder->index, data->itableswitch.branches[u2Index])], CFG_EDGE_NORMAL, fill);
+                break;
+
+            case OPCODE_FORMAT_SLOOKUPSWITCH:
+                add_edge(builder, cfg, from, cfg->block_of[get_mapped_bytecode_index(&builder->index, data->slookupswitch.default_branch)], CFG_EDGE_NORMAL, fill);
+                for(; u2Index < data->slookupswitch.nb_cases; ++u2Index)
+                    add_edge(builder, cfg, from, cfg->block_of[get_mapped_bytecode_index(&builder->index, data->slookupswitch.cases[u2Index].branch)], CFG_EDGE_NORMAL, fill);
+                break;
+
+            case OPCODE_FORMAT_ILOOKUPSWITCH:
+                add_edge(builder, cfg, from, cfg->block_of[get_mapped_bytecode_index(&builder->index, data->ilookupswitch.default_branch)], CFG_EDGE_NORMAL, fill);
+                for(; u2Index < data->ilookupswitch.nb_cases; ++u2Index)
+                    add_edge(builder, cfg, from, cfg->block_of[get_mapped_bytecode_index(&builder->index, data->ilookupswitch.cases[u2Index].branch)], CFG_EDGE_NORMAL, fill);
+                break;
+        }
+
+    /* Handler ranges start and end blocks so a block is either covered as a
+       whole or not at all. */
+    for(; u1Index < cfg->method->exception_handlers_count; ++u1Index)
+        if((block->start >= builder->handler_starts[u1Index]) && (block->start < builder->handler_ends[u1Index]))
+            add_edge(builder, cfg, from, builder->handler_blocks[u1Index], CFG_EDGE_EXCEPTION, fill);
+
+}
+
+
+/**
+ * Build the successors and predecessors arrays.
+ */
+static int build_edges(cfg_builder* builder, method_cfg* cfg) {
+
+    u2* cursors = NULL;
+    u4 edges_count = 0;
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < cfg->blocks_count; ++u2Index1)
+        builder->stamps[u2Index1] = 0xFFFFFFFF;
+
+    /* The edges are counted first so that they fit in one array. */
+    for(u2Index1 = 0; u2Index1 < cfg->blocks_count; ++u2Index1) {
+        add_block_edges(builder, cfg, u2Index1, 0);
+        cfg->blocks[u2Index1].first_successor = edges_count;
+        edges_count += cfg->blocks[u2Index1].successors_count + cfg->blocks[u2Index1].exception_successors_count;
+    }
+
+    cfg->successors = (u2*)malloc(sizeof(u2) * (edges_count + 1));
+    cfg->predecessors = (u2*)malloc(sizeof(u2) * (edges_count + 1));
+    cursors = (u2*)calloc((u4)cfg->blocks_count * 2, sizeof(u2));
+    if((cfg->successors == NULL) || (cfg->predecessors == NULL) || (cursors == NULL)) {
+        perror("build_edges");
+        free(cursors);
+        return -1;
+    }
+
+    for(u2Index1 = 0; u2Index1 < cfg->blocks_count; ++u2Index1)
+        builder->stamps[u2Index1] = 0xFFFFFFFF;
+
+    for(u2Index1 = 0; u2Index1 < cfg->blocks_count; ++u2Index1)
+        add_block_edges(builder, cfg, u2Index1, 1);
+
+    for(u2Index1 = 0; u2Index1 < cfg->blocks_count; ++u2Index1) {
+        cfg_block* block = cfg->blocks + u2Index1;
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < block->successors_count + block->exception_successors_count; ++u2Index2) {
+            if(u2Index2 < block->successors_count)
+                ++cfg->blocks[cfg->successors[block->first_successor + u2Index2]].predecessors_count;
+            else
+                ++cfg->blocks[cfg->successors[block->first_successor + u2Index2]].exception_predecessors_count;
+        }
+    }
+
+    edges_count = 0;
+    for(u2Index1 = 0; u2Index1 < cfg->blocks_count; ++u2Index1) {
+        cfg->blocks[u2Index1].first_predecessor = edges_count;
+        edges_count += cfg->blocks[u2Index1].predecessors_count + cfg->blocks[u2Index1].exception_predecessors_count;
+    }
+
+    for(u2Index1 = 0; u2Index1 < cfg->blocks_count; ++u2Index1) {
+        cfg_block* block = cfg->blocks + u2Index1;
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < block->successors_count + block->exception_successors_count; ++u2Index2) {
+            u2 to = cfg->successors[block->first_successor + u2Index2];
+            cfg_block* target = cfg->blocks + to;
+
+            if(u2Index2 < block->successors_count)
+                cfg->predecessors[target->first_predecessor + cursors[to * 2]++] = u2Index1;
+            else
+                cfg->predecessors[target->first_predecessor + target->predecessors_count + cursors[to * 2 + 1]++] = u2Index1;
+        }
+    }
+
+    free(cursors);
+
+    return 0;
+
+}
+
+
+/**
+ * Order the reachable blocks in reverse postorder with a depth first search
+ * following every edge.
+ */
+static int order_blocks(method_cfg* cfg) {
+
+    u2* stack = NULL;
+    u2* cursors = NULL;
+    u2* postorder = NULL;
+    u1* visited = NULL;
+    u2 stack_count = 0;
+    u2 u2Index = 0;
+
+    stack = (u2*)malloc(sizeof(u2) * cfg->blocks_count);
+    cursors = (u2*)malloc(sizeof(u2) * cfg->blocks_count);
+    postorder = (u2*)malloc(sizeof(u2) * cfg->blocks_count);
+    visited = (u1*)calloc(cfg->blocks_count, sizeof(u1));
+    if((stack == NULL) || (cursors == NULL) || (postorder == NULL) || (visited == NULL)) {
+        perror("order_blocks");
+        free(stack);
+        free(cursors);
+        free(postorder);
+        free(visited);
+        return -1;
+    }
+
+    stack[0] = 0;
+    cursors[0] = 0;
+    visited[0] = 1;
+    stack_count = 1;
+    cfg->reachable_count = 0;
+
+    while(stack_count != 0) {
+        cfg_block* block = cfg->blocks + stack[stack_count - 1];
+
+        if(cursors[stack_count - 1] < block->successors_count + block->exception_successors_count) {
+            u2 next = cfg->successors[block->first_successor + cursors[stack_count - 1]++];
+
+            if(!visited[next]) {
+                visited[next] = 1;
+                stack[stack_count] = next;
+                cursors[stack_count++] = 0;
+            }
+        } else
+            postorder[cfg->reachable_count++] = stack[--stack_count];
+    }
+
+    for(; u2Index < cfg->reachable_count; ++u2Index) {
+        cfg->order[u2Index] = postorder[cfg->reachable_count - 1 - u2Index];
+        cfg->blocks[cfg->order[u2Index]].rpo = u2Index;
+    }
+
+    free(stack);
+    free(cursors);
+    free(postorder);
+    free(visited);
+
+    return 0;
+
+}
+
+
+/**
+ * Compute the immediate dominators with the iterative algorithm of Cooper,
+ * Harvey and Kennedy which converges in a few passes over the blocks in
+ * reverse postorder.
+ */
+static void compute_dominators(method_cfg* cfg) {
+
+    char changed = 1;
+
+    cfg->blocks[0].idom = 0;
+
+    while(changed) {
+        u2 u2Index1 = 1;
+
+        changed = 0;
+
+        for(; u2Index1 < cfg->reachable_count; ++u2Index1) {
+            cfg_block* block = cfg->blocks + cfg->order[u2Index1];
+            u2 new_idom = CFG_NONE;
+            u2 u2Index2 = 0;
+
+            for(; u2Index2 < block->predecessors_count + block->exception_predecessors_count; ++u2Index2) {
+                u2 predecessor = cfg->predecessors[block->first_predecessor + u2Index2];
+
+                if(cfg->blocks[predecessor].idom == CFG_NONE)
+                    continue;
+
+                if(new_idom == CFG_NONE)
+                    new_idom = predecessor;
+                else {
+                    u2 finger = predecessor;
+
+                    while(finger != new_idom) {
+                        while(cfg->blocks[finger].rpo > cfg->blocks[new_idom].rpo)
+                            finger = cfg->blocks[finger].idom;
+                        while(cfg->blocks[new_idom].rpo > cfg->blocks[finger].rpo)
+                            new_idom = cfg->blocks[new_idom].idom;
+                    }
+                }
+            }
+
+            if(block->idom != new_idom) {
+                block->idom = new_idom;
+                changed = 1;
+            }
+        }
+    }
+
+    cfg->blocks[0].idom = CFG_NONE;
+
+}
+
+
+/**
+ * Free what was needed to build a graph.
+ */
+static void free_cfg_builder(cfg_builder* builder) {
+
+    free_bytecode_index_map(&builder->index);
+    free(builder->leaders);
+    free(builder->stamps);
+    free(builder->handler_starts);
+    free(builder->handler_ends);
+    free(builder->handler_blocks);
+
+}
+
+
+/**
+ * Split the bytecodes into blocks and link them.
+ */
+static int build_blocks(cfg_builder* builder, method_cfg* cfg) {
+
+    method_info* method = cfg->method;
+    u2 u2Index = 0;
+    u1 u1Index = 0;
+
+    builder->leaders = (u1*)calloc(method->bytecodes_count, sizeof(u1));
+    builder->handler_starts = (u2*)malloc(sizeof(u2) * (method->exception_handlers_count + 1));
+    builder->handler_ends = (u2*)malloc(sizeof(u2) * (method->exception_handlers_count + 1));
+    builder->handler_blocks = (u2*)malloc(sizeof(u2) * (method->exception_handlers_count + 1));
+    if((builder->leaders == NULL) || (builder->handler_starts == NULL) || (builder->handler_ends == NULL) || (builder->handler_blocks == NULL)) {
+        perror("build_blocks");
+        return -1;
+    }
+
+    if((init_bytecode_index_map(&builder->index, method) == -1) || (mark_leaders(builder, method) == -1))
+        return -1;
+
+    for(; u2Index < method->bytecodes_count; ++u2Index)
+        cfg->blocks_count += builder->leaders[u2Index];
+
+    cfg->blocks = (cfg_block*)calloc(cfg->blocks_count, sizeof(cfg_block));
+    cfg->block_of = (u2*)malloc(sizeof(u2) * method->bytecodes_count);
+    cfg->order = (u2*)malloc(sizeof(u2) * cfg->blocks_count);
+    builder->stamps = (u4*)malloc(sizeof(u4) * cfg->blocks_count);
+    if((cfg->blocks == NULL) || (cfg->block_of == NULL) || (cfg->order == NULL) || (builder->stamps == NULL)) {
+        perror("build_blocks");
+        return -1;
+    }
+
+    cfg->blocks_count = 0;
+    for(u2Index = 0; u2Index < method->bytecodes_count; ++u2Index) {
+        if(builder->leaders[u2Index]) {
+            if(cfg->blocks_count != 0)
+                cfg->blocks[cfg->blocks_count - 1].end = u2Index;
+            cfg->blocks[cfg->blocks_count].start = u2Index;
+            cfg->blocks[cfg->blocks_count].idom = CFG_NONE;
+            cfg->blocks[cfg->blocks_count].rpo = CFG_NONE;
+            ++cfg->blocks_count;
+        }
+        cfg->block_of[u2Index] = cfg->blocks_count - 1;
+    }
+    cfg->blocks[cfg->blocks_count - 1].end = method->bytecodes_count;
+
+    for(; u1Index < method->exception_handlers_count; ++u1Index)
+        builder->handler_blocks[u1Index] = cfg->block_of[get_mapped_bytecode_index(&builder->index, method->exception_handlers[u1Index]->handler)];
+
+    if((build_edges(builder, cfg) == -1) || (order_blocks(cfg) == -1))
+        return -1;
+
+    compute_dominators(cfg);
+
+    return 0;
+
+}
+
+
+method_cfg* build_method_cfg(method_info* method) {
+
+    cfg_builder builder = {{0, NULL, NULL}, NULL, NULL, NULL, NULL, NULL};
+    method_cfg* cfg = (method_cfg*)calloc(1, sizeof(method_cfg));
+    if(cfg == NULL) {
+        perror("build_method_cfg");
+        return NULL;
+    }
+
+    cfg->method = method;
+    cfg->bytecodes = method->bytecodes;
+    cfg->bytecodes_count = method->bytecodes_count;
+
+    if(method->bytecodes_count == 0)
+        return cfg;
+
+    if(build_blocks(&builder, cfg) == -1) {
+        free_cfg_builder(&builder);
+        free_method_cfg(cfg);
+        return NULL;
+    }
+
+    free_cfg_builder(&builder);
+
+    return cfg;
+
+}
+
+
+void free_method_cfg(method_cfg* cfg) {
+
+    if(cfg == NULL)
+        return;
+
+    free(cfg->blocks);
+    free(cfg->block_of);
+    free(cfg->successors);
+    free(cfg->predecessors);
+    free(cfg->order);
+    free(cfg);
+
+}
+
+
+int cfg_dominates(const method_cfg* cfg, u2 block1, u2 block2) {
+
+    if(cfg->blocks[block2].rpo == CFG_NONE)
+        return 0;
+
+    for(; block2 != CFG_NONE; block2 = cfg->blocks[block2].idom)
+        if(block2 == block1)
+            return 1;
+
+    return 0;
+
+}
+
+
+cfg_cache* new_cfg_cache(analyzed_cap_file* acf) {
+
+    u2 u2Index = 0;
+    cfg_cache* cache = (cfg_cache*)malloc(sizeof(cfg_cache));
+    if(cache == NULL) {
+        perror("new_cfg_cache");
+        return NULL;
+    }
+
+    cache->acf = acf;
+    cache->classes_count = acf->classes_count;
+    cache->methods_counts = (u2*)malloc(sizeof(u2) * (acf->classes_count + 1));
+    cache->cfgs = (method_cfg***)calloc(acf->classes_count + 1, sizeof(method_cfg**));
+    if((cache->methods_counts == NULL) || (cache->cfgs == NULL)) {
+        perror("new_cfg_cache");
+        cache->classes_count = 0;
+        free_cfg_cache(cache);
+        return NULL;
+    }
+
+    for(; u2Index < acf->classes_count; ++u2Index) {
+        cache->methods_counts[u2Index] = acf->classes[u2Index]->methods_count;
+        cache->cfgs[u2Index] = (method_cfg**)calloc(acf->classes[u2Index]->methods_count + 1, sizeof(method_cfg*));
+        if(cache->cfgs[u2Index] == NULL) {
+            perror("new_cfg_cache");
+            free_cfg_cache(cache);
+            return NULL;
+        }
+    }
+
+    return cache;
+
+}
+
+
+method_cfg* get_method_cfg(cfg_cache* cache, u2 class_index, u2 method_index) {
+
+    method_info* method = NULL;
+    method_cfg* cfg = NULL;
+
+    if((class_index >= cache->classes_count) || (method_index >= cache->methods_counts[class_index])) {
+        fprintf(stderr, "No method %u in class %u\n", method_index, class_index);
+        return NULL;
+    }
+
+    method = cache->acf->classes[class_index]->methods[method_index];
+    cfg = cache->cfgs[class_index][method_index];
+
+    if((cfg != NULL) && ((cfg->method != method) || (cfg->bytecodes != method->bytecodes) || (cfg->bytecodes_count != method->bytecodes_count))) {
+        free_method_cfg(cfg);
+        cfg = NULL;
+    }
+
+    if(cfg == NULL)
+        cfg = build_method_cfg(method);
+
+    cache->cfgs[class_index][method_index] = cfg;
+
+    return cfg;
+
+}
+
+
+void invalidate_method_cfg(cfg_cache* cache, u2 class_index, u2 method_index) {
+
+    if((class_index >= cache->classes_count) || (method_index >= cache->methods_counts[class_index]))
+        return;
+
+    free_method_cfg(cache->cfgs[class_index][method_index]);
+    cache->cfgs[class_index][method_index] = NULL;
+
+}
+
+
+void free_cfg_cache(cfg_cache* cache) {
+
+    u2 u2Index1 = 0;
+
+    if(cache->cfgs != NULL)
+        for(; u2Index1 < cache->classes_count; ++u2Index1) {
+            u2 u2Index2 = 0;
+
+            if(cache->cfgs[u2Index1] == NULL)
+                continue;
+
+            for(; u2Index2 < cache->methods_counts[u2Index1]; ++u2Index2)
+                free_method_cfg(cache->cfgs[u2Index1][u2Index2]);
+
+            free(cache->cfgs[u2Index1]);
+        }
+
+    free(cache->cfgs);
+    free(cache->methods_counts);
+    free(cache);
+
+}
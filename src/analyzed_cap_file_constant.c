@@ -0,0 +1,571 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_constant.c
+ * \brief Fold operations on constants and propagate the value of static
+ * fields which are never written.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_constant.h"
+#include "analyzed_cap_file_edit.h"
+#include "analyzed_cap_file_peephole.h"
+#include "bytecodes.h"
+
+#define FOLD_NONE       0   /**< Nothing was folded. */
+#define FOLD_OPERATION  1   /**< An operation was computed. */
+#define FOLD_BRANCH     2   /**< A branch was turned into a goto or removed. */
+
+
+/**
+ * Decode a push of a short or int constant. Return 1 if the bytecode is one,
+ * 0 else.
+ */
+static char get_push(bytecode_info* bytecode, int32_t* value, char* is_int) {
+
+    u1 opcode = bytecode->opcode;
+
+    *is_int = (opcodes[opcode].flags & OPCODE_INT) != 0;
+
+    if((opcode >= 2) && (opcode <= 8))          /* sconst_m1 to sconst_5 */
+        *value = opcode - 3;
+    else if((opcode >= 9) && (opcode <= 15))    /* iconst_m1 to iconst_5 */
+        *value = opcode - 10;
+    else if((opcode == 16) || (opcode == 18))   /* bspush, bipush */
+        *value = (int8_t)bytecode->args[0];
+    else if((opcode == 17) || (opcode == 19))   /* sspush, sipush */
+        *value = (int16_t)((bytecode->args[0] << 8) | bytecode->args[1]);
+    else if(opcode == 20)                       /* iipush */
+        *value = (int32_t)(((u4)bytecode->args[0] << 24) | ((u4)bytecode->args[1] << 16) | ((u4)bytecode->args[2] << 8) | bytecode->args[3]);
+    else
+        return 0;
+
+    return 1;
+
+}
+
+
+/**
+ * Turn a bytecode into the shortest push of a short or int constant.
+ */
+static void set_push(bytecode_info* bytecode, int32_t value, char is_int) {
+
+    u1 opcode = 0;
+
+    if((value >= -1) && (value <= 5))
+        opcode = (is_int ? 10 : 3) + value;     /* iconst_<n>, sconst_<n> */
+    else if((value >= -128) && (value <= 127))
+        opcode = is_int ? 18 : 16;              /* bipush, bspush */
+    else if((value >= -32768) && (value <= 32767))
+        opcode = is_int ? 19 : 17;              /* sipush, sspush */
+    else
+        opcode = 20;                            /* iipush */
+
+    bytecode->opcode = opcode;
+    bytecode->nb_args = opcodes[opcode].nb_args;
+    bytecode->nb_byte_args = opcodes[opcode].nb_args;
+    bytecode->has_ref = 0;
+    bytecode->ref = NULL;
+    bytecode->has_branch = 0;
+    bytecode->branch = NULL;
+
+    if(bytecode->nb_args == 1) {
+        bytecode->args[0] = value & 0xFF;
+    } else if(bytecode->nb_args == 2) {
+        bytecode->args[0] = (value >> 8) & 0xFF;
+        bytecode->args[1] = value & 0xFF;
+    } else if(bytecode->nb_args == 4) {
+        bytecode->args[0] = (value >> 24) & 0xFF;
+        bytecode->args[1] = (value >> 16) & 0xFF;
+        bytecode->args[2] = (value >> 8) & 0xFF;
+        bytecode->args[3] = value & 0xFF;
+    }
+
+}
+
+
+/**
+ * Check whether the bytecode at the given index exists and is not the
+ * target of a branch or of an exception handler.
+ */
+static char is_untargeted(method_info* method, u2 index) {
+
+    return (index < method->bytecodes_count) && !is_bytecode_target(method, method->bytecodes[index]);
+
+}
+
+
+char compute_operation(u1 opcode, int32_t value1, int32_t value2, int32_t* result) {
+
+    int64_t value = 0;
+    u1 shift = value2 & 0x1F;
+
+    switch((opcode - 65) / 2) {
+        case 0:     /* add */
+            value = (int64_t)value1 + value2;
+            break;
+
+        case 1:     /* sub */
+            value = (int64_t)value1 - value2;
+            break;
+
+        case 2:     /* mul */
+            value = (int64_t)value1 * value2;
+            break;
+
+        case 3:     /* div */
+            if(value2 == 0)
+                return 0;
+            value = (int64_t)value1 / value2;
+            break;
+
+        case 4:     /* rem */
+            if(value2 == 0)
+                return 0;
+            value = (int64_t)value1 % value2;
+            break;
+
+        case 6:     /* shl */
+            value = (u4)value1 << shift;
+            break;
+
+        case 7:     /* shr */
+            value = (int64_t)value1 >> shift;
+            break;
+
+        case 8:     /* ushr, a short is sign extended first */
+            value = (u4)value1 >> shift;
+            break;
+
+        case 9:     /* and */
+            value = value1 & value2;
+            break;
+
+        case 10:    /* or */
+            value = value1 | value2;
+            break;
+
+        case 11:    /* xor */
+            value = value1 ^ value2;
+            break;
+
+        default:
+            return 0;
+    }
+
+    if(opcodes[opcode].flags & OPCODE_INT)
+        *result = (int32_t)(u4)value;
+    else
+        *result = (int16_t)(u2)value;
+
+    return 1;
+
+}
+
+
+/**
+ * Evaluate the condition of if<cond> or if_scmp<cond>, both listing eq, ne,
+ * lt, ge, gt and le in that order.
+ */
+static char test_condition(u1 condition, int32_t value1, int32_t value2) {
+
+    switch(condition) {
+        case 0:
+            return value1 == value2;
+
+        case 1:
+            return value1 != value2;
+
+        case 2:
+            return value1 < value2;
+
+        case 3:
+            return value1 >= value2;
+
+        case 4:
+            return value1 > value2;
+
+        default:
+            return value1 <= value2;
+    }
+
+}
+
+
+/**
+ * Turn the branch following pushes_count pushes at the given index into a
+ * goto if it is taken, remove it else. The pushes are removed.
+ */
+static int fold_branch(method_info* method, u2 index, u2 pushes_count, char is_taken) {
+
+    bytecode_info* branch = method->bytecodes[index + pushes_count];
+
+    if(!is_taken)
+        return remove_bytecodes(method, index, pushes_count + 1);
+
+    branch->opcode = (opcodes[branch->opcode].branch_width == 2) ? 168 : 112;    /* goto_w, goto */
+    branch->nb_args = opcodes[branch->opcode].nb_args;
+
+    return remove_bytecodes(method, index, pushes_count);
+
+}
+
+
+/**
+ * Fold the sequence starting at the given index if it only operates on
+ * constants. Return -1 if an error occurred, else FOLD_*.
+ */
+static int fold_at(method_info* method, u2 index) {
+
+    bytecode_info* next = NULL;
+    int32_t value1 = 0;
+    int32_t value2 = 0;
+    int32_t result = 0;
+    char is_int1 = 0;
+    char is_int2 = 0;
+    u1 opcode = 0;
+
+    if(!is_untargeted(method, index + 1))
+        return FOLD_NONE;
+
+    next = method->bytecodes[index + 1];
+    opcode = (next->opcode >= 152) && (next->opcode <= 167) ? opcodes[next->opcode].counterpart : next->opcode;
+
+    if(method->bytecodes[index]->opcode == 1) {     /* aconst_null */
+        if((opcode == 102) || (opcode == 103))      /* ifnull, ifnonnull */
+            return (fold_branch(method, index, 1, opcode == 102) == -1) ? -1 : FOLD_BRANCH;
+        return FOLD_NONE;
+    }
+
+    if(!get_push(method->bytecodes[index], &value1, &is_int1))
+        return FOLD_NONE;
+
+    switch(opcode) {
+        case 75:    /* sneg */
+        case 76:    /* ineg */
+            if(is_int1 != ((opcodes[opcode].flags & OPCODE_INT) != 0))
+                return FOLD_NONE;
+            set_push(next, is_int1 ? (int32_t)(0 - (u4)value1) : (int16_t)(0 - (u2)value1), is_int1);
+            return (remove_bytecodes(method, index, 1) == -1) ? -1 : FOLD_OPERATION;
+
+        case 91:    /* s2b */
+        case 92:    /* s2i */
+            if(is_int1)
+                return FOLD_NONE;
+            set_push(next, (opcode == 91) ? (int8_t)(u1)value1 : value1, opcode == 92);
+            return (remove_bytecodes(method, index, 1) == -1) ? -1 : FOLD_OPERATION;
+
+        case 93:    /* i2b */
+        case 94:    /* i2s */
+            if(!is_int1)
+                return FOLD_NONE;
+            set_push(next, (opcode == 93) ? (int8_t)(u1)value1 : (int16_t)(u2)value1, 0);
+            return (remove_bytecodes(method, index, 1) == -1) ? -1 : FOLD_OPERATION;
+    }
+
+    if((opcode >= 96) && (opcode <= 101)) {         /* ifeq to ifle */
+        if(is_int1)
+            return FOLD_NONE;
+        return (fold_branch(method, index, 1, test_condition(opcode - 96, value1, 0)) == -1) ? -1 : FOLD_BRANCH;
+    }
+
+    if(!get_push(next, &value2, &is_int2) || !is_untargeted(method, index + 2) || (is_int1 != is_int2))
+        return FOLD_NONE;
+
+    next = method->bytecodes[index + 2];
+    opcode = (next->opcode >= 152) && (next->opcode <= 167) ? opcodes[next->opcode].counterpart : next->opcode;
+
+    if((opcode >= 65) && (opcode <= 88)) {          /* sadd to ixor */
+        if((is_int1 != ((opcodes[opcode].flags & OPCODE_INT) != 0)) || !compute_operation(opcode, value1, value2, &result))
+            return FOLD_NONE;
+        set_push(next, result, is_int1);
+        return (remove_bytecodes(method, index, 2) == -1) ? -1 : FOLD_OPERATION;
+    }
+
+    if(opcode == 95) {                              /* icmp */
+        if(!is_int1)
+            return FOLD_NONE;
+        set_push(next, (value1 > value2) - (value1 < value2), 0);
+        return (remove_bytecodes(method, index, 2) == -1) ? -1 : FOLD_OPERATION;
+    }
+
+    if((opcode >= 106) && (opcode <= 111)) {        /* if_scmpeq to if_scmple */
+        if(is_int1)
+            return FOLD_NONE;
+        return (fold_branch(method, index, 2, test_condition(opcode - 106, value1, value2)) == -1) ? -1 : FOLD_BRANCH;
+    }
+
+    return FOLD_NONE;
+
+}
+
+
+/**
+ * Get the class defining a field, NULL if there is none.
+ */
+static class_info* get_field_class(analyzed_cap_file* acf, field_info* field) {
+
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->fields_count; ++u2Index2)
+            if(acf->classes[u2Index1]->fields[u2Index2] == field)
+                return acf->classes[u2Index1];
+    }
+
+    return NULL;
+
+}
+
+
+/**
+ * Build an array of the internal static fields written by a putstatic of the
+ * package, each field appearing once.
+ */
+static field_info** get_written_static_fields(analyzed_cap_file* acf, u2* count) {
+
+    field_info** fields = NULL;
+    u4 total = 0;
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->fields_count; ++u2Index2)
+            if(acf->classes[u2Index1]->fields[u2Index2]->flags & FIELD_STATIC)
+                ++total;
+    }
+
+    fields = (field_info**)malloc(sizeof(field_info*) * (total + 1));
+    if(fields == NULL) {
+        perror("get_written_static_fields");
+        return NULL;
+    }
+
+    *count = 0;
+
+    for(u2Index1 = 0; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            method_info* method = acf->classes[u2Index1]->methods[u2Index2];
+            u2 u2Index3 = 0;
+
+            for(; u2Index3 < method->bytecodes_count; ++u2Index3) {
+                bytecode_info* bytecode = method->bytecodes[u2Index3];
+                u2 u2Index4 = 0;
+
+                /* putstatic_a to putstatic_i */
+                if((bytecode->opcode < 127) || (bytecode->opcode > 130) || (bytecode->ref->flags & CONSTANT_POOL_IS_EXTERNAL) || (bytecode->ref->internal_field == NULL))
+                    continue;
+
+                while((u2Index4 < *count) && (fields[u2Index4] != bytecode->ref->internal_field))
+                    ++u2Index4;
+
+                if((u2Index4 == *count) && (*count < total))
+                    fields[(*count)++] = bytecode->ref->internal_field;
+            }
+        }
+    }
+
+    return fields;
+
+}
+
+
+/**
+ * Check whether a static field is constant given the static fields written
+ * by the package.
+ */
+static int is_constant_field(analyzed_cap_file* acf, field_info* field, field_info** written_fields, u2 written_fields_count, int32_t* value) {
+
+    class_info* class = get_field_class(acf, field);
+    u2 u2Index = 0;
+
+    if((class == NULL) || !(field->flags & FIELD_STATIC) || (field->type->types->type & (TYPE_DESCRIPTOR_ARRAY|TYPE_DESCRIPTOR_REF)))
+        return 0;
+
+    if(!(field->flags & FIELD_FINAL) && (field->flags & (FIELD_PUBLIC|FIELD_PROTECTED)) && (class->flags & CLASS_PUBLIC))
+        return 0;
+
+    for(; u2Index < written_fields_count; ++u2Index)
+        if(written_fields[u2Index] == field)
+            return 0;
+
+    if(!(field->flags & FIELD_HAS_VALUE) || (field->value == NULL))
+        *value = 0;
+    else if(field->value_size == 1)
+        *value = (int8_t)field->value[0];
+    else if(field->value_size == 2)
+        *value = (int16_t)((field->value[0] << 8) | field->value[1]);
+    else
+        *value = (int32_t)(((u4)field->value[0] << 24) | ((u4)field->value[1] << 16) | ((u4)field->value[2] << 8) | field->value[3]);
+
+    return 1;
+
+}
+
+
+int get_constant_field_value(analyzed_cap_file* acf, field_info* field, int32_t* value) {
+
+    field_info** written_fields = NULL;
+    u2 written_fields_count = 0;
+    int is_constant = 0;
+
+    if((written_fields = get_written_static_fields(acf, &written_fields_count)) == NULL)
+        return 0;
+
+    is_constant = is_constant_field(acf, field, written_fields, written_fields_count, value);
+
+    free(written_fields);
+    return is_constant;
+
+}
+
+
+/**
+ * Compute the size in byte of the bytecodes of a method.
+ */
+static u2 get_bytecodes_size(method_info* method) {
+
+    u2 size = 0;
+    u2 u2Index = 0;
+
+    for(; u2Index < method->bytecodes_count; ++u2Index)
+        size += method->bytecodes[u2Index]->nb_args + 1;
+
+    return size;
+
+}
+
+
+int fold_constants(analyzed_cap_file* acf, constant_report* report) {
+
+    constant_report local_report;
+    field_info** written_fields = NULL;
+    u2 written_fields_count = 0;
+    u2 u2Index1 = 0;
+
+    if(report == NULL)
+        report = &local_report;
+
+    report->constant_fields = 0;
+    report->loads_replaced = 0;
+    report->operations_folded = 0;
+    report->branches_folded = 0;
+    report->bytes_saved = 0;
+
+    if((written_fields = get_written_static_fields(acf, &written_fields_count)) == NULL)
+        return -1;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+        int32_t value = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->fields_count; ++u2Index2)
+            if(is_constant_field(acf, acf->classes[u2Index1]->fields[u2Index2], written_fields, written_fields_count, &value))
+                ++report->constant_fields;
+    }
+
+    for(u2Index1 = 0; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            method_info* method = acf->classes[u2Index1]->methods[u2Index2];
+            u2 old_size = get_bytecodes_size(method);
+            char changed = 1;
+            u2 u2Index3 = 0;
+
+            for(; u2Index3 < method->bytecodes_count; ++u2Index3) {
+                bytecode_info* bytecode = method->bytecodes[u2Index3];
+                int32_t value = 0;
+
+                /* getstatic_b, getstatic_s and getstatic_i ; iipush would be
+                   larger than getstatic_i. */
+                if((bytecode->opcode >= 124) && (bytecode->opcode <= 126) && !(bytecode->ref->flags & CONSTANT_POOL_IS_EXTERNAL) && (bytecode->ref->internal_field != NULL) && is_constant_field(acf, bytecode->ref->internal_field, written_fields, written_fields_count, &value) && (value >= -32768) && (value <= 32767)) {
+                    set_push(bytecode, value, bytecode->opcode == 126);
+                    method->needs_layout = 1;
+                    ++report->loads_replaced;
+                }
+            }
+
+            while(changed) {
+                changed = 0;
+
+                for(u2Index3 = 0; u2Index3 < method->bytecodes_count; ++u2Index3) {
+                    int rc = fold_at(method, u2Index3);
+
+                    if(rc == -1) {
+                        free(written_fields);
+                        return -1;
+                    }
+
+                    if(rc == FOLD_OPERATION)
+                        ++report->operations_folded;
+                    else if(rc == FOLD_BRANCH)
+                        ++report->branches_folded;
+
+                    if(rc != FOLD_NONE) {
+                        changed = 1;
+                        method->needs_layout = 1;
+                    }
+                }
+            }
+
+            method->bytecodes_size = get_bytecodes_size(method);
+            if(method->bytecodes_size < old_size)
+                report->bytes_saved += old_size - method->bytecodes_size;
+        }
+    }
+
+    free(written_fields);
+
+    if(report->loads_replaced || report->operations_folded || report->branches_folded)
+        acf->dirty_components |= COMPONENT_BIT(COMPONENT_METHOD);
+
+    return 0;
+
+}
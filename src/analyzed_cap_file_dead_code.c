@@ -0,0 +1,612 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_dead_code.c
+ * \brief Remove the methods, fields, constant pool entries and signature pool
+ * entries of an analyzed CAP file that can never be used.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "cap_file.h"
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_dead_code.h"
+#include "cap_file_analyze.h"
+
+#define MEMBER_DEAD     0   /**< Not reached yet. */
+#define MEMBER_LIVE     1   /**< Reached but its bytecodes were not scanned. */
+#define MEMBER_SCANNED  2   /**< Reached and its bytecodes were scanned. */
+
+
+/**
+ * Liveness of the methods and fields of each class.
+ */
+typedef struct {
+    u1** methods;       /**< One MEMBER_* per method of each class. */
+    u1** fields;        /**< One MEMBER_* per field of each class. */
+    char keep_virtual;  /**< An unresolved virtual method reference was met. */
+    char keep_fields;   /**< An unresolved field reference was met. */
+} liveness_info;
+
+
+/**
+ * Return 1 if the package of the analyzed CAP file is exported, else 0.
+ */
+static char is_exported(analyzed_cap_file* acf) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < acf->classes_count; ++u2Index)
+        if(acf->classes[u2Index]->flags & CLASS_APPLET)
+            break;
+
+    if(u2Index != acf->classes_count) {
+        for(u2Index = 0; u2Index < acf->interfaces_count; ++u2Index)
+            if(acf->interfaces[u2Index]->flags & INTERFACE_SHAREABLE)
+                return 1;
+    } else {
+        for(u2Index = 0; u2Index < acf->interfaces_count; ++u2Index)
+            if(acf->interfaces[u2Index]->flags & INTERFACE_PUBLIC)
+                return 1;
+
+        for(u2Index = 0; u2Index < acf->classes_count; ++u2Index)
+            if(acf->classes[u2Index]->flags & CLASS_PUBLIC)
+                return 1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Get the liveness of a class method, NULL for interface methods.
+ */
+static u1* get_method_state(analyzed_cap_file* acf, liveness_info* liveness, method_info* method) {
+
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2)
+            if(acf->classes[u2Index1]->methods[u2Index2] == method)
+                return liveness->methods[u2Index1] + u2Index2;
+    }
+
+    return NULL;
+
+}
+
+
+/**
+ * Get the liveness of a field.
+ */
+static u1* get_field_state(analyzed_cap_file* acf, liveness_info* liveness, field_info* field) {
+
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->fields_count; ++u2Index2)
+            if(acf->classes[u2Index1]->fields[u2Index2] == field)
+                return liveness->fields[u2Index1] + u2Index2;
+    }
+
+    return NULL;
+
+}
+
+
+/**
+ * Mark a method as live. Return 1 if it was not, else 0.
+ */
+static char mark_method(analyzed_cap_file* acf, liveness_info* liveness, method_info* method) {
+
+    u1* state = get_method_state(acf, liveness, method);
+
+    if((state == NULL) || (*state != MEMBER_DEAD))
+        return 0;
+
+    *state = MEMBER_LIVE;
+
+    return 1;
+
+}
+
+
+/**
+ * Mark a field as live. Return 1 if it was not, else 0.
+ */
+static char mark_field(analyzed_cap_file* acf, liveness_info* liveness, field_info* field) {
+
+    u1* state = get_field_state(acf, liveness, field);
+
+    if((state == NULL) || (*state != MEMBER_DEAD))
+        return 0;
+
+    *state = MEMBER_LIVE;
+
+    return 1;
+
+}
+
+
+/**
+ * Mark the virtual methods with the given token in a class and its internal
+ * superclasses. Return 1 if one was not live, else 0.
+ */
+static char mark_virtual_methods(analyzed_cap_file* acf, liveness_info* liveness, class_info* class, u1 token) {
+
+    char changed = 0;
+
+    while(class != NULL) {
+        u2 u2Index = 0;
+
+        for(; u2Index < class->methods_count; ++u2Index)
+            if(!(class->methods[u2Index]->flags & (METHOD_STATIC|METHOD_INIT)) && (class->methods[u2Index]->token == token))
+                changed |= mark_method(acf, liveness, class->methods[u2Index]);
+
+        if((class->superclass == NULL) || (class->superclass->flags & CONSTANT_POOL_IS_EXTERNAL))
+            break;
+
+        class = class->superclass->internal_class;
+    }
+
+    return changed;
+
+}
+
+
+/**
+ * Mark what a constant pool entry used by a live method refers to. Return 1
+ * if something was not live, else 0.
+ */
+static char mark_constant_pool_entry(analyzed_cap_file* acf, liveness_info* liveness, constant_pool_entry_info* entry) {
+
+    char changed = 0;
+
+    if(entry->flags & CONSTANT_POOL_IS_EXTERNAL)
+        return 0;
+
+    if(entry->flags & (CONSTANT_POOL_VIRTUALMETHODREF|CONSTANT_POOL_SUPERMETHODREF|CONSTANT_POOL_STATICMETHODREF)) {
+        if(entry->internal_method != NULL)
+            changed |= mark_method(acf, liveness, entry->internal_method);
+
+        /* A super method call runs the method of a superclass having the same token. */
+        if((entry->flags & CONSTANT_POOL_SUPERMETHODREF) && (entry->internal_class != NULL) && entry->internal_class->superclass && !(entry->internal_class->superclass->flags & CONSTANT_POOL_IS_EXTERNAL))
+            changed |= mark_virtual_methods(acf, liveness, entry->internal_class->superclass->internal_class, entry->method_token);
+
+        if((entry->internal_method == NULL) && !(entry->flags & CONSTANT_POOL_STATICMETHODREF) && !liveness->keep_virtual) {
+            liveness->keep_virtual = 1;
+            changed = 1;
+        }
+    } else if(entry->flags & (CONSTANT_POOL_INSTANCEFIELDREF|CONSTANT_POOL_STATICFIELDREF)) {
+        if(entry->internal_field != NULL)
+            changed |= mark_field(acf, liveness, entry->internal_field);
+        else if(!liveness->keep_fields) {
+            liveness->keep_fields = 1;
+            changed = 1;
+        }
+    }
+
+    return changed;
+
+}
+
+
+/**
+ * Mark the methods and fields reachable from outside of the package.
+ */
+static void mark_roots(analyzed_cap_file* acf, liveness_info* liveness) {
+
+    char exported = is_exported(acf);
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        class_info* class = acf->classes[u2Index1];
+        u2 u2Index2 = 0;
+        u1 u1Index1 = 0;
+
+        if(class->install_method != NULL)
+            mark_method(acf, liveness, class->install_method);
+
+        for(; u1Index1 < class->interfaces_count; ++u1Index1) {
+            u1 u1Index2 = 0;
+
+            for(; u1Index2 < class->interfaces[u1Index1].count; ++u1Index2)
+                if(class->interfaces[u1Index1].index[u1Index2].implementation != NULL)
+                    mark_method(acf, liveness, class->interfaces[u1Index1].index[u1Index2].implementation);
+        }
+
+        for(; u2Index2 < class->methods_count; ++u2Index2) {
+            /* Overriding a method we cannot see means it might be called from another package. */
+            if(class->methods[u2Index2]->is_overriding && (class->methods[u2Index2]->internal_overrided_method == NULL))
+                liveness->methods[u2Index1][u2Index2] = MEMBER_LIVE;
+
+            if(exported && (class->flags & CLASS_PUBLIC) && (class->methods[u2Index2]->flags & (METHOD_PUBLIC|METHOD_PROTECTED)))
+                liveness->methods[u2Index1][u2Index2] = MEMBER_LIVE;
+        }
+
+        for(u2Index2 = 0; u2Index2 < class->fields_count; ++u2Index2)
+            if(exported && (class->flags & CLASS_PUBLIC) && (class->fields[u2Index2]->flags & (FIELD_PUBLIC|FIELD_PROTECTED)))
+                liveness->fields[u2Index1][u2Index2] = MEMBER_LIVE;
+    }
+
+}
+
+
+/**
+ * Propagate liveness through the bytecodes of live methods and through
+ * overriding until nothing changes.
+ */
+static void mark_reachable(analyzed_cap_file* acf, liveness_info* liveness) {
+
+    char changed = 1;
+
+    while(changed) {
+        u2 u2Index1 = 0;
+
+        changed = 0;
+
+        for(; u2Index1 < acf->classes_count; ++u2Index1) {
+            u2 u2Index2 = 0;
+
+            for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+                method_info* method = acf->classes[u2Index1]->methods[u2Index2];
+                u1* state = liveness->methods[u2Index1] + u2Index2;
+                u2 u2Index3 = 0;
+
+                if(*state == MEMBER_DEAD) {
+                    if(liveness->keep_virtual && !(method->flags & (METHOD_STATIC|METHOD_INIT)))
+                        *state = MEMBER_LIVE;
+                    else if(method->internal_overrided_method != NULL) {
+                        u1* overrided_state = get_method_state(acf, liveness, method->internal_overrided_method);
+
+                        if((overrided_state != NULL) && (*overrided_state != MEMBER_DEAD))
+                            *state = MEMBER_LIVE;
+                    }
+                }
+
+                if(*state != MEMBER_LIVE)
+                    continue;
+
+                *state = MEMBER_SCANNED;
+                changed = 1;
+
+                /* The token of an overriding method comes from the overrided one. */
+                if(method->internal_overrided_method != NULL)
+                    mark_method(acf, liveness, method->internal_overrided_method);
+
+                for(; u2Index3 < method->bytecodes_count; ++u2Index3)
+                    if(method->bytecodes[u2Index3]->has_ref)
+                        changed |= mark_constant_pool_entry(acf, liveness, method->bytecodes[u2Index3]->ref);
+            }
+        }
+    }
+
+}
+
+
+/**
+ * Return 1 if a constant pool entry refers to a removed method or field,
+ * else 0.
+ */
+static char is_dead_constant_pool_entry(analyzed_cap_file* acf, liveness_info* liveness, constant_pool_entry_info* entry) {
+
+    u1* state = NULL;
+
+    if(entry->flags & CONSTANT_POOL_IS_EXTERNAL)
+        return 0;
+
+    if((entry->flags & (CONSTANT_POOL_VIRTUALMETHODREF|CONSTANT_POOL_SUPERMETHODREF|CONSTANT_POOL_STATICMETHODREF)) && (entry->internal_method != NULL))
+        state = get_method_state(acf, liveness, entry->internal_method);
+    else if((entry->flags & (CONSTANT_POOL_INSTANCEFIELDREF|CONSTANT_POOL_STATICFIELDREF)) && (entry->internal_field != NULL))
+        state = get_field_state(acf, liveness, entry->internal_field);
+
+    return (state != NULL) && (*state == MEMBER_DEAD);
+
+}
+
+
+/**
+ * Remove the constant pool entries referring to removed methods or fields.
+ */
+static u2 remove_dead_constant_pool_entries(analyzed_cap_file* acf, liveness_info* liveness) {
+
+    u2 u2Index = 0;
+    u2 kept = 0;
+    u2 removed = 0;
+
+    for(; u2Index < acf->constant_pool_count; ++u2Index)
+        if(!is_dead_constant_pool_entry(acf, liveness, acf->constant_pool[u2Index])) {
+            acf->constant_pool[kept] = acf->constant_pool[u2Index];
+            acf->constant_pool[kept]->my_index = kept;
+            ++kept;
+        } else {
+            free(acf->constant_pool[u2Index]);
+        }
+
+    removed = acf->constant_pool_count - kept;
+    acf->constant_pool_count = kept;
+
+    return removed;
+
+}
+
+
+/**
+ * Remove the exception handlers of removed methods. The handlers of each
+ * method are filtered before those of the analyzed CAP file are freed.
+ */
+static void remove_dead_exception_handlers(analyzed_cap_file* acf, liveness_info* liveness) {
+
+    u2 u2Index1 = 0;
+    u1 u1Index = 0;
+    u1 kept = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            method_info* method = acf->classes[u2Index1]->methods[u2Index2];
+
+            kept = 0;
+
+            for(u1Index = 0; u1Index < method->exception_handlers_count; ++u1Index) {
+                u1* state = get_method_state(acf, liveness, method->exception_handlers[u1Index]->try_in);
+
+                if((state == NULL) || (*state != MEMBER_DEAD))
+                    method->exception_handlers[kept++] = method->exception_handlers[u1Index];
+            }
+
+            method->exception_handlers_count = kept;
+        }
+    }
+
+    kept = 0;
+
+    for(u1Index = 0; u1Index < acf->exception_handlers_count; ++u1Index) {
+        u1* state = get_method_state(acf, liveness, acf->exception_handlers[u1Index]->try_in);
+
+        if((state == NULL) || (*state != MEMBER_DEAD)) {
+            acf->exception_handlers[kept] = acf->exception_handlers[u1Index];
+            acf->exception_handlers[kept]->my_index = kept;
+            ++kept;
+        } else {
+            free(acf->exception_handlers[u1Index]);
+        }
+    }
+
+    acf->exception_handlers_count = kept;
+
+}
+
+
+/**
+ * Remove the dead methods and fields of each class.
+ */
+static void remove_dead_members(analyzed_cap_file* acf, liveness_info* liveness, dead_code_report* report) {
+
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        class_info* class = acf->classes[u2Index1];
+        u2 u2Index2 = 0;
+        u2 kept = 0;
+
+        for(; u2Index2 < class->methods_count; ++u2Index2)
+            if(liveness->methods[u2Index1][u2Index2] != MEMBER_DEAD)
+                class->methods[kept++] = class->methods[u2Index2];
+            else
+                free_method(class->methods[u2Index2]);
+
+        report->methods_removed += class->methods_count - kept;
+        class->methods_count = kept;
+
+        kept = 0;
+
+        for(u2Index2 = 0; u2Index2 < class->fields_count; ++u2Index2)
+            if(liveness->fields[u2Index1][u2Index2] != MEMBER_DEAD)
+                class->fields[kept++] = class->fields[u2Index2];
+            else
+                free_field(class->fields[u2Index2]);
+
+        report->fields_removed += class->fields_count - kept;
+        class->fields_count = kept;
+    }
+
+}
+
+
+/**
+ * Mark a type descriptor of the signature pool as used.
+ */
+static void mark_type(analyzed_cap_file* acf, char* used, type_descriptor_info* type) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < acf->signature_pool_count; ++u2Index)
+        if(acf->signature_pool[u2Index] == type) {
+            used[u2Index] = 1;
+            return;
+        }
+
+}
+
+
+/**
+ * Remove the signature pool entries used neither by the constant pool nor
+ * by a field or a method.
+ */
+static int remove_dead_signature_pool_entries(analyzed_cap_file* acf, dead_code_report* report) {
+
+    char* used = NULL;
+    u2 u2Index1 = 0;
+    u2 kept = 0;
+
+    if(acf->signature_pool_count == 0)
+        return 0;
+
+    used = (char*)calloc(acf->signature_pool_count, sizeof(char));
+    if(used == NULL) {
+        perror("remove_dead_signature_pool_entries");
+        return -1;
+    }
+
+    for(; u2Index1 < acf->constant_pool_count; ++u2Index1)
+        if(!(acf->constant_pool[u2Index1]->flags & CONSTANT_POOL_CLASSREF))
+            mark_type(acf, used, acf->constant_pool[u2Index1]->type);
+
+    for(u2Index1 = 0; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->fields_count; ++u2Index2)
+            mark_type(acf, used, acf->classes[u2Index1]->fields[u2Index2]->type);
+
+        for(u2Index2 = 0; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2)
+            mark_type(acf, used, acf->classes[u2Index1]->methods[u2Index2]->signature);
+    }
+
+    for(u2Index1 = 0; u2Index1 < acf->interfaces_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->interfaces[u2Index1]->methods_count; ++u2Index2)
+            mark_type(acf, used, acf->interfaces[u2Index1]->methods[u2Index2]->signature);
+    }
+
+    for(u2Index1 = 0; u2Index1 < acf->signature_pool_count; ++u2Index1)
+        if(used[u2Index1])
+            acf->signature_pool[kept++] = acf->signature_pool[u2Index1];
+        else
+            free_type_descriptor(acf->signature_pool[u2Index1]);
+
+    report->signature_pool_entries_removed = acf->signature_pool_count - kept;
+    acf->signature_pool_count = kept;
+
+    free(used);
+
+    return 0;
+
+}
+
+
+/**
+ * Free the liveness arrays.
+ */
+static void free_liveness(analyzed_cap_file* acf, liveness_info* liveness) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < acf->classes_count; ++u2Index) {
+        if(liveness->methods != NULL)
+            free(liveness->methods[u2Index]);
+        if(liveness->fields != NULL)
+            free(liveness->fields[u2Index]);
+    }
+
+    free(liveness->methods);
+    free(liveness->fields);
+
+}
+
+
+int remove_dead_code(analyzed_cap_file* acf, dead_code_report* report) {
+
+    liveness_info liveness;
+    dead_code_report local_report;
+    u2 u2Index = 0;
+
+    if(report == NULL)
+        report = &local_report;
+
+    report->methods_removed = 0;
+    report->fields_removed = 0;
+    report->constant_pool_entries_removed = 0;
+    report->signature_pool_entries_removed = 0;
+
+    liveness.keep_virtual = 0;
+    liveness.keep_fields = 0;
+    liveness.methods = (u1**)calloc(acf->classes_count + 1, sizeof(u1*));
+    liveness.fields = (u1**)calloc(acf->classes_count + 1, sizeof(u1*));
+    if((liveness.methods == NULL) || (liveness.fields == NULL)) {
+        perror("remove_dead_code");
+        free_liveness(acf, &liveness);
+        return -1;
+    }
+
+    for(; u2Index < acf->classes_count; ++u2Index) {
+        liveness.methods[u2Index] = (u1*)calloc(acf->classes[u2Index]->methods_count + 1, sizeof(u1));
+        liveness.fields[u2Index] = (u1*)calloc(acf->classes[u2Index]->fields_count + 1, sizeof(u1));
+        if((liveness.methods[u2Index] == NULL) || (liveness.fields[u2Index] == NULL)) {
+            perror("remove_dead_code");
+            free_liveness(acf, &liveness);
+            return -1;
+        }
+    }
+
+    mark_roots(acf, &liveness);
+    mark_reachable(acf, &liveness);
+
+    if(liveness.keep_fields)
+        for(u2Index = 0; u2Index < acf->classes_count; ++u2Index) {
+            u2 u2Index2 = 0;
+
+            for(; u2Index2 < acf->classes[u2Index]->fields_count; ++u2Index2)
+                liveness.fields[u2Index][u2Index2] = MEMBER_LIVE;
+        }
+
+    report->constant_pool_entries_removed = remove_dead_constant_pool_entries(acf, &liveness);
+    remove_dead_exception_handlers(acf, &liveness);
+    remove_dead_members(acf, &liveness, report);
+    free_liveness(acf, &liveness);
+
+    if(remove_dead_signature_pool_entries(acf, report) == -1)
+        return -1;
+
+    if(report->methods_removed || report->fields_removed || report->constant_pool_entries_removed || report->signature_pool_entries_removed)
+        acf->dirty_components |= COMPONENT_BIT(COMPONENT_CONSTANTPOOL)|COMPONENT_BIT(COMPONENT_CLASS)|COMPONENT_BIT(COMPONENT_METHOD)|COMPONENT_BIT(COMPONENT_STATICFIELD)|COMPONENT_BIT(COMPONENT_DESCRIPTOR);
+
+    return 0;
+
+}
@@ -0,0 +1,722 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_edit.c
+ * \brief Insert, remove and replace analyzed bytecodes while keeping
+ * branches, switches and exception handlers consistent.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_edit.h"
+#include "bytecodes.h"
+
+/**
+ * \brief Where the bytecodes of a method go once the edits are applied.
+ */
+typedef struct {
+    u2 old_count;               /**< The number of bytecodes before the
+                                     edits. */
+    bytecode_info** sorted;     /**< The bytecodes before the edits sorted by
+                                     address. */
+    u2* sorted_indexes;         /**< The index of each sorted bytecode. */
+    u1* removed;                /**< Whether each bytecode is removed. */
+    u2* targets;                /**< For each bytecode, the index of the new
+                                     bytecode what referred to it now refers
+                                     to, bytecodes_count meaning the end of
+                                     the method. */
+    u2 bytecodes_count;         /**< The number of bytecodes after the
+                                     edits. */
+    bytecode_info** bytecodes;  /**< The bytecodes after the edits. */
+    u1* inserted;               /**< Whether each new bytecode is inserted. */
+} edit_layout;
+
+
+bytecode_info* new_bytecode(u1 opcode) {
+
+    const opcode_info* info = &opcodes[opcode];
+    bytecode_info* bytecode = NULL;
+
+    if(info->format == OPCODE_FORMAT_INVALID) {
+        fprintf(stderr, "Invalid opcode %u\n", opcode);
+        return NULL;
+    }
+
+    bytecode = (bytecode_info*)calloc(1, sizeof(bytecode_info));
+    if(bytecode == NULL) {
+        perror("new_bytecode");
+        return NULL;
+    }
+
+    bytecode->opcode = opcode;
+    bytecode->nb_args = info->nb_args;
+
+    switch(info->format) {
+        case OPCODE_FORMAT_BYTES:
+            bytecode->nb_byte_args = info->nb_args;
+            break;
+
+        case OPCODE_FORMAT_BRANCH:
+            bytecode->has_branch = 1;
+            break;
+
+        case OPCODE_FORMAT_REF:
+            bytecode->has_ref = 1;
+            break;
+
+        case OPCODE_FORMAT_TYPE_REF:    /* checkcast & instanceof of a class */
+            bytecode->nb_byte_args = 1;
+            bytecode->has_ref = 1;
+            break;
+
+        case OPCODE_FORMAT_INVOKEINTERFACE:
+            bytecode->nb_byte_args = 2;
+            bytecode->has_ref = 1;
+            break;
+    }
+
+    return bytecode;
+
+}
+
+
+/**
+ * Redirect a reference to a removed bytecode. A NULL replacement means the end
+ * of the method which only an exception handler end can refer to.
+ */
+static int redirect(bytecode_info** target, bytecode_info** removed, u2 count, bytecode_info* replacement, char may_be_end) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < count; ++u2Index)
+        if(*target == removed[u2Index]) {
+            if((replacement == NULL) && !may_be_end) {
+                fprintf(stderr, "A removed bytecode at the end of a method is still referred to\n");
+                return -1;
+            }
+
+            *target = replacement;
+            return 0;
+        }
+
+    return 0;
+
+}
+
+
+void free_bytecode(bytecode_info* bytecode) {
+
+    if(bytecode->switch_data != NULL) {
+        switch(opcodes[bytecode->opcode].format) {
+            case OPCODE_FORMAT_STABLESWITCH:
+                free(bytecode->switch_data->stableswitch.branches);
+                break;
+
+            case OPCODE_FORMAT_ITABLESWITCH:
+                free(bytecode->switch_data->itableswitch.branches);
+                break;
+
+            case OPCODE_FORMAT_SLOOKUPSWITCH:
+                free(bytecode->switch_data->slookupswitch.cases);
+                break;
+
+            case OPCODE_FORMAT_ILOOKUPSWITCH:
+                free(bytecode->switch_data->ilookupswitch.cases);
+                break;
+        }
+
+        free(bytecode->switch_data);
+    }
+
+    free(bytecode);
+
+}
+
+
+int remove_bytecodes(method_info* method, u2 index, u2 count) {
+
+    bytecode_info** removed = method->bytecodes + index;
+    bytecode_info* replacement = NULL;
+    u2 u2Index1 = 0;
+    u1 u1Index = 0;
+
+    if((count == 0) || (index + count > method->bytecodes_count))
+        return -1;
+
+    if(index + count < method->bytecodes_count)
+        replacement = method->bytecodes[index + count];
+
+    for(; u1Index < method->exception_handlers_count; ++u1Index) {
+        exception_handler_info* handler = method->exception_handlers[u1Index];
+
+        if((redirect(&(handler->start), removed, count, replacement, 0) == -1) || (redirect(&(handler->end), removed, count, replacement, 1) == -1) || (redirect(&(handler->handler), removed, count, replacement, 0) == -1))
+            return -1;
+    }
+
+    for(; u2Index1 < method->bytecodes_count; ++u2Index1) {
+        bytecode_info* crt = method->bytecodes[u2Index1];
+        switch_info* data = crt->switch_data;
+        u2 u2Index2 = 0;
+
+        if((u2Index1 >= index) && (u2Index1 < index + count))
+            continue;
+
+        if(crt->has_branch && (redirect(&(crt->branch), removed, count, replacement, 0) == -1))
+            return -1;
+
+        if(data == NULL)
+            continue;
+
+        switch(opcodes[crt->opcode].format) {
+            case OPCODE_FORMAT_STABLESWITCH:
+                if(redirect(&(data->stableswitch.default_branch), removed, count, replacement, 0) == -1)
+                    return -1;
+                for(; u2Index2 < data->stableswitch.nb_cases; ++u2Index2)
+                    if(redirect(&(data->stableswitch.branches[u2Index2]), removed, count, replacement, 0) == -1)
+                        return -1;
+                break;
+
+            case OPCODE_FORMAT_ITABLESWITCH:
+                if(redirect(&(data->itableswitch.default_branch), removed, count, replacement, 0) == -1)
+                    return -1;
+                for(; u2Index2 < data->itableswitch.nb_cases; ++u2Index2)
+                    if(redirect(&(data->itableswitch.branches[u2Index2]), removed, count, replacement, 0) == -1)
+                        return -1;
+                break;
+
+            case OPCODE_FORMAT_SLOOKUPSWITCH:
+                if(redirect(&(data->slookupswitch.default_branch), removed, count, replacement, 0) == -1)
+                    return -1;
+                for(; u2Index2 < data->slookupswitch.nb_cases; ++u2Index2)
+                    if(redirect(&(data->slookupswitch.cases[u2Index2].branch), removed, count, replacement, 0) == -1)
+                        return -1;
+                break;
+
+            case OPCODE_FORMAT_ILOOKUPSWITCH:
+                if(redirect(&(data->ilookupswitch.default_branch), removed, count, replacement, 0) == -1)
+                    return -1;
+                for(; u2Index2 < data->ilookupswitch.nb_cases; ++u2Index2)
+                    if(redirect(&(data->ilookupswitch.cases[u2Index2].branch), removed, count, replacement, 0) == -1)
+                        return -1;
+                break;
+        }
+    }
+
+    for(u2Index1 = 0; u2Index1 < count; ++u2Index1)
+        free_bytecode(removed[u2Index1]);
+
+    for(u2Index1 = index; u2Index1 + count < method->bytecodes_count; ++u2Index1)
+        method->bytecodes[u2Index1] = method->bytecodes[u2Index1 + count];
+
+    method->bytecodes_count -= count;
+    method->needs_layout = 1;
+
+    return 0;
+
+}
+
+
+void init_bytecode_editor(bytecode_editor* editor, method_info* method) {
+
+    editor->method = method;
+    editor->edits_count = 0;
+    editor->edits_capacity = 0;
+    editor->edits = NULL;
+
+}
+
+
+/**
+ * Record an edit. The array of inserted bytecodes is copied.
+ */
+static int add_edit(bytecode_editor* editor, u1 kind, u2 index, u2 count, bytecode_info** bytecodes, char retarget, u2 span) {
+
+    bytecode_edit* edit = NULL;
+
+    /* Edits are recorded by the hundred when instrumenting so the array
+       grows geometrically. */
+    if(editor->edits_count == editor->edits_capacity) {
+        u4 capacity = (editor->edits_capacity == 0) ? 16 : editor->edits_capacity * 2;
+        bytecode_edit* tmp = (bytecode_edit*)realloc(editor->edits, sizeof(bytecode_edit) * capacity);
+        if(tmp == NULL) {
+            perror("add_edit");
+            return -1;
+        }
+        editor->edits = tmp;
+        editor->edits_capacity = capacity;
+    }
+
+    edit = &editor->edits[editor->edits_count];
+
+    edit->bytecodes = NULL;
+    if(bytecodes != NULL) {
+        edit->bytecodes = (bytecode_info**)malloc(sizeof(bytecode_info*) * count);
+        if(edit->bytecodes == NULL) {
+            perror("add_edit");
+            return -1;
+        }
+        memcpy(edit->bytecodes, bytecodes, sizeof(bytecode_info*) * count);
+    }
+
+    edit->kind = kind;
+    edit->retarget = retarget != 0;
+    edit->index = index;
+    edit->count = count;
+    edit->span = span;
+    edit->order = editor->edits_count++;
+
+    return 0;
+
+}
+
+
+int edit_insert_before(bytecode_editor* editor, u2 index, bytecode_info** bytecodes, u2 count, char retarget) {
+
+    if((count == 0) || (index > editor->method->bytecodes_count))
+        return -1;
+
+    return add_edit(editor, BYTECODE_EDIT_INSERT_BEFORE, index, count, bytecodes, retarget, 0);
+
+}
+
+
+int edit_insert_after(bytecode_editor* editor, u2 index, bytecode_info** bytecodes, u2 count) {
+
+    if((count == 0) || (index >= editor->method->bytecodes_count))
+        return -1;
+
+    return add_edit(editor, BYTECODE_EDIT_INSERT_AFTER, index, count, bytecodes, 0, 0);
+
+}
+
+
+int edit_remove(bytecode_editor* editor, u2 index, u2 count) {
+
+    if((count == 0) || ((u4)index + count > editor->method->bytecodes_count))
+        return -1;
+
+    return add_edit(editor, BYTECODE_EDIT_REMOVE, index, count, NULL, 0, 0);
+
+}
+
+
+int edit_replace(bytecode_editor* editor, u2 index, u2 count, bytecode_info** bytecodes, u2 new_count) {
+
+    if(edit_remove(editor, index, count) == -1)
+        return -1;
+
+    if(new_count == 0)
+        return 0;
+
+    if(add_edit(editor, BYTECODE_EDIT_INSERT_BEFORE, index, new_count, bytecodes, 1, count) == -1) {
+        --editor->edits_count;
+        return -1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Sort edits by bytecode index, then insertions before, removals and
+ * insertions after, then in the order they were recorded.
+ */
+static int compare_edits(const void* edit1, const void* edit2) {
+
+    const bytecode_edit* e1 = (const bytecode_edit*)edit1;
+    const bytecode_edit* e2 = (const bytecode_edit*)edit2;
+
+    if(e1->index != e2->index)
+        return (e1->index > e2->index) - (e1->index < e2->index);
+
+    if(e1->kind != e2->kind)
+        return (e1->kind > e2->kind) - (e1->kind < e2->kind);
+
+    return (e1->order > e2->order) - (e1->order < e2->order);
+
+}
+
+
+/**
+ * Compare two bytecodes by address.
+ */
+static int compare_bytecode_addresses(const void* bytecode1, const void* bytecode2) {
+
+    uintptr_t address1 = (uintptr_t)*(bytecode_info* const*)bytecode1;
+    uintptr_t address2 = (uintptr_t)*(bytecode_info* const*)bytecode2;
+
+    return (address1 > address2) - (address1 < address2);
+
+}
+
+
+/**
+ * Free what was allocated to lay out the edited method.
+ */
+static void free_edit_layout(edit_layout* layout) {
+
+    free(layout->sorted);
+    free(layout->sorted_indexes);
+    free(layout->removed);
+    free(layout->targets);
+    free(layout->bytecodes);
+    free(layout->inserted);
+
+}
+
+
+/**
+ * Compute the bytecodes of the method once the sorted edits are applied and
+ * where the references to the former ones go.
+ */
+static int init_edit_layout(edit_layout* layout, bytecode_editor* editor) {
+
+    method_info* method = editor->method;
+    u4 new_count = method->bytecodes_count;
+    u4 u4Index = 0;
+    u4 crt_edit = 0;
+    u4 forced_until = 0;
+    u2 forced_index = 0;
+    u2 crt_index = 0;
+    u2 u2Index = 0;
+
+    layout->old_count = method->bytecodes_count;
+    layout->sorted = (bytecode_info**)malloc(sizeof(bytecode_info*) * (method->bytecodes_count + 1));
+    layout->sorted_indexes = (u2*)malloc(sizeof(u2) * (method->bytecodes_count + 1));
+    layout->removed = (u1*)calloc(method->bytecodes_count + 1, sizeof(u1));
+    layout->targets = (u2*)malloc(sizeof(u2) * (method->bytecodes_count + 1));
+    layout->bytecodes = NULL;
+    layout->inserted = NULL;
+    if((layout->sorted == NULL) || (layout->sorted_indexes == NULL) || (layout->removed == NULL) || (layout->targets == NULL)) {
+        perror("init_edit_layout");
+        return -1;
+    }
+
+    for(u4Index = 0; u4Index < editor->edits_count; ++u4Index) {
+        bytecode_edit* edit = &editor->edits[u4Index];
+
+        if(edit->kind != BYTECODE_EDIT_REMOVE) {
+            new_count += edit->count;
+            continue;
+        }
+
+        for(u2Index = edit->index; u2Index < edit->index + edit->count; ++u2Index) {
+            if(layout->removed[u2Index]) {
+                fprintf(stderr, "Bytecode %u is removed twice\n", u2Index);
+                return -1;
+            }
+            layout->removed[u2Index] = 1;
+        }
+
+        new_count -= edit->count;
+    }
+
+    if(new_count > 0xFFFF) {
+        fprintf(stderr, "An edited method cannot have more than 65535 bytecodes\n");
+        return -1;
+    }
+
+    layout->bytecodes_count = new_count;
+    layout->bytecodes = (bytecode_info**)malloc(sizeof(bytecode_info*) * (new_count + 1));
+    layout->inserted = (u1*)malloc(sizeof(u1) * (new_count + 1));
+    if((layout->bytecodes == NULL) || (layout->inserted == NULL)) {
+        perror("init_edit_layout");
+        return -1;
+    }
+
+    for(u4Index = 0; u4Index <= method->bytecodes_count; ++u4Index) {
+        char has_retarget = 0;
+        u2 retarget_index = 0;
+
+        for(; (crt_edit < editor->edits_count) && (editor->edits[crt_edit].index == u4Index) && (editor->edits[crt_edit].kind == BYTECODE_EDIT_INSERT_BEFORE); ++crt_edit) {
+            bytecode_edit* edit = &editor->edits[crt_edit];
+
+            if(edit->retarget && !has_retarget) {
+                has_retarget = 1;
+                retarget_index = crt_index;
+            }
+
+            /* Replaced bytecodes all go to the first new one. */
+            if(edit->span != 0) {
+                forced_index = crt_index;
+                forced_until = u4Index + edit->span;
+            }
+
+            for(u2Index = 0; u2Index < edit->count; ++u2Index) {
+                layout->bytecodes[crt_index] = edit->bytecodes[u2Index];
+                layout->inserted[crt_index++] = 1;
+            }
+        }
+
+        while((crt_edit < editor->edits_count) && (editor->edits[crt_edit].index == u4Index) && (editor->edits[crt_edit].kind == BYTECODE_EDIT_REMOVE))
+            ++crt_edit;
+
+        if(u4Index == method->bytecodes_count)
+            break;
+
+        /* A removed bytecode goes to whatever follows it. */
+        if(has_retarget)
+            layout->targets[u4Index] = retarget_index;
+        else if(u4Index < forced_until)
+            layout->targets[u4Index] = forced_index;
+        else
+            layout->targets[u4Index] = crt_index;
+
+        if(!layout->removed[u4Index]) {
+            layout->bytecodes[crt_index] = method->bytecodes[u4Index];
+            layout->inserted[crt_index++] = 0;
+        }
+
+        for(; (crt_edit < editor->edits_count) && (editor->edits[crt_edit].index == u4Index) && (editor->edits[crt_edit].kind == BYTECODE_EDIT_INSERT_AFTER); ++crt_edit)
+            for(u2Index = 0; u2Index < editor->edits[crt_edit].count; ++u2Index) {
+                layout->bytecodes[crt_index] = editor->edits[crt_edit].bytecodes[u2Index];
+                layout->inserted[crt_index++] = 1;
+            }
+    }
+
+    for(u2Index = 0; u2Index < method->bytecodes_count; ++u2Index)
+        layout->sorted[u2Index] = method->bytecodes[u2Index];
+
+    qsort(layout->sorted, method->bytecodes_count, sizeof(bytecode_info*), compare_bytecode_addresses);
+
+    for(u2Index = 0; u2Index < method->bytecodes_count; ++u2Index) {
+        bytecode_info** found = (bytecode_info**)bsearch(&method->bytecodes[u2Index], layout->sorted, method->bytecodes_count, sizeof(bytecode_info*), compare_bytecode_addresses);
+        layout->sorted_indexes[found - layout->sorted] = u2Index;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Check, and set if apply, where a reference to a bytecode goes once the
+ * edits are applied. References from inserted bytecodes are kept as given.
+ */
+static int fix_reference(edit_layout* layout, bytecode_info** target, char from_inserted, char may_be_end, char apply) {
+
+    bytecode_info** found = NULL;
+    u2 index = 0;
+
+    if(*target == NULL)
+        return 0;
+
+    found = (bytecode_info**)bsearch(target, layout->sorted, layout->old_count, sizeof(bytecode_info*), compare_bytecode_addresses);
+    if(found == NULL)
+        return 0;
+
+    index = layout->sorted_indexes[found - layout->sorted];
+
+    if(from_inserted) {
+        if(layout->removed[index]) {
+            fprintf(stderr, "An inserted bytecode refers to a removed one\n");
+            return -1;
+        }
+        return 0;
+    }
+
+    if(layout->targets[index] == layout->bytecodes_count) {
+        if(!may_be_end) {
+            fprintf(stderr, "A removed bytecode at the end of a method is still referred to\n");
+            return -1;
+        }
+
+        if(apply)
+            *target = NULL;
+        return 0;
+    }
+
+    if(apply)
+        *target = layout->bytecodes[layout->targets[index]];
+
+    return 0;
+
+}
+
+
+/**
+ * Check, and fix if apply, the branches of a bytecode.
+ */
+static int fix_bytecode_references(edit_layout* layout, bytecode_info* bytecode, char from_inserted, char apply) {
+
+    switch_info* data = bytecode->switch_data;
+    u2 u2Index = 0;
+
+    if(bytecode->has_branch && (fix_reference(layout, &(bytecode->branch), from_inserted, 0, apply) == -1))
+        return -1;
+
+    if(data == NULL)
+        return 0;
+
+    switch(opcodes[bytecode->opcode].format) {
+        case OPCODE_FORMAT_STABLESWITCH:
+            if(fix_reference(layout, &(data->stableswitch.default_branch), from_inserted, 0, apply) == -1)
+                return -1;
+            for(; u2Index < data->stableswitch.nb_cases; ++u2Index)
+                if(fix_reference(layout, &(data->stableswitch.branches[u2Index]), from_inserted, 0, apply) == -1)
+                    return -1;
+            break;
+
+        case OPCODE_FORMAT_ITABLESWITCH:
+            if(fix_reference(layout, &(data->itableswitch.default_branch), from_inserted, 0, apply) == -1)
+                return -1;
+            for(; u2Index < data->itableswitch.nb_cases; ++u2Index)
+                if(fix_reference(layout, &(data->itableswitch.branches[u2Index]), from_inserted, 0, apply) == -1)
+                    return -1;
+            break;
+
+        case OPCODE_FORMAT_SLOOKUPSWITCH:
+            if(fix_reference(layout, &(data->slookupswitch.default_branch), from_inserted, 0, apply) == -1)
+                return -1;
+            for(; u2Index < data->slookupswitch.nb_cases; ++u2Index)
+                if(fix_reference(layout, &(data->slookupswitch.cases[u2Index].branch), from_inserted, 0, apply) == -1)
+                    return -1;
+            break;
+
+        case OPCODE_FORMAT_ILOOKUPSWITCH:
+            if(fix_reference(layout, &(data->ilookupswitch.default_branch), from_inserted, 0, apply) == -1)
+                return -1;
+            for(; u2Index < data->ilookupswitch.nb_cases; ++u2Index)
+                if(fix_reference(layout, &(data->ilookupswitch.cases[u2Index].branch), from_inserted, 0, apply) == -1)
+                    return -1;
+            break;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Check, and fix if apply, every reference to a bytecode of the method.
+ */
+static int fix_references(edit_layout* layout, method_info* method, char apply) {
+
+    u2 u2Index = 0;
+    u1 u1Index = 0;
+
+    for(; u2Index < layout->bytecodes_count; ++u2Index)
+        if(fix_bytecode_references(layout, layout->bytecodes[u2Index], layout->inserted[u2Index], apply) == -1)
+            return -1;
+
+    for(; u1Index < method->exception_handlers_count; ++u1Index) {
+        exception_handler_info* handler = method->exception_handlers[u1Index];
+
+        if((fix_reference(layout, &(handler->start), 0, 0, apply) == -1) || (fix_reference(layout, &(handler->end), 0, 1, apply) == -1) || (fix_reference(layout, &(handler->handler), 0, 0, apply) == -1))
+            return -1;
+    }
+
+    return 0;
+
+}
+
+
+int commit_bytecode_edits(bytecode_editor* editor) {
+
+    method_info* method = editor->method;
+    edit_layout layout;
+    u4 u4Index = 0;
+    u2 u2Index = 0;
+
+    if(editor->edits_count == 0)
+        return 0;
+
+    qsort(editor->edits, editor->edits_count, sizeof(bytecode_edit), compare_edits);
+
+    /* Every reference is checked before any is changed so that the method is
+       left untouched on error. */
+    if((init_edit_layout(&layout, editor) == -1) || (fix_references(&layout, method, 0) == -1)) {
+        free_edit_layout(&layout);
+        return -1;
+    }
+
+    fix_references(&layout, method, 1);
+
+    for(; u2Index < method->bytecodes_count; ++u2Index)
+        if(layout.removed[u2Index])
+            free_bytecode(method->bytecodes[u2Index]);
+
+    free(method->bytecodes);
+    method->bytecodes = layout.bytecodes;
+    method->bytecodes_count = layout.bytecodes_count;
+    layout.bytecodes = NULL;
+
+    method->bytecodes_size = 0;
+    for(u2Index = 0; u2Index < method->bytecodes_count; ++u2Index)
+        method->bytecodes_size += method->bytecodes[u2Index]->nb_args + 1;
+    method->needs_layout = 1;
+
+    for(; u4Index < editor->edits_count; ++u4Index)
+        free(editor->edits[u4Index].bytecodes);
+    editor->edits_count = 0;
+
+    free_edit_layout(&layout);
+
+    return 0;
+
+}
+
+
+void free_bytecode_editor(bytecode_editor* editor) {
+
+    u4 u4Index = 0;
+
+    for(; u4Index < editor->edits_count; ++u4Index) {
+        u2 u2Index = 0;
+
+        for(; u2Index < editor->edits[u4Index].count; ++u2Index)
+            if(editor->edits[u4Index].bytecodes != NULL)
+                free_bytecode(editor->edits[u4Index].bytecodes[u2Index]);
+
+        free(editor->edits[u4Index].bytecodes);
+    }
+
+    free(editor->edits);
+    editor->edits = NULL;
+    editor->edits_count = 0;
+    editor->edits_capacity = 0;
+
+}
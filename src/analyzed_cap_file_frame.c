@@ -0,0 +1,576 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_frame.c
+ * \brief Compute the frame of analyzed methods (max_stack, nargs and
+ * max_locals) from their bytecodes.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_frame.h"
+#include "analyzed_cap_file_cfg.h"
+#include "bytecodes.h"
+#include "exp_file.h"
+
+/**
+ * Get the number of words of one type (0 for void).
+ */
+static u1 get_type_words(one_type_descriptor_info* type) {
+
+    if(type->type == TYPE_DESCRIPTOR_VOID)
+        return 0;
+
+    if(type->type == TYPE_DESCRIPTOR_INT)
+        return 2;
+
+    return 1;
+
+}
+
+
+u1 get_signature_words(type_descriptor_info* signature, u1* return_words) {
+
+    u1 u1Index = 0;
+    u1 words = 0;
+
+    if(signature->types_count == 0) {
+        if(return_words != NULL)
+            *return_words = 0;
+        return 0;
+    }
+
+    /* The return type comes last. */
+    for(; u1Index < signature->types_count - 1; ++u1Index)
+        words += get_type_words(signature->types + u1Index);
+
+    if(return_words != NULL)
+        *return_words = get_type_words(signature->types + signature->types_count - 1);
+
+    return words;
+
+}
+
+
+type_descriptor_info* get_interface_method_signature(interface_info* interface, u1 token) {
+
+    u2 u2Index = 0;
+    u1 u1Index = 0;
+
+    for(; u2Index < interface->methods_count; ++u2Index)
+        if(interface->methods[u2Index]->token == token)
+            return interface->methods[u2Index]->signature;
+
+    for(; u1Index < interface->superinterfaces_count; ++u1Index)
+        if(!(interface->superinterfaces[u1Index]->flags & CONSTANT_POOL_IS_EXTERNAL) && (interface->superinterfaces[u1Index]->internal_interface != NULL))
+            for(u2Index = 0; u2Index < interface->superinterfaces[u1Index]->internal_interface->methods_count; ++u2Index)
+                if(interface->superinterfaces[u1Index]->internal_interface->methods[u2Index]->token == token)
+                    return interface->superinterfaces[u1Index]->internal_interface->methods[u2Index]->signature;
+
+    return NULL;
+
+}
+
+
+ef_cp_info* get_export_method_descriptor(export_file* ef, u1 class_token, u1 token) {
+
+    u1 u1Index = 0;
+
+    if(ef == NULL)
+        return NULL;
+
+    for(; u1Index < ef->export_class_count; ++u1Index) {
+        if(ef->classes[u1Index].token == class_token) {
+            u2 u2Index = 0;
+
+            for(; u2Index < ef->classes[u1Index].export_methods_count; ++u2Index)
+                if(ef->classes[u1Index].methods[u2Index].token == token)
+                    return ef->constant_pool + ef->classes[u1Index].methods[u2Index].descriptor_index;
+
+            return NULL;
+        }
+    }
+
+    return NULL;
+
+}
+
+
+/**
+ * Get the number of words returned by an external interface method from its
+ * descriptor in the export file. Return -1 if it is not found.
+ */
+static int get_external_interface_method_return_words(export_file* ef, u1 class_token, u1 token) {
+
+    ef_cp_info* descriptor = get_export_method_descriptor(ef, class_token, token);
+    u2 u2Index = 0;
+
+    if(descriptor == NULL)
+        return -1;
+
+    /* The return type follows the closing parenthesis. */
+    for(; u2Index + 1 < descriptor->CONSTANT_Utf8.length; ++u2Index)
+        if(descriptor->CONSTANT_Utf8.bytes[u2Index] == ')') {
+            if(descriptor->CONSTANT_Utf8.bytes[u2Index + 1] == 'V')
+                return 0;
+            if(descriptor->CONSTANT_Utf8.bytes[u2Index + 1] == 'I')
+                return 2;
+            return 1;
+        }
+
+    return -1;
+
+}
+
+
+/**
+ * Get the number of words returned by the interface method called by an
+ * invokeinterface. Return -1 if the method is not found.
+ */
+static int get_interface_method_return_words(bytecode_info* bytecode) {
+
+    u1 return_words = 0;
+
+    if(bytecode->ref->flags & CONSTANT_POOL_IS_EXTERNAL)
+        return get_external_interface_method_return_words(bytecode->ref->external_package->ef, bytecode->ref->external_class_token, bytecode->args[1]);
+
+    if(bytecode->ref->internal_interface != NULL) {
+        type_descriptor_info* signature = get_interface_method_signature(bytecode->ref->internal_interface, bytecode->args[1]);
+
+        if(signature != NULL) {
+            get_signature_words(signature, &return_words);
+            return return_words;
+        }
+    }
+
+    return -1;
+
+}
+
+
+int get_stack_effect(bytecode_info* bytecode, u1* pops, u1* pushes) {
+
+    const opcode_info* opcode = opcodes + bytecode->opcode;
+    u1 return_words = 0;
+    u1 m = 0;
+    u1 n = 0;
+    int words = 0;
+
+    if(opcode->format == OPCODE_FORMAT_INVALID) {
+        fprintf(stderr, "Invalid opcode %u\n", bytecode->opcode);
+        return -1;
+    }
+
+    if(opcode->pops != OPCODE_VARIABLE_STACK) {
+        *pops = opcode->pops;
+        *pushes = opcode->pushes;
+        return 0;
+    }
+
+    switch(bytecode->opcode) {
+        case 63: /* dup_x */
+            m = bytecode->args[0] >> 4;
+            n = bytecode->args[0] & 0x0F;
+            if(n == 0) {
+                *pops = m;
+                *pushes = m * 2;
+            } else {
+                *pops = n;
+                *pushes = n + m;
+            }
+            return 0;
+
+        case 64: /* swap_x */
+            m = bytecode->args[0] >> 4;
+            n = bytecode->args[0] & 0x0F;
+            *pops = m + n;
+            *pushes = m + n;
+            return 0;
+
+        case 142: /* invokeinterface */
+            /* nargs already counts the object reference. */
+            *pops = bytecode->args[0];
+
+            if((words = get_interface_method_return_words(bytecode)) == -1) {
+                fprintf(stderr, "Unknown interface method %u for invokeinterface\n", bytecode->args[1]);
+                return -1;
+            }
+
+            *pushes = words;
+            return 0;
+
+        default: /* invokevirtual, invokespecial and invokestatic */
+            if((bytecode->ref == NULL) || (bytecode->ref->type == NULL)) {
+                fprintf(stderr, "Missing signature for %s\n", opcode->mnemonic);
+                return -1;
+            }
+
+            *pops = get_signature_words(bytecode->ref->type, &return_words);
+            *pushes = return_words;
+
+            if(bytecode->opcode != 141)
+                ++*pops;
+            return 0;
+    }
+
+}
+
+
+int has_known_stack_effects(method_info* method) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < method->bytecodes_count; ++u2Index) {
+        bytecode_info* bytecode = method->bytecodes[u2Index];
+
+        if((bytecode->opcode == 142) && (get_interface_method_return_words(bytecode) == -1))
+            return 0;
+    }
+
+    return 1;
+
+}
+
+
+/**
+ * Get the local variable used by a bytecode and its width in words. Return 1
+ * if a local variable is used, else 0.
+ */
+static char get_used_local(bytecode_info* bytecode, u1* local, u1* width) {
+
+    u1 opcode = bytecode->opcode;
+    u1 kind = 0;
+
+    if(get_local_access(bytecode, &kind, local) != LOCAL_ACCESS_NONE) {
+        *width = (kind == LOCAL_INT) ? 2 : 1;
+        return 1;
+    }
+
+    if(opcode == 114) {    /* ret */
+        *local = bytecode->args[0];
+        *width = 1;
+        return 1;
+    }
+
+    if(opcodes[opcode].flags & OPCODE_THIS) {
+        *local = 0;
+        *width = 1;
+        return 1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Set the stack depth of a bytecode if it is not known yet. Return 1 if it
+ * changed, 0 if it did not and -1 if an error occurred, including when the
+ * bytecode is reached with another depth.
+ */
+static int merge_depth(const bytecode_index_map* map, int16_t* depths, bytecode_info* target, int16_t depth) {
+
+    u2 index = get_mapped_bytecode_index(map, target);
+
+    if(index == CFG_NONE) {
+        fprintf(stderr, "Branch target outside of its method\n");
+        return -1;
+    }
+
+    if(depth > 255) {
+        fprintf(stderr, "Operand stack deeper than 255 words\n");
+        return -1;
+    }
+
+    if(depths[index] == depth)
+        return 0;
+
+    if(depths[index] != STACK_DEPTH_UNREACHED) {
+        fprintf(stderr, "Operand stack depth %d and %d at %s\n", depths[index], depth, opcodes[target->opcode].mnemonic);
+        return -1;
+    }
+
+    depths[index] = depth;
+
+    return 1;
+
+}
+
+
+/**
+ * Propagate the stack depth of a bytecode to its successors. Return 1 if a
+ * depth changed, 0 if none did and -1 if an error occurred.
+ */
+static int propagate_depth(method_info* method, const bytecode_index_map* map, int16_t* depths, u2 index, int16_t after) {
+
+    bytecode_info* bytecode = method->bytecodes[index];
+    int changed = 0;
+    int rc = 0;
+    u2 u2Index = 0;
+
+    /* jsr pushes the return address for the subroutine only. */
+    if(!(opcodes[bytecode->opcode].flags & OPCODE_UNCONDITIONAL)) {
+        if(index + 1 >= method->bytecodes_count) {
+            fprintf(stderr, "Execution falls off the end of the method\n");
+            return -1;
+        }
+        if((rc = merge_depth(map, depths, method->bytecodes[index + 1], (bytecode->opcode == 113) ? depths[index] : after)) == -1)
+            return -1;
+        changed |= rc;
+    }
+
+    if(bytecode->has_branch) {
+        if((rc = merge_depth(map, depths, bytecode->branch, after)) == -1)
+            return -1;
+        changed |= rc;
+    }
+
+    switch(bytecode->opcode) {
+        case 115:
+            if((rc = merge_depth(map, depths, bytecode->switch_data->stableswitch.default_branch, after)) == -1)
+                return -1;
+            changed |= rc;
+            for(; u2Index < bytecode->switch_data->stableswitch.nb_cases; ++u2Index) {
+                if((rc = merge_depth(map, depths, bytecode->switch_data->stableswitch.branches[u2Index], after)) == -1)
+                    return -1;
+                changed |= rc;
+            }
+            break;
+
+        case 116:
+            if((rc = merge_depth(map, depths, bytecode->switch_data->itableswitch.default_branch, after)) == -1)
+                return -1;
+            changed |= rc;
+            for(; u2Index < bytecode->switch_data->itableswitch.nb_cases; ++u2Index) {
+                if((rc = merge_depth(map, depths, bytecode->switch_data->itableswitch.branches[u2Index], after)) == -1)
+                    return -1;
+                changed |= rc;
+            }
+            break;
+
+        case 117:
+            if((rc = merge_depth(map, depths, bytecode->switch_data->slookupswitch.default_branch, after)) == -1)
+                return -1;
+            changed |= rc;
+            for(; u2Index < bytecode->switch_data->slookupswitch.nb_cases; ++u2Index) {
+                if((rc = merge_depth(map, depths, bytecode->switch_data->slookupswitch.cases[u2Index].branch, after)) == -1)
+                    return -1;
+                changed |= rc;
+            }
+            break;
+
+        case 118:
+            if((rc = merge_depth(map, depths, bytecode->switch_data->ilookupswitch.default_branch, after)) == -1)
+                return -1;
+            changed |= rc;
+            for(; u2Index < bytecode->switch_data->ilookupswitch.nb_cases; ++u2Index) {
+                if((rc = merge_depth(map, depths, bytecode->switch_data->ilookupswitch.cases[u2Index].branch, after)) == -1)
+                    return -1;
+                changed |= rc;
+            }
+            break;
+    }
+
+    return changed;
+
+}
+
+
+/**
+ * Compute the stack depths of a method whose bytecode indexes are mapped.
+ */
+static int propagate_depths(method_info* method, const bytecode_index_map* map, int16_t* depths, u1* max_stack) {
+
+    int16_t max_depth = 0;
+    int changed = 1;
+    u2 u2Index = 0;
+    u1 u1Index = 0;
+
+    for(; u2Index < method->bytecodes_count; ++u2Index)
+        depths[u2Index] = STACK_DEPTH_UNREACHED;
+
+    depths[0] = 0;
+
+    /* An exception handler starts with the thrown object on the stack. */
+    for(; u1Index < method->exception_handlers_count; ++u1Index)
+        if(merge_depth(map, depths, method->exception_handlers[u1Index]->handler, 1) == -1)
+            return -1;
+
+    while(changed) {
+        changed = 0;
+
+        for(u2Index = 0; u2Index < method->bytecodes_count; ++u2Index) {
+            u1 pops = 0;
+            u1 pushes = 0;
+            int16_t after = 0;
+            int rc = 0;
+
+            if(depths[u2Index] == STACK_DEPTH_UNREACHED)
+                continue;
+
+            if(get_stack_effect(method->bytecodes[u2Index], &pops, &pushes) == -1)
+                return -1;
+
+            if(depths[u2Index] < pops) {
+                fprintf(stderr, "Operand stack underflow at %s\n", opcodes[method->bytecodes[u2Index]->opcode].mnemonic);
+                return -1;
+            }
+
+            after = depths[u2Index] - pops + pushes;
+
+            if(depths[u2Index] > max_depth)
+                max_depth = depths[u2Index];
+            if(after > max_depth)
+                max_depth = after;
+
+            if((rc = propagate_depth(method, map, depths, u2Index, after)) == -1)
+                return -1;
+
+            if(rc)
+                changed = 1;
+        }
+    }
+
+    if(max_depth > 255) {
+        fprintf(stderr, "Operand stack deeper than 255 words\n");
+        return -1;
+    }
+
+    *max_stack = max_depth;
+
+    return 0;
+
+}
+
+
+int compute_stack_depths(method_info* method, int16_t* depths, u1* max_stack) {
+
+    bytecode_index_map map = {0, NULL, NULL};
+    int rc = 0;
+
+    *max_stack = 0;
+
+    if(method->bytecodes_count == 0)
+        return 0;
+
+    if(init_bytecode_index_map(&map, method) == 0)
+        rc = propagate_depths(method, &map, depths, max_stack);
+    else
+        rc = -1;
+
+    free_bytecode_index_map(&map);
+
+    return rc;
+
+}
+
+
+int compute_method_frame(method_info* method) {
+
+    u2 nargs = get_signature_words(method->signature, NULL);
+    u2 nb_locals = 0;
+    u2 u2Index = 0;
+    u1 max_stack = 0;
+
+    if(!(method->flags & METHOD_STATIC))
+        ++nargs;
+
+    nb_locals = nargs;
+
+    for(; u2Index < method->bytecodes_count; ++u2Index) {
+        u1 local = 0;
+        u1 width = 0;
+
+        if(get_used_local(method->bytecodes[u2Index], &local, &width) && (local + width > nb_locals))
+            nb_locals = local + width;
+    }
+
+    if((nargs > 255) || (nb_locals - nargs > 255)) {
+        fprintf(stderr, "Too many local variables\n");
+        return -1;
+    }
+
+    if(!(method->flags & METHOD_ABSTRACT) && (method->bytecodes_count != 0)) {
+        int16_t* depths = (int16_t*)malloc(sizeof(int16_t) * method->bytecodes_count);
+        if(depths == NULL) {
+            perror("compute_method_frame");
+            return -1;
+        }
+
+        if(compute_stack_depths(method, depths, &max_stack) == -1) {
+            free(depths);
+            return -1;
+        }
+
+        free(depths);
+    }
+
+    method->max_stack = max_stack;
+    method->nargs = nargs;
+    method->max_locals = nb_locals - nargs;
+
+    if((method->max_stack > 15) || (method->nargs > 15) || (method->max_locals > 15))
+        method->flags |= METHOD_EXTENDED;
+    else
+        method->flags &= ~METHOD_EXTENDED;
+
+    return 0;
+
+}
+
+
+int compute_frames(analyzed_cap_file* acf) {
+
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2)
+            if(compute_method_frame(acf->classes[u2Index1]->methods[u2Index2]) == -1)
+                return -1;
+    }
+
+    return 0;
+
+}
@@ -0,0 +1,534 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_inline.c
+ * \brief Replace calls to small internal static and private methods by a copy
+ * of their bytecodes.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_inline.h"
+#include "analyzed_cap_file_frame.h"
+#include "analyzed_cap_file_edit.h"
+#include "analyzed_cap_file_peephole.h"
+#include "bytecodes.h"
+#include "cap_file_analyze.h"
+
+#define ORIGIN_PARAMETER    -1  /**< Stores or pops a parameter. */
+#define ORIGIN_RETURN       -2  /**< Replaces a return of the callee. */
+
+
+/**
+ * Check whether a method uses a local variable, for writing only if
+ * only_stores is true.
+ */
+static char uses_local(method_info* method, u1 local, char only_stores) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < method->bytecodes_count; ++u2Index) {
+        u1 kind = 0;
+        u1 crt_local = 0;
+        u1 access = get_local_access(method->bytecodes[u2Index], &kind, &crt_local);
+
+        if((access != LOCAL_ACCESS_NONE) && (!only_stores || (access != LOCAL_ACCESS_LOAD))) {
+            u1 width = (kind == LOCAL_INT) ? 2 : 1;
+
+            if((crt_local <= local) && (local < crt_local + width))
+                return 1;
+        }
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Check that each reachable return of a method leaves only the returned
+ * value on the stack. Return -1 if an error occurred, 1 if so, 0 else.
+ */
+static int returns_with_empty_stack(method_info* method) {
+
+    int16_t* depths = NULL;
+    u1 max_stack = 0;
+    u2 u2Index = 0;
+
+    depths = (int16_t*)malloc(sizeof(int16_t) * method->bytecodes_count);
+    if(depths == NULL) {
+        perror("returns_with_empty_stack");
+        return -1;
+    }
+
+    if(compute_stack_depths(method, depths, &max_stack) == -1) {
+        free(depths);
+        return -1;
+    }
+
+    for(; u2Index < method->bytecodes_count; ++u2Index) {
+        u1 opcode = method->bytecodes[u2Index]->opcode;
+
+        if((opcode >= 119) && (opcode <= 122) && (depths[u2Index] != STACK_DEPTH_UNREACHED) && (depths[u2Index] != opcodes[opcode].pops)) {
+            free(depths);
+            return 0;
+        }
+    }
+
+    free(depths);
+
+    return 1;
+
+}
+
+
+/**
+ * Get the method called by the bytecode at the given index if it can be
+ * inlined. Return NULL if it cannot.
+ */
+static method_info* get_inlinable_callee(class_info* class, method_info* caller, u2 index, u2 max_callee_size) {
+
+    bytecode_info* bytecode = caller->bytecodes[index];
+    method_info* callee = NULL;
+    u2 u2Index = 0;
+
+    if(((bytecode->opcode != 140) && (bytecode->opcode != 141)) || !bytecode->has_ref || (index + 1 == caller->bytecodes_count))
+        return NULL;
+
+    if((bytecode->ref->flags & (CONSTANT_POOL_STATICMETHODREF|CONSTANT_POOL_IS_EXTERNAL)) != CONSTANT_POOL_STATICMETHODREF)
+        return NULL;
+
+    callee = bytecode->ref->internal_method;
+
+    if((callee == NULL) || (callee == caller) || (callee->flags & (METHOD_ABSTRACT|METHOD_INIT)) || (callee->bytecodes_count == 0) || (callee->bytecodes_size > max_callee_size) || (callee->exception_handlers_count != 0))
+        return NULL;
+
+    if((caller->bytecodes_size + callee->bytecodes_size) > 0x7FFF)
+        return NULL;
+
+    /* The callee might use members only its own class can access. */
+    for(; u2Index < class->methods_count; ++u2Index)
+        if(class->methods[u2Index] == callee)
+            break;
+
+    if(u2Index == class->methods_count)
+        return NULL;
+
+    if(bytecode->opcode == 141) {
+        if(!(callee->flags & METHOD_STATIC))
+            return NULL;
+    } else {
+        /* The receiver must be this so the callee this is the caller one. */
+        if(!(callee->flags & METHOD_PRIVATE) || (callee->flags & METHOD_STATIC) || (caller->flags & METHOD_STATIC))
+            return NULL;
+
+        /* Another path to the call might push another receiver. */
+        if((index == 0) || (caller->bytecodes[index - 1]->opcode != 24) || is_bytecode_target(caller, bytecode) || (get_signature_words(callee->signature, NULL) != 0))
+            return NULL;
+
+        if(uses_local(callee, 0, 1))
+            return NULL;
+    }
+
+    for(u2Index = 0; u2Index < callee->bytecodes_count; ++u2Index) {
+        u1 opcode = callee->bytecodes[u2Index]->opcode;
+
+        /* Subroutines and switches are not copied. */
+        if((opcode >= 113) && (opcode <= 118))
+            return NULL;
+
+        if((opcodes[opcode].flags & OPCODE_THIS) && (bytecode->opcode == 141))
+            return NULL;
+    }
+
+    return callee;
+
+}
+
+
+/**
+ * Free what inline_call allocated.
+ */
+static void free_inlined(bytecode_info** inlined, u2 count, bytecode_info** map, int* origins) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < count; ++u2Index)
+        free(inlined[u2Index]);
+
+    free(inlined);
+    free(map);
+    free(origins);
+
+}
+
+
+/**
+ * Replace the call at the given index by the bytecodes of the callee.
+ */
+static int inline_call(method_info* caller, u2 index, method_info* callee, u2* inlined_count) {
+
+    bytecode_info* invoke = caller->bytecodes[index];
+    bytecode_info* continuation = caller->bytecodes[index + 1];
+    bytecode_info* first = NULL;
+    bytecode_info** inlined = NULL;
+    bytecode_info** map = NULL;
+    bytecode_info** tmp = NULL;
+    int* origins = NULL;
+    char is_special = (invoke->opcode == 140);
+    u2 count = 0;
+    u2 base = 0;
+    u2 offset = 0;
+    u2 u2Index = 0;
+    u1 params_count = callee->signature->types_count - 1;
+    u1 u1Index = 0;
+
+    *inlined_count = 0;
+
+    if((compute_method_frame(caller) == -1) || (compute_method_frame(callee) == -1))
+        return -1;
+
+    base = caller->nargs + caller->max_locals;
+    if(base + callee->nargs + callee->max_locals > 255)
+        return 0;
+
+    inlined = (bytecode_info**)calloc(params_count + 1 + callee->bytecodes_count, sizeof(bytecode_info*));
+    map = (bytecode_info**)calloc(callee->bytecodes_count, sizeof(bytecode_info*));
+    origins = (int*)calloc(params_count + 1 + callee->bytecodes_count, sizeof(int));
+    if((inlined == NULL) || (map == NULL) || (origins == NULL)) {
+        perror("inline_call");
+        free_inlined(inlined, 0, map, origins);
+        return -1;
+    }
+
+    /* Parameters are on the stack, the last one on top. */
+    if(is_special) {
+        if((inlined[count] = new_bytecode(59)) == NULL) {
+            free_inlined(inlined, count, map, origins);
+            return -1;
+        }
+        origins[count++] = ORIGIN_PARAMETER;
+    } else {
+        offset = get_signature_words(callee->signature, NULL);
+
+        for(u1Index = params_count; u1Index-- > 0;) {
+            one_type_descriptor_info* type = callee->signature->types + u1Index;
+            u1 width = ((type->type == TYPE_DESCRIPTOR_INT) ? 2 : 1);
+
+            offset -= width;
+
+            if(uses_local(callee, offset, 0)) {
+                u1 kind = (type->type & (TYPE_DESCRIPTOR_REF|TYPE_DESCRIPTOR_ARRAY)) ? LOCAL_REFERENCE : ((type->type == TYPE_DESCRIPTOR_INT) ? LOCAL_INT : LOCAL_SHORT);
+
+                if((inlined[count] = new_bytecode(40 + kind)) == NULL) {
+                    free_inlined(inlined, count, map, origins);
+                    return -1;
+                }
+                set_local_access(inlined[count], base + offset);
+            } else if((inlined[count] = new_bytecode((width == 2) ? 60 : 59)) == NULL) {
+                free_inlined(inlined, count, map, origins);
+                return -1;
+            }
+
+            origins[count++] = ORIGIN_PARAMETER;
+        }
+    }
+
+    for(u2Index = 0; u2Index < callee->bytecodes_count; ++u2Index) {
+        bytecode_info* bytecode = callee->bytecodes[u2Index];
+        u1 kind = 0;
+        u1 local = 0;
+
+        if((bytecode->opcode >= 119) && (bytecode->opcode <= 122)) {
+            /* The returned value is left on the stack for the caller. */
+            if(u2Index + 1 == callee->bytecodes_count) {
+                map[u2Index] = continuation;
+                continue;
+            }
+
+            if((inlined[count] = new_bytecode(112)) == NULL) {
+                free_inlined(inlined, count, map, origins);
+                return -1;
+            }
+            inlined[count]->branch = continuation;
+            origins[count] = ORIGIN_RETURN;
+        } else {
+            if((inlined[count] = (bytecode_info*)calloc(1, sizeof(bytecode_info))) == NULL) {
+                perror("inline_call");
+                free_inlined(inlined, count, map, origins);
+                return -1;
+            }
+            *inlined[count] = *bytecode;
+
+            if(get_local_access(bytecode, &kind, &local) != LOCAL_ACCESS_NONE)
+                set_local_access(inlined[count], (is_special && (local == 0)) ? 0 : base + local);
+
+            origins[count] = u2Index;
+        }
+
+        map[u2Index] = inlined[count++];
+    }
+
+    if(count == 0) {
+        free_inlined(inlined, count, map, origins);
+        return remove_bytecodes(caller, index, 1);
+    }
+
+    /* The call itself becomes the first inlined bytecode so that branches
+       and exception handlers referring to it are kept. */
+    first = inlined[0];
+    *invoke = *first;
+    for(u2Index = 0; u2Index < callee->bytecodes_count; ++u2Index)
+        if(map[u2Index] == first)
+            map[u2Index] = invoke;
+    free(first);
+    inlined[0] = invoke;
+
+    for(u2Index = 0; u2Index < count; ++u2Index)
+        if((origins[u2Index] >= 0) && inlined[u2Index]->has_branch) {
+            int target = find_bytecode_index(callee, callee->bytecodes[origins[u2Index]]->branch);
+
+            if(target == -1) {
+                inlined[0] = NULL;
+                free_inlined(inlined, count, map, origins);
+                return -1;
+            }
+
+            inlined[u2Index]->branch = map[target];
+        }
+
+    tmp = (bytecode_info**)realloc(caller->bytecodes, sizeof(bytecode_info*) * (caller->bytecodes_count + count - 1));
+    if(tmp == NULL) {
+        perror("inline_call");
+        inlined[0] = NULL;
+        free_inlined(inlined, count, map, origins);
+        return -1;
+    }
+    caller->bytecodes = tmp;
+
+    memmove(caller->bytecodes + index + count, caller->bytecodes + index + 1, sizeof(bytecode_info*) * (caller->bytecodes_count - index - 1));
+    for(u2Index = 1; u2Index < count; ++u2Index)
+        caller->bytecodes[index + u2Index] = inlined[u2Index];
+    caller->bytecodes_count += count - 1;
+
+    caller->bytecodes_size = 0;
+    for(u2Index = 0; u2Index < caller->bytecodes_count; ++u2Index)
+        caller->bytecodes_size += caller->bytecodes[u2Index]->nb_args + 1;
+    caller->needs_layout = 1;
+
+    *inlined_count = count;
+
+    free(inlined);
+    free(map);
+    free(origins);
+
+    return 0;
+
+}
+
+
+/**
+ * Compute the size in byte of the bytecodes of all class methods.
+ */
+static u4 get_code_size(analyzed_cap_file* acf) {
+
+    u4 size = 0;
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2)
+            size += acf->classes[u2Index1]->methods[u2Index2]->bytecodes_size;
+    }
+
+    return size;
+
+}
+
+
+/**
+ * Check whether a method is still called or is an install method.
+ */
+static char is_method_used(analyzed_cap_file* acf, method_info* method) {
+
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        if(acf->classes[u2Index1]->install_method == method)
+            return 1;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            method_info* crt_method = acf->classes[u2Index1]->methods[u2Index2];
+            u2 u2Index3 = 0;
+
+            for(; u2Index3 < crt_method->bytecodes_count; ++u2Index3)
+                if(crt_method->bytecodes[u2Index3]->has_ref && !(crt_method->bytecodes[u2Index3]->ref->flags & CONSTANT_POOL_IS_EXTERNAL) && (crt_method->bytecodes[u2Index3]->ref->internal_method == method))
+                    return 1;
+        }
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Remove a method from its class along with the constant pool entries
+ * referring to it and free them.
+ */
+static void remove_method(analyzed_cap_file* acf, method_info* method) {
+
+    u2 u2Index1 = 0;
+    u2 kept = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        class_info* class = acf->classes[u2Index1];
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < class->methods_count; ++u2Index2)
+            if(class->methods[u2Index2] == method) {
+                memmove(class->methods + u2Index2, class->methods + u2Index2 + 1, sizeof(method_info*) * (class->methods_count - u2Index2 - 1));
+                --class->methods_count;
+                break;
+            }
+    }
+
+    for(u2Index1 = 0; u2Index1 < acf->constant_pool_count; ++u2Index1)
+        if((acf->constant_pool[u2Index1]->flags & CONSTANT_POOL_IS_EXTERNAL) || !(acf->constant_pool[u2Index1]->flags & (CONSTANT_POOL_STATICMETHODREF|CONSTANT_POOL_VIRTUALMETHODREF|CONSTANT_POOL_SUPERMETHODREF)) || (acf->constant_pool[u2Index1]->internal_method != method)) {
+            acf->constant_pool[kept] = acf->constant_pool[u2Index1];
+            acf->constant_pool[kept]->my_index = kept;
+            ++kept;
+        } else {
+            free(acf->constant_pool[u2Index1]);
+        }
+
+    acf->constant_pool_count = kept;
+
+    free_method(method);
+
+}
+
+
+int inline_methods(analyzed_cap_file* acf, u2 max_callee_size, inline_report* report) {
+
+    inline_report local_report;
+    method_info** callees = NULL;
+    u2 callees_count = 0;
+    u2 u2Index1 = 0;
+
+    if(report == NULL)
+        report = &local_report;
+
+    report->calls_inlined = 0;
+    report->methods_removed = 0;
+    report->size_before = get_code_size(acf);
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            method_info* caller = acf->classes[u2Index1]->methods[u2Index2];
+            u2 u2Index3 = 0;
+
+            while(u2Index3 < caller->bytecodes_count) {
+                method_info* callee = get_inlinable_callee(acf->classes[u2Index1], caller, u2Index3, max_callee_size);
+                u2 inlined_count = 0;
+                u2 u2Index4 = 0;
+                int rc = 0;
+
+                if((callee == NULL) || ((rc = returns_with_empty_stack(callee)) == 0)) {
+                    ++u2Index3;
+                    continue;
+                }
+
+                if((rc == -1) || (inline_call(caller, u2Index3, callee, &inlined_count) == -1)) {
+                    free(callees);
+                    return -1;
+                }
+
+                /* The inlined bytecodes are not inlined again. */
+                u2Index3 += inlined_count;
+                ++report->calls_inlined;
+
+                for(; u2Index4 < callees_count; ++u2Index4)
+                    if(callees[u2Index4] == callee)
+                        break;
+
+                if(u2Index4 == callees_count) {
+                    method_info** tmp = (method_info**)realloc(callees, sizeof(method_info*) * (callees_count + 1));
+                    if(tmp == NULL) {
+                        perror("inline_methods");
+                        free(callees);
+                        return -1;
+                    }
+                    callees = tmp;
+                    callees[callees_count++] = callee;
+                }
+            }
+        }
+    }
+
+    /* Only callees nobody outside of the package can call are removed. */
+    for(u2Index1 = 0; u2Index1 < callees_count; ++u2Index1)
+        if(((callees[u2Index1]->flags & METHOD_PRIVATE) || !(callees[u2Index1]->flags & (METHOD_PUBLIC|METHOD_PROTECTED))) && !is_method_used(acf, callees[u2Index1])) {
+            remove_method(acf, callees[u2Index1]);
+            ++report->methods_removed;
+        }
+
+    free(callees);
+
+    if(report->calls_inlined != 0)
+        acf->dirty_components |= COMPONENT_BIT(COMPONENT_METHOD);
+
+    if(report->methods_removed != 0)
+        acf->dirty_components |= COMPONENT_BIT(COMPONENT_CLASS)|COMPONENT_BIT(COMPONENT_METHOD);
+
+    report->size_after = get_code_size(acf);
+
+    return 0;
+
+}
@@ -0,0 +1,488 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_instrument.c
+ * \brief Inject calls to a probe at method entries, method exits and basic
+ * blocks of an analyzed CAP file, for coverage and timing on emulators.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_cfg.h"
+#include "analyzed_cap_file_edit.h"
+#include "analyzed_cap_file_instrument.h"
+#include "bytecodes.h"
+#include "cap_file.h"
+#include "exp_file.h"
+#include "verbose_sink.h"
+
+/**
+ * \brief The block map being built.
+ */
+typedef struct {
+    u2 count;               /**< The number of injected probes. */
+    u2 capacity;            /**< The number of entries allocated. */
+    block_map_entry* entries;   /**< The injected probes by id. */
+} block_map;
+
+
+/**
+ * Check whether an export file UTF-8 constant is equal to a string.
+ */
+static int is_utf8_equal(export_file* ef, u2 index, const char* string, size_t length) {
+
+    return (ef->constant_pool[index].tag == EF_CONSTANT_UTF8) && (ef->constant_pool[index].CONSTANT_Utf8.length == length) && (memcmp(ef->constant_pool[index].CONSTANT_Utf8.bytes, string, length) == 0);
+
+}
+
+
+/**
+ * Check whether an exported class has the given name, fully qualified or not.
+ */
+static int is_class_named(export_file* ef, ef_class_info* class, const char* class_name) {
+
+    ef_CONSTANT_Utf8_info* name = NULL;
+    size_t length = strlen(class_name);
+
+    if(ef->constant_pool[class->name_index].tag != EF_CONSTANT_CLASSREF)
+        return 0;
+
+    name = &(ef->constant_pool[ef->constant_pool[class->name_index].CONSTANT_Classref.name_index].CONSTANT_Utf8);
+
+    if(name->length == length)
+        return memcmp(name->bytes, class_name, length) == 0;
+
+    return (name->length > length) && (name->bytes[name->length - length - 1] == '/') && (memcmp(name->bytes + name->length - length, class_name, length) == 0);
+
+}
+
+
+int find_external_probe(export_file* ef, const char* class_name, const char* method_name, instrument_probe* probe) {
+
+    u1 u1Index = 0;
+
+    for(; u1Index < ef->export_class_count; ++u1Index) {
+        ef_class_info* class = ef->classes + u1Index;
+        u2 u2Index = 0;
+
+        if(!is_class_named(ef, class, class_name))
+            continue;
+
+        for(; u2Index < class->export_methods_count; ++u2Index) {
+            ef_method_info* method = class->methods + u2Index;
+
+            if(!(method->access_flags & EF_ACC_STATIC) || !is_utf8_equal(ef, method->name_index, method_name, strlen(method_name)) || !is_utf8_equal(ef, method->descriptor_index, "(S)V", 4))
+                continue;
+
+            probe->method = NULL;
+            probe->ef = ef;
+            probe->class_token = class->token;
+            probe->method_token = method->token;
+
+            return 0;
+        }
+    }
+
+    return -1;
+
+}
+
+
+/**
+ * Check whether a signature is (S)V.
+ */
+static int is_probe_signature(type_descriptor_info* signature) {
+
+    return (signature != NULL) && (signature->types_count == 2) && (signature->types[0].type == TYPE_DESCRIPTOR_SHORT) && (signature->types[1].type == TYPE_DESCRIPTOR_VOID);
+
+}
+
+
+/**
+ * Get the (S)V signature from the signature pool, adding it if needed.
+ */
+static type_descriptor_info* get_probe_signature(analyzed_cap_file* acf) {
+
+    type_descriptor_info* signature = NULL;
+    type_descriptor_info** tmp = NULL;
+    u2 u2Index = 0;
+
+    for(; u2Index < acf->signature_pool_count; ++u2Index)
+        if(is_probe_signature(acf->signature_pool[u2Index]))
+            return acf->signature_pool[u2Index];
+
+    tmp = (type_descriptor_info**)realloc(acf->signature_pool, sizeof(type_descriptor_info*) * (acf->signature_pool_count + 1));
+    if(tmp == NULL) {
+        perror("get_probe_signature");
+        return NULL;
+    }
+    acf->signature_pool = tmp;
+
+    signature = (type_descriptor_info*)calloc(1, sizeof(type_descriptor_info));
+    if(signature == NULL) {
+        perror("get_probe_signature");
+        return NULL;
+    }
+
+    signature->types_count = 2;
+    signature->types = (one_type_descriptor_info*)calloc(2, sizeof(one_type_descriptor_info));
+    if(signature->types == NULL) {
+        perror("get_probe_signature");
+        free(signature);
+        return NULL;
+    }
+    signature->types[0].type = TYPE_DESCRIPTOR_SHORT;
+    signature->types[1].type = TYPE_DESCRIPTOR_VOID;
+
+    acf->signature_pool[acf->signature_pool_count++] = signature;
+    acf->dirty_components |= COMPONENT_BIT(COMPONENT_DESCRIPTOR);
+
+    return signature;
+
+}
+
+
+/**
+ * Get the imported package of an export file, importing it if needed.
+ */
+static imported_package_info* get_imported_package(analyzed_cap_file* acf, export_file* ef) {
+
+    ef_CONSTANT_Package_info* package = &(ef->constant_pool[ef->this_package].CONSTANT_Package);
+    imported_package_info* imported = NULL;
+    imported_package_info** tmp = NULL;
+    u1 u1Index = 0;
+
+    for(; u1Index < acf->imported_packages_count; ++u1Index) {
+        imported = acf->imported_packages[u1Index];
+
+        if((imported->ef == ef) || ((imported->aid_length == package->aid_length) && (memcmp(imported->aid, package->aid, package->aid_length) == 0)))
+            return imported;
+    }
+
+    if(acf->imported_packages_count == 128) {
+        fprintf(stderr, "Cannot import more than 128 packages\n");
+        return NULL;
+    }
+
+    tmp = (imported_package_info**)realloc(acf->imported_packages, sizeof(imported_package_info*) * (acf->imported_packages_count + 1));
+    if(tmp == NULL) {
+        perror("get_imported_package");
+        return NULL;
+    }
+    acf->imported_packages = tmp;
+
+    imported = (imported_package_info*)calloc(1, sizeof(imported_package_info));
+    if(imported == NULL) {
+        perror("get_imported_package");
+        return NULL;
+    }
+
+    imported->aid = (u1*)malloc(sizeof(u1) * package->aid_length);
+    if(imported->aid == NULL) {
+        perror("get_imported_package");
+        free(imported);
+        return NULL;
+    }
+    memcpy(imported->aid, package->aid, package->aid_length);
+
+    imported->my_index = acf->imported_packages_count;
+    imported->count = 0;
+    imported->minor_version = package->minor_version;
+    imported->major_version = package->major_version;
+    imported->aid_length = package->aid_length;
+    imported->ef = ef;
+
+    acf->imported_packages[acf->imported_packages_count++] = imported;
+    acf->dirty_components |= COMPONENT_BIT(COMPONENT_IMPORT);
+
+    return imported;
+
+}
+
+
+/**
+ * Get the constant pool entry used to call the probe, adding it if needed.
+ */
+static constant_pool_entry_info* get_probe_entry(analyzed_cap_file* acf, const instrument_probe* probe) {
+
+    constant_pool_entry_info* entry = NULL;
+    constant_pool_entry_info** tmp = NULL;
+    imported_package_info* package = NULL;
+    type_descriptor_info* signature = NULL;
+    u2 u2Index = 0;
+
+    if(probe->method != NULL) {
+        if(!(probe->method->flags & METHOD_STATIC) || !is_probe_signature(probe->method->signature) || (probe->method->this_method == NULL)) {
+            fprintf(stderr, "The probe should be a static method of signature (S)V\n");
+            return NULL;
+        }
+
+        return probe->method->this_method;
+    }
+
+    if((package = get_imported_package(acf, probe->ef)) == NULL)
+        return NULL;
+
+    for(; u2Index < acf->constant_pool_count; ++u2Index) {
+        entry = acf->constant_pool[u2Index];
+
+        if((entry->flags == (CONSTANT_POOL_STATICMETHODREF|CONSTANT_POOL_IS_EXTERNAL)) && (entry->external_package == package) && (entry->external_class_token == probe->class_token) && (entry->method_token == probe->method_token))
+            return entry;
+    }
+
+    if((signature = get_probe_signature(acf)) == NULL)
+        return NULL;
+
+    tmp = (constant_pool_entry_info**)realloc(acf->constant_pool, sizeof(constant_pool_entry_info*) * (acf->constant_pool_count + 1));
+    if(tmp == NULL) {
+        perror("get_probe_entry");
+        return NULL;
+    }
+    acf->constant_pool = tmp;
+
+    entry = (constant_pool_entry_info*)calloc(1, sizeof(constant_pool_entry_info));
+    if(entry == NULL) {
+        perror("get_probe_entry");
+        return NULL;
+    }
+
+    entry->flags = CONSTANT_POOL_STATICMETHODREF|CONSTANT_POOL_IS_EXTERNAL;
+    entry->my_index = acf->constant_pool_count;
+    entry->type = signature;
+    entry->external_package = package;
+    entry->external_class_token = probe->class_token;
+    entry->method_token = probe->method_token;
+
+    acf->constant_pool[acf->constant_pool_count++] = entry;
+
+    return entry;
+
+}
+
+
+/**
+ * Compute the offset of each bytecode within its method, the last one being
+ * the size of the method.
+ */
+static u2* get_offsets(method_info* method) {
+
+    u2* offsets = NULL;
+    u2 u2Index = 0;
+
+    offsets = (u2*)malloc(sizeof(u2) * (method->bytecodes_count + 1));
+    if(offsets == NULL) {
+        perror("get_offsets");
+        return NULL;
+    }
+
+    offsets[0] = 0;
+    for(; u2Index < method->bytecodes_count; ++u2Index)
+        offsets[u2Index + 1] = offsets[u2Index] + method->bytecodes[u2Index]->nb_args + 1;
+
+    return offsets;
+
+}
+
+
+/**
+ * Record a probe in the block map and insert its call before a bytecode.
+ */
+static int add_probe(bytecode_editor* editor, block_map* map, constant_pool_entry_info* entry, u1 kind, u2 class_index, u2 method_index, u2 index, u2 start, u2 end) {
+
+    block_map_entry* crt = NULL;
+    bytecode_info* call[2] = {NULL, NULL};
+    u2 id = map->count;
+
+    if(id == INSTRUMENT_MAX_PROBES) {
+        fprintf(stderr, "Cannot inject more than %u probes\n", INSTRUMENT_MAX_PROBES);
+        return -1;
+    }
+
+    if(map->count == map->capacity) {
+        u2 capacity = (map->capacity == 0) ? 64 : ((map->capacity >= INSTRUMENT_MAX_PROBES / 2) ? INSTRUMENT_MAX_PROBES : map->capacity * 2);
+        block_map_entry* tmp = (block_map_entry*)realloc(map->entries, sizeof(block_map_entry) * capacity);
+        if(tmp == NULL) {
+            perror("add_probe");
+            return -1;
+        }
+        map->entries = tmp;
+        map->capacity = capacity;
+    }
+
+    /* The id is pushed with the shortest bytecode. */
+    if(id <= 5)
+        call[0] = new_bytecode(3 + id);     /* sconst_<n> */
+    else if(id <= 127) {
+        if((call[0] = new_bytecode(16)) != NULL)  /* bspush */
+            call[0]->args[0] = id;
+    } else if((call[0] = new_bytecode(17)) != NULL) {   /* sspush */
+        call[0]->args[0] = id >> 8;
+        call[0]->args[1] = id & 0xFF;
+    }
+
+    if((call[1] = new_bytecode(141)) != NULL)   /* invokestatic */
+        call[1]->ref = entry;
+
+    if((call[0] == NULL) || (call[1] == NULL) || (edit_insert_before(editor, index, call, 2, kind != INSTRUMENT_ENTRIES) == -1)) {
+        free(call[0]);
+        free(call[1]);
+        return -1;
+    }
+
+    crt = map->entries + map->count++;
+    crt->id = id;
+    crt->kind = kind;
+    crt->class_index = class_index;
+    crt->method_index = method_index;
+    crt->start = start;
+    crt->end = end;
+
+    return 0;
+
+}
+
+
+/**
+ * Inject the probes of a method in one sweep.
+ */
+static int instrument_method(analyzed_cap_file* acf, u2 class_index, u2 method_index, constant_pool_entry_info* entry, u1 flags, block_map* map) {
+
+    method_info* method = acf->classes[class_index]->methods[method_index];
+    bytecode_editor editor;
+    method_cfg* cfg = NULL;
+    u2* offsets = NULL;
+    u2 u2Index = 0;
+    int rc = 0;
+
+    if((cfg = build_method_cfg(method)) == NULL)
+        return -1;
+
+    if((offsets = get_offsets(method)) == NULL) {
+        free_method_cfg(cfg);
+        return -1;
+    }
+
+    init_bytecode_editor(&editor, method);
+
+    if(flags & INSTRUMENT_ENTRIES)
+        rc = add_probe(&editor, map, entry, INSTRUMENT_ENTRIES, class_index, method_index, 0, 0, offsets[method->bytecodes_count]);
+
+    for(; (rc != -1) && (flags & INSTRUMENT_BLOCKS) && (u2Index < cfg->blocks_count); ++u2Index)
+        rc = add_probe(&editor, map, entry, INSTRUMENT_BLOCKS, class_index, method_index, cfg->blocks[u2Index].start, offsets[cfg->blocks[u2Index].start], offsets[cfg->blocks[u2Index].end]);
+
+    for(u2Index = 0; (rc != -1) && (flags & INSTRUMENT_EXITS) && (u2Index < method->bytecodes_count); ++u2Index)
+        if((method->bytecodes[u2Index]->opcode >= 119) && (method->bytecodes[u2Index]->opcode <= 122))
+            rc = add_probe(&editor, map, entry, INSTRUMENT_EXITS, class_index, method_index, u2Index, offsets[u2Index], offsets[u2Index + 1]);
+
+    if(rc != -1)
+        rc = commit_bytecode_edits(&editor);
+
+    free_bytecode_editor(&editor);
+    free_method_cfg(cfg);
+    free(offsets);
+
+    return rc;
+
+}
+
+
+int instrument_cap_file(analyzed_cap_file* acf, const instrument_probe* probe, u1 flags, block_map_entry** map, u2* map_count) {
+
+    constant_pool_entry_info* entry = NULL;
+    block_map crt_map;
+    u2 u2Index1 = 0;
+
+    crt_map.count = 0;
+    crt_map.capacity = 0;
+    crt_map.entries = NULL;
+
+    if((entry = get_probe_entry(acf, probe)) == NULL)
+        return -1;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            method_info* method = acf->classes[u2Index1]->methods[u2Index2];
+
+            if((method == probe->method) || (method->bytecodes_count == 0))
+                continue;
+
+            if(instrument_method(acf, u2Index1, u2Index2, entry, flags, &crt_map) == -1) {
+                free(crt_map.entries);
+                return -1;
+            }
+        }
+    }
+
+    if(crt_map.count != 0)
+        acf->dirty_components |= COMPONENT_BIT(COMPONENT_CONSTANTPOOL)|COMPONENT_BIT(COMPONENT_METHOD);
+
+    *map = crt_map.entries;
+    *map_count = crt_map.count;
+
+    return 0;
+
+}
+
+
+int print_block_map(verbose_sink* sink, const block_map_entry* map, u2 map_count) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < map_count; ++u2Index) {
+        const char* kind = "block";
+
+        if(map[u2Index].kind == INSTRUMENT_ENTRIES)
+            kind = "entry";
+        else if(map[u2Index].kind == INSTRUMENT_EXITS)
+            kind = "exit";
+
+        if(sink_printf(sink, "%u %s %u %u %u %u\n", map[u2Index].id, kind, map[u2Index].class_index, map[u2Index].method_index, map[u2Index].start, map[u2Index].end) == -1)
+            return -1;
+    }
+
+    return 0;
+
+}
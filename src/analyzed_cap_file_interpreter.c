@@ -0,0 +1,1392 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_interpreter.c
+ * \brief Execute analyzed methods on the host to profile them.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_interpreter.h"
+#include "analyzed_cap_file_constant.h"
+#include "analyzed_cap_file_frame.h"
+#include "bytecodes.h"
+
+#define MAX_CALL_DEPTH  256 /**< Deeper calls are an error. */
+
+/**
+ * \brief A method being executed.
+ */
+typedef struct {
+    method_info* method;        /**< The executed method. */
+    method_profile* profile;    /**< Its profile. */
+    u2 pc;                      /**< Index of the current bytecode. */
+    int16_t* locals;            /**< nargs + max_locals words. */
+    u2 locals_count;            /**< Number of local variables in words. */
+    int16_t* stack;             /**< max_stack words. */
+    u2 sp;                      /**< Number of words on the stack. */
+    u2 stack_size;              /**< Size of the stack in words. */
+} call_frame;
+
+/**
+ * \brief The state of a call to interpret_method().
+ */
+typedef struct {
+    call_frame* frames;     /**< The called methods, the current one last. */
+    u2 frames_count;        /**< The call depth. */
+    char done;              /**< The first method returned or threw. */
+    int outcome;            /**< INTERPRETER_RETURNED or INTERPRETER_THREW. */
+    int16_t result[2];      /**< The returned words or thrown handle. */
+    u1 result_count;        /**< The number of returned words. */
+} execution;
+
+
+void get_default_cycle_costs(u4* cycle_costs) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < 256; ++u2Index) {
+        const opcode_info* opcode = opcodes + u2Index;
+
+        if(opcode->format == OPCODE_FORMAT_INVALID)
+            cycle_costs[u2Index] = 0;
+        else if((u2Index >= 139) && (u2Index <= 142))  /* invokes */
+            cycle_costs[u2Index] = 10;
+        else if((u2Index >= 143) && (u2Index <= 145))  /* new, newarray, anewarray */
+            cycle_costs[u2Index] = 20;
+        else if((u2Index == 147) || ((u2Index >= 115) && (u2Index <= 118)))    /* athrow, switches */
+            cycle_costs[u2Index] = 5;
+        else if(((u2Index >= 36) && (u2Index <= 39)) || ((u2Index >= 55) && (u2Index <= 58)))  /* array accesses */
+            cycle_costs[u2Index] = 3;
+        else if(opcode->format == OPCODE_FORMAT_REF)   /* field accesses */
+            cycle_costs[u2Index] = 2;
+        else
+            cycle_costs[u2Index] = 1;
+    }
+
+}
+
+
+/**
+ * Compare two bytecodes by address.
+ */
+static int compare_bytecode_addresses(const void* bytecode1, const void* bytecode2) {
+
+    uintptr_t address1 = (uintptr_t)*(bytecode_info* const*)bytecode1;
+    uintptr_t address2 = (uintptr_t)*(bytecode_info* const*)bytecode2;
+
+    return (address1 > address2) - (address1 < address2);
+
+}
+
+
+/**
+ * Allocate the profile of a method.
+ */
+static int init_method_profile(method_profile* profile, method_info* method) {
+
+    u2 u2Index = 0;
+
+    profile->method = method;
+    profile->invocations = 0;
+    profile->cycles = 0;
+    profile->executions = (u4*)calloc(method->bytecodes_count + 1, sizeof(u4));
+    profile->taken = (u4*)calloc(method->bytecodes_count + 1, sizeof(u4));
+    profile->sorted = (bytecode_info**)malloc(sizeof(bytecode_info*) * (method->bytecodes_count + 1));
+    profile->sorted_indexes = (u2*)malloc(sizeof(u2) * (method->bytecodes_count + 1));
+    if((profile->executions == NULL) || (profile->taken == NULL) || (profile->sorted == NULL) || (profile->sorted_indexes == NULL)) {
+        perror("init_method_profile");
+        return -1;
+    }
+
+    for(; u2Index < method->bytecodes_count; ++u2Index)
+        profile->sorted[u2Index] = method->bytecodes[u2Index];
+
+    qsort(profile->sorted, method->bytecodes_count, sizeof(bytecode_info*), compare_bytecode_addresses);
+
+    for(u2Index = 0; u2Index < method->bytecodes_count; ++u2Index) {
+        bytecode_info** found = (bytecode_info**)bsearch(&method->bytecodes[u2Index], profile->sorted, method->bytecodes_count, sizeof(bytecode_info*), compare_bytecode_addresses);
+        profile->sorted_indexes[found - profile->sorted] = u2Index;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Get the index of a bytecode within a profiled method, -1 if it is not
+ * part of it.
+ */
+static int get_bytecode_index(method_profile* profile, bytecode_info* bytecode) {
+
+    bytecode_info** found = NULL;
+
+    if(bytecode == NULL)
+        return -1;
+
+    found = (bytecode_info**)bsearch(&bytecode, profile->sorted, profile->method->bytecodes_count, sizeof(bytecode_info*), compare_bytecode_addresses);
+    if(found == NULL) {
+        fprintf(stderr, "Branch target outside of its method\n");
+        return -1;
+    }
+
+    return profile->sorted_indexes[found - profile->sorted];
+
+}
+
+
+interpreter* new_interpreter(analyzed_cap_file* acf, const u4* cycle_costs) {
+
+    interpreter* interp = NULL;
+    u2 u2Index1 = 0;
+    u2 count = 0;
+
+    interp = (interpreter*)calloc(1, sizeof(interpreter));
+    if(interp == NULL) {
+        perror("new_interpreter");
+        return NULL;
+    }
+
+    interp->acf = acf;
+
+    if(cycle_costs != NULL)
+        memcpy(interp->cycle_costs, cycle_costs, sizeof(interp->cycle_costs));
+    else
+        get_default_cycle_costs(interp->cycle_costs);
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1)
+        count += acf->classes[u2Index1]->methods_count;
+
+    interp->profiles = (method_profile*)calloc(count + 1, sizeof(method_profile));
+    if(interp->profiles == NULL) {
+        perror("new_interpreter");
+        free(interp);
+        return NULL;
+    }
+
+    for(u2Index1 = 0; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            method_info* method = acf->classes[u2Index1]->methods[u2Index2];
+
+            if((method->bytecodes_count != 0) && (compute_method_frame(method) == -1)) {
+                free_interpreter(interp);
+                return NULL;
+            }
+
+            if(init_method_profile(interp->profiles + interp->profiles_count++, method) == -1) {
+                free_interpreter(interp);
+                return NULL;
+            }
+        }
+    }
+
+    return interp;
+
+}
+
+
+void free_interpreter(interpreter* interp) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < interp->objects_count; ++u2Index) {
+        free(interp->objects[u2Index].elements);
+        free(interp->objects[u2Index].fields);
+    }
+
+    for(u2Index = 0; u2Index < interp->profiles_count; ++u2Index) {
+        free(interp->profiles[u2Index].executions);
+        free(interp->profiles[u2Index].taken);
+        free(interp->profiles[u2Index].sorted);
+        free(interp->profiles[u2Index].sorted_indexes);
+    }
+
+    free(interp->objects);
+    free(interp->statics);
+    free(interp->profiles);
+    free(interp);
+
+}
+
+
+method_profile* get_method_profile(interpreter* interp, method_info* method) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < interp->profiles_count; ++u2Index)
+        if(interp->profiles[u2Index].method == method)
+            return interp->profiles + u2Index;
+
+    return NULL;
+
+}
+
+
+/**
+ * Allocate an object in the heap. Return its handle or 0 if an error
+ * occurred.
+ */
+static u2 new_object(interpreter* interp, class_info* class, constant_pool_entry_info* external_class, u1 exception) {
+
+    interpreter_object* tmp = NULL;
+
+    if(interp->objects_count >= 0x7FFF) {
+        fprintf(stderr, "Interpreter heap is full\n");
+        return 0;
+    }
+
+    tmp = (interpreter_object*)realloc(interp->objects, sizeof(interpreter_object) * (interp->objects_count + 1));
+    if(tmp == NULL) {
+        perror("new_object");
+        return 0;
+    }
+    interp->objects = tmp;
+
+    memset(interp->objects + interp->objects_count, 0, sizeof(interpreter_object));
+    interp->objects[interp->objects_count].class = class;
+    interp->objects[interp->objects_count].external_class = external_class;
+    interp->objects[interp->objects_count].exception = exception;
+
+    return ++interp->objects_count;
+
+}
+
+
+u2 new_interpreter_array(interpreter* interp, u1 type, u2 length) {
+
+    u2 handle = new_object(interp, NULL, NULL, 0);
+    if(handle == 0)
+        return 0;
+
+    interp->objects[handle - 1].array_type = type;
+    interp->objects[handle - 1].length = length;
+    interp->objects[handle - 1].elements = (int32_t*)calloc(length + 1, sizeof(int32_t));
+    if(interp->objects[handle - 1].elements == NULL) {
+        perror("new_interpreter_array");
+        return 0;
+    }
+
+    return handle;
+
+}
+
+
+/**
+ * Get the object of a handle, NULL for null or an invalid handle.
+ */
+static interpreter_object* get_object(interpreter* interp, int16_t handle) {
+
+    if((handle <= 0) || (handle > interp->objects_count))
+        return NULL;
+
+    return interp->objects + handle - 1;
+
+}
+
+
+/**
+ * Get the value of a field, adding it with the given value if it is not
+ * there yet. Return NULL if an error occurred.
+ */
+static int32_t* get_field(interpreter_field** fields, u2* fields_count, const void* key, int32_t value) {
+
+    interpreter_field* tmp = NULL;
+    u2 u2Index = 0;
+
+    for(; u2Index < *fields_count; ++u2Index)
+        if((*fields)[u2Index].key == key)
+            return &(*fields)[u2Index].value;
+
+    tmp = (interpreter_field*)realloc(*fields, sizeof(interpreter_field) * (*fields_count + 1));
+    if(tmp == NULL) {
+        perror("get_field");
+        return NULL;
+    }
+    *fields = tmp;
+
+    (*fields)[*fields_count].key = key;
+    (*fields)[*fields_count].value = value;
+
+    return &(*fields)[(*fields_count)++].value;
+
+}
+
+
+/**
+ * Get the initial value of a static field as found in the Static Field
+ * component. Return -1 if an error occurred, 0 else.
+ */
+static int get_initial_value(interpreter* interp, field_info* field, int32_t* value) {
+
+    u1 type = field->type->types->type;
+    u2 u2Index = 0;
+
+    *value = 0;
+
+    if(!(field->flags & FIELD_HAS_VALUE) || (field->value == NULL))
+        return 0;
+
+    if(type & TYPE_DESCRIPTOR_ARRAY) {
+        u1 array_type = INTERPRETER_ARRAY_BYTE;
+        u1 width = 1;
+        u2 handle = 0;
+
+        if(type & TYPE_DESCRIPTOR_BOOLEAN) {
+            array_type = INTERPRETER_ARRAY_BOOLEAN;
+        } else if(type & TYPE_DESCRIPTOR_SHORT) {
+            array_type = INTERPRETER_ARRAY_SHORT;
+            width = 2;
+        } else if(type & TYPE_DESCRIPTOR_INT) {
+            array_type = INTERPRETER_ARRAY_INT;
+            width = 4;
+        }
+
+        if((handle = new_interpreter_array(interp, array_type, field->value_size / width)) == 0)
+            return -1;
+
+        for(; u2Index < field->value_size / width; ++u2Index) {
+            u1* crt = field->value + (u2Index * width);
+
+            if(width == 1)
+                interp->objects[handle - 1].elements[u2Index] = (int8_t)crt[0];
+            else if(width == 2)
+                interp->objects[handle - 1].elements[u2Index] = (int16_t)((crt[0] << 8) | crt[1]);
+            else
+                interp->objects[handle - 1].elements[u2Index] = (int32_t)(((u4)crt[0] << 24) | ((u4)crt[1] << 16) | ((u4)crt[2] << 8) | crt[3]);
+        }
+
+        *value = handle;
+    } else if(field->value_size == 1) {
+        *value = (int8_t)field->value[0];
+    } else if(field->value_size == 2) {
+        *value = (int16_t)((field->value[0] << 8) | field->value[1]);
+    } else if(field->value_size == 4) {
+        *value = (int32_t)(((u4)field->value[0] << 24) | ((u4)field->value[1] << 16) | ((u4)field->value[2] << 8) | field->value[3]);
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Get a static field, initializing it on first use. Return NULL if an error
+ * occurred.
+ */
+static int32_t* get_static_field(interpreter* interp, constant_pool_entry_info* ref) {
+
+    u2 u2Index = 0;
+    int32_t value = 0;
+    const void* key = ref;
+
+    if(!(ref->flags & CONSTANT_POOL_IS_EXTERNAL) && (ref->internal_field != NULL))
+        key = ref->internal_field;
+
+    for(; u2Index < interp->statics_count; ++u2Index)
+        if(interp->statics[u2Index].key == key)
+            return &interp->statics[u2Index].value;
+
+    if((key != ref) && (get_initial_value(interp, ref->internal_field, &value) == -1))
+        return NULL;
+
+    return get_field(&interp->statics, &interp->statics_count, key, value);
+
+}
+
+
+/**
+ * Get the internal superclass of a class, NULL if there is none.
+ */
+static class_info* get_superclass(class_info* class) {
+
+    if((class->superclass == NULL) || (class->superclass->flags & CONSTANT_POOL_IS_EXTERNAL))
+        return NULL;
+
+    return class->superclass->internal_class;
+
+}
+
+
+/**
+ * Check whether two class reference constant pool entries designate the
+ * same class or interface.
+ */
+static char is_same_class(constant_pool_entry_info* ref1, constant_pool_entry_info* ref2) {
+
+    if(ref1 == ref2)
+        return 1;
+
+    if((ref1->flags & CONSTANT_POOL_IS_EXTERNAL) != (ref2->flags & CONSTANT_POOL_IS_EXTERNAL))
+        return 0;
+
+    if(ref1->flags & CONSTANT_POOL_IS_EXTERNAL)
+        return (ref1->external_package == ref2->external_package) && (ref1->external_class_token == ref2->external_class_token);
+
+    return (ref1->internal_class == ref2->internal_class) && (ref1->internal_interface == ref2->internal_interface);
+
+}
+
+
+/**
+ * Check whether an interface or one of its superinterfaces is the given
+ * one.
+ */
+static char is_subinterface(interface_info* interface, constant_pool_entry_info* type) {
+
+    u1 u1Index = 0;
+
+    if(interface->this_interface != NULL && is_same_class(interface->this_interface, type))
+        return 1;
+
+    for(; u1Index < interface->superinterfaces_count; ++u1Index) {
+        constant_pool_entry_info* super = interface->superinterfaces[u1Index];
+
+        if(is_same_class(super, type))
+            return 1;
+
+        if(!(super->flags & CONSTANT_POOL_IS_EXTERNAL) && (super->internal_interface != NULL) && is_subinterface(super->internal_interface, type))
+            return 1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Check whether an object is an instance of a class or interface. Objects
+ * without class are considered instances of any external type.
+ */
+static char is_instance_of(interpreter_object* object, constant_pool_entry_info* type) {
+
+    class_info* class = object->class;
+
+    if(class == NULL)
+        return (object->external_class != NULL) ? is_same_class(object->external_class, type) || (type->flags & CONSTANT_POOL_IS_EXTERNAL) : (type->flags & CONSTANT_POOL_IS_EXTERNAL) != 0;
+
+    for(; class != NULL; class = get_superclass(class)) {
+        u1 u1Index = 0;
+
+        if(is_same_class(class->this_class, type))
+            return 1;
+
+        for(; u1Index < class->interfaces_count; ++u1Index) {
+            constant_pool_entry_info* interface = class->interfaces[u1Index].ref;
+
+            if(is_same_class(interface, type))
+                return 1;
+
+            if(!(interface->flags & CONSTANT_POOL_IS_EXTERNAL) && (interface->internal_interface != NULL) && is_subinterface(interface->internal_interface, type))
+                return 1;
+        }
+
+        if((class->superclass != NULL) && (class->superclass->flags & CONSTANT_POOL_IS_EXTERNAL) && is_same_class(class->superclass, type))
+            return 1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Check whether an object matches the type of a checkcast or instanceof
+ * bytecode.
+ */
+static char is_of_type(interpreter_object* object, bytecode_info* bytecode) {
+
+    if(bytecode->args[0] == 0)
+        return is_instance_of(object, bytecode->ref);
+
+    if(object->array_type != bytecode->args[0])
+        return 0;
+
+    /* The element type of arrays of references is not kept. */
+    return 1;
+
+}
+
+
+/**
+ * Find the method run by an invoke bytecode. Return NULL if it is external
+ * or cannot be found.
+ */
+static method_info* resolve_method(interpreter* interp, bytecode_info* bytecode, int16_t this_handle) {
+
+    interpreter_object* object = get_object(interp, this_handle);
+    constant_pool_entry_info* ref = bytecode->ref;
+    class_info* class = NULL;
+
+    if(bytecode->opcode == 141 || bytecode->opcode == 140)     /* invokestatic, invokespecial */
+        return (ref->flags & CONSTANT_POOL_IS_EXTERNAL) ? NULL : ref->internal_method;
+
+    if(object == NULL)
+        return NULL;
+
+    for(class = object->class; class != NULL; class = get_superclass(class)) {
+        u2 u2Index = 0;
+
+        if(bytecode->opcode == 142) {   /* invokeinterface */
+            u1 u1Index = 0;
+
+            for(; u1Index < class->interfaces_count; ++u1Index)
+                if(is_same_class(class->interfaces[u1Index].ref, ref) && (bytecode->args[1] < class->interfaces[u1Index].count))
+                    return class->interfaces[u1Index].index[bytecode->args[1]].implementation;
+
+            continue;
+        }
+
+        for(; u2Index < class->methods_count; ++u2Index) {
+            method_info* method = class->methods[u2Index];
+
+            if(!(method->flags & (METHOD_STATIC|METHOD_INIT|METHOD_PRIVATE|METHOD_ABSTRACT)) && (method->token == ref->method_token))
+                return method;
+        }
+    }
+
+    return NULL;
+
+}
+
+
+/**
+ * Push a word on the operand stack. The stack effect was checked before.
+ */
+static void push_word(call_frame* frame, int16_t word) {
+
+    frame->stack[frame->sp++] = word;
+
+}
+
+
+/**
+ * Pop a word from the operand stack.
+ */
+static int16_t pop_word(call_frame* frame) {
+
+    return frame->stack[--frame->sp];
+
+}
+
+
+/**
+ * Push an int, high word first.
+ */
+static void push_int(call_frame* frame, int32_t value) {
+
+    push_word(frame, (int16_t)(u2)((u4)value >> 16));
+    push_word(frame, (int16_t)(u2)value);
+
+}
+
+
+/**
+ * Pop an int.
+ */
+static int32_t pop_int(call_frame* frame) {
+
+    u2 low = (u2)pop_word(frame);
+    u2 high = (u2)pop_word(frame);
+
+    return (int32_t)(((u4)high << 16) | low);
+
+}
+
+
+/**
+ * Read an int from two local variables.
+ */
+static int32_t get_int_local(call_frame* frame, u1 local) {
+
+    return (int32_t)(((u4)(u2)frame->locals[local] << 16) | (u2)frame->locals[local + 1]);
+
+}
+
+
+/**
+ * Write an int into two local variables.
+ */
+static void set_int_local(call_frame* frame, u1 local, int32_t value) {
+
+    frame->locals[local] = (int16_t)(u2)((u4)value >> 16);
+    frame->locals[local + 1] = (int16_t)(u2)value;
+
+}
+
+
+/**
+ * Call a method with the given arguments.
+ */
+static int push_frame(interpreter* interp, execution* exec, method_info* method, const int16_t* args, u1 args_count) {
+
+    call_frame* tmp = NULL;
+    call_frame* frame = NULL;
+    u2 locals_count = method->nargs + method->max_locals;
+
+    if((method->bytecodes_count == 0) || (method->flags & METHOD_ABSTRACT)) {
+        fprintf(stderr, "Cannot execute a method without bytecodes\n");
+        return -1;
+    }
+
+    if(exec->frames_count >= MAX_CALL_DEPTH) {
+        fprintf(stderr, "Call depth exceeds %u\n", MAX_CALL_DEPTH);
+        return -1;
+    }
+
+    if(args_count > locals_count) {
+        fprintf(stderr, "Too many arguments\n");
+        return -1;
+    }
+
+    tmp = (call_frame*)realloc(exec->frames, sizeof(call_frame) * (exec->frames_count + 1));
+    if(tmp == NULL) {
+        perror("push_frame");
+        return -1;
+    }
+    exec->frames = tmp;
+
+    frame = exec->frames + exec->frames_count;
+    frame->method = method;
+    frame->profile = get_method_profile(interp, method);
+    frame->pc = 0;
+    frame->sp = 0;
+    frame->stack_size = method->max_stack;
+    frame->locals_count = locals_count;
+    frame->locals = (int16_t*)calloc(locals_count + 1, sizeof(int16_t));
+    frame->stack = (int16_t*)calloc(frame->stack_size + 1, sizeof(int16_t));
+    if((frame->profile == NULL) || (frame->locals == NULL) || (frame->stack == NULL)) {
+        if(frame->profile == NULL)
+            fprintf(stderr, "Cannot execute a method which is not a class method\n");
+        else
+            perror("push_frame");
+        free(frame->locals);
+        free(frame->stack);
+        return -1;
+    }
+
+    memcpy(frame->locals, args, sizeof(int16_t) * args_count);
+    ++exec->frames_count;
+    ++frame->profile->invocations;
+
+    return 0;
+
+}
+
+
+/**
+ * Leave the current method.
+ */
+static void pop_frame(execution* exec) {
+
+    call_frame* frame = exec->frames + --exec->frames_count;
+
+    free(frame->locals);
+    free(frame->stack);
+
+}
+
+
+/**
+ * Throw an object: continue in the first handler catching it, leaving
+ * methods until one is found.
+ */
+static int throw_object(interpreter* interp, execution* exec, int16_t handle) {
+
+    interpreter_object* object = get_object(interp, handle);
+
+    if(object == NULL) {
+        if((handle = new_object(interp, NULL, NULL, INTERPRETER_NULL_POINTER_EXCEPTION)) == 0)
+            return -1;
+        object = get_object(interp, handle);
+    }
+
+    while(exec->frames_count != 0) {
+        call_frame* frame = exec->frames + exec->frames_count - 1;
+        u1 u1Index = 0;
+
+        for(; u1Index < frame->method->exception_handlers_count; ++u1Index) {
+            exception_handler_info* handler = frame->method->exception_handlers[u1Index];
+            int start = get_bytecode_index(frame->profile, handler->start);
+            int end = (handler->end == NULL) ? frame->method->bytecodes_count : get_bytecode_index(frame->profile, handler->end);
+            int target = get_bytecode_index(frame->profile, handler->handler);
+
+            if((start == -1) || (end == -1) || (target == -1))
+                return -1;
+
+            if((frame->pc < start) || (frame->pc >= end))
+                continue;
+
+            if((handler->catch_type == NULL) || is_instance_of(object, handler->catch_type)) {
+                frame->sp = 0;
+                push_word(frame, handle);
+                frame->pc = target;
+                return 0;
+            }
+        }
+
+        pop_frame(exec);
+    }
+
+    exec->done = 1;
+    exec->outcome = INTERPRETER_THREW;
+    exec->result[0] = handle;
+    exec->result_count = 1;
+
+    return 0;
+
+}
+
+
+/**
+ * Throw an exception of the interpreter.
+ */
+static int throw_exception(interpreter* interp, execution* exec, u1 exception) {
+
+    u2 handle = new_object(interp, NULL, NULL, exception);
+
+    if(handle == 0)
+        return -1;
+
+    return throw_object(interp, exec, handle);
+
+}
+
+
+/**
+ * Execute an invoke bytecode.
+ */
+static int invoke(interpreter* interp, execution* exec, bytecode_info* bytecode, u1 pops, u1 pushes) {
+
+    call_frame* frame = exec->frames + exec->frames_count - 1;
+    int16_t* args = frame->stack + frame->sp - pops;
+    int16_t results[2] = {0, 0};
+    method_info* method = NULL;
+    int rc = INTERPRETER_NATIVE_DEFAULT;
+    u1 u1Index = 0;
+
+    if((bytecode->opcode != 141) && (get_object(interp, args[0]) == NULL))
+        return throw_exception(interp, exec, INTERPRETER_NULL_POINTER_EXCEPTION);
+
+    if((method = resolve_method(interp, bytecode, (bytecode->opcode != 141) ? args[0] : 0)) != NULL) {
+        frame->sp -= pops;
+        return push_frame(interp, exec, method, args, pops);
+    }
+
+    if(interp->native != NULL)
+        rc = interp->native(interp, bytecode, args, pops, results, pushes);
+
+    if(rc == -1)
+        return -1;
+
+    frame->sp -= pops;
+
+    if(rc == INTERPRETER_NATIVE_THROW)
+        return throw_object(interp, exec, results[0]);
+
+    for(; u1Index < pushes; ++u1Index)
+        push_word(frame, results[u1Index]);
+
+    ++frame->pc;
+
+    return 0;
+
+}
+
+
+/**
+ * Leave the current method, giving the returned words to the caller.
+ */
+static void return_from(execution* exec, u1 words) {
+
+    call_frame* frame = exec->frames + exec->frames_count - 1;
+    int16_t result[2] = {0, 0};
+    u1 u1Index = 0;
+
+    for(; u1Index < words; ++u1Index)
+        result[u1Index] = frame->stack[frame->sp - words + u1Index];
+
+    pop_frame(exec);
+
+    if(exec->frames_count == 0) {
+        exec->done = 1;
+        exec->outcome = INTERPRETER_RETURNED;
+        exec->result[0] = result[0];
+        exec->result[1] = result[1];
+        exec->result_count = words;
+        return;
+    }
+
+    frame = exec->frames + exec->frames_count - 1;
+    for(u1Index = 0; u1Index < words; ++u1Index)
+        push_word(frame, result[u1Index]);
+    ++frame->pc;
+
+}
+
+
+/**
+ * Evaluate the condition of a branch whose narrow opcode is given.
+ */
+static char is_branch_taken(call_frame* frame, u1 opcode) {
+
+    int32_t value1 = 0;
+    int32_t value2 = 0;
+
+    if((opcode >= 104) && (opcode <= 111)) {    /* if_acmp<cond>, if_scmp<cond> */
+        value2 = pop_word(frame);
+        value1 = pop_word(frame);
+        opcode = (opcode <= 105) ? opcode - 104 + 96 : opcode - 106 + 96;
+    } else if(opcode != 112) {
+        value1 = pop_word(frame);
+        if((opcode == 102) || (opcode == 103))  /* ifnull, ifnonnull */
+            opcode -= 6;
+    }
+
+    switch(opcode) {
+        case 96:
+            return value1 == value2;
+
+        case 97:
+            return value1 != value2;
+
+        case 98:
+            return value1 < value2;
+
+        case 99:
+            return value1 >= value2;
+
+        case 100:
+            return value1 > value2;
+
+        case 101:
+            return value1 <= value2;
+
+        default:    /* goto */
+            return 1;
+    }
+
+}
+
+
+/**
+ * Get the branch taken by a switch for the given value and whether it is the
+ * default one.
+ */
+static bytecode_info* get_switch_branch(bytecode_info* bytecode, int32_t value, char* is_default) {
+
+    switch_info* data = bytecode->switch_data;
+    u2 u2Index = 0;
+
+    *is_default = 0;
+
+    switch(bytecode->opcode) {
+        case 115:   /* stableswitch */
+            if((value >= data->stableswitch.low) && (value <= data->stableswitch.high))
+                return data->stableswitch.branches[value - data->stableswitch.low];
+            *is_default = 1;
+            return data->stableswitch.default_branch;
+
+        case 116:   /* itableswitch */
+            if((value >= data->itableswitch.low) && (value <= data->itableswitch.high))
+                return data->itableswitch.branches[value - data->itableswitch.low];
+            *is_default = 1;
+            return data->itableswitch.default_branch;
+
+        case 117:   /* slookupswitch */
+            for(; u2Index < data->slookupswitch.nb_cases; ++u2Index)
+                if(data->slookupswitch.cases[u2Index].match == value)
+                    return data->slookupswitch.cases[u2Index].branch;
+            *is_default = 1;
+            return data->slookupswitch.default_branch;
+
+        default:    /* ilookupswitch */
+            for(; u2Index < data->ilookupswitch.nb_cases; ++u2Index)
+                if(data->ilookupswitch.cases[u2Index].match == value)
+                    return data->ilookupswitch.cases[u2Index].branch;
+            *is_default = 1;
+            return data->ilookupswitch.default_branch;
+    }
+
+}
+
+
+/**
+ * Execute an array load or store, from aaload to iaload and from aastore to
+ * iastore.
+ */
+static int access_array(interpreter* interp, execution* exec, call_frame* frame, u1 opcode) {
+
+    char is_store = (opcode >= 55);
+    u1 kind = is_store ? opcode - 55 : opcode - 36;    /* a, b, s, i */
+    int32_t value = 0;
+    int16_t index = 0;
+    interpreter_object* array = NULL;
+
+    if(is_store)
+        value = (kind == 3) ? pop_int(frame) : pop_word(frame);
+
+    index = pop_word(frame);
+    array = get_object(interp, pop_word(frame));
+
+    if((array == NULL) || (array->array_type == 0))
+        return throw_exception(interp, exec, INTERPRETER_NULL_POINTER_EXCEPTION);
+
+    if((index < 0) || (index >= array->length))
+        return throw_exception(interp, exec, INTERPRETER_ARRAY_INDEX_EXCEPTION);
+
+    if(is_store) {
+        array->elements[index] = (kind == 1) ? (int8_t)value : value;
+    } else if(kind == 3) {
+        push_int(frame, array->elements[index]);
+    } else {
+        push_word(frame, (int16_t)array->elements[index]);
+    }
+
+    ++frame->pc;
+
+    return 0;
+
+}
+
+
+/**
+ * Execute a getfield or putfield bytecode, in any form.
+ */
+static int access_field(interpreter* interp, execution* exec, call_frame* frame, bytecode_info* bytecode) {
+
+    u1 opcode = bytecode->opcode;
+    char is_this = (opcodes[opcode].flags & OPCODE_THIS) != 0;
+    char is_put = ((opcode >= 135) && (opcode <= 138)) || (opcode >= 177);
+    char is_int = (opcodes[opcode].flags & OPCODE_INT) != 0;
+    const void* key = bytecode->ref;
+    interpreter_object* object = NULL;
+    int32_t value = 0;
+    int32_t* field = NULL;
+
+    if(!(bytecode->ref->flags & CONSTANT_POOL_IS_EXTERNAL) && (bytecode->ref->internal_field != NULL))
+        key = bytecode->ref->internal_field;
+
+    if(is_put)
+        value = is_int ? pop_int(frame) : pop_word(frame);
+
+    object = get_object(interp, is_this ? frame->locals[0] : pop_word(frame));
+    if(object == NULL)
+        return throw_exception(interp, exec, INTERPRETER_NULL_POINTER_EXCEPTION);
+
+    if((field = get_field(&object->fields, &object->fields_count, key, 0)) == NULL)
+        return -1;
+
+    /* getfield_b and putfield_b, in any form */
+    if((opcodes[opcode].mnemonic[9] == 'b') && is_put)
+        value = (int8_t)value;
+
+    if(is_put)
+        *field = value;
+    else if(is_int)
+        push_int(frame, *field);
+    else
+        push_word(frame, (int16_t)*field);
+
+    ++frame->pc;
+
+    return 0;
+
+}
+
+
+/**
+ * Execute the current bytecode.
+ */
+static int step(interpreter* interp, execution* exec) {
+
+    call_frame* frame = exec->frames + exec->frames_count - 1;
+    bytecode_info* bytecode = NULL;
+    u1 opcode = 0;
+    u1 pops = 0;
+    u1 pushes = 0;
+    int32_t value1 = 0;
+    int32_t value2 = 0;
+    int32_t result = 0;
+    int target = 0;
+    u1 access = 0;
+    u1 kind = 0;
+    u1 local = 0;
+    u1 u1Index = 0;
+    interpreter_object* object = NULL;
+    u2 handle = 0;
+
+    if(frame->pc >= frame->method->bytecodes_count) {
+        fprintf(stderr, "Execution falls off the end of a method\n");
+        return -1;
+    }
+
+    bytecode = frame->method->bytecodes[frame->pc];
+    opcode = bytecode->opcode;
+
+    if(get_stack_effect(bytecode, &pops, &pushes) == -1)
+        return -1;
+
+    if((frame->sp < pops) || (frame->sp - pops + pushes > frame->stack_size)) {
+        fprintf(stderr, "Operand stack %s by %s\n", (frame->sp < pops) ? "underflow" : "overflow", opcodes[opcode].mnemonic);
+        return -1;
+    }
+
+    /* ret reads the return address from a local variable. */
+    if(opcode == 114) {
+        access = LOCAL_ACCESS_LOAD;
+        kind = LOCAL_SHORT;
+        local = bytecode->args[0];
+    } else {
+        access = get_local_access(bytecode, &kind, &local);
+    }
+
+    if((access != LOCAL_ACCESS_NONE) && ((local + ((kind == LOCAL_INT) ? 1 : 0)) >= frame->locals_count)) {
+        fprintf(stderr, "Local variable %u out of bounds for %s\n", local, opcodes[opcode].mnemonic);
+        return -1;
+    }
+
+    ++interp->steps;
+    ++interp->opcode_counts[opcode];
+    interp->cycles += interp->cycle_costs[opcode];
+    ++frame->profile->executions[frame->pc];
+    frame->profile->cycles += interp->cycle_costs[opcode];
+
+    if((opcode >= 2) && (opcode <= 8)) {            /* sconst_m1 to sconst_5 */
+        push_word(frame, opcode - 3);
+    } else if((opcode >= 9) && (opcode <= 15)) {    /* iconst_m1 to iconst_5 */
+        push_int(frame, opcode - 10);
+    } else if((opcode >= 21) && (opcode <= 35)) {   /* aload to iload_3 */
+        get_local_access(bytecode, &kind, &local);
+        if(kind == LOCAL_INT)
+            push_int(frame, get_int_local(frame, local));
+        else
+            push_word(frame, frame->locals[local]);
+    } else if((opcode >= 40) && (opcode <= 54)) {   /* astore to istore_3 */
+        get_local_access(bytecode, &kind, &local);
+        if(kind == LOCAL_INT)
+            set_int_local(frame, local, pop_int(frame));
+        else
+            frame->locals[local] = pop_word(frame);
+    } else if(((opcode >= 36) && (opcode <= 39)) || ((opcode >= 55) && (opcode <= 58))) {
+        return access_array(interp, exec, frame, opcode);
+    } else if(((opcode >= 65) && (opcode <= 74)) || ((opcode >= 77) && (opcode <= 88))) {     /* sadd to ixor but sneg and ineg */
+        char is_int = (opcodes[opcode].flags & OPCODE_INT) != 0;
+
+        value2 = is_int ? pop_int(frame) : pop_word(frame);
+        value1 = is_int ? pop_int(frame) : pop_word(frame);
+
+        if(!compute_operation(opcode, value1, value2, &result))
+            return throw_exception(interp, exec, INTERPRETER_ARITHMETIC_EXCEPTION);
+
+        if(is_int)
+            push_int(frame, result);
+        else
+            push_word(frame, (int16_t)result);
+    } else if(((opcode >= 96) && (opcode <= 112)) || ((opcode >= 152) && (opcode <= 168))) {  /* branches */
+        if(!is_branch_taken(frame, (opcode >= 152) ? opcodes[opcode].counterpart : opcode)) {
+            ++frame->pc;
+            return 0;
+        }
+
+        if((target = get_bytecode_index(frame->profile, bytecode->branch)) == -1)
+            return -1;
+
+        ++frame->profile->taken[frame->pc];
+        frame->pc = target;
+        return 0;
+    } else if((opcode >= 115) && (opcode <= 118)) { /* switches */
+        char is_default = 0;
+
+        value1 = (opcodes[opcode].flags & OPCODE_INT) ? pop_int(frame) : pop_word(frame);
+
+        if((target = get_bytecode_index(frame->profile, get_switch_branch(bytecode, value1, &is_default))) == -1)
+            return -1;
+
+        if(!is_default)
+            ++frame->profile->taken[frame->pc];
+        frame->pc = target;
+        return 0;
+    } else if((opcode >= 119) && (opcode <= 122)) { /* returns */
+        return_from(exec, pushes + pops);
+        return 0;
+    } else if((opcode >= 123) && (opcode <= 130)) { /* getstatic and putstatic */
+        char is_int = (opcodes[opcode].flags & OPCODE_INT) != 0;
+        int32_t* field = get_static_field(interp, bytecode->ref);
+
+        if(field == NULL)
+            return -1;
+
+        if(opcode >= 127) {
+            *field = is_int ? pop_int(frame) : pop_word(frame);
+            if(opcode == 128)   /* putstatic_b */
+                *field = (int8_t)*field;
+        } else if(is_int) {
+            push_int(frame, *field);
+        } else {
+            push_word(frame, (int16_t)*field);
+        }
+    } else if(((opcode >= 131) && (opcode <= 138)) || ((opcode >= 169) && (opcode <= 184))) {
+        return access_field(interp, exec, frame, bytecode);
+    } else if((opcode >= 139) && (opcode <= 142)) {
+        return invoke(interp, exec, bytecode, pops, pushes);
+    } else {
+        switch(opcode) {
+            case 0:     /* nop */
+                break;
+
+            case 1:     /* aconst_null */
+                push_word(frame, 0);
+                break;
+
+            case 16:    /* bspush */
+                push_word(frame, (int8_t)bytecode->args[0]);
+                break;
+
+            case 17:    /* sspush */
+                push_word(frame, (int16_t)((bytecode->args[0] << 8) | bytecode->args[1]));
+                break;
+
+            case 18:    /* bipush */
+                push_int(frame, (int8_t)bytecode->args[0]);
+                break;
+
+            case 19:    /* sipush */
+                push_int(frame, (int16_t)((bytecode->args[0] << 8) | bytecode->args[1]));
+                break;
+
+            case 20:    /* iipush */
+                push_int(frame, (int32_t)(((u4)bytecode->args[0] << 24) | ((u4)bytecode->args[1] << 16) | ((u4)bytecode->args[2] << 8) | bytecode->args[3]));
+                break;
+
+            case 59:    /* pop */
+            case 60:    /* pop2 */
+                frame->sp -= pops;
+                break;
+
+            case 61:    /* dup */
+            case 62:    /* dup2 */
+                for(; u1Index < pops; ++u1Index)
+                    push_word(frame, frame->stack[frame->sp - pops]);
+                break;
+
+            case 63: {  /* dup_x */
+                u1 m = bytecode->args[0] >> 4;
+                u1 n = bytecode->args[0] & 0x0F;
+                int16_t words[4];
+
+                for(; u1Index < m; ++u1Index)
+                    words[u1Index] = frame->stack[frame->sp - m + u1Index];
+
+                if(n != 0) {
+                    for(u1Index = 1; u1Index <= n; ++u1Index)
+                        frame->stack[frame->sp + m - u1Index] = frame->stack[frame->sp - u1Index];
+                    for(u1Index = 0; u1Index < m; ++u1Index)
+                        frame->stack[frame->sp - n + u1Index] = words[u1Index];
+                    frame->sp += m;
+                } else {
+                    for(u1Index = 0; u1Index < m; ++u1Index)
+                        push_word(frame, words[u1Index]);
+                }
+                break;
+            }
+
+            case 64: {  /* swap_x */
+                u1 m = bytecode->args[0] >> 4;
+                u1 n = bytecode->args[0] & 0x0F;
+                int16_t words[4];
+
+                for(; u1Index < m + n; ++u1Index)
+                    words[u1Index] = frame->stack[frame->sp - m - n + u1Index];
+                for(u1Index = 0; u1Index < m; ++u1Index)
+                    frame->stack[frame->sp - m - n + u1Index] = words[n + u1Index];
+                for(u1Index = 0; u1Index < n; ++u1Index)
+                    frame->stack[frame->sp - n + u1Index] = words[u1Index];
+                break;
+            }
+
+            case 75:    /* sneg */
+                push_word(frame, (int16_t)(0 - (u2)pop_word(frame)));
+                break;
+
+            case 76:    /* ineg */
+                push_int(frame, (int32_t)(0 - (u4)pop_int(frame)));
+                break;
+
+            case 89:    /* sinc */
+            case 150:   /* sinc_w */
+                value1 = (opcode == 89) ? (int8_t)bytecode->args[1] : (int16_t)((bytecode->args[1] << 8) | bytecode->args[2]);
+                frame->locals[bytecode->args[0]] = (int16_t)(u2)(frame->locals[bytecode->args[0]] + value1);
+                break;
+
+            case 90:    /* iinc */
+            case 151:   /* iinc_w */
+                value1 = (opcode == 90) ? (int8_t)bytecode->args[1] : (int16_t)((bytecode->args[1] << 8) | bytecode->args[2]);
+                set_int_local(frame, bytecode->args[0], (int32_t)((u4)get_int_local(frame, bytecode->args[0]) + (u4)value1));
+                break;
+
+            case 91:    /* s2b */
+                push_word(frame, (int8_t)pop_word(frame));
+                break;
+
+            case 92:    /* s2i */
+                push_int(frame, pop_word(frame));
+                break;
+
+            case 93:    /* i2b */
+                push_word(frame, (int8_t)pop_int(frame));
+                break;
+
+            case 94:    /* i2s */
+                push_word(frame, (int16_t)pop_int(frame));
+                break;
+
+            case 95:    /* icmp */
+                value2 = pop_int(frame);
+                value1 = pop_int(frame);
+                push_word(frame, (value1 > value2) - (value1 < value2));
+                break;
+
+            case 113:   /* jsr */
+                if((target = get_bytecode_index(frame->profile, bytecode->branch)) == -1)
+                    return -1;
+                push_word(frame, frame->pc + 1);
+                frame->pc = target;
+                return 0;
+
+            case 114:   /* ret */
+                frame->pc = (u2)frame->locals[bytecode->args[0]];
+                return 0;
+
+            case 143:   /* new */
+                if((handle = new_object(interp, (bytecode->ref->flags & CONSTANT_POOL_IS_EXTERNAL) ? NULL : bytecode->ref->internal_class, bytecode->ref, 0)) == 0)
+                    return -1;
+                push_word(frame, handle);
+                break;
+
+            case 144:   /* newarray */
+            case 145:   /* anewarray */
+                value1 = pop_word(frame);
+                if(value1 < 0)
+                    return throw_exception(interp, exec, INTERPRETER_NEGATIVE_ARRAY_SIZE_EXCEPTION);
+                if((handle = new_interpreter_array(interp, (opcode == 144) ? bytecode->args[0] : INTERPRETER_ARRAY_REFERENCE, value1)) == 0)
+                    return -1;
+                push_word(frame, handle);
+                break;
+
+            case 146:   /* arraylength */
+                if(((object = get_object(interp, pop_word(frame))) == NULL) || (object->array_type == 0))
+                    return throw_exception(interp, exec, INTERPRETER_NULL_POINTER_EXCEPTION);
+                push_word(frame, object->length);
+                break;
+
+            case 147:   /* athrow */
+                return throw_object(interp, exec, pop_word(frame));
+
+            case 148:   /* checkcast */
+                if(((object = get_object(interp, frame->stack[frame->sp - 1])) != NULL) && !is_of_type(object, bytecode))
+                    return throw_exception(interp, exec, INTERPRETER_CLASS_CAST_EXCEPTION);
+                break;
+
+            case 149:   /* instanceof */
+                object = get_object(interp, pop_word(frame));
+                push_word(frame, (object != NULL) && is_of_type(object, bytecode));
+                break;
+
+            default:
+                fprintf(stderr, "Cannot interpret %s\n", opcodes[opcode].mnemonic);
+                return -1;
+        }
+    }
+
+    ++frame->pc;
+
+    return 0;
+
+}
+
+
+int interpret_method(interpreter* interp, method_info* method, const int16_t* args, u1 args_count, int16_t* result, u1* result_count) {
+
+    execution exec;
+    u4 steps = 0;
+
+    memset(&exec, 0, sizeof(execution));
+
+    if(push_frame(interp, &exec, method, args, args_count) == -1)
+        return -1;
+
+    while(!exec.done) {
+        if((interp->max_steps != 0) && (steps++ >= interp->max_steps)) {
+            fprintf(stderr, "More than %u bytecodes executed\n", interp->max_steps);
+            break;
+        }
+
+        if(step(interp, &exec) == -1)
+            break;
+    }
+
+    if(!exec.done) {
+        while(exec.frames_count != 0)
+            pop_frame(&exec);
+        free(exec.frames);
+        return -1;
+    }
+
+    free(exec.frames);
+
+    if(result != NULL) {
+        result[0] = exec.result[0];
+        result[1] = exec.result[1];
+    }
+
+    if(result_count != NULL)
+        *result_count = exec.result_count;
+
+    return exec.outcome;
+
+}
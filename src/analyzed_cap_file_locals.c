@@ -0,0 +1,538 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_locals.c
+ * \brief Renumber the local variables of analyzed methods so that variables
+ * which are never live at the same time share a slot.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_locals.h"
+#include "analyzed_cap_file_frame.h"
+#include "bytecodes.h"
+
+
+/**
+ * A local variable which is not a parameter.
+ */
+typedef struct {
+    u1 local;   /**< The original slot. */
+    u1 width;   /**< 2 for an int, 1 else. */
+    u1 slot;    /**< The new slot. */
+    u2 uses;    /**< How many bytecodes use it. */
+    u1 assigned;    /**< Was the new slot chosen? */
+} variable_info;
+
+
+/**
+ * What is computed about a method while renumbering its locals.
+ */
+typedef struct {
+    u2 variables_count;         /**< The number of variables. */
+    variable_info* variables;   /**< The variables. */
+    int* accesses;              /**< Variable used by each bytecode or -1. */
+    u2* successors_count;       /**< Number of successors of each bytecode. */
+    u2** successors;            /**< Successors of each bytecode. */
+    u1* live_in;                /**< Variables live before each bytecode. */
+    u1* live_out;               /**< Variables live after each bytecode. */
+    u1* interferences;          /**< Pairs of variables live together. */
+} locals_info;
+
+
+/**
+ * Free what was computed about a method.
+ */
+static void free_locals_info(method_info* method, locals_info* info) {
+
+    u2 u2Index = 0;
+
+    if(info->successors != NULL)
+        for(; u2Index < method->bytecodes_count; ++u2Index)
+            free(info->successors[u2Index]);
+
+    free(info->variables);
+    free(info->accesses);
+    free(info->successors_count);
+    free(info->successors);
+    free(info->live_in);
+    free(info->live_out);
+    free(info->interferences);
+
+}
+
+
+/**
+ * Find the variables of a method. Return -1 if an error occurred, 1 if the
+ * locals of the method cannot be renumbered, 0 else.
+ */
+static int find_variables(method_info* method, u1 nargs, locals_info* info) {
+
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < method->bytecodes_count; ++u2Index1) {
+        u1 kind = 0;
+        u1 local = 0;
+        u1 width = 0;
+        u1 access = get_local_access(method->bytecodes[u2Index1], &kind, &local);
+        u2 u2Index2 = 0;
+
+        info->accesses[u2Index1] = -1;
+
+        /* Subroutines hide the flow of control. */
+        if((method->bytecodes[u2Index1]->opcode == 113) || (method->bytecodes[u2Index1]->opcode == 114))
+            return 1;
+
+        if(access == LOCAL_ACCESS_NONE)
+            continue;
+
+        width = (kind == LOCAL_INT) ? 2 : 1;
+
+        if(local < nargs) {
+            if(local + width > nargs)
+                return 1;
+            continue;
+        }
+
+        for(; u2Index2 < info->variables_count; ++u2Index2)
+            if(info->variables[u2Index2].local == local)
+                break;
+
+        if(u2Index2 == info->variables_count) {
+            variable_info* tmp = (variable_info*)realloc(info->variables, sizeof(variable_info) * (info->variables_count + 1));
+            if(tmp == NULL) {
+                perror("find_variables");
+                return -1;
+            }
+            info->variables = tmp;
+
+            info->variables[info->variables_count].local = local;
+            info->variables[info->variables_count].width = width;
+            info->variables[info->variables_count].slot = local;
+            info->variables[info->variables_count].uses = 0;
+            info->variables[info->variables_count].assigned = 0;
+            ++info->variables_count;
+        } else if(info->variables[u2Index2].width != width) {
+            return 1;
+        }
+
+        ++info->variables[u2Index2].uses;
+        info->accesses[u2Index1] = u2Index2;
+    }
+
+    /* An int sharing a word with another variable cannot be moved alone. */
+    for(u2Index1 = 0; u2Index1 < info->variables_count; ++u2Index1) {
+        u2 u2Index2 = u2Index1 + 1;
+
+        for(; u2Index2 < info->variables_count; ++u2Index2)
+            if((info->variables[u2Index1].local < info->variables[u2Index2].local + info->variables[u2Index2].width) && (info->variables[u2Index2].local < info->variables[u2Index1].local + info->variables[u2Index1].width))
+                return 1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Add a successor to a bytecode.
+ */
+static int add_successor(method_info* method, locals_info* info, u2 index, bytecode_info* target) {
+
+    int target_index = find_bytecode_index(method, target);
+    u2* tmp = NULL;
+
+    if(target_index == -1)
+        return -1;
+
+    tmp = (u2*)realloc(info->successors[index], sizeof(u2) * (info->successors_count[index] + 1));
+    if(tmp == NULL) {
+        perror("add_successor");
+        return -1;
+    }
+    info->successors[index] = tmp;
+
+    info->successors[index][info->successors_count[index]++] = target_index;
+
+    return 0;
+
+}
+
+
+/**
+ * Find the bytecodes which might be executed after each bytecode.
+ */
+static int find_successors(method_info* method, locals_info* info) {
+
+    u2 u2Index1 = 0;
+    u1 u1Index = 0;
+
+    for(; u2Index1 < method->bytecodes_count; ++u2Index1) {
+        bytecode_info* bytecode = method->bytecodes[u2Index1];
+        u2 u2Index2 = 0;
+
+        if(!(opcodes[bytecode->opcode].flags & OPCODE_UNCONDITIONAL) && (u2Index1 + 1 < method->bytecodes_count))
+            if(add_successor(method, info, u2Index1, method->bytecodes[u2Index1 + 1]) == -1)
+                return -1;
+
+        if(bytecode->has_branch && (add_successor(method, info, u2Index1, bytecode->branch) == -1))
+            return -1;
+
+        switch(bytecode->opcode) {
+            case 115:
+                if(add_successor(method, info, u2Index1, bytecode->switch_data->stableswitch.default_branch) == -1)
+                    return -1;
+                for(; u2Index2 < bytecode->switch_data->stableswitch.nb_cases; ++u2Index2)
+                    if(add_successor(method, info, u2Index1, bytecode->switch_data->stableswitch.branches[u2Index2]) == -1)
+                        return -1;
+                break;
+
+            case 116:
+                if(add_successor(method, info, u2Index1, bytecode->switch_data->itableswitch.default_branch) == -1)
+                    return -1;
+                for(; u2Index2 < bytecode->switch_data->itableswitch.nb_cases; ++u2Index2)
+                    if(add_successor(method, info, u2Index1, bytecode->switch_data->itableswitch.branches[u2Index2]) == -1)
+                        return -1;
+                break;
+
+            case 117:
+                if(add_successor(method, info, u2Index1, bytecode->switch_data->slookupswitch.default_branch) == -1)
+                    return -1;
+                for(; u2Index2 < bytecode->switch_data->slookupswitch.nb_cases; ++u2Index2)
+                    if(add_successor(method, info, u2Index1, bytecode->switch_data->slookupswitch.cases[u2Index2].branch) == -1)
+                        return -1;
+                break;
+
+            case 118:
+                if(add_successor(method, info, u2Index1, bytecode->switch_data->ilookupswitch.default_branch) == -1)
+                    return -1;
+                for(; u2Index2 < bytecode->switch_data->ilookupswitch.nb_cases; ++u2Index2)
+                    if(add_successor(method, info, u2Index1, bytecode->switch_data->ilookupswitch.cases[u2Index2].branch) == -1)
+                        return -1;
+                break;
+        }
+    }
+
+    /* Any bytecode of a try block might continue in the handler. */
+    for(; u1Index < method->exception_handlers_count; ++u1Index) {
+        exception_handler_info* handler = method->exception_handlers[u1Index];
+        char in_range = 0;
+
+        for(u2Index1 = 0; u2Index1 < method->bytecodes_count; ++u2Index1) {
+            if(method->bytecodes[u2Index1] == handler->start)
+                in_range = 1;
+            if(method->bytecodes[u2Index1] == handler->end)
+                in_range = 0;
+            if(in_range && (add_successor(method, info, u2Index1, handler->handler) == -1))
+                return -1;
+        }
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Compute the variables live before and after each bytecode.
+ */
+static void compute_liveness(method_info* method, locals_info* info) {
+
+    u2 count = info->variables_count;
+    char changed = 1;
+
+    while(changed) {
+        u2 u2Index1 = method->bytecodes_count;
+
+        changed = 0;
+
+        while(u2Index1-- > 0) {
+            u1* in = info->live_in + (u4)u2Index1 * count;
+            u1* out = info->live_out + (u4)u2Index1 * count;
+            u1 access = LOCAL_ACCESS_NONE;
+            u1 kind = 0;
+            u1 local = 0;
+            u2 u2Index2 = 0;
+
+            for(; u2Index2 < info->successors_count[u2Index1]; ++u2Index2) {
+                u1* successor_in = info->live_in + (u4)info->successors[u2Index1][u2Index2] * count;
+                u2 u2Index3 = 0;
+
+                for(; u2Index3 < count; ++u2Index3)
+                    out[u2Index3] |= successor_in[u2Index3];
+            }
+
+            if(info->accesses[u2Index1] != -1)
+                access = get_local_access(method->bytecodes[u2Index1], &kind, &local);
+
+            for(u2Index2 = 0; u2Index2 < count; ++u2Index2) {
+                u1 live = out[u2Index2];
+
+                if(info->accesses[u2Index1] == (int)u2Index2)
+                    live = (access != LOCAL_ACCESS_STORE);
+
+                if(live && !in[u2Index2]) {
+                    in[u2Index2] = 1;
+                    changed = 1;
+                }
+            }
+        }
+    }
+
+}
+
+
+/**
+ * Record which variables are live at the same time.
+ */
+static void compute_interferences(method_info* method, locals_info* info) {
+
+    u2 count = info->variables_count;
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < method->bytecodes_count; ++u2Index1) {
+        u1* in = info->live_in + (u4)u2Index1 * count;
+        u1* out = info->live_out + (u4)u2Index1 * count;
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < count; ++u2Index2) {
+            /* A stored variable must not overwrite any variable live after. */
+            char defined = (info->accesses[u2Index1] == (int)u2Index2);
+            u2 u2Index3 = 0;
+
+            for(; u2Index3 < count; ++u2Index3)
+                if((u2Index2 != u2Index3) && ((in[u2Index2] && in[u2Index3]) || ((out[u2Index2] || defined) && out[u2Index3]))) {
+                    info->interferences[(u4)u2Index2 * count + u2Index3] = 1;
+                    info->interferences[(u4)u2Index3 * count + u2Index2] = 1;
+                }
+        }
+    }
+
+}
+
+
+/**
+ * Give a slot to each variable, the most used first.
+ */
+static void assign_slots(locals_info* info, u1 nargs) {
+
+    u2 count = info->variables_count;
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < count; ++u2Index1) {
+        variable_info* variable = NULL;
+        int best = -1;
+        u2 u2Index2 = 0;
+        u2 slot = nargs;
+
+        for(; u2Index2 < count; ++u2Index2)
+            if(!info->variables[u2Index2].assigned && ((best == -1) || (info->variables[u2Index2].uses > info->variables[best].uses)))
+                best = u2Index2;
+
+        variable = info->variables + best;
+
+        for(;; ++slot) {
+            for(u2Index2 = 0; u2Index2 < count; ++u2Index2)
+                if(info->variables[u2Index2].assigned && info->interferences[(u4)best * count + u2Index2] && (slot < info->variables[u2Index2].slot + info->variables[u2Index2].width) && (info->variables[u2Index2].slot < slot + variable->width))
+                    break;
+
+            if(u2Index2 == count)
+                break;
+        }
+
+        variable->slot = slot;
+        variable->assigned = 1;
+    }
+
+}
+
+
+/**
+ * Get the size in byte of a local variable access to the given slot.
+ */
+static u1 get_access_size(u1 access, u1 slot, bytecode_info* bytecode) {
+
+    if(access == LOCAL_ACCESS_INC)
+        return bytecode->nb_args + 1;
+
+    return (slot <= 3) ? 1 : 2;
+
+}
+
+
+int allocate_method_locals(method_info* method, u2* slots_saved, u2* bytes_saved) {
+
+    locals_info info;
+    u1 nargs = get_signature_words(method->signature, NULL);
+    u2 old_top = 0;
+    u2 new_top = 0;
+    u2 old_size = 0;
+    u2 new_size = 0;
+    u2 u2Index = 0;
+    int rc = 0;
+
+    *slots_saved = 0;
+    *bytes_saved = 0;
+
+    if(!(method->flags & METHOD_STATIC))
+        ++nargs;
+
+    if(method->bytecodes_count == 0)
+        return 0;
+
+    info.variables_count = 0;
+    info.variables = NULL;
+    info.successors = NULL;
+    info.live_in = NULL;
+    info.live_out = NULL;
+    info.interferences = NULL;
+    info.successors_count = (u2*)calloc(method->bytecodes_count, sizeof(u2));
+    info.accesses = (int*)malloc(sizeof(int) * method->bytecodes_count);
+    if((info.successors_count == NULL) || (info.accesses == NULL)) {
+        perror("allocate_method_locals");
+        free_locals_info(method, &info);
+        return -1;
+    }
+
+    if((rc = find_variables(method, nargs, &info)) != 0) {
+        free_locals_info(method, &info);
+        return (rc == -1) ? -1 : 0;
+    }
+
+    if(info.variables_count == 0) {
+        free_locals_info(method, &info);
+        return 0;
+    }
+
+    info.successors = (u2**)calloc(method->bytecodes_count, sizeof(u2*));
+    info.live_in = (u1*)calloc((u4)method->bytecodes_count * info.variables_count, sizeof(u1));
+    info.live_out = (u1*)calloc((u4)method->bytecodes_count * info.variables_count, sizeof(u1));
+    info.interferences = (u1*)calloc((u4)info.variables_count * info.variables_count, sizeof(u1));
+    if((info.successors == NULL) || (info.live_in == NULL) || (info.live_out == NULL) || (info.interferences == NULL)) {
+        perror("allocate_method_locals");
+        free_locals_info(method, &info);
+        return -1;
+    }
+
+    if(find_successors(method, &info) == -1) {
+        free_locals_info(method, &info);
+        return -1;
+    }
+
+    compute_liveness(method, &info);
+    compute_interferences(method, &info);
+    assign_slots(&info, nargs);
+
+    for(u2Index = 0; u2Index < info.variables_count; ++u2Index) {
+        if(info.variables[u2Index].local + info.variables[u2Index].width > old_top)
+            old_top = info.variables[u2Index].local + info.variables[u2Index].width;
+        if(info.variables[u2Index].slot + info.variables[u2Index].width > new_top)
+            new_top = info.variables[u2Index].slot + info.variables[u2Index].width;
+    }
+
+    for(u2Index = 0; u2Index < method->bytecodes_count; ++u2Index)
+        if(info.accesses[u2Index] != -1) {
+            u1 kind = 0;
+            u1 local = 0;
+            u1 access = get_local_access(method->bytecodes[u2Index], &kind, &local);
+
+            old_size += method->bytecodes[u2Index]->nb_args + 1;
+            new_size += get_access_size(access, info.variables[info.accesses[u2Index]].slot, method->bytecodes[u2Index]);
+        }
+
+    /* Keep the method as is unless something is gained. */
+    if((new_top > 255) || (new_top > old_top) || (new_size > old_size) || ((new_top == old_top) && (new_size == old_size))) {
+        free_locals_info(method, &info);
+        return 0;
+    }
+
+    for(u2Index = 0; u2Index < method->bytecodes_count; ++u2Index)
+        if(info.accesses[u2Index] != -1)
+            set_local_access(method->bytecodes[u2Index], info.variables[info.accesses[u2Index]].slot);
+
+    method->bytecodes_size -= old_size - new_size;
+    method->needs_layout = 1;
+    *slots_saved = old_top - new_top;
+    *bytes_saved = old_size - new_size;
+
+    free_locals_info(method, &info);
+
+    return 0;
+
+}
+
+
+int allocate_locals(analyzed_cap_file* acf, locals_report* report) {
+
+    locals_report local_report;
+    u2 u2Index1 = 0;
+
+    if(report == NULL)
+        report = &local_report;
+
+    report->methods_changed = 0;
+    report->slots_saved = 0;
+    report->bytes_saved = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            u2 slots_saved = 0;
+            u2 bytes_saved = 0;
+
+            if(allocate_method_locals(acf->classes[u2Index1]->methods[u2Index2], &slots_saved, &bytes_saved) == -1)
+                return -1;
+
+            if(slots_saved || bytes_saved) {
+                acf->dirty_components |= COMPONENT_BIT(COMPONENT_METHOD);
+                ++report->methods_changed;
+                report->slots_saved += slots_saved;
+                report->bytes_saved += bytes_saved;
+            }
+        }
+    }
+
+    return 0;
+
+}
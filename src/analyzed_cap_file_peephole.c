@@ -0,0 +1,442 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_peephole.c
+ * \brief Rewrite short sequences of analyzed bytecodes into smaller
+ * equivalent ones before generating a CAP file.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_edit.h"
+#include "analyzed_cap_file_peephole.h"
+#include "bytecodes.h"
+
+
+
+const peephole_rule default_peephole_rules[] = {
+    peephole_shorter_push,
+    peephole_shorter_local,
+    peephole_jump_to_next,
+    peephole_load_store,
+    peephole_push_pop,
+    peephole_redundant_checkcast,
+    peephole_unreachable,
+    NULL
+};
+
+
+/**
+ * Change the opcode of a bytecode without arguments or with byte arguments
+ * only.
+ */
+static void set_opcode(bytecode_info* bytecode, u1 opcode) {
+
+    bytecode->opcode = opcode;
+    bytecode->nb_args = opcodes[opcode].nb_args;
+    bytecode->nb_byte_args = opcodes[opcode].nb_args;
+
+}
+
+
+/**
+ * Return the bytecode following the one at the given index if it is not a
+ * target, NULL else.
+ */
+static bytecode_info* get_next_untargeted(method_info* method, u2 index) {
+
+    if((index + 1) >= method->bytecodes_count)
+        return NULL;
+
+    if(is_bytecode_target(method, method->bytecodes[index + 1]))
+        return NULL;
+
+    return method->bytecodes[index + 1];
+
+}
+
+
+int is_bytecode_target(method_info* method, bytecode_info* bytecode) {
+
+    u2 u2Index1 = 0;
+    u1 u1Index = 0;
+
+    for(; u1Index < method->exception_handlers_count; ++u1Index)
+        if((method->exception_handlers[u1Index]->start == bytecode) || (method->exception_handlers[u1Index]->end == bytecode) || (method->exception_handlers[u1Index]->handler == bytecode))
+            return 1;
+
+    for(; u2Index1 < method->bytecodes_count; ++u2Index1) {
+        bytecode_info* crt = method->bytecodes[u2Index1];
+        switch_info* data = crt->switch_data;
+        u2 u2Index2 = 0;
+
+        if(crt->has_branch && (crt->branch == bytecode))
+            return 1;
+
+        if(data == NULL)
+            continue;
+
+        switch(opcodes[crt->opcode].format) {
+            case OPCODE_FORMAT_STABLESWITCH:
+                if(data->stableswitch.default_branch == bytecode)
+                    return 1;
+                for(; u2Index2 < data->stableswitch.nb_cases; ++u2Index2)
+                    if(data->stableswitch.branches[u2Index2] == bytecode)
+                        return 1;
+                break;
+
+            case OPCODE_FORMAT_ITABLESWITCH:
+                if(data->itableswitch.default_branch == bytecode)
+                    return 1;
+                for(; u2Index2 < data->itableswitch.nb_cases; ++u2Index2)
+                    if(data->itableswitch.branches[u2Index2] == bytecode)
+                        return 1;
+                break;
+
+            case OPCODE_FORMAT_SLOOKUPSWITCH:
+                if(data->slookupswitch.default_branch == bytecode)
+                    return 1;
+                for(; u2Index2 < data->slookupswitch.nb_cases; ++u2Index2)
+                    if(data->slookupswitch.cases[u2Index2].branch == bytecode)
+                        return 1;
+                break;
+
+            case OPCODE_FORMAT_ILOOKUPSWITCH:
+                if(data->ilookupswitch.default_branch == bytecode)
+                    return 1;
+                for(; u2Index2 < data->ilookupswitch.nb_cases; ++u2Index2)
+                    if(data->ilookupswitch.cases[u2Index2].branch == bytecode)
+                        return 1;
+                break;
+        }
+    }
+
+    return 0;
+
+}
+
+
+int peephole_shorter_push(analyzed_cap_file* acf, method_info* method, u2 index) {
+
+    bytecode_info* bytecode = method->bytecodes[index];
+    u1 old_size = bytecode->nb_args;
+    int32_t value = 0;
+
+    (void)acf;
+
+    switch(bytecode->opcode) {
+        case 16:    /* bspush */
+            value = (int8_t)bytecode->args[0];
+            break;
+
+        case 17:    /* sspush */
+            value = (int16_t)((bytecode->args[0] << 8) | bytecode->args[1]);
+            break;
+
+        case 18:    /* bipush */
+            value = (int8_t)bytecode->args[0];
+            break;
+
+        case 19:    /* sipush */
+            value = (int16_t)((bytecode->args[0] << 8) | bytecode->args[1]);
+            break;
+
+        case 20:    /* iipush */
+            value = (int32_t)(((u4)bytecode->args[0] << 24) | ((u4)bytecode->args[1] << 16) | ((u4)bytecode->args[2] << 8) | bytecode->args[3]);
+            break;
+
+        default:
+            return 0;
+    }
+
+    if(bytecode->opcode <= 17) {
+        if((value >= -1) && (value <= 5))
+            set_opcode(bytecode, 3 + value);    /* sconst_<n> */
+        else if((value >= -128) && (value <= 127))
+            set_opcode(bytecode, 16);           /* bspush */
+    } else {
+        if((value >= -1) && (value <= 5)) {
+            set_opcode(bytecode, 10 + value);   /* iconst_<n> */
+        } else if((value >= -128) && (value <= 127)) {
+            set_opcode(bytecode, 18);           /* bipush */
+        } else if((value >= -32768) && (value <= 32767)) {
+            set_opcode(bytecode, 19);           /* sipush */
+            bytecode->args[0] = (value >> 8) & 0xFF;
+            bytecode->args[1] = value & 0xFF;
+        }
+    }
+
+    if(bytecode->nb_args == 1)
+        bytecode->args[0] = value & 0xFF;
+
+    return bytecode->nb_args < old_size;
+
+}
+
+
+int peephole_shorter_local(analyzed_cap_file* acf, method_info* method, u2 index) {
+
+    bytecode_info* bytecode = method->bytecodes[index];
+    u1 kind = 0;
+    u1 local = 0;
+    u1 access = get_local_access(bytecode, &kind, &local);
+
+    (void)acf;
+
+    if((bytecode->nb_args == 0) || ((access != LOCAL_ACCESS_LOAD) && (access != LOCAL_ACCESS_STORE)) || (local > 3))
+        return 0;
+
+    set_local_access(bytecode, local);
+
+    return 1;
+
+}
+
+
+int peephole_jump_to_next(analyzed_cap_file* acf, method_info* method, u2 index) {
+
+    bytecode_info* bytecode = method->bytecodes[index];
+    const opcode_info* opcode = &opcodes[bytecode->opcode];
+
+    (void)acf;
+
+    if((opcode->format != OPCODE_FORMAT_BRANCH) || (bytecode->opcode == 113) || ((index + 1) >= method->bytecodes_count) || (bytecode->branch != method->bytecodes[index + 1]))
+        return 0;
+
+    if(opcode->flags & OPCODE_UNCONDITIONAL)
+        return (remove_bytecodes(method, index, 1) == -1) ? -1 : 1;
+
+    /* The branch is taken or not, either way its operands are popped. */
+    set_opcode(bytecode, (opcode->pops == 1) ? 59 : 60);    /* pop or pop2 */
+    bytecode->has_branch = 0;
+    bytecode->branch = NULL;
+
+    return 1;
+
+}
+
+
+int peephole_load_store(analyzed_cap_file* acf, method_info* method, u2 index) {
+
+    bytecode_info* next = get_next_untargeted(method, index);
+    u1 load_kind = 0;
+    u1 load_local = 0;
+    u1 store_kind = 0;
+    u1 store_local = 0;
+
+    (void)acf;
+
+    if((next == NULL) || (get_local_access(method->bytecodes[index], &load_kind, &load_local) != LOCAL_ACCESS_LOAD))
+        return 0;
+
+    if(get_local_access(next, &store_kind, &store_local) != LOCAL_ACCESS_STORE)
+        return 0;
+
+    if((load_kind != store_kind) || (load_local != store_local))
+        return 0;
+
+    return (remove_bytecodes(method, index, 2) == -1) ? -1 : 1;
+
+}
+
+
+int peephole_push_pop(analyzed_cap_file* acf, method_info* method, u2 index) {
+
+    bytecode_info* bytecode = method->bytecodes[index];
+    bytecode_info* next = get_next_untargeted(method, index);
+    u1 opcode = bytecode->opcode;
+
+    (void)acf;
+
+    if(next == NULL)
+        return 0;
+
+    /* dup pushes one word more than it pops, dup2 two words more. */
+    if(((opcode == 61) && (next->opcode == 59)) || ((opcode == 62) && (next->opcode == 60)))
+        return (remove_bytecodes(method, index, 2) == -1) ? -1 : 1;
+
+    /* aconst_null to iload_3 only push a value. */
+    if((opcode < 1) || (opcode > 35))
+        return 0;
+
+    if(((opcodes[opcode].pushes == 1) && (next->opcode == 59)) || ((opcodes[opcode].pushes == 2) && (next->opcode == 60)))
+        return (remove_bytecodes(method, index, 2) == -1) ? -1 : 1;
+
+    return 0;
+
+}
+
+
+/**
+ * Is a class reference java.lang.Object, class token 0 of the package with
+ * the AID A0000000620001?
+ */
+static int is_object_classref(const constant_pool_entry_info* ref) {
+
+    static const u1 java_lang_aid[] = {0xA0, 0x00, 0x00, 0x00, 0x62, 0x00, 0x01};
+
+    if((ref == NULL) || !(ref->flags & CONSTANT_POOL_IS_EXTERNAL) || (ref->external_package == NULL) || (ref->external_class_token != 0))
+        return 0;
+
+    return (ref->external_package->aid_length == sizeof(java_lang_aid)) && (memcmp(ref->external_package->aid, java_lang_aid, sizeof(java_lang_aid)) == 0);
+
+}
+
+
+int peephole_redundant_checkcast(analyzed_cap_file* acf, method_info* method, u2 index) {
+
+    bytecode_info* bytecode = method->bytecodes[index];
+    bytecode_info* next = NULL;
+
+    (void)acf;
+
+    /* A checkcast to Object never fails. */
+    if((bytecode->opcode == 148) && (bytecode->args[0] == 0) && is_object_classref(bytecode->ref))
+        return (remove_bytecodes(method, index, 1) == -1) ? -1 : 1;
+
+    if(((next = get_next_untargeted(method, index)) == NULL) || (next->opcode != 148))   /* checkcast */
+        return 0;
+
+    /* Only class and reference array checkcasts have a constant pool entry. */
+    if((bytecode->opcode == 1) ||   /* aconst_null */
+       ((bytecode->opcode == 148) && (bytecode->args[0] == next->args[0]) && (((next->args[0] != 0) && (next->args[0] != 14)) || (bytecode->ref == next->ref))))
+        return (remove_bytecodes(method, index + 1, 1) == -1) ? -1 : 1;
+
+    return 0;
+
+}
+
+
+int peephole_unreachable(analyzed_cap_file* acf, method_info* method, u2 index) {
+
+    (void)acf;
+
+    if(!(opcodes[method->bytecodes[index]->opcode].flags & OPCODE_UNCONDITIONAL) || (get_next_untargeted(method, index) == NULL))
+        return 0;
+
+    return (remove_bytecodes(method, index + 1, 1) == -1) ? -1 : 1;
+
+}
+
+
+/**
+ * Compute the size in byte of the bytecodes of a method.
+ */
+static u2 get_bytecodes_size(method_info* method) {
+
+    u2 size = 0;
+    u2 u2Index = 0;
+
+    for(; u2Index < method->bytecodes_count; ++u2Index)
+        size += method->bytecodes[u2Index]->nb_args + 1;
+
+    return size;
+
+}
+
+
+int peephole_optimize(analyzed_cap_file* acf, const peephole_rule* rules, peephole_report** reports, u2* reports_count) {
+
+    u2 u2Index1 = 0;
+
+    if(rules == NULL)
+        rules = default_peephole_rules;
+
+    if(reports != NULL) {
+        *reports = NULL;
+        *reports_count = 0;
+    }
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            method_info* method = acf->classes[u2Index1]->methods[u2Index2];
+            u2 old_size = get_bytecodes_size(method);
+            char changed = 1;
+
+            while(changed) {
+                u2 u2Index3 = 0;
+
+                changed = 0;
+
+                for(; u2Index3 < method->bytecodes_count; ++u2Index3) {
+                    const peephole_rule* rule = rules;
+
+                    for(; (*rule != NULL) && (u2Index3 < method->bytecodes_count); ++rule) {
+                        int rc = (*rule)(acf, method, u2Index3);
+
+                        if(rc == -1)
+                            return -1;
+
+                        if(rc == 1) {
+                            changed = 1;
+                            method->needs_layout = 1;
+                            acf->dirty_components |= COMPONENT_BIT(COMPONENT_METHOD);
+                        }
+                    }
+                }
+            }
+
+            method->bytecodes_size = get_bytecodes_size(method);
+
+            if((reports != NULL) && (method->bytecodes_size < old_size)) {
+                peephole_report* tmp = (peephole_report*)realloc(*reports, sizeof(peephole_report) * (*reports_count + 1));
+                if(tmp == NULL) {
+                    perror("peephole_optimize");
+                    return -1;
+                }
+                *reports = tmp;
+
+                (*reports)[*reports_count].class_index = u2Index1;
+                (*reports)[*reports_count].method_index = u2Index2;
+                (*reports)[*reports_count].bytes_saved = old_size - method->bytecodes_size;
+                ++*reports_count;
+            }
+        }
+    }
+
+    return 0;
+
+}
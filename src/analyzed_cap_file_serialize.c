@@ -0,0 +1,557 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_serialize.c
+ * \brief Output an analyzed CAP file as a JSON or CBOR document.
+ */
+
+#include <string.h>
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_serialize.h"
+#include "structured_writer.h"
+#include "bytecodes.h"
+
+static const structured_flag interface_flags[] = {{INTERFACE_SHAREABLE, "SHAREABLE"}, {INTERFACE_REMOTE, "REMOTE"}, {INTERFACE_PUBLIC, "PUBLIC"}, {INTERFACE_PACKAGE, "PACKAGE"}, {INTERFACE_ABSTRACT, "ABSTRACT"}, {0, NULL}};
+static const structured_flag class_flags[] = {{CLASS_PUBLIC, "PUBLIC"}, {CLASS_PACKAGE, "PACKAGE"}, {CLASS_FINAL, "FINAL"}, {CLASS_ABSTRACT, "ABSTRACT"}, {CLASS_SHAREABLE, "SHAREABLE"}, {CLASS_REMOTE, "REMOTE"}, {CLASS_APPLET, "APPLET"}, {0, NULL}};
+static const structured_flag field_flags[] = {{FIELD_PUBLIC, "PUBLIC"}, {FIELD_PRIVATE, "PRIVATE"}, {FIELD_PROTECTED, "PROTECTED"}, {FIELD_PACKAGE, "PACKAGE"}, {FIELD_STATIC, "STATIC"}, {FIELD_FINAL, "FINAL"}, {0, NULL}};
+static const structured_flag method_flags[] = {{METHOD_PUBLIC, "PUBLIC"}, {METHOD_PRIVATE, "PRIVATE"}, {METHOD_PROTECTED, "PROTECTED"}, {METHOD_PACKAGE, "PACKAGE"}, {METHOD_STATIC, "STATIC"}, {METHOD_FINAL, "FINAL"}, {METHOD_ABSTRACT, "ABSTRACT"}, {METHOD_INIT, "INIT"}, {METHOD_EXTENDED, "EXTENDED"}, {0, NULL}};
+
+
+/**
+ * Write one type as an object with its name and, for references, the
+ * constant pool index of its class.
+ */
+static void write_one_type(structured_writer* writer, one_type_descriptor_info* type) {
+
+    const char* name = "void";
+
+    if(type->type & TYPE_DESCRIPTOR_BOOLEAN)
+        name = "boolean";
+    else if(type->type & TYPE_DESCRIPTOR_BYTE)
+        name = "byte";
+    else if(type->type & TYPE_DESCRIPTOR_SHORT)
+        name = "short";
+    else if(type->type & TYPE_DESCRIPTOR_INT)
+        name = "int";
+    else if(type->type & TYPE_DESCRIPTOR_REF)
+        name = "ref";
+
+    begin_object(writer);
+    write_string_member(writer, "type", name);
+
+    if(type->type & TYPE_DESCRIPTOR_ARRAY) {
+        write_key(writer, "array");
+        write_bool(writer, 1);
+    }
+
+    if(type->ref != NULL)
+        write_uint_member(writer, "ref", type->ref->my_index);
+
+    end_object(writer);
+
+}
+
+
+/**
+ * Write a type or a signature as an array of types, the return type of a
+ * signature coming last. A missing one is null.
+ */
+static void write_type_descriptor(structured_writer* writer, const char* key, type_descriptor_info* desc) {
+
+    u1 u1Index = 0;
+
+    write_key(writer, key);
+
+    if(desc == NULL) {
+        write_null(writer);
+        return;
+    }
+
+    begin_array(writer);
+
+    for(; u1Index < desc->types_count; ++u1Index)
+        write_one_type(writer, desc->types + u1Index);
+
+    end_array(writer);
+
+}
+
+
+/**
+ * Write the constant info and the imported packages.
+ */
+static void write_constant_info(structured_writer* writer, analyzed_cap_file* acf) {
+
+    u1 u1Index = 0;
+
+    write_key(writer, "info");
+    begin_object(writer);
+    write_uint_member(writer, "javacard_minor_version", acf->info.javacard_minor_version);
+    write_uint_member(writer, "javacard_major_version", acf->info.javacard_major_version);
+    write_uint_member(writer, "package_minor_version", acf->info.package_minor_version);
+    write_uint_member(writer, "package_major_version", acf->info.package_major_version);
+    write_bytes_member(writer, "package_aid", acf->info.package_aid, acf->info.package_aid_length);
+
+    if(acf->info.has_package_name && (acf->info.package_name != NULL))
+        write_string_member(writer, "package_name", acf->info.package_name);
+
+    write_key(writer, "custom_components");
+    begin_array(writer);
+
+    for(; u1Index < acf->info.custom_count; ++u1Index) {
+        begin_object(writer);
+        write_uint_member(writer, "tag", acf->info.custom_components[u1Index].tag);
+        write_uint_member(writer, "size", acf->info.custom_components[u1Index].size);
+        write_bytes_member(writer, "aid", acf->info.custom_components[u1Index].aid, acf->info.custom_components[u1Index].aid_length);
+        end_object(writer);
+    }
+
+    end_array(writer);
+    end_object(writer);
+
+    write_key(writer, "imported_packages");
+    begin_array(writer);
+
+    for(u1Index = 0; u1Index < acf->imported_packages_count; ++u1Index) {
+        begin_object(writer);
+        write_uint_member(writer, "my_index", acf->imported_packages[u1Index]->my_index);
+        write_uint_member(writer, "count", acf->imported_packages[u1Index]->count);
+        write_uint_member(writer, "minor_version", acf->imported_packages[u1Index]->minor_version);
+        write_uint_member(writer, "major_version", acf->imported_packages[u1Index]->major_version);
+        write_bytes_member(writer, "aid", acf->imported_packages[u1Index]->aid, acf->imported_packages[u1Index]->aid_length);
+        end_object(writer);
+    }
+
+    end_array(writer);
+
+}
+
+
+/**
+ * Write the constant pool. Internal entries give the offset of the class or
+ * method and the token of the field they refer to, external ones the
+ * imported package index and the tokens.
+ */
+static void write_constant_pool(structured_writer* writer, analyzed_cap_file* acf) {
+
+    u2 u2Index = 0;
+
+    write_key(writer, "constant_pool");
+    begin_array(writer);
+
+    for(; u2Index < acf->constant_pool_count; ++u2Index) {
+        constant_pool_entry_info* entry = acf->constant_pool[u2Index];
+        const char* kind = "STATICMETHODREF";
+
+        if(entry->flags & CONSTANT_POOL_CLASSREF)
+            kind = "CLASSREF";
+        else if(entry->flags & CONSTANT_POOL_INSTANCEFIELDREF)
+            kind = "INSTANCEFIELDREF";
+        else if(entry->flags & CONSTANT_POOL_VIRTUALMETHODREF)
+            kind = "VIRTUALMETHODREF";
+        else if(entry->flags & CONSTANT_POOL_SUPERMETHODREF)
+            kind = "SUPERMETHODREF";
+        else if(entry->flags & CONSTANT_POOL_STATICFIELDREF)
+            kind = "STATICFIELDREF";
+
+        begin_object(writer);
+        write_string_member(writer, "kind", kind);
+        write_uint_member(writer, "count", entry->count);
+        write_key(writer, "is_external");
+        write_bool(writer, (entry->flags & CONSTANT_POOL_IS_EXTERNAL) != 0);
+
+        if(!(entry->flags & CONSTANT_POOL_CLASSREF))
+            write_type_descriptor(writer, "type", entry->type);
+
+        if(entry->flags & CONSTANT_POOL_IS_EXTERNAL) {
+            write_uint_member(writer, "external_package", entry->external_package->my_index);
+            write_uint_member(writer, "external_class_token", entry->external_class_token);
+
+            if(entry->flags & (CONSTANT_POOL_INSTANCEFIELDREF|CONSTANT_POOL_STATICFIELDREF))
+                write_uint_member(writer, "external_field_token", entry->external_field_token);
+        } else if(entry->internal_class != NULL) {
+            write_uint_member(writer, "internal_class_offset", entry->internal_class->offset);
+        } else if(entry->internal_interface != NULL) {
+            write_uint_member(writer, "internal_interface_offset", entry->internal_interface->offset);
+        }
+
+        if(!(entry->flags & CONSTANT_POOL_IS_EXTERNAL) && (entry->internal_field != NULL) && (entry->flags & (CONSTANT_POOL_INSTANCEFIELDREF|CONSTANT_POOL_STATICFIELDREF)))
+            write_uint_member(writer, "internal_field_token", entry->internal_field->token);
+
+        if(!(entry->flags & CONSTANT_POOL_IS_EXTERNAL) && (entry->internal_method != NULL) && (entry->flags & (CONSTANT_POOL_VIRTUALMETHODREF|CONSTANT_POOL_STATICMETHODREF)))
+            write_uint_member(writer, "internal_method_offset", entry->internal_method->offset);
+
+        if((entry->flags & (CONSTANT_POOL_SUPERMETHODREF)) || ((entry->flags & (CONSTANT_POOL_VIRTUALMETHODREF|CONSTANT_POOL_STATICMETHODREF)) && (entry->flags & CONSTANT_POOL_IS_EXTERNAL)))
+            write_uint_member(writer, "method_token", entry->method_token);
+
+        end_object(writer);
+    }
+
+    end_array(writer);
+
+}
+
+
+/**
+ * Write the targets of a switch.
+ */
+static void write_switch(structured_writer* writer, bytecode_info* bytecode) {
+
+    switch_info* data = bytecode->switch_data;
+    u2 u2Index = 0;
+
+    write_key(writer, "cases");
+    begin_array(writer);
+
+    switch(bytecode->opcode) {
+        case 115:   /* stableswitch */
+            for(; u2Index < data->stableswitch.nb_cases; ++u2Index) {
+                begin_object(writer);
+                write_key(writer, "match");
+                write_int(writer, data->stableswitch.low + u2Index);
+                write_uint_member(writer, "branch", data->stableswitch.branches[u2Index]->offset);
+                end_object(writer);
+            }
+            break;
+
+        case 116:   /* itableswitch */
+            for(; u2Index < data->itableswitch.nb_cases; ++u2Index) {
+                begin_object(writer);
+                write_key(writer, "match");
+                write_int(writer, data->itableswitch.low + u2Index);
+                write_uint_member(writer, "branch", data->itableswitch.branches[u2Index]->offset);
+                end_object(writer);
+            }
+            break;
+
+        case 117:   /* slookupswitch */
+            for(; u2Index < data->slookupswitch.nb_cases; ++u2Index) {
+                begin_object(writer);
+                write_key(writer, "match");
+                write_int(writer, data->slookupswitch.cases[u2Index].match);
+                write_uint_member(writer, "branch", data->slookupswitch.cases[u2Index].branch->offset);
+                end_object(writer);
+            }
+            break;
+
+        default:    /* ilookupswitch */
+            for(; u2Index < data->ilookupswitch.nb_cases; ++u2Index) {
+                begin_object(writer);
+                write_key(writer, "match");
+                write_int(writer, data->ilookupswitch.cases[u2Index].match);
+                write_uint_member(writer, "branch", data->ilookupswitch.cases[u2Index].branch->offset);
+                end_object(writer);
+            }
+    }
+
+    end_array(writer);
+
+    /* default_branch is at the same place in every switch_info. */
+    write_uint_member(writer, "default", data->stableswitch.default_branch->offset);
+
+}
+
+
+/**
+ * Write the bytecodes of a method, branches being given as offsets within
+ * the method.
+ */
+static void write_bytecodes(structured_writer* writer, method_info* method) {
+
+    u2 u2Index = 0;
+
+    write_key(writer, "bytecodes");
+    begin_array(writer);
+
+    for(; u2Index < method->bytecodes_count; ++u2Index) {
+        bytecode_info* bytecode = method->bytecodes[u2Index];
+
+        begin_object(writer);
+        write_uint_member(writer, "offset", bytecode->offset);
+        write_string_member(writer, "opcode", opcodes[bytecode->opcode].mnemonic);
+
+        if(bytecode->nb_byte_args != 0)
+            write_bytes_member(writer, "args", bytecode->args, bytecode->nb_byte_args);
+
+        if(bytecode->has_ref)
+            write_uint_member(writer, "ref", bytecode->ref->my_index);
+
+        if(bytecode->has_branch)
+            write_uint_member(writer, "branch", bytecode->branch->offset);
+
+        if(bytecode->switch_data != NULL)
+            write_switch(writer, bytecode);
+
+        end_object(writer);
+    }
+
+    end_array(writer);
+
+}
+
+
+/**
+ * Write a method of a class or an interface.
+ */
+static void write_method(structured_writer* writer, method_info* method) {
+
+    begin_object(writer);
+    write_uint_member(writer, "token", method->token);
+    write_uint_member(writer, "offset", method->offset);
+    write_flags_member(writer, "flags", method->flags, method_flags);
+    write_uint_member(writer, "max_stack", method->max_stack);
+    write_uint_member(writer, "nargs", method->nargs);
+    write_uint_member(writer, "max_locals", method->max_locals);
+    write_key(writer, "is_overriding");
+    write_bool(writer, method->is_overriding);
+
+    if(method->internal_overrided_method != NULL)
+        write_uint_member(writer, "internal_overrided_method_offset", method->internal_overrided_method->offset);
+
+    write_type_descriptor(writer, "signature", method->signature);
+    write_bytecodes(writer, method);
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the interfaces defined in the package.
+ */
+static void write_interfaces(structured_writer* writer, analyzed_cap_file* acf) {
+
+    u2 u2Index1 = 0;
+
+    write_key(writer, "interfaces");
+    begin_array(writer);
+
+    for(; u2Index1 < acf->interfaces_count; ++u2Index1) {
+        interface_info* interface = acf->interfaces[u2Index1];
+        u1 u1Index = 0;
+        u2 u2Index2 = 0;
+
+        begin_object(writer);
+        write_uint_member(writer, "token", interface->token);
+        write_uint_member(writer, "offset", interface->offset);
+        write_flags_member(writer, "flags", interface->flags, interface_flags);
+        write_key(writer, "superinterfaces");
+        begin_array(writer);
+
+        for(; u1Index < interface->superinterfaces_count; ++u1Index)
+            write_uint(writer, interface->superinterfaces[u1Index]->my_index);
+
+        end_array(writer);
+        write_key(writer, "methods");
+        begin_array(writer);
+
+        for(; u2Index2 < interface->methods_count; ++u2Index2)
+            write_method(writer, interface->methods[u2Index2]);
+
+        end_array(writer);
+        end_object(writer);
+    }
+
+    end_array(writer);
+
+}
+
+
+/**
+ * Write a field of a class.
+ */
+static void write_field(structured_writer* writer, field_info* field) {
+
+    begin_object(writer);
+    write_uint_member(writer, "token", field->token);
+    write_flags_member(writer, "flags", field->flags, field_flags);
+    write_type_descriptor(writer, "type", field->type);
+
+    if(field->flags & FIELD_HAS_VALUE)
+        write_bytes_member(writer, "value", field->value, field->value_size);
+
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the classes defined in the package.
+ */
+static void write_classes(structured_writer* writer, analyzed_cap_file* acf) {
+
+    u2 u2Index1 = 0;
+
+    write_key(writer, "classes");
+    begin_array(writer);
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        class_info* class = acf->classes[u2Index1];
+        u1 u1Index1 = 0;
+        u2 u2Index2 = 0;
+
+        begin_object(writer);
+        write_uint_member(writer, "token", class->token);
+        write_uint_member(writer, "offset", class->offset);
+        write_flags_member(writer, "flags", class->flags, class_flags);
+
+        if(class->flags & CLASS_APPLET) {
+            write_bytes_member(writer, "aid", class->aid, class->aid_length);
+            if(class->install_method != NULL)
+                write_uint_member(writer, "install_method_offset", class->install_method->offset);
+        }
+
+        if(class->superclass != NULL)
+            write_uint_member(writer, "superclass", class->superclass->my_index);
+
+        write_key(writer, "interfaces");
+        begin_array(writer);
+
+        for(; u1Index1 < class->interfaces_count; ++u1Index1) {
+            u1 u1Index2 = 0;
+
+            begin_object(writer);
+            write_uint_member(writer, "ref", class->interfaces[u1Index1].ref->my_index);
+            write_key(writer, "index");
+            begin_array(writer);
+
+            for(; u1Index2 < class->interfaces[u1Index1].count; ++u1Index2) {
+                implemented_method_info* implemented = class->interfaces[u1Index1].index + u1Index2;
+
+                begin_object(writer);
+                write_uint_member(writer, "method_token", implemented->method_token);
+                if(implemented->declaration != NULL)
+                    write_uint_member(writer, "declaration_offset", implemented->declaration->offset);
+                if(implemented->implementation != NULL)
+                    write_uint_member(writer, "implementation_offset", implemented->implementation->offset);
+                end_object(writer);
+            }
+
+            end_array(writer);
+            end_object(writer);
+        }
+
+        end_array(writer);
+        write_key(writer, "fields");
+        begin_array(writer);
+
+        for(; u2Index2 < class->fields_count; ++u2Index2)
+            write_field(writer, class->fields[u2Index2]);
+
+        end_array(writer);
+        write_key(writer, "methods");
+        begin_array(writer);
+
+        for(u2Index2 = 0; u2Index2 < class->methods_count; ++u2Index2)
+            write_method(writer, class->methods[u2Index2]);
+
+        end_array(writer);
+        end_object(writer);
+    }
+
+    end_array(writer);
+
+}
+
+
+/**
+ * Write the exception handlers, their bytecodes being given as offsets
+ * within the method they are in.
+ */
+static void write_exception_handlers(structured_writer* writer, analyzed_cap_file* acf) {
+
+    u1 u1Index = 0;
+
+    write_key(writer, "exception_handlers");
+    begin_array(writer);
+
+    for(; u1Index < acf->exception_handlers_count; ++u1Index) {
+        exception_handler_info* handler = acf->exception_handlers[u1Index];
+
+        begin_object(writer);
+        write_key(writer, "stop_bit");
+        write_bool(writer, handler->stop_bit);
+
+        if(handler->try_in != NULL)
+            write_uint_member(writer, "try_in_offset", handler->try_in->offset);
+        if(handler->start != NULL)
+            write_uint_member(writer, "start", handler->start->offset);
+        if(handler->end != NULL)
+            write_uint_member(writer, "end", handler->end->offset);
+        if(handler->handler != NULL)
+            write_uint_member(writer, "handler", handler->handler->offset);
+        if(handler->catch_type != NULL)
+            write_uint_member(writer, "catch_type", handler->catch_type->my_index);
+
+        end_object(writer);
+    }
+
+    end_array(writer);
+
+}
+
+
+int serialize_analyzed_cap_file(structured_writer* writer, analyzed_cap_file* acf) {
+
+    u2 u2Index = 0;
+
+    begin_object(writer);
+    write_constant_info(writer, acf);
+    write_constant_pool(writer, acf);
+    write_key(writer, "signature_pool");
+    begin_array(writer);
+
+    for(; u2Index < acf->signature_pool_count; ++u2Index) {
+        begin_object(writer);
+        write_uint_member(writer, "count", acf->signature_pool[u2Index]->count);
+        write_type_descriptor(writer, "types", acf->signature_pool[u2Index]);
+        end_object(writer);
+    }
+
+    end_array(writer);
+    write_interfaces(writer, acf);
+    write_classes(writer, acf);
+    write_exception_handlers(writer, acf);
+    end_object(writer);
+
+    return writer->has_failed ? -1 : 0;
+
+}
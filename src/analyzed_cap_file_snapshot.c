@@ -0,0 +1,1530 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_snapshot.c
+ * \brief Save and load an analyzed CAP file to and from a binary snapshot.
+ *
+ * A snapshot starts with a header and the number of every referable part of
+ * the analyzed CAP file so the loader can allocate them all before reading
+ * their content in one pass. References are stored as u2 indexes:
+ * - methods are numbered across interfaces then classes,
+ * - fields are numbered across classes,
+ * - bytecodes are numbered within their method,
+ * - SNAPSHOT_NULL stands for a NULL pointer.
+ * Values are stored big endian.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_snapshot.h"
+#include "cap_file_analyze.h"
+#include "bytecodes.h"
+#include "byte_buffer.h"
+
+#define SNAPSHOT_MAGIC          0x41434653  /**< "ACFS" */
+#define SNAPSHOT_VERSION        3
+#define SNAPSHOT_NULL           0xFFFF
+#define SNAPSHOT_NULL_STRING    0xFFFFFFFF
+
+
+/**
+ * Growing output buffer and the flattened methods and fields used to turn
+ * pointers into indexes.
+ */
+typedef struct {
+    byte_writer output;
+
+    analyzed_cap_file* acf;
+    u2 methods_count;
+    method_info** methods;
+    u2 fields_count;
+    field_info** fields;
+} snapshot_writer;
+
+
+/**
+ * Input buffer and the flattened methods and fields used to turn indexes into
+ * pointers.
+ */
+typedef struct {
+    byte_reader input;
+
+    analyzed_cap_file* acf;
+    u2 methods_count;
+    method_info** methods;
+    u2 fields_count;
+    field_info** fields;
+} snapshot_reader;
+
+
+/**
+ * Build an array of the methods of the interfaces then of the classes.
+ */
+static method_info** get_all_methods(analyzed_cap_file* acf, u2* count) {
+
+    method_info** methods = NULL;
+    u4 total = 0;
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < acf->interfaces_count; ++u2Index1)
+        total += acf->interfaces[u2Index1]->methods_count;
+
+    for(u2Index1 = 0; u2Index1 < acf->classes_count; ++u2Index1)
+        total += acf->classes[u2Index1]->methods_count;
+
+    if(total >= SNAPSHOT_NULL) {
+        fprintf(stderr, "Too many methods for a snapshot\n");
+        return NULL;
+    }
+
+    methods = (method_info**)malloc(sizeof(method_info*) * (total + 1));
+    if(methods == NULL) {
+        perror("get_all_methods");
+        return NULL;
+    }
+
+    *count = 0;
+
+    for(u2Index1 = 0; u2Index1 < acf->interfaces_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+        for(; u2Index2 < acf->interfaces[u2Index1]->methods_count; ++u2Index2)
+            methods[(*count)++] = acf->interfaces[u2Index1]->methods[u2Index2];
+    }
+
+    for(u2Index1 = 0; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2)
+            methods[(*count)++] = acf->classes[u2Index1]->methods[u2Index2];
+    }
+
+    return methods;
+
+}
+
+
+/**
+ * Build an array of the fields of the classes.
+ */
+static field_info** get_all_fields(analyzed_cap_file* acf, u2* count) {
+
+    field_info** fields = NULL;
+    u4 total = 0;
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1)
+        total += acf->classes[u2Index1]->fields_count;
+
+    if(total >= SNAPSHOT_NULL) {
+        fprintf(stderr, "Too many fields for a snapshot\n");
+        return NULL;
+    }
+
+    fields = (field_info**)malloc(sizeof(field_info*) * (total + 1));
+    if(fields == NULL) {
+        perror("get_all_fields");
+        return NULL;
+    }
+
+    *count = 0;
+
+    for(u2Index1 = 0; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+        for(; u2Index2 < acf->classes[u2Index1]->fields_count; ++u2Index2)
+            fields[(*count)++] = acf->classes[u2Index1]->fields[u2Index2];
+    }
+
+    return fields;
+
+}
+
+
+/**
+ * Append a possibly NULL string.
+ */
+static void put_string(snapshot_writer* writer, const char* string) {
+
+    if(string == NULL) {
+        put_u4(&writer->output, SNAPSHOT_NULL_STRING);
+        return;
+    }
+
+    put_u4(&writer->output, strlen(string));
+    put_bytes(&writer->output, (const u1*)string, strlen(string));
+
+}
+
+
+/**
+ * Append an AID preceded by its length.
+ */
+static void put_aid(snapshot_writer* writer, const u1* aid, u1 aid_length) {
+
+    put_u1(&writer->output, aid_length);
+    put_bytes(&writer->output, aid, aid_length);
+
+}
+
+
+/**
+ * Report a pointer which does not point within the analyzed CAP file.
+ */
+static void put_unknown(snapshot_writer* writer, const char* what) {
+
+    fprintf(stderr, "A %s is not part of the analyzed CAP file\n", what);
+    writer->output.error = 1;
+    put_u2(&writer->output, SNAPSHOT_NULL);
+
+}
+
+
+static void put_imported_package(snapshot_writer* writer, imported_package_info* package) {
+
+    u1 u1Index = 0;
+
+    if(package == NULL) {
+        put_u2(&writer->output, SNAPSHOT_NULL);
+        return;
+    }
+
+    if((package->my_index < writer->acf->imported_packages_count) && (writer->acf->imported_packages[package->my_index] == package)) {
+        put_u2(&writer->output, package->my_index);
+        return;
+    }
+
+    for(; u1Index < writer->acf->imported_packages_count; ++u1Index)
+        if(writer->acf->imported_packages[u1Index] == package) {
+            put_u2(&writer->output, u1Index);
+            return;
+        }
+
+    put_unknown(writer, "imported package");
+
+}
+
+
+static void put_constant_pool_entry(snapshot_writer* writer, constant_pool_entry_info* entry) {
+
+    u2 u2Index = 0;
+
+    if(entry == NULL) {
+        put_u2(&writer->output, SNAPSHOT_NULL);
+        return;
+    }
+
+    if((entry->my_index < writer->acf->constant_pool_count) && (writer->acf->constant_pool[entry->my_index] == entry)) {
+        put_u2(&writer->output, entry->my_index);
+        return;
+    }
+
+    for(; u2Index < writer->acf->constant_pool_count; ++u2Index)
+        if(writer->acf->constant_pool[u2Index] == entry) {
+            put_u2(&writer->output, u2Index);
+            return;
+        }
+
+    put_unknown(writer, "constant pool entry");
+
+}
+
+
+static void put_type_descriptor(snapshot_writer* writer, type_descriptor_info* type) {
+
+    u2 u2Index = 0;
+
+    if(type == NULL) {
+        put_u2(&writer->output, SNAPSHOT_NULL);
+        return;
+    }
+
+    for(; u2Index < writer->acf->signature_pool_count; ++u2Index)
+        if(writer->acf->signature_pool[u2Index] == type) {
+            put_u2(&writer->output, u2Index);
+            return;
+        }
+
+    put_unknown(writer, "type descriptor");
+
+}
+
+
+static void put_class(snapshot_writer* writer, class_info* class) {
+
+    u2 u2Index = 0;
+
+    if(class == NULL) {
+        put_u2(&writer->output, SNAPSHOT_NULL);
+        return;
+    }
+
+    for(; u2Index < writer->acf->classes_count; ++u2Index)
+        if(writer->acf->classes[u2Index] == class) {
+            put_u2(&writer->output, u2Index);
+            return;
+        }
+
+    put_unknown(writer, "class");
+
+}
+
+
+static void put_interface(snapshot_writer* writer, interface_info* interface) {
+
+    u2 u2Index = 0;
+
+    if(interface == NULL) {
+        put_u2(&writer->output, SNAPSHOT_NULL);
+        return;
+    }
+
+    for(; u2Index < writer->acf->interfaces_count; ++u2Index)
+        if(writer->acf->interfaces[u2Index] == interface) {
+            put_u2(&writer->output, u2Index);
+            return;
+        }
+
+    put_unknown(writer, "interface");
+
+}
+
+
+static void put_method(snapshot_writer* writer, method_info* method) {
+
+    u2 u2Index = 0;
+
+    if(method == NULL) {
+        put_u2(&writer->output, SNAPSHOT_NULL);
+        return;
+    }
+
+    for(; u2Index < writer->methods_count; ++u2Index)
+        if(writer->methods[u2Index] == method) {
+            put_u2(&writer->output, u2Index);
+            return;
+        }
+
+    put_unknown(writer, "method");
+
+}
+
+
+static void put_field(snapshot_writer* writer, field_info* field) {
+
+    u2 u2Index = 0;
+
+    if(field == NULL) {
+        put_u2(&writer->output, SNAPSHOT_NULL);
+        return;
+    }
+
+    for(; u2Index < writer->fields_count; ++u2Index)
+        if(writer->fields[u2Index] == field) {
+            put_u2(&writer->output, u2Index);
+            return;
+        }
+
+    put_unknown(writer, "field");
+
+}
+
+
+/**
+ * Append the index of a bytecode within its method. Analyzed bytecodes are
+ * sorted by offset so a binary search is tried first; inserted bytecodes might
+ * break this order hence the linear search fallback.
+ */
+static void put_bytecode(snapshot_writer* writer, method_info* method, bytecode_info* bytecode) {
+
+    u2 low = 0;
+    u2 high = 0;
+    u2 u2Index = 0;
+
+    if(bytecode == NULL) {
+        put_u2(&writer->output, SNAPSHOT_NULL);
+        return;
+    }
+
+    if(method == NULL) {
+        put_unknown(writer, "bytecode");
+        return;
+    }
+
+    high = method->bytecodes_count;
+    while(low < high) {
+        u2 middle = low + (high - low) / 2;
+
+        if(method->bytecodes[middle] == bytecode) {
+            put_u2(&writer->output, middle);
+            return;
+        }
+
+        if(method->bytecodes[middle]->offset < bytecode->offset)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    for(; u2Index < method->bytecodes_count; ++u2Index)
+        if(method->bytecodes[u2Index] == bytecode) {
+            put_u2(&writer->output, u2Index);
+            return;
+        }
+
+    put_unknown(writer, "bytecode");
+
+}
+
+
+static void put_exception_handler(snapshot_writer* writer, exception_handler_info* handler) {
+
+    u1 u1Index = 0;
+
+    if(handler == NULL) {
+        put_u2(&writer->output, SNAPSHOT_NULL);
+        return;
+    }
+
+    if((handler->my_index < writer->acf->exception_handlers_count) && (writer->acf->exception_handlers[handler->my_index] == handler)) {
+        put_u2(&writer->output, handler->my_index);
+        return;
+    }
+
+    for(; u1Index < writer->acf->exception_handlers_count; ++u1Index)
+        if(writer->acf->exception_handlers[u1Index] == handler) {
+            put_u2(&writer->output, u1Index);
+            return;
+        }
+
+    put_unknown(writer, "exception handler");
+
+}
+
+
+/**
+ * Append the number of every referable part of the analyzed CAP file.
+ */
+static void save_counts(snapshot_writer* writer) {
+
+    analyzed_cap_file* acf = writer->acf;
+    u2 u2Index1 = 0;
+
+    put_u1(&writer->output, acf->imported_packages_count);
+    put_u2(&writer->output, acf->interfaces_count);
+    put_u2(&writer->output, acf->classes_count);
+    put_u2(&writer->output, acf->constant_pool_count);
+    put_u2(&writer->output, acf->signature_pool_count);
+    put_u1(&writer->output, acf->exception_handlers_count);
+
+    for(; u2Index1 < acf->signature_pool_count; ++u2Index1)
+        put_u1(&writer->output, acf->signature_pool[u2Index1]->types_count);
+
+    for(u2Index1 = 0; u2Index1 < acf->interfaces_count; ++u2Index1)
+        put_u2(&writer->output, acf->interfaces[u2Index1]->methods_count);
+
+    for(u2Index1 = 0; u2Index1 < acf->classes_count; ++u2Index1) {
+        put_u2(&writer->output, acf->classes[u2Index1]->fields_count);
+        put_u2(&writer->output, acf->classes[u2Index1]->methods_count);
+    }
+
+    for(u2Index1 = 0; u2Index1 < writer->methods_count; ++u2Index1)
+        put_u2(&writer->output, writer->methods[u2Index1]->bytecodes_count);
+
+}
+
+
+static void save_constant_info(snapshot_writer* writer) {
+
+    analyzed_cap_file* acf = writer->acf;
+    u1 u1Index = 0;
+
+    put_string(writer, acf->manifest.version);
+    put_string(writer, acf->manifest.created_by);
+    put_string(writer, acf->manifest.name);
+    put_string(writer, acf->manifest.package_name);
+    put_string(writer, acf->manifest.converter_provider);
+    put_string(writer, acf->manifest.converter_version);
+    put_string(writer, acf->manifest.creation_time);
+
+    put_string(writer, acf->info.path);
+    put_string(writer, acf->info.manifest);
+    put_u1(&writer->output, acf->info.javacard_minor_version);
+    put_u1(&writer->output, acf->info.javacard_major_version);
+    put_u1(&writer->output, acf->info.package_minor_version);
+    put_u1(&writer->output, acf->info.package_major_version);
+    put_aid(writer, acf->info.package_aid, acf->info.package_aid_length);
+    put_u1(&writer->output, acf->info.has_package_name);
+    put_string(writer, acf->info.has_package_name ? acf->info.package_name : NULL);
+
+    put_u1(&writer->output, acf->info.custom_count);
+    for(; u1Index < acf->info.custom_count; ++u1Index) {
+        put_u1(&writer->output, acf->info.custom_components[u1Index].tag);
+        put_u2(&writer->output, acf->info.custom_components[u1Index].size);
+        put_aid(writer, acf->info.custom_components[u1Index].aid, acf->info.custom_components[u1Index].aid_length);
+    }
+
+    put_u2(&writer->output, acf->dirty_components);
+    for(u1Index = 0; u1Index < 12; ++u1Index)
+        put_u2(&writer->output, acf->source_directory.component_sizes[u1Index]);
+    put_u2(&writer->output, acf->source_directory.image_size);
+    put_u2(&writer->output, acf->source_directory.array_init_count);
+    put_u2(&writer->output, acf->source_directory.array_init_size);
+    put_u1(&writer->output, acf->source_directory.import_count);
+    put_u1(&writer->output, acf->source_directory.applet_count);
+
+    for(u1Index = 0; u1Index < acf->imported_packages_count; ++u1Index) {
+        imported_package_info* package = acf->imported_packages[u1Index];
+
+        put_u1(&writer->output, package->my_index);
+        put_u2(&writer->output, package->count);
+        put_u1(&writer->output, package->minor_version);
+        put_u1(&writer->output, package->major_version);
+        put_aid(writer, package->aid, package->aid_length);
+    }
+
+}
+
+
+static void save_signature_pool(snapshot_writer* writer) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < writer->acf->signature_pool_count; ++u2Index) {
+        type_descriptor_info* type = writer->acf->signature_pool[u2Index];
+        u1 u1Index = 0;
+
+        put_u2(&writer->output, type->count);
+        put_u2(&writer->output, type->offset);
+
+        for(; u1Index < type->types_count; ++u1Index) {
+            put_u1(&writer->output, type->types[u1Index].type);
+            put_constant_pool_entry(writer, type->types[u1Index].ref);
+            put_u1(&writer->output, type->types[u1Index].is_external);
+            put_u1(&writer->output, type->types[u1Index].p1);
+            put_u1(&writer->output, type->types[u1Index].c1);
+            put_u2(&writer->output, type->types[u1Index].offset);
+        }
+    }
+
+}
+
+
+static void save_constant_pool(snapshot_writer* writer) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < writer->acf->constant_pool_count; ++u2Index) {
+        constant_pool_entry_info* entry = writer->acf->constant_pool[u2Index];
+
+        put_u1(&writer->output, entry->flags);
+        put_u2(&writer->output, entry->my_index);
+        put_u2(&writer->output, entry->count);
+        put_type_descriptor(writer, entry->type);
+        put_imported_package(writer, entry->external_package);
+        put_class(writer, entry->internal_class);
+        put_interface(writer, entry->internal_interface);
+        put_method(writer, entry->internal_method);
+        put_field(writer, entry->internal_field);
+        put_u1(&writer->output, entry->external_class_token);
+        put_u1(&writer->output, entry->external_field_token);
+        put_u1(&writer->output, entry->method_token);
+    }
+
+}
+
+
+static void save_interfaces(snapshot_writer* writer) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < writer->acf->interfaces_count; ++u2Index) {
+        interface_info* interface = writer->acf->interfaces[u2Index];
+        u1 u1Index = 0;
+
+        put_u1(&writer->output, interface->token);
+        put_u2(&writer->output, interface->size);
+        put_u2(&writer->output, interface->offset);
+        put_constant_pool_entry(writer, interface->this_interface);
+        put_u1(&writer->output, interface->flags);
+
+        put_u1(&writer->output, interface->superinterfaces_count);
+        for(; u1Index < interface->superinterfaces_count; ++u1Index)
+            put_constant_pool_entry(writer, interface->superinterfaces[u1Index]);
+    }
+
+}
+
+
+static void save_classes(snapshot_writer* writer) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < writer->acf->classes_count; ++u2Index) {
+        class_info* class = writer->acf->classes[u2Index];
+        u1 u1Index1 = 0;
+
+        put_u1(&writer->output, class->token);
+        put_u2(&writer->output, class->size);
+        put_u2(&writer->output, class->offset);
+        put_constant_pool_entry(writer, class->this_class);
+        put_u1(&writer->output, class->flags);
+        put_string(writer, class->name);
+        put_aid(writer, class->aid, class->aid_length);
+        put_method(writer, class->install_method);
+        put_constant_pool_entry(writer, class->superclass);
+
+        put_u1(&writer->output, class->interfaces_count);
+        for(; u1Index1 < class->interfaces_count; ++u1Index1) {
+            implemented_interface_info* interface = &(class->interfaces[u1Index1]);
+            u1 u1Index2 = 0;
+
+            put_constant_pool_entry(writer, interface->ref);
+            put_u1(&writer->output, interface->count);
+            for(; u1Index2 < interface->count; ++u1Index2) {
+                put_method(writer, interface->index[u1Index2].declaration);
+                put_u1(&writer->output, interface->index[u1Index2].method_token);
+                put_method(writer, interface->index[u1Index2].implementation);
+            }
+        }
+
+        put_u1(&writer->output, class->has_largest_public_method_token);
+        put_u1(&writer->output, class->largest_public_method_token);
+        put_u1(&writer->output, class->has_largest_package_method_token);
+        put_u1(&writer->output, class->largest_package_method_token);
+    }
+
+}
+
+
+static void save_fields(snapshot_writer* writer) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < writer->fields_count; ++u2Index) {
+        field_info* field = writer->fields[u2Index];
+
+        put_u1(&writer->output, field->token);
+        put_u2(&writer->output, field->offset);
+        put_constant_pool_entry(writer, field->this_field);
+        put_u1(&writer->output, field->flags);
+        put_type_descriptor(writer, field->type);
+        put_u2(&writer->output, field->value_size);
+        put_u1(&writer->output, field->value != NULL);
+        if(field->value != NULL)
+            put_bytes(&writer->output, field->value, field->value_size);
+    }
+
+}
+
+
+/**
+ * Append the arguments of a switch like bytecode.
+ */
+static void save_switch(snapshot_writer* writer, method_info* method, bytecode_info* bytecode) {
+
+    u2 u2Index = 0;
+
+    switch(opcodes[bytecode->opcode].format) {
+        case OPCODE_FORMAT_STABLESWITCH:
+            put_bytecode(writer, method, bytecode->switch_data->stableswitch.default_branch);
+            put_u2(&writer->output, bytecode->switch_data->stableswitch.nb_cases);
+            put_u2(&writer->output, (u2)bytecode->switch_data->stableswitch.low);
+            put_u2(&writer->output, (u2)bytecode->switch_data->stableswitch.high);
+            for(; u2Index < bytecode->switch_data->stableswitch.nb_cases; ++u2Index)
+                put_bytecode(writer, method, bytecode->switch_data->stableswitch.branches[u2Index]);
+            break;
+
+        case OPCODE_FORMAT_ITABLESWITCH:
+            put_bytecode(writer, method, bytecode->switch_data->itableswitch.default_branch);
+            put_u2(&writer->output, bytecode->switch_data->itableswitch.nb_cases);
+            put_u4(&writer->output, (u4)bytecode->switch_data->itableswitch.low);
+            put_u4(&writer->output, (u4)bytecode->switch_data->itableswitch.high);
+            for(; u2Index < bytecode->switch_data->itableswitch.nb_cases; ++u2Index)
+                put_bytecode(writer, method, bytecode->switch_data->itableswitch.branches[u2Index]);
+            break;
+
+        case OPCODE_FORMAT_SLOOKUPSWITCH:
+            put_bytecode(writer, method, bytecode->switch_data->slookupswitch.default_branch);
+            put_u2(&writer->output, bytecode->switch_data->slookupswitch.nb_cases);
+            for(; u2Index < bytecode->switch_data->slookupswitch.nb_cases; ++u2Index) {
+                put_u2(&writer->output, (u2)bytecode->switch_data->slookupswitch.cases[u2Index].match);
+                put_bytecode(writer, method, bytecode->switch_data->slookupswitch.cases[u2Index].branch);
+            }
+            break;
+
+        case OPCODE_FORMAT_ILOOKUPSWITCH:
+            put_bytecode(writer, method, bytecode->switch_data->ilookupswitch.default_branch);
+            put_u2(&writer->output, bytecode->switch_data->ilookupswitch.nb_cases);
+            for(; u2Index < bytecode->switch_data->ilookupswitch.nb_cases; ++u2Index) {
+                put_u4(&writer->output, (u4)bytecode->switch_data->ilookupswitch.cases[u2Index].match);
+                put_bytecode(writer, method, bytecode->switch_data->ilookupswitch.cases[u2Index].branch);
+            }
+            break;
+    }
+
+}
+
+
+static void save_methods(snapshot_writer* writer) {
+
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < writer->methods_count; ++u2Index1) {
+        method_info* method = writer->methods[u2Index1];
+        u2 u2Index2 = 0;
+        u1 u1Index = 0;
+
+        put_u1(&writer->output, method->token);
+        put_u2(&writer->output, method->size);
+        put_u2(&writer->output, method->offset);
+        put_constant_pool_entry(writer, method->this_method);
+        put_u1(&writer->output, method->is_overriding);
+        put_method(writer, method->internal_overrided_method);
+        put_u2(&writer->output, method->flags);
+        put_u1(&writer->output, method->max_stack);
+        put_u1(&writer->output, method->nargs);
+        put_u1(&writer->output, method->max_locals);
+        put_type_descriptor(writer, method->signature);
+        put_u2(&writer->output, method->bytecodes_size);
+        put_u1(&writer->output, method->needs_layout);
+
+        put_u1(&writer->output, method->exception_handlers_count);
+        for(; u1Index < method->exception_handlers_count; ++u1Index)
+            put_exception_handler(writer, method->exception_handlers[u1Index]);
+
+        for(; u2Index2 < method->bytecodes_count; ++u2Index2) {
+            bytecode_info* bytecode = method->bytecodes[u2Index2];
+
+            put_u1(&writer->output, bytecode->opcode);
+            put_u1(&writer->output, bytecode->nb_byte_args);
+            put_bytes(&writer->output, bytecode->args, 4);
+            put_u1(&writer->output, bytecode->has_ref);
+            put_u1(&writer->output, bytecode->has_branch);
+            put_u2(&writer->output, bytecode->nb_args);
+            put_u2(&writer->output, bytecode->offset);
+            put_u2(&writer->output, bytecode->info_offset);
+            put_constant_pool_entry(writer, bytecode->ref);
+            put_bytecode(writer, method, bytecode->branch);
+
+            put_u1(&writer->output, bytecode->switch_data != NULL);
+            if(bytecode->switch_data != NULL)
+                save_switch(writer, method, bytecode);
+        }
+    }
+
+}
+
+
+static void save_exception_handlers(snapshot_writer* writer) {
+
+    u1 u1Index = 0;
+
+    for(; u1Index < writer->acf->exception_handlers_count; ++u1Index) {
+        exception_handler_info* handler = writer->acf->exception_handlers[u1Index];
+
+        put_u1(&writer->output, handler->stop_bit);
+        put_u1(&writer->output, handler->my_index);
+        put_method(writer, handler->try_in);
+        put_bytecode(writer, handler->try_in, handler->start);
+        put_bytecode(writer, handler->try_in, handler->end);
+        put_bytecode(writer, handler->try_in, handler->handler);
+        put_constant_pool_entry(writer, handler->catch_type);
+    }
+
+}
+
+
+/**
+ * \brief Serialize an analyzed CAP file into a newly allocated buffer.
+ *
+ * \param acf  The analyzed CAP file to serialize.
+ * \param size The size in byte of the returned buffer.
+ *
+ * \return Return the snapshot or NULL if an error occurred.
+ */
+u1* save_analyzed_cap_file_snapshot(analyzed_cap_file* acf, u4* size) {
+
+    snapshot_writer writer;
+
+    memset(&writer, 0, sizeof(snapshot_writer));
+    writer.acf = acf;
+
+    if((writer.methods = get_all_methods(acf, &(writer.methods_count))) == NULL)
+        return NULL;
+
+    if((writer.fields = get_all_fields(acf, &(writer.fields_count))) == NULL) {
+        free(writer.methods);
+        return NULL;
+    }
+
+    put_u4(&writer.output, SNAPSHOT_MAGIC);
+    put_u2(&writer.output, SNAPSHOT_VERSION);
+
+    save_counts(&writer);
+    save_constant_info(&writer);
+    save_signature_pool(&writer);
+    save_constant_pool(&writer);
+    save_interfaces(&writer);
+    save_classes(&writer);
+    save_fields(&writer);
+    save_methods(&writer);
+    save_exception_handlers(&writer);
+
+    free(writer.methods);
+    free(writer.fields);
+
+    if(writer.output.error) {
+        free(writer.output.buffer);
+        return NULL;
+    }
+
+    *size = writer.output.size;
+    return writer.output.buffer;
+
+}
+
+
+/**
+ * Allocate memory for a part of the analyzed CAP file. Nothing is allocated
+ * and no error is reported for a size of 0.
+ */
+static void* allocate(snapshot_reader* reader, size_t size) {
+
+    void* memory = NULL;
+
+    if(reader->input.error || (size == 0))
+        return NULL;
+
+    memory = calloc(1, size);
+    if(memory == NULL) {
+        perror("load_analyzed_cap_file_snapshot");
+        reader->input.error = 1;
+    }
+
+    return memory;
+
+}
+
+
+/**
+ * Read a possibly NULL string.
+ */
+static char* get_string(snapshot_reader* reader) {
+
+    u4 length = get_u4(&reader->input);
+    const u1* bytes = NULL;
+    char* string = NULL;
+
+    if(length == SNAPSHOT_NULL_STRING)
+        return NULL;
+
+    if((bytes = get_bytes(&reader->input, length)) == NULL)
+        return NULL;
+
+    if((string = (char*)allocate(reader, length + 1)) == NULL)
+        return NULL;
+
+    memcpy(string, bytes, length);
+    return string;
+
+}
+
+
+/**
+ * Read an AID preceded by its length.
+ */
+static u1* get_aid(snapshot_reader* reader, u1* aid_length) {
+
+    const u1* bytes = NULL;
+    u1* aid = NULL;
+
+    *aid_length = get_u1(&reader->input);
+    if((bytes = get_bytes(&reader->input, *aid_length)) == NULL)
+        return NULL;
+
+    if((aid = (u1*)allocate(reader, *aid_length)) != NULL)
+        memcpy(aid, bytes, *aid_length);
+
+    return aid;
+
+}
+
+
+/**
+ * Read an index and check it against the number of indexed parts. Return
+ * SNAPSHOT_NULL for a NULL pointer or an invalid index.
+ */
+static u2 get_index(snapshot_reader* reader, u2 count) {
+
+    u2 index = get_u2(&reader->input);
+
+    if(index == SNAPSHOT_NULL)
+        return SNAPSHOT_NULL;
+
+    if(index >= count) {
+        reader->input.error = 1;
+        return SNAPSHOT_NULL;
+    }
+
+    return index;
+
+}
+
+
+static imported_package_info* get_imported_package(snapshot_reader* reader) {
+
+    u2 index = get_index(reader, reader->acf->imported_packages_count);
+
+    return index == SNAPSHOT_NULL ? NULL : reader->acf->imported_packages[index];
+
+}
+
+
+static constant_pool_entry_info* get_constant_pool_entry(snapshot_reader* reader) {
+
+    u2 index = get_index(reader, reader->acf->constant_pool_count);
+
+    return index == SNAPSHOT_NULL ? NULL : reader->acf->constant_pool[index];
+
+}
+
+
+static type_descriptor_info* get_type_descriptor(snapshot_reader* reader) {
+
+    u2 index = get_index(reader, reader->acf->signature_pool_count);
+
+    return index == SNAPSHOT_NULL ? NULL : reader->acf->signature_pool[index];
+
+}
+
+
+static class_info* get_class(snapshot_reader* reader) {
+
+    u2 index = get_index(reader, reader->acf->classes_count);
+
+    return index == SNAPSHOT_NULL ? NULL : reader->acf->classes[index];
+
+}
+
+
+static interface_info* get_interface(snapshot_reader* reader) {
+
+    u2 index = get_index(reader, reader->acf->interfaces_count);
+
+    return index == SNAPSHOT_NULL ? NULL : reader->acf->interfaces[index];
+
+}
+
+
+static method_info* get_method(snapshot_reader* reader) {
+
+    u2 index = get_index(reader, reader->methods_count);
+
+    return index == SNAPSHOT_NULL ? NULL : reader->methods[index];
+
+}
+
+
+static field_info* get_field(snapshot_reader* reader) {
+
+    u2 index = get_index(reader, reader->fields_count);
+
+    return index == SNAPSHOT_NULL ? NULL : reader->fields[index];
+
+}
+
+
+static bytecode_info* get_bytecode(snapshot_reader* reader, method_info* method) {
+
+    u2 index = get_index(reader, method ? method->bytecodes_count : 0);
+
+    return index == SNAPSHOT_NULL ? NULL : method->bytecodes[index];
+
+}
+
+
+static exception_handler_info* get_exception_handler(snapshot_reader* reader) {
+
+    u2 index = get_index(reader, reader->acf->exception_handlers_count);
+
+    return index == SNAPSHOT_NULL ? NULL : reader->acf->exception_handlers[index];
+
+}
+
+
+/**
+ * Allocate an array of count pointers to newly allocated parts of size bytes.
+ */
+static void** allocate_parts(snapshot_reader* reader, u2 count, size_t size) {
+
+    void** parts = (void**)allocate(reader, sizeof(void*) * count);
+    u2 u2Index = 0;
+
+    if(parts == NULL)
+        return NULL;
+
+    for(; u2Index < count; ++u2Index)
+        if((parts[u2Index] = allocate(reader, size)) == NULL)
+            return NULL;
+
+    return parts;
+
+}
+
+
+/**
+ * Read the number of every referable part of the analyzed CAP file and
+ * allocate them.
+ */
+static int load_counts(snapshot_reader* reader) {
+
+    analyzed_cap_file* acf = reader->acf;
+    u2 u2Index = 0;
+
+    acf->imported_packages_count = get_u1(&reader->input);
+    acf->interfaces_count = get_u2(&reader->input);
+    acf->classes_count = get_u2(&reader->input);
+    acf->constant_pool_count = get_u2(&reader->input);
+    acf->signature_pool_count = get_u2(&reader->input);
+    acf->exception_handlers_count = get_u1(&reader->input);
+
+    acf->imported_packages = (imported_package_info**)allocate_parts(reader, acf->imported_packages_count, sizeof(imported_package_info));
+    acf->interfaces = (interface_info**)allocate_parts(reader, acf->interfaces_count, sizeof(interface_info));
+    acf->classes = (class_info**)allocate_parts(reader, acf->classes_count, sizeof(class_info));
+    acf->constant_pool = (constant_pool_entry_info**)allocate_parts(reader, acf->constant_pool_count, sizeof(constant_pool_entry_info));
+    acf->signature_pool = (type_descriptor_info**)allocate_parts(reader, acf->signature_pool_count, sizeof(type_descriptor_info));
+    acf->exception_handlers = (exception_handler_info**)allocate_parts(reader, acf->exception_handlers_count, sizeof(exception_handler_info));
+    if(reader->input.error)
+        return -1;
+
+    for(; u2Index < acf->signature_pool_count; ++u2Index) {
+        acf->signature_pool[u2Index]->types_count = get_u1(&reader->input);
+        acf->signature_pool[u2Index]->types = (one_type_descriptor_info*)allocate(reader, sizeof(one_type_descriptor_info) * acf->signature_pool[u2Index]->types_count);
+    }
+
+    for(u2Index = 0; u2Index < acf->interfaces_count; ++u2Index) {
+        acf->interfaces[u2Index]->methods_count = get_u2(&reader->input);
+        acf->interfaces[u2Index]->methods = (method_info**)allocate_parts(reader, acf->interfaces[u2Index]->methods_count, sizeof(method_info));
+    }
+
+    for(u2Index = 0; u2Index < acf->classes_count; ++u2Index) {
+        acf->classes[u2Index]->fields_count = get_u2(&reader->input);
+        acf->classes[u2Index]->fields = (field_info**)allocate_parts(reader, acf->classes[u2Index]->fields_count, sizeof(field_info));
+        acf->classes[u2Index]->methods_count = get_u2(&reader->input);
+        acf->classes[u2Index]->methods = (method_info**)allocate_parts(reader, acf->classes[u2Index]->methods_count, sizeof(method_info));
+    }
+
+    if(reader->input.error)
+        return -1;
+
+    if((reader->methods = get_all_methods(acf, &(reader->methods_count))) == NULL)
+        return -1;
+
+    if((reader->fields = get_all_fields(acf, &(reader->fields_count))) == NULL)
+        return -1;
+
+    for(u2Index = 0; u2Index < reader->methods_count; ++u2Index) {
+        reader->methods[u2Index]->bytecodes_count = get_u2(&reader->input);
+        reader->methods[u2Index]->bytecodes = (bytecode_info**)allocate_parts(reader, reader->methods[u2Index]->bytecodes_count, sizeof(bytecode_info));
+    }
+
+    return reader->input.error ? -1 : 0;
+
+}
+
+
+static void load_constant_info(snapshot_reader* reader) {
+
+    analyzed_cap_file* acf = reader->acf;
+    u1 u1Index = 0;
+
+    acf->manifest.version = get_string(reader);
+    acf->manifest.created_by = get_string(reader);
+    acf->manifest.name = get_string(reader);
+    acf->manifest.package_name = get_string(reader);
+    acf->manifest.converter_provider = get_string(reader);
+    acf->manifest.converter_version = get_string(reader);
+    acf->manifest.creation_time = get_string(reader);
+
+    acf->info.path = get_string(reader);
+    acf->info.manifest = get_string(reader);
+    acf->info.javacard_minor_version = get_u1(&reader->input);
+    acf->info.javacard_major_version = get_u1(&reader->input);
+    acf->info.package_minor_version = get_u1(&reader->input);
+    acf->info.package_major_version = get_u1(&reader->input);
+    acf->info.package_aid = get_aid(reader, &(acf->info.package_aid_length));
+    acf->info.has_package_name = get_u1(&reader->input);
+    acf->info.package_name = get_string(reader);
+
+    acf->info.custom_count = get_u1(&reader->input);
+    acf->info.custom_components = (custom_component_info*)allocate(reader, sizeof(custom_component_info) * acf->info.custom_count);
+    for(; (u1Index < acf->info.custom_count) && !reader->input.error; ++u1Index) {
+        acf->info.custom_components[u1Index].tag = get_u1(&reader->input);
+        acf->info.custom_components[u1Index].size = get_u2(&reader->input);
+        acf->info.custom_components[u1Index].aid = get_aid(reader, &(acf->info.custom_components[u1Index].aid_length));
+    }
+
+    acf->dirty_components = get_u2(&reader->input);
+    for(u1Index = 0; u1Index < 12; ++u1Index)
+        acf->source_directory.component_sizes[u1Index] = get_u2(&reader->input);
+    acf->source_directory.image_size = get_u2(&reader->input);
+    acf->source_directory.array_init_count = get_u2(&reader->input);
+    acf->source_directory.array_init_size = get_u2(&reader->input);
+    acf->source_directory.import_count = get_u1(&reader->input);
+    acf->source_directory.applet_count = get_u1(&reader->input);
+
+    for(u1Index = 0; u1Index < acf->imported_packages_count; ++u1Index) {
+        imported_package_info* package = acf->imported_packages[u1Index];
+
+        package->my_index = get_u1(&reader->input);
+        package->count = get_u2(&reader->input);
+        package->minor_version = get_u1(&reader->input);
+        package->major_version = get_u1(&reader->input);
+        package->aid = get_aid(reader, &(package->aid_length));
+    }
+
+}
+
+
+static void load_signature_pool(snapshot_reader* reader) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < reader->acf->signature_pool_count; ++u2Index) {
+        type_descriptor_info* type = reader->acf->signature_pool[u2Index];
+        u1 u1Index = 0;
+
+        type->count = get_u2(&reader->input);
+        type->offset = get_u2(&reader->input);
+
+        for(; u1Index < type->types_count; ++u1Index) {
+            type->types[u1Index].type = get_u1(&reader->input);
+            type->types[u1Index].ref = get_constant_pool_entry(reader);
+            type->types[u1Index].is_external = get_u1(&reader->input);
+            type->types[u1Index].p1 = get_u1(&reader->input);
+            type->types[u1Index].c1 = get_u1(&reader->input);
+            type->types[u1Index].offset = get_u2(&reader->input);
+        }
+    }
+
+}
+
+
+static void load_constant_pool(snapshot_reader* reader) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < reader->acf->constant_pool_count; ++u2Index) {
+        constant_pool_entry_info* entry = reader->acf->constant_pool[u2Index];
+
+        entry->flags = get_u1(&reader->input);
+        entry->my_index = get_u2(&reader->input);
+        entry->count = get_u2(&reader->input);
+        entry->type = get_type_descriptor(reader);
+        entry->external_package = get_imported_package(reader);
+        entry->internal_class = get_class(reader);
+        entry->internal_interface = get_interface(reader);
+        entry->internal_method = get_method(reader);
+        entry->internal_field = get_field(reader);
+        entry->external_class_token = get_u1(&reader->input);
+        entry->external_field_token = get_u1(&reader->input);
+        entry->method_token = get_u1(&reader->input);
+    }
+
+}
+
+
+static void load_interfaces(snapshot_reader* reader) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < reader->acf->interfaces_count; ++u2Index) {
+        interface_info* interface = reader->acf->interfaces[u2Index];
+        u1 u1Index = 0;
+
+        interface->token = get_u1(&reader->input);
+        interface->size = get_u2(&reader->input);
+        interface->offset = get_u2(&reader->input);
+        interface->this_interface = get_constant_pool_entry(reader);
+        interface->flags = get_u1(&reader->input);
+
+        interface->superinterfaces_count = get_u1(&reader->input);
+        interface->superinterfaces = (constant_pool_entry_info**)allocate(reader, sizeof(constant_pool_entry_info*) * interface->superinterfaces_count);
+        for(; (u1Index < interface->superinterfaces_count) && !reader->input.error; ++u1Index)
+            interface->superinterfaces[u1Index] = get_constant_pool_entry(reader);
+    }
+
+}
+
+
+static void load_classes(snapshot_reader* reader) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < reader->acf->classes_count; ++u2Index) {
+        class_info* class = reader->acf->classes[u2Index];
+        u1 u1Index1 = 0;
+
+        class->token = get_u1(&reader->input);
+        class->size = get_u2(&reader->input);
+        class->offset = get_u2(&reader->input);
+        class->this_class = get_constant_pool_entry(reader);
+        class->flags = get_u1(&reader->input);
+        class->name = get_string(reader);
+        class->aid = get_aid(reader, &(class->aid_length));
+        class->install_method = get_method(reader);
+        class->superclass = get_constant_pool_entry(reader);
+
+        class->interfaces_count = get_u1(&reader->input);
+        class->interfaces = (implemented_interface_info*)allocate(reader, sizeof(implemented_interface_info) * class->interfaces_count);
+        for(; (u1Index1 < class->interfaces_count) && !reader->input.error; ++u1Index1) {
+            implemented_interface_info* interface = &(class->interfaces[u1Index1]);
+            u1 u1Index2 = 0;
+
+            interface->ref = get_constant_pool_entry(reader);
+            interface->count = get_u1(&reader->input);
+            interface->index = (implemented_method_info*)allocate(reader, sizeof(implemented_method_info) * interface->count);
+            for(; (u1Index2 < interface->count) && !reader->input.error; ++u1Index2) {
+                interface->index[u1Index2].declaration = get_method(reader);
+                interface->index[u1Index2].method_token = get_u1(&reader->input);
+                interface->index[u1Index2].implementation = get_method(reader);
+            }
+        }
+
+        class->has_largest_public_method_token = get_u1(&reader->input);
+        class->largest_public_method_token = get_u1(&reader->input);
+        class->has_largest_package_method_token = get_u1(&reader->input);
+        class->largest_package_method_token = get_u1(&reader->input);
+        class->tweak = NULL;
+    }
+
+}
+
+
+static void load_fields(snapshot_reader* reader) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < reader->fields_count; ++u2Index) {
+        field_info* field = reader->fields[u2Index];
+
+        field->token = get_u1(&reader->input);
+        field->offset = get_u2(&reader->input);
+        field->this_field = get_constant_pool_entry(reader);
+        field->flags = get_u1(&reader->input);
+        field->type = get_type_descriptor(reader);
+        field->value_size = get_u2(&reader->input);
+        field->value = NULL;
+
+        if(get_u1(&reader->input)) {
+            const u1* value = get_bytes(&reader->input, field->value_size);
+
+            if((value != NULL) && ((field->value = (u1*)allocate(reader, field->value_size)) != NULL))
+                memcpy(field->value, value, field->value_size);
+        }
+    }
+
+}
+
+
+/**
+ * Read the arguments of a switch like bytecode.
+ */
+static void load_switch(snapshot_reader* reader, method_info* method, bytecode_info* bytecode) {
+
+    switch_info* data = (switch_info*)allocate(reader, sizeof(switch_info));
+    u2 u2Index = 0;
+
+    if(data == NULL)
+        return;
+
+    bytecode->switch_data = data;
+
+    switch(opcodes[bytecode->opcode].format) {
+        case OPCODE_FORMAT_STABLESWITCH:
+            data->stableswitch.default_branch = get_bytecode(reader, method);
+            data->stableswitch.nb_cases = get_u2(&reader->input);
+            data->stableswitch.low = (int16_t)get_u2(&reader->input);
+            data->stableswitch.high = (int16_t)get_u2(&reader->input);
+            data->stableswitch.branches = (bytecode_info**)allocate(reader, sizeof(bytecode_info*) * data->stableswitch.nb_cases);
+            for(; (u2Index < data->stableswitch.nb_cases) && !reader->input.error; ++u2Index)
+                data->stableswitch.branches[u2Index] = get_bytecode(reader, method);
+            break;
+
+        case OPCODE_FORMAT_ITABLESWITCH:
+            data->itableswitch.default_branch = get_bytecode(reader, method);
+            data->itableswitch.nb_cases = get_u2(&reader->input);
+            data->itableswitch.low = (int32_t)get_u4(&reader->input);
+            data->itableswitch.high = (int32_t)get_u4(&reader->input);
+            data->itableswitch.branches = (bytecode_info**)allocate(reader, sizeof(bytecode_info*) * data->itableswitch.nb_cases);
+            for(; (u2Index < data->itableswitch.nb_cases) && !reader->input.error; ++u2Index)
+                data->itableswitch.branches[u2Index] = get_bytecode(reader, method);
+            break;
+
+        case OPCODE_FORMAT_SLOOKUPSWITCH:
+            data->slookupswitch.default_branch = get_bytecode(reader, method);
+            data->slookupswitch.nb_cases = get_u2(&reader->input);
+            data->slookupswitch.cases = (slookupswitch_pair_info*)allocate(reader, sizeof(slookupswitch_pair_info) * data->slookupswitch.nb_cases);
+            for(; (u2Index < data->slookupswitch.nb_cases) && !reader->input.error; ++u2Index) {
+                data->slookupswitch.cases[u2Index].match = (int16_t)get_u2(&reader->input);
+                data->slookupswitch.cases[u2Index].branch = get_bytecode(reader, method);
+            }
+            break;
+
+        case OPCODE_FORMAT_ILOOKUPSWITCH:
+            data->ilookupswitch.default_branch = get_bytecode(reader, method);
+            data->ilookupswitch.nb_cases = get_u2(&reader->input);
+            data->ilookupswitch.cases = (ilookupswitch_pair_info*)allocate(reader, sizeof(ilookupswitch_pair_info) * data->ilookupswitch.nb_cases);
+            for(; (u2Index < data->ilookupswitch.nb_cases) && !reader->input.error; ++u2Index) {
+                data->ilookupswitch.cases[u2Index].match = (int32_t)get_u4(&reader->input);
+                data->ilookupswitch.cases[u2Index].branch = get_bytecode(reader, method);
+            }
+            break;
+
+        default:
+            reader->input.error = 1;
+    }
+
+}
+
+
+static void load_methods(snapshot_reader* reader) {
+
+    u2 u2Index1 = 0;
+
+    for(; (u2Index1 < reader->methods_count) && !reader->input.error; ++u2Index1) {
+        method_info* method = reader->methods[u2Index1];
+        u2 u2Index2 = 0;
+        u1 u1Index = 0;
+
+        method->token = get_u1(&reader->input);
+        method->size = get_u2(&reader->input);
+        method->offset = get_u2(&reader->input);
+        method->this_method = get_constant_pool_entry(reader);
+        method->is_overriding = get_u1(&reader->input);
+        method->internal_overrided_method = get_method(reader);
+        method->flags = get_u2(&reader->input);
+        method->max_stack = get_u1(&reader->input);
+        method->nargs = get_u1(&reader->input);
+        method->max_locals = get_u1(&reader->input);
+        method->signature = get_type_descriptor(reader);
+        method->bytecodes_size = get_u2(&reader->input);
+        method->needs_layout = get_u1(&reader->input);
+
+        method->exception_handlers_count = get_u1(&reader->input);
+        method->exception_handlers = (exception_handler_info**)allocate(reader, sizeof(exception_handler_info*) * method->exception_handlers_count);
+        for(; (u1Index < method->exception_handlers_count) && !reader->input.error; ++u1Index)
+            method->exception_handlers[u1Index] = get_exception_handler(reader);
+
+        for(; (u2Index2 < method->bytecodes_count) && !reader->input.error; ++u2Index2) {
+            bytecode_info* bytecode = method->bytecodes[u2Index2];
+            const u1* args = NULL;
+
+            bytecode->opcode = get_u1(&reader->input);
+            bytecode->nb_byte_args = get_u1(&reader->input);
+            if((args = get_bytes(&reader->input, 4)) != NULL)
+                memcpy(bytecode->args, args, 4);
+            bytecode->has_ref = get_u1(&reader->input);
+            bytecode->has_branch = get_u1(&reader->input);
+            bytecode->nb_args = get_u2(&reader->input);
+            bytecode->offset = get_u2(&reader->input);
+            bytecode->info_offset = get_u2(&reader->input);
+            bytecode->ref = get_constant_pool_entry(reader);
+            bytecode->branch = get_bytecode(reader, method);
+            bytecode->switch_data = NULL;
+
+            if(get_u1(&reader->input))
+                load_switch(reader, method, bytecode);
+        }
+    }
+
+}
+
+
+static void load_exception_handlers(snapshot_reader* reader) {
+
+    u1 u1Index = 0;
+
+    for(; u1Index < reader->acf->exception_handlers_count; ++u1Index) {
+        exception_handler_info* handler = reader->acf->exception_handlers[u1Index];
+
+        handler->stop_bit = get_u1(&reader->input);
+        handler->my_index = get_u1(&reader->input);
+        handler->try_in = get_method(reader);
+        handler->start = get_bytecode(reader, handler->try_in);
+        handler->end = get_bytecode(reader, handler->try_in);
+        handler->handler = get_bytecode(reader, handler->try_in);
+        handler->catch_type = get_constant_pool_entry(reader);
+    }
+
+}
+
+
+/**
+ * \brief Rebuild an analyzed CAP file from a snapshot.
+ *
+ * \param snapshot        The snapshot as built by
+ *                        save_analyzed_cap_file_snapshot().
+ * \param size            The size in byte of the snapshot.
+ * \param export_files    An array of parsed export files used to link the
+ *                        imported packages.
+ * \param nb_export_files The number of parsed export files in the array.
+ *
+ * \return Return the analyzed CAP file or NULL if an error occurred.
+ */
+analyzed_cap_file* load_analyzed_cap_file_snapshot(const u1* snapshot, u4 size, export_file** export_files, int nb_export_files) {
+
+    snapshot_reader reader;
+    u1 u1Index = 0;
+
+    memset(&reader, 0, sizeof(snapshot_reader));
+    reader.input.buffer = snapshot;
+    reader.input.size = size;
+
+    if((get_u4(&reader.input) != SNAPSHOT_MAGIC) || (get_u2(&reader.input) != SNAPSHOT_VERSION)) {
+        fprintf(stderr, "Not a snapshot or unsupported snapshot version\n");
+        return NULL;
+    }
+
+    if((reader.acf = (analyzed_cap_file*)allocate(&reader, sizeof(analyzed_cap_file))) == NULL)
+        return NULL;
+
+    if(load_counts(&reader) != -1) {
+        load_constant_info(&reader);
+        load_signature_pool(&reader);
+        load_constant_pool(&reader);
+        load_interfaces(&reader);
+        load_classes(&reader);
+        load_fields(&reader);
+        load_methods(&reader);
+        load_exception_handlers(&reader);
+    }
+
+    free(reader.methods);
+    free(reader.fields);
+
+    if(reader.input.error || (reader.input.position != reader.input.size)) {
+        fprintf(stderr, "Corrupted snapshot\n");
+        return NULL;
+    }
+
+    for(; u1Index < reader.acf->imported_packages_count; ++u1Index) {
+        imported_package_info* package = reader.acf->imported_packages[u1Index];
+
+        if((package->ef = get_export_file_by_aid(package->aid, package->aid_length, export_files, nb_export_files)) == NULL) {
+            fprintf(stderr, "Could not find an export file for imported package %u\n", u1Index);
+            return NULL;
+        }
+    }
+
+    return reader.acf;
+
+}
+
+
+/**
+ * \brief Serialize an analyzed CAP file into a snapshot file.
+ *
+ * \param filename The snapshot file to write.
+ * \param acf      The analyzed CAP file to serialize.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int write_analyzed_cap_file_snapshot(const char* filename, analyzed_cap_file* acf) {
+
+    u1* snapshot = NULL;
+    u4 size = 0;
+    FILE* file = NULL;
+
+    if((snapshot = save_analyzed_cap_file_snapshot(acf, &size)) == NULL)
+        return -1;
+
+    if((file = fopen(filename, "wb")) == NULL) {
+        perror(filename);
+        free(snapshot);
+        return -1;
+    }
+
+    if(fwrite(snapshot, 1, size, file) != size) {
+        fprintf(stderr, "Could not write %s\n", filename);
+        fclose(file);
+        free(snapshot);
+        return -1;
+    }
+
+    free(snapshot);
+
+    if(fclose(file) != 0) {
+        perror(filename);
+        return -1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * \brief Rebuild an analyzed CAP file from a snapshot file.
+ *
+ * \param filename        The snapshot file to read.
+ * \param export_files    An array of parsed export files used to link the
+ *                        imported packages.
+ * \param nb_export_files The number of parsed export files in the array.
+ *
+ * \return Return the analyzed CAP file or NULL if an error occurred.
+ */
+analyzed_cap_file* read_analyzed_cap_file_snapshot(const char* filename, export_file** export_files, int nb_export_files) {
+
+    analyzed_cap_file* acf = NULL;
+    const u1* snapshot = NULL;
+    u4 size = 0;
+
+    if((snapshot = map_file(filename, &size, NULL)) == NULL)
+        return NULL;
+
+    acf = load_analyzed_cap_file_snapshot(snapshot, size, export_files, nb_export_files);
+
+    unmap_file(snapshot, size);
+    return acf;
+
+}
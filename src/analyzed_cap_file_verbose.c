@@ -47,392 +47,412 @@
 
 #include "analyzed_cap_file.h"
 #include "bytecodes.h"
+#include "verbose_sink.h"
 
-static void print_AID(u1* aid, u1 length) {
+static void print_AID(verbose_sink* sink, u1* aid, u1 length) {
 
     u1 u1Index = 0;
 
     for(;u1Index < length; ++u1Index) {
         if(u1Index != 0)
-            printf(":");
-        printf("0x%.2X", aid[u1Index]);
+            sink_printf(sink, ":");
+        sink_printf(sink, "0x%.2X", aid[u1Index]);
     }
 
 }
 
 
-void verbose_constant_info(analyzed_cap_file* acf) {
+void verbose_constant_info(verbose_sink* sink, analyzed_cap_file* acf) {
 
     u1 u1Index = 0;
 
-    printf("Constant info {\n");
+    sink_printf(sink, "Constant info {\n");
 
-    printf("\tjavacard_minor_version: %u\n", acf->info.javacard_minor_version);
-    printf("\tjavacard_major_version: %u\n\n", acf->info.javacard_major_version);
+    sink_printf(sink, "\tjavacard_minor_version: %u\n", acf->info.javacard_minor_version);
+    sink_printf(sink, "\tjavacard_major_version: %u\n\n", acf->info.javacard_major_version);
 
-    printf("\tpackage_minor_version: %u\n", acf->info.package_minor_version);
-    printf("\tpackage_major_version: %u\n", acf->info.package_major_version);
-    printf("\tpackage_aid_length: %u\n", acf->info.package_aid_length);
-    printf("\tpackage_aid: ");
-    print_AID(acf->info.package_aid, acf->info.package_aid_length);
-    printf("\n");
+    sink_printf(sink, "\tpackage_minor_version: %u\n", acf->info.package_minor_version);
+    sink_printf(sink, "\tpackage_major_version: %u\n", acf->info.package_major_version);
+    sink_printf(sink, "\tpackage_aid_length: %u\n", acf->info.package_aid_length);
+    sink_printf(sink, "\tpackage_aid: ");
+    print_AID(sink, acf->info.package_aid, acf->info.package_aid_length);
+    sink_printf(sink, "\n");
 
     if(acf->info.has_package_name) {
-        printf("\tpackage_name: %s\n", acf->info.package_name);
+        sink_printf(sink, "\tpackage_name: %s\n", acf->info.package_name);
     }
 
-    printf("\tcustom_count: %u\n", acf->info.custom_count);
+    sink_printf(sink, "\tcustom_count: %u\n", acf->info.custom_count);
     for(;u1Index < acf->info.custom_count; ++u1Index) {
-        printf("\tcustom_components[%u] {\n", u1Index);
-        printf("\t\ttag: %u\n", acf->info.custom_components[u1Index].tag);
-        printf("\t\tsize: %u\n", acf->info.custom_components[u1Index].size);
-        printf("\t\taid_length:%u\n", acf->info.custom_components[u1Index].aid_length);
-        printf("\t\taid:");
-        print_AID(acf->info.custom_components[u1Index].aid, acf->info.custom_components[u1Index].aid_length);
-        printf("\n");
-        printf("}\n");
+        sink_printf(sink, "\tcustom_components[%u] {\n", u1Index);
+        sink_printf(sink, "\t\ttag: %u\n", acf->info.custom_components[u1Index].tag);
+        sink_printf(sink, "\t\tsize: %u\n", acf->info.custom_components[u1Index].size);
+        sink_printf(sink, "\t\taid_length:%u\n", acf->info.custom_components[u1Index].aid_length);
+        sink_printf(sink, "\t\taid:");
+        print_AID(sink, acf->info.custom_components[u1Index].aid, acf->info.custom_components[u1Index].aid_length);
+        sink_printf(sink, "\n");
+        sink_printf(sink, "}\n");
     }
-    printf("}\n");
+    sink_printf(sink, "}\n");
 
 }
 
 
-void verbose_imported_package(analyzed_cap_file* acf) {
+void verbose_imported_package(verbose_sink* sink, analyzed_cap_file* acf) {
 
     u1 u1Index = 0;
 
     for(; u1Index < acf->imported_packages_count; ++u1Index) {
-        printf("imported_packages[%u] {\n", u1Index);
-        printf("\tmy_index: %u\n", acf->imported_packages[u1Index]->my_index);
-        printf("\tcount: %u\n", acf->imported_packages[u1Index]->count);
-        printf("\tminor_version: %u\n", acf->imported_packages[u1Index]->minor_version);
-        printf("\tmajor_version: %u\n", acf->imported_packages[u1Index]->major_version);
-        printf("\taid_length: %u\n", acf->imported_packages[u1Index]->aid_length);
-        printf("\taid:");
-        print_AID(acf->imported_packages[u1Index]->aid, acf->imported_packages[u1Index]->aid_length);
-        printf("\n");
-        printf("}\n");
+        sink_printf(sink, "imported_packages[%u] {\n", u1Index);
+        sink_printf(sink, "\tmy_index: %u\n", acf->imported_packages[u1Index]->my_index);
+        sink_printf(sink, "\tcount: %u\n", acf->imported_packages[u1Index]->count);
+        sink_printf(sink, "\tminor_version: %u\n", acf->imported_packages[u1Index]->minor_version);
+        sink_printf(sink, "\tmajor_version: %u\n", acf->imported_packages[u1Index]->major_version);
+        sink_printf(sink, "\taid_length: %u\n", acf->imported_packages[u1Index]->aid_length);
+        sink_printf(sink, "\taid:");
+        print_AID(sink, acf->imported_packages[u1Index]->aid, acf->imported_packages[u1Index]->aid_length);
+        sink_printf(sink, "\n");
+        sink_printf(sink, "}\n");
     }
 
 }
 
 
-void print_one_type(one_type_descriptor_info* type) {
+void print_one_type(verbose_sink* sink, one_type_descriptor_info* type) {
 
     if(type->type & TYPE_DESCRIPTOR_VOID)
-        printf("void");
+        sink_printf(sink, "void");
     else if(type->type & TYPE_DESCRIPTOR_BOOLEAN)
-        printf("boolean");
+        sink_printf(sink, "boolean");
     else if(type->type & TYPE_DESCRIPTOR_BYTE)
-        printf("byte");
+        sink_printf(sink, "byte");
     else if(type->type & TYPE_DESCRIPTOR_SHORT)
-        printf("short");
+        sink_printf(sink, "short");
     else if(type->type & TYPE_DESCRIPTOR_INT)
-        printf("int");
+        sink_printf(sink, "int");
     else if(type->type & TYPE_DESCRIPTOR_REF)
-        printf("ref");
+        sink_printf(sink, "ref");
 
     if(type->type & TYPE_DESCRIPTOR_ARRAY)
-        printf("[]");
+        sink_printf(sink, "[]");
 
 }
 
 
-void print_type_descriptor(type_descriptor_info* desc, const char* prefix) {
+void print_type_descriptor(verbose_sink* sink, type_descriptor_info* desc, const char* prefix) {
 
     if(!desc) {
-        printf("%ssignature: NULL\n", prefix);
+        sink_printf(sink, "%ssignature: NULL\n", prefix);
         return;
     }
 
     if(desc->types_count > 1) {
         u1 u1Index = 0;
-        printf("%ssignature: (", prefix);
+        sink_printf(sink, "%ssignature: (", prefix);
         if(desc->types_count > 1) {
             for(; u1Index < (desc->types_count - 2); ++u1Index) {
-                print_one_type(desc->types + u1Index);
-                printf(", ");
+                print_one_type(sink, desc->types + u1Index);
+                sink_printf(sink, ", ");
             }
-            print_one_type(desc->types + u1Index);
+            print_one_type(sink, desc->types + u1Index);
             ++u1Index;
         }
-        printf(")");
-        print_one_type(desc->types + u1Index);
-        printf("\n");
+        sink_printf(sink, ")");
+        print_one_type(sink, desc->types + u1Index);
+        sink_printf(sink, "\n");
     } else {
-        printf("%stype: ", prefix);
-        print_one_type(desc->types);
-        printf("\n");
+        sink_printf(sink, "%stype: ", prefix);
+        print_one_type(sink, desc->types);
+        sink_printf(sink, "\n");
     }
 
 }
 
 
-void verbose_constant_pool(analyzed_cap_file* acf) {
+void verbose_constant_pool(verbose_sink* sink, analyzed_cap_file* acf) {
 
     u2 u2Index = 0;
 
     for(;u2Index < acf->constant_pool_count; ++u2Index) {
-        printf("constant_pool[%u] {\n", u2Index);
+        sink_printf(sink, "constant_pool[%u] {\n", u2Index);
 
         if(acf->constant_pool[u2Index]->flags & CONSTANT_POOL_CLASSREF) {
-            printf("\tCLASSREF {\n");
-            printf("\t\tcount: %u\n", acf->constant_pool[u2Index]->count);
-            printf("\t\tis_external: %u\n", (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) != 0);
+            sink_printf(sink, "\tCLASSREF {\n");
+            sink_printf(sink, "\t\tcount: %u\n", acf->constant_pool[u2Index]->count);
+            sink_printf(sink, "\t\tis_external: %u\n", (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) != 0);
             if(acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) {
-                printf("\t\texternal_package->my_index: %u\n", acf->constant_pool[u2Index]->external_package->my_index);
-                printf("\t\texternal_class_token: %u\n", acf->constant_pool[u2Index]->external_class_token);
+                sink_printf(sink, "\t\texternal_package->my_index: %u\n", acf->constant_pool[u2Index]->external_package->my_index);
+                sink_printf(sink, "\t\texternal_class_token: %u\n", acf->constant_pool[u2Index]->external_class_token);
             } else {
                 if(acf->constant_pool[u2Index]->internal_class)
-                    printf("\t\tinternal_class->offset: %u\n", acf->constant_pool[u2Index]->internal_class->offset);
+                    sink_printf(sink, "\t\tinternal_class->offset: %u\n", acf->constant_pool[u2Index]->internal_class->offset);
                 else
-                    printf("\t\tinternal_interface->offset: %u\n", acf->constant_pool[u2Index]->internal_interface->offset);
+                    sink_printf(sink, "\t\tinternal_interface->offset: %u\n", acf->constant_pool[u2Index]->internal_interface->offset);
             }
         } else if (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_INSTANCEFIELDREF) {
-            printf("\tINSTANCEFIELDREF {\n");
-            printf("\t\tis_external: %u\n", (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) != 0);
-            printf("\t\tcount: %u\n", acf->constant_pool[u2Index]->count);
-            print_type_descriptor(acf->constant_pool[u2Index]->type, "\t\t");
+            sink_printf(sink, "\tINSTANCEFIELDREF {\n");
+            sink_printf(sink, "\t\tis_external: %u\n", (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) != 0);
+            sink_printf(sink, "\t\tcount: %u\n", acf->constant_pool[u2Index]->count);
+            print_type_descriptor(sink, acf->constant_pool[u2Index]->type, "\t\t");
             if(acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) {
-                printf("\t\texternal_package->my_index: %u\n", acf->constant_pool[u2Index]->external_package->my_index);
-                printf("\t\texternal_class_token: %u\n", acf->constant_pool[u2Index]->external_class_token);
-                printf("\t\texternal_field_token: %u\n", acf->constant_pool[u2Index]->external_field_token);
+                sink_printf(sink, "\t\texternal_package->my_index: %u\n", acf->constant_pool[u2Index]->external_package->my_index);
+                sink_printf(sink, "\t\texternal_class_token: %u\n", acf->constant_pool[u2Index]->external_class_token);
+                sink_printf(sink, "\t\texternal_field_token: %u\n", acf->constant_pool[u2Index]->external_field_token);
             } else {
-                printf("\t\tinternal_class->offset: %u\n", acf->constant_pool[u2Index]->internal_class->offset);
-                printf("\t\tinternal_field->token: %u\n", acf->constant_pool[u2Index]->internal_field->token);
+                sink_printf(sink, "\t\tinternal_class->offset: %u\n", acf->constant_pool[u2Index]->internal_class->offset);
+                sink_printf(sink, "\t\tinternal_field->token: %u\n", acf->constant_pool[u2Index]->internal_field->token);
             }
         } else if (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_VIRTUALMETHODREF) {
-            printf("\tVIRTUALMETHODREF {\n");
-            printf("\t\tis_external: %u\n", (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) != 0);
-            print_type_descriptor(acf->constant_pool[u2Index]->type, "\t\t");
+            sink_printf(sink, "\tVIRTUALMETHODREF {\n");
+            sink_printf(sink, "\t\tis_external: %u\n", (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) != 0);
+            print_type_descriptor(sink, acf->constant_pool[u2Index]->type, "\t\t");
             if(acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) {
-                printf("\t\texternal_package->my_index: %u\n", acf->constant_pool[u2Index]->external_package->my_index);
-                printf("\t\texternal_class_token: %u\n", acf->constant_pool[u2Index]->external_class_token);
-                printf("\t\texternal_method_token: %u\n", acf->constant_pool[u2Index]->method_token);
+                sink_printf(sink, "\t\texternal_package->my_index: %u\n", acf->constant_pool[u2Index]->external_package->my_index);
+                sink_printf(sink, "\t\texternal_class_token: %u\n", acf->constant_pool[u2Index]->external_class_token);
+                sink_printf(sink, "\t\texternal_method_token: %u\n", acf->constant_pool[u2Index]->method_token);
             } else {
-                printf("\t\tinternal_class->offset: %u\n", acf->constant_pool[u2Index]->internal_class->offset);
-                printf("\t\tinternal_method->offset: %u\n", acf->constant_pool[u2Index]->internal_method->offset);
+                sink_printf(sink, "\t\tinternal_class->offset: %u\n", acf->constant_pool[u2Index]->internal_class->offset);
+                sink_printf(sink, "\t\tinternal_method->offset: %u\n", acf->constant_pool[u2Index]->internal_method->offset);
             }
         } else if (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_SUPERMETHODREF) {
-            printf("\tSUPERMETHODREF {\n");
-            printf("\t\tis_external: %u\n", (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) != 0);
-            print_type_descriptor(acf->constant_pool[u2Index]->type, "\t\t");
+            sink_printf(sink, "\tSUPERMETHODREF {\n");
+            sink_printf(sink, "\t\tis_external: %u\n", (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) != 0);
+            print_type_descriptor(sink, acf->constant_pool[u2Index]->type, "\t\t");
             if(acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) {
-                printf("\t\texternal_package->my_index: %u\n", acf->constant_pool[u2Index]->external_package->my_index);
-                printf("\t\texternal_class_token: %u\n", acf->constant_pool[u2Index]->external_class_token);
+                sink_printf(sink, "\t\texternal_package->my_index: %u\n", acf->constant_pool[u2Index]->external_package->my_index);
+                sink_printf(sink, "\t\texternal_class_token: %u\n", acf->constant_pool[u2Index]->external_class_token);
             } else {
-                printf("\t\tinternal_class->offset: %u\n", acf->constant_pool[u2Index]->internal_class->offset);
+                sink_printf(sink, "\t\tinternal_class->offset: %u\n", acf->constant_pool[u2Index]->internal_class->offset);
             }
-            printf("\t\tmethod_token: %u\n", acf->constant_pool[u2Index]->method_token);
+            sink_printf(sink, "\t\tmethod_token: %u\n", acf->constant_pool[u2Index]->method_token);
         } else if (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_STATICFIELDREF) {
-            printf("\tSTATICFIELDREF {\n");
-            printf("\t\tis_external: %u\n", (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) != 0);
-            printf("\t\tcount: %u\n", acf->constant_pool[u2Index]->count);
-            print_type_descriptor(acf->constant_pool[u2Index]->type, "\t\t");
+            sink_printf(sink, "\tSTATICFIELDREF {\n");
+            sink_printf(sink, "\t\tis_external: %u\n", (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) != 0);
+            sink_printf(sink, "\t\tcount: %u\n", acf->constant_pool[u2Index]->count);
+            print_type_descriptor(sink, acf->constant_pool[u2Index]->type, "\t\t");
             if(acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) {
-                printf("\t\texternal_package->my_index: %u\n", acf->constant_pool[u2Index]->external_package->my_index);
-                printf("\t\texternal_class_token: %u\n", acf->constant_pool[u2Index]->external_class_token);
-                printf("\t\texternal_field_token: %u\n", acf->constant_pool[u2Index]->external_field_token);
+                sink_printf(sink, "\t\texternal_package->my_index: %u\n", acf->constant_pool[u2Index]->external_package->my_index);
+                sink_printf(sink, "\t\texternal_class_token: %u\n", acf->constant_pool[u2Index]->external_class_token);
+                sink_printf(sink, "\t\texternal_field_token: %u\n", acf->constant_pool[u2Index]->external_field_token);
             } else {
-                printf("\t\tinternal_class->offset: %u\n", acf->constant_pool[u2Index]->internal_class->offset);
-                printf("\t\tinternal_field->token: %u\n", acf->constant_pool[u2Index]->internal_field->token);
+                sink_printf(sink, "\t\tinternal_class->offset: %u\n", acf->constant_pool[u2Index]->internal_class->offset);
+                sink_printf(sink, "\t\tinternal_field->token: %u\n", acf->constant_pool[u2Index]->internal_field->token);
             }
         } else if (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_STATICMETHODREF) {
-            printf("\tSTATICMETHODREF {\n");
-            printf("\t\tis_external: %u\n", (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) != 0);
-            printf("\t\tcount: %u\n", acf->constant_pool[u2Index]->count);
-            print_type_descriptor(acf->constant_pool[u2Index]->type, "\t\t");
+            sink_printf(sink, "\tSTATICMETHODREF {\n");
+            sink_printf(sink, "\t\tis_external: %u\n", (acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) != 0);
+            sink_printf(sink, "\t\tcount: %u\n", acf->constant_pool[u2Index]->count);
+            print_type_descriptor(sink, acf->constant_pool[u2Index]->type, "\t\t");
             if(acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL) {
-                printf("\t\texternal_package->my_index: %u\n", acf->constant_pool[u2Index]->external_package->my_index);
-                printf("\t\texternal_class_token: %u\n", acf->constant_pool[u2Index]->external_class_token);
-                printf("\t\texternal_method_token: %u\n", acf->constant_pool[u2Index]->method_token);
+                sink_printf(sink, "\t\texternal_package->my_index: %u\n", acf->constant_pool[u2Index]->external_package->my_index);
+                sink_printf(sink, "\t\texternal_class_token: %u\n", acf->constant_pool[u2Index]->external_class_token);
+                sink_printf(sink, "\t\texternal_method_token: %u\n", acf->constant_pool[u2Index]->method_token);
             } else {
-                printf("\t\tinternal_class->offset: %u\n", acf->constant_pool[u2Index]->internal_class->offset);
-                printf("\t\tinternal_method->offset: %u\n", acf->constant_pool[u2Index]->internal_method->offset);
+                sink_printf(sink, "\t\tinternal_class->offset: %u\n", acf->constant_pool[u2Index]->internal_class->offset);
+                sink_printf(sink, "\t\tinternal_method->offset: %u\n", acf->constant_pool[u2Index]->internal_method->offset);
             }
         }
 
-        printf("\t}\n}\n");
+        sink_printf(sink, "\t}\n}\n");
     }
 
 }
 
 
-void verbose_signature_pool(analyzed_cap_file* acf) {
+void verbose_signature_pool(verbose_sink* sink, analyzed_cap_file* acf) {
 
     u2 u2Index = 0;
 
-    printf("signature poll {\n");
+    sink_printf(sink, "signature poll {\n");
 
     for(; u2Index < acf->signature_pool_count; ++u2Index) {
         char prefix[16];
 
         sprintf(prefix, "\t%3u: ", u2Index);
-        print_type_descriptor(acf->signature_pool[u2Index], prefix);
+        print_type_descriptor(sink, acf->signature_pool[u2Index], prefix);
     }
 
-    printf("}\n");
+    sink_printf(sink, "}\n");
 
 }
 
 
-void print_bytecodes(bytecode_info** bytecodes, u2 bytecodes_count, const char* prefix) {
+void print_bytecodes(verbose_sink* sink, bytecode_info** bytecodes, u2 bytecodes_count, const char* prefix) {
 
     u2 u2Index = 0;
 
     for(; u2Index < bytecodes_count; ++u2Index) {
-        printf("%s\t%2u(%2u): %s", prefix, bytecodes[u2Index]->offset, bytecodes[u2Index]->info_offset, mnemonics[bytecodes[u2Index]->opcode]);
-        if(bytecodes[u2Index]->opcode == 115) {
-            u2 crt_case = 0;
-            printf("{\n");
-            for(; crt_case < bytecodes[u2Index]->stableswitch.nb_cases; ++crt_case)
-                printf("%s\t\tcase %u: offset %u\n", prefix, bytecodes[u2Index]->stableswitch.low + crt_case, bytecodes[u2Index]->stableswitch.branches[crt_case]->offset);
-            printf("%s\t\tdefault: offset %u\n%s\t};\n", prefix, bytecodes[u2Index]->stableswitch.default_branch->offset, prefix);
-        } else if(bytecodes[u2Index]->opcode == 117) {
-            u2 crt_case = 0;
-            printf("{\n");
-            for(; crt_case < bytecodes[u2Index]->slookupswitch.nb_cases; ++crt_case)
-                printf("%s\t\tcase %d: offset %u\n", prefix, bytecodes[u2Index]->slookupswitch.cases[crt_case].match, bytecodes[u2Index]->slookupswitch.cases[crt_case].branch->offset);
-            printf("%s\t\tdefault: offset %u\n%s\t};\n", prefix, bytecodes[u2Index]->slookupswitch.default_branch->offset, prefix);
-        } else if(bytecodes[u2Index]->nb_args) {
-            u1 u1Index = 0;
-            for(;u1Index < bytecodes[u2Index]->nb_byte_args; ++u1Index)
-                printf(" %.2X", bytecodes[u2Index]->args[u1Index]);
-            if(bytecodes[u2Index]->has_ref)
-                printf(" cp_ref: %u", bytecodes[u2Index]->ref->my_index);
-            if(bytecodes[u2Index]->has_branch)
-                printf(" branch: %u", bytecodes[u2Index]->branch->offset);
-            printf(";\n");
-        } else {
-            printf(";\n");
+        bytecode_info* bytecode = bytecodes[u2Index];
+        u2 crt_case = 0;
+        u1 u1Index = 0;
+
+        sink_printf(sink, "%s\t%2u(%2u): %s", prefix, bytecode->offset, bytecode->info_offset, opcodes[bytecode->opcode].mnemonic);
+
+        switch(opcodes[bytecode->opcode].format) {
+            case OPCODE_FORMAT_STABLESWITCH:
+                sink_printf(sink, "{\n");
+                for(; crt_case < bytecode->switch_data->stableswitch.nb_cases; ++crt_case)
+                    sink_printf(sink, "%s\t\tcase %d: offset %u\n", prefix, bytecode->switch_data->stableswitch.low + crt_case, bytecode->switch_data->stableswitch.branches[crt_case]->offset);
+                sink_printf(sink, "%s\t\tdefault: offset %u\n%s\t};\n", prefix, bytecode->switch_data->stableswitch.default_branch->offset, prefix);
+                break;
+
+            case OPCODE_FORMAT_ITABLESWITCH:
+                sink_printf(sink, "{\n");
+                for(; crt_case < bytecode->switch_data->itableswitch.nb_cases; ++crt_case)
+                    sink_printf(sink, "%s\t\tcase %ld: offset %u\n", prefix, (long)bytecode->switch_data->itableswitch.low + crt_case, bytecode->switch_data->itableswitch.branches[crt_case]->offset);
+                sink_printf(sink, "%s\t\tdefault: offset %u\n%s\t};\n", prefix, bytecode->switch_data->itableswitch.default_branch->offset, prefix);
+                break;
+
+            case OPCODE_FORMAT_SLOOKUPSWITCH:
+                sink_printf(sink, "{\n");
+                for(; crt_case < bytecode->switch_data->slookupswitch.nb_cases; ++crt_case)
+                    sink_printf(sink, "%s\t\tcase %d: offset %u\n", prefix, bytecode->switch_data->slookupswitch.cases[crt_case].match, bytecode->switch_data->slookupswitch.cases[crt_case].branch->offset);
+                sink_printf(sink, "%s\t\tdefault: offset %u\n%s\t};\n", prefix, bytecode->switch_data->slookupswitch.default_branch->offset, prefix);
+                break;
+
+            case OPCODE_FORMAT_ILOOKUPSWITCH:
+                sink_printf(sink, "{\n");
+                for(; crt_case < bytecode->switch_data->ilookupswitch.nb_cases; ++crt_case)
+                    sink_printf(sink, "%s\t\tcase %ld: offset %u\n", prefix, (long)bytecode->switch_data->ilookupswitch.cases[crt_case].match, bytecode->switch_data->ilookupswitch.cases[crt_case].branch->offset);
+                sink_printf(sink, "%s\t\tdefault: offset %u\n%s\t};\n", prefix, bytecode->switch_data->ilookupswitch.default_branch->offset, prefix);
+                break;
+
+            default:
+                for(; u1Index < bytecode->nb_byte_args; ++u1Index)
+                    sink_printf(sink, " %.2X", bytecode->args[u1Index]);
+                if(bytecode->has_ref)
+                    sink_printf(sink, " cp_ref: %u", bytecode->ref->my_index);
+                if(bytecode->has_branch)
+                    sink_printf(sink, " branch: %u", bytecode->branch->offset);
+                sink_printf(sink, ";\n");
         }
     }
 
 }
 
 
-void verbose_method(method_info* method, const char* prefix) {
-    printf("%stoken: %u\n", prefix, method->token);
-    printf("%soffset: %u\n", prefix, method->offset);
-    printf("%sflags:", prefix);
+void verbose_method(verbose_sink* sink, method_info* method, const char* prefix) {
+    sink_printf(sink, "%stoken: %u\n", prefix, method->token);
+    sink_printf(sink, "%soffset: %u\n", prefix, method->offset);
+    sink_printf(sink, "%sflags:", prefix);
     if(method->flags & METHOD_PUBLIC)
-        printf(" PUBLIC");
+        sink_printf(sink, " PUBLIC");
     if(method->flags & METHOD_PRIVATE)
-        printf(" PRIVATE");
+        sink_printf(sink, " PRIVATE");
     if(method->flags & METHOD_PROTECTED)
-        printf(" PROTECTED");
+        sink_printf(sink, " PROTECTED");
     if(method->flags & METHOD_PACKAGE)
-        printf(" PACKAGE");
+        sink_printf(sink, " PACKAGE");
     if(method->flags & METHOD_STATIC)
-        printf(" STATIC");
+        sink_printf(sink, " STATIC");
     if(method->flags & METHOD_FINAL)
-        printf(" FINAL");
+        sink_printf(sink, " FINAL");
     if(method->flags & METHOD_ABSTRACT)
-        printf(" ABSTRACT");
+        sink_printf(sink, " ABSTRACT");
     if(method->flags & METHOD_INIT)
-        printf(" INIT");
+        sink_printf(sink, " INIT");
     if(method->flags & METHOD_EXTENDED)
-        printf(" EXTENDED");
-    printf("\n");
+        sink_printf(sink, " EXTENDED");
+    sink_printf(sink, "\n");
 
-    printf("%smax_stack: %u\n", prefix, method->max_stack);
-    printf("%snargs: %u\n", prefix, method->nargs);
-    printf("%smax_locals: %u\n", prefix, method->max_locals);
+    sink_printf(sink, "%smax_stack: %u\n", prefix, method->max_stack);
+    sink_printf(sink, "%snargs: %u\n", prefix, method->nargs);
+    sink_printf(sink, "%smax_locals: %u\n", prefix, method->max_locals);
 
     if(method->is_overriding)
-        printf("%sis_overriding\n", prefix);
+        sink_printf(sink, "%sis_overriding\n", prefix);
 
     if(method->internal_overrided_method)
-        printf("%sinternal_overrided_method: %u\n", prefix, method->internal_overrided_method->offset);
+        sink_printf(sink, "%sinternal_overrided_method: %u\n", prefix, method->internal_overrided_method->offset);
 
-    print_type_descriptor(method->signature, prefix);
-    printf("%sbytecode_count: %u\n", prefix, method->bytecodes_count);
-    printf("%sbytecodes:\n", prefix);
-    print_bytecodes(method->bytecodes, method->bytecodes_count, prefix);
+    print_type_descriptor(sink, method->signature, prefix);
+    sink_printf(sink, "%sbytecode_count: %u\n", prefix, method->bytecodes_count);
+    sink_printf(sink, "%sbytecodes:\n", prefix);
+    print_bytecodes(sink, method->bytecodes, method->bytecodes_count, prefix);
 
 }
 
 
-void verbose_interfaces(analyzed_cap_file* acf) {
+void verbose_interfaces(verbose_sink* sink, analyzed_cap_file* acf) {
 
     u2 u2Index1 = 0;
 
     for(; u2Index1 < acf->interfaces_count; ++u2Index1) {
         u1 u1Index = 0;
         u2 u2Index2 = 0;
-        printf("interfaces[%u] {\n", u2Index1);
-        printf("\ttoken: %u\n", acf->interfaces[u2Index1]->token);
-        printf("\toffset: %u\n", acf->interfaces[u2Index1]->offset);
-        printf("\tflags:");
+        sink_printf(sink, "interfaces[%u] {\n", u2Index1);
+        sink_printf(sink, "\ttoken: %u\n", acf->interfaces[u2Index1]->token);
+        sink_printf(sink, "\toffset: %u\n", acf->interfaces[u2Index1]->offset);
+        sink_printf(sink, "\tflags:");
         if(acf->interfaces[u2Index1]->flags & INTERFACE_SHAREABLE)
-            printf(" SHAREABLE");
+            sink_printf(sink, " SHAREABLE");
         if(acf->interfaces[u2Index1]->flags & INTERFACE_REMOTE)
-            printf(" REMOTE");
+            sink_printf(sink, " REMOTE");
         if(acf->interfaces[u2Index1]->flags & INTERFACE_PUBLIC)
-            printf(" PUBLIC");
+            sink_printf(sink, " PUBLIC");
         if(acf->interfaces[u2Index1]->flags & INTERFACE_PACKAGE)
-            printf(" PACKAGE");
+            sink_printf(sink, " PACKAGE");
         if(acf->interfaces[u2Index1]->flags & INTERFACE_ABSTRACT)
-            printf(" ABSTRACT");
-        printf("\n");
+            sink_printf(sink, " ABSTRACT");
+        sink_printf(sink, "\n");
         for(; u1Index < acf->interfaces[u2Index1]->superinterfaces_count; ++u1Index)
-            printf("\tsuperinterfaces[%u]->my_index: %u\n", u1Index, acf->interfaces[u2Index1]->superinterfaces[u1Index]->my_index);
+            sink_printf(sink, "\tsuperinterfaces[%u]->my_index: %u\n", u1Index, acf->interfaces[u2Index1]->superinterfaces[u1Index]->my_index);
         for(; u2Index2 < acf->interfaces[u2Index1]->methods_count; ++u2Index2) {
-            printf("\tmethods[%u] {\n", u2Index2);
-            verbose_method(acf->interfaces[u2Index1]->methods[u2Index2], "\t\t");
-            printf("\t}\n");
+            sink_printf(sink, "\tmethods[%u] {\n", u2Index2);
+            verbose_method(sink, acf->interfaces[u2Index1]->methods[u2Index2], "\t\t");
+            sink_printf(sink, "\t}\n");
         }
-        printf("}\n");
+        sink_printf(sink, "}\n");
     }
 
 }
 
 
-void printAID(u1* aid, u1 length) {
+void printAID(verbose_sink* sink, u1* aid, u1 length) {
 
     u1 u1Index = 0;
 
     for(;u1Index < length; ++u1Index) {
         if(u1Index != 0)
-            printf(":");
-        printf("0x%.2X", aid[u1Index]);
+            sink_printf(sink, ":");
+        sink_printf(sink, "0x%.2X", aid[u1Index]);
     }
 
 }
 
 
-void verbose_field(field_info* field, const char* prefix) {
+void verbose_field(verbose_sink* sink, field_info* field, const char* prefix) {
 
-    printf("%stoken: %u\n", prefix, field->token);
-    printf("%sflags:", prefix);
+    sink_printf(sink, "%stoken: %u\n", prefix, field->token);
+    sink_printf(sink, "%sflags:", prefix);
     if(field->flags & FIELD_PUBLIC)
-        printf(" PUBLIC");
+        sink_printf(sink, " PUBLIC");
     if(field->flags & FIELD_PRIVATE)
-        printf(" PRIVATE");
+        sink_printf(sink, " PRIVATE");
     if(field->flags & FIELD_PROTECTED)
-        printf(" PROTECTED");
+        sink_printf(sink, " PROTECTED");
     if(field->flags & FIELD_PACKAGE)
-        printf(" PACKAGE");
+        sink_printf(sink, " PACKAGE");
     if(field->flags & FIELD_STATIC)
-        printf(" STATIC");
+        sink_printf(sink, " STATIC");
     if(field->flags & FIELD_FINAL)
-        printf(" FINAL");
-    printf("\n");
+        sink_printf(sink, " FINAL");
+    sink_printf(sink, "\n");
 
-    print_type_descriptor(field->type, prefix);
+    print_type_descriptor(sink, field->type, prefix);
 
     if(field->flags & FIELD_HAS_VALUE) {
         u2 u2Index = 0;
-        printf("%svalue:", prefix);
+        sink_printf(sink, "%svalue:", prefix);
         for(; u2Index < field->value_size; ++u2Index)
-            printf(" %.2X", field->value[u2Index]);
-        printf("\n");
+            sink_printf(sink, " %.2X", field->value[u2Index]);
+        sink_printf(sink, "\n");
     }
 
 }
 
 
-void verbose_classes(analyzed_cap_file* acf) {
+void verbose_classes(verbose_sink* sink, analyzed_cap_file* acf) {
 
     u2 u2Index1 = 0;
 
@@ -440,86 +460,86 @@ void verbose_classes(analyzed_cap_file* acf) {
         u1 u1Index1 = 0;
         u2 u2Index2 = 0;
 
-        printf("classes[%u] {\n", u2Index1);
+        sink_printf(sink, "classes[%u] {\n", u2Index1);
 
-        printf("\ttoken: %u\n", acf->classes[u2Index1]->token);
-        printf("\toffset: %u\n", acf->classes[u2Index1]->offset);
+        sink_printf(sink, "\ttoken: %u\n", acf->classes[u2Index1]->token);
+        sink_printf(sink, "\toffset: %u\n", acf->classes[u2Index1]->offset);
 
-        printf("\tflags:");
+        sink_printf(sink, "\tflags:");
         if(acf->classes[u2Index1]->flags & CLASS_PUBLIC)
-            printf(" PUBLIC");
+            sink_printf(sink, " PUBLIC");
         if(acf->classes[u2Index1]->flags & CLASS_PACKAGE)
-            printf(" PACKAGE");
+            sink_printf(sink, " PACKAGE");
         if(acf->classes[u2Index1]->flags & CLASS_FINAL)
-            printf(" FINAL");
+            sink_printf(sink, " FINAL");
         if(acf->classes[u2Index1]->flags & CLASS_ABSTRACT)
-            printf(" ABSTRACT");
+            sink_printf(sink, " ABSTRACT");
         if(acf->classes[u2Index1]->flags & CLASS_SHAREABLE)
-            printf(" SHAREABLE");
+            sink_printf(sink, " SHAREABLE");
         if(acf->classes[u2Index1]->flags & CLASS_REMOTE)
-            printf(" REMOTE");
-        printf("\n");
+            sink_printf(sink, " REMOTE");
+        sink_printf(sink, "\n");
 
         if(acf->classes[u2Index1]->flags & CLASS_APPLET) {
-            printf("\tAID: ");
-            printAID(acf->classes[u2Index1]->aid, acf->classes[u2Index1]->aid_length);
-            printf("\n");
-            printf("\tinstall_method->offset: %u\n", acf->classes[u2Index1]->install_method->offset);
+            sink_printf(sink, "\tAID: ");
+            printAID(sink, acf->classes[u2Index1]->aid, acf->classes[u2Index1]->aid_length);
+            sink_printf(sink, "\n");
+            sink_printf(sink, "\tinstall_method->offset: %u\n", acf->classes[u2Index1]->install_method->offset);
         }
 
         if(acf->classes[u2Index1]->superclass)
-            printf("\tsuperclass->my_index: %u\n", acf->classes[u2Index1]->superclass->my_index);
+            sink_printf(sink, "\tsuperclass->my_index: %u\n", acf->classes[u2Index1]->superclass->my_index);
 
         for(; u1Index1 < acf->classes[u2Index1]->interfaces_count; ++u1Index1) {
             u1 u1Index2 = 0;
 
-            printf("\tinterfaces[%u] {\n", u1Index1);
-            printf("\t\tref->my_index: %u\n", acf->classes[u2Index1]->interfaces[u1Index1].ref->my_index);
+            sink_printf(sink, "\tinterfaces[%u] {\n", u1Index1);
+            sink_printf(sink, "\t\tref->my_index: %u\n", acf->classes[u2Index1]->interfaces[u1Index1].ref->my_index);
 
             for(; u1Index2 < acf->classes[u2Index1]->interfaces[u1Index1].count; ++u1Index2) {
-                printf("\t\tindex[%u] {\n", u1Index2);
+                sink_printf(sink, "\t\tindex[%u] {\n", u1Index2);
                 if(acf->classes[u2Index1]->interfaces[u1Index1].index[u1Index2].declaration)
-                    printf("\t\t\tdeclaration->offset: %u\n", acf->classes[u2Index1]->interfaces[u1Index1].index[u1Index2].declaration->offset);
+                    sink_printf(sink, "\t\t\tdeclaration->offset: %u\n", acf->classes[u2Index1]->interfaces[u1Index1].index[u1Index2].declaration->offset);
                 if(acf->classes[u2Index1]->interfaces[u1Index1].index[u2Index2].implementation)
-                    printf("\t\t\timplementation->offset: %u\n", acf->classes[u2Index1]->interfaces[u1Index1].index[u1Index2].implementation->offset);
+                    sink_printf(sink, "\t\t\timplementation->offset: %u\n", acf->classes[u2Index1]->interfaces[u1Index1].index[u1Index2].implementation->offset);
             }
-            printf("}\n");
+            sink_printf(sink, "}\n");
         }
 
         for(; u2Index2 < acf->classes[u2Index1]->fields_count; ++u2Index2) {
-            printf("\tfields[%u] {\n", u2Index2);
-            verbose_field(acf->classes[u2Index1]->fields[u2Index2], "\t\t");
-            printf("\t}\n");
+            sink_printf(sink, "\tfields[%u] {\n", u2Index2);
+            verbose_field(sink, acf->classes[u2Index1]->fields[u2Index2], "\t\t");
+            sink_printf(sink, "\t}\n");
         }
 
         for(u2Index2 = 0; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
-            printf("\tmethods[%u] {\n", u2Index2);
-            verbose_method(acf->classes[u2Index1]->methods[u2Index2], "\t\t");
-            printf("\t}\n");
+            sink_printf(sink, "\tmethods[%u] {\n", u2Index2);
+            verbose_method(sink, acf->classes[u2Index1]->methods[u2Index2], "\t\t");
+            sink_printf(sink, "\t}\n");
         }
 
-        printf("}\n");
+        sink_printf(sink, "}\n");
     }
 
 }
 
 
-void verbose_exception_handlers(analyzed_cap_file* acf) {
+void verbose_exception_handlers(verbose_sink* sink, analyzed_cap_file* acf) {
 
     u1 u1Index = 0;
 
     for(; u1Index < acf->exception_handlers_count; ++u1Index) {
-        printf("exception_handlers[%u] {\n", u1Index);
-        printf("\tstop_bit: %u\n", acf->exception_handlers[u1Index]->stop_bit);
+        sink_printf(sink, "exception_handlers[%u] {\n", u1Index);
+        sink_printf(sink, "\tstop_bit: %u\n", acf->exception_handlers[u1Index]->stop_bit);
         if(acf->exception_handlers[u1Index]->start)
-            printf("\tstart->offset: %u\n", acf->exception_handlers[u1Index]->start->info_offset);
+            sink_printf(sink, "\tstart->offset: %u\n", acf->exception_handlers[u1Index]->start->info_offset);
         if(acf->exception_handlers[u1Index]->end)
-            printf("\tend->offset: %u\n", acf->exception_handlers[u1Index]->end->info_offset);
+            sink_printf(sink, "\tend->offset: %u\n", acf->exception_handlers[u1Index]->end->info_offset);
         if(acf->exception_handlers[u1Index]->handler)
-            printf("\thandler->offset: %u\n", acf->exception_handlers[u1Index]->handler->info_offset);
+            sink_printf(sink, "\thandler->offset: %u\n", acf->exception_handlers[u1Index]->handler->info_offset);
         if(acf->exception_handlers[u1Index]->catch_type)
-            printf("\tcatch_type->my_index: %u\n", acf->exception_handlers[u1Index]->catch_type->my_index);
-        printf("}\n");
+            sink_printf(sink, "\tcatch_type->my_index: %u\n", acf->exception_handlers[u1Index]->catch_type->my_index);
+        sink_printf(sink, "}\n");
     }
 
 }
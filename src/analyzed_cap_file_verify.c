@@ -0,0 +1,1398 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file analyzed_cap_file_verify.c
+ * \brief Verify the bytecodes of an analyzed CAP file by typed dataflow
+ * analysis, the way an off-card verifier does.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_cfg.h"
+#include "analyzed_cap_file_frame.h"
+#include "analyzed_cap_file_verify.h"
+#include "bytecodes.h"
+#include "exp_file.h"
+#include "verbose_sink.h"
+
+#define VERIFY_TOP              0   /**< A word which cannot be used, also
+                                         the type of void. */
+#define VERIFY_SHORT            1   /**< A short, byte or boolean. */
+#define VERIFY_INT              2   /**< An int or its high word. */
+#define VERIFY_INT_LOW          3   /**< The low word of an int. */
+#define VERIFY_RETURN_ADDRESS   4   /**< Pushed by jsr. */
+#define VERIFY_NULL             5   /**< The null reference. */
+#define VERIFY_REFERENCE        6   /**< An object or an array of unknown
+                                         type. */
+#define VERIFY_BYTE_ARRAY       7   /**< An array of bytes or booleans. */
+#define VERIFY_SHORT_ARRAY      8   /**< An array of shorts. */
+#define VERIFY_INT_ARRAY        9   /**< An array of ints. */
+#define VERIFY_REFERENCE_ARRAY  10  /**< An array of references. */
+
+/**
+ * The name of each type in failure messages.
+ */
+static const char* type_names[] = {"an unusable word", "a short", "an int", "an int", "a return address", "null", "a reference", "a byte array", "a short array", "an int array", "a reference array"};
+
+/**
+ * \brief The state of the verification of a method.
+ */
+typedef struct {
+    method_info* method;        /**< The method. */
+    method_cfg* cfg;            /**< The graph of the method. */
+    u2* offsets;                /**< The offset of each bytecode. */
+
+    u2 locals_count;            /**< nargs plus max_locals. */
+    u2 max_stack;               /**< The declared operand stack size. */
+    u2 frame_size;              /**< The number of words of a frame, local
+                                     variables first. */
+
+    u1* frames;                 /**< The types at the start of each block. */
+    int16_t* depths;            /**< The operand stack depth at the start of
+                                     each block, -1 if not reached yet. */
+    u1* pending;                /**< Whether each block must be verified
+                                     again. */
+
+    u1* types;                  /**< The types before the current
+                                     bytecode. */
+    u2 depth;                   /**< The current operand stack depth. */
+    u1* saved;                  /**< The types before the last jsr. */
+    u2 saved_depth;             /**< The operand stack depth before the last
+                                     jsr. */
+
+    u2 index;                   /**< The index of the current bytecode or
+                                     CFG_NONE. */
+    verify_failure* failure;    /**< Where to report a failure. */
+} verifier;
+
+
+/**
+ * Report a failure at the current bytecode. Always return -1.
+ */
+static int fail(verifier* v, const char* format, ...) {
+
+    va_list arguments;
+
+    if(v->index == CFG_NONE) {
+        v->failure->offset = VERIFY_NO_OFFSET;
+        v->failure->opcode = 0;
+    } else {
+        v->failure->offset = v->offsets[v->index];
+        v->failure->opcode = v->method->bytecodes[v->index]->opcode;
+    }
+
+    va_start(arguments, format);
+    vsnprintf(v->failure->message, VERIFY_MESSAGE_LENGTH, format, arguments);
+    va_end(arguments);
+
+    return -1;
+
+}
+
+
+/**
+ * Tell if a type is a reference.
+ */
+static char is_reference(u1 type) {
+
+    return type >= VERIFY_NULL;
+
+}
+
+
+/**
+ * Tell if a value of a type may be used where another is expected.
+ */
+static char is_assignable(u1 type, u1 expected) {
+
+    if(type == expected)
+        return 1;
+
+    if(expected == VERIFY_REFERENCE)
+        return is_reference(type);
+
+    if(expected > VERIFY_REFERENCE)
+        return type == VERIFY_NULL;
+
+    return 0;
+
+}
+
+
+/**
+ * Get the type holding the values of two types, VERIFY_TOP if there is none.
+ */
+static u1 merge_types(u1 type1, u1 type2) {
+
+    if(type1 == type2)
+        return type1;
+
+    if(is_reference(type1) && is_reference(type2)) {
+        if(type1 == VERIFY_NULL)
+            return type2;
+        if(type2 == VERIFY_NULL)
+            return type1;
+        return VERIFY_REFERENCE;
+    }
+
+    return VERIFY_TOP;
+
+}
+
+
+/**
+ * Get the type of a field, parameter or return type.
+ */
+static u1 get_descriptor_type(const one_type_descriptor_info* type) {
+
+    if(type->type & TYPE_DESCRIPTOR_ARRAY) {
+        if(type->type & (TYPE_DESCRIPTOR_BOOLEAN|TYPE_DESCRIPTOR_BYTE))
+            return VERIFY_BYTE_ARRAY;
+        if(type->type & TYPE_DESCRIPTOR_SHORT)
+            return VERIFY_SHORT_ARRAY;
+        if(type->type & TYPE_DESCRIPTOR_INT)
+            return VERIFY_INT_ARRAY;
+        return VERIFY_REFERENCE_ARRAY;
+    }
+
+    if(type->type & TYPE_DESCRIPTOR_REF)
+        return VERIFY_REFERENCE;
+
+    if(type->type == TYPE_DESCRIPTOR_INT)
+        return VERIFY_INT;
+
+    if(type->type == TYPE_DESCRIPTOR_VOID)
+        return VERIFY_TOP;
+
+    return VERIFY_SHORT;
+
+}
+
+
+/**
+ * Get the type of the Java type at a position of an export file descriptor
+ * and move past it. Return -1 if it is malformed.
+ */
+static int parse_export_type(const ef_cp_info* descriptor, u2* position, u1* type) {
+
+    const u1* bytes = descriptor->CONSTANT_Utf8.bytes;
+    u2 length = descriptor->CONSTANT_Utf8.length;
+    char is_array = 0;
+
+    if((*position < length) && (bytes[*position] == '[')) {
+        is_array = 1;
+        ++*position;
+    }
+
+    if(*position >= length)
+        return -1;
+
+    switch(bytes[(*position)++]) {
+        case 'V':
+            *type = VERIFY_TOP;
+            return is_array ? -1 : 0;
+
+        case 'Z':
+        case 'B':
+            *type = is_array ? VERIFY_BYTE_ARRAY : VERIFY_SHORT;
+            return 0;
+
+        case 'S':
+            *type = is_array ? VERIFY_SHORT_ARRAY : VERIFY_SHORT;
+            return 0;
+
+        case 'I':
+            *type = is_array ? VERIFY_INT_ARRAY : VERIFY_INT;
+            return 0;
+
+        case 'L':
+            while((*position < length) && (bytes[*position] != ';'))
+                ++*position;
+            if(*position++ >= length)
+                return -1;
+            *type = is_array ? VERIFY_REFERENCE_ARRAY : VERIFY_REFERENCE;
+            return 0;
+    }
+
+    return -1;
+
+}
+
+
+/**
+ * Push a value onto the operand stack.
+ */
+static int push(verifier* v, u1 type) {
+
+    u1* stack = v->types + v->locals_count;
+
+    if(v->depth + ((type == VERIFY_INT) ? 2 : 1) > v->max_stack)
+        return fail(v, "Operand stack above max_stack (%u)", v->max_stack);
+
+    stack[v->depth++] = type;
+    if(type == VERIFY_INT)
+        stack[v->depth++] = VERIFY_INT_LOW;
+
+    return 0;
+
+}
+
+
+/**
+ * Pop a value of the expected type from the operand stack.
+ */
+static int pop(verifier* v, u1 expected) {
+
+    u1* stack = v->types + v->locals_count;
+
+    if(v->depth < ((expected == VERIFY_INT) ? 2 : 1))
+        return fail(v, "Operand stack underflow");
+
+    if(expected == VERIFY_INT) {
+        if((stack[v->depth - 2] != VERIFY_INT) || (stack[v->depth - 1] != VERIFY_INT_LOW))
+            return fail(v, "Expected an int on the operand stack, found %s", type_names[stack[v->depth - 1]]);
+        v->depth -= 2;
+        return 0;
+    }
+
+    if(!is_assignable(stack[v->depth - 1], expected))
+        return fail(v, "Expected %s on the operand stack, found %s", type_names[expected], type_names[stack[v->depth - 1]]);
+
+    --v->depth;
+
+    return 0;
+
+}
+
+
+/**
+ * Pop any reference from the operand stack.
+ */
+static int pop_reference(verifier* v, u1* type) {
+
+    u1* stack = v->types + v->locals_count;
+
+    if(v->depth < 1)
+        return fail(v, "Operand stack underflow");
+
+    if(!is_reference(stack[v->depth - 1]))
+        return fail(v, "Expected a reference on the operand stack, found %s", type_names[stack[v->depth - 1]]);
+
+    *type = stack[--v->depth];
+
+    return 0;
+
+}
+
+
+/**
+ * Check that the words moved by a stack manipulation do not split an int.
+ */
+static int check_words(verifier* v, u2 words) {
+
+    if(v->depth < words)
+        return fail(v, "Operand stack underflow");
+
+    if((words != 0) && (v->types[v->locals_count + v->depth - words] == VERIFY_INT_LOW))
+        return fail(v, "Operand stack manipulation splits an int");
+
+    return 0;
+
+}
+
+
+/**
+ * Check that a local variable of some words is within the frame.
+ */
+static int check_local(verifier* v, u2 local, u1 words) {
+
+    if(local + words > v->locals_count)
+        return fail(v, "Local variable %u beyond nargs and max_locals (%u)", local, v->locals_count);
+
+    return 0;
+
+}
+
+
+/**
+ * Push the value of a local variable of the expected type.
+ */
+static int load(verifier* v, u1 local, u1 expected) {
+
+    if(check_local(v, local, (expected == VERIFY_INT) ? 2 : 1) == -1)
+        return -1;
+
+    if(expected == VERIFY_INT) {
+        if((v->types[local] != VERIFY_INT) || (v->types[local + 1] != VERIFY_INT_LOW))
+            return fail(v, "Local variable %u does not hold an int", local);
+        return push(v, VERIFY_INT);
+    }
+
+    if(expected == VERIFY_REFERENCE) {
+        if(!is_reference(v->types[local]))
+            return fail(v, "Local variable %u does not hold a reference", local);
+        return push(v, v->types[local]);
+    }
+
+    if(v->types[local] != VERIFY_SHORT)
+        return fail(v, "Local variable %u does not hold a short", local);
+
+    return push(v, VERIFY_SHORT);
+
+}
+
+
+/**
+ * Set the type of a local variable word.
+ */
+static void set_local(verifier* v, u2 local, u1 type) {
+
+    /* Overwriting one word of an int makes the other unusable. */
+    if((v->types[local] == VERIFY_INT_LOW) && (local > 0))
+        v->types[local - 1] = VERIFY_TOP;
+    if((v->types[local] == VERIFY_INT) && (local + 1 < v->locals_count))
+        v->types[local + 1] = VERIFY_TOP;
+
+    v->types[local] = type;
+
+}
+
+
+/**
+ * Pop a value of the expected type into a local variable. astore also
+ * stores return addresses.
+ */
+static int store(verifier* v, u1 local, u1 expected) {
+
+    u1 type = expected;
+
+    if(check_local(v, local, (expected == VERIFY_INT) ? 2 : 1) == -1)
+        return -1;
+
+    if(expected == VERIFY_REFERENCE) {
+        if(v->depth < 1)
+            return fail(v, "Operand stack underflow");
+
+        type = v->types[v->locals_count + v->depth - 1];
+        if(!is_reference(type) && (type != VERIFY_RETURN_ADDRESS))
+            return fail(v, "Expected a reference on the operand stack, found %s", type_names[type]);
+
+        --v->depth;
+    } else if(pop(v, expected) == -1)
+        return -1;
+
+    set_local(v, local, type);
+    if(type == VERIFY_INT)
+        set_local(v, local + 1, VERIFY_INT_LOW);
+
+    return 0;
+
+}
+
+
+/**
+ * Check the kind of the constant pool entry of a bytecode.
+ */
+static int check_ref(verifier* v, bytecode_info* bytecode, u1 flags) {
+
+    if(bytecode->ref == NULL)
+        return fail(v, "Missing constant pool entry");
+
+    if(!(bytecode->ref->flags & flags))
+        return fail(v, "Constant pool entry %u is of the wrong kind", bytecode->ref->my_index);
+
+    return 0;
+
+}
+
+
+/**
+ * Check the constant pool entry of a field access and get the type of the
+ * field. kind is 0 for _a, 1 for _b, 2 for _s and 3 for _i accesses.
+ */
+static int get_field_type(verifier* v, bytecode_info* bytecode, u1 flags, u1 kind, u1* type) {
+
+    u1 field_type = 0;
+
+    if(check_ref(v, bytecode, flags) == -1)
+        return -1;
+
+    if((bytecode->ref->type == NULL) || (bytecode->ref->type->types_count == 0))
+        return fail(v, "Missing type of constant pool entry %u", bytecode->ref->my_index);
+
+    field_type = bytecode->ref->type->types->type;
+    *type = get_descriptor_type(bytecode->ref->type->types);
+
+    if(((kind == 0) && !(field_type & (TYPE_DESCRIPTOR_REF|TYPE_DESCRIPTOR_ARRAY))) ||
+       ((kind == 1) && (field_type != TYPE_DESCRIPTOR_BYTE) && (field_type != TYPE_DESCRIPTOR_BOOLEAN)) ||
+       ((kind == 2) && (field_type != TYPE_DESCRIPTOR_SHORT)) ||
+       ((kind == 3) && (field_type != TYPE_DESCRIPTOR_INT)))
+        return fail(v, "Access to a field of another type");
+
+    return 0;
+
+}
+
+
+/**
+ * Get the parameter and return types of the method called by an invoke
+ * bytecode.
+ */
+static int get_invoked_signature(verifier* v, bytecode_info* bytecode, u1* parameters, u1* parameters_count, u1* return_type) {
+
+    type_descriptor_info* signature = NULL;
+    constant_pool_entry_info* ref = bytecode->ref;
+    u1 u1Index = 0;
+
+    if(bytecode->opcode == 142) {
+        if(ref->flags & CONSTANT_POOL_IS_EXTERNAL) {
+            ef_cp_info* descriptor = get_export_method_descriptor(ref->external_package->ef, ref->external_class_token, bytecode->args[1]);
+            u2 position = 1;
+
+            if(descriptor == NULL)
+                return fail(v, "Interface method %u not found in the export files", bytecode->args[1]);
+
+            *parameters_count = 0;
+            while((position < descriptor->CONSTANT_Utf8.length) && (descriptor->CONSTANT_Utf8.bytes[position] != ')')) {
+                if((*parameters_count == 255) || (parse_export_type(descriptor, &position, parameters + *parameters_count) == -1))
+                    return fail(v, "Malformed descriptor of interface method %u", bytecode->args[1]);
+                ++*parameters_count;
+            }
+
+            ++position;
+            if(parse_export_type(descriptor, &position, return_type) == -1)
+                return fail(v, "Malformed descriptor of interface method %u", bytecode->args[1]);
+
+            return 0;
+        }
+
+        if((ref->internal_interface == NULL) || ((signature = get_interface_method_signature(ref->internal_interface, bytecode->args[1])) == NULL))
+            return fail(v, "Interface method %u not found", bytecode->args[1]);
+    } else
+        signature = ref->type;
+
+    if((signature == NULL) || (signature->types_count == 0))
+        return fail(v, "Missing signature of constant pool entry %u", ref->my_index);
+
+    *parameters_count = signature->types_count - 1;
+    for(; u1Index < *parameters_count; ++u1Index)
+        parameters[u1Index] = get_descriptor_type(signature->types + u1Index);
+    *return_type = get_descriptor_type(signature->types + *parameters_count);
+
+    return 0;
+
+}
+
+
+/**
+ * Verify invokevirtual, invokespecial, invokestatic and invokeinterface.
+ */
+static int verify_invoke(verifier* v, bytecode_info* bytecode) {
+
+    u1 parameters[255];
+    u1 parameters_count = 0;
+    u1 return_type = VERIFY_TOP;
+    u1 object = 0;
+    u2 words = 1;
+    u1 u1Index = 0;
+
+    switch(bytecode->opcode) {
+        case 139:
+            if(check_ref(v, bytecode, CONSTANT_POOL_VIRTUALMETHODREF) == -1)
+                return -1;
+            break;
+
+        case 140:
+            if(check_ref(v, bytecode, CONSTANT_POOL_STATICMETHODREF|CONSTANT_POOL_SUPERMETHODREF) == -1)
+                return -1;
+            break;
+
+        case 141:
+            if(check_ref(v, bytecode, CONSTANT_POOL_STATICMETHODREF) == -1)
+                return -1;
+            break;
+
+        default:
+            if(check_ref(v, bytecode, CONSTANT_POOL_CLASSREF) == -1)
+                return -1;
+            break;
+    }
+
+    if(get_invoked_signature(v, bytecode, parameters, &parameters_count, &return_type) == -1)
+        return -1;
+
+    if(bytecode->opcode == 142) {
+        for(; u1Index < parameters_count; ++u1Index)
+            words += (parameters[u1Index] == VERIFY_INT) ? 2 : 1;
+
+        if(words != bytecode->args[0])
+            return fail(v, "nargs %u does not match the signature", bytecode->args[0]);
+    }
+
+    for(u1Index = parameters_count; u1Index > 0; --u1Index)
+        if(pop(v, parameters[u1Index - 1]) == -1)
+            return -1;
+
+    if((bytecode->opcode != 141) && (pop_reference(v, &object) == -1))
+        return -1;
+
+    if(return_type != VERIFY_TOP)
+        return push(v, return_type);
+
+    return 0;
+
+}
+
+
+/**
+ * Verify the return bytecodes against the return type of the method.
+ */
+static int verify_return(verifier* v, u1 opcode) {
+
+    type_descriptor_info* signature = v->method->signature;
+    u1 return_type = get_descriptor_type(signature->types + signature->types_count - 1);
+
+    switch(opcode) {
+        case 119:
+            if(!is_reference(return_type))
+                return fail(v, "areturn in a method not returning a reference");
+            break;
+
+        case 120:
+            if(return_type != VERIFY_SHORT)
+                return fail(v, "sreturn in a method not returning a short");
+            break;
+
+        case 121:
+            if(return_type != VERIFY_INT)
+                return fail(v, "ireturn in a method not returning an int");
+            break;
+
+        default:
+            if(return_type != VERIFY_TOP)
+                return fail(v, "return in a method returning a value");
+            return 0;
+    }
+
+    return pop(v, return_type);
+
+}
+
+
+/**
+ * Get the type checked by checkcast and instanceof.
+ */
+static int get_checked_type(verifier* v, bytecode_info* bytecode, u1* type) {
+
+    switch(bytecode->args[0]) {
+        case 0:
+            *type = VERIFY_REFERENCE;
+            return check_ref(v, bytecode, CONSTANT_POOL_CLASSREF);
+
+        case 10:
+        case 11:
+            *type = VERIFY_BYTE_ARRAY;
+            return 0;
+
+        case 12:
+            *type = VERIFY_SHORT_ARRAY;
+            return 0;
+
+        case 13:
+            *type = VERIFY_INT_ARRAY;
+            return 0;
+
+        case 14:
+            *type = VERIFY_REFERENCE_ARRAY;
+            return check_ref(v, bytecode, CONSTANT_POOL_CLASSREF);
+    }
+
+    return fail(v, "Invalid array type %u", bytecode->args[0]);
+
+}
+
+
+/**
+ * Verify dup_x and swap_x.
+ */
+static int verify_stack_manipulation(verifier* v, bytecode_info* bytecode) {
+
+    u1* stack = v->types + v->locals_count;
+    u1 words[4];
+    u1 m = bytecode->args[0] >> 4;
+    u1 n = bytecode->args[0] & 0x0F;
+
+    if(bytecode->opcode == 63) {
+        if((m < 1) || (m > 4) || ((n != 0) && ((n < m) || (n > m + 4))))
+            return fail(v, "Invalid dup_x operand 0x%02X", bytecode->args[0]);
+
+        if(n == 0)
+            n = m;
+
+        if((check_words(v, m) == -1) || (check_words(v, n) == -1))
+            return -1;
+
+        if(v->depth + m > v->max_stack)
+            return fail(v, "Operand stack above max_stack (%u)", v->max_stack);
+
+        /* The m top words are copied n words down. */
+        memmove(stack + v->depth - n + m, stack + v->depth - n, n);
+        memcpy(stack + v->depth - n, stack + v->depth, m);
+        v->depth += m;
+
+        return 0;
+    }
+
+    if((m < 1) || (m > 2) || (n < 1) || (n > 2))
+        return fail(v, "Invalid swap_x operand 0x%02X", bytecode->args[0]);
+
+    if((check_words(v, m) == -1) || (check_words(v, m + n) == -1))
+        return -1;
+
+    memcpy(words, stack + v->depth - m, m);
+    memmove(stack + v->depth - n, stack + v->depth - m - n, n);
+    memcpy(stack + v->depth - m - n, words, m);
+
+    return 0;
+
+}
+
+
+/**
+ * Update the types with the effect of a bytecode after checking it.
+ */
+static int verify_bytecode(verifier* v, bytecode_info* bytecode) {
+
+    u1* stack = v->types + v->locals_count;
+    u1 opcode = bytecode->opcode;
+    u1 object = 0;
+    u1 type = 0;
+
+    /* Wide forms behave as their narrow counterpart. */
+    if(((opcode >= 150) && (opcode <= 172)) || ((opcode >= 177) && (opcode <= 180)))
+        opcode = opcodes[opcode].counterpart;
+
+    switch(opcode) {
+        case 0:     /* nop */
+        case 112:   /* goto */
+            return 0;
+
+        case 1:     /* aconst_null */
+            return push(v, VERIFY_NULL);
+
+        case 2: case 3: case 4: case 5: case 6: case 7: case 8:
+        case 16:    /* bspush */
+        case 17:    /* sspush */
+            return push(v, VERIFY_SHORT);
+
+        case 9: case 10: case 11: case 12: case 13: case 14: case 15:
+        case 18:    /* bipush */
+        case 19:    /* sipush */
+        case 20:    /* iipush */
+            return push(v, VERIFY_INT);
+
+        case 21:
+            return load(v, bytecode->args[0], VERIFY_REFERENCE);
+        case 22:
+            return load(v, bytecode->args[0], VERIFY_SHORT);
+        case 23:
+            return load(v, bytecode->args[0], VERIFY_INT);
+
+        case 24: case 25: case 26: case 27:
+            return load(v, opcode - 24, VERIFY_REFERENCE);
+        case 28: case 29: case 30: case 31:
+            return load(v, opcode - 28, VERIFY_SHORT);
+        case 32: case 33: case 34: case 35:
+            return load(v, opcode - 32, VERIFY_INT);
+
+        case 36:    /* aaload */
+            if((pop(v, VERIFY_SHORT) == -1) || (pop(v, VERIFY_REFERENCE_ARRAY) == -1))
+                return -1;
+            return push(v, VERIFY_REFERENCE);
+        case 37:    /* baload */
+            if((pop(v, VERIFY_SHORT) == -1) || (pop(v, VERIFY_BYTE_ARRAY) == -1))
+                return -1;
+            return push(v, VERIFY_SHORT);
+        case 38:    /* saload */
+            if((pop(v, VERIFY_SHORT) == -1) || (pop(v, VERIFY_SHORT_ARRAY) == -1))
+                return -1;
+            return push(v, VERIFY_SHORT);
+        case 39:    /* iaload */
+            if((pop(v, VERIFY_SHORT) == -1) || (pop(v, VERIFY_INT_ARRAY) == -1))
+                return -1;
+            return push(v, VERIFY_INT);
+
+        case 40:
+            return store(v, bytecode->args[0], VERIFY_REFERENCE);
+        case 41:
+            return store(v, bytecode->args[0], VERIFY_SHORT);
+        case 42:
+            return store(v, bytecode->args[0], VERIFY_INT);
+
+        case 43: case 44: case 45: case 46:
+            return store(v, opcode - 43, VERIFY_REFERENCE);
+        case 47: case 48: case 49: case 50:
+            return store(v, opcode - 47, VERIFY_SHORT);
+        case 51: case 52: case 53: case 54:
+            return store(v, opcode - 51, VERIFY_INT);
+
+        case 55:    /* aastore */
+            if((pop_reference(v, &object) == -1) || (pop(v, VERIFY_SHORT) == -1))
+                return -1;
+            return pop(v, VERIFY_REFERENCE_ARRAY);
+        case 56:    /* bastore */
+            if((pop(v, VERIFY_SHORT) == -1) || (pop(v, VERIFY_SHORT) == -1))
+                return -1;
+            return pop(v, VERIFY_BYTE_ARRAY);
+        case 57:    /* sastore */
+            if((pop(v, VERIFY_SHORT) == -1) || (pop(v, VERIFY_SHORT) == -1))
+                return -1;
+            return pop(v, VERIFY_SHORT_ARRAY);
+        case 58:    /* iastore */
+            if((pop(v, VERIFY_INT) == -1) || (pop(v, VERIFY_SHORT) == -1))
+                return -1;
+            return pop(v, VERIFY_INT_ARRAY);
+
+        case 59:    /* pop */
+        case 60:    /* pop2 */
+            if(check_words(v, opcode - 58) == -1)
+                return -1;
+            v->depth -= opcode - 58;
+            return 0;
+
+        case 61:    /* dup */
+        case 62:    /* dup2 */
+            if(check_words(v, opcode - 60) == -1)
+                return -1;
+            if(v->depth + opcode - 60 > v->max_stack)
+                return fail(v, "Operand stack above max_stack (%u)", v->max_stack);
+            memcpy(stack + v->depth, stack + v->depth - (opcode - 60), opcode - 60);
+            v->depth += opcode - 60;
+            return 0;
+
+        case 63:    /* dup_x */
+        case 64:    /* swap_x */
+            return verify_stack_manipulation(v, bytecode);
+
+        case 65: case 67: case 69: case 71: case 73: case 77: case 79: case 81: case 83: case 85: case 87:
+            if((pop(v, VERIFY_SHORT) == -1) || (pop(v, VERIFY_SHORT) == -1))
+                return -1;
+            return push(v, VERIFY_SHORT);
+
+        case 66: case 68: case 70: case 72: case 74: case 78: case 80: case 82: case 84: case 86: case 88:
+            if((pop(v, VERIFY_INT) == -1) || (pop(v, VERIFY_INT) == -1))
+                return -1;
+            return push(v, VERIFY_INT);
+
+        case 75:    /* sneg */
+        case 91:    /* s2b */
+            if(pop(v, VERIFY_SHORT) == -1)
+                return -1;
+            return push(v, VERIFY_SHORT);
+        case 76:    /* ineg */
+            if(pop(v, VERIFY_INT) == -1)
+                return -1;
+            return push(v, VERIFY_INT);
+        case 92:    /* s2i */
+            if(pop(v, VERIFY_SHORT) == -1)
+                return -1;
+            return push(v, VERIFY_INT);
+        case 93:    /* i2b */
+        case 94:    /* i2s */
+            if(pop(v, VERIFY_INT) == -1)
+                return -1;
+            return push(v, VERIFY_SHORT);
+        case 95:    /* icmp */
+            if((pop(v, VERIFY_INT) == -1) || (pop(v, VERIFY_INT) == -1))
+                return -1;
+            return push(v, VERIFY_SHORT);
+
+        case 89:    /* sinc */
+            if(check_local(v, bytecode->args[0], 1) == -1)
+                return -1;
+            if(v->types[bytecode->args[0]] != VERIFY_SHORT)
+                return fail(v, "Local variable %u does not hold a short", bytecode->args[0]);
+            return 0;
+        case 90:    /* iinc */
+            if(check_local(v, bytecode->args[0], 2) == -1)
+                return -1;
+            if((v->types[bytecode->args[0]] != VERIFY_INT) || (v->types[bytecode->args[0] + 1] != VERIFY_INT_LOW))
+                return fail(v, "Local variable %u does not hold an int", bytecode->args[0]);
+            return 0;
+
+        case 96: case 97: case 98: case 99: case 100: case 101:
+        case 115:   /* stableswitch */
+        case 117:   /* slookupswitch */
+            return pop(v, VERIFY_SHORT);
+        case 102:   /* ifnull */
+        case 103:   /* ifnonnull */
+        case 147:   /* athrow */
+            return pop_reference(v, &object);
+        case 104:   /* if_acmpeq */
+        case 105:   /* if_acmpne */
+            if(pop_reference(v, &object) == -1)
+                return -1;
+            return pop_reference(v, &object);
+        case 106: case 107: case 108: case 109: case 110: case 111:
+            if(pop(v, VERIFY_SHORT) == -1)
+                return -1;
+            return pop(v, VERIFY_SHORT);
+        case 116:   /* itableswitch */
+        case 118:   /* ilookupswitch */
+            return pop(v, VERIFY_INT);
+
+        case 113:   /* jsr */
+            memcpy(v->saved, v->types, v->frame_size);
+            v->saved_depth = v->depth;
+            return push(v, VERIFY_RETURN_ADDRESS);
+        case 114:   /* ret */
+            if(check_local(v, bytecode->args[0], 1) == -1)
+                return -1;
+            if(v->types[bytecode->args[0]] != VERIFY_RETURN_ADDRESS)
+                return fail(v, "Local variable %u does not hold a return address", bytecode->args[0]);
+            return 0;
+
+        case 119: case 120: case 121: case 122:
+            return verify_return(v, opcode);
+
+        case 123: case 124: case 125: case 126:
+            if(get_field_type(v, bytecode, CONSTANT_POOL_STATICFIELDREF, opcode - 123, &type) == -1)
+                return -1;
+            return push(v, type);
+        case 127: case 128: case 129: case 130:
+            if(get_field_type(v, bytecode, CONSTANT_POOL_STATICFIELDREF, opcode - 127, &type) == -1)
+                return -1;
+            return pop(v, type);
+        case 131: case 132: case 133: case 134:
+            if(get_field_type(v, bytecode, CONSTANT_POOL_INSTANCEFIELDREF, opcode - 131, &type) == -1)
+                return -1;
+            if(pop(v, VERIFY_REFERENCE) == -1)
+                return -1;
+            return push(v, type);
+        case 135: case 136: case 137: case 138:
+            if((get_field_type(v, bytecode, CONSTANT_POOL_INSTANCEFIELDREF, opcode - 135, &type) == -1) || (pop(v, type) == -1))
+                return -1;
+            return pop(v, VERIFY_REFERENCE);
+        case 173: case 174: case 175: case 176:
+            if((get_field_type(v, bytecode, CONSTANT_POOL_INSTANCEFIELDREF, opcode - 173, &type) == -1) || (check_local(v, 0, 1) == -1))
+                return -1;
+            if(!is_reference(v->types[0]))
+                return fail(v, "Local variable 0 does not hold a reference");
+            return push(v, type);
+        case 181: case 182: case 183: case 184:
+            if((get_field_type(v, bytecode, CONSTANT_POOL_INSTANCEFIELDREF, opcode - 181, &type) == -1) || (check_local(v, 0, 1) == -1))
+                return -1;
+            if(!is_reference(v->types[0]))
+                return fail(v, "Local variable 0 does not hold a reference");
+            return pop(v, type);
+
+        case 139: case 140: case 141: case 142:
+            return verify_invoke(v, bytecode);
+
+        case 143:   /* new */
+            if(check_ref(v, bytecode, CONSTANT_POOL_CLASSREF) == -1)
+                return -1;
+            return push(v, VERIFY_REFERENCE);
+        case 144:   /* newarray */
+            if((bytecode->args[0] < 10) || (bytecode->args[0] > 13))
+                return fail(v, "Invalid array type %u", bytecode->args[0]);
+            if(pop(v, VERIFY_SHORT) == -1)
+                return -1;
+            return push(v, (bytecode->args[0] <= 11) ? VERIFY_BYTE_ARRAY : VERIFY_SHORT_ARRAY + bytecode->args[0] - 12);
+        case 145:   /* anewarray */
+            if((check_ref(v, bytecode, CONSTANT_POOL_CLASSREF) == -1) || (pop(v, VERIFY_SHORT) == -1))
+                return -1;
+            return push(v, VERIFY_REFERENCE_ARRAY);
+        case 146:   /* arraylength */
+            if(pop_reference(v, &object) == -1)
+                return -1;
+            if(object == VERIFY_REFERENCE)
+                return fail(v, "Expected an array on the operand stack, found a reference");
+            return push(v, VERIFY_SHORT);
+        case 148:   /* checkcast */
+        case 149:   /* instanceof */
+            if(get_checked_type(v, bytecode, &type) == -1)
+                return -1;
+            if(pop_reference(v, &object) == -1)
+                return -1;
+            return push(v, (opcode == 148) ? type : VERIFY_SHORT);
+    }
+
+    return fail(v, "Invalid opcode %u", bytecode->opcode);
+
+}
+
+
+/**
+ * Merge a frame into the frame at the start of a block, marking the block to
+ * be verified again if it changed.
+ */
+static int merge_frame(verifier* v, u2 block, const u1* locals, const u1* stack, u2 depth) {
+
+    u1* frame = v->frames + (u4)block * v->frame_size;
+    u2 u2Index = 0;
+
+    if(v->depths[block] == -1) {
+        memcpy(frame, locals, v->locals_count);
+        memcpy(frame + v->locals_count, stack, depth);
+        v->depths[block] = depth;
+        v->pending[block] = 1;
+        return 0;
+    }
+
+    if(v->depths[block] != depth)
+        return fail(v, "Operand stack of %u words at offset %u where another path has %u", depth, v->offsets[v->cfg->blocks[block].start], v->depths[block]);
+
+    for(; u2Index < v->locals_count; ++u2Index) {
+        u1 merged = merge_types(frame[u2Index], locals[u2Index]);
+
+        if(merged != frame[u2Index]) {
+            frame[u2Index] = merged;
+            v->pending[block] = 1;
+        }
+    }
+
+    for(u2Index = 0; u2Index < depth; ++u2Index) {
+        u1 merged = merge_types(frame[v->locals_count + u2Index], stack[u2Index]);
+
+        if(merged == VERIFY_TOP)
+            return fail(v, "Operand stack word %u at offset %u is %s on a path and %s on another", u2Index, v->offsets[v->cfg->blocks[block].start], type_names[frame[v->locals_count + u2Index]], type_names[stack[u2Index]]);
+
+        if(merged != frame[v->locals_count + u2Index]) {
+            frame[v->locals_count + u2Index] = merged;
+            v->pending[block] = 1;
+        }
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Verify the bytecodes of a block from the frame at its start and merge the
+ * resulting frames into its successors.
+ */
+static int verify_block(verifier* v, u2 block) {
+
+    static const u1 thrown[1] = {VERIFY_REFERENCE};
+    cfg_block* crt = v->cfg->blocks + block;
+    bytecode_info* last = v->method->bytecodes[crt->end - 1];
+    u4 u4Index = 0;
+
+    memcpy(v->types, v->frames + (u4)block * v->frame_size, v->frame_size);
+    v->depth = v->depths[block];
+
+    for(v->index = crt->start; v->index < crt->end; ++v->index) {
+        /* A handler may be entered from any bytecode it covers, with the
+           local variables of that bytecode and only the thrown object on the
+           operand stack. */
+        for(u4Index = crt->first_successor + crt->successors_count; u4Index < crt->first_successor + crt->successors_count + crt->exception_successors_count; ++u4Index) {
+            if(v->max_stack < 1)
+                return fail(v, "Operand stack above max_stack (%u)", v->max_stack);
+            if(merge_frame(v, v->cfg->successors[u4Index], v->types, thrown, 1) == -1)
+                return -1;
+        }
+
+        if(verify_bytecode(v, v->method->bytecodes[v->index]) == -1)
+            return -1;
+    }
+
+    v->index = crt->end - 1;
+
+    if(!(opcodes[last->opcode].flags & OPCODE_UNCONDITIONAL) && (crt->end == v->method->bytecodes_count))
+        return fail(v, "Execution falls off the end of the method");
+
+    for(u4Index = crt->first_successor; u4Index < crt->first_successor + crt->successors_count; ++u4Index) {
+        u2 successor = v->cfg->successors[u4Index];
+        int rc = 0;
+
+        /* jsr pushes the return address for the subroutine only. */
+        if((last->opcode == 113) && (successor == block + 1) && (crt->end < v->method->bytecodes_count))
+            rc = merge_frame(v, successor, v->saved, v->saved + v->locals_count, v->saved_depth);
+        else
+            rc = merge_frame(v, successor, v->types, v->types + v->locals_count, v->depth);
+
+        if(rc == -1)
+            return -1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Get the index of a bytecode within the method, CFG_NONE if it is not in it.
+ */
+static u2 find_bytecode(method_info* method, const bytecode_info* bytecode) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < method->bytecodes_count; ++u2Index)
+        if(method->bytecodes[u2Index] == bytecode)
+            return u2Index;
+
+    return CFG_NONE;
+
+}
+
+
+/**
+ * Check that every branch target is within the method. Only used to find the
+ * bytecode to blame once building the graph failed.
+ */
+static int check_branch_targets(verifier* v) {
+
+    for(v->index = 0; v->index < v->method->bytecodes_count; ++v->index) {
+        bytecode_info* bytecode = v->method->bytecodes[v->index];
+        switch_info* data = bytecode->switch_data;
+        u2 u2Index = 0;
+
+        if(bytecode->has_branch && ((bytecode->branch == NULL) || (find_bytecode(v->method, bytecode->branch) == CFG_NONE)))
+            return fail(v, "Branch target outside of the method");
+
+        if(data == NULL)
+            continue;
+
+        switch(bytecode->opcode) {
+            case 115:
+                if(find_bytecode(v->method, data->stableswitch.default_branch) == CFG_NONE)
+                    return fail(v, "Branch target outside of the method");
+                for(; u2Index < data->stableswitch.nb_cases; ++u2Index)
+                    if(find_bytecode(v->method, data->stableswitch.branches[u2Index]) == CFG_NONE)
+                        return fail(v, "Branch target outside of the method");
+                break;
+
+            case 116:
+                if(find_bytecode(v->method, data->itableswitch.default_branch) == CFG_NONE)
+                    return fail(v, "Branch target outside of the method");
+                for(; u2Index < data->itableswitch.nb_cases; ++u2Index)
+                    if(find_bytecode(v->method, data->itableswitch.branches[u2Index]) == CFG_NONE)
+                        return fail(v, "Branch target outside of the method");
+                break;
+
+            case 117:
+                if(find_bytecode(v->method, data->slookupswitch.default_branch) == CFG_NONE)
+                    return fail(v, "Branch target outside of the method");
+                for(; u2Index < data->slookupswitch.nb_cases; ++u2Index)
+                    if(find_bytecode(v->method, data->slookupswitch.cases[u2Index].branch) == CFG_NONE)
+                        return fail(v, "Branch target outside of the method");
+                break;
+
+            case 118:
+                if(find_bytecode(v->method, data->ilookupswitch.default_branch) == CFG_NONE)
+                    return fail(v, "Branch target outside of the method");
+                for(; u2Index < data->ilookupswitch.nb_cases; ++u2Index)
+                    if(find_bytecode(v->method, data->ilookupswitch.cases[u2Index].branch) == CFG_NONE)
+                        return fail(v, "Branch target outside of the method");
+                break;
+        }
+    }
+
+    v->index = CFG_NONE;
+
+    return 0;
+
+}
+
+
+/**
+ * Check the exception handlers of the method.
+ */
+static int check_exception_handlers(verifier* v) {
+
+    u1 u1Index = 0;
+
+    for(; u1Index < v->method->exception_handlers_count; ++u1Index) {
+        exception_handler_info* handler = v->method->exception_handlers[u1Index];
+        u2 start = find_bytecode(v->method, handler->start);
+        u2 end = (handler->end == NULL) ? v->method->bytecodes_count : find_bytecode(v->method, handler->end);
+
+        if((start == CFG_NONE) || (end == CFG_NONE) || (find_bytecode(v->method, handler->handler) == CFG_NONE))
+            return fail(v, "Exception handler %u outside of the method", handler->my_index);
+
+        if(start >= end)
+            return fail(v, "Exception handler %u covers no bytecode", handler->my_index);
+
+        if((handler->catch_type != NULL) && !(handler->catch_type->flags & CONSTANT_POOL_CLASSREF))
+            return fail(v, "Exception handler %u catches constant pool entry %u which is not a class", handler->my_index, handler->catch_type->my_index);
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Set the frame at the start of the method from its signature.
+ */
+static int init_entry_frame(verifier* v) {
+
+    method_info* method = v->method;
+    type_descriptor_info* signature = method->signature;
+    u2 nargs = 0;
+    u1 u1Index = 0;
+
+    if((signature == NULL) || (signature->types_count == 0))
+        return fail(v, "Missing signature");
+
+    nargs = get_signature_words(signature, NULL) + ((method->flags & METHOD_STATIC) ? 0 : 1);
+    if(nargs != method->nargs)
+        return fail(v, "nargs %u does not match the %u words of the signature", method->nargs, nargs);
+
+    memset(v->frames, VERIFY_TOP, v->locals_count);
+
+    nargs = 0;
+    if(!(method->flags & METHOD_STATIC))
+        v->frames[nargs++] = VERIFY_REFERENCE;
+
+    for(; u1Index < signature->types_count - 1; ++u1Index) {
+        u1 type = get_descriptor_type(signature->types + u1Index);
+
+        v->frames[nargs++] = type;
+        if(type == VERIFY_INT)
+            v->frames[nargs++] = VERIFY_INT_LOW;
+    }
+
+    v->depths[0] = 0;
+    v->pending[0] = 1;
+
+    return 0;
+
+}
+
+
+/**
+ * Allocate what the verification of a method needs.
+ */
+static int init_verifier(verifier* v) {
+
+    method_info* method = v->method;
+    u2 u2Index = 0;
+
+    v->locals_count = method->nargs + method->max_locals;
+    v->max_stack = method->max_stack;
+    v->frame_size = v->locals_count + v->max_stack;
+
+    v->frames = (u1*)malloc((u4)v->cfg->blocks_count * v->frame_size + 1);
+    v->depths = (int16_t*)malloc(sizeof(int16_t) * v->cfg->blocks_count);
+    v->pending = (u1*)calloc(v->cfg->blocks_count, sizeof(u1));
+    v->types = (u1*)malloc(v->frame_size + 1);
+    v->saved = (u1*)malloc(v->frame_size + 1);
+    if((v->frames == NULL) || (v->depths == NULL) || (v->pending == NULL) || (v->types == NULL) || (v->saved == NULL)) {
+        perror("init_verifier");
+        return fail(v, "Out of memory");
+    }
+
+    for(; u2Index < v->cfg->blocks_count; ++u2Index)
+        v->depths[u2Index] = -1;
+
+    return 0;
+
+}
+
+
+/**
+ * Compute the offset of each bytecode within the method.
+ */
+static int init_offsets(verifier* v) {
+
+    u2 u2Index = 0;
+
+    v->offsets = (u2*)malloc(sizeof(u2) * (v->method->bytecodes_count + 1));
+    if(v->offsets == NULL) {
+        perror("init_offsets");
+        return fail(v, "Out of memory");
+    }
+
+    v->offsets[0] = 0;
+    for(; u2Index < v->method->bytecodes_count; ++u2Index)
+        v->offsets[u2Index + 1] = v->offsets[u2Index] + v->method->bytecodes[u2Index]->nb_args + 1;
+
+    return 0;
+
+}
+
+
+/**
+ * Free what the verification of a method needed.
+ */
+static void free_verifier(verifier* v) {
+
+    free_method_cfg(v->cfg);
+    free(v->offsets);
+    free(v->frames);
+    free(v->depths);
+    free(v->pending);
+    free(v->types);
+    free(v->saved);
+
+}
+
+
+int verify_method(method_info* method, verify_failure* failure) {
+
+    verifier v;
+    char changed = 1;
+    int rc = 0;
+
+    memset(&v, 0, sizeof(verifier));
+    v.method = method;
+    v.index = CFG_NONE;
+    v.failure = failure;
+
+    failure->offset = VERIFY_NO_OFFSET;
+    failure->opcode = 0;
+    failure->message[0] = '\0';
+
+    if(method->flags & METHOD_ABSTRACT)
+        return 0;
+
+    if(method->bytecodes_count == 0)
+        return fail(&v, "Method without bytecodes");
+
+    if(init_offsets(&v) == -1)
+        return -1;
+
+    if((v.cfg = build_method_cfg(method)) == NULL) {
+        if((check_branch_targets(&v) == 0) && (check_exception_handlers(&v) == 0))
+            fail(&v, "Cannot build the control flow graph");
+        free_verifier(&v);
+        return -1;
+    }
+
+    if((init_verifier(&v) == -1) || (check_exception_handlers(&v) == -1) || (init_entry_frame(&v) == -1)) {
+        free_verifier(&v);
+        return -1;
+    }
+
+    /* Blocks are taken in reverse postorder until no frame changes so a
+       block is mostly verified once all its predecessors were. */
+    while(changed && (rc != -1)) {
+        u2 u2Index = 0;
+
+        changed = 0;
+
+        for(; (rc != -1) && (u2Index < v.cfg->reachable_count); ++u2Index) {
+            u2 block = v.cfg->order[u2Index];
+
+            if(!v.pending[block])
+                continue;
+
+            v.pending[block] = 0;
+            changed = 1;
+            rc = verify_block(&v, block);
+        }
+    }
+
+    free_verifier(&v);
+
+    return rc;
+
+}
+
+
+int verify_cap_file(analyzed_cap_file* acf, verify_failure** failures, u2* failures_count) {
+
+    verify_failure failure;
+    u2 capacity = 0;
+    u2 u2Index1 = 0;
+
+    *failures = NULL;
+    *failures_count = 0;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            if(verify_method(acf->classes[u2Index1]->methods[u2Index2], &failure) == 0)
+                continue;
+
+            if(*failures_count == capacity) {
+                verify_failure* tmp = NULL;
+
+                capacity = (capacity == 0) ? 8 : capacity * 2;
+                tmp = (verify_failure*)realloc(*failures, sizeof(verify_failure) * capacity);
+                if(tmp == NULL) {
+                    perror("verify_cap_file");
+                    free(*failures);
+                    *failures = NULL;
+                    *failures_count = 0;
+                    return -1;
+                }
+                *failures = tmp;
+            }
+
+            failure.class_index = u2Index1;
+            failure.method_index = u2Index2;
+            (*failures)[(*failures_count)++] = failure;
+        }
+    }
+
+    return *failures_count;
+
+}
+
+
+int print_verify_failures(verbose_sink* sink, const verify_failure* failures, u2 failures_count) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < failures_count; ++u2Index) {
+        int rc = 0;
+
+        if(failures[u2Index].offset == VERIFY_NO_OFFSET)
+            rc = sink_printf(sink, "class %u method %u: %s\n", failures[u2Index].class_index, failures[u2Index].method_index, failures[u2Index].message);
+        else
+            rc = sink_printf(sink, "class %u method %u offset %u %s: %s\n", failures[u2Index].class_index, failures[u2Index].method_index, failures[u2Index].offset, opcodes[failures[u2Index].opcode].mnemonic, failures[u2Index].message);
+
+        if(rc == -1)
+            return -1;
+    }
+
+    return 0;
+
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file byte_buffer.c
+ * \brief Big endian reading and writing of the binary files of the library
+ * and mapping of those files in memory.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "byte_buffer.h"
+
+
+void put_bytes(byte_writer* writer, const u1* bytes, u4 length) {
+
+    if(writer->error || (length == 0))
+        return;
+
+    if((writer->capacity - writer->size) < length) {
+        u4 capacity = writer->capacity ? writer->capacity : 4096;
+        u1* tmp = NULL;
+
+        while((capacity - writer->size) < length)
+            capacity *= 2;
+
+        tmp = (u1*)realloc(writer->buffer, capacity);
+        if(tmp == NULL) {
+            perror("put_bytes");
+            writer->error = 1;
+            return;
+        }
+        writer->buffer = tmp;
+        writer->capacity = capacity;
+    }
+
+    memcpy(writer->buffer + writer->size, bytes, length);
+    writer->size += length;
+
+}
+
+
+void put_u1(byte_writer* writer, u1 value) {
+
+    put_bytes(writer, &value, 1);
+
+}
+
+
+void put_u2(byte_writer* writer, u2 value) {
+
+    u1 bytes[2];
+
+    store_u2(bytes, value);
+    put_bytes(writer, bytes, 2);
+
+}
+
+
+void put_u4(byte_writer* writer, u4 value) {
+
+    u1 bytes[4];
+
+    store_u4(bytes, value);
+    put_bytes(writer, bytes, 4);
+
+}
+
+
+const u1* get_bytes(byte_reader* reader, u4 length) {
+
+    const u1* bytes = NULL;
+
+    if(reader->error || ((reader->size - reader->position) < length)) {
+        reader->error = 1;
+        return NULL;
+    }
+
+    bytes = reader->buffer + reader->position;
+    reader->position += length;
+    return bytes;
+
+}
+
+
+u1 get_u1(byte_reader* reader) {
+
+    const u1* bytes = get_bytes(reader, 1);
+
+    return bytes ? bytes[0] : 0;
+
+}
+
+
+u2 get_u2(byte_reader* reader) {
+
+    const u1* bytes = get_bytes(reader, 2);
+
+    return bytes ? (bytes[0] << 8) | bytes[1] : 0;
+
+}
+
+
+u4 get_u4(byte_reader* reader) {
+
+    const u1* bytes = get_bytes(reader, 4);
+
+    return bytes ? load_u4(bytes) : 0;
+
+}
+
+
+uint64_t get_u8(byte_reader* reader) {
+
+    const u1* bytes = get_bytes(reader, 8);
+
+    return bytes ? load_u8(bytes) : 0;
+
+}
+
+
+void store_u2(u1* buffer, u2 value) {
+
+    buffer[0] = value >> 8;
+    buffer[1] = value & 0xFF;
+
+}
+
+
+void store_u4(u1* buffer, u4 value) {
+
+    buffer[0] = value >> 24;
+    buffer[1] = (value >> 16) & 0xFF;
+    buffer[2] = (value >> 8) & 0xFF;
+    buffer[3] = value & 0xFF;
+
+}
+
+
+void store_u8(u1* buffer, uint64_t value) {
+
+    store_u4(buffer, value >> 32);
+    store_u4(buffer + 4, value & 0xFFFFFFFF);
+
+}
+
+
+u4 load_u4(const u1* buffer) {
+
+    return ((u4)buffer[0] << 24) | ((u4)buffer[1] << 16) | ((u4)buffer[2] << 8) | buffer[3];
+
+}
+
+
+uint64_t load_u8(const u1* buffer) {
+
+    return ((uint64_t)load_u4(buffer) << 32) | load_u4(buffer + 4);
+
+}
+
+
+const u1* map_file(const char* path, u4* size, int* missing) {
+
+    struct stat st;
+    void* buffer = NULL;
+    int fd = open(path, O_RDONLY);
+
+    if(missing != NULL)
+        *missing = 0;
+
+    if(fd == -1) {
+        if((missing != NULL) && (errno == ENOENT))
+            *missing = 1;
+        else
+            perror(path);
+        return NULL;
+    }
+
+    if(fstat(fd, &st) == -1) {
+        perror(path);
+        close(fd);
+        return NULL;
+    }
+
+    if((st.st_size == 0) || (st.st_size > 0xFFFFFFFF)) {
+        fprintf(stderr, "%s is empty or too large\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    buffer = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(buffer == MAP_FAILED) {
+        perror(path);
+        return NULL;
+    }
+
+    *size = st.st_size;
+    return (const u1*)buffer;
+
+}
+
+
+void unmap_file(const u1* buffer, u4 size) {
+
+    munmap((void*)buffer, size);
+
+}
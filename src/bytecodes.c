@@ -0,0 +1,384 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file bytecodes.c
+ * \brief Describe each Java Card bytecode (see chapter 7 of Virtual Machine
+ * Specification, Java Card Platform, v2.2.2).
+ */
+
+#include <stdio.h>
+
+#include "bytecodes.h"
+
+/* Columns are: mnemonic, format, nb_args, ref_width, branch_width,
+   counterpart, pops, pushes and flags. */
+const opcode_info opcodes[256] = {
+    /*   0 */ {"nop",              OPCODE_FORMAT_NONE,           0, 0, 0, 0, 0, 0, 0},
+    /*   1 */ {"aconst_null",      OPCODE_FORMAT_NONE,           0, 0, 0, 1, 0, 1, 0},
+    /*   2 */ {"sconst_m1",        OPCODE_FORMAT_NONE,           0, 0, 0, 2, 0, 1, 0},
+    /*   3 */ {"sconst_0",         OPCODE_FORMAT_NONE,           0, 0, 0, 3, 0, 1, 0},
+    /*   4 */ {"sconst_1",         OPCODE_FORMAT_NONE,           0, 0, 0, 4, 0, 1, 0},
+    /*   5 */ {"sconst_2",         OPCODE_FORMAT_NONE,           0, 0, 0, 5, 0, 1, 0},
+    /*   6 */ {"sconst_3",         OPCODE_FORMAT_NONE,           0, 0, 0, 6, 0, 1, 0},
+    /*   7 */ {"sconst_4",         OPCODE_FORMAT_NONE,           0, 0, 0, 7, 0, 1, 0},
+    /*   8 */ {"sconst_5",         OPCODE_FORMAT_NONE,           0, 0, 0, 8, 0, 1, 0},
+    /*   9 */ {"iconst_m1",        OPCODE_FORMAT_NONE,           0, 0, 0, 9, 0, 2, OPCODE_INT},
+    /*  10 */ {"iconst_0",         OPCODE_FORMAT_NONE,           0, 0, 0, 10, 0, 2, OPCODE_INT},
+    /*  11 */ {"iconst_1",         OPCODE_FORMAT_NONE,           0, 0, 0, 11, 0, 2, OPCODE_INT},
+    /*  12 */ {"iconst_2",         OPCODE_FORMAT_NONE,           0, 0, 0, 12, 0, 2, OPCODE_INT},
+    /*  13 */ {"iconst_3",         OPCODE_FORMAT_NONE,           0, 0, 0, 13, 0, 2, OPCODE_INT},
+    /*  14 */ {"iconst_4",         OPCODE_FORMAT_NONE,           0, 0, 0, 14, 0, 2, OPCODE_INT},
+    /*  15 */ {"iconst_5",         OPCODE_FORMAT_NONE,           0, 0, 0, 15, 0, 2, OPCODE_INT},
+    /*  16 */ {"bspush",           OPCODE_FORMAT_BYTES,          1, 0, 0, 16, 0, 1, 0},
+    /*  17 */ {"sspush",           OPCODE_FORMAT_BYTES,          2, 0, 0, 17, 0, 1, 0},
+    /*  18 */ {"bipush",           OPCODE_FORMAT_BYTES,          1, 0, 0, 18, 0, 2, OPCODE_INT},
+    /*  19 */ {"sipush",           OPCODE_FORMAT_BYTES,          2, 0, 0, 19, 0, 2, OPCODE_INT},
+    /*  20 */ {"iipush",           OPCODE_FORMAT_BYTES,          4, 0, 0, 20, 0, 2, OPCODE_INT},
+    /*  21 */ {"aload",            OPCODE_FORMAT_BYTES,          1, 0, 0, 21, 0, 1, 0},
+    /*  22 */ {"sload",            OPCODE_FORMAT_BYTES,          1, 0, 0, 22, 0, 1, 0},
+    /*  23 */ {"iload",            OPCODE_FORMAT_BYTES,          1, 0, 0, 23, 0, 2, OPCODE_INT},
+    /*  24 */ {"aload_0",          OPCODE_FORMAT_NONE,           0, 0, 0, 24, 0, 1, 0},
+    /*  25 */ {"aload_1",          OPCODE_FORMAT_NONE,           0, 0, 0, 25, 0, 1, 0},
+    /*  26 */ {"aload_2",          OPCODE_FORMAT_NONE,           0, 0, 0, 26, 0, 1, 0},
+    /*  27 */ {"aload_3",          OPCODE_FORMAT_NONE,           0, 0, 0, 27, 0, 1, 0},
+    /*  28 */ {"sload_0",          OPCODE_FORMAT_NONE,           0, 0, 0, 28, 0, 1, 0},
+    /*  29 */ {"sload_1",          OPCODE_FORMAT_NONE,           0, 0, 0, 29, 0, 1, 0},
+    /*  30 */ {"sload_2",          OPCODE_FORMAT_NONE,           0, 0, 0, 30, 0, 1, 0},
+    /*  31 */ {"sload_3",          OPCODE_FORMAT_NONE,           0, 0, 0, 31, 0, 1, 0},
+    /*  32 */ {"iload_0",          OPCODE_FORMAT_NONE,           0, 0, 0, 32, 0, 2, OPCODE_INT},
+    /*  33 */ {"iload_1",          OPCODE_FORMAT_NONE,           0, 0, 0, 33, 0, 2, OPCODE_INT},
+    /*  34 */ {"iload_2",          OPCODE_FORMAT_NONE,           0, 0, 0, 34, 0, 2, OPCODE_INT},
+    /*  35 */ {"iload_3",          OPCODE_FORMAT_NONE,           0, 0, 0, 35, 0, 2, OPCODE_INT},
+    /*  36 */ {"aaload",           OPCODE_FORMAT_NONE,           0, 0, 0, 36, 2, 1, 0},
+    /*  37 */ {"baload",           OPCODE_FORMAT_NONE,           0, 0, 0, 37, 2, 1, 0},
+    /*  38 */ {"saload",           OPCODE_FORMAT_NONE,           0, 0, 0, 38, 2, 1, 0},
+    /*  39 */ {"iaload",           OPCODE_FORMAT_NONE,           0, 0, 0, 39, 2, 2, OPCODE_INT},
+    /*  40 */ {"astore",           OPCODE_FORMAT_BYTES,          1, 0, 0, 40, 1, 0, 0},
+    /*  41 */ {"sstore",           OPCODE_FORMAT_BYTES,          1, 0, 0, 41, 1, 0, 0},
+    /*  42 */ {"istore",           OPCODE_FORMAT_BYTES,          1, 0, 0, 42, 2, 0, OPCODE_INT},
+    /*  43 */ {"astore_0",         OPCODE_FORMAT_NONE,           0, 0, 0, 43, 1, 0, 0},
+    /*  44 */ {"astore_1",         OPCODE_FORMAT_NONE,           0, 0, 0, 44, 1, 0, 0},
+    /*  45 */ {"astore_2",         OPCODE_FORMAT_NONE,           0, 0, 0, 45, 1, 0, 0},
+    /*  46 */ {"astore_3",         OPCODE_FORMAT_NONE,           0, 0, 0, 46, 1, 0, 0},
+    /*  47 */ {"sstore_0",         OPCODE_FORMAT_NONE,           0, 0, 0, 47, 1, 0, 0},
+    /*  48 */ {"sstore_1",         OPCODE_FORMAT_NONE,           0, 0, 0, 48, 1, 0, 0},
+    /*  49 */ {"sstore_2",         OPCODE_FORMAT_NONE,           0, 0, 0, 49, 1, 0, 0},
+    /*  50 */ {"sstore_3",         OPCODE_FORMAT_NONE,           0, 0, 0, 50, 1, 0, 0},
+    /*  51 */ {"istore_0",         OPCODE_FORMAT_NONE,           0, 0, 0, 51, 2, 0, OPCODE_INT},
+    /*  52 */ {"istore_1",         OPCODE_FORMAT_NONE,           0, 0, 0, 52, 2, 0, OPCODE_INT},
+    /*  53 */ {"istore_2",         OPCODE_FORMAT_NONE,           0, 0, 0, 53, 2, 0, OPCODE_INT},
+    /*  54 */ {"istore_3",         OPCODE_FORMAT_NONE,           0, 0, 0, 54, 2, 0, OPCODE_INT},
+    /*  55 */ {"aastore",          OPCODE_FORMAT_NONE,           0, 0, 0, 55, 3, 0, 0},
+    /*  56 */ {"bastore",          OPCODE_FORMAT_NONE,           0, 0, 0, 56, 3, 0, 0},
+    /*  57 */ {"sastore",          OPCODE_FORMAT_NONE,           0, 0, 0, 57, 3, 0, 0},
+    /*  58 */ {"iastore",          OPCODE_FORMAT_NONE,           0, 0, 0, 58, 4, 0, OPCODE_INT},
+    /*  59 */ {"pop",              OPCODE_FORMAT_NONE,           0, 0, 0, 59, 1, 0, 0},
+    /*  60 */ {"pop2",             OPCODE_FORMAT_NONE,           0, 0, 0, 60, 2, 0, 0},
+    /*  61 */ {"dup",              OPCODE_FORMAT_NONE,           0, 0, 0, 61, 1, 2, 0},
+    /*  62 */ {"dup2",             OPCODE_FORMAT_NONE,           0, 0, 0, 62, 2, 4, 0},
+    /*  63 */ {"dup_x",            OPCODE_FORMAT_BYTES,          1, 0, 0, 63, OPCODE_VARIABLE_STACK, OPCODE_VARIABLE_STACK, 0},
+    /*  64 */ {"swap_x",           OPCODE_FORMAT_BYTES,          1, 0, 0, 64, OPCODE_VARIABLE_STACK, OPCODE_VARIABLE_STACK, 0},
+    /*  65 */ {"sadd",             OPCODE_FORMAT_NONE,           0, 0, 0, 65, 2, 1, 0},
+    /*  66 */ {"iadd",             OPCODE_FORMAT_NONE,           0, 0, 0, 66, 4, 2, OPCODE_INT},
+    /*  67 */ {"ssub",             OPCODE_FORMAT_NONE,           0, 0, 0, 67, 2, 1, 0},
+    /*  68 */ {"isub",             OPCODE_FORMAT_NONE,           0, 0, 0, 68, 4, 2, OPCODE_INT},
+    /*  69 */ {"smul",             OPCODE_FORMAT_NONE,           0, 0, 0, 69, 2, 1, 0},
+    /*  70 */ {"imul",             OPCODE_FORMAT_NONE,           0, 0, 0, 70, 4, 2, OPCODE_INT},
+    /*  71 */ {"sdiv",             OPCODE_FORMAT_NONE,           0, 0, 0, 71, 2, 1, 0},
+    /*  72 */ {"idiv",             OPCODE_FORMAT_NONE,           0, 0, 0, 72, 4, 2, OPCODE_INT},
+    /*  73 */ {"srem",             OPCODE_FORMAT_NONE,           0, 0, 0, 73, 2, 1, 0},
+    /*  74 */ {"irem",             OPCODE_FORMAT_NONE,           0, 0, 0, 74, 4, 2, OPCODE_INT},
+    /*  75 */ {"sneg",             OPCODE_FORMAT_NONE,           0, 0, 0, 75, 1, 1, 0},
+    /*  76 */ {"ineg",             OPCODE_FORMAT_NONE,           0, 0, 0, 76, 2, 2, OPCODE_INT},
+    /*  77 */ {"sshl",             OPCODE_FORMAT_NONE,           0, 0, 0, 77, 2, 1, 0},
+    /*  78 */ {"ishl",             OPCODE_FORMAT_NONE,           0, 0, 0, 78, 4, 2, OPCODE_INT},
+    /*  79 */ {"sshr",             OPCODE_FORMAT_NONE,           0, 0, 0, 79, 2, 1, 0},
+    /*  80 */ {"ishr",             OPCODE_FORMAT_NONE,           0, 0, 0, 80, 4, 2, OPCODE_INT},
+    /*  81 */ {"sushr",            OPCODE_FORMAT_NONE,           0, 0, 0, 81, 2, 1, 0},
+    /*  82 */ {"iushr",            OPCODE_FORMAT_NONE,           0, 0, 0, 82, 4, 2, OPCODE_INT},
+    /*  83 */ {"sand",             OPCODE_FORMAT_NONE,           0, 0, 0, 83, 2, 1, 0},
+    /*  84 */ {"iand",             OPCODE_FORMAT_NONE,           0, 0, 0, 84, 4, 2, OPCODE_INT},
+    /*  85 */ {"sor",              OPCODE_FORMAT_NONE,           0, 0, 0, 85, 2, 1, 0},
+    /*  86 */ {"ior",              OPCODE_FORMAT_NONE,           0, 0, 0, 86, 4, 2, OPCODE_INT},
+    /*  87 */ {"sxor",             OPCODE_FORMAT_NONE,           0, 0, 0, 87, 2, 1, 0},
+    /*  88 */ {"ixor",             OPCODE_FORMAT_NONE,           0, 0, 0, 88, 4, 2, OPCODE_INT},
+    /*  89 */ {"sinc",             OPCODE_FORMAT_BYTES,          2, 0, 0, 150, 0, 0, 0},
+    /*  90 */ {"iinc",             OPCODE_FORMAT_BYTES,          2, 0, 0, 151, 0, 0, OPCODE_INT},
+    /*  91 */ {"s2b",              OPCODE_FORMAT_NONE,           0, 0, 0, 91, 1, 1, 0},
+    /*  92 */ {"s2i",              OPCODE_FORMAT_NONE,           0, 0, 0, 92, 1, 2, OPCODE_INT},
+    /*  93 */ {"i2b",              OPCODE_FORMAT_NONE,           0, 0, 0, 93, 2, 1, OPCODE_INT},
+    /*  94 */ {"i2s",              OPCODE_FORMAT_NONE,           0, 0, 0, 94, 2, 1, OPCODE_INT},
+    /*  95 */ {"icmp",             OPCODE_FORMAT_NONE,           0, 0, 0, 95, 4, 1, OPCODE_INT},
+    /*  96 */ {"ifeq",             OPCODE_FORMAT_BRANCH,         1, 0, 1, 152, 1, 0, 0},
+    /*  97 */ {"ifne",             OPCODE_FORMAT_BRANCH,         1, 0, 1, 153, 1, 0, 0},
+    /*  98 */ {"iflt",             OPCODE_FORMAT_BRANCH,         1, 0, 1, 154, 1, 0, 0},
+    /*  99 */ {"ifge",             OPCODE_FORMAT_BRANCH,         1, 0, 1, 155, 1, 0, 0},
+    /* 100 */ {"ifgt",             OPCODE_FORMAT_BRANCH,         1, 0, 1, 156, 1, 0, 0},
+    /* 101 */ {"ifle",             OPCODE_FORMAT_BRANCH,         1, 0, 1, 157, 1, 0, 0},
+    /* 102 */ {"ifnull",           OPCODE_FORMAT_BRANCH,         1, 0, 1, 158, 1, 0, 0},
+    /* 103 */ {"ifnonnull",        OPCODE_FORMAT_BRANCH,         1, 0, 1, 159, 1, 0, 0},
+    /* 104 */ {"if_acmpeq",        OPCODE_FORMAT_BRANCH,         1, 0, 1, 160, 2, 0, 0},
+    /* 105 */ {"if_acmpne",        OPCODE_FORMAT_BRANCH,         1, 0, 1, 161, 2, 0, 0},
+    /* 106 */ {"if_scmpeq",        OPCODE_FORMAT_BRANCH,         1, 0, 1, 162, 2, 0, 0},
+    /* 107 */ {"if_scmpne",        OPCODE_FORMAT_BRANCH,         1, 0, 1, 163, 2, 0, 0},
+    /* 108 */ {"if_scmplt",        OPCODE_FORMAT_BRANCH,         1, 0, 1, 164, 2, 0, 0},
+    /* 109 */ {"if_scmpge",        OPCODE_FORMAT_BRANCH,         1, 0, 1, 165, 2, 0, 0},
+    /* 110 */ {"if_scmpgt",        OPCODE_FORMAT_BRANCH,         1, 0, 1, 166, 2, 0, 0},
+    /* 111 */ {"if_scmple",        OPCODE_FORMAT_BRANCH,         1, 0, 1, 167, 2, 0, 0},
+    /* 112 */ {"goto",             OPCODE_FORMAT_BRANCH,         1, 0, 1, 168, 0, 0, OPCODE_UNCONDITIONAL},
+    /* 113 */ {"jsr",              OPCODE_FORMAT_BRANCH,         2, 0, 2, 113, 0, 1, 0},
+    /* 114 */ {"ret",              OPCODE_FORMAT_BYTES,          1, 0, 0, 114, 0, 0, OPCODE_UNCONDITIONAL},
+    /* 115 */ {"stableswitch",     OPCODE_FORMAT_STABLESWITCH,   6, 0, 2, 115, 1, 0, OPCODE_UNCONDITIONAL},
+    /* 116 */ {"itableswitch",     OPCODE_FORMAT_ITABLESWITCH,   10, 0, 2, 116, 2, 0, OPCODE_UNCONDITIONAL|OPCODE_INT},
+    /* 117 */ {"slookupswitch",    OPCODE_FORMAT_SLOOKUPSWITCH,  4, 0, 2, 117, 1, 0, OPCODE_UNCONDITIONAL},
+    /* 118 */ {"ilookupswitch",    OPCODE_FORMAT_ILOOKUPSWITCH,  4, 0, 2, 118, 2, 0, OPCODE_UNCONDITIONAL|OPCODE_INT},
+    /* 119 */ {"areturn",          OPCODE_FORMAT_NONE,           0, 0, 0, 119, 1, 0, OPCODE_UNCONDITIONAL},
+    /* 120 */ {"sreturn",          OPCODE_FORMAT_NONE,           0, 0, 0, 120, 1, 0, OPCODE_UNCONDITIONAL},
+    /* 121 */ {"ireturn",          OPCODE_FORMAT_NONE,           0, 0, 0, 121, 2, 0, OPCODE_UNCONDITIONAL|OPCODE_INT},
+    /* 122 */ {"return",           OPCODE_FORMAT_NONE,           0, 0, 0, 122, 0, 0, OPCODE_UNCONDITIONAL},
+    /* 123 */ {"getstatic_a",      OPCODE_FORMAT_REF,            2, 2, 0, 123, 0, 1, 0},
+    /* 124 */ {"getstatic_b",      OPCODE_FORMAT_REF,            2, 2, 0, 124, 0, 1, 0},
+    /* 125 */ {"getstatic_s",      OPCODE_FORMAT_REF,            2, 2, 0, 125, 0, 1, 0},
+    /* 126 */ {"getstatic_i",      OPCODE_FORMAT_REF,            2, 2, 0, 126, 0, 2, OPCODE_INT},
+    /* 127 */ {"putstatic_a",      OPCODE_FORMAT_REF,            2, 2, 0, 127, 1, 0, 0},
+    /* 128 */ {"putstatic_b",      OPCODE_FORMAT_REF,            2, 2, 0, 128, 1, 0, 0},
+    /* 129 */ {"putstatic_s",      OPCODE_FORMAT_REF,            2, 2, 0, 129, 1, 0, 0},
+    /* 130 */ {"putstatic_i",      OPCODE_FORMAT_REF,            2, 2, 0, 130, 2, 0, OPCODE_INT},
+    /* 131 */ {"getfield_a",       OPCODE_FORMAT_REF,            1, 1, 0, 169, 1, 1, 0},
+    /* 132 */ {"getfield_b",       OPCODE_FORMAT_REF,            1, 1, 0, 170, 1, 1, 0},
+    /* 133 */ {"getfield_s",       OPCODE_FORMAT_REF,            1, 1, 0, 171, 1, 1, 0},
+    /* 134 */ {"getfield_i",       OPCODE_FORMAT_REF,            1, 1, 0, 172, 1, 2, OPCODE_INT},
+    /* 135 */ {"putfield_a",       OPCODE_FORMAT_REF,            1, 1, 0, 177, 2, 0, 0},
+    /* 136 */ {"putfield_b",       OPCODE_FORMAT_REF,            1, 1, 0, 178, 2, 0, 0},
+    /* 137 */ {"putfield_s",       OPCODE_FORMAT_REF,            1, 1, 0, 179, 2, 0, 0},
+    /* 138 */ {"putfield_i",       OPCODE_FORMAT_REF,            1, 1, 0, 180, 3, 0, OPCODE_INT},
+    /* 139 */ {"invokevirtual",    OPCODE_FORMAT_REF,            2, 2, 0, 139, OPCODE_VARIABLE_STACK, OPCODE_VARIABLE_STACK, 0},
+    /* 140 */ {"invokespecial",    OPCODE_FORMAT_REF,            2, 2, 0, 140, OPCODE_VARIABLE_STACK, OPCODE_VARIABLE_STACK, 0},
+    /* 141 */ {"invokestatic",     OPCODE_FORMAT_REF,            2, 2, 0, 141, OPCODE_VARIABLE_STACK, OPCODE_VARIABLE_STACK, 0},
+    /* 142 */ {"invokeinterface",  OPCODE_FORMAT_INVOKEINTERFACE, 4, 2, 0, 142, OPCODE_VARIABLE_STACK, OPCODE_VARIABLE_STACK, 0},
+    /* 143 */ {"new",              OPCODE_FORMAT_REF,            2, 2, 0, 143, 0, 1, 0},
+    /* 144 */ {"newarray",         OPCODE_FORMAT_BYTES,          1, 0, 0, 144, 1, 1, 0},
+    /* 145 */ {"anewarray",        OPCODE_FORMAT_REF,            2, 2, 0, 145, 1, 1, 0},
+    /* 146 */ {"arraylength",      OPCODE_FORMAT_NONE,           0, 0, 0, 146, 1, 1, 0},
+    /* 147 */ {"athrow",           OPCODE_FORMAT_NONE,           0, 0, 0, 147, 1, 0, OPCODE_UNCONDITIONAL},
+    /* 148 */ {"checkcast",        OPCODE_FORMAT_TYPE_REF,       3, 2, 0, 148, 1, 1, 0},
+    /* 149 */ {"instanceof",       OPCODE_FORMAT_TYPE_REF,       3, 2, 0, 149, 1, 1, 0},
+    /* 150 */ {"sinc_w",           OPCODE_FORMAT_BYTES,          3, 0, 0, 89, 0, 0, 0},
+    /* 151 */ {"iinc_w",           OPCODE_FORMAT_BYTES,          3, 0, 0, 90, 0, 0, OPCODE_INT},
+    /* 152 */ {"ifeq_w",           OPCODE_FORMAT_BRANCH,         2, 0, 2, 96, 1, 0, 0},
+    /* 153 */ {"ifne_w",           OPCODE_FORMAT_BRANCH,         2, 0, 2, 97, 1, 0, 0},
+    /* 154 */ {"iflt_w",           OPCODE_FORMAT_BRANCH,         2, 0, 2, 98, 1, 0, 0},
+    /* 155 */ {"ifge_w",           OPCODE_FORMAT_BRANCH,         2, 0, 2, 99, 1, 0, 0},
+    /* 156 */ {"ifgt_w",           OPCODE_FORMAT_BRANCH,         2, 0, 2, 100, 1, 0, 0},
+    /* 157 */ {"ifle_w",           OPCODE_FORMAT_BRANCH,         2, 0, 2, 101, 1, 0, 0},
+    /* 158 */ {"ifnull_w",         OPCODE_FORMAT_BRANCH,         2, 0, 2, 102, 1, 0, 0},
+    /* 159 */ {"ifnonnull_w",      OPCODE_FORMAT_BRANCH,         2, 0, 2, 103, 1, 0, 0},
+    /* 160 */ {"if_acmpeq_w",      OPCODE_FORMAT_BRANCH,         2, 0, 2, 104, 2, 0, 0},
+    /* 161 */ {"if_acmpne_w",      OPCODE_FORMAT_BRANCH,         2, 0, 2, 105, 2, 0, 0},
+    /* 162 */ {"if_scmpeq_w",      OPCODE_FORMAT_BRANCH,         2, 0, 2, 106, 2, 0, 0},
+    /* 163 */ {"if_scmpne_w",      OPCODE_FORMAT_BRANCH,         2, 0, 2, 107, 2, 0, 0},
+    /* 164 */ {"if_scmplt_w",      OPCODE_FORMAT_BRANCH,         2, 0, 2, 108, 2, 0, 0},
+    /* 165 */ {"if_scmpge_w",      OPCODE_FORMAT_BRANCH,         2, 0, 2, 109, 2, 0, 0},
+    /* 166 */ {"if_scmpgt_w",      OPCODE_FORMAT_BRANCH,         2, 0, 2, 110, 2, 0, 0},
+    /* 167 */ {"if_scmple_w",      OPCODE_FORMAT_BRANCH,         2, 0, 2, 111, 2, 0, 0},
+    /* 168 */ {"goto_w",           OPCODE_FORMAT_BRANCH,         2, 0, 2, 112, 0, 0, OPCODE_UNCONDITIONAL},
+    /* 169 */ {"getfield_a_w",     OPCODE_FORMAT_REF,            2, 2, 0, 131, 1, 1, 0},
+    /* 170 */ {"getfield_b_w",     OPCODE_FORMAT_REF,            2, 2, 0, 132, 1, 1, 0},
+    /* 171 */ {"getfield_s_w",     OPCODE_FORMAT_REF,            2, 2, 0, 133, 1, 1, 0},
+    /* 172 */ {"getfield_i_w",     OPCODE_FORMAT_REF,            2, 2, 0, 134, 1, 2, OPCODE_INT},
+    /* 173 */ {"getfield_a_this",  OPCODE_FORMAT_REF,            1, 1, 0, 169, 0, 1, OPCODE_THIS},
+    /* 174 */ {"getfield_b_this",  OPCODE_FORMAT_REF,            1, 1, 0, 170, 0, 1, OPCODE_THIS},
+    /* 175 */ {"getfield_s_this",  OPCODE_FORMAT_REF,            1, 1, 0, 171, 0, 1, OPCODE_THIS},
+    /* 176 */ {"getfield_i_this",  OPCODE_FORMAT_REF,            1, 1, 0, 172, 0, 2, OPCODE_THIS|OPCODE_INT},
+    /* 177 */ {"putfield_a_w",     OPCODE_FORMAT_REF,            2, 2, 0, 135, 2, 0, 0},
+    /* 178 */ {"putfield_b_w",     OPCODE_FORMAT_REF,            2, 2, 0, 136, 2, 0, 0},
+    /* 179 */ {"putfield_s_w",     OPCODE_FORMAT_REF,            2, 2, 0, 137, 2, 0, 0},
+    /* 180 */ {"putfield_i_w",     OPCODE_FORMAT_REF,            2, 2, 0, 138, 3, 0, OPCODE_INT},
+    /* 181 */ {"putfield_a_this",  OPCODE_FORMAT_REF,            1, 1, 0, 177, 1, 0, OPCODE_THIS},
+    /* 182 */ {"putfield_b_this",  OPCODE_FORMAT_REF,            1, 1, 0, 178, 1, 0, OPCODE_THIS},
+    /* 183 */ {"putfield_s_this",  OPCODE_FORMAT_REF,            1, 1, 0, 179, 1, 0, OPCODE_THIS},
+    /* 184 */ {"putfield_i_this",  OPCODE_FORMAT_REF,            1, 1, 0, 180, 2, 0, OPCODE_THIS|OPCODE_INT},
+    /* 185 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 185, 0, 0, 0},
+    /* 186 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 186, 0, 0, 0},
+    /* 187 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 187, 0, 0, 0},
+    /* 188 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 188, 0, 0, 0},
+    /* 189 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 189, 0, 0, 0},
+    /* 190 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 190, 0, 0, 0},
+    /* 191 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 191, 0, 0, 0},
+    /* 192 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 192, 0, 0, 0},
+    /* 193 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 193, 0, 0, 0},
+    /* 194 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 194, 0, 0, 0},
+    /* 195 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 195, 0, 0, 0},
+    /* 196 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 196, 0, 0, 0},
+    /* 197 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 197, 0, 0, 0},
+    /* 198 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 198, 0, 0, 0},
+    /* 199 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 199, 0, 0, 0},
+    /* 200 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 200, 0, 0, 0},
+    /* 201 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 201, 0, 0, 0},
+    /* 202 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 202, 0, 0, 0},
+    /* 203 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 203, 0, 0, 0},
+    /* 204 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 204, 0, 0, 0},
+    /* 205 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 205, 0, 0, 0},
+    /* 206 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 206, 0, 0, 0},
+    /* 207 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 207, 0, 0, 0},
+    /* 208 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 208, 0, 0, 0},
+    /* 209 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 209, 0, 0, 0},
+    /* 210 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 210, 0, 0, 0},
+    /* 211 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 211, 0, 0, 0},
+    /* 212 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 212, 0, 0, 0},
+    /* 213 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 213, 0, 0, 0},
+    /* 214 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 214, 0, 0, 0},
+    /* 215 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 215, 0, 0, 0},
+    /* 216 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 216, 0, 0, 0},
+    /* 217 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 217, 0, 0, 0},
+    /* 218 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 218, 0, 0, 0},
+    /* 219 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 219, 0, 0, 0},
+    /* 220 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 220, 0, 0, 0},
+    /* 221 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 221, 0, 0, 0},
+    /* 222 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 222, 0, 0, 0},
+    /* 223 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 223, 0, 0, 0},
+    /* 224 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 224, 0, 0, 0},
+    /* 225 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 225, 0, 0, 0},
+    /* 226 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 226, 0, 0, 0},
+    /* 227 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 227, 0, 0, 0},
+    /* 228 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 228, 0, 0, 0},
+    /* 229 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 229, 0, 0, 0},
+    /* 230 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 230, 0, 0, 0},
+    /* 231 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 231, 0, 0, 0},
+    /* 232 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 232, 0, 0, 0},
+    /* 233 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 233, 0, 0, 0},
+    /* 234 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 234, 0, 0, 0},
+    /* 235 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 235, 0, 0, 0},
+    /* 236 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 236, 0, 0, 0},
+    /* 237 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 237, 0, 0, 0},
+    /* 238 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 238, 0, 0, 0},
+    /* 239 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 239, 0, 0, 0},
+    /* 240 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 240, 0, 0, 0},
+    /* 241 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 241, 0, 0, 0},
+    /* 242 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 242, 0, 0, 0},
+    /* 243 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 243, 0, 0, 0},
+    /* 244 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 244, 0, 0, 0},
+    /* 245 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 245, 0, 0, 0},
+    /* 246 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 246, 0, 0, 0},
+    /* 247 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 247, 0, 0, 0},
+    /* 248 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 248, 0, 0, 0},
+    /* 249 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 249, 0, 0, 0},
+    /* 250 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 250, 0, 0, 0},
+    /* 251 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 251, 0, 0, 0},
+    /* 252 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 252, 0, 0, 0},
+    /* 253 */ {"invalid_opcode",   OPCODE_FORMAT_INVALID,        0, 0, 0, 253, 0, 0, 0},
+    /* 254 */ {"impdep1",          OPCODE_FORMAT_INVALID,        0, 0, 0, 254, 0, 0, 0},
+    /* 255 */ {"impdep2",          OPCODE_FORMAT_INVALID,        0, 0, 0, 255, 0, 0, 0}
+};
+
+
+u1 get_local_access(const bytecode_info* bytecode, u1* kind, u1* local) {
+
+    u1 opcode = bytecode->opcode;
+
+    if((opcode >= 21) && (opcode <= 23)) {          /* aload, sload, iload */
+        *kind = opcode - 21;
+        *local = bytecode->args[0];
+        return LOCAL_ACCESS_LOAD;
+    } else if((opcode >= 24) && (opcode <= 35)) {   /* aload_0 to iload_3 */
+        *kind = (opcode - 24) / 4;
+        *local = (opcode - 24) % 4;
+        return LOCAL_ACCESS_LOAD;
+    } else if((opcode >= 40) && (opcode <= 42)) {   /* astore, sstore, istore */
+        *kind = opcode - 40;
+        *local = bytecode->args[0];
+        return LOCAL_ACCESS_STORE;
+    } else if((opcode >= 43) && (opcode <= 54)) {   /* astore_0 to istore_3 */
+        *kind = (opcode - 43) / 4;
+        *local = (opcode - 43) % 4;
+        return LOCAL_ACCESS_STORE;
+    } else if((opcode == 89) || (opcode == 150)) {  /* sinc, sinc_w */
+        *kind = LOCAL_SHORT;
+        *local = bytecode->args[0];
+        return LOCAL_ACCESS_INC;
+    } else if((opcode == 90) || (opcode == 151)) {  /* iinc, iinc_w */
+        *kind = LOCAL_INT;
+        *local = bytecode->args[0];
+        return LOCAL_ACCESS_INC;
+    }
+
+    return LOCAL_ACCESS_NONE;
+
+}
+
+
+void set_local_access(bytecode_info* bytecode, u1 local) {
+
+    u1 kind = 0;
+    u1 old_local = 0;
+    u1 access = get_local_access(bytecode, &kind, &old_local);
+    u1 opcode = 0;
+
+    if(access == LOCAL_ACCESS_INC) {
+        bytecode->args[0] = local;
+        return;
+    }
+
+    if(local <= 3)
+        opcode = ((access == LOCAL_ACCESS_LOAD) ? 24 : 43) + (kind * 4) + local;
+    else
+        opcode = ((access == LOCAL_ACCESS_LOAD) ? 21 : 40) + kind;
+
+    bytecode->opcode = opcode;
+    bytecode->nb_args = opcodes[opcode].nb_args;
+    bytecode->nb_byte_args = opcodes[opcode].nb_args;
+    bytecode->args[0] = local;
+
+}
+
+
+int find_bytecode_index(const method_info* method, const bytecode_info* bytecode) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < method->bytecodes_count; ++u2Index)
+        if(method->bytecodes[u2Index] == bytecode)
+            return u2Index;
+
+    fprintf(stderr, "Branch target outside of its method\n");
+    return -1;
+
+}
@@ -55,6 +55,8 @@
 #include "cap_file.h"
 #include "analyzed_cap_file.h"
 #include "exp_file_reader.h"
+#include "bytecodes.h"
+#include "analyzed_cap_file_edit.h"
 
  
 /**
@@ -227,7 +229,7 @@ static constant_pool_entry_info* add_new_external_class_ref_to_constant_pool(ana
     }
     acf->constant_pool = tmp;
 
-    acf->constant_pool[acf->constant_pool_count] = (constant_pool_entry_info*)malloc(sizeof(constant_pool_entry_info));
+    acf->constant_pool[acf->constant_pool_count] = (constant_pool_entry_info*)calloc(1, sizeof(constant_pool_entry_info));
     if(acf->constant_pool[acf->constant_pool_count] == NULL) {
         perror("add_new_external_class_ref_to_constant_pool");
         return NULL;
@@ -272,7 +274,7 @@ static constant_pool_entry_info* add_new_internal_class_ref_to_constant_pool(ana
     }
     acf->constant_pool = tmp;
 
-    acf->constant_pool[acf->constant_pool_count] = (constant_pool_entry_info*)malloc(sizeof(constant_pool_entry_info));
+    acf->constant_pool[acf->constant_pool_count] = (constant_pool_entry_info*)calloc(1, sizeof(constant_pool_entry_info));
     if(acf->constant_pool[acf->constant_pool_count] == NULL) {
         perror("add_new_internal_class_ref_to_constant_pool");
         return NULL;
@@ -391,7 +393,7 @@ static int analyze_imported_packages(analyzed_cap_file* acf, cap_file* cf) {
     }
 
     for(u1Index = 0; u1Index < cf->import.count; ++u1Index) {
-        acf->imported_packages[u1Index] = (imported_package_info*)malloc(sizeof(imported_package_info));
+        acf->imported_packages[u1Index] = (imported_package_info*)calloc(1, sizeof(imported_package_info));
         if(acf->imported_packages[u1Index] == NULL) {
             perror("analyze_imported_packages");
             return -1;
@@ -440,7 +442,7 @@ static int analyze_signature_pool(analyzed_cap_file* acf, cap_file* cf) {
     }
 
     for(; u2Index < cf->descriptor.types.type_desc_count; ++u2Index) {
-        acf->signature_pool[u2Index] = (type_descriptor_info*)malloc(sizeof(type_descriptor_info));
+        acf->signature_pool[u2Index] = (type_descriptor_info*)calloc(1, sizeof(type_descriptor_info));
         if(acf->signature_pool[u2Index] == NULL) {
             perror("analyze_signature_pool");
             return -1;
@@ -485,7 +487,7 @@ static int analyze_constant_pool(analyzed_cap_file* acf, cap_file* cf) {
 
     for(u2Index1 = 0; u2Index1 < cf->constant_pool.count; ++u2Index1) {
         u2 u2Index2 = 0;
-        acf->constant_pool[u2Index1] = (constant_pool_entry_info*)malloc(sizeof(constant_pool_entry_info));
+        acf->constant_pool[u2Index1] = (constant_pool_entry_info*)calloc(1, sizeof(constant_pool_entry_info));
         if(acf->constant_pool[u2Index1] == NULL) {
             perror("analyze_constant_pool");
             return -1;
@@ -724,7 +726,7 @@ static int analyze_interface_methods(analyzed_cap_file* acf, interface_info* int
 
     for(; u2Index1 < descriptor->method_count; ++u2Index1) {
         u2 u2Index2 = 0;
-        interface->methods[u2Index1] = (method_info*)malloc(sizeof(method_info));
+        interface->methods[u2Index1] = (method_info*)calloc(1, sizeof(method_info));
         if(interface->methods[u2Index1] == NULL) {
             perror("analyze_interface_methods");
             return -1;
@@ -746,7 +748,9 @@ static int analyze_interface_methods(analyzed_cap_file* acf, interface_info* int
         interface->methods[u2Index1]->signature = acf->signature_pool[u2Index2];
 
         interface->methods[u2Index1]->bytecodes_count = 0;
+        interface->methods[u2Index1]->bytecodes_size = 0;
         interface->methods[u2Index1]->bytecodes = NULL;
+        interface->methods[u2Index1]->needs_layout = 0;
     }
 
     return 0;
@@ -783,7 +787,7 @@ static int analyze_interfaces(analyzed_cap_file* acf, cap_file* cf) {
         u1 descriptorIndex = 0;
         u2 u2Index2 = 0;
 
-        acf->interfaces[u2Index1] = (interface_info*)malloc(sizeof(interface_info));
+        acf->interfaces[u2Index1] = (interface_info*)calloc(1, sizeof(interface_info));
         if(acf->interfaces[u2Index1] == NULL) {
             perror("analyze_cap_file");
             return -1;
@@ -859,7 +863,7 @@ static constant_pool_entry_info* add_new_internal_static_field_to_constant_pool(
     }
     acf->constant_pool = tmp;
 
-    acf->constant_pool[acf->constant_pool_count] = (constant_pool_entry_info*)malloc(sizeof(constant_pool_entry_info));
+    acf->constant_pool[acf->constant_pool_count] = (constant_pool_entry_info*)calloc(1, sizeof(constant_pool_entry_info));
     if(acf->constant_pool[acf->constant_pool_count] == NULL) {
         perror("add_new_internal_static_field_to_constant_pool");
         return NULL;
@@ -900,7 +904,7 @@ static constant_pool_entry_info* add_new_internal_instance_field_to_constant_poo
     }
     acf->constant_pool = tmp;
 
-    acf->constant_pool[acf->constant_pool_count] = (constant_pool_entry_info*)malloc(sizeof(constant_pool_entry_info));
+    acf->constant_pool[acf->constant_pool_count] = (constant_pool_entry_info*)calloc(1, sizeof(constant_pool_entry_info));
     if(acf->constant_pool[acf->constant_pool_count] == NULL) {
         perror("add_new_internal_instance_field_to_constant_pool");
         return NULL;
@@ -958,12 +962,14 @@ static u1* get_static_field_values(cap_file* cf, u2 offset, u1* has_value, u2* v
         *value_size = 0;
         return NULL;
     } else {
-        u2 u2Index2 = 0;
-
         *has_value = 1;
         values = (u1*)malloc(*value_size);
-        for(u2Index1 = (crt_offset - offset); u2Index1 < *value_size; ++u2Index1)
-            values[u2Index2++] = cf->static_field.non_default_values[u2Index1];
+        if(values == NULL) {
+            perror("get_static_field_values");
+            return NULL;
+        }
+        for(u2Index1 = 0; u2Index1 < *value_size; ++u2Index1)
+            values[u2Index1] = cf->static_field.non_default_values[(offset - crt_offset) + u2Index1];
     }
 
     return values;
@@ -1007,7 +1013,7 @@ static type_descriptor_info* find_type_descriptor(analyzed_cap_file* acf, u1 is_
     }
     acf->signature_pool = tmp;
 
-    acf->signature_pool[acf->signature_pool_count] = (type_descriptor_info*)malloc(sizeof(type_descriptor_info));
+    acf->signature_pool[acf->signature_pool_count] = (type_descriptor_info*)calloc(1, sizeof(type_descriptor_info));
     if(acf->signature_pool[acf->signature_pool_count] == NULL) {
         perror("find_type_descriptor");
         return NULL;
@@ -1062,7 +1068,7 @@ static int analyze_class_fields(analyzed_cap_file* acf, class_info* class, cap_f
     for(; u2Index1 < descriptor->field_count; ++u2Index1) {
         u2 u2Index2 = 0;
 
-        class->fields[u2Index1] = (field_info*)malloc(sizeof(field_info));
+        class->fields[u2Index1] = (field_info*)calloc(1, sizeof(field_info));
         if(class->fields[u2Index1] == NULL) {
             perror("analyze_class_fields");
             return -1;
@@ -1081,8 +1087,12 @@ static int analyze_class_fields(analyzed_cap_file* acf, class_info* class, cap_f
         else
             class->fields[u2Index1]->flags = FIELD_PACKAGE;
 
-        if(descriptor->fields[u2Index1].access_flags & DESCRIPTOR_ACC_STATIC)
+        /* The offset of a static field is kept for the components copied
+           from the source CAP file. */
+        if(descriptor->fields[u2Index1].access_flags & DESCRIPTOR_ACC_STATIC) {
             class->fields[u2Index1]->flags |= FIELD_STATIC;
+            class->fields[u2Index1]->offset = descriptor->fields[u2Index1].field_ref.static_field.ref.internal_ref.offset;
+        }
 
         if(descriptor->fields[u2Index1].access_flags & DESCRIPTOR_ACC_FINAL)
             class->fields[u2Index1]->flags |= FIELD_FINAL;
@@ -1213,352 +1223,108 @@ static bytecode_info** analyze_bytecodes(analyzed_cap_file* acf, cf_method_info*
     bytecode_info** bytecodes = NULL;
 
     while(u2Index1 < method->bytecode_count) {
-        bytecode_info** tmp = realloc(bytecodes, sizeof(bytecode_info*) * (*bytecodes_count + 1));
+        const opcode_info* opcode = &opcodes[method->bytecodes[u2Index1]];
+        bytecode_info* crt_bytecode = NULL;
+        bytecode_info** tmp = NULL;
+
+        if(opcode->format == OPCODE_FORMAT_INVALID) {
+            fprintf(stderr, "Invalid opcode %u at offset %u\n", method->bytecodes[u2Index1], u2Index1);
+            return NULL;
+        }
+
+        tmp = realloc(bytecodes, sizeof(bytecode_info*) * (*bytecodes_count + 1));
         if(tmp == NULL) {
             perror("analyze_bytecodes");
             return NULL;
         }
         bytecodes = tmp;
-        bytecodes[*bytecodes_count] = (bytecode_info*)malloc(sizeof(bytecode_info));
+        bytecodes[*bytecodes_count] = (bytecode_info*)calloc(1, sizeof(bytecode_info));
         if(bytecodes[*bytecodes_count] == NULL) {
             perror("analyze_bytecodes");
             return NULL;
         }
-
-        bytecodes[*bytecodes_count]->opcode = method->bytecodes[u2Index1];
-        bytecodes[*bytecodes_count]->offset = u2Index1;
-        bytecodes[*bytecodes_count]->info_offset = *crt_info_offset;
-        bytecodes[*bytecodes_count]->nb_args = 0;
-        bytecodes[*bytecodes_count]->nb_byte_args = 0;
-        bytecodes[*bytecodes_count]->has_ref = 0;
-        bytecodes[*bytecodes_count]->has_branch = 0;
-
-        switch(method->bytecodes[u2Index1]) {
-/* No operand */
-            case 0:     /* nop */
-            case 1:     /* aconst_null */
-            case 2:     /* sconst_m1 */
-            case 3:     /* sconst_0 */
-            case 4:     /* sconst_1 */
-            case 5:     /* sconst_2 */
-            case 6:     /* sconst_3 */
-            case 7:     /* sconst_4 */
-            case 8:     /* sconst_5 */
-            case 9:     /* iconst_m1 */
-            case 10:    /* iconst_0 */
-            case 11:    /* iconst_1 */
-            case 12:    /* iconst_2 */
-            case 13:    /* iconst_3 */
-            case 14:    /* iconst_4 */
-            case 15:    /* iconst_5 */
-            case 24:    /* aload_0 */
-            case 25:    /* aload_1 */
-            case 26:    /* aload_2 */
-            case 27:    /* aload_3 */
-            case 28:    /* sload_0 */
-            case 29:    /* sload_1 */
-            case 30:    /* sload_2 */
-            case 31:    /* sload_3 */
-            case 32:    /* iload_0 */
-            case 33:    /* iload_1 */
-            case 34:    /* iload_2 */
-            case 35:    /* iload_3 */
-            case 36:    /* aaload */
-            case 37:    /* baload */
-            case 38:    /* saload */
-            case 39:    /* iaload */
-            case 43:    /* astore_0 */
-            case 44:    /* astore_1 */
-            case 45:    /* astore_2 */
-            case 46:    /* astore_3 */
-            case 47:    /* sstore_0 */
-            case 48:    /* sstore_1 */
-            case 49:    /* sstore_2 */
-            case 50:    /* sstore_3 */
-            case 51:    /* istore_0 */
-            case 52:    /* istore_1 */
-            case 53:    /* istore_2 */
-            case 54:    /* istore_3 */
-            case 55:    /* aastore */
-            case 56:    /* bastore */
-            case 57:    /* sastore */
-            case 58:    /* iastore */
-            case 59:    /* pop */
-            case 60:    /* pop2 */
-            case 61:    /* dup */
-            case 62:    /* dup2 */
-            case 65:    /* sadd */
-            case 66:    /* iadd */
-            case 67:    /* ssub */
-            case 68:    /* isub */
-            case 69:    /* smul */
-            case 70:    /* imul */
-            case 71:    /* sdiv */
-            case 72:    /* idiv */
-            case 73:    /* srem */
-            case 74:    /* irem */
-            case 75:    /* sneg */
-            case 76:    /* ineg */
-            case 77:    /* sshl */
-            case 78:    /* ishl */
-            case 79:    /* sshr */
-            case 80:    /* ishr */
-            case 81:    /* sushr */
-            case 82:    /* iushr */
-            case 83:    /* sand */
-            case 84:    /* iand */
-            case 85:    /* sor */
-            case 86:    /* ior */
-            case 87:    /* sxor */
-            case 88:    /* ixor */
-            case 91:    /* s2b */
-            case 92:    /* s2i */
-            case 93:    /* i2b */
-            case 94:    /* i2s */
-            case 95:    /* icmp */
-            case 119:   /* areturn */
-            case 120:   /* sreturn */
-            case 121:   /* ireturn */
-            case 122:   /* return */
-            case 146:   /* arraylength */
-            case 147:   /* athrow */
-                *crt_info_offset += 1;
-                break;
-
-/* One operand but not a ref nor a branch*/
-            case 16:    /* bspush */
-            case 18:    /* bipush */
-            case 21:    /* aload */
-            case 22:    /* sload */
-            case 23:    /* iload */
-            case 40:    /* astore */
-            case 41:    /* sstore */
-            case 42:    /* istore */
-            case 63:    /* dup_x */
-            case 64:    /* swap_x */
-            case 114:   /* ret */
-            case 144:   /* newarray */
-                bytecodes[*bytecodes_count]->nb_args = 1;
-                bytecodes[*bytecodes_count]->nb_byte_args = 1;
-                ++u2Index1;
-                *crt_info_offset += 2;
-                bytecodes[*bytecodes_count]->args[0] = method->bytecodes[u2Index1];
-                break;
-
-/* One operand but a branch */
-            case 96:    /* ifeq */
-            case 97:    /* ifne */
-            case 98:    /* iflt */
-            case 99:    /* ifge */
-            case 100:   /* ifgt */
-            case 101:   /* ifle */
-            case 102:   /* ifnull */
-            case 103:   /* ifnonnull */
-            case 104:   /* if_acmpeq */
-            case 105:   /* if_acmpne */
-            case 106:   /* if_scmpeq */
-            case 107:   /* if_scmpne */
-            case 108:   /* if_scmplt */
-            case 109:   /* if_scmpge */
-            case 110:   /* if_scmpgt */
-            case 111:   /* if_scmple */
-            case 112:   /* goto */
-                bytecodes[*bytecodes_count]->nb_args = 1;
-                bytecodes[*bytecodes_count]->has_branch = 1;
-                ++u2Index1;
-                *crt_info_offset += 2;
+        crt_bytecode = bytecodes[*bytecodes_count];
+
+        crt_bytecode->opcode = method->bytecodes[u2Index1];
+        crt_bytecode->offset = u2Index1;
+        crt_bytecode->info_offset = *crt_info_offset;
+        crt_bytecode->nb_args = opcode->nb_args;
+        crt_bytecode->nb_byte_args = 0;
+        crt_bytecode->has_ref = 0;
+        crt_bytecode->has_branch = 0;
+        crt_bytecode->switch_data = NULL;
+
+        switch(opcode->format) {
+            case OPCODE_FORMAT_BYTES:
+                crt_bytecode->nb_byte_args = opcode->nb_args;
+                memcpy(crt_bytecode->args, method->bytecodes + u2Index1 + 1, opcode->nb_args);
                 break;
 
-/* One operand but a ref */
-            case 131:   /* getfield_a */
-            case 132:   /* getfield_b */
-            case 133:   /* getfield_s */
-            case 134:   /* getfield_i */
-            case 135:   /* putfield_a */
-            case 136:   /* putfield_b */
-            case 137:   /* putfield_s */
-            case 138:   /* putfield_i */
-            case 173:   /* getfield_a_this */
-            case 174:   /* getfield_b_this */
-            case 175:   /* getfield_s_this */
-            case 176:   /* getfield_i_this */
-            case 181:   /* putfield_a_this */
-            case 182:   /* putfield_b_this */
-            case 183:   /* putfield_s_this */
-            case 184:   /* putfiled_i_this */
-                bytecodes[*bytecodes_count]->nb_args = 1;
-                bytecodes[*bytecodes_count]->has_ref = 1;
-                ++u2Index1;
-                *crt_info_offset += 2;
-                bytecodes[*bytecodes_count]->ref = acf->constant_pool[method->bytecodes[u2Index1]];
+            case OPCODE_FORMAT_BRANCH:
+                crt_bytecode->has_branch = 1;
                 break;
 
-/* Two operands but not a wide ref */
-            case 17:    /* sspush */
-            case 19:    /* sipush */
-            case 89:    /* sinc */
-            case 90:    /* iinc */
-                bytecodes[*bytecodes_count]->nb_args = 2;
-                bytecodes[*bytecodes_count]->nb_byte_args = 2;
-                ++u2Index1;
-                bytecodes[*bytecodes_count]->args[0] = method->bytecodes[u2Index1];
-                ++u2Index1;
-                bytecodes[*bytecodes_count]->args[1] = method->bytecodes[u2Index1];
-                *crt_info_offset += 3;
+            case OPCODE_FORMAT_REF:
+                crt_bytecode->has_ref = 1;
+                if(opcode->ref_width == 1)
+                    crt_bytecode->ref = acf->constant_pool[method->bytecodes[u2Index1 + 1]];
+                else
+                    crt_bytecode->ref = acf->constant_pool[(method->bytecodes[u2Index1 + 1] << 8) | method->bytecodes[u2Index1 + 2]];
                 break;
 
-/* Two operands but a wide branch */
-            case 113:   /* jsr */
-            case 152:   /* ifeq_w */
-            case 153:   /* ifne_w */
-            case 154:   /* iflt_w */
-            case 155:   /* ifge_w */
-            case 156:   /* ifgt_w */
-            case 157:   /* ifle_w */
-            case 158:   /* ifnull_w */
-            case 159:   /* ifnonnull_w */
-            case 160:   /* if_acmpeq_w */
-            case 161:   /* if_acmpne_w */
-            case 162:   /* if_scmpeq_w */
-            case 163:   /* if_scmpne_w */
-            case 164:   /* if_scmplt_w */
-            case 165:   /* if_scmpge_w */
-            case 166:   /* if_scmpgt_w */
-            case 167:   /* if_scmple_w */
-            case 168:   /* goto_w */
-                bytecodes[*bytecodes_count]->nb_args = 2;
-                bytecodes[*bytecodes_count]->has_branch = 1;
-                u2Index1 += 2;
-                *crt_info_offset += 3;
-                break;
-
-/* Two operands but a wide ref */
-            case 123:   /* getstatic_a */
-            case 124:   /* getstatic_b */
-            case 125:   /* getstatic_s */
-            case 126:   /* getstatic_i */
-            case 127:   /* putstatic_a */
-            case 128:   /* putstatic_b */
-            case 129:   /* putstatic_s */
-            case 130:   /* putstatic_i */
-            case 139:   /* invokevirtual */
-            case 140:   /* invokespecial */
-            case 141:   /* invokestatic */
-            case 143:   /* new */
-            case 145:   /* anewarray */
-            case 169:   /* getfield_a_w */
-            case 170:   /* getfield_b_w */
-            case 171:   /* getfield_s_w */
-            case 172:   /* getfield_i_w */
-            case 177:   /* putfield_a_w */
-            case 178:   /* putfield_b_w */
-            case 179:   /* putfield_s_w */
-            case 180:   /* putfield_i_w */
-                bytecodes[*bytecodes_count]->nb_args = 2;
-                bytecodes[*bytecodes_count]->has_ref = 1;
-                bytecodes[*bytecodes_count]->ref = acf->constant_pool[(method->bytecodes[u2Index1 + 1] << 8) | method->bytecodes[u2Index1 + 2]];
-                u2Index1 += 2;
-                *crt_info_offset += 3;
-                break;
-
-/* Three operands */
-            case 150:   /* sinc_w */
-            case 151:   /* iinc_w */
-                bytecodes[*bytecodes_count]->nb_args = 3;
-                bytecodes[*bytecodes_count]->nb_byte_args = 3;
-                ++u2Index1;
-                bytecodes[*bytecodes_count]->args[0] = method->bytecodes[u2Index1];
-                ++u2Index1;
-                bytecodes[*bytecodes_count]->args[1] = method->bytecodes[u2Index1];
-                ++u2Index1;
-                bytecodes[*bytecodes_count]->args[2] = method->bytecodes[u2Index1];
-                *crt_info_offset += 4;
-                break;
-
-/* Three operands with a wide ref */
-            case 148:   /* checkcast */
-            case 149:   /* instanceof */
-                bytecodes[*bytecodes_count]->nb_args = 3;
-                bytecodes[*bytecodes_count]->nb_byte_args = 1;
-                ++u2Index1;
-                bytecodes[*bytecodes_count]->args[0] = method->bytecodes[u2Index1];
-                if(bytecodes[*bytecodes_count]->args[0] == 14 || bytecodes[*bytecodes_count]->args[0] == 0) {
-                    bytecodes[*bytecodes_count]->has_ref = 1;
-                    bytecodes[*bytecodes_count]->ref = acf->constant_pool[(method->bytecodes[u2Index1 + 1] << 8) | method->bytecodes[u2Index1 + 2]];
+            case OPCODE_FORMAT_TYPE_REF:    /* checkcast & instanceof */
+                crt_bytecode->nb_byte_args = 1;
+                crt_bytecode->args[0] = method->bytecodes[u2Index1 + 1];
+                if(crt_bytecode->args[0] == 14 || crt_bytecode->args[0] == 0) {
+                    crt_bytecode->has_ref = 1;
+                    crt_bytecode->ref = acf->constant_pool[(method->bytecodes[u2Index1 + 2] << 8) | method->bytecodes[u2Index1 + 3]];
                 } else {
-                    bytecodes[*bytecodes_count]->nb_byte_args = 3;
-                    bytecodes[*bytecodes_count]->args[1] = 0;
-                    bytecodes[*bytecodes_count]->args[2] = 0;
+                    crt_bytecode->nb_byte_args = 3;
+                    crt_bytecode->args[1] = 0;
+                    crt_bytecode->args[2] = 0;
                 }
-                u2Index1 += 2;
-                *crt_info_offset += 4;
-                break;
-
-/* Four operands */
-            case 20:    /* iipush */
-                bytecodes[*bytecodes_count]->nb_args = 4;
-                bytecodes[*bytecodes_count]->nb_byte_args = 4;
-                ++u2Index1;
-                bytecodes[*bytecodes_count]->args[0] = method->bytecodes[u2Index1];
-                ++u2Index1;
-                bytecodes[*bytecodes_count]->args[1] = method->bytecodes[u2Index1];
-                ++u2Index1;
-                bytecodes[*bytecodes_count]->args[2] = method->bytecodes[u2Index1];
-                ++u2Index1;
-                bytecodes[*bytecodes_count]->args[3] = method->bytecodes[u2Index1];
-                *crt_info_offset += 5;
                 break;
 
-/* Four operands with refs */
-            case 142:   /* invokeinterface */
-                bytecodes[*bytecodes_count]->nb_args = 4;
-                bytecodes[*bytecodes_count]->nb_byte_args = 2;
-                ++u2Index1;
-                bytecodes[*bytecodes_count]->args[0] = method->bytecodes[u2Index1];
-                bytecodes[*bytecodes_count]->has_ref = 1;
-                bytecodes[*bytecodes_count]->ref = acf->constant_pool[(method->bytecodes[u2Index1 + 1] << 8) | method->bytecodes[u2Index1 + 2]];
-                u2Index1 += 3;
-                bytecodes[*bytecodes_count]->args[1] = method->bytecodes[u2Index1];
-                *crt_info_offset += 5;
+            case OPCODE_FORMAT_INVOKEINTERFACE:
+                crt_bytecode->nb_byte_args = 2;
+                crt_bytecode->args[0] = method->bytecodes[u2Index1 + 1];
+                crt_bytecode->has_ref = 1;
+                crt_bytecode->ref = acf->constant_pool[(method->bytecodes[u2Index1 + 2] << 8) | method->bytecodes[u2Index1 + 3]];
+                crt_bytecode->args[1] = method->bytecodes[u2Index1 + 4];
                 break;
 
-/* LookupSwitch */
-            case 117:   /* slookupswitch */
-                bytecodes[*bytecodes_count]->nb_args = 4 + (((method->bytecodes[u2Index1 + 3] << 8) | method->bytecodes[u2Index1 + 4]) * 4);
-                bytecodes[*bytecodes_count]->slookupswitch.nb_cases = (method->bytecodes[u2Index1 + 3] << 8) | method->bytecodes[u2Index1 + 4];
-                u2Index1 += bytecodes[*bytecodes_count]->nb_args;
-                *crt_info_offset += bytecodes[*bytecodes_count]->nb_args + 1;
-                break;
-
-            case 118:   /* ilookupswitch */
-                bytecodes[*bytecodes_count]->nb_args = 4 + (((method->bytecodes[u2Index1 + 3] << 8) | method->bytecodes[u2Index1 + 4]) * 6);
-                bytecodes[*bytecodes_count]->ilookupswitch.nb_cases = (method->bytecodes[u2Index1 + 3] << 8) | method->bytecodes[u2Index1 + 4];
-                u2Index1 += bytecodes[*bytecodes_count]->nb_args;
-                *crt_info_offset += bytecodes[*bytecodes_count]->nb_args + 1;
-                break;
-
-/* TableSwitch */
-            case 115:   /* stableswitch */
-                bytecodes[*bytecodes_count]->nb_args = 6 + ((((method->bytecodes[u2Index1 + 5] << 8) | method->bytecodes[u2Index1 + 6]) - ((method->bytecodes[u2Index1 + 3] << 8) | method->bytecodes[u2Index1 + 4]) + 1) * 2);
-                bytecodes[*bytecodes_count]->stableswitch.low = (method->bytecodes[u2Index1 + 3] << 8) | method->bytecodes[u2Index1 + 4];
-                bytecodes[*bytecodes_count]->stableswitch.high = (method->bytecodes[u2Index1 + 5] << 8) | method->bytecodes[u2Index1 + 6];
-                bytecodes[*bytecodes_count]->stableswitch.nb_cases = bytecodes[*bytecodes_count]->stableswitch.high - bytecodes[*bytecodes_count]->stableswitch.low + 1;
-                u2Index1 += bytecodes[*bytecodes_count]->nb_args;
-                *crt_info_offset += bytecodes[*bytecodes_count]->nb_args + 1;
-                break;
+            case OPCODE_FORMAT_STABLESWITCH:
+            case OPCODE_FORMAT_ITABLESWITCH:
+            case OPCODE_FORMAT_SLOOKUPSWITCH:
+            case OPCODE_FORMAT_ILOOKUPSWITCH:
+                crt_bytecode->switch_data = (switch_info*)calloc(1, sizeof(switch_info));
+                if(crt_bytecode->switch_data == NULL) {
+                    perror("analyze_bytecodes");
+                    return NULL;
+                }
 
-            case 116:   /* itableswitch */
-                bytecodes[*bytecodes_count]->nb_args = 6 + ((((method->bytecodes[u2Index1 + 7] << 24) | (method->bytecodes[u2Index1 + 8] << 16) | (method->bytecodes[u2Index1 + 9] << 8) | method->bytecodes[u2Index1 + 10]) - ((method->bytecodes[u2Index1 + 3] << 24) | (method->bytecodes[u2Index1 + 4] << 16) | (method->bytecodes[u2Index1 + 5] << 8) | method->bytecodes[u2Index1 + 6]) + 1) * 2);
-                bytecodes[*bytecodes_count]->itableswitch.low = (method->bytecodes[u2Index1 + 3] << 24) | (method->bytecodes[u2Index1 + 4] << 16) | (method->bytecodes[u2Index1 + 5] << 8) | method->bytecodes[u2Index1 + 6];
-                bytecodes[*bytecodes_count]->itableswitch.high = (method->bytecodes[u2Index1 + 7] << 24) | (method->bytecodes[u2Index1 + 8] << 16) | (method->bytecodes[u2Index1 + 9] << 8) | method->bytecodes[u2Index1 + 10];
-                bytecodes[*bytecodes_count]->itableswitch.nb_cases = bytecodes[*bytecodes_count]->itableswitch.high - bytecodes[*bytecodes_count]->itableswitch.low + 1;
-                u2Index1 += bytecodes[*bytecodes_count]->nb_args;
-                *crt_info_offset += bytecodes[*bytecodes_count]->nb_args + 1;
+                if(opcode->format == OPCODE_FORMAT_STABLESWITCH) {
+                    crt_bytecode->switch_data->stableswitch.low = (method->bytecodes[u2Index1 + 3] << 8) | method->bytecodes[u2Index1 + 4];
+                    crt_bytecode->switch_data->stableswitch.high = (method->bytecodes[u2Index1 + 5] << 8) | method->bytecodes[u2Index1 + 6];
+                    crt_bytecode->switch_data->stableswitch.nb_cases = crt_bytecode->switch_data->stableswitch.high - crt_bytecode->switch_data->stableswitch.low + 1;
+                    crt_bytecode->nb_args += crt_bytecode->switch_data->stableswitch.nb_cases * 2;
+                } else if(opcode->format == OPCODE_FORMAT_ITABLESWITCH) {
+                    crt_bytecode->switch_data->itableswitch.low = (method->bytecodes[u2Index1 + 3] << 24) | (method->bytecodes[u2Index1 + 4] << 16) | (method->bytecodes[u2Index1 + 5] << 8) | method->bytecodes[u2Index1 + 6];
+                    crt_bytecode->switch_data->itableswitch.high = (method->bytecodes[u2Index1 + 7] << 24) | (method->bytecodes[u2Index1 + 8] << 16) | (method->bytecodes[u2Index1 + 9] << 8) | method->bytecodes[u2Index1 + 10];
+                    crt_bytecode->switch_data->itableswitch.nb_cases = crt_bytecode->switch_data->itableswitch.high - crt_bytecode->switch_data->itableswitch.low + 1;
+                    crt_bytecode->nb_args += crt_bytecode->switch_data->itableswitch.nb_cases * 2;
+                } else if(opcode->format == OPCODE_FORMAT_SLOOKUPSWITCH) {
+                    crt_bytecode->switch_data->slookupswitch.nb_cases = (method->bytecodes[u2Index1 + 3] << 8) | method->bytecodes[u2Index1 + 4];
+                    crt_bytecode->nb_args += crt_bytecode->switch_data->slookupswitch.nb_cases * 4;
+                } else {
+                    crt_bytecode->switch_data->ilookupswitch.nb_cases = (method->bytecodes[u2Index1 + 3] << 8) | method->bytecodes[u2Index1 + 4];
+                    crt_bytecode->nb_args += crt_bytecode->switch_data->ilookupswitch.nb_cases * 6;
+                }
                 break;
-
         }
 
-        ++u2Index1;
+        u2Index1 += crt_bytecode->nb_args + 1;
+        *crt_info_offset += crt_bytecode->nb_args + 1;
         *bytecodes_count += 1;
     }
 
@@ -1569,57 +1335,57 @@ static bytecode_info** analyze_bytecodes(analyzed_cap_file* acf, cf_method_info*
         if(bytecodes[u2Index1]->has_branch) {   /* Every bytecode with a branch except switch like bytecodes. */
             u2 offset_to_find = 0;
 
-            if(bytecodes[u2Index1]->nb_args == 1)
-                offset_to_find = bytecodes[u2Index1]->offset + (char)method->bytecodes[bytecodes[u2Index1]->offset + 1];
+            if(opcodes[bytecodes[u2Index1]->opcode].branch_width == 1)
+                offset_to_find = bytecodes[u2Index1]->offset + (int8_t)method->bytecodes[bytecodes[u2Index1]->offset + 1];
             else 
                 offset_to_find = bytecodes[u2Index1]->offset + (int16_t)((method->bytecodes[bytecodes[u2Index1]->offset + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 2]);
 
             bytecodes[u2Index1]->branch = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, offset_to_find);
         } else if(bytecodes[u2Index1]->opcode == 115) { /* stableswitch */
-            bytecodes[u2Index1]->stableswitch.branches = (bytecode_info**)malloc(sizeof(bytecode_info*) * (bytecodes[u2Index1]->stableswitch.nb_cases));
-            if(bytecodes[u2Index1]->stableswitch.branches == NULL) {
+            bytecodes[u2Index1]->switch_data->stableswitch.branches = (bytecode_info**)malloc(sizeof(bytecode_info*) * (bytecodes[u2Index1]->switch_data->stableswitch.nb_cases));
+            if(bytecodes[u2Index1]->switch_data->stableswitch.branches == NULL) {
                 perror("analyze_bytecodes");
                 return NULL;
             }
 
-            bytecodes[u2Index1]->stableswitch.default_branch = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + ((method->bytecodes[bytecodes[u2Index1]->offset + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 2]));
-            for(; u2Index2 < bytecodes[u2Index1]->stableswitch.nb_cases; ++u2Index2) {
-                bytecodes[u2Index1]->stableswitch.branches[u2Index2] = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + ((method->bytecodes[bytecodes[u2Index1]->offset + 6 + (u2Index2 * 2) + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 6 + (u2Index2 * 2) + 2]));
+            bytecodes[u2Index1]->switch_data->stableswitch.default_branch = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + ((method->bytecodes[bytecodes[u2Index1]->offset + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 2]));
+            for(; u2Index2 < bytecodes[u2Index1]->switch_data->stableswitch.nb_cases; ++u2Index2) {
+                bytecodes[u2Index1]->switch_data->stableswitch.branches[u2Index2] = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + ((method->bytecodes[bytecodes[u2Index1]->offset + 6 + (u2Index2 * 2) + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 6 + (u2Index2 * 2) + 2]));
             }
         } else if(bytecodes[u2Index1]->opcode == 116) { /* itableswitch */
-            bytecodes[u2Index1]->itableswitch.branches = (bytecode_info**)malloc(sizeof(bytecode_info*) * (bytecodes[u2Index1]->itableswitch.nb_cases));
-            if(bytecodes[u2Index1]->itableswitch.branches == NULL) {
+            bytecodes[u2Index1]->switch_data->itableswitch.branches = (bytecode_info**)malloc(sizeof(bytecode_info*) * (bytecodes[u2Index1]->switch_data->itableswitch.nb_cases));
+            if(bytecodes[u2Index1]->switch_data->itableswitch.branches == NULL) {
                 perror("analyze_bytecodes");
                 return NULL;
             }
 
-            bytecodes[u2Index1]->itableswitch.default_branch = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + ((method->bytecodes[bytecodes[u2Index1]->offset + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 2]));
-            for(; u2Index2 < bytecodes[u2Index1]->itableswitch.nb_cases; ++u2Index2) {
-                bytecodes[u2Index1]->itableswitch.branches[u2Index2] = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + ((method->bytecodes[bytecodes[u2Index1]->offset + 10 + (u2Index2 * 2) + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 10 + (u2Index2 * 2) + 2]));
+            bytecodes[u2Index1]->switch_data->itableswitch.default_branch = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + ((method->bytecodes[bytecodes[u2Index1]->offset + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 2]));
+            for(; u2Index2 < bytecodes[u2Index1]->switch_data->itableswitch.nb_cases; ++u2Index2) {
+                bytecodes[u2Index1]->switch_data->itableswitch.branches[u2Index2] = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + ((method->bytecodes[bytecodes[u2Index1]->offset + 10 + (u2Index2 * 2) + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 10 + (u2Index2 * 2) + 2]));
             }
         } else if(bytecodes[u2Index1]->opcode == 117){  /* slookupswitch */
-            bytecodes[u2Index1]->slookupswitch.cases = (slookupswitch_pair_info*)malloc(sizeof(slookupswitch_pair_info) * bytecodes[u2Index1]->slookupswitch.nb_cases);
-            if(bytecodes[u2Index1]->slookupswitch.cases == NULL) {
+            bytecodes[u2Index1]->switch_data->slookupswitch.cases = (slookupswitch_pair_info*)malloc(sizeof(slookupswitch_pair_info) * bytecodes[u2Index1]->switch_data->slookupswitch.nb_cases);
+            if(bytecodes[u2Index1]->switch_data->slookupswitch.cases == NULL) {
                 perror("analyze_bytecodes");
                 return NULL;
             }
 
-            bytecodes[u2Index1]->slookupswitch.default_branch = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + (int16_t)((method->bytecodes[bytecodes[u2Index1]->offset + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 2]));
-            for(; u2Index2 < bytecodes[u2Index1]->slookupswitch.nb_cases; ++u2Index2) {
-                bytecodes[u2Index1]->slookupswitch.cases[u2Index2].match = (method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 4) + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 4) + 2];
-                bytecodes[u2Index1]->slookupswitch.cases[u2Index2].branch = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + (int16_t)((method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 4) + 3] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 4) + 4]));
+            bytecodes[u2Index1]->switch_data->slookupswitch.default_branch = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + (int16_t)((method->bytecodes[bytecodes[u2Index1]->offset + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 2]));
+            for(; u2Index2 < bytecodes[u2Index1]->switch_data->slookupswitch.nb_cases; ++u2Index2) {
+                bytecodes[u2Index1]->switch_data->slookupswitch.cases[u2Index2].match = (method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 4) + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 4) + 2];
+                bytecodes[u2Index1]->switch_data->slookupswitch.cases[u2Index2].branch = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + (int16_t)((method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 4) + 3] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 4) + 4]));
             }
         } else if(bytecodes[u2Index1]->opcode == 118) { /* ilookupswitch */
-            bytecodes[u2Index1]->ilookupswitch.cases = (ilookupswitch_pair_info*)malloc(sizeof(ilookupswitch_pair_info) * bytecodes[u2Index1]->ilookupswitch.nb_cases);
-            if(bytecodes[u2Index1]->ilookupswitch.cases == NULL) {
+            bytecodes[u2Index1]->switch_data->ilookupswitch.cases = (ilookupswitch_pair_info*)malloc(sizeof(ilookupswitch_pair_info) * bytecodes[u2Index1]->switch_data->ilookupswitch.nb_cases);
+            if(bytecodes[u2Index1]->switch_data->ilookupswitch.cases == NULL) {
                 perror("analyze_bytecodes");
                 return NULL;
             }
 
-            bytecodes[u2Index1]->ilookupswitch.default_branch = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + (int16_t)((method->bytecodes[bytecodes[u2Index1]->offset + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 2]));
-            for(; u2Index2 < bytecodes[u2Index1]->ilookupswitch.nb_cases; ++u2Index2) {
-                bytecodes[u2Index1]->ilookupswitch.cases[u2Index2].match = (method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 6) + 1] << 24) | (method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 6) + 2] << 16) | (method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 6) + 3] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 6) + 4];
-                bytecodes[u2Index1]->ilookupswitch.cases[u2Index2].branch = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + (int16_t)((method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 6) + 5] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 6) + 6]));
+            bytecodes[u2Index1]->switch_data->ilookupswitch.default_branch = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + (int16_t)((method->bytecodes[bytecodes[u2Index1]->offset + 1] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 2]));
+            for(; u2Index2 < bytecodes[u2Index1]->switch_data->ilookupswitch.nb_cases; ++u2Index2) {
+                bytecodes[u2Index1]->switch_data->ilookupswitch.cases[u2Index2].match = (method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 6) + 1] << 24) | (method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 6) + 2] << 16) | (method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 6) + 3] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 6) + 4];
+                bytecodes[u2Index1]->switch_data->ilookupswitch.cases[u2Index2].branch = get_bytecode_from_offset(bytecodes, *bytecodes_count, u2Index1, bytecodes[u2Index1]->offset + (int16_t)((method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 6) + 5] << 8) | method->bytecodes[bytecodes[u2Index1]->offset + 4 + (u2Index2 * 6) + 6]));
             }
         }
     }
@@ -1654,7 +1420,7 @@ static constant_pool_entry_info* add_new_internal_static_method_to_constant_pool
     }
     acf->constant_pool = tmp;
 
-    acf->constant_pool[acf->constant_pool_count] = (constant_pool_entry_info*)malloc(sizeof(constant_pool_entry_info));
+    acf->constant_pool[acf->constant_pool_count] = (constant_pool_entry_info*)calloc(1, sizeof(constant_pool_entry_info));
     if(acf->constant_pool[acf->constant_pool_count] == NULL) {
         perror("add_new_internal_static_method_to_constant_pool");
         return NULL;
@@ -1697,7 +1463,7 @@ static constant_pool_entry_info* add_new_internal_virtual_method_to_constant_poo
     }
     acf->constant_pool = tmp;
 
-    acf->constant_pool[acf->constant_pool_count] = (constant_pool_entry_info*)malloc(sizeof(constant_pool_entry_info));
+    acf->constant_pool[acf->constant_pool_count] = (constant_pool_entry_info*)calloc(1, sizeof(constant_pool_entry_info));
     if(acf->constant_pool[acf->constant_pool_count] == NULL) {
         perror("add_new_internal_static_method_to_constant_pool");
         return NULL;
@@ -1744,7 +1510,7 @@ static int analyze_class_methods(analyzed_cap_file* acf, class_info* class, cap_
     for(; u2Index1 < class->methods_count; ++u2Index1) {
         u2 u2Index2 = 0;
 
-        class->methods[u2Index1] = (method_info*)malloc(sizeof(method_info));
+        class->methods[u2Index1] = (method_info*)calloc(1, sizeof(method_info));
         if(class->methods[u2Index1] == NULL) {
             perror("analyze_class_methods");
             return -1;
@@ -1857,6 +1623,11 @@ static int analyze_class_methods(analyzed_cap_file* acf, class_info* class, cap_
             *info_offset += 2;
         }
 
+        /* The offsets read from the CAP file are valid until the bytecodes
+           change. */
+        class->methods[u2Index1]->bytecodes_size = cf->method.methods[u2Index2].bytecode_count;
+        class->methods[u2Index1]->needs_layout = 0;
+
         /* Mainly if the method is not abstract then we analyze its bytecodes. */
         if(cf->method.methods[u2Index2].bytecode_count != 0) {
             if((class->methods[u2Index1]->bytecodes = analyze_bytecodes(acf, cf->method.methods + u2Index2, &(class->methods[u2Index1]->bytecodes_count), info_offset)) == NULL)
@@ -2025,7 +1796,7 @@ static int analyze_classes(analyzed_cap_file* acf, cap_file* cf) {
     u2 info_offset = 1 + (cf->method.handler_count * 8);
 
     acf->classes_count = cf->class.classes_count;
-    acf->classes = (class_info**)malloc(sizeof(class_info) * acf->classes_count);
+    acf->classes = (class_info**)malloc(sizeof(class_info*) * acf->classes_count);
     if(acf->classes == NULL) {
         perror("analyze_cap_file");
         return -1;
@@ -2035,7 +1806,7 @@ static int analyze_classes(analyzed_cap_file* acf, cap_file* cf) {
         u1 descriptorIndex = 0;
         u2 u2Index2 = 0;
 
-        acf->classes[u2Index1] = (class_info*)malloc(sizeof(class_info));
+        acf->classes[u2Index1] = (class_info*)calloc(1, sizeof(class_info));
         if(acf->classes[u2Index1] == NULL) {
             perror("analyze_classes");
             return -1;
@@ -2155,7 +1926,7 @@ static int analyze_exception_handlers(analyzed_cap_file* acf, cap_file* cf) {
     for(;u1Index < cf->method.handler_count; ++u1Index) {
         u2 u2Index1 = 0;
 
-        acf->exception_handlers[u1Index] = (exception_handler_info*)malloc(sizeof(exception_handler_info));
+        acf->exception_handlers[u1Index] = (exception_handler_info*)calloc(1, sizeof(exception_handler_info));
         if(acf->exception_handlers[u1Index] == NULL) {
             perror("analyze_exception_handlers");
             return -1;
@@ -2440,6 +2211,32 @@ export_file** get_export_files_from_directories(char* const* directories, int nb
 }
 
 
+/**
+ * \brief Search for the parsed export file of a package given its AID.
+ *
+ * \param aid             The AID of the package.
+ * \param aid_length      The length of the AID.
+ * \param export_files    The array of parsed export files.
+ * \param nb_export_files The number of parsed export files in the array.
+ *
+ * \return Return the parsed export file or NULL if none was found.
+ */
+export_file* get_export_file_by_aid(const u1* aid, u1 aid_length, export_file** export_files, int nb_export_files) {
+
+    int index = 0;
+
+    for(; index < nb_export_files; ++index) {
+        ef_CONSTANT_Package_info* package = &(export_files[index]->constant_pool[export_files[index]->this_package].CONSTANT_Package);
+
+        if((package->aid_length == aid_length) && (memcmp(package->aid, aid, aid_length) == 0))
+            return export_files[index];
+    }
+
+    return NULL;
+
+}
+
+
 /**
  * \brief Linking each imported package to a parsed export file. If one is not
  *        found, prompt for a path to it.
@@ -2453,28 +2250,14 @@ export_file** get_export_files_from_directories(char* const* directories, int nb
  */
 static int get_export_files(analyzed_cap_file* acf, export_file** export_files, int nb_export_files) {
 
-    u1 u1Index1 = 0;
-
-    for(; u1Index1 < acf->imported_packages_count; ++u1Index1) {
-        u1 u1Index2 = 0;
-
-        for(; u1Index2 < nb_export_files; ++u1Index2) {
-            if(export_files[u1Index2]->constant_pool[export_files[u1Index2]->this_package].CONSTANT_Package.aid_length == acf->imported_packages[u1Index1]->aid_length) {
-                u1 u1Index3 = 0;
-                for(; u1Index3 < acf->imported_packages[u1Index1]->aid_length; ++u1Index3)
-                    if(export_files[u1Index2]->constant_pool[export_files[u1Index2]->this_package].CONSTANT_Package.aid[u1Index3] != acf->imported_packages[u1Index1]->aid[u1Index3])
-                        break;
+    u1 u1Index = 0;
 
-                if(u1Index3 == acf->imported_packages[u1Index1]->aid_length) {
-                    acf->imported_packages[u1Index1]->ef = export_files[u1Index2];
-                    break;
-                }
-            }
-        }
+    for(; u1Index < acf->imported_packages_count; ++u1Index) {
+        acf->imported_packages[u1Index]->ef = get_export_file_by_aid(acf->imported_packages[u1Index]->aid, acf->imported_packages[u1Index]->aid_length, export_files, nb_export_files);
 
-        if(u1Index2 == nb_export_files) {
+        if(acf->imported_packages[u1Index]->ef == NULL) {
             fprintf(stderr, "Could not find an export file: ");
-            print_AID(acf->imported_packages[u1Index1]->aid, acf->imported_packages[u1Index1]->aid_length);
+            print_AID(acf->imported_packages[u1Index]->aid, acf->imported_packages[u1Index]->aid_length);
             fprintf(stderr, "\n");
             return -1;
         }
@@ -2911,6 +2694,7 @@ static int analyze_manifest(analyzed_cap_file* acf, cap_file* cf) {
                     char** tmp1 = NULL;
                     u1** tmp2 = NULL;
                     u1* tmp3 = NULL;
+                    u1 u1Index2 = applets_count;
                     applets_count = u1Index + 1;
 
                     tmp1 = (char**)realloc(applet_names, sizeof(char*) * applets_count);
@@ -2933,6 +2717,12 @@ static int analyze_manifest(analyzed_cap_file* acf, cap_file* cf) {
                         return -1;
                     }
                     applet_aid_lengths = tmp3;
+
+                    for(; u1Index2 < applets_count; ++u1Index2) {
+                        applet_names[u1Index2] = NULL;
+                        applet_aids[u1Index2] = NULL;
+                        applet_aid_lengths[u1Index2] = 0;
+                    }
                 }
                     
                 crt_index = (end_index - cf->manifest) + 1;
@@ -2990,11 +2780,18 @@ static int analyze_manifest(analyzed_cap_file* acf, cap_file* cf) {
 
                 if(u1Index2 == applet_aid_lengths[u1Index]) {
                     acf->classes[u2Index]->name = applet_names[u1Index];
+                    applet_names[u1Index] = NULL;
                     break;
                 }
             }
     }
 
+    for(u1Index = 0; u1Index < applets_count; ++u1Index) {
+        free(applet_names[u1Index]);
+        free(applet_aids[u1Index]);
+    }
+
+    free(applet_names);
     free(applet_aids);
     free(applet_aid_lengths);
 
@@ -3015,7 +2812,7 @@ static int analyze_manifest(analyzed_cap_file* acf, cap_file* cf) {
  */
 analyzed_cap_file* analyze_cap_file(cap_file* cf, export_file** export_files, int nb_export_files) {
 
-    analyzed_cap_file* acf = (analyzed_cap_file*)malloc(sizeof(analyzed_cap_file));
+    analyzed_cap_file* acf = (analyzed_cap_file*)calloc(1, sizeof(analyzed_cap_file));
     if(acf == NULL) {
         perror("analyze_cap_file");
         return NULL;
@@ -3075,6 +2872,156 @@ analyzed_cap_file* analyze_cap_file(cap_file* cf, export_file** export_files, in
     if(analyze_manifest(acf, cf) == -1)
         return NULL;
 
+    if(cf->source != NULL) {
+        acf->source = (char*)malloc(strlen(cf->source) + 1);
+        if(acf->source == NULL) {
+            perror("analyze_cap_file");
+            return NULL;
+        }
+        strcpy(acf->source, cf->source);
+    } else
+        acf->source = NULL;
+    acf->dirty_components = 0;
+
+    memcpy(acf->source_directory.component_sizes, cf->directory.component_sizes, sizeof(acf->source_directory.component_sizes));
+    acf->source_directory.image_size = cf->directory.static_field_size.image_size;
+    acf->source_directory.array_init_count = cf->directory.static_field_size.array_init_count;
+    acf->source_directory.array_init_size = cf->directory.static_field_size.array_init_size;
+    acf->source_directory.import_count = cf->directory.import_count;
+    acf->source_directory.applet_count = cf->directory.applet_count;
+
     return acf;
 
 }
+
+
+/**
+ * \brief Free a method of an analyzed CAP file along with its bytecodes. The
+ * exception handlers belong to the analyzed CAP file and are not freed.
+ *
+ * \param method The method to free.
+ */
+void free_method(method_info* method) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < method->bytecodes_count; ++u2Index)
+        free_bytecode(method->bytecodes[u2Index]);
+
+    free(method->bytecodes);
+    free(method->exception_handlers);
+    free(method);
+
+}
+
+
+/**
+ * \brief Free a field of an analyzed CAP file along with its initial value.
+ *
+ * \param field The field to free.
+ */
+void free_field(field_info* field) {
+
+    free(field->value);
+    free(field);
+
+}
+
+
+/**
+ * \brief Free a type descriptor of the signature pool of an analyzed CAP
+ * file.
+ *
+ * \param type The type descriptor to free.
+ */
+void free_type_descriptor(type_descriptor_info* type) {
+
+    free(type->types);
+    free(type);
+
+}
+
+
+/**
+ * \brief Free an analyzed CAP file built by analyze_cap_file() or loaded from
+ * a snapshot. The export files it refers to are not freed.
+ *
+ * \param acf The analyzed CAP file to free, might be NULL.
+ */
+void free_analyzed_cap_file(analyzed_cap_file* acf) {
+
+    u2 u2Index1 = 0;
+    u2 u2Index2 = 0;
+
+    if(acf == NULL)
+        return;
+
+    free(acf->manifest.version);
+    free(acf->manifest.created_by);
+    free(acf->manifest.name);
+    free(acf->manifest.package_name);
+    free(acf->manifest.converter_provider);
+    free(acf->manifest.converter_version);
+    free(acf->manifest.creation_time);
+
+    free(acf->info.path);
+    free(acf->info.manifest);
+    free(acf->info.package_aid);
+    free(acf->info.package_name);
+    for(u2Index1 = 0; u2Index1 < acf->info.custom_count; ++u2Index1)
+        free(acf->info.custom_components[u2Index1].aid);
+    free(acf->info.custom_components);
+
+    for(u2Index1 = 0; u2Index1 < acf->imported_packages_count; ++u2Index1) {
+        free(acf->imported_packages[u2Index1]->aid);
+        free(acf->imported_packages[u2Index1]);
+    }
+    free(acf->imported_packages);
+
+    for(u2Index1 = 0; u2Index1 < acf->interfaces_count; ++u2Index1) {
+        free(acf->interfaces[u2Index1]->superinterfaces);
+        for(u2Index2 = 0; u2Index2 < acf->interfaces[u2Index1]->methods_count; ++u2Index2)
+            free_method(acf->interfaces[u2Index1]->methods[u2Index2]);
+        free(acf->interfaces[u2Index1]->methods);
+        free(acf->interfaces[u2Index1]);
+    }
+    free(acf->interfaces);
+
+    for(u2Index1 = 0; u2Index1 < acf->classes_count; ++u2Index1) {
+        class_info* class = acf->classes[u2Index1];
+
+        free(class->name);
+        free(class->aid);
+
+        for(u2Index2 = 0; u2Index2 < class->interfaces_count; ++u2Index2)
+            free(class->interfaces[u2Index2].index);
+        free(class->interfaces);
+
+        for(u2Index2 = 0; u2Index2 < class->fields_count; ++u2Index2)
+            free_field(class->fields[u2Index2]);
+        free(class->fields);
+
+        for(u2Index2 = 0; u2Index2 < class->methods_count; ++u2Index2)
+            free_method(class->methods[u2Index2]);
+        free(class->methods);
+
+        free(class);
+    }
+    free(acf->classes);
+
+    for(u2Index1 = 0; u2Index1 < acf->constant_pool_count; ++u2Index1)
+        free(acf->constant_pool[u2Index1]);
+    free(acf->constant_pool);
+
+    for(u2Index1 = 0; u2Index1 < acf->signature_pool_count; ++u2Index1)
+        free_type_descriptor(acf->signature_pool[u2Index1]);
+    free(acf->signature_pool);
+
+    for(u2Index1 = 0; u2Index1 < acf->exception_handlers_count; ++u2Index1)
+        free(acf->exception_handlers[u2Index1]);
+    free(acf->exception_handlers);
+
+    free(acf->source);
+    free(acf);
+
+}
@@ -0,0 +1,529 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file cap_file_cache.c
+ * \brief Keep analyzed CAP files in an on-disk cache so unchanged CAP files are
+ * not read and analyzed again.
+ *
+ * A cache entry is stored in <cache directory>/<CAP file hash>.acf and is made
+ * of:
+ * - a header (magic and version),
+ * - the number of imported packages and for each of them its AID and the hash
+ *   of the export file it was linked to,
+ * - the size of the snapshot of the analyzed CAP file and the snapshot itself.
+ * Hashes are 64-bit FNV-1a.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "analyzed_cap_file.h"
+#include "analyzed_cap_file_snapshot.h"
+#include "byte_buffer.h"
+#include "cap_file_analyze.h"
+#include "cap_file_cache.h"
+#include "cap_file_reader.h"
+
+#define CACHE_MAGIC         0x41434643  /**< "ACFC" */
+#define CACHE_VERSION       1
+#define FNV_OFFSET_BASIS    0xCBF29CE484222325ULL
+#define FNV_PRIME           0x00000100000001B3ULL
+
+
+static uint64_t hash_bytes(uint64_t hash, const u1* bytes, u4 length) {
+
+    u4 u4Index = 0;
+
+    for(; u4Index < length; ++u4Index) {
+        hash ^= bytes[u4Index];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+
+}
+
+
+static uint64_t hash_u2(uint64_t hash, u2 value) {
+
+    u1 bytes[2];
+
+    bytes[0] = value >> 8;
+    bytes[1] = value & 0xFF;
+    return hash_bytes(hash, bytes, 2);
+
+}
+
+
+static uint64_t hash_u4(uint64_t hash, u4 value) {
+
+    u1 bytes[4];
+
+    bytes[0] = value >> 24;
+    bytes[1] = (value >> 16) & 0xFF;
+    bytes[2] = (value >> 8) & 0xFF;
+    bytes[3] = value & 0xFF;
+    return hash_bytes(hash, bytes, 4);
+
+}
+
+
+/**
+ * \brief Hash the bytes of a file.
+ *
+ * \param filename The file to hash.
+ * \param hash     Where to store the hash.
+ *
+ * \return Return -1 if the file could not be read, 0 else.
+ */
+int hash_file(const char* filename, uint64_t* hash) {
+
+    u1 buffer[65536];
+    size_t length = 0;
+    FILE* file = fopen(filename, "rb");
+
+    if(file == NULL) {
+        perror(filename);
+        return -1;
+    }
+
+    *hash = FNV_OFFSET_BASIS;
+    while((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        *hash = hash_bytes(*hash, buffer, length);
+
+    if(ferror(file)) {
+        perror(filename);
+        fclose(file);
+        return -1;
+    }
+
+    fclose(file);
+    return 0;
+
+}
+
+
+/**
+ * \brief Hash everything a parsed export file holds.
+ *
+ * \param ef The parsed export file.
+ *
+ * \return Return the hash.
+ */
+uint64_t hash_export_file(const export_file* ef) {
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    u2 u2Index1 = 0;
+    u1 u1Index = 0;
+
+    hash = hash_u4(hash, ef->magic);
+    hash = hash_bytes(hash, &(ef->minor_version), 1);
+    hash = hash_bytes(hash, &(ef->major_version), 1);
+    hash = hash_u2(hash, ef->constant_pool_count);
+
+    for(; u2Index1 < ef->constant_pool_count; ++u2Index1) {
+        const ef_cp_info* entry = &(ef->constant_pool[u2Index1]);
+
+        hash = hash_bytes(hash, &(entry->tag), 1);
+        switch(entry->tag) {
+            case EF_CONSTANT_PACKAGE:
+                hash = hash_bytes(hash, &(entry->CONSTANT_Package.flags), 1);
+                hash = hash_u2(hash, entry->CONSTANT_Package.name_index);
+                hash = hash_bytes(hash, &(entry->CONSTANT_Package.minor_version), 1);
+                hash = hash_bytes(hash, &(entry->CONSTANT_Package.major_version), 1);
+                hash = hash_bytes(hash, &(entry->CONSTANT_Package.aid_length), 1);
+                hash = hash_bytes(hash, entry->CONSTANT_Package.aid, entry->CONSTANT_Package.aid_length);
+                break;
+
+            case EF_CONSTANT_CLASSREF:
+                hash = hash_u2(hash, entry->CONSTANT_Classref.name_index);
+                break;
+
+            case EF_CONSTANT_INTEGER:
+                hash = hash_u4(hash, entry->CONSTANT_Integer.bytes);
+                break;
+
+            case EF_CONSTANT_UTF8:
+                hash = hash_u2(hash, entry->CONSTANT_Utf8.length);
+                hash = hash_bytes(hash, entry->CONSTANT_Utf8.bytes, entry->CONSTANT_Utf8.length);
+                break;
+        }
+    }
+
+    hash = hash_u2(hash, ef->this_package);
+    hash = hash_bytes(hash, &(ef->export_class_count), 1);
+
+    for(; u1Index < ef->export_class_count; ++u1Index) {
+        const ef_class_info* class = &(ef->classes[u1Index]);
+        u2 u2Index2 = 0;
+
+        hash = hash_bytes(hash, &(class->token), 1);
+        hash = hash_u2(hash, class->access_flags);
+        hash = hash_u2(hash, class->name_index);
+
+        hash = hash_u2(hash, class->export_supers_count);
+        for(u2Index1 = 0; u2Index1 < class->export_supers_count; ++u2Index1)
+            hash = hash_u2(hash, class->supers[u2Index1]);
+
+        hash = hash_bytes(hash, &(class->export_interfaces_count), 1);
+        for(u2Index1 = 0; u2Index1 < class->export_interfaces_count; ++u2Index1)
+            hash = hash_u2(hash, class->interfaces[u2Index1]);
+
+        hash = hash_u2(hash, class->export_fields_count);
+        for(u2Index1 = 0; u2Index1 < class->export_fields_count; ++u2Index1) {
+            const ef_field_info* field = &(class->fields[u2Index1]);
+
+            hash = hash_bytes(hash, &(field->token), 1);
+            hash = hash_u2(hash, field->access_flags);
+            hash = hash_u2(hash, field->name_index);
+            hash = hash_u2(hash, field->descriptor_index);
+            hash = hash_u2(hash, field->attributes_count);
+            for(u2Index2 = 0; u2Index2 < field->attributes_count; ++u2Index2) {
+                hash = hash_u2(hash, field->attributes[u2Index2].attribute_name_index);
+                hash = hash_u4(hash, field->attributes[u2Index2].attribute_length);
+                hash = hash_u2(hash, field->attributes[u2Index2].constantvalue_index);
+            }
+        }
+
+        hash = hash_u2(hash, class->export_methods_count);
+        for(u2Index1 = 0; u2Index1 < class->export_methods_count; ++u2Index1) {
+            hash = hash_bytes(hash, &(class->methods[u2Index1].token), 1);
+            hash = hash_u2(hash, class->methods[u2Index1].access_flags);
+            hash = hash_u2(hash, class->methods[u2Index1].name_index);
+            hash = hash_u2(hash, class->methods[u2Index1].descriptor_index);
+        }
+    }
+
+    return hash;
+
+}
+
+
+/**
+ * Build the path of the cache entry of a CAP file given its hash.
+ */
+static char* get_entry_path(const char* cache_directory, uint64_t hash) {
+
+    size_t length = strlen(cache_directory) + 22; /* /<16 hex digits>.acf\0 */
+    char* path = (char*)malloc(length);
+
+    if(path == NULL) {
+        perror("get_entry_path");
+        return NULL;
+    }
+
+    snprintf(path, length, "%s/%016llx.acf", cache_directory, (unsigned long long)hash);
+    return path;
+
+}
+
+
+/**
+ * Check that the export files recorded in a cache entry are the same as the
+ * given ones. Return the offset of the snapshot size within the entry or 0 if
+ * the entry cannot be used.
+ */
+static u4 check_entry(const u1* entry, u4 size, export_file** export_files, int nb_export_files) {
+
+    u4 position = 7;
+    u1 imported_packages_count = 0;
+    u1 u1Index = 0;
+
+    if((size < 7) || (load_u4(entry) != CACHE_MAGIC) || (((entry[4] << 8) | entry[5]) != CACHE_VERSION))
+        return 0;
+
+    imported_packages_count = entry[6];
+
+    for(; u1Index < imported_packages_count; ++u1Index) {
+        export_file* ef = NULL;
+        u1 aid_length = 0;
+
+        if((size - position) < 1)
+            return 0;
+
+        aid_length = entry[position++];
+        if((size - position) < (u4)aid_length + 8)
+            return 0;
+
+        ef = get_export_file_by_aid(entry + position, aid_length, export_files, nb_export_files);
+        if((ef == NULL) || (hash_export_file(ef) != load_u8(entry + position + aid_length)))
+            return 0;
+
+        position += aid_length + 8;
+    }
+
+    if(((size - position) < 4) || ((size - position - 4) != load_u4(entry + position)))
+        return 0;
+
+    return position;
+
+}
+
+
+/**
+ * Load an analyzed CAP file from the cache given the hash of the CAP file.
+ */
+static analyzed_cap_file* get_entry(const char* cache_directory, uint64_t hash, export_file** export_files, int nb_export_files) {
+
+    analyzed_cap_file* acf = NULL;
+    char* path = NULL;
+    const u1* entry = NULL;
+    u4 size = 0;
+    u4 position = 0;
+    int missing = 0;
+
+    if((path = get_entry_path(cache_directory, hash)) == NULL)
+        return NULL;
+
+    entry = map_file(path, &size, &missing);
+    free(path);
+    if(entry == NULL)
+        return NULL;
+
+    if((position = check_entry(entry, size, export_files, nb_export_files)) != 0)
+        acf = load_analyzed_cap_file_snapshot(entry + position + 4, size - position - 4, export_files, nb_export_files);
+
+    unmap_file(entry, size);
+    return acf;
+
+}
+
+
+/**
+ * Write a cache entry. The entry is written to a temporary file first so
+ * concurrent readers never see a partial entry. The name of the temporary
+ * file also holds the address of the snapshot so that threads of the same
+ * process writing the same entry do not share it.
+ */
+static int write_entry(const char* path, const u1* header, u4 header_size, const u1* snapshot, u4 snapshot_size) {
+
+    char* tmp_path = (char*)malloc(strlen(path) + 48);
+    FILE* file = NULL;
+
+    if(tmp_path == NULL) {
+        perror("write_entry");
+        return -1;
+    }
+
+    sprintf(tmp_path, "%s.%ld.%lx", path, (long)getpid(), (unsigned long)(size_t)snapshot);
+
+    if((file = fopen(tmp_path, "wb")) == NULL) {
+        perror(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+
+    if((fwrite(header, 1, header_size, file) != header_size) || (fwrite(snapshot, 1, snapshot_size, file) != snapshot_size)) {
+        fprintf(stderr, "Could not write %s\n", tmp_path);
+        fclose(file);
+        remove(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+
+    if((fclose(file) != 0) || (rename(tmp_path, path) != 0)) {
+        perror(tmp_path);
+        remove(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+
+    free(tmp_path);
+    return 0;
+
+}
+
+
+/**
+ * Store an analyzed CAP file in the cache given the hash of the CAP file.
+ */
+static int put_entry(const char* cache_directory, uint64_t hash, analyzed_cap_file* acf) {
+
+    u1* snapshot = NULL;
+    u1* header = NULL;
+    u4 snapshot_size = 0;
+    u4 header_size = 11;
+    u4 position = 7;
+    char* path = NULL;
+    u1 u1Index = 0;
+    int rc = -1;
+
+    for(; u1Index < acf->imported_packages_count; ++u1Index)
+        header_size += 1 + acf->imported_packages[u1Index]->aid_length + 8;
+
+    header = (u1*)malloc(header_size);
+    if(header == NULL) {
+        perror("put_entry");
+        return -1;
+    }
+
+    store_u4(header, CACHE_MAGIC);
+    header[4] = CACHE_VERSION >> 8;
+    header[5] = CACHE_VERSION & 0xFF;
+    header[6] = acf->imported_packages_count;
+
+    for(u1Index = 0; u1Index < acf->imported_packages_count; ++u1Index) {
+        imported_package_info* package = acf->imported_packages[u1Index];
+
+        if(package->ef == NULL) {
+            fprintf(stderr, "Imported package %u is not linked to an export file\n", u1Index);
+            free(header);
+            return -1;
+        }
+
+        header[position++] = package->aid_length;
+        memcpy(header + position, package->aid, package->aid_length);
+        position += package->aid_length;
+        store_u8(header + position, hash_export_file(package->ef));
+        position += 8;
+    }
+
+    if((snapshot = save_analyzed_cap_file_snapshot(acf, &snapshot_size)) == NULL) {
+        free(header);
+        return -1;
+    }
+
+    store_u4(header + position, snapshot_size);
+
+    if((path = get_entry_path(cache_directory, hash)) != NULL) {
+        rc = write_entry(path, header, header_size, snapshot, snapshot_size);
+        free(path);
+    }
+
+    free(snapshot);
+    free(header);
+    return rc;
+
+}
+
+
+/**
+ * \brief Load an analyzed CAP file from the cache.
+ *
+ * \param cache_directory The directory holding the cache entries.
+ * \param filename        The CAP file which was analyzed.
+ * \param export_files    An array of parsed export files.
+ * \param nb_export_files The number of parsed export files in the array.
+ *
+ * \return Return the analyzed CAP file or NULL if it is not in the cache or an
+ *         error occurred.
+ */
+analyzed_cap_file* get_cached_analyzed_cap_file(const char* cache_directory, const char* filename, export_file** export_files, int nb_export_files) {
+
+    uint64_t hash = 0;
+
+    if(hash_file(filename, &hash) == -1)
+        return NULL;
+
+    return get_entry(cache_directory, hash, export_files, nb_export_files);
+
+}
+
+
+/**
+ * \brief Store an analyzed CAP file in the cache.
+ *
+ * \param cache_directory The directory holding the cache entries.
+ * \param filename        The CAP file which was analyzed.
+ * \param acf             The analyzed CAP file.
+ *
+ * \return Return -1 if an error occurred, 0 else.
+ */
+int put_cached_analyzed_cap_file(const char* cache_directory, const char* filename, analyzed_cap_file* acf) {
+
+    uint64_t hash = 0;
+
+    if(hash_file(filename, &hash) == -1)
+        return -1;
+
+    return put_entry(cache_directory, hash, acf);
+
+}
+
+
+/**
+ * \brief Load an analyzed CAP file from the cache or else read, analyze and
+ * store it in the cache.
+ *
+ * \param cache_directory The directory holding the cache entries.
+ * \param filename        The CAP file to read.
+ * \param export_files    An array of parsed export files.
+ * \param nb_export_files The number of parsed export files in the array.
+ *
+ * \return Return the analyzed CAP file or NULL if an error occurred.
+ */
+analyzed_cap_file* read_and_analyze_cap_file(const char* cache_directory, const char* filename, export_file** export_files, int nb_export_files) {
+
+    analyzed_cap_file* acf = NULL;
+    cap_file* cf = NULL;
+    uint64_t hash = 0;
+
+    if(hash_file(filename, &hash) == -1)
+        return NULL;
+
+    if((acf = get_entry(cache_directory, hash, export_files, nb_export_files)) != NULL) {
+        /* The entry was made from the same bytes so the components of the
+           file can still be copied when writing. */
+        if((acf->source = (char*)malloc(strlen(filename) + 1)) == NULL)
+            perror("read_and_analyze_cap_file");
+        else
+            strcpy(acf->source, filename);
+
+        return acf;
+    }
+
+    if((cf = read_cap_file(filename)) == NULL)
+        return NULL;
+
+    acf = analyze_cap_file(cf, export_files, nb_export_files);
+    free_cap_file(cf);
+
+    if(acf == NULL)
+        return NULL;
+
+    if(put_entry(cache_directory, hash, acf) == -1)
+        fprintf(stderr, "Could not cache the analyzed %s\n", filename);
+
+    return acf;
+
+}
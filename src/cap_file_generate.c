@@ -50,6 +50,11 @@
 
 #include "cap_file.h"
 #include "analyzed_cap_file.h"
+#include "cap_file_generate.h"
+#include "cap_file_reader.h"
+#include "analyzed_cap_file_edit.h"
+#include "analyzed_cap_file_frame.h"
+#include "bytecodes.h"
 
 /**
  * Searching for a parameter, a field or a bytecode using int type.
@@ -75,56 +80,7 @@ static char is_using_int(analyzed_cap_file* acf) {
                     return 1;
 
             for(; u2Index3 < acf->classes[u2Index1]->methods[u2Index2]->bytecodes_count; ++u2Index3)
-                if((acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 10) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 11) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 12) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 13) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 14) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 15) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 18) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 19) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 20) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 23) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 32) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 33) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 34) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 35) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 39) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 42) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 51) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 52) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 53) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 54) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 58) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 66) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 68) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 70) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 72) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 74) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 76) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 78) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 80) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 82) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 84) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 86) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 88) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 90) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 92) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 93) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 94) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 95) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 116) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 118) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 121) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 126) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 130) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 134) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 138) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 151) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 172) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 176) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 180) ||
-                   (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 184) ||
+                if((opcodes[acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode].flags & OPCODE_INT) ||
                    ((acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 144) &&
                    (acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->args[0] == 13)) ||
                    ((acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode == 148) &&
@@ -235,9 +191,10 @@ static int generate_header_component(analyzed_cap_file* acf, cap_file* new) {
 
 
 /**
- * Generate the directory component in the given cap_file structure.
+ * Generate the directory component in the given cap_file structure. What the
+ * components copied from the source CAP file hold is taken from the source.
  */
-static int generate_directory_component(analyzed_cap_file* acf, cap_file* new) {
+static int generate_directory_component(analyzed_cap_file* acf, cap_file* new, u2 copied) {
 
     u1 u1Index = 0;
     u2 u2Index = 0;
@@ -287,20 +244,26 @@ static int generate_directory_component(analyzed_cap_file* acf, cap_file* new) {
     new->directory.component_sizes[COMPONENT_DESCRIPTOR - 1] = new->descriptor.size;
     new->directory.component_sizes[COMPONENT_DEBUG - 1] = 0;
 
-    new->directory.static_field_size.image_size = new->static_field.image_size;
-    new->directory.static_field_size.array_init_count = new->static_field.array_init_count;
-    new->directory.static_field_size.array_init_size = 0;
-
-    for(; u2Index < new->static_field.array_init_count; ++u2Index)
-        if((new->static_field.array_init[u2Index].type == 2) || (new->static_field.array_init[u2Index].type == 3))
-            new->directory.static_field_size.array_init_size += new->static_field.array_init[u2Index].count;
-        else if(new->static_field.array_init[u2Index].type == 4)
-            new->directory.static_field_size.array_init_size += (new->static_field.array_init[u2Index].count * 2);
-        else
-            new->directory.static_field_size.array_init_size += (new->static_field.array_init[u2Index].count * 4);
+    if(copied & COMPONENT_BIT(COMPONENT_STATICFIELD)) {
+        new->directory.static_field_size.image_size = acf->source_directory.image_size;
+        new->directory.static_field_size.array_init_count = acf->source_directory.array_init_count;
+        new->directory.static_field_size.array_init_size = acf->source_directory.array_init_size;
+    } else {
+        new->directory.static_field_size.image_size = new->static_field.image_size;
+        new->directory.static_field_size.array_init_count = new->static_field.array_init_count;
+        new->directory.static_field_size.array_init_size = 0;
+
+        for(; u2Index < new->static_field.array_init_count; ++u2Index)
+            if((new->static_field.array_init[u2Index].type == 2) || (new->static_field.array_init[u2Index].type == 3))
+                new->directory.static_field_size.array_init_size += new->static_field.array_init[u2Index].count;
+            else if(new->static_field.array_init[u2Index].type == 4)
+                new->directory.static_field_size.array_init_size += (new->static_field.array_init[u2Index].count * 2);
+            else
+                new->directory.static_field_size.array_init_size += (new->static_field.array_init[u2Index].count * 4);
+    }
 
-    new->directory.import_count = new->import.count;
-    new->directory.applet_count = new->applet.count;
+    new->directory.import_count = (copied & COMPONENT_BIT(COMPONENT_IMPORT)) ? acf->source_directory.import_count : new->import.count;
+    new->directory.applet_count = (copied & COMPONENT_BIT(COMPONENT_APPLET)) ? acf->source_directory.applet_count : new->applet.count;
 
     return 0;
 
@@ -360,7 +323,11 @@ static void count_imported_package(analyzed_cap_file* acf) {
 
     u2 u2Index = 0;
 
-    for(; u2Index < acf->constant_pool_count; ++u2Index)
+    /* The counts of a previous generation are started over. */
+    for(; u2Index < acf->imported_packages_count; ++u2Index)
+        acf->imported_packages[u2Index]->count = 0;
+
+    for(u2Index = 0; u2Index < acf->constant_pool_count; ++u2Index)
         if(acf->constant_pool[u2Index]->flags & CONSTANT_POOL_IS_EXTERNAL && (acf->constant_pool[u2Index]->count !=0))
             ++acf->constant_pool[u2Index]->external_package->count;
 
@@ -435,7 +402,11 @@ static void count_constant_pool_references(analyzed_cap_file* acf) {
     u1 u1Index = 0;
     u2 u2Index1 = 0;
 
-    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+    /* The counts of a previous generation are started over. */
+    for(; u2Index1 < acf->constant_pool_count; ++u2Index1)
+        acf->constant_pool[u2Index1]->count = 0;
+
+    for(u2Index1 = 0; u2Index1 < acf->classes_count; ++u2Index1) {
         u2 u2Index2 = 0;
 
         for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
@@ -457,56 +428,128 @@ static void count_constant_pool_references(analyzed_cap_file* acf) {
 
 
 /**
- * Update the index of each constant pool entry while respecting this order: instance_fieldref, classref, virtual_methodref, super_methodref, static_fieldref, static_methodref.
+ * Order constant pool entries by decreasing reference count then by index.
  */
-static void update_constant_pool_entry_index(analyzed_cap_file* acf) {
+static int compare_constant_pool_entries(const void* entry1, const void* entry2) {
 
-    u2 u2Index = 0;
+    const constant_pool_entry_info* e1 = *(constant_pool_entry_info* const*)entry1;
+    const constant_pool_entry_info* e2 = *(constant_pool_entry_info* const*)entry2;
+
+    if(e1->count != e2->count)
+        return (e1->count > e2->count) ? -1 : 1;
+
+    return (int)e1->my_index - (int)e2->my_index;
+
+}
+
+
+/**
+ * Update the index of each constant pool entry while respecting this order: instance_fieldref, classref, virtual_methodref, super_methodref, static_fieldref, static_methodref.
+ * If sort_by_count is true (!=0), the entries of each group are ordered by
+ * decreasing reference count so the most used ones get the smallest indexes
+ * and thus one byte wide bytecodes.
+ */
+static int update_constant_pool_entry_index(analyzed_cap_file* acf, char sort_by_count) {
+
+    static const u1 groups[6] = {
+        CONSTANT_POOL_INSTANCEFIELDREF,
+        CONSTANT_POOL_CLASSREF,
+        CONSTANT_POOL_VIRTUALMETHODREF,
+        CONSTANT_POOL_SUPERMETHODREF,
+        CONSTANT_POOL_STATICFIELDREF,
+        CONSTANT_POOL_STATICMETHODREF
+    };
+    constant_pool_entry_info** group = NULL;
     u2 crtIndex = 0;
+    u1 u1Index = 0;
 
-    for(; u2Index < acf->constant_pool_count; ++u2Index)
-        if((acf->constant_pool[u2Index]->flags & CONSTANT_POOL_INSTANCEFIELDREF) && (acf->constant_pool[u2Index]->count != 0)) {
-            acf->constant_pool[u2Index]->my_index = crtIndex;
-            ++crtIndex;
+    if(sort_by_count && (acf->constant_pool_count != 0)) {
+        group = (constant_pool_entry_info**)malloc(sizeof(constant_pool_entry_info*) * acf->constant_pool_count);
+        if(group == NULL) {
+            perror("update_constant_pool_entry_index");
+            return -1;
         }
+    }
 
-    for(u2Index = 0; u2Index < acf->constant_pool_count; ++u2Index)
-        if((acf->constant_pool[u2Index]->flags & CONSTANT_POOL_CLASSREF) && (acf->constant_pool[u2Index]->count != 0)) {
-            acf->constant_pool[u2Index]->my_index = crtIndex;
-            ++crtIndex;
-        }
+    for(; u1Index < 6; ++u1Index) {
+        u2 group_start = crtIndex;
+        u2 group_count = 0;
+        u2 u2Index = 0;
 
-    for(u2Index = 0; u2Index < acf->constant_pool_count; ++u2Index)
-        if((acf->constant_pool[u2Index]->flags & CONSTANT_POOL_VIRTUALMETHODREF) && (acf->constant_pool[u2Index]->count != 0)) {
-            acf->constant_pool[u2Index]->my_index = crtIndex;
-            ++crtIndex;
-        }
+        for(; u2Index < acf->constant_pool_count; ++u2Index)
+            if((acf->constant_pool[u2Index]->flags & groups[u1Index]) && (acf->constant_pool[u2Index]->count != 0)) {
+                acf->constant_pool[u2Index]->my_index = crtIndex;
+                ++crtIndex;
 
-    for(u2Index = 0; u2Index < acf->constant_pool_count; ++u2Index)
-        if((acf->constant_pool[u2Index]->flags & CONSTANT_POOL_SUPERMETHODREF) && (acf->constant_pool[u2Index]->count != 0)) {
-            acf->constant_pool[u2Index]->my_index = crtIndex;
-            ++crtIndex;
-        }
+                if(group != NULL)
+                    group[group_count++] = acf->constant_pool[u2Index];
+            }
 
-    for(u2Index = 0; u2Index < acf->constant_pool_count; ++u2Index)
-        if((acf->constant_pool[u2Index]->flags & CONSTANT_POOL_STATICFIELDREF) && (acf->constant_pool[u2Index]->count != 0)) {
-            acf->constant_pool[u2Index]->my_index = crtIndex;
-            ++crtIndex;
+        if(group_count > 1) {
+            qsort(group, group_count, sizeof(constant_pool_entry_info*), compare_constant_pool_entries);
+            for(u2Index = 0; u2Index < group_count; ++u2Index)
+                group[u2Index]->my_index = group_start + u2Index;
         }
+    }
 
-    for(u2Index = 0; u2Index < acf->constant_pool_count; ++u2Index)
-        if((acf->constant_pool[u2Index]->flags & CONSTANT_POOL_STATICMETHODREF) && (acf->constant_pool[u2Index]->count != 0)) {
-            acf->constant_pool[u2Index]->my_index = crtIndex;
-            ++crtIndex;
+    free(group);
+
+    return 0;
+
+}
+
+
+/**
+ * Insert count new bytecodes (as nop) right after the bytecode at the given index.
+ */
+static int insert_bytecodes(method_info* method, u2 index, u1 count) {
+
+    u2 u2Index = 0;
+    u1 u1Index = 0;
+    bytecode_info** tmp = (bytecode_info**)realloc(method->bytecodes, sizeof(bytecode_info*) * (method->bytecodes_count + count));
+    if(tmp == NULL) {
+        perror("insert_bytecodes");
+        return -1;
+    }
+    method->bytecodes = tmp;
+
+    for(u2Index = method->bytecodes_count + count - 1; u2Index > index + count; --u2Index)
+        method->bytecodes[u2Index] = method->bytecodes[u2Index - count];
+
+    method->bytecodes_count += count;
+    method->needs_layout = 1;
+
+    for(u1Index = 1; u1Index <= count; ++u1Index) {
+        method->bytecodes[index + u1Index] = (bytecode_info*)calloc(1, sizeof(bytecode_info));
+        if(method->bytecodes[index + u1Index] == NULL) {
+            perror("insert_bytecodes");
+            return -1;
         }
 
+        method->bytecodes[index + u1Index]->opcode = 0;    /* nop */
+        method->bytecodes[index + u1Index]->nb_byte_args = 0;
+        method->bytecodes[index + u1Index]->has_ref = 0;
+        method->bytecodes[index + u1Index]->has_branch = 0;
+        method->bytecodes[index + u1Index]->nb_args = 0;
+        method->bytecodes[index + u1Index]->offset = 0;
+        method->bytecodes[index + u1Index]->info_offset = 0;
+        method->bytecodes[index + u1Index]->ref = NULL;
+        method->bytecodes[index + u1Index]->branch = NULL;
+        method->bytecodes[index + u1Index]->switch_data = NULL;
+    }
+
+    return 0;
+
 }
 
 
 /**
  * Update bytecodes opcode with respect to constant pool entry index value.
  * Some bytecode can only handle index of one byte width while other two bytes width.
- * We compact or expand accordingly.
+ * We compact or expand accordingly using the opcode counterpart.
+ * Since getfield_<t>_this and putfield_<t>_this have no wide form, they are
+ * replaced by aload_0 followed by getfield_<t>_w or swap_x and putfield_<t>_w.
+ * Those insertions are applied to each method at once.
  */
 static int compact_bytecodes(analyzed_cap_file* acf) {
 
@@ -516,200 +559,575 @@ static int compact_bytecodes(analyzed_cap_file* acf) {
         u2 u2Index2 = 0;
 
         for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            method_info* method = acf->classes[u2Index1]->methods[u2Index2];
+            bytecode_editor editor;
             u2 u2Index3 = 0;
 
-            while(u2Index3 < acf->classes[u2Index1]->methods[u2Index2]->bytecodes_count) {
-                switch(acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode) {
-                    case 131:       /* getfield_a */
-                    case 132:       /* getfield_b */
-                    case 133:       /* getfield_s */
-                    case 134:       /* getfield_i */
-                        if(acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->ref->my_index > 255) {
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode += 38;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->nb_args = 2;
-                        }
-                        break;
-
-                    case 173:       /* getfield_a_this */
-                    case 174:       /* getfield_b_this */
-                    case 175:       /* getfield_s_this */
-                    case 176:       /* getfield_i_this */
-                        if(acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->ref->my_index > 255) {
-                            u2 u2Index4 = 0;
-                            bytecode_info** tmp = (bytecode_info**)realloc(acf->classes[u2Index1]->methods[u2Index2]->bytecodes, sizeof(bytecode_info*) * (acf->classes[u2Index1]->methods[u2Index2]->bytecodes_count + 1));
-                            if(tmp == NULL) {
-                                perror("compact_bytecodes");
-                                return -1;
-                            }
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes = tmp;
+            init_bytecode_editor(&editor, method);
 
-                            for(u2Index4 = acf->classes[u2Index1]->methods[u2Index2]->bytecodes_count; u2Index4 > u2Index3; --u2Index4)
-                                acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index4] = acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index4 - 1];
+            for(; u2Index3 < method->bytecodes_count; ++u2Index3) {
+                bytecode_info* bytecode = method->bytecodes[u2Index3];
+                const opcode_info* opcode = &opcodes[bytecode->opcode];
 
-                            ++acf->classes[u2Index1]->methods[u2Index2]->bytecodes_count;
+                if(!bytecode->has_ref || (opcode->counterpart == bytecode->opcode))
+                    continue;
 
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1] = (bytecode_info*)malloc(sizeof(bytecode_info));
-                            if(acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1] == NULL) {
-                                perror("compact_bytecodes");
-                                return -1;
-                            }
+                if((opcode->ref_width == 1) && (bytecode->ref->my_index > 255)) {
+                    if(opcode->flags & OPCODE_THIS) {
+                        /* If a value is popped, it has to be swapped under the object reference. */
+                        u1 nb_inserted = (opcode->pops == 0) ? 1 : 2;
+                        bytecode_info* inserted[2] = {NULL, NULL};
 
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->opcode = acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode - 4;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->offset = 0;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->nb_byte_args = 0;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->has_ref = 1;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->ref = acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->ref;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->has_branch = 0;
+                        if(nb_inserted == 2) {
+                            inserted[0] = new_bytecode(64); /* swap_x */
+                            if(inserted[0] != NULL)
+                                inserted[0]->args[0] = 0x10 | opcode->pops;
+                        }
 
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode = 24;    /* aload_0 */
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->nb_args = 0;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->has_ref = 0;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->ref = NULL;
+                        inserted[nb_inserted - 1] = new_bytecode(opcode->counterpart);
+                        if(inserted[nb_inserted - 1] != NULL)
+                            inserted[nb_inserted - 1]->ref = bytecode->ref;
 
-                            ++u2Index3;
-                        }
-                        break;
-
-                    case 169:       /* getfield_a_w */
-                    case 170:       /* getfield_b_w */
-                    case 171:       /* getfield_s_w */
-                    case 172:       /* getfield_i_w */
-                        if(acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->ref->my_index < 256) {
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode -= 38;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->nb_args = 1;
-                        }
-                        break;
-
-                    case 135:       /* putfield_a */
-                    case 136:       /* putfield_b */
-                    case 137:       /* putfield_s */
-                    case 138:       /* putfield_i */
-                        if(acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->ref->my_index > 255) {
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode += 42;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->nb_args = 2;
+                        if(((nb_inserted == 2) && (inserted[0] == NULL)) || (inserted[nb_inserted - 1] == NULL) || (edit_insert_after(&editor, u2Index3, inserted, nb_inserted) == -1)) {
+                            free(inserted[0]);
+                            free(inserted[1]);
+                            free_bytecode_editor(&editor);
+                            return -1;
                         }
-                        break;
-
-                    case 181:       /* putfield_a_this */
-                    case 182:       /* putfield_b_this */
-                    case 183:       /* putfield_s_this */
-                    case 184:       /* putfield_i_this */
-                        if(acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->ref->my_index > 255) {
-                            u2 u2Index4 = 0;
-                            bytecode_info** tmp = (bytecode_info**)realloc(acf->classes[u2Index1]->methods[u2Index2]->bytecodes, sizeof(bytecode_info*) * (acf->classes[u2Index1]->methods[u2Index2]->bytecodes_count + 2));
-                            if(tmp == NULL) {
-                                perror("compact_bytecodes");
-                                return -1;
-                            }
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes = tmp;
 
-                            for(u2Index4 = acf->classes[u2Index1]->methods[u2Index2]->bytecodes_count + 1; u2Index4 > u2Index3; --u2Index4)
-                                acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index4] = acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index4 - 1];
+                        bytecode->opcode = 24;  /* aload_0 */
+                        bytecode->nb_args = 0;
+                        bytecode->has_ref = 0;
+                        bytecode->ref = NULL;
+                    } else {
+                        bytecode->opcode = opcode->counterpart;
+                        bytecode->nb_args = opcodes[opcode->counterpart].nb_args;
+                        method->needs_layout = 1;
+                    }
+                } else if((opcode->ref_width == 2) && (opcodes[opcode->counterpart].ref_width == 1) && (bytecode->ref->my_index < 256)) {
+                    bytecode->opcode = opcode->counterpart;
+                    bytecode->nb_args = opcodes[opcode->counterpart].nb_args;
+                    method->needs_layout = 1;
+                }
+            }
 
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes_count += 2;
+            if(commit_bytecode_edits(&editor) == -1) {
+                free_bytecode_editor(&editor);
+                return -1;
+            }
 
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1] = (bytecode_info*)malloc(sizeof(bytecode_info));
-                            if(acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1] == NULL) {
-                                perror("compact_bytecodes");
-                                return -1;
-                            }
+            free_bytecode_editor(&editor);
+        }
+    }
 
+    return 0;
 
-                            /* putfield_<t>_w */
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 2]->opcode = acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode - 4;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 2]->offset = 0;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 2]->nb_byte_args = 0;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 2]->has_ref = 1;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 2]->ref = acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->ref;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 2]->has_branch = 0;
+}
 
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 2] = (bytecode_info*)malloc(sizeof(bytecode_info));
-                            if(acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 2] == NULL) {
-                                perror("compact_bytecodes");
-                                return -1;
-                            }
-
-                            /* swap_x */
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->opcode = 64;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->offset = 0;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->nb_byte_args = 1;
-                            if(acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 2]->opcode == 180)   /* putfield_i_w */
-                                acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->args[0] = 0x12;
-                            else
-                                acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->args[0] = 0x11;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->has_ref = 0;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->ref = NULL;
-
-                            /* aload_0 */
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3 + 1]->has_branch = 0;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode = 24;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->nb_args = 0;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->has_ref = 0;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->ref = NULL;
-
-                            ++u2Index3;
-                        }
-                        break;
-
-                    case 177:       /* putfield_a_w */
-                    case 178:       /* putfield_b_w */
-                    case 179:       /* putfield_s_w */
-                    case 180:       /* putfield_i_w */
-                        if(acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->ref->my_index < 256) {
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->opcode -= 42;
-                            acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->nb_args = 1;
-                        }
-                        break;
 
-                }
+/* The cost of a switch form is its size in byte plus an estimate of the
+   cycles its dispatch takes, a cycle being roughly the cost of a simple
+   bytecode. */
+#define SWITCH_TABLE_CYCLES     4   /**< Bound checks and indexed branch. */
+#define SWITCH_LOOKUP_CYCLES    2   /**< Lookup setup, plus one per case. */
+#define SWITCH_CHAIN_CYCLES     3   /**< Load, push and compare per case. */
+#define SWITCH_MAX_CHAIN_CASES  2   /**< Larger switches are never unrolled. */
 
-                ++u2Index3;
 
-            }
+/**
+ * Sort switch cases by increasing match value.
+ */
+static int compare_switch_cases(const void* case1, const void* case2) {
+
+    int32_t match1 = ((const ilookupswitch_pair_info*)case1)->match;
+    int32_t match2 = ((const ilookupswitch_pair_info*)case2)->match;
+
+    return (match1 > match2) - (match1 < match2);
+
+}
+
+
+/**
+ * Get the sorted cases of a switch which do not branch to its default
+ * target, whatever its form.
+ */
+static int get_switch_cases(bytecode_info* bytecode, bytecode_info** default_branch, ilookupswitch_pair_info** cases, u2* cases_count) {
+
+    switch_info* data = bytecode->switch_data;
+    u2 nb_cases = 0;
+    u2 u2Index = 0;
+
+    switch(bytecode->opcode) {
+        case 115:   /* stableswitch */
+            *default_branch = data->stableswitch.default_branch;
+            nb_cases = data->stableswitch.nb_cases;
+            break;
+
+        case 116:   /* itableswitch */
+            *default_branch = data->itableswitch.default_branch;
+            nb_cases = data->itableswitch.nb_cases;
+            break;
+
+        case 117:   /* slookupswitch */
+            *default_branch = data->slookupswitch.default_branch;
+            nb_cases = data->slookupswitch.nb_cases;
+            break;
+
+        default:    /* ilookupswitch */
+            *default_branch = data->ilookupswitch.default_branch;
+            nb_cases = data->ilookupswitch.nb_cases;
+    }
+
+    *cases_count = 0;
+    *cases = (ilookupswitch_pair_info*)malloc(sizeof(ilookupswitch_pair_info) * (nb_cases + 1));
+    if(*cases == NULL) {
+        perror("get_switch_cases");
+        return -1;
+    }
+
+    for(; u2Index < nb_cases; ++u2Index) {
+        ilookupswitch_pair_info crt_case;
+
+        if(bytecode->opcode == 115) {
+            crt_case.match = data->stableswitch.low + u2Index;
+            crt_case.branch = data->stableswitch.branches[u2Index];
+        } else if(bytecode->opcode == 116) {
+            crt_case.match = data->itableswitch.low + u2Index;
+            crt_case.branch = data->itableswitch.branches[u2Index];
+        } else if(bytecode->opcode == 117) {
+            crt_case.match = data->slookupswitch.cases[u2Index].match;
+            crt_case.branch = data->slookupswitch.cases[u2Index].branch;
+        } else {
+            crt_case = data->ilookupswitch.cases[u2Index];
         }
+
+        if(crt_case.branch != *default_branch)
+            (*cases)[(*cases_count)++] = crt_case;
     }
 
+    qsort(*cases, *cases_count, sizeof(ilookupswitch_pair_info), compare_switch_cases);
+
     return 0;
 
 }
 
 
 /**
- * Compute bytecodes offsets with respect to each opcode number of arguments.
+ * Free the arguments of a switch.
  */
-static void compute_bytecodes_offsets(analyzed_cap_file* acf) {
+static void free_switch_data(bytecode_info* bytecode) {
+
+    switch(bytecode->opcode) {
+        case 115:   /* stableswitch */
+            free(bytecode->switch_data->stableswitch.branches);
+            break;
+
+        case 116:   /* itableswitch */
+            free(bytecode->switch_data->itableswitch.branches);
+            break;
+
+        case 117:   /* slookupswitch */
+            free(bytecode->switch_data->slookupswitch.cases);
+            break;
+
+        default:    /* ilookupswitch */
+            free(bytecode->switch_data->ilookupswitch.cases);
+    }
+
+}
+
+
+/**
+ * Encode a switch as a tableswitch with the given sorted cases, at least
+ * one.
+ */
+static int set_table_switch(bytecode_info* bytecode, char is_int, bytecode_info* default_branch, ilookupswitch_pair_info* cases, u2 cases_count) {
+
+    u2 nb_cases = cases[cases_count - 1].match - cases[0].match + 1;
+    u2 u2Index = 0;
+    bytecode_info** branches = (bytecode_info**)malloc(sizeof(bytecode_info*) * nb_cases);
+    if(branches == NULL) {
+        perror("set_table_switch");
+        return -1;
+    }
+
+    for(; u2Index < nb_cases; ++u2Index)
+        branches[u2Index] = default_branch;
+
+    for(u2Index = 0; u2Index < cases_count; ++u2Index)
+        branches[cases[u2Index].match - cases[0].match] = cases[u2Index].branch;
+
+    free_switch_data(bytecode);
+
+    if(is_int) {
+        bytecode->opcode = 116;     /* itableswitch */
+        bytecode->switch_data->itableswitch.default_branch = default_branch;
+        bytecode->switch_data->itableswitch.nb_cases = nb_cases;
+        bytecode->switch_data->itableswitch.low = cases[0].match;
+        bytecode->switch_data->itableswitch.high = cases[cases_count - 1].match;
+        bytecode->switch_data->itableswitch.branches = branches;
+    } else {
+        bytecode->opcode = 115;     /* stableswitch */
+        bytecode->switch_data->stableswitch.default_branch = default_branch;
+        bytecode->switch_data->stableswitch.nb_cases = nb_cases;
+        bytecode->switch_data->stableswitch.low = cases[0].match;
+        bytecode->switch_data->stableswitch.high = cases[cases_count - 1].match;
+        bytecode->switch_data->stableswitch.branches = branches;
+    }
+
+    bytecode->nb_args = opcodes[bytecode->opcode].nb_args + (nb_cases * 2);
+
+    return 0;
+
+}
+
+
+/**
+ * Encode a switch as a lookupswitch with the given sorted cases.
+ */
+static int set_lookup_switch(bytecode_info* bytecode, char is_int, bytecode_info* default_branch, ilookupswitch_pair_info* cases, u2 cases_count) {
+
+    u2 u2Index = 0;
+
+    if(is_int) {
+        ilookupswitch_pair_info* new_cases = (ilookupswitch_pair_info*)malloc(sizeof(ilookupswitch_pair_info) * (cases_count + 1));
+        if(new_cases == NULL) {
+            perror("set_lookup_switch");
+            return -1;
+        }
+
+        for(; u2Index < cases_count; ++u2Index)
+            new_cases[u2Index] = cases[u2Index];
+
+        free_switch_data(bytecode);
+        bytecode->opcode = 118;     /* ilookupswitch */
+        bytecode->switch_data->ilookupswitch.default_branch = default_branch;
+        bytecode->switch_data->ilookupswitch.nb_cases = cases_count;
+        bytecode->switch_data->ilookupswitch.cases = new_cases;
+        bytecode->nb_args = opcodes[118].nb_args + (cases_count * 6);
+    } else {
+        slookupswitch_pair_info* new_cases = (slookupswitch_pair_info*)malloc(sizeof(slookupswitch_pair_info) * (cases_count + 1));
+        if(new_cases == NULL) {
+            perror("set_lookup_switch");
+            return -1;
+        }
+
+        for(; u2Index < cases_count; ++u2Index) {
+            new_cases[u2Index].match = cases[u2Index].match;
+            new_cases[u2Index].branch = cases[u2Index].branch;
+        }
+
+        free_switch_data(bytecode);
+        bytecode->opcode = 117;     /* slookupswitch */
+        bytecode->switch_data->slookupswitch.default_branch = default_branch;
+        bytecode->switch_data->slookupswitch.nb_cases = cases_count;
+        bytecode->switch_data->slookupswitch.cases = new_cases;
+        bytecode->nb_args = opcodes[117].nb_args + (cases_count * 4);
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Fill a bytecode without reference nor switch arguments.
+ */
+static void set_chain_bytecode(bytecode_info* bytecode, u1 opcode, bytecode_info* branch) {
+
+    memset(bytecode, 0, sizeof(bytecode_info));
+
+    bytecode->opcode = opcode;
+    bytecode->nb_args = opcodes[opcode].nb_args;
+    if(opcodes[opcode].format == OPCODE_FORMAT_BYTES)
+        bytecode->nb_byte_args = opcodes[opcode].nb_args;
+    bytecode->has_branch = (branch != NULL);
+    bytecode->branch = branch;
+
+}
+
+
+/**
+ * Fill a bytecode with the shortest push of a constant.
+ */
+static void set_chain_push(bytecode_info* bytecode, int32_t value, char is_int) {
+
+    if((value >= -1) && (value <= 5)) {
+        set_chain_bytecode(bytecode, (is_int ? 10 : 3) + value, NULL);  /* iconst_<n>, sconst_<n> */
+    } else if((value >= -128) && (value <= 127)) {
+        set_chain_bytecode(bytecode, is_int ? 18 : 16, NULL);           /* bipush, bspush */
+        bytecode->args[0] = value & 0xFF;
+    } else if((value >= -32768) && (value <= 32767)) {
+        set_chain_bytecode(bytecode, is_int ? 19 : 17, NULL);           /* sipush, sspush */
+        bytecode->args[0] = (value >> 8) & 0xFF;
+        bytecode->args[1] = value & 0xFF;
+    } else {
+        set_chain_bytecode(bytecode, 20, NULL);                         /* iipush */
+        bytecode->args[0] = (value >> 24) & 0xFF;
+        bytecode->args[1] = (value >> 16) & 0xFF;
+        bytecode->args[2] = (value >> 8) & 0xFF;
+        bytecode->args[3] = value & 0xFF;
+    }
+
+}
+
+
+/**
+ * Build the comparisons replacing a switch with at most
+ * SWITCH_MAX_CHAIN_CASES cases. The switched value is kept in the given
+ * local variable if there is more than one case. Return the number of
+ * bytecodes built.
+ */
+static u1 build_switch_chain(bytecode_info* chain, char is_int, bytecode_info* default_branch, ilookupswitch_pair_info* cases, u2 cases_count, u1 local, bytecode_info* next) {
+
+    u1 count = 0;
+    u2 u2Index = 0;
+
+    if(cases_count == 0)
+        set_chain_bytecode(chain + count++, is_int ? 60 : 59, NULL);    /* pop2, pop */
+
+    if((cases_count > 1) && (local <= 3)) {
+        set_chain_bytecode(chain + count++, (is_int ? 51 : 47) + local, NULL);   /* istore_<n>, sstore_<n> */
+    } else if(cases_count > 1) {
+        set_chain_bytecode(chain + count, is_int ? 42 : 41, NULL);      /* istore, sstore */
+        chain[count++].args[0] = local;
+    }
+
+    for(; u2Index < cases_count; ++u2Index) {
+        if((cases_count > 1) && (local <= 3)) {
+            set_chain_bytecode(chain + count++, (is_int ? 32 : 28) + local, NULL);   /* iload_<n>, sload_<n> */
+        } else if(cases_count > 1) {
+            set_chain_bytecode(chain + count, is_int ? 23 : 22, NULL);  /* iload, sload */
+            chain[count++].args[0] = local;
+        }
+
+        if(is_int) {
+            set_chain_push(chain + count++, cases[u2Index].match, 1);
+            set_chain_bytecode(chain + count++, 95, NULL);              /* icmp */
+            set_chain_bytecode(chain + count++, 96, cases[u2Index].branch);     /* ifeq */
+        } else if(cases[u2Index].match == 0) {
+            set_chain_bytecode(chain + count++, 96, cases[u2Index].branch);     /* ifeq */
+        } else {
+            set_chain_push(chain + count++, cases[u2Index].match, 0);
+            set_chain_bytecode(chain + count++, 106, cases[u2Index].branch);    /* if_scmpeq */
+        }
+    }
+
+    if(default_branch != next)
+        set_chain_bytecode(chain + count++, 112, default_branch);       /* goto */
+
+    return count;
+
+}
+
+
+/**
+ * Give the switch at the given index its cheapest form among tableswitch,
+ * lookupswitch and, for one or two cases, a chain of comparisons. Return -1
+ * if an error occurred, else the number of bytecodes added after it.
+ */
+static int lower_switch(method_info* method, u2 index, generate_report* report) {
+
+    bytecode_info* bytecode = method->bytecodes[index];
+    bytecode_info* next = (index + 1 < method->bytecodes_count) ? method->bytecodes[index + 1] : NULL;
+    bytecode_info* default_branch = NULL;
+    bytecode_info chain[10];
+    ilookupswitch_pair_info* cases = NULL;
+    char is_int = (opcodes[bytecode->opcode].flags & OPCODE_INT) != 0;
+    u1 old_opcode = bytecode->opcode;
+    u4 old_size = bytecode->nb_args + 1;
+    u4 table_cost = 0xFFFFFFFF;
+    u4 lookup_cost = 0;
+    u4 chain_cost = 0xFFFFFFFF;
+    u2 cases_count = 0;
+    u2 u2Index = 0;
+    u1 chain_count = 0;
+    u1 local = 0;
+    int rc = 0;
+
+    if(get_switch_cases(bytecode, &default_branch, &cases, &cases_count) == -1)
+        return -1;
+
+    if((cases_count != 0) && (((int64_t)cases[cases_count - 1].match - cases[0].match) < 0x7FFF))
+        table_cost = opcodes[is_int ? 116 : 115].nb_args + 1 + ((cases[cases_count - 1].match - cases[0].match + 1) * 2) + SWITCH_TABLE_CYCLES;
+
+    lookup_cost = opcodes[is_int ? 118 : 117].nb_args + 1 + (cases_count * (is_int ? 6 : 4)) + SWITCH_LOOKUP_CYCLES + cases_count;
+
+    if(cases_count <= SWITCH_MAX_CHAIN_CASES) {
+        if(compute_method_frame(method) == -1) {
+            free(cases);
+            return -1;
+        }
+
+        if((method->nargs + method->max_locals + (is_int ? 2 : 1)) <= 255) {
+            local = method->nargs + method->max_locals;
+            chain_count = build_switch_chain(chain, is_int, default_branch, cases, cases_count, local, next);
+
+            chain_cost = SWITCH_CHAIN_CYCLES * cases_count;
+            for(; u2Index < chain_count; ++u2Index)
+                chain_cost += chain[u2Index].nb_args + 1;
+        }
+    }
+
+    if((chain_cost < table_cost) && (chain_cost < lookup_cost)) {
+        if(insert_bytecodes(method, index, chain_count - 1) == -1) {
+            free(cases);
+            return -1;
+        }
+
+        /* The switch itself becomes the first bytecode of the chain so
+           branches and exception handlers referring to it are kept. */
+        free_switch_data(bytecode);
+        free(bytecode->switch_data);
+        for(u2Index = 0; u2Index < chain_count; ++u2Index)
+            *method->bytecodes[index + u2Index] = chain[u2Index];
+
+        if(report != NULL)
+            ++report->unrolled_switches;
+
+        free(cases);
+        return chain_count - 1;
+    }
+
+    if(table_cost <= lookup_cost)
+        rc = set_table_switch(bytecode, is_int, default_branch, cases, cases_count);
+    else
+        rc = set_lookup_switch(bytecode, is_int, default_branch, cases, cases_count);
+
+    if((rc != -1) && ((bytecode->opcode != old_opcode) || ((u4)(bytecode->nb_args + 1) != old_size))) {
+        method->needs_layout = 1;
+        if(report != NULL)
+            ++report->reencoded_switches;
+    }
+
+    free(cases);
+
+    return rc;
+
+}
+
+
+/**
+ * Lower every switch of the analyzed CAP file.
+ */
+static int lower_switches(analyzed_cap_file* acf, generate_report* report) {
 
     u2 u2Index1 = 0;
-    u2 crt_info_offset = 1 + (acf->exception_handlers_count * 8);
 
     for(; u2Index1 < acf->classes_count; ++u2Index1) {
         u2 u2Index2 = 0;
 
         for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            method_info* method = acf->classes[u2Index1]->methods[u2Index2];
             u2 u2Index3 = 0;
-            u2 crt_offset = 0;
 
-            if(acf->classes[u2Index1]->methods[u2Index2]->flags & METHOD_EXTENDED)
-                crt_info_offset += 4;
-            else
-                crt_info_offset += 2;
+            for(; u2Index3 < method->bytecodes_count; ++u2Index3) {
+                int added = 0;
 
-            for(; u2Index3 < acf->classes[u2Index1]->methods[u2Index2]->bytecodes_count; ++u2Index3) {
-                acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->offset = crt_offset;
-                acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->info_offset = crt_info_offset;
-                crt_offset += acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->nb_args + 1;
-                crt_info_offset += acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->nb_args + 1;
+                if((method->bytecodes[u2Index3]->opcode < 115) || (method->bytecodes[u2Index3]->opcode > 118))
+                    continue;
+
+                if((added = lower_switch(method, u2Index3, report)) == -1)
+                    return -1;
+
+                u2Index3 += added;
+            }
+        }
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Give each branch of a method the shortest form whose offset fits. Branches
+ * start short and are widened until every offset fits: widening a branch can
+ * only make other offsets larger so this reaches a fixpoint.
+ */
+static int relax_method_branches(method_info* method, generate_report* report) {
+
+    u1* was_wide = NULL;
+    u2 u2Index = 0;
+    char changed = 1;
+
+    if(method->bytecodes_count == 0)
+        return 0;
+
+    was_wide = (u1*)malloc(sizeof(u1) * method->bytecodes_count);
+    if(was_wide == NULL) {
+        perror("relax_method_branches");
+        return -1;
+    }
+
+    for(; u2Index < method->bytecodes_count; ++u2Index) {
+        bytecode_info* bytecode = method->bytecodes[u2Index];
+        const opcode_info* opcode = &opcodes[bytecode->opcode];
+
+        was_wide[u2Index] = 0;
+
+        if((opcode->format != OPCODE_FORMAT_BRANCH) || (opcode->counterpart == bytecode->opcode) || (bytecode->branch == NULL))
+            continue;
+
+        if(opcode->branch_width == 2) {
+            was_wide[u2Index] = 1;
+            bytecode->opcode = opcode->counterpart;
+            bytecode->nb_args = opcodes[opcode->counterpart].nb_args;
+        }
+    }
+
+    while(changed) {
+        u2 crt_offset = 0;
+
+        changed = 0;
+
+        for(u2Index = 0; u2Index < method->bytecodes_count; ++u2Index) {
+            method->bytecodes[u2Index]->offset = crt_offset;
+            crt_offset += method->bytecodes[u2Index]->nb_args + 1;
+        }
+
+        for(u2Index = 0; u2Index < method->bytecodes_count; ++u2Index) {
+            bytecode_info* bytecode = method->bytecodes[u2Index];
+            const opcode_info* opcode = &opcodes[bytecode->opcode];
+            int branch = 0;
+
+            if((opcode->format != OPCODE_FORMAT_BRANCH) || (opcode->branch_width != 1) || (bytecode->branch == NULL))
+                continue;
+
+            branch = (int)bytecode->branch->offset - (int)bytecode->offset;
+            if((branch < -128) || (branch > 127)) {
+                bytecode->opcode = opcode->counterpart;
+                bytecode->nb_args = opcodes[opcode->counterpart].nb_args;
+                changed = 1;
             }
         }
     }
 
+    if(report != NULL)
+        for(u2Index = 0; u2Index < method->bytecodes_count; ++u2Index) {
+            const opcode_info* opcode = &opcodes[method->bytecodes[u2Index]->opcode];
+
+            if((opcode->format != OPCODE_FORMAT_BRANCH) || (opcode->counterpart == method->bytecodes[u2Index]->opcode) || (method->bytecodes[u2Index]->branch == NULL))
+                continue;
+
+            if(was_wide[u2Index] && (opcode->branch_width == 1))
+                ++report->narrowed_branches;
+            else if(!was_wide[u2Index] && (opcode->branch_width == 2))
+                ++report->widened_branches;
+        }
+
+    free(was_wide);
+
+    return 0;
+
 }
 
 
 /**
- * Compute the bytecode size in byte for each methods of the analyzed CAP file.
+ * Relax the branches of every method of the analyzed CAP file, or only of
+ * the methods needing a layout if incremental.
  */
-static void compute_bytecodes_sizes(analyzed_cap_file* acf) {
+static int relax_branches(analyzed_cap_file* acf, char incremental, generate_report* report) {
 
     u2 u2Index1 = 0;
 
@@ -717,177 +1135,255 @@ static void compute_bytecodes_sizes(analyzed_cap_file* acf) {
         u2 u2Index2 = 0;
 
         for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
-            u2 u2Index3 = 0;
-            u2 crt_bytecodes_size = 0;
-
-            for(; u2Index3 < acf->classes[u2Index1]->methods[u2Index2]->bytecodes_count; ++u2Index3) {
-                crt_bytecodes_size += (1 + acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->nb_args);
-            }
+            if(incremental && !acf->classes[u2Index1]->methods[u2Index2]->needs_layout)
+                continue;
 
-            acf->classes[u2Index1]->methods[u2Index2]->bytecodes_size = crt_bytecodes_size;
+            if(relax_method_branches(acf->classes[u2Index1]->methods[u2Index2], report) == -1)
+                return -1;
         }
     }
 
+    return 0;
+
 }
 
 
 /**
- * Generate bytecodes given the analyzed bytecodes.
+ * Compute max_stack, nargs and max_locals of every method, or only of the
+ * methods needing a layout if incremental. An unchanged method calling an
+ * interface method found nowhere keeps its analyzed frame.
  */
-static u1* generate_bytecodes(bytecode_info** bytecodes, u2 bytecodes_count, u2 bytecodes_size) {
+static int compute_generated_frames(analyzed_cap_file* acf, char incremental) {
 
-    u2 u2Index = 0;
-    u2 crt_bytecode = 0;
-    u1* new_bytecodes = (u1*)malloc(sizeof(u1) * bytecodes_size);
-    if(new_bytecodes == NULL) {
-        perror("generate_method_component");
-        return NULL;
-    }
+    u2 u2Index1 = 0;
 
-    for(; u2Index < bytecodes_count; ++u2Index) {
-        if(bytecodes[u2Index]->opcode == 115) {         /* stableswitch */
-            u2 crt_case = 0;
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
 
-            new_bytecodes[crt_bytecode] = 115;
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            method_info* method = acf->classes[u2Index1]->methods[u2Index2];
 
-            new_bytecodes[crt_bytecode + 1] = ((int16_t)(bytecodes[u2Index]->stableswitch.default_branch->offset - bytecodes[u2Index]->offset)) >> 8;
-            new_bytecodes[crt_bytecode + 2] = ((int16_t)(bytecodes[u2Index]->stableswitch.default_branch->offset - bytecodes[u2Index]->offset)) & 0xFF;
+            if(!method->needs_layout && (incremental || !has_known_stack_effects(method)))
+                continue;
 
-            new_bytecodes[crt_bytecode + 3] = bytecodes[u2Index]->stableswitch.low >> 8;
-            new_bytecodes[crt_bytecode + 4] = bytecodes[u2Index]->stableswitch.low & 0xFF;
+            if(compute_method_frame(method) == -1)
+                return -1;
+        }
+    }
 
-            new_bytecodes[crt_bytecode + 5] = bytecodes[u2Index]->stableswitch.high >> 8;
-            new_bytecodes[crt_bytecode + 6] = bytecodes[u2Index]->stableswitch.high & 0xFF;
+    return 0;
+
+}
 
-            crt_bytecode += 7;
 
-            for(; crt_case < bytecodes[u2Index]->stableswitch.nb_cases; ++crt_case) {
-                new_bytecodes[crt_bytecode + (crt_case * 2)] = ((int16_t)(bytecodes[u2Index]->stableswitch.branches[crt_case]->offset - bytecodes[u2Index]->offset)) >> 8;
-                new_bytecodes[crt_bytecode + (crt_case * 2) + 1] = ((int16_t)(bytecodes[u2Index]->stableswitch.branches[crt_case]->offset - bytecodes[u2Index]->offset)) & 0xFF;
-            }
+/**
+ * Compute bytecodes offsets with respect to each opcode number of arguments.
+ * If incremental, the bytecodes of a method not needing a layout keep their
+ * offset within the method and their info offset is only shifted by however
+ * much the method moved within the Method component.
+ */
+static void compute_bytecodes_offsets(analyzed_cap_file* acf, char incremental) {
 
-            crt_bytecode += (bytecodes[u2Index]->stableswitch.nb_cases * 2);
-        } else if(bytecodes[u2Index]->opcode == 116) {  /* itableswitch */
-            u2 crt_case = 0;
+    u2 u2Index1 = 0;
+    u2 crt_info_offset = 1 + (acf->exception_handlers_count * 8);
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            method_info* method = acf->classes[u2Index1]->methods[u2Index2];
+            u2 u2Index3 = 0;
+            u2 crt_offset = 0;
 
-            new_bytecodes[crt_bytecode] = 116;
+            if(method->flags & METHOD_EXTENDED)
+                crt_info_offset += 4;
+            else
+                crt_info_offset += 2;
 
-            new_bytecodes[crt_bytecode + 1] = ((int16_t)(bytecodes[u2Index]->itableswitch.default_branch->offset - bytecodes[u2Index]->offset)) >> 8;
-            new_bytecodes[crt_bytecode + 2] = ((int16_t)(bytecodes[u2Index]->itableswitch.default_branch->offset - bytecodes[u2Index]->offset)) & 0xFF;
+            if(incremental && !method->needs_layout) {
+                u2 delta = 0;
 
-            new_bytecodes[crt_bytecode + 3] = bytecodes[u2Index]->itableswitch.low >> 24;
-            new_bytecodes[crt_bytecode + 4] = bytecodes[u2Index]->itableswitch.low >> 16;
-            new_bytecodes[crt_bytecode + 5] = bytecodes[u2Index]->itableswitch.low >> 8;
-            new_bytecodes[crt_bytecode + 6] = bytecodes[u2Index]->itableswitch.low & 0xFF;
+                if(method->bytecodes_count == 0)
+                    continue;
 
-            new_bytecodes[crt_bytecode + 7] = bytecodes[u2Index]->itableswitch.high >> 24;
-            new_bytecodes[crt_bytecode + 8] = bytecodes[u2Index]->itableswitch.high >> 16;
-            new_bytecodes[crt_bytecode + 9] = bytecodes[u2Index]->itableswitch.high >> 8;
-            new_bytecodes[crt_bytecode + 10] = bytecodes[u2Index]->itableswitch.high & 0xFF;
+                /* Unsigned arithmetic wraps so moving backward works too. */
+                delta = crt_info_offset - method->bytecodes[0]->info_offset;
+                if(delta != 0)
+                    for(; u2Index3 < method->bytecodes_count; ++u2Index3)
+                        method->bytecodes[u2Index3]->info_offset += delta;
 
-            crt_bytecode += 11;
+                crt_info_offset += method->bytecodes_size;
+                continue;
+            }
 
-            for(; crt_case < bytecodes[u2Index]->itableswitch.nb_cases; ++crt_case) {
-                new_bytecodes[crt_bytecode + (crt_case * 2)] = ((int16_t)(bytecodes[u2Index]->itableswitch.branches[crt_case]->offset - bytecodes[u2Index]->offset)) >> 8;
-                new_bytecodes[crt_bytecode + (crt_case * 2) + 1] = ((int16_t)(bytecodes[u2Index]->itableswitch.branches[crt_case]->offset - bytecodes[u2Index]->offset)) & 0xFF;
+            for(; u2Index3 < method->bytecodes_count; ++u2Index3) {
+                method->bytecodes[u2Index3]->offset = crt_offset;
+                method->bytecodes[u2Index3]->info_offset = crt_info_offset;
+                crt_offset += method->bytecodes[u2Index3]->nb_args + 1;
+                crt_info_offset += method->bytecodes[u2Index3]->nb_args + 1;
             }
+        }
+    }
 
-            crt_bytecode += (bytecodes[u2Index]->itableswitch.nb_cases * 2);
-        } else if(bytecodes[u2Index]->opcode == 117) {  /* slookupswitch */
-            u2 crt_case = 0;
+}
 
-            new_bytecodes[crt_bytecode] = 117;
 
-            new_bytecodes[crt_bytecode + 1] = ((int16_t)(bytecodes[u2Index]->slookupswitch.default_branch->offset - bytecodes[u2Index]->offset)) >> 8;
-            new_bytecodes[crt_bytecode + 2] = ((int16_t)(bytecodes[u2Index]->slookupswitch.default_branch->offset - bytecodes[u2Index]->offset)) & 0xFF;
+/**
+ * Compute the bytecode size in byte for each methods of the analyzed CAP file,
+ * or only of the methods needing a layout if incremental.
+ */
+static void compute_bytecodes_sizes(analyzed_cap_file* acf, char incremental) {
 
-            new_bytecodes[crt_bytecode + 3] = bytecodes[u2Index]->slookupswitch.nb_cases >> 8;
-            new_bytecodes[crt_bytecode + 4] = bytecodes[u2Index]->slookupswitch.nb_cases & 0xFF;
+    u2 u2Index1 = 0;
 
-            crt_bytecode += 5;
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
 
-            for(; crt_case < bytecodes[u2Index]->slookupswitch.nb_cases; ++crt_case) {
-                new_bytecodes[crt_bytecode + (crt_case * 4)] = bytecodes[u2Index]->slookupswitch.cases[crt_case].match >> 8;
-                new_bytecodes[crt_bytecode + (crt_case * 4) + 1] = bytecodes[u2Index]->slookupswitch.cases[crt_case].match & 0xFF;
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2) {
+            u2 u2Index3 = 0;
+            u2 crt_bytecodes_size = 0;
 
-                new_bytecodes[crt_bytecode + (crt_case * 4) + 2] = ((int16_t)(bytecodes[u2Index]->slookupswitch.cases[crt_case].branch->offset - bytecodes[u2Index]->offset)) >> 8;
-                new_bytecodes[crt_bytecode + (crt_case * 4) + 3] = ((int16_t)(bytecodes[u2Index]->slookupswitch.cases[crt_case].branch->offset - bytecodes[u2Index]->offset)) & 0xFF;
+            if(incremental && !acf->classes[u2Index1]->methods[u2Index2]->needs_layout)
+                continue;
+
+            for(; u2Index3 < acf->classes[u2Index1]->methods[u2Index2]->bytecodes_count; ++u2Index3) {
+                crt_bytecodes_size += (1 + acf->classes[u2Index1]->methods[u2Index2]->bytecodes[u2Index3]->nb_args);
             }
 
-            crt_bytecode += (bytecodes[u2Index]->slookupswitch.nb_cases * 4);
-        } else if(bytecodes[u2Index]->opcode == 118) {  /* ilookupswitch */
-            u2 crt_case = 0;
+            acf->classes[u2Index1]->methods[u2Index2]->bytecodes_size = crt_bytecodes_size;
+            /* Offsets and size are now up to date. */
+            acf->classes[u2Index1]->methods[u2Index2]->needs_layout = 0;
+        }
+    }
+
+}
 
-            new_bytecodes[crt_bytecode] = 118;
 
-            new_bytecodes[crt_bytecode + 1] = ((int16_t)(bytecodes[u2Index]->ilookupswitch.default_branch->offset - bytecodes[u2Index]->offset)) >> 8;
-            new_bytecodes[crt_bytecode + 2] = ((int16_t)(bytecodes[u2Index]->ilookupswitch.default_branch->offset - bytecodes[u2Index]->offset)) & 0xFF;
+/**
+ * Write the relative offset to the given branch target on two bytes.
+ */
+static void write_branch(u1* buffer, bytecode_info* bytecode, bytecode_info* target) {
 
-            new_bytecodes[crt_bytecode + 3] = bytecodes[u2Index]->ilookupswitch.nb_cases >> 8;
-            new_bytecodes[crt_bytecode + 4] = bytecodes[u2Index]->ilookupswitch.nb_cases & 0xFF;
+    int16_t branch = (int16_t)(target->offset - bytecode->offset);
 
-            crt_bytecode += 5;
+    buffer[0] = (branch >> 8) & 0xFF;
+    buffer[1] = branch & 0xFF;
 
-            for(; crt_case < bytecodes[u2Index]->ilookupswitch.nb_cases; ++crt_case) {
-                new_bytecodes[crt_bytecode + (crt_case * 4)] = bytecodes[u2Index]->ilookupswitch.cases[crt_case].match >> 24;
-                new_bytecodes[crt_bytecode + (crt_case * 4) + 1] = bytecodes[u2Index]->ilookupswitch.cases[crt_case].match >> 16;
-                new_bytecodes[crt_bytecode + (crt_case * 4) + 2] = bytecodes[u2Index]->ilookupswitch.cases[crt_case].match >> 8;
-                new_bytecodes[crt_bytecode + (crt_case * 4) + 3] = bytecodes[u2Index]->ilookupswitch.cases[crt_case].match & 0xFF;
+}
 
-                new_bytecodes[crt_bytecode + (crt_case * 4) + 2] = ((int16_t)(bytecodes[u2Index]->ilookupswitch.cases[crt_case].branch->offset - bytecodes[u2Index]->offset)) >> 8;
-                new_bytecodes[crt_bytecode + (crt_case * 4) + 3] = ((int16_t)(bytecodes[u2Index]->ilookupswitch.cases[crt_case].branch->offset - bytecodes[u2Index]->offset)) & 0xFF;
-            }
 
-            crt_bytecode += (bytecodes[u2Index]->ilookupswitch.nb_cases * 6);
-        } else if(bytecodes[u2Index]->nb_args) {    /* Have at least one arg */
-            new_bytecodes[crt_bytecode] = bytecodes[u2Index]->opcode;
-            ++crt_bytecode;
-            if(bytecodes[u2Index]->has_branch) {    /* If there is a branch, it makes use of all the args */
-                if(bytecodes[u2Index]->nb_args == 1) {
-                    new_bytecodes[crt_bytecode] = ((char)(bytecodes[u2Index]->branch->offset - bytecodes[u2Index]->offset));
-                    ++crt_bytecode;
+/**
+ * Generate bytecodes given the analyzed bytecodes.
+ */
+static u1* generate_bytecodes(bytecode_info** bytecodes, u2 bytecodes_count, u2 bytecodes_size) {
+
+    u2 u2Index = 0;
+    u2 crt_bytecode = 0;
+    u1* new_bytecodes = (u1*)malloc(sizeof(u1) * bytecodes_size);
+    if(new_bytecodes == NULL) {
+        perror("generate_method_component");
+        return NULL;
+    }
+
+    for(; u2Index < bytecodes_count; ++u2Index) {
+        bytecode_info* bytecode = bytecodes[u2Index];
+        u1* buffer = new_bytecodes + crt_bytecode;
+        u2 crt_case = 0;
+
+        buffer[0] = bytecode->opcode;
+
+        switch(opcodes[bytecode->opcode].format) {
+            case OPCODE_FORMAT_BRANCH:
+                if(opcodes[bytecode->opcode].branch_width == 1)
+                    buffer[1] = (int8_t)(bytecode->branch->offset - bytecode->offset);
+                else
+                    write_branch(buffer + 1, bytecode, bytecode->branch);
+                break;
+
+            case OPCODE_FORMAT_REF:
+                if(opcodes[bytecode->opcode].ref_width == 1) {
+                    buffer[1] = bytecode->ref->my_index & 0xFF;
                 } else {
-                    new_bytecodes[crt_bytecode] = ((int16_t)(bytecodes[u2Index]->branch->offset - bytecodes[u2Index]->offset)) >> 8;
-                    new_bytecodes[crt_bytecode + 1] = ((int16_t)(bytecodes[u2Index]->branch->offset - bytecodes[u2Index]->offset)) & 0xFF;
-                    crt_bytecode += 2;
+                    buffer[1] = bytecode->ref->my_index >> 8;
+                    buffer[2] = bytecode->ref->my_index & 0xFF;
                 }
-            } else if(bytecodes[u2Index]->has_ref) {    /* If there is a ref */
-                if(bytecodes[u2Index]->nb_args == 1) {
-                    new_bytecodes[crt_bytecode] = bytecodes[u2Index]->ref->my_index & 0xFF;
-                    ++crt_bytecode;
-                } else if(bytecodes[u2Index]->nb_args == 2) {
-                    new_bytecodes[crt_bytecode] = bytecodes[u2Index]->ref->my_index >> 8;
-                    new_bytecodes[crt_bytecode + 1] = bytecodes[u2Index]->ref->my_index & 0xFF;
-                    crt_bytecode += 2;
-                } else if(bytecodes[u2Index]->nb_args == 3) {   /* checkcast & instanceof */
-                    new_bytecodes[crt_bytecode] = bytecodes[u2Index]->args[0];
-                    if(bytecodes[u2Index]->has_ref) {
-                        new_bytecodes[crt_bytecode + 1] = bytecodes[u2Index]->ref->my_index >> 8;
-                        new_bytecodes[crt_bytecode + 2] = bytecodes[u2Index]->ref->my_index & 0xFF;
-                    } else {
-                        new_bytecodes[crt_bytecode + 1] = bytecodes[u2Index]->args[1];
-                        new_bytecodes[crt_bytecode + 2] = bytecodes[u2Index]->args[2];
-                    }
-                    crt_bytecode += 3;
+                break;
+
+            case OPCODE_FORMAT_TYPE_REF:    /* checkcast & instanceof */
+                buffer[1] = bytecode->args[0];
+                if(bytecode->has_ref) {
+                    buffer[2] = bytecode->ref->my_index >> 8;
+                    buffer[3] = bytecode->ref->my_index & 0xFF;
                 } else {
-                    new_bytecodes[crt_bytecode] = bytecodes[u2Index]->args[0];
-                    new_bytecodes[crt_bytecode + 1] = bytecodes[u2Index]->ref->my_index >> 8;
-                    new_bytecodes[crt_bytecode + 2] = bytecodes[u2Index]->ref->my_index & 0xFF;
-                    new_bytecodes[crt_bytecode + 3] = bytecodes[u2Index]->args[1];
-                    crt_bytecode += 4;
+                    buffer[2] = bytecode->args[1];
+                    buffer[3] = bytecode->args[2];
                 }
-            } else {    /* It's only byte args */
-                u1 crt_arg = 0;
-
-                for(; crt_arg < bytecodes[u2Index]->nb_byte_args; ++crt_arg)
-                    new_bytecodes[crt_bytecode + crt_arg] = bytecodes[u2Index]->args[crt_arg];
+                break;
+
+            case OPCODE_FORMAT_INVOKEINTERFACE:
+                buffer[1] = bytecode->args[0];
+                buffer[2] = bytecode->ref->my_index >> 8;
+                buffer[3] = bytecode->ref->my_index & 0xFF;
+                buffer[4] = bytecode->args[1];
+                break;
+
+            case OPCODE_FORMAT_STABLESWITCH:
+                write_branch(buffer + 1, bytecode, bytecode->switch_data->stableswitch.default_branch);
+                buffer[3] = bytecode->switch_data->stableswitch.low >> 8;
+                buffer[4] = bytecode->switch_data->stableswitch.low & 0xFF;
+                buffer[5] = bytecode->switch_data->stableswitch.high >> 8;
+                buffer[6] = bytecode->switch_data->stableswitch.high & 0xFF;
+
+                for(; crt_case < bytecode->switch_data->stableswitch.nb_cases; ++crt_case)
+                    write_branch(buffer + 7 + (crt_case * 2), bytecode, bytecode->switch_data->stableswitch.branches[crt_case]);
+                break;
+
+            case OPCODE_FORMAT_ITABLESWITCH:
+                write_branch(buffer + 1, bytecode, bytecode->switch_data->itableswitch.default_branch);
+                buffer[3] = bytecode->switch_data->itableswitch.low >> 24;
+                buffer[4] = bytecode->switch_data->itableswitch.low >> 16;
+                buffer[5] = bytecode->switch_data->itableswitch.low >> 8;
+                buffer[6] = bytecode->switch_data->itableswitch.low & 0xFF;
+                buffer[7] = bytecode->switch_data->itableswitch.high >> 24;
+                buffer[8] = bytecode->switch_data->itableswitch.high >> 16;
+                buffer[9] = bytecode->switch_data->itableswitch.high >> 8;
+                buffer[10] = bytecode->switch_data->itableswitch.high & 0xFF;
+
+                for(; crt_case < bytecode->switch_data->itableswitch.nb_cases; ++crt_case)
+                    write_branch(buffer + 11 + (crt_case * 2), bytecode, bytecode->switch_data->itableswitch.branches[crt_case]);
+                break;
+
+            case OPCODE_FORMAT_SLOOKUPSWITCH:
+                write_branch(buffer + 1, bytecode, bytecode->switch_data->slookupswitch.default_branch);
+                buffer[3] = bytecode->switch_data->slookupswitch.nb_cases >> 8;
+                buffer[4] = bytecode->switch_data->slookupswitch.nb_cases & 0xFF;
+
+                for(; crt_case < bytecode->switch_data->slookupswitch.nb_cases; ++crt_case) {
+                    buffer[5 + (crt_case * 4)] = bytecode->switch_data->slookupswitch.cases[crt_case].match >> 8;
+                    buffer[5 + (crt_case * 4) + 1] = bytecode->switch_data->slookupswitch.cases[crt_case].match & 0xFF;
+                    write_branch(buffer + 5 + (crt_case * 4) + 2, bytecode, bytecode->switch_data->slookupswitch.cases[crt_case].branch);
+                }
+                break;
+
+            case OPCODE_FORMAT_ILOOKUPSWITCH:
+                write_branch(buffer + 1, bytecode, bytecode->switch_data->ilookupswitch.default_branch);
+                buffer[3] = bytecode->switch_data->ilookupswitch.nb_cases >> 8;
+                buffer[4] = bytecode->switch_data->ilookupswitch.nb_cases & 0xFF;
+
+                for(; crt_case < bytecode->switch_data->ilookupswitch.nb_cases; ++crt_case) {
+                    buffer[5 + (crt_case * 6)] = bytecode->switch_data->ilookupswitch.cases[crt_case].match >> 24;
+                    buffer[5 + (crt_case * 6) + 1] = bytecode->switch_data->ilookupswitch.cases[crt_case].match >> 16;
+                    buffer[5 + (crt_case * 6) + 2] = bytecode->switch_data->ilookupswitch.cases[crt_case].match >> 8;
+                    buffer[5 + (crt_case * 6) + 3] = bytecode->switch_data->ilookupswitch.cases[crt_case].match & 0xFF;
+                    write_branch(buffer + 5 + (crt_case * 6) + 4, bytecode, bytecode->switch_data->ilookupswitch.cases[crt_case].branch);
+                }
+                break;
 
-                crt_bytecode += bytecodes[u2Index]->nb_byte_args;
-            }
-        } else {    /* There is no arg */
-            new_bytecodes[crt_bytecode] = bytecodes[u2Index]->opcode;
-            ++crt_bytecode;
+            default:    /* Only byte args if any */
+                memcpy(buffer + 1, bytecode->args, bytecode->nb_byte_args);
         }
+
+        crt_bytecode += bytecode->nb_args + 1;
     }
 
     return new_bytecodes;
@@ -1418,7 +1914,7 @@ static int generate_class_component(analyzed_cap_file* acf, cap_file* new) {
     new->class.signature_pool = NULL;        
 
     new->class.interfaces_count = acf->interfaces_count;
-    new->class.interfaces = (cf_interface_info*)malloc(sizeof(cf_interface_info) * new->class.interfaces_count);
+    new->class.interfaces = (cf_interface_info*)calloc(new->class.interfaces_count, sizeof(cf_interface_info));
     if(new->class.interfaces == NULL) {
         perror("generate_class_component");
         return -1;
@@ -1458,7 +1954,7 @@ static int generate_class_component(analyzed_cap_file* acf, cap_file* new) {
     }
 
     new->class.classes_count = acf->classes_count;
-    new->class.classes = (cf_class_info*)malloc(sizeof(cf_class_info) * new->class.classes_count);
+    new->class.classes = (cf_class_info*)calloc(new->class.classes_count, sizeof(cf_class_info));
     if(new->class.classes == NULL) {
         perror("generate_class_component");
         return -1;
@@ -2006,7 +2502,11 @@ static void count_type_descriptor_references(analyzed_cap_file* acf) {
 
     u2 u2Index1 = 0;
 
-    for(; u2Index1 < acf->constant_pool_count; ++u2Index1)
+    /* The counts of a previous generation are started over. */
+    for(; u2Index1 < acf->signature_pool_count; ++u2Index1)
+        acf->signature_pool[u2Index1]->count = 0;
+
+    for(u2Index1 = 0; u2Index1 < acf->constant_pool_count; ++u2Index1)
         if(!(acf->constant_pool[u2Index1]->flags & CONSTANT_POOL_CLASSREF) && acf->constant_pool[u2Index1]->count != 0)
             ++acf->constant_pool[u2Index1]->type->count;
 
@@ -2225,7 +2725,7 @@ static int generate_descriptor_component(analyzed_cap_file* acf, cap_file* new)
     new->descriptor.size += crt_offset;
 
     new->descriptor.class_count = acf->classes_count + acf->interfaces_count;
-    new->descriptor.classes = (cf_class_descriptor_info*)malloc(sizeof(cf_class_descriptor_info) * new->descriptor.class_count);
+    new->descriptor.classes = (cf_class_descriptor_info*)calloc(new->descriptor.class_count, sizeof(cf_class_descriptor_info));
     if(new->descriptor.classes == NULL) {
         perror("generate_descriptor_component");
         return -1;
@@ -2572,90 +3072,318 @@ static int generate_manifest(analyzed_cap_file* acf, cap_file* new) {
 }
 
 
+/**
+ * Give the components of the generated CAP file which are copied from the CAP
+ * file the analyzed one comes from instead of being generated. Changing the
+ * imports, the bytecodes, the classes, the static fields, the constant pool or
+ * the descriptors moves tokens, offsets and indexes found in most other
+ * components and any change may change a size recorded in the Directory
+ * component.
+ */
+static u2 get_copied_components(analyzed_cap_file* acf, u1 flags) {
+
+    u2 linked = COMPONENT_BIT(COMPONENT_IMPORT)|COMPONENT_BIT(COMPONENT_CONSTANTPOOL)|COMPONENT_BIT(COMPONENT_CLASS)|COMPONENT_BIT(COMPONENT_METHOD)|COMPONENT_BIT(COMPONENT_STATICFIELD)|COMPONENT_BIT(COMPONENT_DESCRIPTOR);
+    u2 dirty = acf->dirty_components;
+    u2 u2Index1 = 0;
+
+    if(!(flags & GENERATE_COPY_UNCHANGED) || (acf->source == NULL))
+        return 0;
+
+    /* Editing bytecodes only sets needs_layout of the method. */
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2)
+            if(acf->classes[u2Index1]->methods[u2Index2]->needs_layout)
+                dirty |= COMPONENT_BIT(COMPONENT_METHOD);
+    }
+
+    if(flags & GENERATE_SORT_CONSTANT_POOL)
+        dirty |= COMPONENT_BIT(COMPONENT_CONSTANTPOOL);
+
+    if(flags & GENERATE_LOWER_SWITCHES)
+        dirty |= COMPONENT_BIT(COMPONENT_METHOD);
+
+    if(dirty & linked)
+        dirty |= linked|COMPONENT_BIT(COMPONENT_MANIFEST)|COMPONENT_BIT(COMPONENT_HEADER)|COMPONENT_BIT(COMPONENT_APPLET)|COMPONENT_BIT(COMPONENT_REFERENCELOCATION)|COMPONENT_BIT(COMPONENT_EXPORT);
+
+    if(dirty != 0)
+        dirty |= COMPONENT_BIT(COMPONENT_DIRECTORY)|COMPONENT_BIT(COMPONENT_DEBUG);
+
+    return ALL_COMPONENTS & ~dirty;
+
+}
+
+
+/**
+ * Give a component copied from the source CAP file the tag and size the
+ * Directory component of the source gives it, a tag of 0 if it is absent.
+ */
+static void set_copied_component(analyzed_cap_file* acf, cap_file* new, u1 tag) {
+
+    u2 size = acf->source_directory.component_sizes[tag - 1];
+    u1 present_tag = (size != 0) ? tag : 0;
+
+    switch(tag) {
+        case COMPONENT_HEADER:
+            new->header.tag = present_tag;
+            new->header.size = size;
+            break;
+        case COMPONENT_DIRECTORY:
+            new->directory.tag = present_tag;
+            new->directory.size = size;
+            break;
+        case COMPONENT_APPLET:
+            new->applet.tag = present_tag;
+            new->applet.size = size;
+            break;
+        case COMPONENT_IMPORT:
+            new->import.tag = present_tag;
+            new->import.size = size;
+            break;
+        case COMPONENT_CONSTANTPOOL:
+            new->constant_pool.tag = present_tag;
+            new->constant_pool.size = size;
+            break;
+        case COMPONENT_CLASS:
+            new->class.tag = present_tag;
+            new->class.size = size;
+            break;
+        case COMPONENT_METHOD:
+            new->method.tag = present_tag;
+            new->method.size = size;
+            break;
+        case COMPONENT_STATICFIELD:
+            new->static_field.tag = present_tag;
+            new->static_field.size = size;
+            break;
+        case COMPONENT_REFERENCELOCATION:
+            new->reference_location.tag = present_tag;
+            new->reference_location.size = size;
+            break;
+        case COMPONENT_EXPORT:
+            new->export.tag = present_tag;
+            new->export.size = size;
+            break;
+        case COMPONENT_DESCRIPTOR:
+            new->descriptor.tag = present_tag;
+            new->descriptor.size = size;
+            break;
+        case COMPONENT_DEBUG:
+            new->debug.tag = present_tag;
+            new->debug.size = size;
+            break;
+    }
+
+}
+
+
 /**
  * Generate from the analyzed CAP file a cap_file structure and return it.
  */
 cap_file* generate_cap_file(analyzed_cap_file* acf) {
 
-    cap_file* new = (cap_file*)malloc(sizeof(cap_file));
+    return generate_cap_file_with_flags(acf, 0, NULL);
+
+}
+
+
+/**
+ * Generate from the analyzed CAP file a cap_file structure and return it. The
+ * flags select optional optimizations and the report, if any, is filled.
+ */
+cap_file* generate_cap_file_with_flags(analyzed_cap_file* acf, u1 flags, generate_report* report) {
+
+    generate_report local_report;
+    u2 copied = get_copied_components(acf, flags);
+    cap_file* new = (cap_file*)calloc(1, sizeof(cap_file));
     if(new == NULL) {
         perror("generate_cap_file");
         return NULL;
     }
 
-    new->path = acf->info.path;
     new->path = (char*)malloc(strlen(acf->info.path) + 1);
     if(new->path == NULL) {
         perror("generate_cap_file");
+        free_cap_file(new);
         return NULL;
     }
     strcpy(new->path, acf->info.path);
 
-    if(generate_header_component(acf, new) == -1)
+    /* The Header component is generated even when it is copied since the
+       Applet and Directory components depend on it. */
+    if(generate_header_component(acf, new) == -1) {
+        free_cap_file(new);
         return NULL;
+    }
+
+    if(copied & COMPONENT_BIT(COMPONENT_HEADER))
+        set_copied_component(acf, new, COMPONENT_HEADER);
 
     /* We compute the count to know which constant pool entries will remain. */
     count_constant_pool_references(acf);
     /* From the remaining constant pool entries, we determine the remaining imported packages. */
     count_imported_package(acf);
-    if(generate_import_component(acf, new) == -1)
+    if(copied & COMPONENT_BIT(COMPONENT_IMPORT))
+        set_copied_component(acf, new, COMPONENT_IMPORT);
+    else if(generate_import_component(acf, new) == -1) {
+        free_cap_file(new);
         return NULL;
+    }
 
-    /* We generate the constant pool entry indexes used by bytecodes. */
-    update_constant_pool_entry_index(acf);
+    /* The report tells what was changed in the bytecodes. */
+    if(report == NULL)
+        report = &local_report;
 
-    /* If constant pool entry indexes are smaller or bigger in width than before,
-       we compact or expend bytecodes. */
-    if(compact_bytecodes(acf) == -1)
-        return NULL;
+    report->narrowed_branches = 0;
+    report->widened_branches = 0;
+    report->reencoded_switches = 0;
+    report->unrolled_switches = 0;
 
-    /* We compute offsets */
-    compute_bytecodes_offsets(acf);
-    /* TODO A second pass for compacting or expending bytecode should be done since offset might be smaller or bigger than before (i.e. ifeq should become a ifeq_w). */
-    compute_bytecodes_sizes(acf);
-    sort_exception_handlers(acf);
+    /* The constant pool and the bytecodes of copied components keep the
+       indexes and the forms they have in the source. */
+    if(copied & COMPONENT_BIT(COMPONENT_CONSTANTPOOL)) {
+        set_copied_component(acf, new, COMPONENT_CONSTANTPOOL);
+    } else {
+        /* We generate the constant pool entry indexes used by bytecodes. */
+        if(update_constant_pool_entry_index(acf, flags & GENERATE_SORT_CONSTANT_POOL) == -1) {
+            free_cap_file(new);
+            return NULL;
+        }
 
-    if(generate_method_component(acf, new) == -1)
-        return NULL;
+        /* If constant pool entry indexes are smaller or bigger in width than before,
+           we compact or expend bytecodes. */
+        if(compact_bytecodes(acf) == -1) {
+            free_cap_file(new);
+            return NULL;
+        }
+    }
+
+    if(copied & COMPONENT_BIT(COMPONENT_METHOD)) {
+        set_copied_component(acf, new, COMPONENT_METHOD);
+    } else {
+        /* Switches get their cheapest form before branches are relaxed since
+           unrolled switches add branches. */
+        if((flags & GENERATE_LOWER_SWITCHES) && (lower_switches(acf, report) == -1)) {
+            free_cap_file(new);
+            return NULL;
+        }
+
+        /* Since bytecodes might be smaller or bigger than before, branches get the
+           shortest form their offset fits in (i.e. ifeq might become ifeq_w). */
+        if(relax_branches(acf, flags & GENERATE_INCREMENTAL_LAYOUT, report) == -1) {
+            free_cap_file(new);
+            return NULL;
+        }
+
+        /* Bytecodes might have been changed without the analyzed frame
+           following so max_stack, nargs and max_locals are computed again,
+           giving their exact minima. Since the method header might become
+           extended or not, it is done before computing offsets. */
+        if(compute_generated_frames(acf, flags & GENERATE_INCREMENTAL_LAYOUT) == -1) {
+            free_cap_file(new);
+            return NULL;
+        }
+
+        /* We compute offsets */
+        compute_bytecodes_offsets(acf, flags & GENERATE_INCREMENTAL_LAYOUT);
+        compute_bytecodes_sizes(acf, flags & GENERATE_INCREMENTAL_LAYOUT);
+        sort_exception_handlers(acf);
+
+        if(generate_method_component(acf, new) == -1) {
+            free_cap_file(new);
+            return NULL;
+        }
+    }
 
     /* Compute token for everything. */
     compute_tokens(acf);
 
-    if(generate_class_component(acf, new) == -1)
+    if(copied & COMPONENT_BIT(COMPONENT_CLASS))
+        set_copied_component(acf, new, COMPONENT_CLASS);
+    else if(generate_class_component(acf, new) == -1) {
+        free_cap_file(new);
         return NULL;
+    }
 
-    if(generate_static_field_component(acf, new) == -1)
+    if(copied & COMPONENT_BIT(COMPONENT_STATICFIELD))
+        set_copied_component(acf, new, COMPONENT_STATICFIELD);
+    else if(generate_static_field_component(acf, new) == -1) {
+        free_cap_file(new);
         return NULL;
+    }
 
-    if(generate_reference_location_component(acf, new) == -1)
+    if(copied & COMPONENT_BIT(COMPONENT_REFERENCELOCATION))
+        set_copied_component(acf, new, COMPONENT_REFERENCELOCATION);
+    else if(generate_reference_location_component(acf, new) == -1) {
+        free_cap_file(new);
         return NULL;
+    }
 
-    if(generate_constant_pool_component(acf, new) == -1)
+    if(!(copied & COMPONENT_BIT(COMPONENT_CONSTANTPOOL)) && (generate_constant_pool_component(acf, new) == -1)) {
+        free_cap_file(new);
         return NULL;
+    }
 
-    if(generate_export_component(acf, new) == -1)
+    if(copied & COMPONENT_BIT(COMPONENT_EXPORT))
+        set_copied_component(acf, new, COMPONENT_EXPORT);
+    else if(generate_export_component(acf, new) == -1) {
+        free_cap_file(new);
         return NULL;
+    }
 
-    if(generate_applet_component(acf, new) == -1)
+    if(copied & COMPONENT_BIT(COMPONENT_APPLET))
+        set_copied_component(acf, new, COMPONENT_APPLET);
+    else if(generate_applet_component(acf, new) == -1) {
+        free_cap_file(new);
         return NULL;
+    }
 
-    /* From the remaining constant pool entries and other descriptor dependency,
-       we sort out the remaining type descriptors. */
-    count_type_descriptor_references(acf);
+    if(copied & COMPONENT_BIT(COMPONENT_DESCRIPTOR)) {
+        set_copied_component(acf, new, COMPONENT_DESCRIPTOR);
+    } else {
+        /* From the remaining constant pool entries and other descriptor dependency,
+           we sort out the remaining type descriptors. */
+        count_type_descriptor_references(acf);
 
-    if(generate_descriptor_component(acf, new) == -1)
-        return NULL;
+        if(generate_descriptor_component(acf, new) == -1) {
+            free_cap_file(new);
+            return NULL;
+        }
+    }
 
     /* Since we have all the component sizes and such, we can generate the directory component. */
-    if(generate_directory_component(acf, new) == -1)
+    if(copied & COMPONENT_BIT(COMPONENT_DIRECTORY))
+        set_copied_component(acf, new, COMPONENT_DIRECTORY);
+    else if(generate_directory_component(acf, new, copied) == -1) {
+        free_cap_file(new);
         return NULL;
+    }
 
-    if(generate_manifest(acf, new) == -1)
+    if(!(copied & COMPONENT_BIT(COMPONENT_MANIFEST)) && (generate_manifest(acf, new) == -1)) {
+        free_cap_file(new);
         return NULL;
+    }
 
-    /* We don't support the debug component. */
-    new->debug.tag = 0;
-    new->debug.size = 0;
+    /* We don't support the debug component but the source one still describes
+       an unchanged CAP file. */
+    if(copied & COMPONENT_BIT(COMPONENT_DEBUG)) {
+        set_copied_component(acf, new, COMPONENT_DEBUG);
+    } else {
+        new->debug.tag = 0;
+        new->debug.size = 0;
+    }
+
+    if(acf->source != NULL) {
+        new->source = (char*)malloc(strlen(acf->source) + 1);
+        if(new->source == NULL) {
+            perror("generate_cap_file");
+            free_cap_file(new);
+            return NULL;
+        }
+        strcpy(new->source, acf->source);
+    }
+    new->source_components = copied;
 
     /* TODO custom components */
 
@@ -0,0 +1,1594 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file cap_file_index.c
+ * \brief An on-disk inverted index of the external names used by a corpus of
+ * CAP files.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "analyzed_cap_file.h"
+#include "byte_buffer.h"
+#include "cap_file_analyze.h"
+#include "cap_file_cache.h"
+#include "cap_file_index.h"
+#include "cap_file_reader.h"
+#include "file_batch.h"
+
+#define INDEX_MAGIC         0x41434649  /**< "ACFI" */
+#define INDEX_VERSION       1
+#define INDEX_HEADER_SIZE   14
+#define INDEX_POSTING_SIZE  10
+#define INDEX_NO_KEY        0xFFFFFFFF
+#define FNV_OFFSET_BASIS    0xCBF29CE484222325ULL
+#define FNV_PRIME           0x00000100000001B3ULL
+
+
+/**
+ * \brief A document being built from an analyzed CAP file.
+ */
+typedef struct {
+    cap_file_index_document* document;  /**< The document being built. */
+    u4 keys_capacity;                   /**< The number of keys allocated. */
+    u4 usages_capacity;                 /**< The number of usages allocated. */
+    u4 buckets_count;                   /**< A power of two. */
+    u4* buckets;                        /**< Index of a key plus one, 0 for an
+                                             empty bucket. */
+    char* name;                         /**< The name being built. */
+    u4 name_length;                     /**< The length of the name. */
+    u4 name_capacity;                   /**< The number of bytes allocated. */
+    int error;                          /**< Set on the first error. */
+} usage_scanner;
+
+/**
+ * \brief What is shared by the workers of an update.
+ */
+typedef struct {
+    cap_file_index* index;              /**< The index being updated. Its
+                                             documents are only read by the
+                                             workers. */
+    const char* cache_directory;        /**< Where analyzed CAP files are
+                                             cached, NULL for no cache. */
+    pthread_mutex_t mutex;              /**< Protects what follows. */
+    u4 documents_count;                 /**< The number of documents found. */
+    u4 documents_capacity;              /**< The number of documents
+                                             allocated. */
+    cap_file_index_document** documents;    /**< The documents found, kept or
+                                                 scanned again. */
+    int error;                          /**< Set if a document could not be
+                                             added. */
+} index_update;
+
+/**
+ * \brief A name of a document while writing the index.
+ */
+typedef struct {
+    const char* key;    /**< The name. */
+    u4 document;        /**< The index of the document. */
+    u4 local;           /**< The index of the name within the document. */
+} key_reference;
+
+
+static uint64_t hash_string(const char* string) {
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    for(; *string != '\0'; ++string) {
+        hash ^= (u1)*string;
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+
+}
+
+
+/**
+ * Move to an offset within the index file.
+ */
+static void seek(byte_reader* reader, u4 offset) {
+
+    if(offset > reader->size)
+        reader->error = 1;
+    else
+        reader->position = offset;
+
+}
+
+
+/**
+ * Move to the record pointed to by an entry of one of the offset tables.
+ */
+static void seek_entry(byte_reader* reader, u4 table, u4 entry) {
+
+    seek(reader, table + entry * 4);
+    seek(reader, get_u4(reader));
+
+}
+
+
+/**
+ * Check the header of a mapped index file and get its counts.
+ */
+static int check_header(byte_reader* reader, const char* path, u4* documents_count, u4* keys_count) {
+
+    u4 magic = get_u4(reader);
+    u2 version = get_u2(reader);
+
+    *documents_count = get_u4(reader);
+    *keys_count = get_u4(reader);
+
+    if(reader->error || (magic != INDEX_MAGIC) || (version != INDEX_VERSION) || ((((uint64_t)*documents_count + *keys_count) * 4) > (reader->size - INDEX_HEADER_SIZE))) {
+        fprintf(stderr, "%s is not an index\n", path);
+        return -1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Get the hash of an export file, 0 if there is none.
+ */
+static uint64_t get_export_file_hash(const cap_file_index* index, export_file* ef) {
+
+    int i = 0;
+
+    if(ef == NULL)
+        return 0;
+
+    for(; i < index->nb_export_files; ++i)
+        if(index->export_files[i] == ef)
+            return index->export_file_hashes[i];
+
+    return hash_export_file(ef);
+
+}
+
+
+static int compare_documents(const void* document1, const void* document2) {
+
+    return strcmp((*(cap_file_index_document* const*)document1)->path, (*(cap_file_index_document* const*)document2)->path);
+
+}
+
+
+static int compare_usages(const void* usage1, const void* usage2) {
+
+    const cap_file_index_usage* first = (const cap_file_index_usage*)usage1;
+    const cap_file_index_usage* second = (const cap_file_index_usage*)usage2;
+
+    if(first->class_index != second->class_index)
+        return (first->class_index < second->class_index) ? -1 : 1;
+
+    if(first->method_index != second->method_index)
+        return (first->method_index < second->method_index) ? -1 : 1;
+
+    return (first->offset > second->offset) - (first->offset < second->offset);
+
+}
+
+
+static int compare_key_references(const void* reference1, const void* reference2) {
+
+    const key_reference* r1 = (const key_reference*)reference1;
+    const key_reference* r2 = (const key_reference*)reference2;
+    int rc = strcmp(r1->key, r2->key);
+
+    if(rc != 0)
+        return rc;
+
+    return (r1->document > r2->document) - (r1->document < r2->document);
+
+}
+
+
+/**
+ * Search the index for the document of a CAP file.
+ */
+static cap_file_index_document* find_document(const cap_file_index* index, const char* path) {
+
+    u4 low = 0;
+    u4 high = index->documents_count;
+
+    while(low < high) {
+        u4 middle = low + (high - low) / 2;
+        int rc = strcmp(index->documents[middle]->path, path);
+
+        if(rc == 0)
+            return index->documents[middle];
+
+        if(rc < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return NULL;
+
+}
+
+
+/**
+ * Record the size, modification time and hash of a CAP file.
+ */
+static int stamp_document(cap_file_index_document* document, const char* path) {
+
+    struct stat st;
+
+    if(stat(path, &st) == -1) {
+        perror(path);
+        return -1;
+    }
+
+    document->size = st.st_size;
+    document->mtime = st.st_mtime;
+
+    return hash_file(path, &(document->hash));
+
+}
+
+
+/**
+ * Check whether a document is still what scanning its CAP file would give.
+ * The modification time to record is stored in mtime.
+ */
+static int is_document_current(const cap_file_index* index, const cap_file_index_document* document, const char* path, int64_t* mtime) {
+
+    struct stat st;
+    u1 u1Index = 0;
+
+    if(stat(path, &st) == -1)
+        return 0;
+
+    if(((uint64_t)st.st_size != document->size) || ((int64_t)st.st_mtime != document->mtime)) {
+        uint64_t hash = 0;
+
+        if(((uint64_t)st.st_size != document->size) || (hash_file(path, &hash) == -1) || (hash != document->hash))
+            return 0;
+    }
+
+    for(; u1Index < document->imports_count; ++u1Index) {
+        const cap_file_index_import* import = document->imports + u1Index;
+        export_file* ef = get_export_file_by_aid(import->aid, import->aid_length, index->export_files, index->nb_export_files);
+
+        if(get_export_file_hash(index, ef) != import->hash)
+            return 0;
+    }
+
+    *mtime = st.st_mtime;
+    return 1;
+
+}
+
+
+/**
+ * Append bytes to the name being built.
+ */
+static void append_name(usage_scanner* scanner, const char* bytes, u4 length) {
+
+    if(scanner->error)
+        return;
+
+    if((scanner->name_capacity - scanner->name_length) <= length) {
+        u4 capacity = scanner->name_capacity ? scanner->name_capacity : 256;
+        char* tmp = NULL;
+
+        while((capacity - scanner->name_length) <= length)
+            capacity *= 2;
+
+        tmp = (char*)realloc(scanner->name, capacity);
+        if(tmp == NULL) {
+            perror("append_name");
+            scanner->error = 1;
+            return;
+        }
+        scanner->name = tmp;
+        scanner->name_capacity = capacity;
+    }
+
+    memcpy(scanner->name + scanner->name_length, bytes, length);
+    scanner->name_length += length;
+    scanner->name[scanner->name_length] = '\0';
+
+}
+
+
+static void append_token(usage_scanner* scanner, u1 token) {
+
+    char buffer[4];
+
+    sprintf(buffer, "%u", token);
+    append_name(scanner, buffer, strlen(buffer));
+
+}
+
+
+/**
+ * Get an UTF-8 constant of an export file or NULL if the index does not
+ * refer to one.
+ */
+static ef_CONSTANT_Utf8_info* get_utf8(export_file* ef, u2 index) {
+
+    if((index >= ef->constant_pool_count) || (ef->constant_pool[index].tag != EF_CONSTANT_UTF8))
+        return NULL;
+
+    return &(ef->constant_pool[index].CONSTANT_Utf8);
+
+}
+
+
+/**
+ * Get the name of a class reference of an export file or NULL if the index
+ * does not refer to one.
+ */
+static ef_CONSTANT_Utf8_info* get_class_name(export_file* ef, u2 index) {
+
+    if((index >= ef->constant_pool_count) || (ef->constant_pool[index].tag != EF_CONSTANT_CLASSREF))
+        return NULL;
+
+    return get_utf8(ef, ef->constant_pool[index].CONSTANT_Classref.name_index);
+
+}
+
+
+static ef_class_info* get_export_class(export_file* ef, u1 token) {
+
+    u1 u1Index = 0;
+
+    for(; u1Index < ef->export_class_count; ++u1Index)
+        if(ef->classes[u1Index].token == token)
+            return ef->classes + u1Index;
+
+    return NULL;
+
+}
+
+
+/**
+ * Get the exported class of the same package named by a class reference of
+ * an export file.
+ */
+static ef_class_info* get_export_class_by_name(export_file* ef, u2 index) {
+
+    ef_CONSTANT_Utf8_info* name = get_class_name(ef, index);
+    u1 u1Index = 0;
+
+    if(name == NULL)
+        return NULL;
+
+    for(; u1Index < ef->export_class_count; ++u1Index) {
+        ef_CONSTANT_Utf8_info* other = get_class_name(ef, ef->classes[u1Index].name_index);
+
+        if((other != NULL) && (other->length == name->length) && (memcmp(other->bytes, name->bytes, name->length) == 0))
+            return ef->classes + u1Index;
+    }
+
+    return NULL;
+
+}
+
+
+/**
+ * Search an exported class for a method given its token. Constructors share
+ * the tokens of static methods. Virtual methods are also searched for in the
+ * superclasses of the same package.
+ */
+static ef_method_info* get_export_method(export_file* ef, ef_class_info* class, u1 token, int is_static) {
+
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < class->export_methods_count; ++u2Index1) {
+        ef_method_info* method = class->methods + u2Index1;
+        ef_CONSTANT_Utf8_info* name = get_utf8(ef, method->name_index);
+        int is_method_static = (method->access_flags & EF_ACC_STATIC) || ((name != NULL) && (name->length == 6) && (memcmp(name->bytes, "<init>", 6) == 0));
+
+        if((method->token == token) && (is_method_static == is_static))
+            return method;
+    }
+
+    if(is_static)
+        return NULL;
+
+    for(u2Index1 = 0; u2Index1 < class->export_supers_count; ++u2Index1) {
+        ef_class_info* super = get_export_class_by_name(ef, class->supers[u2Index1]);
+        u2 u2Index2 = 0;
+
+        if(super == NULL)
+            continue;
+
+        for(; u2Index2 < super->export_methods_count; ++u2Index2)
+            if((super->methods[u2Index2].token == token) && !(super->methods[u2Index2].access_flags & EF_ACC_STATIC))
+                return super->methods + u2Index2;
+    }
+
+    return NULL;
+
+}
+
+
+/**
+ * Search an exported class for a field given its token. Instance fields are
+ * also searched for in the superclasses of the same package.
+ */
+static ef_field_info* get_export_field(export_file* ef, ef_class_info* class, u1 token, int is_static) {
+
+    u2 u2Index1 = 0;
+
+    for(; u2Index1 < class->export_fields_count; ++u2Index1)
+        if((class->fields[u2Index1].token == token) && (((class->fields[u2Index1].access_flags & EF_ACC_STATIC) != 0) == is_static))
+            return class->fields + u2Index1;
+
+    if(is_static)
+        return NULL;
+
+    for(u2Index1 = 0; u2Index1 < class->export_supers_count; ++u2Index1) {
+        ef_class_info* super = get_export_class_by_name(ef, class->supers[u2Index1]);
+        u2 u2Index2 = 0;
+
+        if(super == NULL)
+            continue;
+
+        for(; u2Index2 < super->export_fields_count; ++u2Index2)
+            if((super->fields[u2Index2].token == token) && !(super->fields[u2Index2].access_flags & EF_ACC_STATIC))
+                return super->fields + u2Index2;
+    }
+
+    return NULL;
+
+}
+
+
+/**
+ * Append the name of an imported package or its AID if it has no export
+ * file.
+ */
+static void append_package_name(usage_scanner* scanner, imported_package_info* package) {
+
+    export_file* ef = package->ef;
+    u1 u1Index = 0;
+
+    if((ef != NULL) && (ef->this_package < ef->constant_pool_count) && (ef->constant_pool[ef->this_package].tag == EF_CONSTANT_PACKAGE)) {
+        ef_CONSTANT_Utf8_info* name = get_utf8(ef, ef->constant_pool[ef->this_package].CONSTANT_Package.name_index);
+
+        if(name != NULL) {
+            append_name(scanner, (const char*)name->bytes, name->length);
+            return;
+        }
+    }
+
+    for(; u1Index < package->aid_length; ++u1Index) {
+        char buffer[3];
+
+        sprintf(buffer, "%02X", package->aid[u1Index]);
+        append_name(scanner, buffer, 2);
+    }
+
+}
+
+
+/**
+ * Append the fully qualified name of an external class or its token if it is
+ * not exported.
+ */
+static void append_class_name(usage_scanner* scanner, imported_package_info* package, ef_class_info* class, u1 token) {
+
+    ef_CONSTANT_Utf8_info* name = (class != NULL) ? get_class_name(package->ef, class->name_index) : NULL;
+
+    if((name != NULL) && (memchr(name->bytes, '/', name->length) != NULL)) {
+        append_name(scanner, (const char*)name->bytes, name->length);
+        return;
+    }
+
+    append_package_name(scanner, package);
+    append_name(scanner, "/", 1);
+
+    if(name != NULL)
+        append_name(scanner, (const char*)name->bytes, name->length);
+    else
+        append_token(scanner, token);
+
+}
+
+
+/**
+ * Build the name used by an external constant pool entry.
+ */
+static void build_ref_name(usage_scanner* scanner, constant_pool_entry_info* ref) {
+
+    imported_package_info* package = ref->external_package;
+    ef_class_info* class = (package->ef != NULL) ? get_export_class(package->ef, ref->external_class_token) : NULL;
+
+    scanner->name_length = 0;
+    append_class_name(scanner, package, class, ref->external_class_token);
+
+    if(ref->flags & (CONSTANT_POOL_INSTANCEFIELDREF|CONSTANT_POOL_STATICFIELDREF)) {
+        ef_field_info* field = (class != NULL) ? get_export_field(package->ef, class, ref->external_field_token, (ref->flags & CONSTANT_POOL_STATICFIELDREF) != 0) : NULL;
+        ef_CONSTANT_Utf8_info* name = (field != NULL) ? get_utf8(package->ef, field->name_index) : NULL;
+
+        append_name(scanner, ".", 1);
+        if(name != NULL)
+            append_name(scanner, (const char*)name->bytes, name->length);
+        else
+            append_token(scanner, ref->external_field_token);
+    } else if(ref->flags & (CONSTANT_POOL_VIRTUALMETHODREF|CONSTANT_POOL_SUPERMETHODREF|CONSTANT_POOL_STATICMETHODREF)) {
+        ef_method_info* method = (class != NULL) ? get_export_method(package->ef, class, ref->method_token, (ref->flags & CONSTANT_POOL_STATICMETHODREF) != 0) : NULL;
+        ef_CONSTANT_Utf8_info* name = (method != NULL) ? get_utf8(package->ef, method->name_index) : NULL;
+        ef_CONSTANT_Utf8_info* descriptor = (method != NULL) ? get_utf8(package->ef, method->descriptor_index) : NULL;
+
+        append_name(scanner, ".", 1);
+        if((name != NULL) && (descriptor != NULL)) {
+            append_name(scanner, (const char*)name->bytes, name->length);
+            append_name(scanner, (const char*)descriptor->bytes, descriptor->length);
+        } else {
+            append_token(scanner, ref->method_token);
+            append_name(scanner, "()", 2);
+        }
+    }
+
+}
+
+
+/**
+ * Get the index of the name being built within the keys of the document,
+ * adding it if needed.
+ */
+static u4 intern_name(usage_scanner* scanner) {
+
+    cap_file_index_document* document = scanner->document;
+    u4 bucket = 0;
+
+    if(scanner->name_length > 0xFFFF) {
+        fprintf(stderr, "Name too long in %s\n", document->path);
+        scanner->error = 1;
+        return INDEX_NO_KEY;
+    }
+
+    if((document->keys_count + 1) * 2 > scanner->buckets_count) {
+        u4 buckets_count = scanner->buckets_count ? scanner->buckets_count * 2 : 64;
+        u4* buckets = (u4*)calloc(buckets_count, sizeof(u4));
+        u4 u4Index = 0;
+
+        if(buckets == NULL) {
+            perror("intern_name");
+            scanner->error = 1;
+            return INDEX_NO_KEY;
+        }
+
+        for(; u4Index < document->keys_count; ++u4Index) {
+            bucket = hash_string(document->keys[u4Index]) & (buckets_count - 1);
+            while(buckets[bucket] != 0)
+                bucket = (bucket + 1) & (buckets_count - 1);
+            buckets[bucket] = u4Index + 1;
+        }
+
+        free(scanner->buckets);
+        scanner->buckets = buckets;
+        scanner->buckets_count = buckets_count;
+    }
+
+    bucket = hash_string(scanner->name) & (scanner->buckets_count - 1);
+    while(scanner->buckets[bucket] != 0) {
+        if(strcmp(document->keys[scanner->buckets[bucket] - 1], scanner->name) == 0)
+            return scanner->buckets[bucket] - 1;
+        bucket = (bucket + 1) & (scanner->buckets_count - 1);
+    }
+
+    if(document->keys_count == scanner->keys_capacity) {
+        u4 capacity = scanner->keys_capacity ? scanner->keys_capacity * 2 : 32;
+        char** tmp = (char**)realloc(document->keys, sizeof(char*) * capacity);
+
+        if(tmp == NULL) {
+            perror("intern_name");
+            scanner->error = 1;
+            return INDEX_NO_KEY;
+        }
+        document->keys = tmp;
+        scanner->keys_capacity = capacity;
+    }
+
+    if((document->keys[document->keys_count] = (char*)malloc(scanner->name_length + 1)) == NULL) {
+        perror("intern_name");
+        scanner->error = 1;
+        return INDEX_NO_KEY;
+    }
+
+    memcpy(document->keys[document->keys_count], scanner->name, scanner->name_length + 1);
+    scanner->buckets[bucket] = document->keys_count + 1;
+    return document->keys_count++;
+
+}
+
+
+/**
+ * Record the usage of an external constant pool entry.
+ */
+static void add_usage(usage_scanner* scanner, constant_pool_entry_info* ref, u2 class_index, u2 method_index, u2 offset) {
+
+    cap_file_index_document* document = scanner->document;
+    cap_file_index_usage* usage = NULL;
+    u4 key = 0;
+
+    if(scanner->error || !(ref->flags & CONSTANT_POOL_IS_EXTERNAL) || (ref->external_package == NULL))
+        return;
+
+    build_ref_name(scanner, ref);
+    if(scanner->error || ((key = intern_name(scanner)) == INDEX_NO_KEY))
+        return;
+
+    if(document->usages_count == scanner->usages_capacity) {
+        u4 capacity = scanner->usages_capacity ? scanner->usages_capacity * 2 : 64;
+        cap_file_index_usage* tmp = (cap_file_index_usage*)realloc(document->usages, sizeof(cap_file_index_usage) * capacity);
+
+        if(tmp == NULL) {
+            perror("add_usage");
+            scanner->error = 1;
+            return;
+        }
+        document->usages = tmp;
+        scanner->usages_capacity = capacity;
+    }
+
+    usage = document->usages + document->usages_count++;
+    usage->key = key;
+    usage->class_index = class_index;
+    usage->method_index = method_index;
+    usage->offset = offset;
+
+}
+
+
+/**
+ * Record the usages of a method, its bytecodes first and then the caught
+ * classes at the start of their handler.
+ */
+static void scan_method(usage_scanner* scanner, method_info* method, u2 class_index, u2 method_index) {
+
+    u2* offsets = NULL;
+    u2 offset = 0;
+    u2 u2Index = 0;
+    u1 u1Index = 0;
+
+    if((method->bytecodes_count == 0) || scanner->error)
+        return;
+
+    /* The offsets of the bytecodes are computed again as the analyzed CAP
+       file may come from the cache. */
+    if((offsets = (u2*)malloc(sizeof(u2) * method->bytecodes_count)) == NULL) {
+        perror("scan_method");
+        scanner->error = 1;
+        return;
+    }
+
+    for(; u2Index < method->bytecodes_count; ++u2Index) {
+        bytecode_info* bytecode = method->bytecodes[u2Index];
+
+        offsets[u2Index] = offset;
+        if(bytecode->has_ref && (bytecode->ref != NULL))
+            add_usage(scanner, bytecode->ref, class_index, method_index, offset);
+        offset += 1 + bytecode->nb_args;
+    }
+
+    for(; u1Index < method->exception_handlers_count; ++u1Index) {
+        exception_handler_info* handler = method->exception_handlers[u1Index];
+
+        if(handler->catch_type == NULL)
+            continue;
+
+        for(u2Index = 0; (u2Index < method->bytecodes_count) && (method->bytecodes[u2Index] != handler->handler); ++u2Index);
+        if(u2Index < method->bytecodes_count)
+            add_usage(scanner, handler->catch_type, class_index, method_index, offsets[u2Index]);
+    }
+
+    free(offsets);
+
+}
+
+
+void free_cap_file_index_document(cap_file_index_document* document) {
+
+    u4 u4Index = 0;
+
+    if(document == NULL)
+        return;
+
+    for(; u4Index < document->keys_count; ++u4Index)
+        free(document->keys[u4Index]);
+
+    free(document->keys);
+    free(document->usages);
+    free(document->imports);
+    free(document->path);
+    free(document);
+
+}
+
+
+cap_file_index_document* scan_cap_file_usages(const cap_file_index* index, analyzed_cap_file* acf, const char* path) {
+
+    usage_scanner scanner;
+    cap_file_index_document* document = NULL;
+    u2 u2Index1 = 0;
+    u1 u1Index = 0;
+
+    if((document = (cap_file_index_document*)calloc(1, sizeof(cap_file_index_document))) == NULL) {
+        perror("scan_cap_file_usages");
+        return NULL;
+    }
+
+    if(((document->path = (char*)malloc(strlen(path) + 1)) == NULL) ||
+       ((acf->imported_packages_count > 0) && ((document->imports = (cap_file_index_import*)malloc(sizeof(cap_file_index_import) * acf->imported_packages_count)) == NULL))) {
+        perror("scan_cap_file_usages");
+        free_cap_file_index_document(document);
+        return NULL;
+    }
+
+    strcpy(document->path, path);
+
+    if(stamp_document(document, path) == -1) {
+        free_cap_file_index_document(document);
+        return NULL;
+    }
+
+    for(; u1Index < acf->imported_packages_count; ++u1Index) {
+        imported_package_info* package = acf->imported_packages[u1Index];
+        cap_file_index_import* import = document->imports + u1Index;
+
+        if(package->aid_length > CAP_FILE_INDEX_MAX_AID_LENGTH) {
+            fprintf(stderr, "Imported package %u of %s has an invalid AID\n", u1Index, path);
+            free_cap_file_index_document(document);
+            return NULL;
+        }
+
+        import->aid_length = package->aid_length;
+        memcpy(import->aid, package->aid, package->aid_length);
+        import->hash = get_export_file_hash(index, package->ef);
+        ++document->imports_count;
+    }
+
+    memset(&scanner, 0, sizeof(usage_scanner));
+    scanner.document = document;
+
+    for(; u2Index1 < acf->classes_count; ++u2Index1) {
+        u2 u2Index2 = 0;
+
+        for(; u2Index2 < acf->classes[u2Index1]->methods_count; ++u2Index2)
+            scan_method(&scanner, acf->classes[u2Index1]->methods[u2Index2], u2Index1, u2Index2);
+    }
+
+    free(scanner.buckets);
+    free(scanner.name);
+
+    if(scanner.error) {
+        free_cap_file_index_document(document);
+        return NULL;
+    }
+
+    return document;
+
+}
+
+
+/**
+ * Read the record of a document from an index file.
+ */
+static cap_file_index_document* read_document(byte_reader* reader) {
+
+    cap_file_index_document* document = NULL;
+    const u1* path = NULL;
+    u2 path_length = get_u2(reader);
+    u1 u1Index = 0;
+
+    if((path = get_bytes(reader, path_length)) == NULL)
+        return NULL;
+
+    if(((document = (cap_file_index_document*)calloc(1, sizeof(cap_file_index_document))) == NULL) ||
+       ((document->path = (char*)malloc(path_length + 1)) == NULL)) {
+        perror("read_document");
+        free(document);
+        return NULL;
+    }
+
+    memcpy(document->path, path, path_length);
+    document->path[path_length] = '\0';
+    document->hash = get_u8(reader);
+    document->size = get_u8(reader);
+    document->mtime = (int64_t)get_u8(reader);
+    document->imports_count = get_u1(reader);
+
+    if((document->imports_count > 0) && ((document->imports = (cap_file_index_import*)malloc(sizeof(cap_file_index_import) * document->imports_count)) == NULL)) {
+        perror("read_document");
+        free_cap_file_index_document(document);
+        return NULL;
+    }
+
+    for(; u1Index < document->imports_count; ++u1Index) {
+        cap_file_index_import* import = document->imports + u1Index;
+        const u1* aid = NULL;
+
+        import->aid_length = get_u1(reader);
+        if((import->aid_length > CAP_FILE_INDEX_MAX_AID_LENGTH) || ((aid = get_bytes(reader, import->aid_length)) == NULL)) {
+            reader->error = 1;
+            break;
+        }
+
+        memcpy(import->aid, aid, import->aid_length);
+        import->hash = get_u8(reader);
+    }
+
+    if(reader->error) {
+        free_cap_file_index_document(document);
+        return NULL;
+    }
+
+    return document;
+
+}
+
+
+/**
+ * Give the documents of an index file their names and usages. The postings
+ * are gone through twice: to count and then to fill.
+ */
+static int read_postings(byte_reader* reader, cap_file_index* index, u4 keys_table, u4 keys_count) {
+
+    u4* last_keys = NULL;
+    u4 pass = 0;
+    u4 u4Index1 = 0;
+    int rc = 0;
+
+    if((index->documents_count > 0) && ((last_keys = (u4*)malloc(sizeof(u4) * index->documents_count)) == NULL)) {
+        perror("read_postings");
+        return -1;
+    }
+
+    for(; (pass < 2) && (rc == 0); ++pass) {
+        for(u4Index1 = 0; u4Index1 < index->documents_count; ++u4Index1) {
+            cap_file_index_document* document = index->documents[u4Index1];
+
+            last_keys[u4Index1] = INDEX_NO_KEY;
+
+            if(pass == 1) {
+                if(((document->keys_count > 0) && ((document->keys = (char**)calloc(document->keys_count, sizeof(char*))) == NULL)) ||
+                   ((document->usages_count > 0) && ((document->usages = (cap_file_index_usage*)malloc(sizeof(cap_file_index_usage) * document->usages_count)) == NULL))) {
+                    perror("read_postings");
+                    rc = -1;
+                    break;
+                }
+
+                /* The counts are set again while filling. */
+                document->keys_count = 0;
+                document->usages_count = 0;
+            }
+        }
+
+        for(u4Index1 = 0; (u4Index1 < keys_count) && (rc == 0); ++u4Index1) {
+            const u1* key = NULL;
+            u2 key_length = 0;
+            u4 postings_count = 0;
+            u4 u4Index2 = 0;
+
+            seek_entry(reader, keys_table, u4Index1);
+            key_length = get_u2(reader);
+            key = get_bytes(reader, key_length);
+            postings_count = get_u4(reader);
+
+            if(reader->error || (postings_count > (reader->size - reader->position) / INDEX_POSTING_SIZE)) {
+                rc = -1;
+                break;
+            }
+
+            for(; u4Index2 < postings_count; ++u4Index2) {
+                u4 document_index = get_u4(reader);
+                cap_file_index_document* document = NULL;
+                cap_file_index_usage* usage = NULL;
+
+                if(document_index >= index->documents_count) {
+                    rc = -1;
+                    break;
+                }
+
+                document = index->documents[document_index];
+
+                if(last_keys[document_index] != u4Index1) {
+                    last_keys[document_index] = u4Index1;
+
+                    if((pass == 1) && ((document->keys[document->keys_count] = (char*)malloc(key_length + 1)) == NULL)) {
+                        perror("read_postings");
+                        rc = -1;
+                        break;
+                    }
+
+                    if(pass == 1) {
+                        memcpy(document->keys[document->keys_count], key, key_length);
+                        document->keys[document->keys_count][key_length] = '\0';
+                    }
+
+                    ++document->keys_count;
+                }
+
+                if(pass == 0) {
+                    reader->position += INDEX_POSTING_SIZE - 4;
+                    ++document->usages_count;
+                    continue;
+                }
+
+                usage = document->usages + document->usages_count++;
+                usage->key = document->keys_count - 1;
+                usage->class_index = get_u2(reader);
+                usage->method_index = get_u2(reader);
+                usage->offset = get_u2(reader);
+            }
+        }
+    }
+
+    free(last_keys);
+
+    if((rc == -1) || reader->error) {
+        /* Only the names which were read can be freed. */
+        for(u4Index1 = 0; u4Index1 < index->documents_count; ++u4Index1)
+            if(index->documents[u4Index1]->keys == NULL)
+                index->documents[u4Index1]->keys_count = 0;
+
+        return -1;
+    }
+
+    for(u4Index1 = 0; u4Index1 < index->documents_count; ++u4Index1)
+        qsort(index->documents[u4Index1]->usages, index->documents[u4Index1]->usages_count, sizeof(cap_file_index_usage), compare_usages);
+
+    return 0;
+
+}
+
+
+cap_file_index* read_cap_file_index(const char* path, export_file** export_files, int nb_export_files) {
+
+    cap_file_index* index = NULL;
+    byte_reader reader;
+    const u1* buffer = NULL;
+    u4 size = 0;
+    u4 keys_count = 0;
+    u4 u4Index = 0;
+    int missing = 0;
+    int i = 0;
+
+    if((index = (cap_file_index*)calloc(1, sizeof(cap_file_index))) == NULL) {
+        perror("read_cap_file_index");
+        return NULL;
+    }
+
+    index->export_files = export_files;
+    index->nb_export_files = nb_export_files;
+
+    if((nb_export_files > 0) && ((index->export_file_hashes = (uint64_t*)malloc(sizeof(uint64_t) * nb_export_files)) == NULL)) {
+        perror("read_cap_file_index");
+        free(index);
+        return NULL;
+    }
+
+    for(; i < nb_export_files; ++i)
+        index->export_file_hashes[i] = hash_export_file(export_files[i]);
+
+    if((buffer = map_file(path, &size, &missing)) == NULL) {
+        if(missing)
+            return index;
+
+        free_cap_file_index(index);
+        return NULL;
+    }
+
+    memset(&reader, 0, sizeof(byte_reader));
+    reader.buffer = buffer;
+    reader.size = size;
+
+    if(check_header(&reader, path, &(index->documents_count), &keys_count) == -1) {
+        index->documents_count = 0;
+        unmap_file(buffer, size);
+        free_cap_file_index(index);
+        return NULL;
+    }
+
+    if((index->documents_count > 0) && ((index->documents = (cap_file_index_document**)calloc(index->documents_count, sizeof(cap_file_index_document*))) == NULL)) {
+        perror("read_cap_file_index");
+        index->documents_count = 0;
+        unmap_file(buffer, size);
+        free_cap_file_index(index);
+        return NULL;
+    }
+
+    for(; u4Index < index->documents_count; ++u4Index) {
+        seek_entry(&reader, INDEX_HEADER_SIZE, u4Index);
+        if((index->documents[u4Index] = read_document(&reader)) == NULL)
+            break;
+    }
+
+    if((u4Index < index->documents_count) || (read_postings(&reader, index, INDEX_HEADER_SIZE + index->documents_count * 4, keys_count) == -1)) {
+        fprintf(stderr, "%s is not a valid index\n", path);
+        unmap_file(buffer, size);
+        free_cap_file_index(index);
+        return NULL;
+    }
+
+    unmap_file(buffer, size);
+    return index;
+
+}
+
+
+void free_cap_file_index(cap_file_index* index) {
+
+    u4 u4Index = 0;
+
+    if(index == NULL)
+        return;
+
+    for(; u4Index < index->documents_count; ++u4Index)
+        free_cap_file_index_document(index->documents[u4Index]);
+
+    free(index->documents);
+    free(index->export_file_hashes);
+    free(index);
+
+}
+
+
+/**
+ * Add a document found by a worker.
+ */
+static void add_document(index_update* update, cap_file_index_document* document) {
+
+    pthread_mutex_lock(&(update->mutex));
+
+    if(update->documents_count == update->documents_capacity) {
+        u4 capacity = update->documents_capacity ? update->documents_capacity * 2 : 64;
+        cap_file_index_document** tmp = (cap_file_index_document**)realloc(update->documents, sizeof(cap_file_index_document*) * capacity);
+
+        if(tmp == NULL) {
+            perror("add_document");
+            update->error = 1;
+            pthread_mutex_unlock(&(update->mutex));
+            return;
+        }
+        update->documents = tmp;
+        update->documents_capacity = capacity;
+    }
+
+    update->documents[update->documents_count++] = document;
+
+    pthread_mutex_unlock(&(update->mutex));
+
+}
+
+
+/**
+ * Keep the document of a CAP file if it is current or else scan the CAP file
+ * again.
+ */
+static int index_one_cap_file(const char* filename, verbose_sink* output, verbose_sink* report, void* data) {
+
+    index_update* update = (index_update*)data;
+    cap_file_index_document* document = find_document(update->index, filename);
+    analyzed_cap_file* acf = NULL;
+    cap_file* cf = NULL;
+    int64_t mtime = 0;
+
+    (void)report;
+
+    if((document != NULL) && is_document_current(update->index, document, filename, &mtime)) {
+        /* Only the worker given this file touches its old document. */
+        document->mtime = mtime;
+        add_document(update, document);
+        return sink_printf(output, "%u usages of %u names, unchanged\n", document->usages_count, document->keys_count) == -1 ? -1 : 0;
+    }
+
+    if(update->cache_directory != NULL)
+        acf = read_and_analyze_cap_file(update->cache_directory, filename, update->index->export_files, update->index->nb_export_files);
+    else if((cf = read_cap_file(filename)) != NULL)
+        acf = analyze_cap_file(cf, update->index->export_files, update->index->nb_export_files);
+
+    free_cap_file(cf);
+
+    if(acf == NULL)
+        return -1;
+
+    document = scan_cap_file_usages(update->index, acf, filename);
+    free_analyzed_cap_file(acf);
+
+    if(document == NULL)
+        return -1;
+
+    add_document(update, document);
+    return sink_printf(output, "%u usages of %u names\n", document->usages_count, document->keys_count) == -1 ? -1 : 0;
+
+}
+
+
+int update_cap_file_index(cap_file_index* index, char* const* filenames, int nb_filenames, int nb_workers, const char* cache_directory, verbose_sink* output, verbose_sink* report) {
+
+    index_update update;
+    u4 documents_count = 0;
+    u4 u4Index = 0;
+    int failed = 0;
+
+    memset(&update, 0, sizeof(index_update));
+    update.index = index;
+    update.cache_directory = cache_directory;
+
+    if(pthread_mutex_init(&(update.mutex), NULL) != 0) {
+        fprintf(stderr, "Could not create the mutex of the index update\n");
+        return -1;
+    }
+
+    failed = process_file_batch(filenames, nb_filenames, nb_workers, index_one_cap_file, &update, output, report);
+    pthread_mutex_destroy(&(update.mutex));
+
+    qsort(update.documents, update.documents_count, sizeof(cap_file_index_document*), compare_documents);
+
+    /* A CAP file given twice is only indexed once. */
+    for(; u4Index < update.documents_count; ++u4Index) {
+        if((documents_count > 0) && (strcmp(update.documents[documents_count - 1]->path, update.documents[u4Index]->path) == 0)) {
+            if((update.documents[u4Index] != update.documents[documents_count - 1]) && (find_document(index, update.documents[u4Index]->path) != update.documents[u4Index]))
+                free_cap_file_index_document(update.documents[u4Index]);
+            continue;
+        }
+
+        update.documents[documents_count++] = update.documents[u4Index];
+    }
+
+    /* The old documents which were not kept are those of CAP files scanned
+       again or no longer in the batch. */
+    for(u4Index = 0; u4Index < index->documents_count; ++u4Index) {
+        u4 low = 0;
+        u4 high = documents_count;
+
+        while(low < high) {
+            u4 middle = low + (high - low) / 2;
+
+            if(strcmp(update.documents[middle]->path, index->documents[u4Index]->path) < 0)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+
+        if((low == documents_count) || (update.documents[low] != index->documents[u4Index]))
+            free_cap_file_index_document(index->documents[u4Index]);
+    }
+
+    free(index->documents);
+    index->documents = update.documents;
+    index->documents_count = documents_count;
+
+    if((failed == -1) || update.error)
+        return -1;
+
+    return failed;
+
+}
+
+
+/**
+ * Write an index file through a temporary file.
+ */
+static int write_index_file(const char* path, const u1* buffer, size_t size) {
+
+    char* tmp_path = (char*)malloc(strlen(path) + 24);
+    FILE* file = NULL;
+
+    if(tmp_path == NULL) {
+        perror("write_index_file");
+        return -1;
+    }
+
+    sprintf(tmp_path, "%s.%ld", path, (long)getpid());
+
+    if((file = fopen(tmp_path, "wb")) == NULL) {
+        perror(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+
+    if(fwrite(buffer, 1, size, file) != size) {
+        fprintf(stderr, "Could not write %s\n", tmp_path);
+        fclose(file);
+        remove(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+
+    if((fclose(file) != 0) || (rename(tmp_path, path) != 0)) {
+        perror(tmp_path);
+        remove(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+
+    free(tmp_path);
+    return 0;
+
+}
+
+
+/**
+ * Give every distinct name of the documents a global index, in bytewise
+ * order. The global index of the name local of document d is
+ * globals[bases[d] + local].
+ */
+static key_reference* number_keys(cap_file_index* index, u4** globals, u4** bases, u4* keys_count) {
+
+    key_reference* references = NULL;
+    size_t references_count = 0;
+    size_t position = 0;
+    u4 u4Index1 = 0;
+
+    for(; u4Index1 < index->documents_count; ++u4Index1)
+        references_count += index->documents[u4Index1]->keys_count;
+
+    if(references_count >= INDEX_NO_KEY) {
+        fprintf(stderr, "Too many names for an index\n");
+        return NULL;
+    }
+
+    references = (key_reference*)malloc(sizeof(key_reference) * (references_count + 1));
+    *globals = (u4*)malloc(sizeof(u4) * (references_count + 1));
+    *bases = (u4*)malloc(sizeof(u4) * (index->documents_count + 1));
+
+    if((references == NULL) || (*globals == NULL) || (*bases == NULL)) {
+        perror("number_keys");
+        free(references);
+        free(*globals);
+        free(*bases);
+        return NULL;
+    }
+
+    for(u4Index1 = 0; u4Index1 < index->documents_count; ++u4Index1) {
+        cap_file_index_document* document = index->documents[u4Index1];
+        u4 u4Index2 = 0;
+
+        (*bases)[u4Index1] = position;
+        for(; u4Index2 < document->keys_count; ++u4Index2, ++position) {
+            references[position].key = document->keys[u4Index2];
+            references[position].document = u4Index1;
+            references[position].local = u4Index2;
+        }
+    }
+
+    qsort(references, references_count, sizeof(key_reference), compare_key_references);
+
+    *keys_count = 0;
+    for(position = 0; position < references_count; ++position) {
+        if((position > 0) && (strcmp(references[position - 1].key, references[position].key) != 0))
+            ++*keys_count;
+        (*globals)[(*bases)[references[position].document] + references[position].local] = *keys_count;
+    }
+
+    if(references_count > 0)
+        ++*keys_count;
+
+    return references;
+
+}
+
+
+int write_cap_file_index(cap_file_index* index, const char* path) {
+
+    key_reference* references = NULL;
+    u4* globals = NULL;
+    u4* bases = NULL;
+    u4* cursors = NULL;
+    u1* buffer = NULL;
+    uint64_t size = 0;
+    size_t position = 0;
+    u4 keys_count = 0;
+    u4 key = 0;
+    u4 u4Index1 = 0;
+    int rc = -1;
+
+    if((references = number_keys(index, &globals, &bases, &keys_count)) == NULL)
+        return -1;
+
+    if((cursors = (u4*)calloc(keys_count + 1, sizeof(u4))) == NULL) {
+        perror("write_cap_file_index");
+        free(references);
+        free(globals);
+        free(bases);
+        return -1;
+    }
+
+    /* The cursors first count the usages of each name. */
+    for(; u4Index1 < index->documents_count; ++u4Index1) {
+        cap_file_index_document* document = index->documents[u4Index1];
+        u4 u4Index2 = 0;
+
+        for(; u4Index2 < document->usages_count; ++u4Index2)
+            ++cursors[globals[bases[u4Index1] + document->usages[u4Index2].key]];
+    }
+
+    size = INDEX_HEADER_SIZE + ((uint64_t)index->documents_count + keys_count) * 4;
+
+    for(u4Index1 = 0; u4Index1 < index->documents_count; ++u4Index1) {
+        cap_file_index_document* document = index->documents[u4Index1];
+        u1 u1Index = 0;
+
+        size += 2 + strlen(document->path) + 25;
+        for(; u1Index < document->imports_count; ++u1Index)
+            size += 1 + document->imports[u1Index].aid_length + 8;
+    }
+
+    for(u4Index1 = 0, key = 0; u4Index1 < keys_count; ++u4Index1) {
+        for(; globals[bases[references[key].document] + references[key].local] != u4Index1; ++key);
+        size += 2 + strlen(references[key].key) + 4 + (uint64_t)cursors[u4Index1] * INDEX_POSTING_SIZE;
+    }
+
+    if(size > 0xFFFFFFFF) {
+        fprintf(stderr, "Too many usages for an index\n");
+    } else if((buffer = (u1*)malloc(size)) == NULL) {
+        perror("write_cap_file_index");
+    } else {
+        store_u4(buffer, INDEX_MAGIC);
+        store_u2(buffer + 4, INDEX_VERSION);
+        store_u4(buffer + 6, index->documents_count);
+        store_u4(buffer + 10, keys_count);
+        position = INDEX_HEADER_SIZE + ((size_t)index->documents_count + keys_count) * 4;
+
+        for(u4Index1 = 0; u4Index1 < index->documents_count; ++u4Index1) {
+            cap_file_index_document* document = index->documents[u4Index1];
+            size_t length = strlen(document->path);
+            u1 u1Index = 0;
+
+            if(length > 0xFFFF) {
+                fprintf(stderr, "Path too long for an index: %s\n", document->path);
+                break;
+            }
+
+            store_u4(buffer + INDEX_HEADER_SIZE + u4Index1 * 4, position);
+            store_u2(buffer + position, length);
+            memcpy(buffer + position + 2, document->path, length);
+            position += 2 + length;
+            store_u8(buffer + position, document->hash);
+            store_u8(buffer + position + 8, document->size);
+            store_u8(buffer + position + 16, (uint64_t)document->mtime);
+            buffer[position + 24] = document->imports_count;
+            position += 25;
+
+            for(; u1Index < document->imports_count; ++u1Index) {
+                buffer[position] = document->imports[u1Index].aid_length;
+                memcpy(buffer + position + 1, document->imports[u1Index].aid, document->imports[u1Index].aid_length);
+                position += 1 + document->imports[u1Index].aid_length;
+                store_u8(buffer + position, document->imports[u1Index].hash);
+                position += 8;
+            }
+        }
+
+        if(u4Index1 == index->documents_count) {
+            /* Each name is followed by room for its postings, its cursor then
+               pointing to where its next posting goes. */
+            for(u4Index1 = 0, key = 0; u4Index1 < keys_count; ++u4Index1) {
+                size_t length = 0;
+                u4 postings_count = cursors[u4Index1];
+
+                for(; globals[bases[references[key].document] + references[key].local] != u4Index1; ++key);
+                length = strlen(references[key].key);
+
+                store_u4(buffer + INDEX_HEADER_SIZE + ((size_t)index->documents_count + u4Index1) * 4, position);
+                store_u2(buffer + position, length);
+                memcpy(buffer + position + 2, references[key].key, length);
+                store_u4(buffer + position + 2 + length, postings_count);
+                position += 2 + length + 4;
+                cursors[u4Index1] = position;
+                position += (size_t)postings_count * INDEX_POSTING_SIZE;
+            }
+
+            /* Going through the documents in order sorts the postings of each
+               name by document. */
+            for(u4Index1 = 0; u4Index1 < index->documents_count; ++u4Index1) {
+                cap_file_index_document* document = index->documents[u4Index1];
+                u4 u4Index2 = 0;
+
+                for(; u4Index2 < document->usages_count; ++u4Index2) {
+                    cap_file_index_usage* usage = document->usages + u4Index2;
+                    u4* cursor = cursors + globals[bases[u4Index1] + usage->key];
+
+                    store_u4(buffer + *cursor, u4Index1);
+                    store_u2(buffer + *cursor + 4, usage->class_index);
+                    store_u2(buffer + *cursor + 6, usage->method_index);
+                    store_u2(buffer + *cursor + 8, usage->offset);
+                    *cursor += INDEX_POSTING_SIZE;
+                }
+            }
+
+            rc = write_index_file(path, buffer, size);
+        }
+    }
+
+    free(cursors);
+    free(references);
+    free(globals);
+    free(bases);
+    free(buffer);
+    return rc;
+
+}
+
+
+/**
+ * Compare the name at an entry of the keys table with a string, only up to
+ * the length of the string if is_prefix is set. Set error on a malformed
+ * index.
+ */
+static int compare_key(byte_reader* reader, u4 keys_table, u4 entry, const char* name, size_t name_length, int is_prefix) {
+
+    const u1* key = NULL;
+    u2 key_length = 0;
+    int rc = 0;
+
+    seek_entry(reader, keys_table, entry);
+    key_length = get_u2(reader);
+    if((key = get_bytes(reader, key_length)) == NULL)
+        return 0;
+
+    if(is_prefix && (key_length > name_length))
+        key_length = name_length;
+
+    rc = memcmp(key, name, (key_length < name_length) ? key_length : name_length);
+    if(rc != 0)
+        return rc;
+
+    return (key_length > name_length) - (key_length < name_length);
+
+}
+
+
+/**
+ * Output the usages of the name at an entry of the keys table.
+ */
+static int print_postings(byte_reader* reader, u4 documents_count, u4 entry, verbose_sink* output) {
+
+    const u1* key = NULL;
+    u2 key_length = 0;
+    u4 postings_count = 0;
+    u4 u4Index = 0;
+
+    seek_entry(reader, INDEX_HEADER_SIZE + documents_count * 4, entry);
+    key_length = get_u2(reader);
+    key = get_bytes(reader, key_length);
+    postings_count = get_u4(reader);
+
+    for(; (u4Index < postings_count) && !reader->error; ++u4Index) {
+        u4 posting = reader->position;
+        u4 document = get_u4(reader);
+        u2 class_index = get_u2(reader);
+        u2 method_index = get_u2(reader);
+        u2 offset = get_u2(reader);
+        const u1* path = NULL;
+        u2 path_length = 0;
+
+        if(document >= documents_count) {
+            reader->error = 1;
+            break;
+        }
+
+        seek_entry(reader, INDEX_HEADER_SIZE, document);
+        path_length = get_u2(reader);
+        if((path = get_bytes(reader, path_length)) == NULL)
+            break;
+
+        if(sink_printf(output, "%.*s: class %u, method %u, offset %u: %.*s\n", (int)path_length, (const char*)path, class_index, method_index, offset, (int)key_length, (const char*)key) == -1)
+            return -1;
+
+        reader->position = posting + INDEX_POSTING_SIZE;
+    }
+
+    return reader->error ? -1 : (int)postings_count;
+
+}
+
+
+int query_cap_file_index(const char* path, const char* name, int is_prefix, verbose_sink* output) {
+
+    byte_reader reader;
+    const u1* buffer = NULL;
+    size_t name_length = strlen(name);
+    u4 size = 0;
+    u4 documents_count = 0;
+    u4 keys_count = 0;
+    u4 keys_table = 0;
+    u4 low = 0;
+    u4 high = 0;
+    int missing = 0;
+    int found = 0;
+
+    if((buffer = map_file(path, &size, &missing)) == NULL) {
+        if(missing)
+            fprintf(stderr, "%s does not exist\n", path);
+        return -1;
+    }
+
+    memset(&reader, 0, sizeof(byte_reader));
+    reader.buffer = buffer;
+    reader.size = size;
+
+    if(check_header(&reader, path, &documents_count, &keys_count) == -1) {
+        unmap_file(buffer, size);
+        return -1;
+    }
+
+    keys_table = INDEX_HEADER_SIZE + documents_count * 4;
+    high = keys_count;
+
+    /* Search for the first name not lower than the given one. */
+    while((low < high) && !reader.error) {
+        u4 middle = low + (high - low) / 2;
+
+        if(compare_key(&reader, keys_table, middle, name, name_length, 0) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    for(; (low < keys_count) && !reader.error && (compare_key(&reader, keys_table, low, name, name_length, is_prefix) == 0); ++low) {
+        int count = print_postings(&reader, documents_count, low, output);
+
+        if(count == -1) {
+            found = -1;
+            break;
+        }
+
+        found += count;
+        if(!is_prefix)
+            break;
+    }
+
+    if(reader.error) {
+        fprintf(stderr, "%s is not a valid index\n", path);
+        found = -1;
+    }
+
+    unmap_file(buffer, size);
+    return found;
+
+}
@@ -178,7 +178,7 @@ static int parseHeaderComponent(cap_file* cf, char* data) {
         return -1;
     }
 
-    printf("Parsing header component\n");
+    fprintf(stderr, "Parsing header component\n");
     cf->header.tag = data[position++];
 
     cf->header.size = bigEndianToU2(data + position);
@@ -253,7 +253,7 @@ static int parseDirectoryComponent(cap_file* cf, char* data) {
         return -1;
     }
 
-    printf("Parsing directory component\n");
+    fprintf(stderr, "Parsing directory component\n");
     cf->directory.tag = data[position++];
     cf->directory.size = bigEndianToU2(data + position);
     position += 2;
@@ -340,7 +340,7 @@ static int parseAppletComponent(cap_file* cf, char* data) {
         return -1;
     }
 
-    printf("Parsing applet component\n");
+    fprintf(stderr, "Parsing applet component\n");
     cf->applet.tag = data[position++];
     cf->applet.size = bigEndianToU2(data + position);
     position += 2;
@@ -398,7 +398,7 @@ static int parseImportComponent(cap_file* cf, char* data) {
         return -1;
     }
 
-    printf("Parsing import component\n");
+    fprintf(stderr, "Parsing import component\n");
     cf->import.tag = data[position++];
     cf->import.size = bigEndianToU2(data + position);
     position += 2;
@@ -457,7 +457,7 @@ static int parseConstantPoolComponent(cap_file* cf, char* data) {
         return -1;
     }
 
-    printf("Parsing constant pool component\n");
+    fprintf(stderr, "Parsing constant pool component\n");
     cf->constant_pool.tag = data[position++];
     cf->constant_pool.size = bigEndianToU2(data + position);
     position += 2;
@@ -594,7 +594,7 @@ static int parseClassComponent(cap_file* cf, char* data) {
         return -1;
     }
 
-    printf("Parsing class component\n");
+    fprintf(stderr, "Parsing class component\n");
     cf->class.tag = data[position++];
     cf->class.size = bigEndianToU2(data + position);
     position += 2;
@@ -618,7 +618,7 @@ static int parseClassComponent(cap_file* cf, char* data) {
                 return -1;
             }
             cf->class.signature_pool = tmp;
-            ++cf->class.signature_pool_length;
+            ++cf->class.signature_pool_count;
 
             cf->class.signature_pool[u2Index].offset = offset;
             cf->class.signature_pool[u2Index].nibble_count = data[position++];
@@ -872,7 +872,7 @@ static int parseMethodComponent(cap_file* cf, char* data) {
         return -1;
     }
 
-    printf("Parsing method component\n");
+    fprintf(stderr, "Parsing method component\n");
     cf->method.tag = data[position++];
     cf->method.size = bigEndianToU2(data + position);
     position += 2;
@@ -992,7 +992,7 @@ static int parseStaticFieldComponent(cap_file* cf, char* data) {
         return -1;
     }
 
-    printf("Parsing static field component\n");
+    fprintf(stderr, "Parsing static field component\n");
     cf->static_field.tag = data[position++];
     cf->static_field.size = bigEndianToU2(data + position);
     position += 2;
@@ -1073,7 +1073,7 @@ static int parseReferenceLocationComponent(cap_file* cf, char* data) {
         return -1;
     }
 
-    printf("Parsing reference location component\n");
+    fprintf(stderr, "Parsing reference location component\n");
     cf->reference_location.tag = data[position++];
     cf->reference_location.size = bigEndianToU2(data + position);
     position += 2;
@@ -1133,7 +1133,7 @@ static int parseExportComponent(cap_file* cf, char* data) {
         return -1;
     }
 
-    printf("Parsing export component\n");
+    fprintf(stderr, "Parsing export component\n");
     cf->export.tag = data[position++];
     cf->export.size = bigEndianToU2(data + position);
     position += 2;
@@ -1213,7 +1213,7 @@ static int parseDescriptorComponent(cap_file* cf, char* data) {
         return -1;
     }
 
-    printf("Parsing descriptor component\n");
+    fprintf(stderr, "Parsing descriptor component\n");
     cf->descriptor.tag = data[position++];
     cf->descriptor.size = bigEndianToU2(data + position);
     position += 2;
@@ -1416,7 +1416,7 @@ static int parseDebugComponent(cap_file* cf, char* data) {
         return -1;
     }
 
-    printf("Parsing debug component\n");
+    fprintf(stderr, "Parsing debug component\n");
     cf->debug.tag = data[position++];
     cf->debug.size = bigEndianToU2(data + position);
     position += 2;
@@ -1603,7 +1603,7 @@ cap_file* read_cap_file(const char* filename) {
     int error = 0;
     struct zip* z = zip_open(filename, 0, &error);
 
-    printf("Starting to read the cap file: %s\n", filename);
+    fprintf(stderr, "Starting to read the cap file: %s\n", filename);
 
     if(error != 0) {
         char buf[1024];
@@ -1763,10 +1763,10 @@ cap_file* read_cap_file(const char* filename) {
                 return NULL;
             }
             cf->manifest[stat.size] = '\0';
-            printf("Found manifest, skipping...\n");
+            fprintf(stderr, "Found manifest, skipping...\n");
         } else if(strcmp(substr, "Header.cap") == 0) {
             /* We already read the header component */
-            printf("Skipping header...\n"); 
+            fprintf(stderr, "Skipping header...\n"); 
             free(data);
         } else if(strcmp(substr, "Directory.cap") == 0) {
             if(parseDirectoryComponent(cf, data) == -1) {
@@ -1791,7 +1791,7 @@ cap_file* read_cap_file(const char* filename) {
             free(data);
         } else if(strcmp(substr, "ConstantPool.cap") == 0) {
             /* We already read the constant pool component */
-            printf("Skipping constant pool...\n");
+            fprintf(stderr, "Skipping constant pool...\n");
             free(data);
         } else if(strcmp(substr, "Class.cap") == 0) {
             if(parseClassComponent(cf, data) == -1) {
@@ -1830,7 +1830,7 @@ cap_file* read_cap_file(const char* filename) {
             free(data);
         } else if(strcmp(substr, "Descriptor.cap") == 0) {
             /* We already read the descriptor component */
-            printf("Skipping descriptor...\n");
+            fprintf(stderr, "Skipping descriptor...\n");
             free(data);
         } else if(strcmp(substr, "Debug.cap") == 0) {
             if(parseDebugComponent(cf, data) == -1) {
@@ -1841,12 +1841,133 @@ cap_file* read_cap_file(const char* filename) {
             free(data);
         } else { 
             free(data);
-            printf("Unsupported component, skipping...\n");
+            fprintf(stderr, "Unsupported component, skipping...\n");
         }
     }
 
     zip_close(z);
 
+    cf->source = (char*)malloc(strlen(filename) + 1);
+    if(cf->source == NULL) {
+        perror("readCapFile");
+        return NULL;
+    }
+    strcpy(cf->source, filename);
+    cf->source_components = 0;
+
     return cf;
 
 }
+
+
+/**
+ * \brief Free a straightforward CAP file representation read by
+ * read_cap_file() or generated by generate_cap_file().
+ *
+ * \param cf The CAP file to free, might be NULL.
+ */
+void free_cap_file(cap_file* cf) {
+
+    u2 u2Index1 = 0;
+    u2 u2Index2 = 0;
+
+    if(cf == NULL)
+        return;
+
+    free(cf->path);
+    free(cf->manifest);
+    free(cf->source);
+
+    free(cf->header.package.AID);
+    if(cf->header.has_package_name)
+        free(cf->header.package_name.name);
+
+    for(u2Index1 = 0; u2Index1 < cf->directory.custom_count; ++u2Index1)
+        free(cf->directory.custom_components[u2Index1].AID);
+    free(cf->directory.custom_components);
+
+    for(u2Index1 = 0; u2Index1 < cf->applet.count; ++u2Index1)
+        free(cf->applet.applets[u2Index1].AID);
+    free(cf->applet.applets);
+
+    for(u2Index1 = 0; u2Index1 < cf->import.count; ++u2Index1)
+        free(cf->import.packages[u2Index1].AID);
+    free(cf->import.packages);
+
+    free(cf->constant_pool.constant_pool);
+
+    for(u2Index1 = 0; u2Index1 < cf->class.signature_pool_count; ++u2Index1)
+        free(cf->class.signature_pool[u2Index1].type);
+    free(cf->class.signature_pool);
+
+    for(u2Index1 = 0; (cf->class.interfaces != NULL) && (u2Index1 < cf->class.interfaces_count); ++u2Index1) {
+        free(cf->class.interfaces[u2Index1].superinterfaces);
+        if(cf->class.interfaces[u2Index1].has_interface_name)
+            free(cf->class.interfaces[u2Index1].interface_name.interface_name);
+    }
+    free(cf->class.interfaces);
+
+    for(u2Index1 = 0; (cf->class.classes != NULL) && (u2Index1 < cf->class.classes_count); ++u2Index1) {
+        free(cf->class.classes[u2Index1].public_virtual_method_table);
+        free(cf->class.classes[u2Index1].package_virtual_method_table);
+
+        for(u2Index2 = 0; (cf->class.classes[u2Index1].interfaces != NULL) && (u2Index2 < cf->class.classes[u2Index1].interface_count); ++u2Index2)
+            free(cf->class.classes[u2Index1].interfaces[u2Index2].index);
+        free(cf->class.classes[u2Index1].interfaces);
+
+        if(cf->class.classes[u2Index1].has_remote_interfaces) {
+            free(cf->class.classes[u2Index1].remote_interfaces.remote_methods);
+            free(cf->class.classes[u2Index1].remote_interfaces.hash_modifier);
+            free(cf->class.classes[u2Index1].remote_interfaces.class_name);
+            free(cf->class.classes[u2Index1].remote_interfaces.remote_interfaces);
+        }
+    }
+    free(cf->class.classes);
+
+    free(cf->method.exception_handlers);
+    for(u2Index1 = 0; u2Index1 < cf->method.method_count; ++u2Index1)
+        free(cf->method.methods[u2Index1].bytecodes);
+    free(cf->method.methods);
+
+    for(u2Index1 = 0; u2Index1 < cf->static_field.array_init_count; ++u2Index1)
+        free(cf->static_field.array_init[u2Index1].values);
+    free(cf->static_field.array_init);
+    free(cf->static_field.non_default_values);
+
+    free(cf->reference_location.offset_to_byte_indices);
+    free(cf->reference_location.offset_to_byte2_indices);
+
+    for(u2Index1 = 0; u2Index1 < cf->export.class_count; ++u2Index1) {
+        free(cf->export.class_exports[u2Index1].static_field_offsets);
+        free(cf->export.class_exports[u2Index1].static_method_offsets);
+    }
+    free(cf->export.class_exports);
+
+    for(u2Index1 = 0; (cf->descriptor.classes != NULL) && (u2Index1 < cf->descriptor.class_count); ++u2Index1) {
+        free(cf->descriptor.classes[u2Index1].interfaces);
+        free(cf->descriptor.classes[u2Index1].fields);
+        free(cf->descriptor.classes[u2Index1].methods);
+    }
+    free(cf->descriptor.classes);
+    free(cf->descriptor.types.constant_pool_types);
+    for(u2Index1 = 0; u2Index1 < cf->descriptor.types.type_desc_count; ++u2Index1)
+        free(cf->descriptor.types.type_desc[u2Index1].type);
+    free(cf->descriptor.types.type_desc);
+
+    for(u2Index1 = 0; u2Index1 < cf->debug.string_count; ++u2Index1)
+        free(cf->debug.strings_table[u2Index1].bytes);
+    free(cf->debug.strings_table);
+    for(u2Index1 = 0; u2Index1 < cf->debug.class_count; ++u2Index1) {
+        free(cf->debug.classes[u2Index1].interface_names_indexes);
+        free(cf->debug.classes[u2Index1].fields);
+        for(u2Index2 = 0; u2Index2 < cf->debug.classes[u2Index1].method_count; ++u2Index2) {
+            free(cf->debug.classes[u2Index1].methods[u2Index2].variable_table);
+            free(cf->debug.classes[u2Index1].methods[u2Index2].line_table);
+        }
+        free(cf->debug.classes[u2Index1].methods);
+    }
+    free(cf->debug.classes);
+
+    free(cf);
+
+}
@@ -0,0 +1,758 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file cap_file_serialize.c
+ * \brief Output a CAP file in its straightforward representation as a JSON
+ * or CBOR document.
+ */
+
+#include <string.h>
+
+#include "cap_file.h"
+#include "cap_file_serialize.h"
+#include "structured_writer.h"
+
+static const structured_flag header_flags[] = {{HEADER_ACC_INT, "ACC_INT"}, {HEADER_ACC_EXPORT, "ACC_EXPORT"}, {HEADER_ACC_APPLET, "ACC_APPLET"}, {0, NULL}};
+static const structured_flag class_flags[] = {{CLASS_ACC_INTERFACE, "ACC_INTERFACE"}, {CLASS_ACC_SHAREABLE, "ACC_SHAREABLE"}, {CLASS_ACC_REMOTE, "ACC_REMOTE"}, {0, NULL}};
+static const structured_flag method_flags[] = {{METHOD_ACC_EXTENDED, "ACC_EXTENDED"}, {METHOD_ACC_ABSTRACT, "ACC_ABSTRACT"}, {0, NULL}};
+static const structured_flag class_descriptor_flags[] = {{DESCRIPTOR_ACC_PUBLIC, "ACC_PUBLIC"}, {DESCRIPTOR_ACC_FINAL, "ACC_FINAL"}, {DESCRIPTOR_ACC_INTERFACE, "ACC_INTERFACE"}, {DESCRIPTOR_ACC_ABSTRACT1, "ACC_ABSTRACT"}, {0, NULL}};
+static const structured_flag field_descriptor_flags[] = {{DESCRIPTOR_ACC_PUBLIC, "ACC_PUBLIC"}, {DESCRIPTOR_ACC_PRIVATE, "ACC_PRIVATE"}, {DESCRIPTOR_ACC_PROTECTED, "ACC_PROTECTED"}, {DESCRIPTOR_ACC_STATIC, "ACC_STATIC"}, {DESCRIPTOR_ACC_FINAL, "ACC_FINAL"}, {0, NULL}};
+static const structured_flag method_descriptor_flags[] = {{DESCRIPTOR_ACC_PUBLIC, "ACC_PUBLIC"}, {DESCRIPTOR_ACC_PRIVATE, "ACC_PRIVATE"}, {DESCRIPTOR_ACC_PROTECTED, "ACC_PROTECTED"}, {DESCRIPTOR_ACC_STATIC, "ACC_STATIC"}, {DESCRIPTOR_ACC_FINAL, "ACC_FINAL"}, {DESCRIPTOR_ACC_ABSTRACT2, "ACC_ABSTRACT"}, {DESCRIPTOR_ACC_INIT, "ACC_INIT"}, {0, NULL}};
+
+
+/**
+ * Write an array of u2 values.
+ */
+static void write_u2_array(structured_writer* writer, const char* key, u2* values, u2 count) {
+
+    u2 u2Index = 0;
+
+    write_key(writer, key);
+    begin_array(writer);
+
+    for(; u2Index < count; ++u2Index)
+        write_uint(writer, values[u2Index]);
+
+    end_array(writer);
+
+}
+
+
+/**
+ * Write a package_info.
+ */
+static void write_package(structured_writer* writer, cf_package_info* package) {
+
+    begin_object(writer);
+    write_uint_member(writer, "minor_version", package->minor_version);
+    write_uint_member(writer, "major_version", package->major_version);
+    write_bytes_member(writer, "AID", package->AID, package->AID_length);
+    end_object(writer);
+
+}
+
+
+/**
+ * Write a class_ref.
+ */
+static void write_class_ref(structured_writer* writer, const char* key, cf_class_ref_info* class_ref) {
+
+    write_key(writer, key);
+    begin_object(writer);
+
+    if(class_ref->isExternal) {
+        write_key(writer, "external_class_ref");
+        begin_object(writer);
+        write_uint_member(writer, "package_token", class_ref->ref.external_class_ref.package_token);
+        write_uint_member(writer, "class_token", class_ref->ref.external_class_ref.class_token);
+        end_object(writer);
+    } else {
+        write_uint_member(writer, "internal_class_ref", class_ref->ref.internal_class_ref);
+    }
+
+    end_object(writer);
+
+}
+
+
+/**
+ * Write a static field or static method reference.
+ */
+static void write_static_ref(structured_writer* writer, const char* key, cf_static_ref_info* static_ref) {
+
+    write_key(writer, key);
+    begin_object(writer);
+
+    if(static_ref->isExternal) {
+        write_key(writer, "external_ref");
+        begin_object(writer);
+        write_uint_member(writer, "package_token", static_ref->ref.external_ref.package_token);
+        write_uint_member(writer, "class_token", static_ref->ref.external_ref.class_token);
+        write_uint_member(writer, "token", static_ref->ref.external_ref.token);
+        end_object(writer);
+    } else {
+        write_key(writer, "internal_ref");
+        begin_object(writer);
+        write_uint_member(writer, "padding", static_ref->ref.internal_ref.padding);
+        write_uint_member(writer, "offset", static_ref->ref.internal_ref.offset);
+        end_object(writer);
+    }
+
+    end_object(writer);
+
+}
+
+
+/**
+ * Write a type descriptor with one array element per nibble.
+ */
+static void write_type_descriptor(structured_writer* writer, cf_type_descriptor* type_descriptor) {
+
+    u1 u1Index = 0;
+
+    begin_object(writer);
+    write_uint_member(writer, "offset", type_descriptor->offset);
+    write_uint_member(writer, "nibble_count", type_descriptor->nibble_count);
+    write_key(writer, "type");
+    begin_array(writer);
+
+    for(; u1Index < type_descriptor->nibble_count; ++u1Index)
+        write_uint(writer, (u1Index % 2) ? type_descriptor->type[u1Index / 2] & 0x0F : type_descriptor->type[u1Index / 2] >> 4);
+
+    end_array(writer);
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the tag and size of a component.
+ */
+static void begin_component(structured_writer* writer, const char* key, u1 tag, u2 size) {
+
+    write_key(writer, key);
+    begin_object(writer);
+    write_uint_member(writer, "tag", tag);
+    write_uint_member(writer, "size", size);
+
+}
+
+
+/**
+ * Write the Header component.
+ */
+static void write_header_component(structured_writer* writer, cap_file* cf) {
+
+    begin_component(writer, "header_component", cf->header.tag, cf->header.size);
+    write_uint_member(writer, "magic", cf->header.magic);
+    write_uint_member(writer, "minor_version", cf->header.minor_version);
+    write_uint_member(writer, "major_version", cf->header.major_version);
+    write_flags_member(writer, "flags", cf->header.flags, header_flags);
+    write_key(writer, "package");
+    write_package(writer, &(cf->header.package));
+
+    if(cf->header.has_package_name) {
+        write_key(writer, "package_name");
+        write_string(writer, cf->header.package_name.name, cf->header.package_name.name_length);
+    }
+
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the Directory component.
+ */
+static void write_directory_component(structured_writer* writer, cap_file* cf) {
+
+    u1 u1Index = 0;
+
+    begin_component(writer, "directory_component", cf->directory.tag, cf->directory.size);
+    write_u2_array(writer, "component_sizes", cf->directory.component_sizes, cf->directory.can_have_debug_component ? 12 : 11);
+    write_key(writer, "static_field_size");
+    begin_object(writer);
+    write_uint_member(writer, "image_size", cf->directory.static_field_size.image_size);
+    write_uint_member(writer, "array_init_count", cf->directory.static_field_size.array_init_count);
+    write_uint_member(writer, "array_init_size", cf->directory.static_field_size.array_init_size);
+    end_object(writer);
+    write_uint_member(writer, "import_count", cf->directory.import_count);
+    write_uint_member(writer, "applet_count", cf->directory.applet_count);
+    write_key(writer, "custom_components");
+    begin_array(writer);
+
+    for(; u1Index < cf->directory.custom_count; ++u1Index) {
+        begin_object(writer);
+        write_uint_member(writer, "component_tag", cf->directory.custom_components[u1Index].component_tag);
+        write_uint_member(writer, "size", cf->directory.custom_components[u1Index].size);
+        write_bytes_member(writer, "AID", cf->directory.custom_components[u1Index].AID, cf->directory.custom_components[u1Index].AID_length);
+        end_object(writer);
+    }
+
+    end_array(writer);
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the Applet component.
+ */
+static void write_applet_component(structured_writer* writer, cap_file* cf) {
+
+    u1 u1Index = 0;
+
+    begin_component(writer, "applet_component", cf->applet.tag, cf->applet.size);
+    write_key(writer, "applets");
+    begin_array(writer);
+
+    for(; u1Index < cf->applet.count; ++u1Index) {
+        begin_object(writer);
+        write_bytes_member(writer, "AID", cf->applet.applets[u1Index].AID, cf->applet.applets[u1Index].AID_length);
+        write_uint_member(writer, "install_method_offset", cf->applet.applets[u1Index].install_method_offset);
+        end_object(writer);
+    }
+
+    end_array(writer);
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the Import component.
+ */
+static void write_import_component(structured_writer* writer, cap_file* cf) {
+
+    u1 u1Index = 0;
+
+    begin_component(writer, "import_component", cf->import.tag, cf->import.size);
+    write_key(writer, "packages");
+    begin_array(writer);
+
+    for(; u1Index < cf->import.count; ++u1Index)
+        write_package(writer, cf->import.packages + u1Index);
+
+    end_array(writer);
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the Constant Pool component.
+ */
+static void write_constant_pool_component(structured_writer* writer, cap_file* cf) {
+
+    u2 u2Index = 0;
+
+    begin_component(writer, "constant_pool_component", cf->constant_pool.tag, cf->constant_pool.size);
+    write_key(writer, "constant_pool");
+    begin_array(writer);
+
+    for(; u2Index < cf->constant_pool.count; ++u2Index) {
+        cf_cp_info* entry = cf->constant_pool.constant_pool + u2Index;
+
+        begin_object(writer);
+
+        switch(entry->tag) {
+            case CF_CONSTANT_CLASSREF:
+                write_string_member(writer, "tag", "CONSTANT_Classref");
+                write_class_ref(writer, "class_ref", &(entry->CONSTANT_Classref.class_ref));
+                write_uint_member(writer, "padding", entry->CONSTANT_Classref.padding);
+                break;
+
+            case CF_CONSTANT_INSTANCEFIELDREF:
+                write_string_member(writer, "tag", "CONSTANT_InstanceFieldref");
+                write_class_ref(writer, "class", &(entry->CONSTANT_InstanceFieldref.class));
+                write_uint_member(writer, "token", entry->CONSTANT_InstanceFieldref.token);
+                break;
+
+            case CF_CONSTANT_VIRTUALMETHODREF:
+                write_string_member(writer, "tag", "CONSTANT_VirtualMethodref");
+                write_class_ref(writer, "class", &(entry->CONSTANT_VirtualMethodref.class));
+                write_uint_member(writer, "token", entry->CONSTANT_VirtualMethodref.token);
+                break;
+
+            case CF_CONSTANT_SUPERMETHODREF:
+                write_string_member(writer, "tag", "CONSTANT_SuperMethodref");
+                write_class_ref(writer, "class", &(entry->CONSTANT_SuperMethodref.class));
+                write_uint_member(writer, "token", entry->CONSTANT_SuperMethodref.token);
+                break;
+
+            case CF_CONSTANT_STATICFIELDREF:
+                write_string_member(writer, "tag", "CONSTANT_StaticFieldref");
+                write_static_ref(writer, "static_field_ref", &(entry->CONSTANT_StaticFieldref.static_field_ref));
+                break;
+
+            case CF_CONSTANT_STATICMETHODREF:
+                write_string_member(writer, "tag", "CONSTANT_StaticMethodref");
+                write_static_ref(writer, "static_method_ref", &(entry->CONSTANT_StaticMethodref.static_method_ref));
+                break;
+
+            default:
+                write_uint_member(writer, "tag", entry->tag);
+        }
+
+        end_object(writer);
+    }
+
+    end_array(writer);
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the remote interfaces of a class.
+ */
+static void write_remote_interfaces(structured_writer* writer, cf_remote_interface_info* remote) {
+
+    u1 u1Index = 0;
+
+    write_key(writer, "remote_interfaces");
+    begin_object(writer);
+    write_key(writer, "remote_methods");
+    begin_array(writer);
+
+    for(; u1Index < remote->remote_methods_count; ++u1Index) {
+        begin_object(writer);
+        write_uint_member(writer, "remote_method_hash", remote->remote_methods[u1Index].remote_method_hash);
+        write_uint_member(writer, "signature_offset", remote->remote_methods[u1Index].signature_offset);
+        write_uint_member(writer, "virtual_method_token", remote->remote_methods[u1Index].virtual_method_token);
+        end_object(writer);
+    }
+
+    end_array(writer);
+    write_bytes_member(writer, "hash_modifier", remote->hash_modifier, remote->hash_modifier_length);
+    write_key(writer, "class_name");
+    write_string(writer, remote->class_name, remote->class_name_length);
+    write_key(writer, "remote_interfaces");
+    begin_array(writer);
+
+    for(u1Index = 0; u1Index < remote->remote_interfaces_count; ++u1Index) {
+        begin_object(writer);
+        write_class_ref(writer, "class_ref", remote->remote_interfaces + u1Index);
+        end_object(writer);
+    }
+
+    end_array(writer);
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the Class component.
+ */
+static void write_class_component(structured_writer* writer, cap_file* cf) {
+
+    u2 u2Index = 0;
+
+    begin_component(writer, "class_component", cf->class.tag, cf->class.size);
+
+    if(cf->class.can_have_signature_pool) {
+        write_uint_member(writer, "signature_pool_length", cf->class.signature_pool_length);
+        write_key(writer, "signature_pool");
+        begin_array(writer);
+
+        for(; u2Index < cf->class.signature_pool_count; ++u2Index)
+            write_type_descriptor(writer, cf->class.signature_pool + u2Index);
+
+        end_array(writer);
+    }
+
+    write_key(writer, "interfaces");
+    begin_array(writer);
+
+    for(u2Index = 0; u2Index < cf->class.interfaces_count; ++u2Index) {
+        cf_interface_info* interface = cf->class.interfaces + u2Index;
+        u1 u1Index = 0;
+
+        begin_object(writer);
+        write_uint_member(writer, "offset", interface->offset);
+        write_flags_member(writer, "flags", interface->flags, class_flags);
+        write_key(writer, "superinterfaces");
+        begin_array(writer);
+
+        for(; u1Index < interface->interface_count; ++u1Index) {
+            begin_object(writer);
+            write_class_ref(writer, "class_ref", interface->superinterfaces + u1Index);
+            end_object(writer);
+        }
+
+        end_array(writer);
+
+        if(interface->has_interface_name) {
+            write_key(writer, "interface_name");
+            write_string(writer, interface->interface_name.interface_name, interface->interface_name.interface_name_length);
+        }
+
+        end_object(writer);
+    }
+
+    end_array(writer);
+    write_key(writer, "classes");
+    begin_array(writer);
+
+    for(u2Index = 0; u2Index < cf->class.classes_count; ++u2Index) {
+        cf_class_info* class = cf->class.classes + u2Index;
+        u1 u1Index = 0;
+
+        begin_object(writer);
+        write_uint_member(writer, "offset", class->offset);
+        write_flags_member(writer, "flags", class->flags, class_flags);
+
+        if(class->has_superclass)
+            write_class_ref(writer, "super_class_ref", &(class->super_class_ref));
+
+        write_uint_member(writer, "declared_instance_size", class->declared_instance_size);
+        write_uint_member(writer, "first_reference_token", class->first_reference_token);
+        write_uint_member(writer, "reference_count", class->reference_count);
+        write_uint_member(writer, "public_method_table_base", class->public_method_table_base);
+        write_uint_member(writer, "package_method_table_base", class->package_method_table_base);
+        write_u2_array(writer, "public_virtual_method_table", class->public_virtual_method_table, class->public_method_table_count);
+        write_u2_array(writer, "package_virtual_method_table", class->package_virtual_method_table, class->package_method_table_count);
+        write_key(writer, "interfaces");
+        begin_array(writer);
+
+        for(; u1Index < class->interface_count; ++u1Index) {
+            begin_object(writer);
+            write_class_ref(writer, "interface", &(class->interfaces[u1Index].interface));
+            write_bytes_member(writer, "index", class->interfaces[u1Index].index, class->interfaces[u1Index].count);
+            end_object(writer);
+        }
+
+        end_array(writer);
+
+        if(class->has_remote_interfaces)
+            write_remote_interfaces(writer, &(class->remote_interfaces));
+
+        end_object(writer);
+    }
+
+    end_array(writer);
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the Method component.
+ */
+static void write_method_component(structured_writer* writer, cap_file* cf) {
+
+    u1 u1Index = 0;
+    u2 u2Index = 0;
+
+    begin_component(writer, "method_component", cf->method.tag, cf->method.size);
+    write_key(writer, "exception_handlers");
+    begin_array(writer);
+
+    for(; u1Index < cf->method.handler_count; ++u1Index) {
+        cf_exception_handler_info* handler = cf->method.exception_handlers + u1Index;
+
+        begin_object(writer);
+        write_uint_member(writer, "start_offset", handler->start_offset);
+        write_uint_member(writer, "stop_bit", handler->stop_bit);
+        write_uint_member(writer, "active_length", handler->active_length);
+        write_uint_member(writer, "handler_offset", handler->handler_offset);
+        write_uint_member(writer, "catch_type_index", handler->catch_type_index);
+        end_object(writer);
+    }
+
+    end_array(writer);
+    write_key(writer, "methods");
+    begin_array(writer);
+
+    for(; u2Index < cf->method.method_count; ++u2Index) {
+        cf_method_info* method = cf->method.methods + u2Index;
+
+        begin_object(writer);
+        write_uint_member(writer, "offset", method->offset);
+        write_flags_member(writer, "flags", method->method_header.flags, method_flags);
+
+        if(method->method_header.flags & METHOD_ACC_EXTENDED) {
+            write_uint_member(writer, "padding", method->method_header.extended_method_header.padding);
+            write_uint_member(writer, "max_stack", method->method_header.extended_method_header.max_stack);
+            write_uint_member(writer, "nargs", method->method_header.extended_method_header.nargs);
+            write_uint_member(writer, "max_locals", method->method_header.extended_method_header.max_locals);
+        } else {
+            write_uint_member(writer, "max_stack", method->method_header.standard_method_header.max_stack);
+            write_uint_member(writer, "nargs", method->method_header.standard_method_header.nargs);
+            write_uint_member(writer, "max_locals", method->method_header.standard_method_header.max_locals);
+        }
+
+        write_bytes_member(writer, "bytecodes", method->bytecodes, method->bytecode_count);
+        end_object(writer);
+    }
+
+    end_array(writer);
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the Static Field component.
+ */
+static void write_static_field_component(structured_writer* writer, cap_file* cf) {
+
+    static const char* const types[] = {"boolean", "byte", "short", "int"};
+    u2 u2Index = 0;
+
+    begin_component(writer, "static_field_component", cf->static_field.tag, cf->static_field.size);
+    write_uint_member(writer, "image_size", cf->static_field.image_size);
+    write_uint_member(writer, "reference_count", cf->static_field.reference_count);
+    write_key(writer, "array_init");
+    begin_array(writer);
+
+    for(; u2Index < cf->static_field.array_init_count; ++u2Index) {
+        cf_array_init_info* array_init = cf->static_field.array_init + u2Index;
+
+        begin_object(writer);
+
+        if((array_init->type >= 2) && (array_init->type <= 5))
+            write_string_member(writer, "type", types[array_init->type - 2]);
+        else
+            write_uint_member(writer, "type", array_init->type);
+
+        write_bytes_member(writer, "values", array_init->values, array_init->count);
+        end_object(writer);
+    }
+
+    end_array(writer);
+    write_uint_member(writer, "default_value_count", cf->static_field.default_value_count);
+    write_bytes_member(writer, "non_default_values", cf->static_field.non_default_values, cf->static_field.non_default_value_count);
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the Reference Location component.
+ */
+static void write_reference_location_component(structured_writer* writer, cap_file* cf) {
+
+    begin_component(writer, "reference_location_component", cf->reference_location.tag, cf->reference_location.size);
+    write_bytes_member(writer, "offsets_to_byte_indices", cf->reference_location.offset_to_byte_indices, cf->reference_location.byte_index_count);
+    write_bytes_member(writer, "offsets_to_byte2_indices", cf->reference_location.offset_to_byte2_indices, cf->reference_location.byte2_index_count);
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the Export component.
+ */
+static void write_export_component(structured_writer* writer, cap_file* cf) {
+
+    u1 u1Index = 0;
+
+    begin_component(writer, "export_component", cf->export.tag, cf->export.size);
+    write_key(writer, "class_exports");
+    begin_array(writer);
+
+    for(; u1Index < cf->export.class_count; ++u1Index) {
+        begin_object(writer);
+        write_uint_member(writer, "class_offset", cf->export.class_exports[u1Index].class_offset);
+        write_u2_array(writer, "static_field_offsets", cf->export.class_exports[u1Index].static_field_offsets, cf->export.class_exports[u1Index].static_field_count);
+        write_u2_array(writer, "static_method_offsets", cf->export.class_exports[u1Index].static_method_offsets, cf->export.class_exports[u1Index].static_method_count);
+        end_object(writer);
+    }
+
+    end_array(writer);
+    end_object(writer);
+
+}
+
+
+/**
+ * Write a field descriptor.
+ */
+static void write_field_descriptor(structured_writer* writer, cf_field_descriptor_info* field) {
+
+    static const char* const types[] = {"boolean", "byte", "short", "int"};
+
+    begin_object(writer);
+    write_uint_member(writer, "token", field->token);
+    write_flags_member(writer, "access_flags", field->access_flags, field_descriptor_flags);
+
+    if(field->access_flags & DESCRIPTOR_ACC_STATIC) {
+        write_static_ref(writer, "field_ref", &(field->field_ref.static_field));
+    } else {
+        write_key(writer, "field_ref");
+        begin_object(writer);
+        write_class_ref(writer, "class_ref", &(field->field_ref.instance_field.class_ref));
+        write_uint_member(writer, "token", field->field_ref.instance_field.token);
+        end_object(writer);
+    }
+
+    if((field->type.primitive_type >= 0x8002) && (field->type.primitive_type <= 0x8005))
+        write_string_member(writer, "primitive_type", types[field->type.primitive_type - 0x8002]);
+    else
+        write_uint_member(writer, "reference_type", field->type.reference_type);
+
+    end_object(writer);
+
+}
+
+
+/**
+ * Write the Descriptor component.
+ */
+static void write_descriptor_component(structured_writer* writer, cap_file* cf) {
+
+    u1 u1Index1 = 0;
+    u2 u2Index = 0;
+
+    begin_component(writer, "descriptor_component", cf->descriptor.tag, cf->descriptor.size);
+    write_key(writer, "classes");
+    begin_array(writer);
+
+    for(; u1Index1 < cf->descriptor.class_count; ++u1Index1) {
+        cf_class_descriptor_info* class = cf->descriptor.classes + u1Index1;
+        u1 u1Index2 = 0;
+
+        begin_object(writer);
+        write_uint_member(writer, "token", class->token);
+        write_flags_member(writer, "access_flags", class->access_flags, class_descriptor_flags);
+        write_class_ref(writer, "this_class_ref", &(class->this_class_ref));
+        write_key(writer, "interfaces");
+        begin_array(writer);
+
+        for(; u1Index2 < class->interface_count; ++u1Index2) {
+            begin_object(writer);
+            write_class_ref(writer, "class_ref", class->interfaces + u1Index2);
+            end_object(writer);
+        }
+
+        end_array(writer);
+        write_key(writer, "fields");
+        begin_array(writer);
+
+        for(u2Index = 0; u2Index < class->field_count; ++u2Index)
+            write_field_descriptor(writer, class->fields + u2Index);
+
+        end_array(writer);
+        write_key(writer, "methods");
+        begin_array(writer);
+
+        for(u2Index = 0; u2Index < class->method_count; ++u2Index) {
+            cf_method_descriptor_info* method = class->methods + u2Index;
+
+            begin_object(writer);
+            write_uint_member(writer, "token", method->token);
+            write_flags_member(writer, "access_flags", method->access_flags, method_descriptor_flags);
+            write_uint_member(writer, "method_offset", method->method_offset);
+            write_uint_member(writer, "type_offset", method->type_offset);
+            write_uint_member(writer, "bytecode_count", method->bytecode_count);
+            write_uint_member(writer, "exception_handler_count", method->exception_handler_count);
+            write_uint_member(writer, "exception_handler_index", method->exception_handler_index);
+            end_object(writer);
+        }
+
+        end_array(writer);
+        end_object(writer);
+    }
+
+    end_array(writer);
+    write_key(writer, "types");
+    begin_object(writer);
+    write_u2_array(writer, "constant_pool_types", cf->descriptor.types.constant_pool_types, cf->descriptor.types.constant_pool_count);
+    write_key(writer, "type_desc");
+    begin_array(writer);
+
+    for(u2Index = 0; u2Index < cf->descriptor.types.type_desc_count; ++u2Index)
+        write_type_descriptor(writer, cf->descriptor.types.type_desc + u2Index);
+
+    end_array(writer);
+    end_object(writer);
+    end_object(writer);
+
+}
+
+
+int serialize_cap_file(structured_writer* writer, cap_file* cf) {
+
+    begin_object(writer);
+
+    if(cf->manifest != NULL)
+        write_string_member(writer, "manifest", cf->manifest);
+
+    if(cf->header.tag != 0)
+        write_header_component(writer, cf);
+
+    if(cf->directory.tag != 0)
+        write_directory_component(writer, cf);
+
+    if(cf->applet.tag != 0)
+        write_applet_component(writer, cf);
+
+    if(cf->import.tag != 0)
+        write_import_component(writer, cf);
+
+    if(cf->constant_pool.tag != 0)
+        write_constant_pool_component(writer, cf);
+
+    if(cf->class.tag != 0)
+        write_class_component(writer, cf);
+
+    if(cf->method.tag != 0)
+        write_method_component(writer, cf);
+
+    if(cf->static_field.tag != 0)
+        write_static_field_component(writer, cf);
+
+    if(cf->reference_location.tag != 0)
+        write_reference_location_component(writer, cf);
+
+    if(cf->export.tag != 0)
+        write_export_component(writer, cf);
+
+    if(cf->descriptor.tag != 0)
+        write_descriptor_component(writer, cf);
+
+    end_object(writer);
+
+    return writer->has_failed ? -1 : 0;
+
+}
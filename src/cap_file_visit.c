@@ -0,0 +1,237 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file cap_file_visit.c
+ * \brief Walk the bytecodes of a straightforward representation of CAP file
+ * without analyzing it.
+ */
+
+#include <stdio.h>
+
+#include "cap_file.h"
+#include "cap_file_visit.h"
+#include "bytecodes.h"
+
+/**
+ * Read a signed two bytes value.
+ */
+static int16_t get_s2(const u1* buffer) {
+
+    return (int16_t)((buffer[0] << 8) | buffer[1]);
+
+}
+
+
+/**
+ * Read a signed four bytes value.
+ */
+static int32_t get_s4(const u1* buffer) {
+
+    return (int32_t)(((u4)buffer[0] << 24) | ((u4)buffer[1] << 16) | ((u4)buffer[2] << 8) | (u4)buffer[3]);
+
+}
+
+
+int get_visited_switch_case(const visited_bytecode* bytecode, u2 case_index, int32_t* match, u2* branch) {
+
+    if(case_index >= bytecode->nb_cases)
+        return -1;
+
+    switch(opcodes[bytecode->opcode].format) {
+        case OPCODE_FORMAT_STABLESWITCH:
+            *match = get_s2(bytecode->args + 2) + case_index;
+            *branch = bytecode->offset + get_s2(bytecode->args + 6 + (case_index * 2));
+            return 0;
+
+        case OPCODE_FORMAT_ITABLESWITCH:
+            *match = get_s4(bytecode->args + 2) + case_index;
+            *branch = bytecode->offset + get_s2(bytecode->args + 10 + (case_index * 2));
+            return 0;
+
+        case OPCODE_FORMAT_SLOOKUPSWITCH:
+            *match = get_s2(bytecode->args + 4 + (case_index * 4));
+            *branch = bytecode->offset + get_s2(bytecode->args + 4 + (case_index * 4) + 2);
+            return 0;
+
+        case OPCODE_FORMAT_ILOOKUPSWITCH:
+            *match = get_s4(bytecode->args + 4 + (case_index * 6));
+            *branch = bytecode->offset + get_s2(bytecode->args + 4 + (case_index * 6) + 4);
+            return 0;
+    }
+
+    return -1;
+
+}
+
+
+int visit_method_bytecodes(cap_file* cf, u2 method_index, bytecode_visitor visitor, void* data) {
+
+    cf_method_info* method = NULL;
+    visited_bytecode bytecode;
+    u2 info_offset = 0;
+    u2 u2Index = 0;
+
+    if(method_index >= cf->method.method_count) {
+        fprintf(stderr, "Method %u does not exist\n", method_index);
+        return -1;
+    }
+
+    method = &(cf->method.methods[method_index]);
+    info_offset = method->offset + ((method->method_header.flags & METHOD_ACC_EXTENDED) ? 4 : 2);
+
+    while(u2Index < method->bytecode_count) {
+        const opcode_info* opcode = &opcodes[method->bytecodes[u2Index]];
+        u1 is_switch = 0;
+        int ret = 0;
+
+        if(opcode->format == OPCODE_FORMAT_INVALID) {
+            fprintf(stderr, "Invalid opcode %u at offset %u of method %u\n", method->bytecodes[u2Index], u2Index, method_index);
+            return -1;
+        }
+
+        if((u2Index + opcode->nb_args + 1) > method->bytecode_count) {
+            fprintf(stderr, "Truncated bytecode at offset %u of method %u\n", u2Index, method_index);
+            return -1;
+        }
+
+        bytecode.opcode = method->bytecodes[u2Index];
+        bytecode.offset = u2Index;
+        bytecode.info_offset = info_offset + u2Index;
+        bytecode.nb_args = opcode->nb_args;
+        bytecode.args = method->bytecodes + u2Index + 1;
+        bytecode.has_ref = 0;
+        bytecode.ref = 0;
+        bytecode.has_branch = 0;
+        bytecode.branch = 0;
+        bytecode.nb_cases = 0;
+
+        switch(opcode->format) {
+            case OPCODE_FORMAT_BRANCH:
+                bytecode.has_branch = 1;
+                if(opcode->branch_width == 1)
+                    bytecode.branch = u2Index + (int8_t)bytecode.args[0];
+                else
+                    bytecode.branch = u2Index + get_s2(bytecode.args);
+                break;
+
+            case OPCODE_FORMAT_REF:
+                bytecode.has_ref = 1;
+                if(opcode->ref_width == 1)
+                    bytecode.ref = bytecode.args[0];
+                else
+                    bytecode.ref = (bytecode.args[0] << 8) | bytecode.args[1];
+                break;
+
+            case OPCODE_FORMAT_TYPE_REF:    /* checkcast & instanceof */
+                if(bytecode.args[0] == 14 || bytecode.args[0] == 0) {
+                    bytecode.has_ref = 1;
+                    bytecode.ref = (bytecode.args[1] << 8) | bytecode.args[2];
+                }
+                break;
+
+            case OPCODE_FORMAT_INVOKEINTERFACE:
+                bytecode.has_ref = 1;
+                bytecode.ref = (bytecode.args[1] << 8) | bytecode.args[2];
+                break;
+
+            case OPCODE_FORMAT_STABLESWITCH:
+                bytecode.nb_cases = get_s2(bytecode.args + 4) - get_s2(bytecode.args + 2) + 1;
+                bytecode.nb_args += bytecode.nb_cases * 2;
+                is_switch = 1;
+                break;
+
+            case OPCODE_FORMAT_ITABLESWITCH:
+                bytecode.nb_cases = get_s4(bytecode.args + 6) - get_s4(bytecode.args + 2) + 1;
+                bytecode.nb_args += bytecode.nb_cases * 2;
+                is_switch = 1;
+                break;
+
+            case OPCODE_FORMAT_SLOOKUPSWITCH:
+                bytecode.nb_cases = (bytecode.args[2] << 8) | bytecode.args[3];
+                bytecode.nb_args += bytecode.nb_cases * 4;
+                is_switch = 1;
+                break;
+
+            case OPCODE_FORMAT_ILOOKUPSWITCH:
+                bytecode.nb_cases = (bytecode.args[2] << 8) | bytecode.args[3];
+                bytecode.nb_args += bytecode.nb_cases * 6;
+                is_switch = 1;
+                break;
+        }
+
+        if(is_switch) {
+            if((u2Index + bytecode.nb_args + 1) > method->bytecode_count) {
+                fprintf(stderr, "Truncated switch at offset %u of method %u\n", u2Index, method_index);
+                return -1;
+            }
+
+            bytecode.has_branch = 1;
+            bytecode.branch = u2Index + get_s2(bytecode.args);
+        }
+
+        if(visitor && ((ret = visitor(cf, method_index, &bytecode, data)) != 0))
+            return ret;
+
+        u2Index += bytecode.nb_args + 1;
+    }
+
+    return 0;
+
+}
+
+
+int visit_cap_file_bytecodes(cap_file* cf, method_visitor method_visitor, bytecode_visitor bytecode_visitor, void* data) {
+
+    u2 u2Index = 0;
+
+    for(; u2Index < cf->method.method_count; ++u2Index) {
+        int ret = 0;
+
+        if(method_visitor && ((ret = method_visitor(cf, u2Index, data)) != 0))
+            return ret;
+
+        if(bytecode_visitor && ((ret = visit_method_bytecodes(cf, u2Index, bytecode_visitor, data)) != 0))
+            return ret;
+    }
+
+    return 0;
+
+}
@@ -73,6 +73,56 @@ static void U4ToBigIndian(char* buffer, u4 value) {
 }
 
 
+/** The names of the components, indexed by tag, as in their entries. */
+static const char* const componentNames[] = {"Manifest", "Header", "Directory", "Applet", "Import", "ConstantPool", "Class", "Method", "StaticField", "RefLocation", "Export", "Descriptor", "Debug"};
+
+
+/**
+ * Give the name of the entry of a component, or of the manifest, in the CAP
+ * file.
+ */
+static void getEntryName(cap_file* cf, u1 tag, char* name) {
+
+    if(tag == COMPONENT_MANIFEST)
+        strcpy(name, "META-INF/MANIFEST.MF");
+    else
+        snprintf(name, 1024, "%s%s.cap", cf->path, componentNames[tag]);
+
+}
+
+
+/**
+ * Copy an entry of the source CAP file as it is. The whole entry being taken
+ * with ZIP_FL_COMPRESSED, libzip writes its compressed data without inflating
+ * and deflating it again. Return -1 if an error occurred, 0 else.
+ */
+static int copyFromSource(struct zip* z, struct zip* source, const char* name) {
+
+    struct zip_source* zipSource = NULL;
+    zip_int64_t index = zip_name_locate(source, name, 0);
+
+    if(index == -1) {
+        fprintf(stderr, "copyFromSource: %s | %s\n", name, zip_strerror(source));
+        return -1;
+    }
+
+    zipSource = zip_source_zip(z, source, index, ZIP_FL_COMPRESSED, 0, -1);
+    if(zipSource == NULL) {
+        fprintf(stderr, "copyFromSource: %s | %s\n", name, zip_strerror(z));
+        return -1;
+    }
+
+    if(zip_add(z, name, zipSource) == -1) {
+        fprintf(stderr, "copyFromSource: %s | %s\n", name, zip_strerror(z));
+        zip_source_free(zipSource);
+        return -1;
+    }
+
+    return 0;
+
+}
+
+
 static int addToZip(struct zip* z, const char* name, char* buffer, zip_uint64_t len) {
 
     zip_int64_t index = -1;
@@ -903,6 +953,49 @@ int writeDebug(struct zip* z, cap_file* cf) {
 
 }
 
+/**
+ * Write a component, or the manifest, of the CAP file or, if it was not
+ * generated, copy it from the source CAP file. Return -1 if an error occurred,
+ * 0 else.
+ */
+static int writeComponent(struct zip* z, struct zip* source, cap_file* cf, u1 tag, int (*write)(struct zip*, cap_file*)) {
+
+    char name[1024];
+
+    if(!(cf->source_components & COMPONENT_BIT(tag))) {
+        if(write(z, cf) == -1)
+            return -1;
+
+        printf("%s written\n", componentNames[tag]);
+        return 0;
+    }
+
+    getEntryName(cf, tag, name);
+    if(copyFromSource(z, source, name) == -1)
+        return -1;
+
+    printf("%s copied\n", componentNames[tag]);
+    return 0;
+
+}
+
+
+/**
+ * Close the written CAP file and then its source, which must stay open until
+ * the copied entries are written.
+ */
+static int closeZips(struct zip* z, struct zip* source) {
+
+    int rc = zip_close(z);
+
+    if(source != NULL)
+        zip_close(source);
+
+    return rc;
+
+}
+
+
 /**
  * \brief Write a straightforward CAP file representation into a file.
  * 
@@ -915,121 +1008,273 @@ int write_cap_file(cap_file* cf, const char* filename) {
 
     int error = 0;
     struct zip* z = NULL;
+    struct zip* source = NULL;
+
+    /* The components which were not generated are copied from the CAP file
+       this one comes from, which must not be the one about to be
+       overwritten. */
+    if(cf->source_components != 0) {
+        if((cf->source == NULL) || (strcmp(cf->source, filename) == 0)) {
+            fprintf(stderr, "writeCapFile: some components were not generated and cannot be copied into %s\n", filename);
+            return -1;
+        }
+
+        if((source = zip_open(cf->source, 0, &error)) == NULL) {
+            fprintf(stderr, "writeCapFile: could not open %s\n", cf->source);
+            return -1;
+        }
+    }
 
     open(filename, O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
 
+    error = 0;
     z = zip_open(filename, ZIP_CREATE, &error); 
     if(error != 0) {
         char buf[1024];
         zip_error_to_str(buf, 1024, error, errno);
         fprintf(stderr, "writeCapFile: %s\n", buf);
+        if(source != NULL)
+            zip_close(source);
         return -1;
     }
 
-    if(writeManifest(z, cf) == -1) {
-        zip_close(z);
+    if(writeComponent(z, source, cf, COMPONENT_MANIFEST, writeManifest) == -1) {
+        closeZips(z, source);
         return -1;
-    } else
-        printf("Manifest written\n");
+    }
 
     if(cf->header.tag != 0) {
-        if(writeHeader(z, cf) == -1) {
-            zip_close(z);
+        if(writeComponent(z, source, cf, COMPONENT_HEADER, writeHeader) == -1) {
+            closeZips(z, source);
             return -1;
-        } else
-            printf("Header written\n");
+        }
     }
 
     if(cf->directory.tag != 0) {
-        if(writeDirectory(z, cf) == -1) {
-            zip_close(z);
+        if(writeComponent(z, source, cf, COMPONENT_DIRECTORY, writeDirectory) == -1) {
+            closeZips(z, source);
             return -1;
-        } else
-            printf("Directory written\n");
+        }
     }
 
     if(cf->applet.tag != 0) {
-        if(writeApplet(z, cf) == -1) {
-            zip_close(z);
+        if(writeComponent(z, source, cf, COMPONENT_APPLET, writeApplet) == -1) {
+            closeZips(z, source);
             return -1;
-        } else
-            printf("Applet written\n");
+        }
     }
 
     if(cf->import.tag != 0) {
-        if(writeImport(z, cf) == -1) {
-            zip_close(z);
+        if(writeComponent(z, source, cf, COMPONENT_IMPORT, writeImport) == -1) {
+            closeZips(z, source);
             return -1;
-        } else
-            printf("Import written\n");
+        }
     }
 
     if(cf->constant_pool.tag != 0) {
-        if(writeConstantPool(z, cf) == -1) {
-            zip_close(z);
+        if(writeComponent(z, source, cf, COMPONENT_CONSTANTPOOL, writeConstantPool) == -1) {
+            closeZips(z, source);
             return -1;
-        } else
-            printf("ConstantPool written\n");
+        }
     }
 
     if(cf->class.tag != 0) {
-        if(writeClass(z, cf) == -1) {
-            zip_close(z);
+        if(writeComponent(z, source, cf, COMPONENT_CLASS, writeClass) == -1) {
+            closeZips(z, source);
             return -1;
-        } else
-            printf("Class written\n");
+        }
     }
 
     if(cf->method.tag != 0) {
-        if(writeMethod(z, cf) == -1) {
-            zip_close(z);
+        if(writeComponent(z, source, cf, COMPONENT_METHOD, writeMethod) == -1) {
+            closeZips(z, source);
             return -1;
-        } else
-            printf("Method written\n");
+        }
     }
 
     if(cf->static_field.tag != 0) {
-        if(writeStaticField(z, cf) == -1) {
-            zip_close(z);
+        if(writeComponent(z, source, cf, COMPONENT_STATICFIELD, writeStaticField) == -1) {
+            closeZips(z, source);
             return -1;
-        } else
-            printf("StaticField written\n");
+        }
     }
 
     if(cf->reference_location.tag != 0) {
-        if(writeReferenceLocation(z, cf) == -1) {
-            zip_close(z);
+        if(writeComponent(z, source, cf, COMPONENT_REFERENCELOCATION, writeReferenceLocation) == -1) {
+            closeZips(z, source);
             return -1;
-        } else
-            printf("RefLocation written\n");
+        }
     }
 
     if(cf->export.tag != 0) {
-        if(writeExport(z, cf) == -1) {
-            zip_close(z);
+        if(writeComponent(z, source, cf, COMPONENT_EXPORT, writeExport) == -1) {
+            closeZips(z, source);
             return -1;
-        } else
-            printf("Export written\n");
+        }
     }
 
     if(cf->descriptor.tag != 0) {
-        if(writeDescriptor(z, cf) == -1) {
-            zip_close(z);
+        if(writeComponent(z, source, cf, COMPONENT_DESCRIPTOR, writeDescriptor) == -1) {
+            closeZips(z, source);
             return -1;
-        } else
-            printf("Descriptor written\n");
+        }
     }
 
     if(cf->debug.tag != 0) {
-        if(writeDebug(z, cf) == -1) {
+        if(writeComponent(z, source, cf, COMPONENT_DEBUG, writeDebug) == -1) {
+            closeZips(z, source);
+            return -1;
+        }
+    }
+
+    if(closeZips(z, source) == -1) {
+        fprintf(stderr, "writeCapFile: %s\n", zip_strerror(z));
+        return -1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Read the compressed bytes of an entry, at most len of them. Return the
+ * number of bytes read, -1 if an error occurred.
+ */
+static zip_int64_t readCompressed(struct zip_file* file, char* buffer, zip_uint64_t len) {
+
+    zip_int64_t total = 0;
+
+    while((zip_uint64_t)total < len) {
+        zip_int64_t rc = zip_fread(file, buffer + total, len - total);
+        if(rc == -1)
+            return -1;
+        if(rc == 0)
+            break;
+        total += rc;
+    }
+
+    return total;
+
+}
+
+
+/**
+ * Compare an entry of two CAP files: its size, CRC, compression method and
+ * compressed bytes. Return 1 if the entries are identical or both absent, 0
+ * if they are not and -1 if an error occurred.
+ */
+static int compareEntries(struct zip* z1, struct zip* z2, const char* name) {
+
+    struct zip_stat stat1;
+    struct zip_stat stat2;
+    struct zip_file* file1 = NULL;
+    struct zip_file* file2 = NULL;
+    char buffer1[4096];
+    char buffer2[4096];
+    zip_int64_t len1 = 0;
+    zip_int64_t len2 = 0;
+    int identical = 1;
+
+    if(zip_stat(z1, name, 0, &stat1) == -1)
+        return zip_stat(z2, name, 0, &stat2) == -1;
+
+    if(zip_stat(z2, name, 0, &stat2) == -1)
+        return 0;
+
+    if(!(stat1.valid & stat2.valid & ZIP_STAT_SIZE) || !(stat1.valid & stat2.valid & ZIP_STAT_COMP_SIZE) || !(stat1.valid & stat2.valid & ZIP_STAT_CRC) || !(stat1.valid & stat2.valid & ZIP_STAT_COMP_METHOD)) {
+        fprintf(stderr, "compareEntries: %s | incomplete entry information\n", name);
+        return -1;
+    }
+
+    if((stat1.size != stat2.size) || (stat1.comp_size != stat2.comp_size) || (stat1.crc != stat2.crc) || (stat1.comp_method != stat2.comp_method))
+        return 0;
+
+    if(((file1 = zip_fopen(z1, name, ZIP_FL_COMPRESSED)) == NULL) || ((file2 = zip_fopen(z2, name, ZIP_FL_COMPRESSED)) == NULL)) {
+        fprintf(stderr, "compareEntries: %s | %s\n", name, zip_strerror(file1 == NULL ? z1 : z2));
+        if(file1 != NULL)
+            zip_fclose(file1);
+        return -1;
+    }
+
+    do {
+        len1 = readCompressed(file1, buffer1, sizeof(buffer1));
+        len2 = readCompressed(file2, buffer2, sizeof(buffer2));
+
+        if((len1 == -1) || (len2 == -1)) {
+            fprintf(stderr, "compareEntries: %s | could not read the entry\n", name);
+            identical = -1;
+        } else if((len1 != len2) || (memcmp(buffer1, buffer2, len1) != 0))
+            identical = 0;
+    } while((identical == 1) && (len1 > 0));
+
+    zip_fclose(file1);
+    zip_fclose(file2);
+
+    return identical;
+
+}
+
+
+/**
+ * \brief Check that the components a written CAP file copied from its source
+ * are the same entries, byte for byte and still compressed the same way.
+ *
+ * \param cf The straightforward representation of the written CAP file.
+ * \param filename The path to the written CAP file.
+ *
+ * \return Return -1 if an error occurred, the number of copied components
+ *         which differ from the source else.
+ */
+int check_copied_components(cap_file* cf, const char* filename) {
+
+    int error = 0;
+    int differ = 0;
+    int rc = 0;
+    u1 tag = COMPONENT_MANIFEST;
+    char name[1024];
+    struct zip* z = NULL;
+    struct zip* source = NULL;
+
+    if(cf->source_components == 0)
+        return 0;
+
+    if(cf->source == NULL) {
+        fprintf(stderr, "checkCopiedComponents: no source to compare %s with\n", filename);
+        return -1;
+    }
+
+    if((z = zip_open(filename, 0, &error)) == NULL) {
+        fprintf(stderr, "checkCopiedComponents: could not open %s\n", filename);
+        return -1;
+    }
+
+    if((source = zip_open(cf->source, 0, &error)) == NULL) {
+        fprintf(stderr, "checkCopiedComponents: could not open %s\n", cf->source);
+        zip_close(z);
+        return -1;
+    }
+
+    for(; tag <= COMPONENT_DEBUG; ++tag) {
+        if(!(cf->source_components & COMPONENT_BIT(tag)))
+            continue;
+
+        getEntryName(cf, tag, name);
+        if((rc = compareEntries(z, source, name)) == -1) {
+            zip_close(source);
             zip_close(z);
             return -1;
-        } else
-            printf("Debug written\n");
+        }
+
+        if(rc == 0) {
+            fprintf(stderr, "%s differs from the source\n", componentNames[tag]);
+            ++differ;
+        }
     }
 
+    zip_close(source);
     zip_close(z);
 
-    return 0;
+    return differ;
 
 }
@@ -185,7 +185,7 @@ export_file* read_export_file(const char* filename) {
     u2 indexCP = 0;
     u1 indexClass = 0;
 
-    printf("Starting to read the export file: %s\n", filename);
+    fprintf(stderr, "Starting to read the export file: %s\n", filename);
 
     data = readFile(filename, &length);
     if(data == NULL)
@@ -0,0 +1,226 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file exp_file_serialize.c
+ * \brief Output an export file as a JSON or CBOR document.
+ */
+
+#include "exp_file.h"
+#include "exp_file_serialize.h"
+#include "structured_writer.h"
+
+static const structured_flag class_flags[] = {{EF_ACC_PUBLIC, "ACC_PUBLIC"}, {EF_ACC_FINAL, "ACC_FINAL"}, {EF_ACC_INTERFACE, "ACC_INTERFACE"}, {EF_ACC_ABSTRACT, "ACC_ABSTRACT"}, {EF_ACC_SHAREABLE, "ACC_SHAREABLE"}, {EF_ACC_REMOTE, "ACC_REMOTE"}, {0, NULL}};
+static const structured_flag field_flags[] = {{EF_ACC_PUBLIC, "ACC_PUBLIC"}, {EF_ACC_PROTECTED, "ACC_PROTECTED"}, {EF_ACC_STATIC, "ACC_STATIC"}, {EF_ACC_FINAL, "ACC_FINAL"}, {0, NULL}};
+static const structured_flag method_flags[] = {{EF_ACC_PUBLIC, "ACC_PUBLIC"}, {EF_ACC_PROTECTED, "ACC_PROTECTED"}, {EF_ACC_STATIC, "ACC_STATIC"}, {EF_ACC_FINAL, "ACC_FINAL"}, {EF_ACC_ABSTRACT, "ACC_ABSTRACT"}, {0, NULL}};
+static const structured_flag package_flags[] = {{EF_ACC_LIBRARY, "ACC_LIBRARY"}, {0, NULL}};
+
+
+/**
+ * Write a member holding the string of a CONSTANT_Utf8 entry, if index
+ * designates one.
+ */
+static void write_utf8_member(structured_writer* writer, const char* key, export_file* ef, u2 index) {
+
+    if((index >= ef->constant_pool_count) || (ef->constant_pool[index].tag != EF_CONSTANT_UTF8))
+        return;
+
+    write_key(writer, key);
+    write_string(writer, ef->constant_pool[index].CONSTANT_Utf8.bytes, ef->constant_pool[index].CONSTANT_Utf8.length);
+
+}
+
+
+/**
+ * Write the constant pool.
+ */
+static void write_constant_pool(structured_writer* writer, export_file* ef) {
+
+    u2 u2Index = 0;
+
+    write_key(writer, "constant_pool");
+    begin_array(writer);
+
+    for(; u2Index < ef->constant_pool_count; ++u2Index) {
+        ef_cp_info* entry = ef->constant_pool + u2Index;
+
+        begin_object(writer);
+
+        switch(entry->tag) {
+            case EF_CONSTANT_PACKAGE:
+                write_string_member(writer, "tag", "CONSTANT_Package");
+                write_flags_member(writer, "flags", entry->CONSTANT_Package.flags, package_flags);
+                write_uint_member(writer, "name_index", entry->CONSTANT_Package.name_index);
+                write_uint_member(writer, "minor_version", entry->CONSTANT_Package.minor_version);
+                write_uint_member(writer, "major_version", entry->CONSTANT_Package.major_version);
+                write_bytes_member(writer, "aid", entry->CONSTANT_Package.aid, entry->CONSTANT_Package.aid_length);
+                break;
+
+            case EF_CONSTANT_CLASSREF:
+                write_string_member(writer, "tag", "CONSTANT_Classref");
+                write_uint_member(writer, "name_index", entry->CONSTANT_Classref.name_index);
+                break;
+
+            case EF_CONSTANT_INTEGER:
+                write_string_member(writer, "tag", "CONSTANT_Integer");
+                write_uint_member(writer, "bytes", entry->CONSTANT_Integer.bytes);
+                break;
+
+            case EF_CONSTANT_UTF8:
+                write_string_member(writer, "tag", "CONSTANT_Utf8");
+                write_key(writer, "bytes");
+                write_string(writer, entry->CONSTANT_Utf8.bytes, entry->CONSTANT_Utf8.length);
+                break;
+
+            default:
+                write_uint_member(writer, "tag", entry->tag);
+        }
+
+        end_object(writer);
+    }
+
+    end_array(writer);
+
+}
+
+
+/**
+ * Write an exported class or interface.
+ */
+static void write_class(structured_writer* writer, export_file* ef, ef_class_info* class) {
+
+    u2 u2Index1 = 0;
+
+    begin_object(writer);
+    write_uint_member(writer, "token", class->token);
+    write_flags_member(writer, "access_flags", class->access_flags, class_flags);
+    write_uint_member(writer, "name_index", class->name_index);
+
+    if((class->name_index < ef->constant_pool_count) && (ef->constant_pool[class->name_index].tag == EF_CONSTANT_CLASSREF))
+        write_utf8_member(writer, "name", ef, ef->constant_pool[class->name_index].CONSTANT_Classref.name_index);
+
+    write_key(writer, "supers");
+    begin_array(writer);
+
+    for(; u2Index1 < class->export_supers_count; ++u2Index1)
+        write_uint(writer, class->supers[u2Index1]);
+
+    end_array(writer);
+    write_key(writer, "interfaces");
+    begin_array(writer);
+
+    for(u2Index1 = 0; u2Index1 < class->export_interfaces_count; ++u2Index1)
+        write_uint(writer, class->interfaces[u2Index1]);
+
+    end_array(writer);
+    write_key(writer, "fields");
+    begin_array(writer);
+
+    for(u2Index1 = 0; u2Index1 < class->export_fields_count; ++u2Index1) {
+        ef_field_info* field = class->fields + u2Index1;
+        u2 u2Index2 = 0;
+
+        begin_object(writer);
+        write_uint_member(writer, "token", field->token);
+        write_flags_member(writer, "access_flags", field->access_flags, field_flags);
+        write_uint_member(writer, "name_index", field->name_index);
+        write_utf8_member(writer, "name", ef, field->name_index);
+        write_uint_member(writer, "descriptor_index", field->descriptor_index);
+        write_utf8_member(writer, "descriptor", ef, field->descriptor_index);
+        write_key(writer, "attributes");
+        begin_array(writer);
+
+        for(; u2Index2 < field->attributes_count; ++u2Index2) {
+            begin_object(writer);
+            write_uint_member(writer, "attribute_name_index", field->attributes[u2Index2].attribute_name_index);
+            write_uint_member(writer, "attribute_length", field->attributes[u2Index2].attribute_length);
+            write_uint_member(writer, "constantvalue_index", field->attributes[u2Index2].constantvalue_index);
+            end_object(writer);
+        }
+
+        end_array(writer);
+        end_object(writer);
+    }
+
+    end_array(writer);
+    write_key(writer, "methods");
+    begin_array(writer);
+
+    for(u2Index1 = 0; u2Index1 < class->export_methods_count; ++u2Index1) {
+        ef_method_info* method = class->methods + u2Index1;
+
+        begin_object(writer);
+        write_uint_member(writer, "token", method->token);
+        write_flags_member(writer, "access_flags", method->access_flags, method_flags);
+        write_uint_member(writer, "name_index", method->name_index);
+        write_utf8_member(writer, "name", ef, method->name_index);
+        write_uint_member(writer, "descriptor_index", method->descriptor_index);
+        write_utf8_member(writer, "descriptor", ef, method->descriptor_index);
+        end_object(writer);
+    }
+
+    end_array(writer);
+    end_object(writer);
+
+}
+
+
+int serialize_export_file(structured_writer* writer, export_file* ef) {
+
+    u1 u1Index = 0;
+
+    begin_object(writer);
+    write_uint_member(writer, "magic", ef->magic);
+    write_uint_member(writer, "minor_version", ef->minor_version);
+    write_uint_member(writer, "major_version", ef->major_version);
+    write_constant_pool(writer, ef);
+    write_uint_member(writer, "this_package", ef->this_package);
+    write_key(writer, "classes");
+    begin_array(writer);
+
+    for(; u1Index < ef->export_class_count; ++u1Index)
+        write_class(writer, ef, ef->classes + u1Index);
+
+    end_array(writer);
+    end_object(writer);
+
+    return writer->has_failed ? -1 : 0;
+
+}
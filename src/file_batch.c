@@ -0,0 +1,421 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file file_batch.c
+ * \brief Run a function on many input files on a pool of worker threads
+ * while keeping the output in the order of the inputs.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <linux/limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "file_batch.h"
+#include "verbose_sink.h"
+
+
+/**
+ * Output of one input file, waiting to be handed over in order.
+ */
+typedef struct {
+    int is_done;
+    int ret;
+    verbose_sink output;
+    verbose_sink report;
+} file_batch_slot;
+
+
+/**
+ * State shared by the worker threads.
+ */
+typedef struct {
+    char* const* filenames;
+    int nb_filenames;
+    file_batch_function function;
+    void* data;
+    file_batch_slot* slots;
+    int nb_slots;
+    int next;
+    int emitted;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} file_batch_state;
+
+
+/**
+ * Add a copy of a file name to an array of file names.
+ */
+static int add_filename(const char* filename, char*** filenames, int* nb_filenames) {
+
+    char** tmp = NULL;
+    char* copy = (char*)malloc(strlen(filename) + 1);
+
+    if(copy == NULL) {
+        perror("add_filename");
+        return -1;
+    }
+
+    strcpy(copy, filename);
+
+    tmp = (char**)realloc(*filenames, sizeof(char*) * (*nb_filenames + 1));
+    if(tmp == NULL) {
+        perror("add_filename");
+        free(copy);
+        return -1;
+    }
+    *filenames = tmp;
+
+    (*filenames)[*nb_filenames] = copy;
+    ++(*nb_filenames);
+
+    return 0;
+
+}
+
+
+/**
+ * Compare two file names for qsort().
+ */
+static int compare_filenames(const void* a, const void* b) {
+
+    return strcmp(*(char* const*)a, *(char* const*)b);
+
+}
+
+
+/**
+ * Recursively add the regular files with the given extension found in a
+ * directory.
+ */
+static int add_directory(const char* directory, const char* extension, char*** filenames, int* nb_filenames) {
+
+    char* path = NULL;
+    struct dirent* crt_entry = NULL;
+    size_t directory_length = strlen(directory);
+    size_t extension_length = (extension == NULL) ? 0 : strlen(extension);
+    DIR* crt_dir = opendir(directory);
+    int ret = 0;
+
+    if(crt_dir == NULL) {
+        perror(directory);
+        return -1;
+    }
+
+    if(directory[directory_length - 1] != '/')
+        ++directory_length;
+
+    path = (char*)malloc(directory_length + NAME_MAX + 1);
+    if(path == NULL) {
+        perror("add_directory");
+        closedir(crt_dir);
+        return -1;
+    }
+
+    strcpy(path, directory);
+    path[directory_length - 1] = '/';
+
+    while((ret == 0) && ((crt_entry = readdir(crt_dir)) != NULL)) {
+        struct stat stat_buf;
+        size_t path_length = 0;
+
+        if((strcmp(crt_entry->d_name, ".") == 0) || (strcmp(crt_entry->d_name, "..") == 0))
+            continue;
+
+        path[directory_length] = '\0';
+        strcat(path, crt_entry->d_name);
+        path_length = strlen(path);
+
+        if(stat(path, &stat_buf) == -1)
+            continue;
+
+        if(S_ISDIR(stat_buf.st_mode))
+            ret = add_directory(path, extension, filenames, nb_filenames);
+        else if(S_ISREG(stat_buf.st_mode) && ((extension == NULL) || ((path_length > extension_length) && (strcmp(path + path_length - extension_length, extension) == 0))))
+            ret = add_filename(path, filenames, nb_filenames);
+    }
+
+    closedir(crt_dir);
+    free(path);
+
+    return ret;
+
+}
+
+
+/**
+ * Add the file names listed in a file, one per line.
+ */
+static int add_list(const char* list, char*** filenames, int* nb_filenames) {
+
+    char line[PATH_MAX + 2];
+    FILE* file = fopen(list, "r");
+    int ret = 0;
+
+    if(file == NULL) {
+        perror(list);
+        return -1;
+    }
+
+    while((ret == 0) && (fgets(line, sizeof(line), file) != NULL)) {
+        size_t length = strlen(line);
+
+        while((length > 0) && ((line[length - 1] == '\n') || (line[length - 1] == '\r')))
+            line[--length] = '\0';
+
+        if(length != 0)
+            ret = add_filename(line, filenames, nb_filenames);
+    }
+
+    fclose(file);
+
+    return ret;
+
+}
+
+
+char** get_file_batch(char* const* arguments, int nb_arguments, const char* extension, int* nb_filenames) {
+
+    char** filenames = NULL;
+    int i = 0;
+
+    *nb_filenames = 0;
+
+    for(; i < nb_arguments; ++i) {
+        struct stat stat_buf;
+        int first = *nb_filenames;
+        int ret = 0;
+
+        if(arguments[i][0] == '@') {
+            ret = add_list(arguments[i] + 1, &filenames, nb_filenames);
+        } else if((stat(arguments[i], &stat_buf) != -1) && S_ISDIR(stat_buf.st_mode)) {
+            ret = add_directory(arguments[i], extension, &filenames, nb_filenames);
+            if(ret == 0)
+                qsort(filenames + first, *nb_filenames - first, sizeof(char*), compare_filenames);
+        } else {
+            ret = add_filename(arguments[i], &filenames, nb_filenames);
+        }
+
+        if(ret == -1) {
+            free_file_batch(filenames, *nb_filenames);
+            *nb_filenames = 0;
+            return NULL;
+        }
+    }
+
+    if(filenames == NULL)
+        fprintf(stderr, "No input file\n");
+
+    return filenames;
+
+}
+
+
+void free_file_batch(char** filenames, int nb_filenames) {
+
+    int i = 0;
+
+    if(filenames == NULL)
+        return;
+
+    for(; i < nb_filenames; ++i)
+        free(filenames[i]);
+
+    free(filenames);
+
+}
+
+
+/**
+ * Take the next files whose slots are free and process them until every file
+ * has been taken.
+ */
+static void* run_worker(void* arg) {
+
+    file_batch_state* state = (file_batch_state*)arg;
+
+    pthread_mutex_lock(&(state->lock));
+
+    while(1) {
+        file_batch_slot* slot = NULL;
+        int index = 0;
+        int ret = 0;
+
+        while((state->next < state->nb_filenames) && (state->next >= state->emitted + state->nb_slots))
+            pthread_cond_wait(&(state->changed), &(state->lock));
+
+        if(state->next >= state->nb_filenames)
+            break;
+
+        index = state->next++;
+        slot = state->slots + (index % state->nb_slots);
+
+        pthread_mutex_unlock(&(state->lock));
+
+        init_memory_sink(&(slot->output));
+        init_memory_sink(&(slot->report));
+        ret = state->function(state->filenames[index], &(slot->output), &(slot->report), state->data);
+        if((flush_verbose_sink(&(slot->output)) == -1) || (flush_verbose_sink(&(slot->report)) == -1))
+            ret = -1;
+
+        pthread_mutex_lock(&(state->lock));
+
+        slot->ret = ret;
+        slot->is_done = 1;
+        pthread_cond_broadcast(&(state->changed));
+    }
+
+    pthread_mutex_unlock(&(state->lock));
+
+    return NULL;
+
+}
+
+
+/**
+ * Process every file in the calling thread.
+ */
+static int process_in_order(char* const* filenames, int nb_filenames, file_batch_function function, void* data, verbose_sink* output, verbose_sink* report) {
+
+    int failed = 0;
+    int i = 0;
+
+    for(; i < nb_filenames; ++i) {
+        if(nb_filenames > 1)
+            sink_printf(output, "==> %s <==\n", filenames[i]);
+
+        if(function(filenames[i], output, report, data) == -1)
+            ++failed;
+    }
+
+    return failed;
+
+}
+
+
+int process_file_batch(char* const* filenames, int nb_filenames, int nb_workers, file_batch_function function, void* data, verbose_sink* output, verbose_sink* report) {
+
+    file_batch_state state;
+    pthread_t* workers = NULL;
+    int nb_started = 0;
+    int failed = 0;
+    int i = 0;
+
+    if(nb_workers > nb_filenames)
+        nb_workers = nb_filenames;
+
+    if(nb_workers <= 1)
+        return process_in_order(filenames, nb_filenames, function, data, output, report);
+
+    state.filenames = filenames;
+    state.nb_filenames = nb_filenames;
+    state.function = function;
+    state.data = data;
+    state.nb_slots = nb_workers * FILE_BATCH_WINDOW_FACTOR;
+    state.next = 0;
+    state.emitted = 0;
+
+    state.slots = (file_batch_slot*)calloc(state.nb_slots, sizeof(file_batch_slot));
+    workers = (pthread_t*)malloc(sizeof(pthread_t) * nb_workers);
+    if((state.slots == NULL) || (workers == NULL)) {
+        perror("process_file_batch");
+        free(state.slots);
+        free(workers);
+        return -1;
+    }
+
+    pthread_mutex_init(&(state.lock), NULL);
+    pthread_cond_init(&(state.changed), NULL);
+
+    for(; nb_started < nb_workers; ++nb_started)
+        if(pthread_create(workers + nb_started, NULL, run_worker, &state) != 0)
+            break;
+
+    if(nb_started == 0) {
+        fprintf(stderr, "Could not start the workers\n");
+        pthread_cond_destroy(&(state.changed));
+        pthread_mutex_destroy(&(state.lock));
+        free(state.slots);
+        free(workers);
+        return process_in_order(filenames, nb_filenames, function, data, output, report);
+    }
+
+    for(; i < nb_filenames; ++i) {
+        file_batch_slot* slot = state.slots + (i % state.nb_slots);
+
+        pthread_mutex_lock(&(state.lock));
+        while(!slot->is_done)
+            pthread_cond_wait(&(state.changed), &(state.lock));
+        pthread_mutex_unlock(&(state.lock));
+
+        sink_printf(output, "==> %s <==\n", filenames[i]);
+        sink_write(output, slot->output.memory, slot->output.memory_length);
+        sink_write(report, slot->report.memory, slot->report.memory_length);
+
+        if(slot->ret == -1)
+            ++failed;
+
+        free_verbose_sink(&(slot->output));
+        free_verbose_sink(&(slot->report));
+
+        pthread_mutex_lock(&(state.lock));
+        slot->is_done = 0;
+        ++state.emitted;
+        pthread_cond_broadcast(&(state.changed));
+        pthread_mutex_unlock(&(state.lock));
+    }
+
+    for(i = 0; i < nb_started; ++i)
+        pthread_join(workers[i], NULL);
+
+    pthread_cond_destroy(&(state.changed));
+    pthread_mutex_destroy(&(state.lock));
+    free(state.slots);
+    free(workers);
+
+    return failed;
+
+}
@@ -0,0 +1,510 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file structured_writer.c
+ * \brief Stream JSON or CBOR documents to a verbose_sink.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "structured_writer.h"
+
+#define CBOR_UNSIGNED   0x00    /**< Major type of unsigned integers. */
+#define CBOR_NEGATIVE   0x20    /**< Major type of negative integers. */
+#define CBOR_BYTES      0x40    /**< Major type of byte strings. */
+#define CBOR_TEXT       0x60    /**< Major type of text strings. */
+#define CBOR_ARRAY      0x9F    /**< Start of an indefinite length array. */
+#define CBOR_MAP        0xBF    /**< Start of an indefinite length map. */
+#define CBOR_FALSE      0xF4    /**< false. */
+#define CBOR_TRUE       0xF5    /**< true. */
+#define CBOR_NULL       0xF6    /**< null. */
+#define CBOR_BREAK      0xFF    /**< End of an indefinite length item. */
+
+
+void init_structured_writer(structured_writer* writer, verbose_sink* sink, u1 format) {
+
+    writer->sink = sink;
+    writer->format = format;
+    writer->depth = 0;
+    writer->has_failed = 0;
+    writer->after_key = 0;
+    writer->has_elements[0] = 0;
+
+}
+
+
+/**
+ * Output some bytes, recording a failure.
+ */
+static int output(structured_writer* writer, const char* bytes, size_t length) {
+
+    if(writer->has_failed)
+        return -1;
+
+    if(sink_write(writer->sink, bytes, length) == -1) {
+        writer->has_failed = 1;
+        return -1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Output a CBOR initial byte and the following argument bytes.
+ */
+static int output_cbor_head(structured_writer* writer, u1 major, u4 value) {
+
+    char head[5];
+
+    if(value < 24) {
+        head[0] = (char)(major | value);
+        return output(writer, head, 1);
+    }
+
+    if(value <= 0xFF) {
+        head[0] = (char)(major | 24);
+        head[1] = (char)value;
+        return output(writer, head, 2);
+    }
+
+    if(value <= 0xFFFF) {
+        head[0] = (char)(major | 25);
+        head[1] = (char)(value >> 8);
+        head[2] = (char)value;
+        return output(writer, head, 3);
+    }
+
+    head[0] = (char)(major | 26);
+    head[1] = (char)(value >> 24);
+    head[2] = (char)(value >> 16);
+    head[3] = (char)(value >> 8);
+    head[4] = (char)value;
+    return output(writer, head, 5);
+
+}
+
+
+/**
+ * Output a new line followed by the indentation of the current depth.
+ */
+static int output_json_line(structured_writer* writer) {
+
+    static const char tabs[STRUCTURED_MAX_DEPTH + 2] = "\n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+
+    return output(writer, tabs, writer->depth + 1);
+
+}
+
+
+/**
+ * Output what comes before a value in JSON: nothing after a key, else a
+ * separator and a new line.
+ */
+static int begin_json_value(structured_writer* writer) {
+
+    if(writer->after_key) {
+        writer->after_key = 0;
+        return 0;
+    }
+
+    if(writer->has_elements[writer->depth] && (output(writer, ",", 1) == -1))
+        return -1;
+
+    writer->has_elements[writer->depth] = 1;
+
+    if(writer->depth == 0)
+        return 0;
+
+    return output_json_line(writer);
+
+}
+
+
+/**
+ * Open an object or an array.
+ */
+static int begin_container(structured_writer* writer, char json_start, u1 cbor_start) {
+
+    if(writer->has_failed)
+        return -1;
+
+    if(writer->depth == STRUCTURED_MAX_DEPTH) {
+        fprintf(stderr, "Structured document nested too deeply\n");
+        writer->has_failed = 1;
+        return -1;
+    }
+
+    if(writer->format == STRUCTURED_CBOR) {
+        char start = (char)cbor_start;
+
+        if(output(writer, &start, 1) == -1)
+            return -1;
+    } else if((begin_json_value(writer) == -1) || (output(writer, &json_start, 1) == -1)) {
+        return -1;
+    }
+
+    writer->has_elements[++writer->depth] = 0;
+
+    return 0;
+
+}
+
+
+/**
+ * Close an object or an array.
+ */
+static int end_container(structured_writer* writer, char json_end) {
+
+    char cbor_end = (char)CBOR_BREAK;
+
+    if(writer->has_failed)
+        return -1;
+
+    if(writer->depth == 0) {
+        fprintf(stderr, "No structured object or array to close\n");
+        writer->has_failed = 1;
+        return -1;
+    }
+
+    --writer->depth;
+
+    if(writer->format == STRUCTURED_CBOR)
+        return output(writer, &cbor_end, 1);
+
+    if(writer->has_elements[writer->depth + 1] && (output_json_line(writer) == -1))
+        return -1;
+
+    return output(writer, &json_end, 1);
+
+}
+
+
+int begin_object(structured_writer* writer) {
+
+    return begin_container(writer, '{', CBOR_MAP);
+
+}
+
+
+int end_object(structured_writer* writer) {
+
+    return end_container(writer, '}');
+
+}
+
+
+int begin_array(structured_writer* writer) {
+
+    return begin_container(writer, '[', CBOR_ARRAY);
+
+}
+
+
+int end_array(structured_writer* writer) {
+
+    return end_container(writer, ']');
+
+}
+
+
+/**
+ * Output a JSON string literal, escaping what must be.
+ */
+static int output_json_string(structured_writer* writer, const u1* text, u4 length) {
+
+    u4 start = 0;
+    u4 u4Index = 0;
+
+    if(output(writer, "\"", 1) == -1)
+        return -1;
+
+    for(; u4Index < length; ++u4Index) {
+        char escape[7];
+
+        if((text[u4Index] >= 0x20) && (text[u4Index] != '"') && (text[u4Index] != '\\'))
+            continue;
+
+        if(output(writer, (const char*)text + start, u4Index - start) == -1)
+            return -1;
+
+        if((text[u4Index] == '"') || (text[u4Index] == '\\')) {
+            escape[0] = '\\';
+            escape[1] = (char)text[u4Index];
+            escape[2] = '\0';
+        } else {
+            sprintf(escape, "\\u%.4X", text[u4Index]);
+        }
+
+        if(output(writer, escape, strlen(escape)) == -1)
+            return -1;
+
+        start = u4Index + 1;
+    }
+
+    if(output(writer, (const char*)text + start, length - start) == -1)
+        return -1;
+
+    return output(writer, "\"", 1);
+
+}
+
+
+int write_key(structured_writer* writer, const char* key) {
+
+    if(writer->has_failed)
+        return -1;
+
+    if(writer->format == STRUCTURED_CBOR) {
+        if(output_cbor_head(writer, CBOR_TEXT, strlen(key)) == -1)
+            return -1;
+        return output(writer, key, strlen(key));
+    }
+
+    if(writer->has_elements[writer->depth] && (output(writer, ",", 1) == -1))
+        return -1;
+
+    writer->has_elements[writer->depth] = 1;
+
+    if((output_json_line(writer) == -1) || (output_json_string(writer, (const u1*)key, strlen(key)) == -1) || (output(writer, ": ", 2) == -1))
+        return -1;
+
+    writer->after_key = 1;
+
+    return 0;
+
+}
+
+
+int write_uint(structured_writer* writer, u4 value) {
+
+    char number[16];
+
+    if(writer->has_failed)
+        return -1;
+
+    if(writer->format == STRUCTURED_CBOR)
+        return output_cbor_head(writer, CBOR_UNSIGNED, value);
+
+    if(begin_json_value(writer) == -1)
+        return -1;
+
+    sprintf(number, "%lu", (unsigned long)value);
+
+    return output(writer, number, strlen(number));
+
+}
+
+
+int write_int(structured_writer* writer, int32_t value) {
+
+    char number[16];
+
+    if(writer->has_failed)
+        return -1;
+
+    if(writer->format == STRUCTURED_CBOR) {
+        if(value < 0)
+            return output_cbor_head(writer, CBOR_NEGATIVE, (u4)(-1 - value));
+        return output_cbor_head(writer, CBOR_UNSIGNED, (u4)value);
+    }
+
+    if(begin_json_value(writer) == -1)
+        return -1;
+
+    sprintf(number, "%ld", (long)value);
+
+    return output(writer, number, strlen(number));
+
+}
+
+
+int write_bool(structured_writer* writer, char value) {
+
+    char cbor_value = (char)(value ? CBOR_TRUE : CBOR_FALSE);
+
+    if(writer->has_failed)
+        return -1;
+
+    if(writer->format == STRUCTURED_CBOR)
+        return output(writer, &cbor_value, 1);
+
+    if(begin_json_value(writer) == -1)
+        return -1;
+
+    return value ? output(writer, "true", 4) : output(writer, "false", 5);
+
+}
+
+
+int write_null(structured_writer* writer) {
+
+    char cbor_value = (char)CBOR_NULL;
+
+    if(writer->has_failed)
+        return -1;
+
+    if(writer->format == STRUCTURED_CBOR)
+        return output(writer, &cbor_value, 1);
+
+    if(begin_json_value(writer) == -1)
+        return -1;
+
+    return output(writer, "null", 4);
+
+}
+
+
+int write_string(structured_writer* writer, const u1* text, u4 length) {
+
+    if(writer->has_failed)
+        return -1;
+
+    if(writer->format == STRUCTURED_CBOR) {
+        if(output_cbor_head(writer, CBOR_TEXT, length) == -1)
+            return -1;
+        return output(writer, (const char*)text, length);
+    }
+
+    if(begin_json_value(writer) == -1)
+        return -1;
+
+    return output_json_string(writer, text, length);
+
+}
+
+
+int write_bytes(structured_writer* writer, const u1* bytes, u4 length) {
+
+    static const char digits[] = "0123456789ABCDEF";
+    u4 u4Index = 0;
+
+    if(writer->has_failed)
+        return -1;
+
+    if(writer->format == STRUCTURED_CBOR) {
+        if(output_cbor_head(writer, CBOR_BYTES, length) == -1)
+            return -1;
+        return output(writer, (const char*)bytes, length);
+    }
+
+    if((begin_json_value(writer) == -1) || (output(writer, "\"", 1) == -1))
+        return -1;
+
+    for(; u4Index < length; ++u4Index) {
+        char hex[2];
+
+        hex[0] = digits[bytes[u4Index] >> 4];
+        hex[1] = digits[bytes[u4Index] & 0x0F];
+
+        if(output(writer, hex, 2) == -1)
+            return -1;
+    }
+
+    return output(writer, "\"", 1);
+
+}
+
+
+int write_uint_member(structured_writer* writer, const char* key, u4 value) {
+
+    if(write_key(writer, key) == -1)
+        return -1;
+
+    return write_uint(writer, value);
+
+}
+
+
+int write_string_member(structured_writer* writer, const char* key, const char* text) {
+
+    if(write_key(writer, key) == -1)
+        return -1;
+
+    return write_string(writer, (const u1*)text, strlen(text));
+
+}
+
+
+int write_bytes_member(structured_writer* writer, const char* key, const u1* bytes, u4 length) {
+
+    if(write_key(writer, key) == -1)
+        return -1;
+
+    return write_bytes(writer, bytes, length);
+
+}
+
+
+int write_flags_member(structured_writer* writer, const char* key, u2 flags, const structured_flag* names) {
+
+    if((write_key(writer, key) == -1) || (begin_array(writer) == -1))
+        return -1;
+
+    for(; names->name != NULL; ++names)
+        if((flags & names->mask) && (write_string(writer, (const u1*)names->name, strlen(names->name)) == -1))
+            return -1;
+
+    return end_array(writer);
+
+}
+
+
+int end_document(structured_writer* writer) {
+
+    if(writer->has_failed)
+        return -1;
+
+    if(writer->depth != 0) {
+        fprintf(stderr, "Structured document ended with %u object(s) or array(s) still open\n", writer->depth);
+        writer->has_failed = 1;
+        return -1;
+    }
+
+    if(writer->format == STRUCTURED_JSON)
+        return output(writer, "\n", 1);
+
+    return 0;
+
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file verbose_sink.c
+ * \brief Buffered destination of the output of the verbose_* functions.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "verbose_sink.h"
+
+
+/**
+ * Initialize the parts common to every sink.
+ */
+static void init_sink(verbose_sink* sink, u1 type) {
+
+    sink->type = type;
+    sink->has_failed = 0;
+    sink->file = NULL;
+    sink->memory = NULL;
+    sink->memory_length = 0;
+    sink->memory_capacity = 0;
+    sink->callback = NULL;
+    sink->callback_data = NULL;
+    sink->buffer_length = 0;
+
+}
+
+
+void init_file_sink(verbose_sink* sink, FILE* file) {
+
+    init_sink(sink, VERBOSE_SINK_FILE);
+    sink->file = file;
+
+}
+
+
+void init_memory_sink(verbose_sink* sink) {
+
+    init_sink(sink, VERBOSE_SINK_MEMORY);
+
+}
+
+
+void init_callback_sink(verbose_sink* sink, verbose_sink_callback callback, void* data) {
+
+    init_sink(sink, VERBOSE_SINK_CALLBACK);
+    sink->callback = callback;
+    sink->callback_data = data;
+
+}
+
+
+/**
+ * Hand some bytes over to the destination of the sink, bypassing the buffer.
+ */
+static int output_bytes(verbose_sink* sink, const char* bytes, size_t length) {
+
+    if(length == 0)
+        return 0;
+
+    switch(sink->type) {
+        case VERBOSE_SINK_FILE:
+            if(fwrite(bytes, 1, length, sink->file) != length) {
+                perror("output_bytes");
+                return -1;
+            }
+            return 0;
+
+        case VERBOSE_SINK_MEMORY:
+            if(sink->memory_length + length + 1 > sink->memory_capacity) {
+                size_t capacity = (sink->memory_capacity == 0) ? VERBOSE_SINK_BUFFER_SIZE : sink->memory_capacity;
+                char* tmp = NULL;
+
+                while(sink->memory_length + length + 1 > capacity)
+                    capacity *= 2;
+
+                tmp = (char*)realloc(sink->memory, capacity);
+                if(tmp == NULL) {
+                    perror("output_bytes");
+                    return -1;
+                }
+                sink->memory = tmp;
+                sink->memory_capacity = capacity;
+            }
+
+            memcpy(sink->memory + sink->memory_length, bytes, length);
+            sink->memory_length += length;
+            sink->memory[sink->memory_length] = '\0';
+            return 0;
+
+        case VERBOSE_SINK_CALLBACK:
+            return sink->callback(sink->callback_data, bytes, length);
+
+        default:
+            fprintf(stderr, "Invalid sink\n");
+            return -1;
+    }
+
+}
+
+
+int flush_verbose_sink(verbose_sink* sink) {
+
+    if(!sink->has_failed && (output_bytes(sink, sink->buffer, sink->buffer_length) == -1))
+        sink->has_failed = 1;
+
+    sink->buffer_length = 0;
+
+    if(!sink->has_failed && (sink->type == VERBOSE_SINK_FILE) && (fflush(sink->file) == EOF)) {
+        perror("flush_verbose_sink");
+        sink->has_failed = 1;
+    }
+
+    return sink->has_failed ? -1 : 0;
+
+}
+
+
+int sink_write(verbose_sink* sink, const char* bytes, size_t length) {
+
+    if(sink->has_failed)
+        return -1;
+
+    if(sink->buffer_length + length > VERBOSE_SINK_BUFFER_SIZE) {
+        if(flush_verbose_sink(sink) == -1)
+            return -1;
+
+        /* Too large to be worth buffering. */
+        if(length > VERBOSE_SINK_BUFFER_SIZE) {
+            if(output_bytes(sink, bytes, length) == -1) {
+                sink->has_failed = 1;
+                return -1;
+            }
+            return 0;
+        }
+    }
+
+    memcpy(sink->buffer + sink->buffer_length, bytes, length);
+    sink->buffer_length += length;
+
+    return 0;
+
+}
+
+
+int sink_printf(verbose_sink* sink, const char* format, ...) {
+
+    va_list args;
+    int length = 0;
+    char* large = NULL;
+
+    if(sink->has_failed)
+        return -1;
+
+    va_start(args, format);
+    length = vsnprintf(sink->buffer + sink->buffer_length, VERBOSE_SINK_BUFFER_SIZE - sink->buffer_length, format, args);
+    va_end(args);
+
+    if(length < 0) {
+        perror("sink_printf");
+        sink->has_failed = 1;
+        return -1;
+    }
+
+    if((size_t)length < VERBOSE_SINK_BUFFER_SIZE - sink->buffer_length) {
+        sink->buffer_length += length;
+        return 0;
+    }
+
+    /* The output did not fit, it is formatted again once there is room. */
+    if(flush_verbose_sink(sink) == -1)
+        return -1;
+
+    if((size_t)length < VERBOSE_SINK_BUFFER_SIZE) {
+        va_start(args, format);
+        vsnprintf(sink->buffer, VERBOSE_SINK_BUFFER_SIZE, format, args);
+        va_end(args);
+        sink->buffer_length = length;
+        return 0;
+    }
+
+    large = (char*)malloc(length + 1);
+    if(large == NULL) {
+        perror("sink_printf");
+        sink->has_failed = 1;
+        return -1;
+    }
+
+    va_start(args, format);
+    vsnprintf(large, length + 1, format, args);
+    va_end(args);
+
+    if(output_bytes(sink, large, length) == -1)
+        sink->has_failed = 1;
+
+    free(large);
+
+    return sink->has_failed ? -1 : 0;
+
+}
+
+
+void free_verbose_sink(verbose_sink* sink) {
+
+    free(sink->memory);
+    sink->memory = NULL;
+    sink->memory_length = 0;
+    sink->memory_capacity = 0;
+    sink->buffer_length = 0;
+
+}
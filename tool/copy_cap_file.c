@@ -0,0 +1,103 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file copy_cap_file.c
+ * \brief Read, parse and analyze a .CAP file, then generate and write it again
+ * copying the unchanged components from the source and check they come out
+ * byte for byte identical.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <exp_file.h>
+#include <cap_file.h>
+#include <analyzed_cap_file.h>
+#include <cap_file_reader.h>
+#include <cap_file_analyze.h>
+#include <cap_file_generate.h>
+#include <cap_file_writer.h>
+
+
+int main(int argc, char* argv[]) {
+
+    cap_file* cf = NULL;
+    cap_file* new_cf = NULL;
+    analyzed_cap_file* acf = NULL;
+    export_file** export_files = NULL;
+    int nb_export_files = 0;
+    int differ = 0;
+
+    if(argc < 4) {
+        fprintf(stderr, "Usage: %s exp_files_directory [exp_files_directory] filename copied_filename\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if((cf = read_cap_file(argv[argc - 2])) == NULL)
+        return EXIT_FAILURE;
+
+    export_files = get_export_files_from_directories(argv + 1, argc - 3, &nb_export_files);
+
+    if((acf = analyze_cap_file(cf, export_files, nb_export_files)) == NULL)
+        return EXIT_FAILURE;
+
+    if(((new_cf = generate_cap_file_with_flags(acf, GENERATE_COPY_UNCHANGED, NULL)) == NULL) || (write_cap_file(new_cf, argv[argc - 1]) == -1))
+        return EXIT_FAILURE;
+
+    /* Nothing changed since the analysis so every component is copied. */
+    if(new_cf->source_components != ALL_COMPONENTS) {
+        fprintf(stderr, "Some components of %s were generated again\n", argv[argc - 2]);
+        return EXIT_FAILURE;
+    }
+
+    if((differ = check_copied_components(new_cf, argv[argc - 1])) == -1)
+        return EXIT_FAILURE;
+
+    if(differ != 0) {
+        fprintf(stderr, "%d copied component(s) differ from %s\n", differ, argv[argc - 2]);
+        return EXIT_FAILURE;
+    }
+
+    printf("Every component of %s copied as it is\n", argv[argc - 1]);
+
+    return EXIT_SUCCESS;
+
+}
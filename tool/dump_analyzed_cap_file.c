@@ -40,67 +40,146 @@
 
 /**
  * \file dump_analyzed_cap_file.c
- * \brief Read, parse, analyze and output a .CAP file.
+ * \brief Read, parse, analyze and output .CAP files.
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <exp_file.h>
 #include <cap_file.h>
 #include <cap_file_reader.h>
 #include <analyzed_cap_file.h>
 #include <cap_file_analyze.h>
+#include <cap_file_cache.h>
+#include <analyzed_cap_file_snapshot.h>
 #include <analyzed_cap_file_verbose.h>
+#include <file_batch.h>
 
 
-int main(int argc, char* argv[]) {
+/**
+ * What is shared by the analyses of all the inputs.
+ */
+typedef struct {
+    export_file** export_files;
+    int nb_export_files;
+    char* cache_directory;
+    char* snapshot_filename;
+} dump_options;
+
+
+/**
+ * Read, analyze and output one CAP file.
+ */
+static int dump_analyzed_cap_file(const char* filename, verbose_sink* output, verbose_sink* report, void* data) {
 
+    dump_options* options = (dump_options*)data;
     cap_file* cf = NULL;
     analyzed_cap_file* acf = NULL;
 
-    int i = 0;
-    char** directories = NULL;
+    (void)report;
+
+    if(options->cache_directory != NULL)
+        acf = read_and_analyze_cap_file(options->cache_directory, filename, options->export_files, options->nb_export_files);
+    else if((cf = read_cap_file(filename)) != NULL)
+        acf = analyze_cap_file(cf, options->export_files, options->nb_export_files);
+
+    free_cap_file(cf);
+
+    if(acf == NULL)
+        return -1;
+
+    if((options->snapshot_filename != NULL) && (write_analyzed_cap_file_snapshot(options->snapshot_filename, acf) == -1)) {
+        free_analyzed_cap_file(acf);
+        return -1;
+    }
+
+    verbose_constant_info(output, acf);
+    sink_printf(output, "\n");
+    verbose_imported_package(output, acf);
+    sink_printf(output, "\n");
+    verbose_constant_pool(output, acf);
+    sink_printf(output, "\n");
+    verbose_signature_pool(output, acf);
+    sink_printf(output, "\n");
+    verbose_interfaces(output, acf);
+    sink_printf(output, "\n");
+    verbose_classes(output, acf);
+    sink_printf(output, "\n");
+    verbose_exception_handlers(output, acf);
+
+    free_analyzed_cap_file(acf);
+
+    return 0;
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+    verbose_sink sink;
+    verbose_sink report;
+    dump_options options;
+
+    char** filenames = NULL;
+    int nb_filenames = 0;
+    int nb_workers = 1;
     int nb_directories = 0;
-    export_file** export_files = NULL;
-    int nb_export_files = 0;
+    int first_input = 0;
+    int first_directory = 1;
+    int failed = 0;
+
+    options.cache_directory = NULL;
+    options.snapshot_filename = NULL;
+
+    while((first_directory + 1 < argc) && (argv[first_directory][0] == '-')) {
+        if(strcmp(argv[first_directory], "-c") == 0)
+            options.cache_directory = argv[first_directory + 1];
+        else if(strcmp(argv[first_directory], "-o") == 0)
+            options.snapshot_filename = argv[first_directory + 1];
+        else if(strcmp(argv[first_directory], "-j") == 0)
+            nb_workers = atoi(argv[first_directory + 1]);
+        else
+            break;
+
+        first_directory += 2;
+    }
 
-    if(argc < 3) {
-        fprintf(stderr, "Usage: %s exp_files_directory [exp_files_directory] filename\n", argv[0]);
+    /* The inputs follow a -- or, without it, are the last argument. */
+    for(first_input = first_directory; (first_input < argc) && (strcmp(argv[first_input], "--") != 0); ++first_input);
+
+    if(first_input < argc) {
+        nb_directories = first_input - first_directory;
+        ++first_input;
+    } else {
+        first_input = argc - 1;
+        nb_directories = first_input - first_directory;
+    }
+
+    if((nb_directories < 1) || (first_input >= argc)) {
+        fprintf(stderr, "Usage: %s [-j workers] [-c cache_directory] [-o snapshot_file] exp_files_directory [exp_files_directory] filename\n", argv[0]);
+        fprintf(stderr, "       %s [-j workers] [-c cache_directory] exp_files_directory [exp_files_directory] -- filename|directory|@list [filename|directory|@list]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
-    if((cf = read_cap_file(argv[argc-1])) == NULL)
+    if((filenames = get_file_batch(argv + first_input, argc - first_input, ".cap", &nb_filenames)) == NULL)
         return EXIT_FAILURE;
 
-    nb_directories = argc - 2;
-    directories = (char**)malloc(sizeof(char*) * nb_directories);
-    if(directories == NULL) {
-        perror("main");
+    if((options.snapshot_filename != NULL) && (nb_filenames > 1)) {
+        fprintf(stderr, "A snapshot can only be written for a single input\n");
         return EXIT_FAILURE;
     }
 
-    for(; i < nb_directories; ++i)
-        directories[i] = argv[1 + i];
+    options.export_files = get_export_files_from_directories(argv + first_directory, nb_directories, &options.nb_export_files);
 
-    export_files = get_export_files_from_directories(directories, nb_directories, &nb_export_files);
+    init_file_sink(&sink, stdout);
+    init_file_sink(&report, stderr);
 
-    if((acf = analyze_cap_file(cf, export_files, nb_export_files)) == NULL)
-        return EXIT_FAILURE;
+    failed = process_file_batch(filenames, nb_filenames, nb_workers, dump_analyzed_cap_file, &options, &sink, &report);
 
-    verbose_constant_info(acf);
-    printf("\n");
-    verbose_imported_package(acf);
-    printf("\n");
-    verbose_constant_pool(acf);
-    printf("\n");
-    verbose_signature_pool(acf);
-    printf("\n");
-    verbose_interfaces(acf);
-    printf("\n");
-    verbose_classes(acf);
-    printf("\n");
-    verbose_exception_handlers(acf);
+    if((flush_verbose_sink(&sink) == -1) || (flush_verbose_sink(&report) == -1) || (failed != 0))
+        return EXIT_FAILURE;
 
     return EXIT_SUCCESS;
 
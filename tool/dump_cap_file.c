@@ -40,51 +40,94 @@
 
 /**
  * \file dump_cap_file.c
- * \brief Read, parse and output a .CAP file.
+ * \brief Read, parse and output .CAP files.
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <cap_file.h>
 #include <cap_file_reader.h>
 #include <cap_file_verbose.h>
+#include <file_batch.h>
 
-int main(int argc, char* argv[]) {
+
+/**
+ * Read and output one CAP file.
+ */
+static int dump_cap_file(const char* filename, verbose_sink* output, verbose_sink* report, void* data) {
 
     cap_file* cf = NULL;
 
-    if(argc != 2) {
-        fprintf(stderr, "Usage: %s capFile\n", argv[0]);
+    (void)report;
+    (void)data;
+
+    if((cf = read_cap_file(filename)) == NULL)
+        return -1;
+
+    verbose_manifest(output, cf);
+    sink_printf(output, "\n");
+    verbose_header_component(output, cf);
+    sink_printf(output, "\n");
+    verbose_directory_component(output, cf);
+    sink_printf(output, "\n");
+    verbose_applet_component(output, cf);
+    sink_printf(output, "\n");
+    verbose_import_component(output, cf);
+    sink_printf(output, "\n");
+    verbose_constant_pool_component(output, cf);
+    sink_printf(output, "\n");
+    verbose_class_component(output, cf);
+    sink_printf(output, "\n");
+    verbose_method_component(output, cf);
+    sink_printf(output, "\n");
+    verbose_static_field_component(output, cf); 
+    sink_printf(output, "\n");
+    verbose_reference_location_component(output, cf);
+    sink_printf(output, "\n");
+    verbose_export_component(output, cf);
+    sink_printf(output, "\n");
+    verbose_descriptor_component(output, cf);
+
+    free_cap_file(cf);
+
+    return 0;
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+    verbose_sink sink;
+    verbose_sink report;
+    char** filenames = NULL;
+    int nb_filenames = 0;
+    int nb_workers = 1;
+    int first_input = 1;
+    int failed = 0;
+
+    if((argc > 2) && (strcmp(argv[1], "-j") == 0)) {
+        nb_workers = atoi(argv[2]);
+        first_input = 3;
+    }
+
+    if(argc < first_input + 1) {
+        fprintf(stderr, "Usage: %s [-j workers] capFile|directory|@list [capFile|directory|@list]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
-    if((cf = read_cap_file(argv[1])) == NULL)
+    if((filenames = get_file_batch(argv + first_input, argc - first_input, ".cap", &nb_filenames)) == NULL)
+        return EXIT_FAILURE;
+
+    init_file_sink(&sink, stdout);
+    init_file_sink(&report, stderr);
+
+    failed = process_file_batch(filenames, nb_filenames, nb_workers, dump_cap_file, NULL, &sink, &report);
+
+    if((flush_verbose_sink(&sink) == -1) || (flush_verbose_sink(&report) == -1) || (failed != 0))
         return EXIT_FAILURE;
 
-    verbose_manifest(cf);
-    printf("\n");
-    verbose_header_component(cf);
-    printf("\n");
-    verbose_directory_component(cf);
-    printf("\n");
-    verbose_applet_component(cf);
-    printf("\n");
-    verbose_import_component(cf);
-    printf("\n");
-    verbose_constant_pool_component(cf);
-    printf("\n");
-    verbose_class_component(cf);
-    printf("\n");
-    verbose_method_component(cf);
-    printf("\n");
-    verbose_static_field_component(cf); 
-    printf("\n");
-    verbose_reference_location_component(cf);
-    printf("\n");
-    verbose_export_component(cf);
-    printf("\n");
-    verbose_descriptor_component(cf);
     return EXIT_SUCCESS;
 
-}    
+}
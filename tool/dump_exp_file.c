@@ -40,29 +40,69 @@
 
 /**
  * \file dump_exp_file.c
- * \brief Read, parse and output an export file.
+ * \brief Read, parse and output export files.
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <exp_file.h>
 #include <exp_file_verbose.h>
 #include <exp_file_reader.h>
+#include <file_batch.h>
 
-int main(int argc, char* argv[]) {
+
+/**
+ * Read and output one export file.
+ */
+static int dump_exp_file(const char* filename, verbose_sink* output, verbose_sink* report, void* data) {
 
     export_file* ef = NULL;
 
-    if(argc != 2) {
-        fprintf(stderr, "usage: %s filename\n", argv[0]);
+    (void)report;
+    (void)data;
+
+    if((ef = read_export_file(filename)) == NULL)
+        return -1;
+
+    verbose_export_file(output, ef);
+
+    return 0;
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+    verbose_sink sink;
+    verbose_sink report;
+    char** filenames = NULL;
+    int nb_filenames = 0;
+    int nb_workers = 1;
+    int first_input = 1;
+    int failed = 0;
+
+    if((argc > 2) && (strcmp(argv[1], "-j") == 0)) {
+        nb_workers = atoi(argv[2]);
+        first_input = 3;
+    }
+
+    if(argc < first_input + 1) {
+        fprintf(stderr, "usage: %s [-j workers] filename|directory|@list [filename|directory|@list]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
-    if((ef = read_export_file(argv[1])) == NULL)
+    if((filenames = get_file_batch(argv + first_input, argc - first_input, ".exp", &nb_filenames)) == NULL)
         return EXIT_FAILURE;
 
-    verbose_export_file(ef);
+    init_file_sink(&sink, stdout);
+    init_file_sink(&report, stderr);
+
+    failed = process_file_batch(filenames, nb_filenames, nb_workers, dump_exp_file, NULL, &sink, &report);
+
+    if((flush_verbose_sink(&sink) == -1) || (flush_verbose_sink(&report) == -1) || (failed != 0))
+        return EXIT_FAILURE;
 
     return EXIT_SUCCESS;
 
@@ -40,82 +40,223 @@
 
 /**
  * \file dump_generated_cap_file.c
- * \brief Read, parse, analyze, generate and output a .CAP file.
+ * \brief Read, parse, analyze, generate and output a .CAP file. The analyzed
+ * CAP file can also be loaded from a snapshot.
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <exp_file.h>
 #include <cap_file.h>
 #include <analyzed_cap_file.h>
 #include <cap_file_reader.h>
 #include <cap_file_analyze.h>
+#include <analyzed_cap_file_snapshot.h>
+#include <analyzed_cap_file_peephole.h>
+#include <analyzed_cap_file_dead_code.h>
+#include <analyzed_cap_file_locals.h>
+#include <analyzed_cap_file_inline.h>
+#include <analyzed_cap_file_constant.h>
 #include <cap_file_generate.h>
 #include <cap_file_verbose.h>
+#include <file_batch.h>
 
 
-int main(int argc, char* argv[]) {
+/**
+ * What is shared by the generations from all the inputs.
+ */
+typedef struct {
+    export_file** export_files;
+    int nb_export_files;
+    int is_snapshot;
+    int optimize;
+    int dead_code;
+    u1 flags;
+} dump_options;
+
+
+/**
+ * Read, analyze, optionally optimize, generate and output one CAP file.
+ */
+static int dump_generated_cap_file(const char* filename, verbose_sink* output, verbose_sink* report, void* data) {
 
+    dump_options* options = (dump_options*)data;
     cap_file* cf = NULL;
     cap_file* new_cf = NULL;
     analyzed_cap_file* acf = NULL;
 
     int i = 0;
-    char** directories = NULL;
-    int nb_directories = 0;
-    export_file** export_files = NULL;
-    int nb_export_files = 0;
+    generate_report generated;
+    peephole_report* peephole_reports = NULL;
+    u2 peephole_reports_count = 0;
+    dead_code_report removed;
+    locals_report locals;
+    inline_report inlined;
+    constant_report folded;
 
-    if(argc < 3) {
-        fprintf(stderr, "Usage: %s exp_files_directory [exp_files_directory] filename\n", argv[0]);
-        return EXIT_FAILURE;
+    if(options->is_snapshot)
+        acf = read_analyzed_cap_file_snapshot(filename, options->export_files, options->nb_export_files);
+    else if((cf = read_cap_file(filename)) != NULL)
+        acf = analyze_cap_file(cf, options->export_files, options->nb_export_files);
+
+    free_cap_file(cf);
+
+    if(acf == NULL)
+        return -1;
+
+    if(options->dead_code) {
+        if(remove_dead_code(acf, &removed) == -1) {
+            free_analyzed_cap_file(acf);
+            return -1;
+        }
+
+        sink_printf(report, "%u method(s), %u field(s), %u constant pool entry(ies) and %u signature pool entry(ies) removed\n", removed.methods_removed, removed.fields_removed, removed.constant_pool_entries_removed, removed.signature_pool_entries_removed);
     }
 
-    if((cf = read_cap_file(argv[argc - 1])) == NULL)
-        return EXIT_FAILURE;
+    if(options->optimize) {
+        if(inline_methods(acf, INLINE_MAX_CALLEE_SIZE, &inlined) == -1) {
+            free_analyzed_cap_file(acf);
+            return -1;
+        }
 
-    nb_directories = argc - 2;
-    directories = (char**)malloc(sizeof(char*) * nb_directories);
-    if(directories == NULL) {
-        perror("main");
-        return EXIT_FAILURE;
+        sink_printf(report, "%u call(s) inlined, %u method(s) removed: %u byte(s) of bytecodes before, %u after\n", inlined.calls_inlined, inlined.methods_removed, inlined.size_before, inlined.size_after);
+
+        if(fold_constants(acf, &folded) == -1) {
+            free_analyzed_cap_file(acf);
+            return -1;
+        }
+
+        sink_printf(report, "%u constant static field(s), %u load(s) replaced, %u operation(s) and %u branch(es) folded: %u byte(s) saved\n", folded.constant_fields, folded.loads_replaced, folded.operations_folded, folded.branches_folded, folded.bytes_saved);
+
+        if(allocate_locals(acf, &locals) == -1) {
+            free_analyzed_cap_file(acf);
+            return -1;
+        }
+
+        sink_printf(report, "%u method(s) with renumbered locals: %u slot(s) and %u byte(s) saved\n", locals.methods_changed, locals.slots_saved, locals.bytes_saved);
+
+        if(peephole_optimize(acf, NULL, &peephole_reports, &peephole_reports_count) == -1) {
+            free_analyzed_cap_file(acf);
+            return -1;
+        }
+
+        for(i = 0; i < peephole_reports_count; ++i)
+            sink_printf(report, "class %u method %u: %u byte(s) saved\n", peephole_reports[i].class_index, peephole_reports[i].method_index, peephole_reports[i].bytes_saved);
+    }
+
+    if((new_cf = generate_cap_file_with_flags(acf, options->flags, &generated)) == NULL) {
+        free(peephole_reports);
+        free_analyzed_cap_file(acf);
+        return -1;
     }
 
-    for(; i < nb_directories; ++i)
-        directories[i] = argv[1 + i];
+    if(options->flags)
+        sink_printf(report, "%u branch(es) narrowed, %u branch(es) widened, %u switch(es) re-encoded, %u switch(es) unrolled\n", generated.narrowed_branches, generated.widened_branches, generated.reencoded_switches, generated.unrolled_switches);
 
-    export_files = get_export_files_from_directories(directories, nb_directories, &nb_export_files);
+    verbose_manifest(output, new_cf);
+    sink_printf(output, "\n");
+    verbose_header_component(output, new_cf);
+    sink_printf(output, "\n");
+    verbose_directory_component(output, new_cf);
+    sink_printf(output, "\n");
+    verbose_applet_component(output, new_cf);
+    sink_printf(output, "\n");
+    verbose_import_component(output, new_cf);
+    sink_printf(output, "\n");
+    verbose_constant_pool_component(output, new_cf);
+    sink_printf(output, "\n");
+    verbose_class_component(output, new_cf);    
+    sink_printf(output, "\n");
+    verbose_method_component(output, new_cf);
+    sink_printf(output, "\n");
+    verbose_static_field_component(output, new_cf);
+    sink_printf(output, "\n");
+    verbose_reference_location_component(output, new_cf);
+    sink_printf(output, "\n");
+    verbose_export_component(output, new_cf);
+    sink_printf(output, "\n");
+    verbose_descriptor_component(output, new_cf);
 
-    if((acf = analyze_cap_file(cf, export_files, nb_export_files)) == NULL)
+    free(peephole_reports);
+    free_cap_file(new_cf);
+    free_analyzed_cap_file(acf);
+
+    return 0;
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+    verbose_sink sink;
+    verbose_sink report;
+    dump_options options;
+
+    char** filenames = NULL;
+    int nb_filenames = 0;
+    int nb_workers = 1;
+    int nb_directories = 0;
+    int first_input = 0;
+    int first_directory = 1;
+    int failed = 0;
+
+    options.is_snapshot = 0;
+    options.optimize = 0;
+    options.dead_code = 0;
+    options.flags = 0;
+
+    while((first_directory < argc) && (argv[first_directory][0] == '-')) {
+        if(strcmp(argv[first_directory], "-s") == 0)
+            options.is_snapshot = 1;
+        else if(strcmp(argv[first_directory], "-d") == 0)
+            options.dead_code = 1;
+        else if(strcmp(argv[first_directory], "-O") == 0) {
+            options.flags |= GENERATE_SORT_CONSTANT_POOL|GENERATE_LOWER_SWITCHES|GENERATE_INCREMENTAL_LAYOUT;
+            options.optimize = 1;
+        }
+        else if((strcmp(argv[first_directory], "-j") == 0) && (first_directory + 1 < argc))
+            nb_workers = atoi(argv[++first_directory]);
+        else
+            break;
+
+        ++first_directory;
+    }
+
+    /* The inputs follow a -- or, without it, are the last argument. */
+    for(first_input = first_directory; (first_input < argc) && (strcmp(argv[first_input], "--") != 0); ++first_input);
+
+    if(first_input < argc) {
+        nb_directories = first_input - first_directory;
+        ++first_input;
+    } else {
+        first_input = argc - 1;
+        nb_directories = first_input - first_directory;
+    }
+
+    if((nb_directories < 1) || (first_input >= argc)) {
+        fprintf(stderr, "Usage: %s [-s] [-d] [-O] [-j workers] exp_files_directory [exp_files_directory] filename\n", argv[0]);
+        fprintf(stderr, "       %s [-s] [-d] [-O] [-j workers] exp_files_directory [exp_files_directory] -- filename|directory|@list [filename|directory|@list]\n", argv[0]);
+        fprintf(stderr, "\t-s: filename is a snapshot of an analyzed CAP file\n");
+        fprintf(stderr, "\t-d: remove the methods and fields which cannot be reached\n");
+        fprintf(stderr, "\t-O: optimize the generated CAP file\n");
+        fprintf(stderr, "\t-j: number of files processed at once\n");
         return EXIT_FAILURE;
+    }
 
-    if((new_cf = generate_cap_file(acf)) == NULL)
+    if((filenames = get_file_batch(argv + first_input, argc - first_input, options.is_snapshot ? NULL : ".cap", &nb_filenames)) == NULL)
         return EXIT_FAILURE;
 
-    verbose_manifest(new_cf);
-    printf("\n");
-    verbose_header_component(new_cf);
-    printf("\n");
-    verbose_directory_component(new_cf);
-    printf("\n");
-    verbose_applet_component(new_cf);
-    printf("\n");
-    verbose_import_component(new_cf);
-    printf("\n");
-    verbose_constant_pool_component(new_cf);
-    printf("\n");
-    verbose_class_component(new_cf);    
-    printf("\n");
-    verbose_method_component(new_cf);
-    printf("\n");
-    verbose_static_field_component(new_cf);
-    printf("\n");
-    verbose_reference_location_component(new_cf);
-    printf("\n");
-    verbose_export_component(new_cf);
-    printf("\n");
-    verbose_descriptor_component(new_cf);
+    options.export_files = get_export_files_from_directories(argv + first_directory, nb_directories, &options.nb_export_files);
+
+    init_file_sink(&sink, stdout);
+    init_file_sink(&report, stderr);
+
+    failed = process_file_batch(filenames, nb_filenames, nb_workers, dump_generated_cap_file, &options, &sink, &report);
+
+    if((flush_verbose_sink(&sink) == -1) || (flush_verbose_sink(&report) == -1) || (failed != 0))
+        return EXIT_FAILURE;
 
     return EXIT_SUCCESS;
 
@@ -0,0 +1,123 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 .CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file dump_structured_file.c
+ * \brief Read and output a .CAP file, an analyzed .CAP file or an export
+ * file as a JSON or CBOR document.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <exp_file.h>
+#include <exp_file_reader.h>
+#include <exp_file_serialize.h>
+#include <cap_file.h>
+#include <cap_file_reader.h>
+#include <cap_file_serialize.h>
+#include <analyzed_cap_file.h>
+#include <cap_file_analyze.h>
+#include <analyzed_cap_file_serialize.h>
+#include <structured_writer.h>
+
+
+int main(int argc, char* argv[]) {
+
+    verbose_sink sink;
+    structured_writer writer;
+    int format = STRUCTURED_JSON;
+    int first_arg = 1;
+    int ret = 0;
+
+    if((argc > 1) && (strcmp(argv[1], "-b") == 0)) {
+        format = STRUCTURED_CBOR;
+        first_arg = 2;
+    }
+
+    if((argc < first_arg + 2) || ((strcmp(argv[first_arg], "analyzed") == 0) && (argc < first_arg + 3)) || ((strcmp(argv[first_arg], "analyzed") != 0) && (argc != first_arg + 2))) {
+        fprintf(stderr, "Usage: %s [-b] cap filename\n       %s [-b] analyzed exp_files_directory [exp_files_directory] filename\n       %s [-b] exp filename\n", argv[0], argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    init_file_sink(&sink, stdout);
+    init_structured_writer(&writer, &sink, format);
+
+    if(strcmp(argv[first_arg], "cap") == 0) {
+        cap_file* cf = read_cap_file(argv[first_arg + 1]);
+
+        if(cf == NULL)
+            return EXIT_FAILURE;
+
+        ret = serialize_cap_file(&writer, cf);
+    } else if(strcmp(argv[first_arg], "exp") == 0) {
+        export_file* ef = read_export_file(argv[first_arg + 1]);
+
+        if(ef == NULL)
+            return EXIT_FAILURE;
+
+        ret = serialize_export_file(&writer, ef);
+    } else if(strcmp(argv[first_arg], "analyzed") == 0) {
+        cap_file* cf = NULL;
+        analyzed_cap_file* acf = NULL;
+        export_file** export_files = NULL;
+        int nb_export_files = 0;
+
+        if((cf = read_cap_file(argv[argc - 1])) == NULL)
+            return EXIT_FAILURE;
+
+        export_files = get_export_files_from_directories(argv + first_arg + 1, argc - first_arg - 2, &nb_export_files);
+
+        if((acf = analyze_cap_file(cf, export_files, nb_export_files)) == NULL)
+            return EXIT_FAILURE;
+
+        ret = serialize_analyzed_cap_file(&writer, acf);
+    } else {
+        fprintf(stderr, "Unknown kind of file %s\n", argv[first_arg]);
+        return EXIT_FAILURE;
+    }
+
+    if((ret == -1) || (end_document(&writer) == -1) || (flush_verbose_sink(&sink) == -1))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file index_cap_file.c
+ * \brief Index the external names used by .CAP files or search the index for
+ * the usages of a name.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <exp_file.h>
+#include <cap_file_analyze.h>
+#include <cap_file_index.h>
+#include <file_batch.h>
+
+
+/**
+ * Output the usages of each name. A name ending with * is a prefix.
+ */
+static int query(const char* index_file, char* const* names, int nb_names) {
+
+    verbose_sink sink;
+    int failed = 0;
+    int i = 0;
+
+    init_file_sink(&sink, stdout);
+
+    for(; i < nb_names; ++i) {
+        size_t length = strlen(names[i]);
+        int is_prefix = (length > 0) && (names[i][length - 1] == '*');
+
+        if(is_prefix)
+            names[i][length - 1] = '\0';
+
+        if(query_cap_file_index(index_file, names[i], is_prefix, &sink) == -1) {
+            failed = 1;
+            break;
+        }
+    }
+
+    if((flush_verbose_sink(&sink) == -1) || failed)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+    verbose_sink sink;
+    verbose_sink report;
+    cap_file_index* index = NULL;
+    export_file** export_files = NULL;
+    char* cache_directory = NULL;
+
+    char** filenames = NULL;
+    int nb_filenames = 0;
+    int nb_export_files = 0;
+    int nb_workers = 1;
+    int nb_directories = 0;
+    int first_input = 0;
+    int first_directory = 1;
+    int failed = 0;
+
+    if((argc > 3) && (strcmp(argv[1], "-q") == 0))
+        return query(argv[2], argv + 3, argc - 3);
+
+    while((first_directory + 1 < argc) && (argv[first_directory][0] == '-')) {
+        if(strcmp(argv[first_directory], "-c") == 0)
+            cache_directory = argv[first_directory + 1];
+        else if(strcmp(argv[first_directory], "-j") == 0)
+            nb_workers = atoi(argv[first_directory + 1]);
+        else
+            break;
+
+        first_directory += 2;
+    }
+
+    /* The index file comes before the export files directories. */
+    ++first_directory;
+
+    /* The inputs follow a -- or, without it, are the last argument. */
+    for(first_input = first_directory; (first_input < argc) && (strcmp(argv[first_input], "--") != 0); ++first_input);
+
+    if(first_input < argc) {
+        nb_directories = first_input - first_directory;
+        ++first_input;
+    } else {
+        first_input = argc - 1;
+        nb_directories = first_input - first_directory;
+    }
+
+    if((nb_directories < 1) || (first_input >= argc)) {
+        fprintf(stderr, "Usage: %s [-j workers] [-c cache_directory] index_file exp_files_directory [exp_files_directory] filename\n", argv[0]);
+        fprintf(stderr, "       %s [-j workers] [-c cache_directory] index_file exp_files_directory [exp_files_directory] -- filename|directory|@list [filename|directory|@list]\n", argv[0]);
+        fprintf(stderr, "       %s -q index_file name|prefix* [name|prefix*]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if((filenames = get_file_batch(argv + first_input, argc - first_input, ".cap", &nb_filenames)) == NULL)
+        return EXIT_FAILURE;
+
+    export_files = get_export_files_from_directories(argv + first_directory, nb_directories, &nb_export_files);
+
+    if((index = read_cap_file_index(argv[first_directory - 1], export_files, nb_export_files)) == NULL)
+        return EXIT_FAILURE;
+
+    init_file_sink(&sink, stdout);
+    init_file_sink(&report, stderr);
+
+    failed = update_cap_file_index(index, filenames, nb_filenames, nb_workers, cache_directory, &sink, &report);
+
+    /* The CAP files which could be indexed are kept even if others failed. */
+    if((failed == -1) || (write_cap_file_index(index, argv[first_directory - 1]) == -1))
+        failed = -1;
+
+    free_cap_file_index(index);
+    free_file_batch(filenames, nb_filenames);
+
+    if((flush_verbose_sink(&sink) == -1) || (flush_verbose_sink(&report) == -1) || (failed != 0))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+
+}
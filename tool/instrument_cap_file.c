@@ -0,0 +1,187 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file instrument_cap_file.c
+ * \brief Read, parse and analyze a .CAP file, inject probe calls into it,
+ * then write it along with its block map.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <exp_file.h>
+#include <cap_file.h>
+#include <analyzed_cap_file.h>
+#include <cap_file_reader.h>
+#include <cap_file_analyze.h>
+#include <analyzed_cap_file_instrument.h>
+#include <cap_file_generate.h>
+#include <cap_file_writer.h>
+#include <verbose_sink.h>
+
+
+/**
+ * Find the probe given either as class_index.method_index or as
+ * package/Class.method.
+ */
+static int get_probe(const char* name, analyzed_cap_file* acf, export_file** export_files, int nb_export_files, instrument_probe* probe) {
+
+    const char* dot = strrchr(name, '.');
+    char* class_name = NULL;
+    int i = 0;
+
+    if(dot == NULL) {
+        fprintf(stderr, "Invalid probe %s\n", name);
+        return -1;
+    }
+
+    if(isdigit((unsigned char)name[0])) {
+        unsigned long class_index = strtoul(name, NULL, 0);
+        unsigned long method_index = strtoul(dot + 1, NULL, 0);
+
+        if((class_index >= acf->classes_count) || (method_index >= acf->classes[class_index]->methods_count)) {
+            fprintf(stderr, "No method %lu in class %lu\n", method_index, class_index);
+            return -1;
+        }
+
+        probe->method = acf->classes[class_index]->methods[method_index];
+        probe->ef = NULL;
+        return 0;
+    }
+
+    class_name = (char*)malloc(dot - name + 1);
+    if(class_name == NULL) {
+        perror("get_probe");
+        return -1;
+    }
+    memcpy(class_name, name, dot - name);
+    class_name[dot - name] = '\0';
+
+    for(; i < nb_export_files; ++i)
+        if(find_external_probe(export_files[i], class_name, dot + 1, probe) == 0) {
+            free(class_name);
+            return 0;
+        }
+
+    fprintf(stderr, "No static method %s of signature (S)V in the export files\n", name);
+    free(class_name);
+
+    return -1;
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+    cap_file* cf = NULL;
+    cap_file* new_cf = NULL;
+    analyzed_cap_file* acf = NULL;
+    export_file** export_files = NULL;
+    int nb_export_files = 0;
+    instrument_probe probe;
+    block_map_entry* map = NULL;
+    u2 map_count = 0;
+    verbose_sink sink;
+    FILE* map_file = NULL;
+    u1 flags = 0;
+    int first_arg = 1;
+    int failed = 0;
+
+    for(; (first_arg < argc) && (argv[first_arg][0] == '-'); ++first_arg) {
+        if(strcmp(argv[first_arg], "-e") == 0)
+            flags |= INSTRUMENT_ENTRIES;
+        else if(strcmp(argv[first_arg], "-x") == 0)
+            flags |= INSTRUMENT_EXITS;
+        else if(strcmp(argv[first_arg], "-b") == 0)
+            flags |= INSTRUMENT_BLOCKS;
+        else
+            break;
+    }
+
+    if(argc < first_arg + 5) {
+        fprintf(stderr, "Usage: %s [-e] [-x] [-b] probe exp_files_directory [exp_files_directory] filename instrumented_filename map_filename\n", argv[0]);
+        fprintf(stderr, "\tCall probe, either class_index.method_index or package/Class.method of signature (S)V, with an id\n");
+        fprintf(stderr, "\t-e: at each method entry\n");
+        fprintf(stderr, "\t-x: before each return\n");
+        fprintf(stderr, "\t-b: at each basic block (default)\n");
+        return EXIT_FAILURE;
+    }
+
+    if(flags == 0)
+        flags = INSTRUMENT_BLOCKS;
+
+    if((cf = read_cap_file(argv[argc - 3])) == NULL)
+        return EXIT_FAILURE;
+
+    export_files = get_export_files_from_directories(argv + first_arg + 1, argc - first_arg - 4, &nb_export_files);
+
+    if((acf = analyze_cap_file(cf, export_files, nb_export_files)) == NULL)
+        return EXIT_FAILURE;
+
+    if(get_probe(argv[first_arg], acf, export_files, nb_export_files, &probe) == -1)
+        return EXIT_FAILURE;
+
+    if(instrument_cap_file(acf, &probe, flags, &map, &map_count) == -1)
+        return EXIT_FAILURE;
+
+    if(((new_cf = generate_cap_file_with_flags(acf, GENERATE_COPY_UNCHANGED, NULL)) == NULL) || (write_cap_file(new_cf, argv[argc - 2]) == -1))
+        return EXIT_FAILURE;
+
+    if((map_file = fopen(argv[argc - 1], "w")) == NULL) {
+        perror(argv[argc - 1]);
+        return EXIT_FAILURE;
+    }
+
+    init_file_sink(&sink, map_file);
+    failed = (print_block_map(&sink, map, map_count) == -1) || (flush_verbose_sink(&sink) == -1);
+
+    if((fclose(map_file) != 0) || failed)
+        return EXIT_FAILURE;
+
+    fprintf(stderr, "%u probe(s) injected\n", map_count);
+
+    free(map);
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file profile_cap_file.c
+ * \brief Read, parse and analyze a .CAP file, then run one of its methods
+ * and output its profile.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <exp_file.h>
+#include <cap_file.h>
+#include <analyzed_cap_file.h>
+#include <cap_file_reader.h>
+#include <cap_file_analyze.h>
+#include <analyzed_cap_file_interpreter.h>
+#include <bytecodes.h>
+
+
+int main(int argc, char* argv[]) {
+
+    cap_file* cf = NULL;
+    analyzed_cap_file* acf = NULL;
+    interpreter* interp = NULL;
+    method_info* method = NULL;
+
+    int i = 0;
+    char* directory = NULL;
+    export_file** export_files = NULL;
+    int nb_export_files = 0;
+    u2 class_index = 0;
+    u2 method_index = 0;
+    int16_t args[255];
+    u1 args_count = 0;
+    int16_t result[2];
+    u1 result_count = 0;
+    int outcome = 0;
+    u4 max_steps = 1000000;
+    int first_arg = 1;
+
+    if((argc > 2) && (strcmp(argv[1], "-n") == 0)) {
+        max_steps = strtoul(argv[2], NULL, 0);
+        first_arg = 3;
+    }
+
+    if(argc < first_arg + 4) {
+        fprintf(stderr, "Usage: %s [-n max_steps] exp_files_directory filename class_index method_index [short_arg ...]\n", argv[0]);
+        fprintf(stderr, "\tRun a method with the given words as arguments and print its profile\n");
+        fprintf(stderr, "\t-n: stop after max_steps bytecodes (default: 1000000, 0 for no limit)\n");
+        return EXIT_FAILURE;
+    }
+
+    directory = argv[first_arg];
+
+    if((cf = read_cap_file(argv[first_arg + 1])) == NULL)
+        return EXIT_FAILURE;
+
+    export_files = get_export_files_from_directories(&directory, 1, &nb_export_files);
+
+    if((acf = analyze_cap_file(cf, export_files, nb_export_files)) == NULL)
+        return EXIT_FAILURE;
+
+    class_index = strtoul(argv[first_arg + 2], NULL, 0);
+    method_index = strtoul(argv[first_arg + 3], NULL, 0);
+
+    if((class_index >= acf->classes_count) || (method_index >= acf->classes[class_index]->methods_count)) {
+        fprintf(stderr, "No method %u in class %u\n", method_index, class_index);
+        return EXIT_FAILURE;
+    }
+
+    method = acf->classes[class_index]->methods[method_index];
+
+    for(i = first_arg + 4; (i < argc) && (args_count < 255); ++i)
+        args[args_count++] = (int16_t)strtol(argv[i], NULL, 0);
+
+    if((interp = new_interpreter(acf, NULL)) == NULL)
+        return EXIT_FAILURE;
+
+    interp->max_steps = max_steps;
+
+    if((outcome = interpret_method(interp, method, args, args_count, result, &result_count)) == -1)
+        return EXIT_FAILURE;
+
+    if(outcome == INTERPRETER_THREW)
+        printf("threw object %d\n", result[0]);
+    else if(result_count == 2)
+        printf("returned %d\n", (int32_t)(((uint32_t)(uint16_t)result[0] << 16) | (uint16_t)result[1]));
+    else if(result_count == 1)
+        printf("returned %d\n", result[0]);
+    else
+        printf("returned\n");
+
+    printf("%u bytecode(s) executed, %u cycle(s)\n\n", interp->steps, interp->cycles);
+
+    for(i = 0; i < 256; ++i)
+        if(interp->opcode_counts[i] != 0)
+            printf("%-18s %u\n", opcodes[i].mnemonic, interp->opcode_counts[i]);
+
+    for(i = 0; i < interp->profiles_count; ++i) {
+        method_profile* profile = interp->profiles + i;
+        u2 u2Index = 0;
+
+        if(profile->invocations == 0)
+            continue;
+
+        printf("\nmethod at offset %u: %u invocation(s), %u cycle(s)\n", profile->method->offset, profile->invocations, profile->cycles);
+
+        for(; u2Index < profile->method->bytecodes_count; ++u2Index) {
+            if(profile->executions[u2Index] == 0)
+                continue;
+
+            printf("\t%5u %-18s %u", u2Index, opcodes[profile->method->bytecodes[u2Index]->opcode].mnemonic, profile->executions[u2Index]);
+            if((opcodes[profile->method->bytecodes[u2Index]->opcode].format == OPCODE_FORMAT_BRANCH) || (profile->taken[u2Index] != 0))
+                printf(" (%u taken)", profile->taken[u2Index]);
+            printf("\n");
+        }
+    }
+
+    free_interpreter(interp);
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright Inria:
+ * Jean-François Hren
+ * 
+ * jfhren[at]gmail[dot]com
+ * michael[dot]hauspie[at]lifl[dot]com
+ * 
+ * This software is a computer program whose purpose is to read, analyze,
+ * modify, generate and write Java Card 2 CAP file.
+ * 
+ * This software is governed by the CeCILL-B license under French
+ * law and
+ * abiding by the rules of distribution of free software.  You can  use, 
+ * modify and/ or redistribute the software under the terms of the
+ * CeCILL-B
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info". 
+ * 
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability. 
+ * 
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or 
+ * data to be ensured and,  more generally, to use and operate it in the 
+ * same conditions as regards security. 
+ * 
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-B license and that you accept its
+ * terms.
+ */
+
+/**
+ * \file verify_cap_file.c
+ * \brief Read, parse and analyze .CAP files and verify their bytecodes.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <exp_file.h>
+#include <cap_file.h>
+#include <cap_file_reader.h>
+#include <analyzed_cap_file.h>
+#include <cap_file_analyze.h>
+#include <cap_file_cache.h>
+#include <analyzed_cap_file_verify.h>
+#include <file_batch.h>
+
+
+/**
+ * What is shared by the verifications of all the inputs.
+ */
+typedef struct {
+    export_file** export_files;
+    int nb_export_files;
+    char* cache_directory;
+} verify_options;
+
+
+/**
+ * Read, analyze and verify one CAP file. Fail if a method is rejected.
+ */
+static int verify_one_cap_file(const char* filename, verbose_sink* output, verbose_sink* report, void* data) {
+
+    verify_options* options = (verify_options*)data;
+    cap_file* cf = NULL;
+    analyzed_cap_file* acf = NULL;
+    verify_failure* failures = NULL;
+    u2 failures_count = 0;
+    u4 methods_count = 0;
+    u2 u2Index = 0;
+    int rejected = 0;
+
+    (void)report;
+
+    if(options->cache_directory != NULL)
+        acf = read_and_analyze_cap_file(options->cache_directory, filename, options->export_files, options->nb_export_files);
+    else if((cf = read_cap_file(filename)) != NULL)
+        acf = analyze_cap_file(cf, options->export_files, options->nb_export_files);
+
+    free_cap_file(cf);
+
+    if(acf == NULL)
+        return -1;
+
+    if((rejected = verify_cap_file(acf, &failures, &failures_count)) == -1) {
+        free_analyzed_cap_file(acf);
+        return -1;
+    }
+
+    for(; u2Index < acf->classes_count; ++u2Index)
+        methods_count += acf->classes[u2Index]->methods_count;
+
+    if((print_verify_failures(output, failures, failures_count) == -1) ||
+       (sink_printf(output, "%u methods, %u rejected\n", methods_count, failures_count) == -1))
+        rejected = -1;
+
+    free(failures);
+    free_analyzed_cap_file(acf);
+
+    return (rejected == 0) ? 0 : -1;
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+    verbose_sink sink;
+    verbose_sink report;
+    verify_options options;
+
+    char** filenames = NULL;
+    int nb_filenames = 0;
+    int nb_workers = 1;
+    int nb_directories = 0;
+    int first_input = 0;
+    int first_directory = 1;
+    int failed = 0;
+
+    options.cache_directory = NULL;
+
+    while((first_directory + 1 < argc) && (argv[first_directory][0] == '-')) {
+        if(strcmp(argv[first_directory], "-c") == 0)
+            options.cache_directory = argv[first_directory + 1];
+        else if(strcmp(argv[first_directory], "-j") == 0)
+            nb_workers = atoi(argv[first_directory + 1]);
+        else
+            break;
+
+        first_directory += 2;
+    }
+
+    /* The inputs follow a -- or, without it, are the last argument. */
+    for(first_input = first_directory; (first_input < argc) && (strcmp(argv[first_input], "--") != 0); ++first_input);
+
+    if(first_input < argc) {
+        nb_directories = first_input - first_directory;
+        ++first_input;
+    } else {
+        first_input = argc - 1;
+        nb_directories = first_input - first_directory;
+    }
+
+    if((nb_directories < 1) || (first_input >= argc)) {
+        fprintf(stderr, "Usage: %s [-j workers] [-c cache_directory] exp_files_directory [exp_files_directory] filename\n", argv[0]);
+        fprintf(stderr, "       %s [-j workers] [-c cache_directory] exp_files_directory [exp_files_directory] -- filename|directory|@list [filename|directory|@list]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if((filenames = get_file_batch(argv + first_input, argc - first_input, ".cap", &nb_filenames)) == NULL)
+        return EXIT_FAILURE;
+
+    options.export_files = get_export_files_from_directories(argv + first_directory, nb_directories, &options.nb_export_files);
+
+    init_file_sink(&sink, stdout);
+    init_file_sink(&report, stderr);
+
+    failed = process_file_batch(filenames, nb_filenames, nb_workers, verify_one_cap_file, &options, &sink, &report);
+
+    if((flush_verbose_sink(&sink) == -1) || (flush_verbose_sink(&report) == -1) || (failed != 0))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+
+}